@@ -41,6 +41,12 @@
 #include "gsfname.h"
 
 #include "gxfapi.h"
+#include "gxfcfile.h"
+#include "gsmd5.h"
+#include "gscdefs.h"
+#include "gslibctx.h"
+#include "gssprintf.h"
+#include "gxsync.h"
 
 
 /* FreeType headers */
@@ -65,6 +71,53 @@
 #define ft_emprintf(m,s) { outflush(m); emprintf(m, s); outflush(m); }
 #define ft_emprintf1(m,s,d) { outflush(m); emprintf1(m, s, d); outflush(m); }
 
+/* The number of sizes kept on a face, so that a font used at a few sizes
+ * doesn't have its size set up again (and, for TrueType, its prep program
+ * run again) each time it changes from one to another.
+ */
+#define FF_FACE_SIZES 8
+
+/* The number of faces that no font is using which the face cache keeps,
+ * and the amount of font data they may hold between them.
+ */
+#define FF_FACE_CACHE_UNUSED 16
+#define FF_FACE_CACHE_UNUSED_BYTES (32 * 1024 * 1024)
+
+typedef struct ff_size_s
+{
+    FT_Size ft_size;            /* NULL if not made yet */
+    bool valid;                 /* the scale below has been set on it */
+    FT_F26Dot6 width, height;
+    FT_UInt horz_res;
+    FT_UInt vert_res;
+    uint last_used;
+} ff_size;
+
+/* An FT_Face, with the data it was opened from and the sizes made for it.
+ * A face opened from a complete font program - a font file, or a buffer
+ * holding the whole font - doesn't call back into the font it was opened
+ * for, so it goes in the server's face cache and is shared by every font
+ * that uses the same program, including fonts in later jobs.
+ */
+typedef struct ff_ft_face_s ff_ft_face;
+struct ff_ft_face_s
+{
+    ff_ft_face *next;           /* in the face cache, most recently used first */
+    int refs;                   /* ff_face objects using this */
+    bool cached;
+    byte key[16];               /* see face_cache_key */
+    FT_Face ft_face;
+    FT_CharMap charmap;         /* the one FreeType chose when opening the face */
+    /* If non-null, we're using a custom stream object for Freetype to read the font file */
+    FT_Stream ftstrm;
+    /* Non-null if font data is owned by this object. */
+    unsigned char *font_data;
+    int font_data_len;
+    bool data_owned;
+    ff_size sizes[FF_FACE_SIZES];
+    uint size_clock;
+};
+
 typedef struct ff_server_s
 {
     gs_fapi_server fapi_server;
@@ -74,29 +127,36 @@ typedef struct ff_server_s
     gs_memory_t *mem;
     FT_Memory ftmemory;
     struct FT_MemoryRec_ ftmemory_rec;
+    /* Rendered glyphs kept from earlier runs, if we have a file for them. */
+    gx_font_cache_file *glyph_file;
+    bool glyph_file_opened;
+    /* Faces opened from complete font programs, see ff_ft_face. */
+    ff_ft_face *face_cache;
+    gx_monitor_t *face_cache_lock;
 } ff_server;
 
 
 
 typedef struct ff_face_s
 {
-    FT_Face ft_face;
+    FT_Face ft_face;            /* ftf->ft_face */
+    ff_ft_face *ftf;
 
     /* Currently in force scaling/transform for this face */
     FT_Matrix ft_transform;
     FT_F26Dot6 width, height;
     FT_UInt horz_res;
     FT_UInt vert_res;
+    /* The character map chosen for this font, which may not be the one
+     * another font sharing the FT_Face wants. */
+    FT_CharMap charmap;
 
     /* If non-null, the incremental interface object passed to FreeType. */
     FT_Incremental_InterfaceRec *ft_inc_int;
-    /* If non-null, we're using a custom stream object for Freetype to read the font file */
-    FT_Stream ftstrm;
-    /* Non-null if font data is owned by this object. */
-    unsigned char *font_data;
-    int font_data_len;
-    bool data_owned;
     ff_server *server;
+    /* Identifies the font program in the glyph cache file. */
+    byte digest[16];
+    bool has_digest;
 } ff_face;
 
 /* Here we define the struct FT_Incremental that is used as an opaque type
@@ -115,6 +175,7 @@ typedef struct FT_IncrementalRec_
     FT_Incremental_MetricsRec glyph_metrics;    /* Incremental glyph metrics supplied by Ghostscript. */
     unsigned long glyph_metrics_index;  /* contains data for this glyph index unless it is 0xFFFFFFFF. */
     gs_fapi_metrics_type metrics_type;  /* determines whether metrics are replaced, added, etc. */
+    int glyph_data_requests;    /* Count of glyphs fetched, to detect composites. */
 } FT_IncrementalRec;
 
 
@@ -126,6 +187,9 @@ static void
 delete_inc_int_info(gs_fapi_server * a_server,
                     FT_IncrementalRec * a_inc_int_info);
 
+static void
+md5_append_int(gs_md5_state_t *md5, int64_t v);
+
 static void *
 FF_alloc(FT_Memory memory, long size)
 {
@@ -275,23 +339,216 @@ FF_open_read_stream(gs_memory_t * mem, char *fname, FT_Stream * fts)
 }
 
 
+static ff_ft_face *
+new_ft_face(gs_fapi_server * a_server, FT_Face a_ft_face, FT_Stream ftstrm,
+            unsigned char *a_font_data, int a_font_data_len, bool data_owned)
+{
+    ff_server *s = (ff_server *) a_server;
+
+    ff_ft_face *ftf = (ff_ft_face *) FF_alloc(s->ftmemory, sizeof(ff_ft_face));
+
+    if (ftf) {
+        memset(ftf, 0x00, sizeof(ff_ft_face));
+        ftf->refs = 1;
+        ftf->ft_face = a_ft_face;
+        ftf->charmap = a_ft_face->charmap;
+        ftf->ftstrm = ftstrm;
+        ftf->font_data = a_font_data;
+        ftf->font_data_len = a_font_data_len;
+        ftf->data_owned = data_owned;
+        /* The face comes with a size; use that first. */
+        ftf->sizes[0].ft_size = a_ft_face->size;
+    }
+    return ftf;
+}
+
+static void
+delete_ft_face(ff_server * s, ff_ft_face * ftf)
+{
+    FT_Done_Face(ftf->ft_face);
+    if (ftf->data_owned)
+        FF_free(s->ftmemory, ftf->font_data);
+    if (ftf->ftstrm)
+        FF_free(s->ftmemory, ftf->ftstrm);
+    FF_free(s->ftmemory, ftf);
+}
+
+/* Make the key for a font program in the face cache. For a program in
+ * memory this is the digest face_digest makes of it, so that the glyph
+ * cache file can use it too; a font file is known by its name and length.
+ */
+static void
+face_cache_key(gs_fapi_font * a_font, const byte * data, int64_t length,
+               byte key[16])
+{
+    gs_md5_state_t md5;
+
+    gs_md5_init(&md5);
+    if (data != NULL)
+        gs_md5_append(&md5, data, (int)length);
+    else {
+        gs_md5_append(&md5, (const byte *)a_font->font_file_path,
+                      strlen(a_font->font_file_path));
+        md5_append_int(&md5, length);
+    }
+    md5_append_int(&md5, a_font->subfont);
+    md5_append_int(&md5, a_font->is_type1);
+    md5_append_int(&md5, a_font->is_cid);
+    gs_md5_finish(&md5, key);
+}
+
+/* Find a face in the face cache, taking a reference to it. */
+static ff_ft_face *
+face_cache_find(ff_server * s, const byte key[16])
+{
+    ff_ft_face *ftf, **pprev;
+
+    gx_monitor_enter(s->face_cache_lock);
+    for (pprev = &s->face_cache; (ftf = *pprev) != NULL; pprev = &ftf->next) {
+        if (!memcmp(ftf->key, key, sizeof(ftf->key))) {
+            *pprev = ftf->next;
+            ftf->next = s->face_cache;
+            s->face_cache = ftf;
+            ftf->refs++;
+            break;
+        }
+    }
+    gx_monitor_leave(s->face_cache_lock);
+    return ftf;
+}
+
+static void
+face_cache_add(ff_server * s, ff_ft_face * ftf, const byte key[16])
+{
+    memcpy(ftf->key, key, sizeof(ftf->key));
+    ftf->cached = true;
+    gx_monitor_enter(s->face_cache_lock);
+    ftf->next = s->face_cache;
+    s->face_cache = ftf;
+    gx_monitor_leave(s->face_cache_lock);
+}
+
+/* Drop a reference to a face. A face in the cache is kept when no font
+ * is using it, until there are too many such faces. */
+static void
+release_ft_face(ff_server * s, ff_ft_face * ftf)
+{
+    ff_ft_face **pprev;
+    int unused = 0;
+    int64_t unused_bytes = 0;
+
+    if (!ftf->cached) {
+        delete_ft_face(s, ftf);
+        return;
+    }
+    gx_monitor_enter(s->face_cache_lock);
+    if (--ftf->refs == 0) {
+        pprev = &s->face_cache;
+        while ((ftf = *pprev) != NULL) {
+            if (ftf->refs == 0) {
+                unused++;
+                if (ftf->data_owned)
+                    unused_bytes += ftf->font_data_len;
+                if (unused > FF_FACE_CACHE_UNUSED ||
+                    unused_bytes > FF_FACE_CACHE_UNUSED_BYTES) {
+                    *pprev = ftf->next;
+                    delete_ft_face(s, ftf);
+                    continue;
+                }
+            }
+            pprev = &ftf->next;
+        }
+    }
+    gx_monitor_leave(s->face_cache_lock);
+}
+
+/* Make the FT_Size for a scale current on a face, setting up a new one
+ * if the scale isn't one of those kept on the face. */
+static FT_Error
+ft_face_set_size(ff_ft_face * ftf, FT_F26Dot6 width, FT_F26Dot6 height,
+                 FT_UInt horz_res, FT_UInt vert_res)
+{
+    ff_size *sz, *victim = NULL;
+    FT_Error ft_error;
+    int i;
+
+    for (i = 0; i < FF_FACE_SIZES; i++) {
+        sz = &ftf->sizes[i];
+        if (sz->valid && sz->width == width && sz->height == height &&
+            sz->horz_res == horz_res && sz->vert_res == vert_res) {
+            sz->last_used = ++ftf->size_clock;
+            if (ftf->ft_face->size == sz->ft_size)
+                return 0;
+            return FT_Activate_Size(sz->ft_size);
+        }
+        /* Otherwise use a slot with no scale set, or the least recently used. */
+        if (victim == NULL ||
+            (victim->valid && (!sz->valid || sz->last_used < victim->last_used)))
+            victim = sz;
+    }
+    sz = victim;
+    if (sz->ft_size == NULL) {
+        ft_error = FT_New_Size(ftf->ft_face, &sz->ft_size);
+        if (ft_error)
+            return ft_error;
+    }
+    if (ftf->ft_face->size != sz->ft_size) {
+        ft_error = FT_Activate_Size(sz->ft_size);
+        if (ft_error)
+            return ft_error;
+    }
+    sz->valid = false;
+    ft_error = FT_Set_Char_Size(ftf->ft_face, width, height, horz_res, vert_res);
+    if (ft_error)
+        return ft_error;
+    sz->valid = true;
+    sz->width = width;
+    sz->height = height;
+    sz->horz_res = horz_res;
+    sz->vert_res = vert_res;
+    sz->last_used = ++ftf->size_clock;
+    return 0;
+}
+
+/* Set the character map of this font on its FT_Face, which another font
+ * sharing the face may have changed. */
+static void
+face_select_charmap(ff_face * face)
+{
+    if (face->charmap != NULL && face->ft_face->charmap != face->charmap)
+        (void)FT_Set_Charmap(face->ft_face, face->charmap);
+}
+
+/* Likewise the size and transform. */
+static FT_Error
+face_select(ff_face * face)
+{
+    FT_Error ft_error;
+
+    ft_error = ft_face_set_size(face->ftf, face->width, face->height,
+                                face->horz_res, face->vert_res);
+    if (ft_error)
+        return ft_error;
+    FT_Set_Transform(face->ft_face, &face->ft_transform, NULL);
+    face_select_charmap(face);
+    return 0;
+}
+
 static ff_face *
-new_face(gs_fapi_server * a_server, FT_Face a_ft_face,
-         FT_Incremental_InterfaceRec * a_ft_inc_int, FT_Stream ftstrm,
-         unsigned char *a_font_data, int a_font_data_len, bool data_owned)
+new_face(gs_fapi_server * a_server, ff_ft_face * ftf,
+         FT_Incremental_InterfaceRec * a_ft_inc_int)
 {
     ff_server *s = (ff_server *) a_server;
 
     ff_face *face = (ff_face *) FF_alloc(s->ftmemory, sizeof(ff_face));
 
     if (face) {
-        face->ft_face = a_ft_face;
+        memset(face, 0x00, sizeof(ff_face));
+        face->ft_face = ftf->ft_face;
+        face->ftf = ftf;
         face->ft_inc_int = a_ft_inc_int;
-        face->font_data = a_font_data;
-        face->font_data_len = a_font_data_len;
-        face->data_owned = data_owned;
-        face->ftstrm = ftstrm;
         face->server = (ff_server *) a_server;
+        face->has_digest = false;
     }
     return face;
 }
@@ -312,14 +569,9 @@ delete_face(gs_fapi_server * a_server, ff_face * a_face)
             delete_inc_int(a_server, a_face->ft_inc_int);
             a_face->ft_inc_int = NULL;
         }
-        FT_Done_Face(a_face->ft_face);
+        release_ft_face(s, a_face->ftf);
 
         FF_free(s->ftmemory, a_face->ft_inc_int);
-        if (a_face->data_owned)
-            FF_free(s->ftmemory, a_face->font_data);
-        if (a_face->ftstrm) {
-            FF_free(s->ftmemory, a_face->ftstrm);
-        }
         FF_free(s->ftmemory, a_face);
     }
 }
@@ -339,6 +591,7 @@ new_inc_int_info(gs_fapi_server * a_server, gs_fapi_font * a_fapi_font)
         info->glyph_data_in_use = false;
         info->glyph_metrics_index = 0xFFFFFFFF;
         info->metrics_type = gs_fapi_metrics_notdef;
+        info->glyph_data_requests = 0;
     }
     return info;
 }
@@ -365,6 +618,7 @@ get_fapi_glyph_data(FT_Incremental a_info, FT_UInt a_index, FT_Data * a_data)
 
     /* Tell the FAPI interface that we need to decrypt the glyph data. */
     ff->need_decrypt = true;
+    a_info->glyph_data_requests++;
 
     /* If glyph_data is already in use (as will happen for composite glyphs)
      * create a new buffer on the heap.
@@ -543,44 +797,15 @@ ft_to_gs_error(FT_Error a_error)
     return 0;
 }
 
-/* Load a glyph and optionally rasterize it. Return its metrics in a_metrics.
- * If a_bitmap is true convert the glyph to a bitmap.
- */
-static gs_fapi_retcode
-load_glyph(gs_fapi_server * a_server, gs_fapi_font * a_fapi_font,
-           const gs_fapi_char_ref * a_char_ref, gs_fapi_metrics * a_metrics,
-           FT_Glyph * a_glyph, bool a_bitmap, int max_bitmap)
+/* Find the FreeType glyph index for a_char_ref. */
+static int
+glyph_index(ff_face * face, gs_fapi_font * a_fapi_font,
+            const gs_fapi_char_ref * a_char_ref)
 {
-    ff_server *s = (ff_server *) a_server;
-    FT_Error ft_error = 0;
-    FT_Error ft_error_fb = 1;
-    ff_face *face = (ff_face *) a_fapi_font->server_font_data;
     FT_Face ft_face = face->ft_face;
     int index = a_char_ref->char_codes[0];
-    FT_Long w;
-    FT_Long h;
-    FT_Long fflags;
-    FT_Int32 load_flags = 0;
-    FT_Vector  delta = {0,0};
-
-    /* Save a_fapi_font->char_data, which is set to null by FAPI_FF_get_glyph as part of a hack to
-     * make the deprecated Type 2 endchar ('seac') work, so that it can be restored
-     * after the first call to FT_Load_Glyph.
-     */
-    const void *saved_char_data = a_fapi_font->char_data;
-    const int saved_char_data_len = a_fapi_font->char_data_len;
-
-    if (s->bitmap_glyph) {
-        FT_Bitmap_Done(s->freetype_library, &s->bitmap_glyph->bitmap);
-        FF_free(s->ftmemory, s->bitmap_glyph);
-        s->bitmap_glyph = NULL;
-    }
-    if (s->outline_glyph) {
-        FT_Outline_Done(s->freetype_library, &s->outline_glyph->outline);
-        FF_free(s->ftmemory, s->outline_glyph);
-        s->outline_glyph = NULL;
-    }
 
+    face_select_charmap(face);
     if (!a_char_ref->is_glyph_index) {
         if (ft_face->num_charmaps)
             index = FT_Get_Char_Index(ft_face, index);
@@ -619,6 +844,52 @@ load_glyph(gs_fapi_server * a_server, gs_fapi_font * a_fapi_font,
             }
         }
     }
+    return index;
+}
+
+/* Load a glyph and optionally rasterize it. Return its metrics in a_metrics.
+ * If a_bitmap is true convert the glyph to a bitmap.
+ */
+static gs_fapi_retcode
+load_glyph(gs_fapi_server * a_server, gs_fapi_font * a_fapi_font,
+           const gs_fapi_char_ref * a_char_ref, gs_fapi_metrics * a_metrics,
+           FT_Glyph * a_glyph, bool a_bitmap, int max_bitmap)
+{
+    ff_server *s = (ff_server *) a_server;
+    FT_Error ft_error = 0;
+    FT_Error ft_error_fb = 1;
+    ff_face *face = (ff_face *) a_fapi_font->server_font_data;
+    FT_Face ft_face = face->ft_face;
+    int index;
+    FT_Long w;
+    FT_Long h;
+    FT_Long fflags;
+    FT_Int32 load_flags = 0;
+    FT_Vector  delta = {0,0};
+
+    /* Save a_fapi_font->char_data, which is set to null by FAPI_FF_get_glyph as part of a hack to
+     * make the deprecated Type 2 endchar ('seac') work, so that it can be restored
+     * after the first call to FT_Load_Glyph.
+     */
+    const void *saved_char_data = a_fapi_font->char_data;
+    const int saved_char_data_len = a_fapi_font->char_data_len;
+
+    if (s->bitmap_glyph) {
+        FT_Bitmap_Done(s->freetype_library, &s->bitmap_glyph->bitmap);
+        FF_free(s->ftmemory, s->bitmap_glyph);
+        s->bitmap_glyph = NULL;
+    }
+    if (s->outline_glyph) {
+        FT_Outline_Done(s->freetype_library, &s->outline_glyph->outline);
+        FF_free(s->ftmemory, s->outline_glyph);
+        s->outline_glyph = NULL;
+    }
+
+    ft_error = face_select(face);
+    if (ft_error)
+        return ft_to_gs_error(ft_error);
+    index = glyph_index(face, a_fapi_font, a_char_ref);
+
     /* Refresh the pointer to the FAPI_font held by the incremental interface. */
     if (face->ft_inc_int)
         face->ft_inc_int->object->fapi_font = a_fapi_font;
@@ -1170,10 +1441,18 @@ gs_fapi_ft_get_scaled_font(gs_fapi_server * a_server, gs_fapi_font * a_font,
         unsigned char *own_font_data = NULL;
         int own_font_data_len = -1;
         FT_Stream ft_strm = NULL;
+        ff_ft_face *ftf = NULL;
+        byte key[16];
+        bool cacheable = false;
 
         /* dpf("gs_fapi_ft_get_scaled_font creating face\n"); */
 
         if (a_font->full_font_buf) {
+            face_cache_key(a_font, (const byte *)a_font->full_font_buf,
+                           a_font->full_font_buf_len, key);
+            ftf = face_cache_find(s, key);
+            if (ftf != NULL)
+                goto have_face;
 
             own_font_data =
                 gs_malloc(((gs_memory_t *) (s->ftmemory->user)),
@@ -1198,6 +1477,7 @@ gs_fapi_ft_get_scaled_font(gs_fapi_server * a_server, gs_fapi_font * a_font,
                 gs_free(mem, own_font_data, 0, 0, "FF_open_read_stream");
                 return ft_to_gs_error(ft_error);
             }
+            cacheable = true;
         }
         /* Load a typeface from a file. */
         else if (a_font->font_file_path) {
@@ -1212,6 +1492,14 @@ gs_fapi_ft_get_scaled_font(gs_fapi_server * a_server, gs_fapi_font * a_font,
                 return (code);
             }
 
+            face_cache_key(a_font, NULL, ft_strm->size, key);
+            ftf = face_cache_find(s, key);
+            if (ftf != NULL) {
+                FF_stream_close(ft_strm);
+                FF_free(s->ftmemory, ft_strm);
+                ft_strm = NULL;
+                goto have_face;
+            }
             args.flags = FT_OPEN_STREAM;
             args.stream = ft_strm;
 
@@ -1222,6 +1510,7 @@ gs_fapi_ft_get_scaled_font(gs_fapi_server * a_server, gs_fapi_font * a_font,
                 /* in the event of an error, Freetype should cleanup the stream */
                 return ft_to_gs_error(ft_error);
             }
+            cacheable = true;
         }
 
         /* Load a typeface from a representation in GhostScript's memory. */
@@ -1342,17 +1631,40 @@ gs_fapi_ft_get_scaled_font(gs_fapi_server * a_server, gs_fapi_font * a_font,
         }
 
         if (ft_face) {
-            face =
-                new_face(a_server, ft_face, ft_inc_int, ft_strm,
-                         own_font_data, own_font_data_len, data_owned);
-            if (!face) {
+            ftf = new_ft_face(a_server, ft_face, ft_strm, own_font_data,
+                              own_font_data_len, data_owned);
+            if (!ftf) {
                 if (data_owned)
                     FF_free(s->ftmemory, own_font_data);
                 FT_Done_Face(ft_face);
                 delete_inc_int(a_server, ft_inc_int);
                 return_error(gs_error_VMerror);
             }
+            /* Setting the weight vector of a multiple master font changes
+             * the face, so such faces can't be shared. */
+            if (cacheable && !FT_HAS_MULTIPLE_MASTERS(ft_face))
+                face_cache_add(s, ftf, key);
+        }
+
+      have_face:
+        if (ftf) {
+            face = new_face(a_server, ftf, ft_inc_int);
+            if (!face) {
+                release_ft_face(s, ftf);
+                delete_inc_int(a_server, ft_inc_int);
+                return_error(gs_error_VMerror);
+            }
             a_font->server_font_data = face;
+            if (a_font->full_font_buf) {
+                /* The cache key is the digest of the font program. */
+                memcpy(face->digest, key, sizeof(face->digest));
+                face->has_digest = true;
+            }
+
+            /* Start from the character map FreeType chose, as another font
+             * sharing the face may have picked a different one. */
+            if (ftf->charmap != NULL && face->ft_face->charmap != ftf->charmap)
+                (void)FT_Set_Charmap(face->ft_face, ftf->charmap);
 
             if (!a_font->is_type1) {
                 for (i = 0; i < GS_FAPI_NUM_TTF_CMAP_REQ && !cmap; i++) {
@@ -1397,6 +1709,7 @@ gs_fapi_ft_get_scaled_font(gs_fapi_server * a_server, gs_fapi_font * a_font,
                 a_font->ttf_cmap_selected.platform_id = -1;
                 a_font->ttf_cmap_selected.encoding_id = -1;
             }
+            face->charmap = face->ft_face->charmap;
         }
         else
             a_font->server_font_data = NULL;
@@ -1425,8 +1738,7 @@ gs_fapi_ft_get_scaled_font(gs_fapi_server * a_server, gs_fapi_font * a_font,
         transform_decompose(&face->ft_transform, &face->horz_res,
                             &face->vert_res, &face->width, &face->height, face->ft_face->units_per_EM);
 
-        ft_error = FT_Set_Char_Size(face->ft_face, face->width, face->height,
-                                    face->horz_res, face->vert_res);
+        ft_error = face_select(face);
 
         if (ft_error) {
             /* The code originally cleaned up the face data here, but the "top level"
@@ -1560,6 +1872,254 @@ gs_fapi_ft_get_fontmatrix(gs_fapi_server * server, gs_matrix * m)
     return 0;
 }
 
+/*
+ * Glyphs in the glyph cache file are keyed by an MD5 digest of everything
+ * load_glyph uses to render them: the font program, the glyph's own data
+ * when it comes through the incremental interface, the replacement
+ * metrics, the size and transform, and the hinting mode. UIDs aren't good
+ * enough, as they aren't unique across documents.
+ */
+#define GLYPH_FILE_INTS 13          /* metrics, then bitmap geometry */
+
+static void
+md5_append_int(gs_md5_state_t *md5, int64_t v)
+{
+    byte b[8];
+    int i;
+
+    for (i = 0; i < 8; i++)
+        b[i] = (byte)(v >> (i * 8));
+    gs_md5_append(md5, b, 8);
+}
+
+/* Digest the font program the face was made from. */
+static int
+face_digest(ff_face * face, gs_fapi_font * a_font)
+{
+    gs_md5_state_t md5;
+
+    if (face->has_digest)
+        return 0;
+    gs_md5_init(&md5);
+    if (face->ftf->font_data != NULL)
+        gs_md5_append(&md5, face->ftf->font_data, face->ftf->font_data_len);
+    else if (face->ftf->ftstrm != NULL) {
+        FT_Stream strm = face->ftf->ftstrm;
+        byte buf[4096];
+        unsigned long pos, count;
+
+        for (pos = 0; pos < strm->size; pos += count) {
+            count = min(sizeof(buf), strm->size - pos);
+            if (strm->read(strm, pos, buf, count) != count)
+                return_error(gs_error_ioerror);
+            gs_md5_append(&md5, buf, count);
+        }
+    }
+    else
+        return_error(gs_error_undefined);
+    md5_append_int(&md5, a_font->subfont);
+    md5_append_int(&md5, a_font->is_type1);
+    md5_append_int(&md5, a_font->is_cid);
+    gs_md5_finish(&md5, face->digest);
+    face->has_digest = true;
+    return 0;
+}
+
+/* Make the key for a glyph, returning false if it can't be cached. */
+static bool
+glyph_file_key(gs_fapi_server * a_server, gs_fapi_font * a_font,
+               const gs_fapi_char_ref * a_char_ref,
+               byte key[gx_font_cache_file_key_size])
+{
+    ff_face *face = (ff_face *) a_font->server_font_data;
+    FT_Face ft_face = face->ft_face;
+    gs_md5_state_t md5;
+    int index;
+
+    /* The weight vector of a multiple master font isn't in the key. */
+    if (FT_HAS_MULTIPLE_MASTERS(ft_face) || face_digest(face, a_font) < 0)
+        return false;
+    index = glyph_index(face, a_font, a_char_ref);
+
+    gs_md5_init(&md5);
+    gs_md5_append(&md5, face->digest, sizeof(face->digest));
+    md5_append_int(&md5, index);
+    md5_append_int(&md5, a_font->is_mtx_skipped);
+    md5_append_int(&md5, a_font->is_vertical);
+    md5_append_int(&md5, a_font->full_font_buf != NULL ||
+                         a_font->font_file_path != NULL);
+    md5_append_int(&md5, a_char_ref->metrics_type);
+    md5_append_int(&md5, a_char_ref->sb_x);
+    md5_append_int(&md5, a_char_ref->sb_y);
+    md5_append_int(&md5, a_char_ref->aw_x);
+    md5_append_int(&md5, a_char_ref->aw_y);
+    md5_append_int(&md5, a_char_ref->metrics_scale);
+    md5_append_int(&md5, face->ft_transform.xx);
+    md5_append_int(&md5, face->ft_transform.xy);
+    md5_append_int(&md5, face->ft_transform.yx);
+    md5_append_int(&md5, face->ft_transform.yy);
+    md5_append_int(&md5, face->width);
+    md5_append_int(&md5, face->height);
+    md5_append_int(&md5, face->horz_res);
+    md5_append_int(&md5, face->vert_res);
+    md5_append_int(&md5, a_server->grid_fit);
+
+    if (face->ft_inc_int) {
+        FT_IncrementalRec *inc = face->ft_inc_int->object;
+        const void *saved_char_data = a_font->char_data;
+        const int saved_char_data_len = a_font->char_data_len;
+        FT_Data data;
+        FT_Error ft_error;
+
+        inc->fapi_font = a_font;
+        ft_error = get_fapi_glyph_data(inc, index, &data);
+        if (ft_error == 0) {
+            gs_md5_append(&md5, data.pointer, data.length);
+            free_fapi_glyph_data(inc, &data);
+        }
+        a_font->char_data = saved_char_data;
+        a_font->char_data_len = saved_char_data_len;
+        if (ft_error != 0)
+            return false;
+    }
+    gs_md5_finish(&md5, key);
+    return true;
+}
+
+/* Open the glyph cache file when it is first needed, as the file name */
+/* may be set after the interpreter has begun using fonts. */
+static gx_font_cache_file *
+open_glyph_file(ff_server * s)
+{
+    const char *fname = gs_lib_ctx_get_glyph_cache_file(s->mem);
+    FT_UInt tt_ins_version;
+    char version[128];
+
+    if (s->glyph_file_opened || fname == NULL)
+        return s->glyph_file;
+    s->glyph_file_opened = true;
+    if (FT_Property_Get(s->freetype_library, "truetype",
+                        "interpreter-version", &tt_ins_version))
+        return NULL;
+    /* Anything that changes the rendering must change this string. */
+    gs_snprintf(version, sizeof(version),
+                "FreeType %d.%d.%d Ghostscript %ld TT interpreter %d",
+                FREETYPE_MAJOR, FREETYPE_MINOR, FREETYPE_PATCH,
+                gs_revision, (int)tt_ins_version);
+    (void)gx_font_cache_file_open(s->mem, fname, version,
+                                  GX_FONT_CACHE_FILE_MAX_SIZE,
+                                  &s->glyph_file);
+    return s->glyph_file;
+}
+
+/* Make a bitmap glyph from a glyph cache file record. */
+static bool
+glyph_file_read(ff_server * s, const byte *data, uint size,
+                gs_fapi_metrics * a_metrics, int max_bitmap)
+{
+    int v[GLYPH_FILE_INTS];
+    FT_Glyph glyph;
+    FT_BitmapGlyph bmg;
+    uint i, bitmap_size, pitch;
+
+    if (size < sizeof(v) / sizeof(v[0]) * 4)
+        return false;
+    for (i = 0; i < GLYPH_FILE_INTS; i++, data += 4)
+        v[i] = (int)(data[0] | (data[1] << 8) | (data[2] << 16) |
+                     ((uint)data[3] << 24));
+    /* The file is shared and writable, and the checksum only catches
+       damage, so check that the bitmap is consistent before trusting it. */
+    if (v[8] < 0 || v[9] < 0 || v[10] == min_int)
+        return false;
+    pitch = (v[10] < 0 ? -v[10] : v[10]);
+    if (pitch < ((uint)v[8] + 7) / 8 ||
+        (int64_t)pitch * v[9] != (int64_t)(size - GLYPH_FILE_INTS * 4) ||
+        (int64_t)bitmap_raster((int64_t)v[8]) * v[9] >= max_bitmap)
+        return false;
+    bitmap_size = pitch * v[9];
+    if (FT_New_Glyph(s->freetype_library, FT_GLYPH_FORMAT_BITMAP, &glyph))
+        return false;
+    bmg = (FT_BitmapGlyph) glyph;
+    if (bitmap_size > 0) {
+        bmg->bitmap.buffer = FF_alloc(s->ftmemory, bitmap_size);
+        if (bmg->bitmap.buffer == NULL) {
+            FT_Done_Glyph(glyph);
+            return false;
+        }
+        memcpy(bmg->bitmap.buffer, data, bitmap_size);
+    }
+    bmg->bitmap.width = v[8];
+    bmg->bitmap.rows = v[9];
+    bmg->bitmap.pitch = v[10];
+    bmg->bitmap.pixel_mode = FT_PIXEL_MODE_MONO;
+    bmg->bitmap.num_grays = 2;
+    bmg->left = v[11];
+    bmg->top = v[12];
+
+    if (s->bitmap_glyph) {
+        FT_Bitmap_Done(s->freetype_library, &s->bitmap_glyph->bitmap);
+        FF_free(s->ftmemory, s->bitmap_glyph);
+    }
+    if (s->outline_glyph) {
+        FT_Outline_Done(s->freetype_library, &s->outline_glyph->outline);
+        FF_free(s->ftmemory, s->outline_glyph);
+        s->outline_glyph = NULL;
+    }
+    s->bitmap_glyph = bmg;
+    a_metrics->bbox_x0 = v[0];
+    a_metrics->bbox_y0 = v[1];
+    a_metrics->bbox_x1 = v[2];
+    a_metrics->bbox_y1 = v[3];
+    a_metrics->escapement = v[4];
+    a_metrics->v_escapement = v[5];
+    a_metrics->em_x = v[6];
+    a_metrics->em_y = v[7];
+    return true;
+}
+
+/* Add the glyph just rendered to the glyph cache file. */
+static void
+glyph_file_write(ff_server * s, const byte *key,
+                 const gs_fapi_metrics * a_metrics)
+{
+    FT_Bitmap *bitmap = &s->bitmap_glyph->bitmap;
+    int pitch = (bitmap->pitch < 0 ? -bitmap->pitch : bitmap->pitch);
+    uint bitmap_size = bitmap->rows * pitch;
+    uint size = GLYPH_FILE_INTS * 4 + bitmap_size;
+    int v[GLYPH_FILE_INTS];
+    byte *data, *p;
+    int i;
+
+    if (bitmap->pixel_mode != FT_PIXEL_MODE_MONO)
+        return;
+    v[0] = a_metrics->bbox_x0;
+    v[1] = a_metrics->bbox_y0;
+    v[2] = a_metrics->bbox_x1;
+    v[3] = a_metrics->bbox_y1;
+    v[4] = a_metrics->escapement;
+    v[5] = a_metrics->v_escapement;
+    v[6] = a_metrics->em_x;
+    v[7] = a_metrics->em_y;
+    v[8] = bitmap->width;
+    v[9] = bitmap->rows;
+    v[10] = bitmap->pitch;
+    v[11] = s->bitmap_glyph->left;
+    v[12] = s->bitmap_glyph->top;
+    data = gs_alloc_bytes(s->mem, size, "glyph_file_write");
+    if (data == NULL)
+        return;
+    for (i = 0, p = data; i < GLYPH_FILE_INTS; i++, p += 4) {
+        p[0] = (byte)v[i];
+        p[1] = (byte)(v[i] >> 8);
+        p[2] = (byte)(v[i] >> 16);
+        p[3] = (byte)(v[i] >> 24);
+    }
+    if (bitmap_size > 0)
+        memcpy(p, bitmap->buffer, bitmap_size);
+    (void)gx_font_cache_file_add(s->glyph_file, key, data, size);
+    gs_free_object(s->mem, data, "glyph_file_write");
+}
+
 /*
  * Rasterize the character a_char and return its metrics. Do not return the
  * bitmap but store this. It can be retrieved by a subsequent call to
@@ -1571,10 +2131,36 @@ gs_fapi_ft_get_char_raster_metrics(gs_fapi_server * a_server, gs_fapi_font * a_f
                         gs_fapi_metrics * a_metrics)
 {
     ff_server *s = (ff_server *) a_server;
-    gs_fapi_retcode error =
-        load_glyph(a_server, a_font, a_char_ref, a_metrics,
-                   (FT_Glyph *) & s->bitmap_glyph, true,
-                   a_server->max_bitmap);
+    ff_face *face = (ff_face *) a_font->server_font_data;
+    byte key[gx_font_cache_file_key_size];
+    bool use_file = false;
+    gs_fapi_retcode error;
+
+    if (!a_font->metrics_only && open_glyph_file(s) != NULL) {
+        use_file = glyph_file_key(a_server, a_font, a_char_ref, key);
+        if (use_file) {
+            uint size;
+            const byte *data = gx_font_cache_file_lookup(s->glyph_file, key,
+                                                         &size);
+
+            if (data != NULL &&
+                glyph_file_read(s, data, size, a_metrics,
+                                a_server->max_bitmap))
+                return 0;
+        }
+        if (face->ft_inc_int)
+            face->ft_inc_int->object->glyph_data_requests = 0;
+    }
+    error = load_glyph(a_server, a_font, a_char_ref, a_metrics,
+                       (FT_Glyph *) & s->bitmap_glyph, true,
+                       a_server->max_bitmap);
+    /* Glyphs built from other glyphs (seac, composites) depend on more */
+    /* data than the key covers. */
+    if (use_file && error == 0 && s->bitmap_glyph != NULL &&
+        s->bitmap_glyph->root.format == FT_GLYPH_FORMAT_BITMAP &&
+        (face->ft_inc_int == NULL ||
+         face->ft_inc_int->object->glyph_data_requests <= 1))
+        glyph_file_write(s, key, a_metrics);
     return error;
 }
 
@@ -1824,6 +2410,7 @@ gs_fapi_ft_check_cmap_for_GID(gs_fapi_server * server, uint * index)
     ff_face *face = (ff_face *) (server->ff.server_font_data);
     FT_Face ft_face = face->ft_face;
 
+    face_select_charmap(face);
     *index = FT_Get_Char_Index(ft_face, *index);
     return 0;
 }
@@ -1928,6 +2515,13 @@ gs_fapi_ft_init(gs_memory_t * mem, gs_fapi_server ** server)
     memset(serv, 0, sizeof(*serv));
     serv->mem = cmem;
     serv->fapi_server = freetypeserver;
+    serv->face_cache_lock = gx_monitor_label(gx_monitor_alloc(cmem),
+                                             "fapi_ft face cache");
+    if (serv->face_cache_lock == NULL) {
+        gs_free_object(cmem, serv, "gs_fapi_ft_init");
+        gs_memory_chunk_release(cmem);
+        return_error(gs_error_VMerror);
+    }
 
     serv->ftmemory = (FT_Memory) (&(serv->ftmemory_rec));
 
@@ -1941,9 +2535,19 @@ gs_fapi_freetype_destroy(gs_fapi_server ** serv)
 {
     ff_server *server = (ff_server *) * serv;
     gs_memory_t *cmem = server->mem;
+    ff_ft_face *ftf, *next;
 
     FT_Done_Glyph(&server->outline_glyph->root);
     FT_Done_Glyph(&server->bitmap_glyph->root);
+    gx_font_cache_file_close(server->glyph_file);
+
+    /* Faces still in use go with the library. */
+    for (ftf = server->face_cache; ftf != NULL; ftf = next) {
+        next = ftf->next;
+        if (ftf->refs == 0)
+            delete_ft_face(server, ftf);
+    }
+    gx_monitor_free(server->face_cache_lock);
 
     /* As with initialization: since we're supplying memory management to
      * FT, we cannot just to use FT_Done_FreeType (), we have to use
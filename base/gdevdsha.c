@@ -34,6 +34,31 @@ gx_devn_diff(frac31 devn1[], frac31 devn2[], int num)
     return false;
 }
 
+/*
+ * Split each color gradient into a whole part and a non-negative remainder
+ * so that advancing a reduced fraction by one pixel needs no division.
+ * Returns false when the remainders could overflow, in which case the
+ * callers keep dividing.
+ */
+static bool
+gx_linear_color_step_init(int32_t *cg_q, int32_t *cg_r, const int32_t *cg_num,
+                          int32_t cg_den, int n)
+{
+    int k;
+
+    if (cg_den <= 0 || cg_den >= (1 << 30))
+        return false;
+    for (k = 0; k < n; k++) {
+        cg_q[k] = cg_num[k] / cg_den;
+        cg_r[k] = cg_num[k] - cg_q[k] * cg_den;
+        if (cg_r[k] < 0) {
+            cg_q[k]--;
+            cg_r[k] += cg_den;
+        }
+    }
+    return true;
+}
+
 int
 gx_hl_fill_linear_color_scanline(gx_device *dev, const gs_fill_attributes *fa,
         int i0, int j, int w, const frac31 *c0, const int32_t *c0f,
@@ -42,6 +67,8 @@ gx_hl_fill_linear_color_scanline(gx_device *dev, const gs_fill_attributes *fa,
     frac31 c[GX_DEVICE_COLOR_MAX_COMPONENTS];
     frac31 curr[GX_DEVICE_COLOR_MAX_COMPONENTS];
     ulong f[GX_DEVICE_COLOR_MAX_COMPONENTS];
+    int32_t cg_q[GX_DEVICE_COLOR_MAX_COMPONENTS], cg_r[GX_DEVICE_COLOR_MAX_COMPONENTS];
+    bool step_exact;
     int i, i1 = i0 + w, bi = i0, k;
     const gx_device_color_info *cinfo = &dev->color_info;
     int n = cinfo->num_components;
@@ -60,11 +87,24 @@ gx_hl_fill_linear_color_scanline(gx_device *dev, const gs_fill_attributes *fa,
         curr[k] = c[k] = c0[k];
         f[k] = c0f[k];
     }
+    step_exact = gx_linear_color_step_init(cg_q, cg_r, cg_num, cg_den, n);
     for (i = i0 + 1, di = 1; i < i1; i += di) {
         if (di == 1) {
+            bool reduced = step_exact && i > i0 + 1;
+
             /* Advance colors by 1 pixel. */
             for (k = 0; k < n; k++) {
-                if (cg_num[k]) {
+                if (cg_num[k] && reduced) {
+                    /* f[k] is within [0, cg_den) after the first step. */
+                    int32_t m = (int32_t)f[k] + cg_r[k];
+
+                    c[k] += cg_q[k];
+                    if (m >= cg_den) {
+                        c[k]++;
+                        m -= cg_den;
+                    }
+                    f[k] = m;
+                } else if (cg_num[k]) {
                     int32_t m = f[k] + cg_num[k];
 
                     c[k] += m / cg_den;
@@ -204,6 +244,8 @@ gx_default_fill_linear_color_scanline(gx_device *dev, const gs_fill_attributes *
     bool devn = dev_proc(dev, dev_spec_op)(dev, gxdso_supports_devn, NULL, 0);
     frac31 c[GX_DEVICE_COLOR_MAX_COMPONENTS];
     ulong f[GX_DEVICE_COLOR_MAX_COMPONENTS];
+    int32_t cg_q[GX_DEVICE_COLOR_MAX_COMPONENTS], cg_r[GX_DEVICE_COLOR_MAX_COMPONENTS];
+    bool step_exact;
     int i, i1 = i0 + w, bi = i0, k;
     gx_color_index ci0 = 0, ci1;
     const gx_device_color_info *cinfo = &dev->color_info;
@@ -230,15 +272,28 @@ gx_default_fill_linear_color_scanline(gx_device *dev, const gs_fill_attributes *
         f[k] = c0f[k];
         ci0 |= (gx_color_index)(c[k] >> (sizeof(c[k]) * 8 - 1 - bits)) << shift;
     }
+    step_exact = gx_linear_color_step_init(cg_q, cg_r, cg_num, cg_den, n);
     for (i = i0 + 1, di = 1; i < i1; i += di) {
         if (di == 1) {
+            bool reduced = step_exact && i > i0 + 1;
+
             /* Advance colors by 1 pixel. */
             ci1 = 0;
             for (k = 0; k < n; k++) {
                 int shift = cinfo->comp_shift[k];
                 int bits = cinfo->comp_bits[k];
 
-                if (cg_num[k]) {
+                if (cg_num[k] && reduced) {
+                    /* f[k] is within [0, cg_den) after the first step. */
+                    int32_t m = (int32_t)f[k] + cg_r[k];
+
+                    c[k] += cg_q[k];
+                    if (m >= cg_den) {
+                        c[k]++;
+                        m -= cg_den;
+                    }
+                    f[k] = m;
+                } else if (cg_num[k]) {
                     int32_t m = f[k] + cg_num[k];
 
                     c[k] += m / cg_den;
@@ -244,10 +244,12 @@ gdev_prn_tear_down(gx_device *pdev, byte **the_memory)
         pcldev->icc_table = NULL;
 
         /* If the clist is a reader clist, free any color_usage_array
-         * memory used by same.
+         * and band index memory used by same.
          */
-        if (!CLIST_IS_WRITER(pclist_dev))
+        if (!CLIST_IS_WRITER(pclist_dev)) {
             gs_free_object(pcrdev->memory, pcrdev->color_usage_array, "clist_color_usage_array");
+            clist_free_band_index(pcrdev->band_index);
+        }
 
     } else {
         /* point at the device bitmap, no need to close mem dev */
@@ -174,6 +174,7 @@ typedef struct {
     FILE        *(*get_file)(gp_file *file);
     void         (*clearerr)(gp_file *file);
     gp_file     *(*reopen)(gp_file *f, const char *fname, const char *mode);
+    int          (*prefetch)(gp_file *file, gs_offset_t offset, gs_offset_t len);
 } gp_file_ops_t;
 
 struct gp_file_s {
@@ -284,6 +285,15 @@ gp_fpwrite(void *buf, size_t count, gs_offset_t offset, gp_file *f) {
     return (f->ops.pwrite)(f, count, offset, buf);
 }
 
+/* Advise that a range of the file will be read soon, so the system can  */
+/* start reading it in. This is only a hint: it may do nothing at all.  */
+static inline int
+gp_fprefetch(gp_file *f, gs_offset_t offset, gs_offset_t len) {
+    if (f == NULL || f->ops.prefetch == NULL)
+        return 0;
+    return (f->ops.prefetch)(f, offset, len);
+}
+
 static inline int
 gp_file_is_char_buffered(gp_file *f) {
     if (f->ops.is_char_buffered == NULL)
@@ -639,6 +649,8 @@ int gp_pread_impl(char *buf, size_t count, gs_offset_t offset, FILE *f);
 
 int gp_pwrite_impl(const char *buf, size_t count, gs_offset_t offset, FILE *f);
 
+int gp_prefetch_impl(FILE *f, gs_offset_t offset, gs_offset_t len);
+
 gs_offset_t gp_ftell_impl(FILE *f);
 
 int gp_fseek_impl(FILE *strm, gs_offset_t offset, int origin);
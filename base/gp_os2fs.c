@@ -305,6 +305,11 @@ int gp_pwrite_impl(char *buf, size_t count, gs_offset_t offset, FILE *f)
     return -1;
 }
 
+int gp_prefetch_impl(FILE *f, gs_offset_t offset, gs_offset_t len)
+{
+    return 0;
+}
+
 /* -------------- Helpers for gp_file_name_combine_generic ------------- */
 
 uint gp_file_name_root(const char *fname, uint len)
@@ -31,6 +31,7 @@
 #include "stat_.h"
 #include "dirent_.h"
 #include "unistd_.h"
+#include "fcntl_.h"
 #include <stdlib.h>             /* for mkstemp/mktemp */
 
 #if !defined(HAVE_FSEEKO)
@@ -245,6 +246,15 @@ int gp_pwrite_impl(const char *buf, size_t count, gs_offset_t offset, FILE *f)
 #endif
 }
 
+int gp_prefetch_impl(FILE *f, gs_offset_t offset, gs_offset_t len)
+{
+#if !defined(GS_NO_FILESYSTEM) && defined(POSIX_FADV_WILLNEED)
+    /* Only advisory, so any failure can be ignored. */
+    (void)posix_fadvise(fileno(f), offset, len, POSIX_FADV_WILLNEED);
+#endif
+    return 0;
+}
+
 /* Set a file into binary or text mode. */
 int
 gp_setmode_binary_impl(FILE * pfile, bool mode) /* lgtm [cpp/useless-expression] */
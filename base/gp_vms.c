@@ -311,6 +311,11 @@ int gp_pwrite_impl(const char *buf, size_t count, gs_offset_t offset, FILE *f)
     return -1;
 }
 
+int gp_prefetch_impl(FILE *f, gs_offset_t offset, gs_offset_t len)
+{
+    return 0;
+}
+
 /* Set a file into binary or text mode. */
 int
 gp_setmode_binary_impl(FILE * pfile, bool binary)
@@ -153,6 +153,12 @@ int gp_pwrite_impl(const char *buf, size_t count, gs_offset_t offset, FILE *f)
     return ret;
 }
 
+/* There is no read-ahead hint for a file handle, so this is a no-op */
+int gp_prefetch_impl(FILE *f, gs_offset_t offset, gs_offset_t len)
+{
+    return 0;
+}
+
 /* --------- 64 bit file access ----------- */
 /* MSVC versions before 8 doen't provide big files.
    MSVC 8 doesn't distinguish big and small files,
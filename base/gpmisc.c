@@ -593,6 +593,14 @@ gp_file_FILE_pwrite(gp_file *file_, size_t count, gs_offset_t offset, const void
     return gp_pwrite_impl(buf, count, offset, file->file);
 }
 
+static int
+gp_file_FILE_prefetch(gp_file *file_, gs_offset_t offset, gs_offset_t len)
+{
+    gp_file_FILE *file = (gp_file_FILE *)file_;
+
+    return gp_prefetch_impl(file->file, offset, len);
+}
+
 static int
 gp_file_FILE_is_char_buffered(gp_file *file_)
 {
@@ -668,7 +676,8 @@ static const gp_file_ops_t gp_file_FILE_prototype =
     gp_file_FILE_ferror,
     gp_file_FILE_get_file,
     gp_file_FILE_clearerr,
-    gp_file_FILE_reopen
+    gp_file_FILE_reopen,
+    gp_file_FILE_prefetch
 };
 
 gp_file *gp_file_FILE_alloc(const gs_memory_t *mem)
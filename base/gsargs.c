@@ -366,9 +366,9 @@ arg_next(arg_list * pal, const char **argstr, const gs_memory_t *errmem)
                     else if (in_quote) {
                         /* Need to check the next char to see if we're closing at the end */
                         c = get_codepoint(pal, pas);
-                        if (c > 0 && c < 256 && isspace(c)) {
-                            /* Reading from an @file, we've hit a space char. That's good, this
-                             * was a close quote. */
+                        if (c == EOF || (c > 0 && c < 256 && isspace(c))) {
+                            /* Reading from an @file, we've hit a space char or the end of
+                             * the input. That's good, this was a close quote. */
                             cstr[i] = 0;
                             break;
                         }
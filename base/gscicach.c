@@ -54,6 +54,7 @@ struct gs_color_index_cache_s {
     float *paint_values;
     frac31 *frac_values;
     int chains[COLOR_INDEX_CACHE_CHAINS];
+    gx_monitor_t *lock; /* Serializes remap_color, or NULL. */
     /* Note : the 0th element of buf, paint_values, frac_values is never used,
        because we consider the index 0 as NULL
        just for a faster initialization. */
@@ -102,6 +103,12 @@ gs_color_index_cache_create(gs_memory_t *memory, const gs_color_space *direct_sp
     return pcic;
 }
 
+void
+gs_color_index_cache_set_lock(gs_color_index_cache_t *pcic, gx_monitor_t *lock)
+{
+    pcic->lock = lock;
+}
+
 void
 gs_color_index_cache_destroy(gs_color_index_cache_t *pcic)
 {
@@ -308,8 +315,12 @@ gs_cached_color_index(gs_color_index_cache_t *self, const float *paint_values,
                sizeof(*paint_values) * client_num_components);
         memcpy(fcc.paint.values, paint_values,
                sizeof(*paint_values) * client_num_components);
+        if (self->lock != NULL)
+            gx_monitor_enter(self->lock);
         code = pcs->type->remap_color(&fcc, pcs, pdevc, self->pgs,
                                       self->trans_dev, gs_color_select_texture);
+        if (self->lock != NULL)
+            gx_monitor_leave(self->lock);
         if (code < 0)
             return code;
         if (pdevc->type == &gx_dc_type_data_pure) {
@@ -20,6 +20,7 @@
 #  define gscicach_INCLUDED
 
 #include "gxdevcli.h" /* For frac31. */
+#include "gxsync.h"
 
 typedef struct gs_color_index_cache_s gs_color_index_cache_t;
 
@@ -27,6 +28,10 @@ gs_color_index_cache_t *gs_color_index_cache_create(gs_memory_t *memory,
                 const gs_color_space *direct_space, gx_device *dev, gs_gstate *pgs, bool need_frac, gx_device *trans_dev);
 void gs_color_index_cache_destroy(gs_color_index_cache_t *this);
 
+/* Convert colors that miss the cache under a lock, for caches of several
+   threads that share the color space and the graphics state. */
+void gs_color_index_cache_set_lock(gs_color_index_cache_t *this, gx_monitor_t *lock);
+
 int gs_cached_color_index(gs_color_index_cache_t *this, const float *paint_values, gx_device_color *pdevc, frac31 *frac_values);
 
 #endif /* gscicach_INCLUDED */
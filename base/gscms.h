@@ -451,7 +451,9 @@ struct gsicc_link_s {
     gsicc_hashlink_t hashcode;
     struct gsicc_link_cache_s *icc_link_cache;
     int ref_count;
-    gsicc_link_t *next;
+    gsicc_link_t *next;		/* next link in the same hash bucket */
+    gsicc_link_t *lru_prev;	/* neighbours on the list of unused links */
+    gsicc_link_t *lru_next;
     gx_monitor_t *lock;		/* lock used while changing contents */
     bool includes_softproof;
     bool includes_devlink;
@@ -462,21 +464,47 @@ struct gsicc_link_s {
     gsicc_colorbuffer_t data_cs; /* needed for begin_monitor after end_monitor */
     int num_input;  /* Need so we can monitor properly */
     int num_output; /* Need so we can monitor properly */
+    struct gsicc_lut_s *lut;	/* table baked for buffer transforms, or NULL */
 };
 
 /* ICC Cache. The size of the cache is limited by max_memory_size.
  * Links are added if there is sufficient memory and if the number
- * of links does not exceed a (soft) limit.
+ * of links does not exceed a (soft) limit (see ICCLinkCacheSize).
+ *
+ * The links are hashed into a number of shards, each with its own
+ * lock, so that rendering threads looking up different links don't
+ * contend with each other. Each shard keeps its unused (zero ref_count)
+ * links on a list, least recently used first, from which links are
+ * evicted when the cache is full.
  */
 
+#define ICC_LINK_CACHE_SHARDS 8
+#define ICC_LINK_SHARD_BUCKETS 16
+
+typedef struct gsicc_link_shard_s {
+    gx_monitor_t *lock;		/* protects the buckets, the lru list and link ref_counts */
+    gsicc_link_t *buckets[ICC_LINK_SHARD_BUCKETS];
+    gsicc_link_t *lru_head;	/* least recently used unused link */
+    gsicc_link_t *lru_tail;	/* most recently used unused link */
+    ulong hits;
+    ulong misses;
+} gsicc_link_shard_t;
+
+/* Color converted image rows, see gsicc_rowcache.c */
+typedef struct gsicc_rowcache_s gsicc_rowcache_t;
+
 typedef struct gsicc_link_cache_s {
-    gsicc_link_t *head;
+    gsicc_link_shard_t shards[ICC_LINK_CACHE_SHARDS];
     int num_links;
     rc_header rc;
     gs_memory_t *memory;
-    gx_monitor_t *lock;		/* handle for the monitor */
+    gx_monitor_t *lock;		/* protects num_links, cache_full and the counts below */
     bool cache_full;		/* flag that some thread needs a cache slot */
     gx_semaphore_t *full_wait;	/* semaphore for waiting when the cache is full */
+    ulong num_released;		/* count of links becoming unused */
+    ulong waits;		/* times a thread waited for a slot */
+    ulong evictions;		/* unused links removed to make room */
+    gsicc_rowcache_t *row_cache;	/* converted image rows, or NULL */
 } gsicc_link_cache_t;
 
 /* A linked list structure to keep DeviceN ICC profiles
@@ -134,6 +134,13 @@ int gx_default_get_param(gx_device *dev, char *Param, void *list)
     gsicc_blackptcomp_t blackptcomps[NUM_DEVICE_PROFILES];
     gsicc_blackpreserve_t blackpreserve[NUM_DEVICE_PROFILES];
     int color_accuracy = MAX_COLOR_ACCURACY;
+    int link_cache_size = gsicc_currentlinkcachesize(dev->memory);
+    bool fast_lut = gsicc_currentfastlut(dev->memory);
+    bool sample_calc = gs_lib_ctx_get_sample_calc_functions(dev->memory);
+    int shading_threads = gs_lib_ctx_get_shading_threads(dev->memory);
+    bool fast_bl_compression = gs_lib_ctx_get_fast_band_list_compression(dev->memory);
+    int64_t bl_compression_threshold = gs_lib_ctx_get_band_list_compression_threshold(dev->memory);
+    int row_cache_size = gs_lib_ctx_get_image_row_cache_size(dev->memory);
     int depth = dev->color_info.depth;
     cmm_dev_profile_t *dev_profile;
     char null_str[1]={'\0'};
@@ -501,6 +508,27 @@ int gx_default_get_param(gx_device *dev, char *Param, void *list)
     if (strcmp(Param, "ColorAccuracy") == 0) {
         return param_write_int(plist, "ColorAccuracy", (const int *)(&(color_accuracy)));
     }
+    if (strcmp(Param, "ICCLinkCacheSize") == 0) {
+        return param_write_int(plist, "ICCLinkCacheSize", &link_cache_size);
+    }
+    if (strcmp(Param, "ICCFastLUT") == 0) {
+        return param_write_bool(plist, "ICCFastLUT", &fast_lut);
+    }
+    if (strcmp(Param, "SampleCalcFunctions") == 0) {
+        return param_write_bool(plist, "SampleCalcFunctions", &sample_calc);
+    }
+    if (strcmp(Param, "NumShadingThreads") == 0) {
+        return param_write_int(plist, "NumShadingThreads", &shading_threads);
+    }
+    if (strcmp(Param, "FastBandListCompression") == 0) {
+        return param_write_bool(plist, "FastBandListCompression", &fast_bl_compression);
+    }
+    if (strcmp(Param, "BandListCompressionThreshold") == 0) {
+        return param_write_i64(plist, "BandListCompressionThreshold", &bl_compression_threshold);
+    }
+    if (strcmp(Param, "ImageRowCacheSize") == 0) {
+        return param_write_int(plist, "ImageRowCacheSize", &row_cache_size);
+    }
     if (strcmp(Param, "RenderIntent") == 0) {
         return param_write_int(plist,"RenderIntent", (const int *) (&(profile_intents[0])));
     }
@@ -611,6 +639,13 @@ gx_default_get_params(gx_device * dev, gs_param_list * plist)
     bool prebandthreshold = true, temp_bool;
     int k;
     int color_accuracy = MAX_COLOR_ACCURACY;
+    int link_cache_size = gsicc_currentlinkcachesize(dev->memory);
+    bool fast_lut = gsicc_currentfastlut(dev->memory);
+    bool sample_calc = gs_lib_ctx_get_sample_calc_functions(dev->memory);
+    int shading_threads = gs_lib_ctx_get_shading_threads(dev->memory);
+    bool fast_bl_compression = gs_lib_ctx_get_fast_band_list_compression(dev->memory);
+    int64_t bl_compression_threshold = gs_lib_ctx_get_band_list_compression_threshold(dev->memory);
+    int row_cache_size = gs_lib_ctx_get_image_row_cache_size(dev->memory);
     gs_param_float_array msa, ibba, hwra, ma;
     gs_param_string_array scna;
     char null_str[1]={'\0'};
@@ -802,6 +837,13 @@ gx_default_get_params(gx_device * dev, gs_param_list * plist)
         (code = param_write_string(plist,"ICCOutputColors", &(icc_colorants))) < 0 ||
         (code = param_write_int(plist, "RenderIntent", (const int *)(&(profile_intents[0])))) < 0 ||
         (code = param_write_int(plist, "ColorAccuracy", (const int *)(&(color_accuracy)))) < 0 ||
+        (code = param_write_int(plist, "ICCLinkCacheSize", &link_cache_size)) < 0 ||
+        (code = param_write_bool(plist, "ICCFastLUT", &fast_lut)) < 0 ||
+        (code = param_write_bool(plist, "SampleCalcFunctions", &sample_calc)) < 0 ||
+        (code = param_write_int(plist, "NumShadingThreads", &shading_threads)) < 0 ||
+        (code = param_write_bool(plist, "FastBandListCompression", &fast_bl_compression)) < 0 ||
+        (code = param_write_i64(plist, "BandListCompressionThreshold", &bl_compression_threshold)) < 0 ||
+        (code = param_write_int(plist, "ImageRowCacheSize", &row_cache_size)) < 0 ||
         (code = param_write_int(plist,"VectorIntent", (const int *) &(profile_intents[1]))) < 0 ||
         (code = param_write_int(plist,"ImageIntent", (const int *) &(profile_intents[2]))) < 0 ||
         (code = param_write_int(plist,"TextIntent", (const int *) &(profile_intents[3]))) < 0 ||
@@ -1679,6 +1721,13 @@ gx_default_put_params(gx_device * dev, gs_param_list * plist)
     int leadingedge = dev->LeadingEdge;
     int k;
     int color_accuracy;
+    int link_cache_size;
+    bool fast_lut;
+    bool sample_calc;
+    int shading_threads;
+    bool fast_bl_compression;
+    int64_t bl_compression_threshold;
+    int row_cache_size;
     bool devicegraytok = true;
     bool graydetection = false;
     bool usefastcolor = false;
@@ -1696,6 +1745,13 @@ gx_default_put_params(gx_device * dev, gs_param_list * plist)
                                                gsTEXTPROFILE};
 
     color_accuracy = gsicc_currentcoloraccuracy(dev->memory);
+    link_cache_size = gsicc_currentlinkcachesize(dev->memory);
+    fast_lut = gsicc_currentfastlut(dev->memory);
+    sample_calc = gs_lib_ctx_get_sample_calc_functions(dev->memory);
+    shading_threads = gs_lib_ctx_get_shading_threads(dev->memory);
+    fast_bl_compression = gs_lib_ctx_get_fast_band_list_compression(dev->memory);
+    bl_compression_threshold = gs_lib_ctx_get_band_list_compression_threshold(dev->memory);
+    row_cache_size = gs_lib_ctx_get_image_row_cache_size(dev->memory);
     if (dev->icc_struct != NULL) {
         for (k = 0; k < NUM_DEVICE_PROFILES; k++) {
             rend_intent[k] = dev->icc_struct->rendercond[k].rendering_intent;
@@ -2004,6 +2060,51 @@ nce:
         ecode = code;
         param_signal_error(plist, param_name, ecode);
     }
+    if ((code = param_read_int(plist, (param_name = "ICCLinkCacheSize"),
+                                                        &link_cache_size)) < 0) {
+        ecode = code;
+        param_signal_error(plist, param_name, ecode);
+    } else if (link_cache_size < 0) {
+        ecode = gs_note_error(gs_error_rangecheck);
+        param_signal_error(plist, param_name, ecode);
+    }
+    if ((code = param_read_bool(plist, (param_name = "ICCFastLUT"),
+                                                        &fast_lut)) < 0) {
+        ecode = code;
+        param_signal_error(plist, param_name, ecode);
+    }
+    if ((code = param_read_bool(plist, (param_name = "SampleCalcFunctions"),
+                                                        &sample_calc)) < 0) {
+        ecode = code;
+        param_signal_error(plist, param_name, ecode);
+    }
+    if ((code = param_read_int(plist, (param_name = "NumShadingThreads"),
+                                                        &shading_threads)) < 0) {
+        ecode = code;
+        param_signal_error(plist, param_name, ecode);
+    }
+    if ((code = param_read_bool(plist, (param_name = "FastBandListCompression"),
+                                                        &fast_bl_compression)) < 0) {
+        ecode = code;
+        param_signal_error(plist, param_name, ecode);
+    }
+    if ((code = param_read_i64(plist, (param_name = "BandListCompressionThreshold"),
+                                                        &bl_compression_threshold)) < 0) {
+        ecode = code;
+        param_signal_error(plist, param_name, ecode);
+    }
+    if (bl_compression_threshold < 0) {
+        ecode = gs_error_rangecheck;
+        param_signal_error(plist, "BandListCompressionThreshold", ecode);
+    }
+    if ((code = param_read_int(plist, (param_name = "ImageRowCacheSize"),
+                                                        &row_cache_size)) < 0) {
+        ecode = code;
+        param_signal_error(plist, param_name, ecode);
+    } else if (row_cache_size < 0) {
+        ecode = gs_note_error(gs_error_rangecheck);
+        param_signal_error(plist, param_name, ecode);
+    }
     if ((code = param_read_bool(plist, (param_name = "DeviceGrayToK"),
                                                         &devicegraytok)) < 0) {
         ecode = code;
@@ -2475,6 +2576,13 @@ label:\
         }
     }
     gsicc_setcoloraccuracy(dev->memory, color_accuracy);
+    gsicc_setlinkcachesize(dev->memory, link_cache_size);
+    gsicc_setfastlut(dev->memory, fast_lut);
+    gs_lib_ctx_set_sample_calc_functions(dev->memory, sample_calc);
+    gs_lib_ctx_set_shading_threads(dev->memory, shading_threads);
+    gs_lib_ctx_set_fast_band_list_compression(dev->memory, fast_bl_compression);
+    gs_lib_ctx_set_band_list_compression_threshold(dev->memory, bl_compression_threshold);
+    gs_lib_ctx_set_image_row_cache_size(dev->memory, row_cache_size);
     code = gx_default_put_graytok(devicegraytok, dev);
     if (code < 0)
         return code;
@@ -277,6 +277,7 @@ gs_font_dir_alloc2_limits(gs_memory_t * struct_mem, gs_memory_t * bits_mem,
     pdir->tti = 0;
     pdir->ttm = 0;
     pdir->san = 0;
+    pdir->tt_outlines = NULL;
     pdir->global_glyph_code = NULL;
     pdir->text_enum_id = 0;
     pdir->hash = 42;  /* initialize the hash to a randomly picked number */
@@ -301,6 +302,8 @@ gs_font_dir_finalize(const gs_memory_t *cmem, void *vptr)
         }
     }
 
+    gx_ttf_outline_cache_free(pdir);
+
     /* free character cache machinery */
     gs_free_object(pdir->memory, pdir->fmcache.mdata, "gs_font_dir_finalize");
     gs_free_object(pdir->memory, pdir->ccache.table, "gs_font_dir_finalize");
@@ -20,6 +20,8 @@
 #include "gx.h"
 #include "gserrors.h"
 #include "gsdsrc.h"
+#include "gslibctx.h"
+#include "gsfunc0.h"
 #include "gsfunc4.h"
 #include "gxfarith.h"
 #include "gxfunc.h"
@@ -34,6 +36,10 @@ typedef struct gs_function_PtCr_s {
     gs_function_PtCr_params_t params;
     /* Define a bogus DataSource for get_function_info. */
     gs_data_source_t data_source;
+    /* Compiled form of the ops (see below), or NULL to interpret them. */
+    struct calc_code_s *compiled;
+    /* Sampled approximation (see fn_PtCr_sample), or NULL. */
+    gs_function_t *sampled;
 } gs_function_PtCr_t;
 
 /* GC descriptor */
@@ -98,42 +104,34 @@ typedef enum {
         /* Miscellaneous */
 
     PtCr_no_op,
-    PtCr_typecheck
+    PtCr_typecheck,
 
-} gs_PtCr_typed_opcode_t;
+        /* Compiled code only */
 
-/* Evaluate a PostScript Calculator function. */
-static int
-fn_PtCr_evaluate(const gs_function_t *pfn_common, const float *in, float *out)
-{
-    const gs_function_PtCr_t *pfn = (const gs_function_PtCr_t *)pfn_common;
-    calc_value_t vstack_buf[2 + MAX_VSTACK + 1];
-    calc_value_t *vstack = &vstack_buf[1];
-    calc_value_t *vsp = vstack + pfn->params.m;
-    const byte *p = pfn->params.ops.data;
-    int repeat_count[MAX_PSC_FUNCTION_NESTING];
-    int repeat_proc_size[MAX_PSC_FUNCTION_NESTING];
-    int repeat_nesting_level = -1;
-    int i;
+    PtCr_move,
+    PtCr_jump,
+    PtCr_jump_false
 
-    /*
-     * Define the table for mapping explicit opcodes to typed opcodes.
-     * We index this table with the opcode and the types of the top 2
-     * values on the stack.
-     */
-    static const struct op_defn_s {
-        byte opcode[16];	/* 4 * type[-1] + type[0] */
-    } op_defn_table[] = {
-        /* Keep this consistent with opcodes in gsfunc4.h! */
+} gs_PtCr_typed_opcode_t;
+
+/*
+ * Define the table for mapping explicit opcodes to typed opcodes.
+ * We index this table with the opcode and the types of the top 2
+ * values on the stack.
+ */
+static const struct op_defn_s {
+    byte opcode[16];	/* 4 * type[-1] + type[0] */
+} op_defn_table[] = {
+    /* Keep this consistent with opcodes in gsfunc4.h! */
 
 #define O4(op) op,op,op,op
 #define E PtCr_typecheck
 #define E4 O4(E)
 #define N PtCr_no_op
-        /* 0-operand operators */
+    /* 0-operand operators */
 #define OP_NONE(op)\
   {{O4(op), O4(op), O4(op), O4(op)}}
-        /* 1-operand operators */
+    /* 1-operand operators */
 #define OP1(b, i, f)\
   {{E,b,i,f, E,b,i,f, E,b,i,f, E,b,i,f}}
 #define OP_NUM1(i, f)\
@@ -142,7 +140,7 @@ fn_PtCr_evaluate(const gs_function_t *pfn_common, const float *in, float *out)
   OP1(E, PtCr_int_to_float, f)
 #define OP_ANY1(op)\
   OP1(op, op, op)
-        /* 2-operand operators */
+    /* 2-operand operators */
 #define OP_NUM2(i, f)\
   {{E4, E4, E,E,i,PtCr_2nd_int_to_float, E,E,PtCr_int_to_float,f}}
 #define OP_INT_BOOL2(i)\
@@ -157,69 +155,82 @@ fn_PtCr_evaluate(const gs_function_t *pfn_common, const float *in, float *out)
 #define OP_ANY2(op)\
   {{E4, E,op,op,op, E,op,op,op, E,op,op,op}}
 
-    /* Arithmetic operators */
-
-        OP_NUM1(PtCr_abs_int, PtCr_abs),	/* abs */
-        OP_NUM2(PtCr_add_int, PtCr_add),	/* add */
-        OP_INT_BOOL2(PtCr_and),  /* and */
-        OP_MATH2(PtCr_atan),	/* atan */
-        OP_INT2(PtCr_bitshift),	/* bitshift */
-        OP_NUM1(N, PtCr_ceiling),	/* ceiling */
-        OP_MATH1(PtCr_cos),	/* cos */
-        OP_NUM1(N, PtCr_cvi),	/* cvi */
-        OP_NUM1(PtCr_int_to_float, N),	/* cvr */
-        OP_MATH2(PtCr_div),	/* div */
-        OP_MATH2(PtCr_exp),	/* exp */
-        OP_NUM1(N, PtCr_floor),	/* floor */
-        OP_INT2(PtCr_idiv),	/* idiv */
-        OP_MATH1(PtCr_ln),	/* ln */
-        OP_MATH1(PtCr_log),	/* log */
-        OP_INT2(PtCr_mod),	/* mod */
-        OP_NUM2(PtCr_mul_int, PtCr_mul),	/* mul */
-        OP_NUM1(PtCr_neg_int, PtCr_neg),	/* neg */
-        OP1(PtCr_not, PtCr_not, E),	/* not */
-        OP_INT_BOOL2(PtCr_or),  /* or */
-        OP_NUM1(N, PtCr_round),	/* round */
-        OP_MATH1(PtCr_sin),	/* sin */
-        OP_MATH1(PtCr_sqrt),	/* sqrt */
-        OP_NUM2(PtCr_sub_int, PtCr_sub),	/* sub */
-        OP_NUM1(N, PtCr_truncate),	/* truncate */
-        OP_INT_BOOL2(PtCr_xor),  /* xor */
-
-    /* Comparison operators */
-
-        OP_REL2(PtCr_eq_int, PtCr_eq),	/* eq */
-        OP_NUM2(PtCr_ge_int, PtCr_ge),	/* ge */
-        OP_NUM2(PtCr_gt_int, PtCr_gt),	/* gt */
-        OP_NUM2(PtCr_le_int, PtCr_le),	/* le */
-        OP_NUM2(PtCr_lt_int, PtCr_lt),	/* lt */
-        OP_REL2(PtCr_ne_int, PtCr_ne),	/* ne */
-
-    /* Stack operators */
-
-        OP1(E, PtCr_copy, E),	/* copy */
-        OP_ANY1(PtCr_dup),	/* dup */
-        OP_ANY2(PtCr_exch),	/* exch */
-        OP1(E, PtCr_index, E),	/* index */
-        OP_ANY1(PtCr_pop),	/* pop */
-        OP_INT2(PtCr_roll),	/* roll */
-
-    /* Constants */
-
-        OP_NONE(PtCr_byte),		/* byte */
-        OP_NONE(PtCr_int),		/* int */
-        OP_NONE(PtCr_float),		/* float */
-        OP_NONE(PtCr_true),		/* true */
-        OP_NONE(PtCr_false),		/* false */
-
-    /* Special */
-
-        OP1(PtCr_if, E, E),		/* if */
-        OP_NONE(PtCr_else),		/* else */
-        OP_NONE(PtCr_return),		/* return */
-        OP1(E, PtCr_repeat, E),		/* repeat */
-        OP_NONE(PtCr_repeat_end)	/* repeat_end */
-    };
+/* Arithmetic operators */
+
+    OP_NUM1(PtCr_abs_int, PtCr_abs),	/* abs */
+    OP_NUM2(PtCr_add_int, PtCr_add),	/* add */
+    OP_INT_BOOL2(PtCr_and),  /* and */
+    OP_MATH2(PtCr_atan),	/* atan */
+    OP_INT2(PtCr_bitshift),	/* bitshift */
+    OP_NUM1(N, PtCr_ceiling),	/* ceiling */
+    OP_MATH1(PtCr_cos),	/* cos */
+    OP_NUM1(N, PtCr_cvi),	/* cvi */
+    OP_NUM1(PtCr_int_to_float, N),	/* cvr */
+    OP_MATH2(PtCr_div),	/* div */
+    OP_MATH2(PtCr_exp),	/* exp */
+    OP_NUM1(N, PtCr_floor),	/* floor */
+    OP_INT2(PtCr_idiv),	/* idiv */
+    OP_MATH1(PtCr_ln),	/* ln */
+    OP_MATH1(PtCr_log),	/* log */
+    OP_INT2(PtCr_mod),	/* mod */
+    OP_NUM2(PtCr_mul_int, PtCr_mul),	/* mul */
+    OP_NUM1(PtCr_neg_int, PtCr_neg),	/* neg */
+    OP1(PtCr_not, PtCr_not, E),	/* not */
+    OP_INT_BOOL2(PtCr_or),  /* or */
+    OP_NUM1(N, PtCr_round),	/* round */
+    OP_MATH1(PtCr_sin),	/* sin */
+    OP_MATH1(PtCr_sqrt),	/* sqrt */
+    OP_NUM2(PtCr_sub_int, PtCr_sub),	/* sub */
+    OP_NUM1(N, PtCr_truncate),	/* truncate */
+    OP_INT_BOOL2(PtCr_xor),  /* xor */
+
+/* Comparison operators */
+
+    OP_REL2(PtCr_eq_int, PtCr_eq),	/* eq */
+    OP_NUM2(PtCr_ge_int, PtCr_ge),	/* ge */
+    OP_NUM2(PtCr_gt_int, PtCr_gt),	/* gt */
+    OP_NUM2(PtCr_le_int, PtCr_le),	/* le */
+    OP_NUM2(PtCr_lt_int, PtCr_lt),	/* lt */
+    OP_REL2(PtCr_ne_int, PtCr_ne),	/* ne */
+
+/* Stack operators */
+
+    OP1(E, PtCr_copy, E),	/* copy */
+    OP_ANY1(PtCr_dup),	/* dup */
+    OP_ANY2(PtCr_exch),	/* exch */
+    OP1(E, PtCr_index, E),	/* index */
+    OP_ANY1(PtCr_pop),	/* pop */
+    OP_INT2(PtCr_roll),	/* roll */
+
+/* Constants */
+
+    OP_NONE(PtCr_byte),		/* byte */
+    OP_NONE(PtCr_int),		/* int */
+    OP_NONE(PtCr_float),		/* float */
+    OP_NONE(PtCr_true),		/* true */
+    OP_NONE(PtCr_false),		/* false */
+
+/* Special */
+
+    OP1(PtCr_if, E, E),		/* if */
+    OP_NONE(PtCr_else),		/* else */
+    OP_NONE(PtCr_return),		/* return */
+    OP1(E, PtCr_repeat, E),		/* repeat */
+    OP_NONE(PtCr_repeat_end)	/* repeat_end */
+};
+
+/* Evaluate a PostScript Calculator function by interpreting its ops. */
+static int
+fn_PtCr_interpret(const gs_function_PtCr_t *pfn, const float *in, float *out)
+{
+    calc_value_t vstack_buf[2 + MAX_VSTACK + 1];
+    calc_value_t *vstack = &vstack_buf[1];
+    calc_value_t *vsp = vstack + pfn->params.m;
+    const byte *p = pfn->params.ops.data;
+    int repeat_count[MAX_PSC_FUNCTION_NESTING];
+    int repeat_proc_size[MAX_PSC_FUNCTION_NESTING];
+    int repeat_nesting_level = -1;
+    int i;
 
     memset(repeat_count, 0x00, MAX_PSC_FUNCTION_NESTING * sizeof(int));
     memset(repeat_proc_size, 0x00, MAX_PSC_FUNCTION_NESTING * sizeof(int));
@@ -576,6 +587,1215 @@ fn_PtCr_evaluate(const gs_function_t *pfn_common, const float *in, float *out)
     return 0;
 }
 
+/* ---------------- Compiled code ---------------- */
+
+/*
+ * When a function is created we compile its ops, by running them on a
+ * stack of symbolic values each of which is either a constant or a
+ * register holding a value of known type.  Stack manipulation and
+ * anything computed only from constants disappears at compile time; what
+ * is left is straight-line code over a register file, with forward jumps
+ * for conditionals that depend on the inputs.  repeat loops are unrolled.
+ *
+ * The compiler dispatches on op_defn_table exactly as the interpreter
+ * does, and folds constants by running the same code that evaluates the
+ * compiled function, so the results are identical.  Integer arithmetic
+ * that might overflow into a real, stack operations with computed
+ * operands, and conditionals whose arms leave stacks of different shapes
+ * are left to the interpreter, as are functions that would fail with a
+ * typecheck, rangecheck or limitcheck.  Where one arm leaves an integer
+ * and the other a real, the value is kept as a real but marked as mixed,
+ * and only operators whose result could depend on its type are left to
+ * the interpreter (see calc_dispatch).
+ */
+
+/* Define the limits on compiled code. */
+#define CALC_MAX_INSNS 4096
+#define CALC_MAX_REGS 512
+#define CALC_MAX_OPS 65536	/* ops processed, including unrolled loops */
+#define CALC_MAX_NESTING 32	/* conditionals */
+
+/* Flag a constant's register during compilation. */
+#define CALC_CONST_REG 0x8000
+
+/* Returned by the compiler when it leaves a function to the interpreter. */
+#define CALC_INTERPRET 1
+
+typedef union calc_reg_s {
+    int i;			/* also used for Boolean */
+    float f;
+} calc_reg_t;
+
+typedef struct calc_insn_s {
+    ushort op;			/* gs_PtCr_opcode_t or gs_PtCr_typed_opcode_t */
+    ushort d;			/* result register, or jump target */
+    ushort a, b;		/* operand registers */
+} calc_insn_t;
+
+/*
+ * The registers hold the inputs, then temporaries, then the constants,
+ * which are copied in before each evaluation.
+ */
+typedef struct calc_code_s {
+    int num_insns;
+    int num_consts;
+    int first_const;
+    /* Followed by the instructions, the constants and the n registers */
+    /* holding the outputs, which are always reals. */
+} calc_code_t;
+#define calc_code_insns(pcode)\
+  ((const calc_insn_t *)((const calc_code_t *)(pcode) + 1))
+#define calc_code_consts(pcode)\
+  ((const calc_reg_t *)(calc_code_insns(pcode) + (pcode)->num_insns))
+#define calc_code_outputs(pcode)\
+  ((const ushort *)(calc_code_consts(pcode) + (pcode)->num_consts))
+
+/* Run compiled code.  Each instruction mirrors a case of fn_PtCr_interpret. */
+static int
+calc_run(const calc_insn_t *insns, calc_reg_t *reg)
+{
+    const calc_insn_t *pc = insns;
+
+#define R reg[pc->d]
+#define A reg[pc->a]
+#define B reg[pc->b]
+    for (;; ++pc) {
+        switch (pc->op) {
+        case PtCr_abs:
+            R.f = fabs(A.f);
+            continue;
+        case PtCr_add:
+            R.f = A.f + B.f;
+            continue;
+        case PtCr_and:
+            R.i = A.i & B.i;
+            continue;
+        case PtCr_atan: {
+            double result;
+            int code = gs_atan2_degrees(A.f, B.f, &result);
+
+            if (code < 0)
+                return code;
+            R.f = result;
+            continue;
+        }
+        case PtCr_bitshift:
+#define MAX_SHIFT (ARCH_SIZEOF_INT * 8 - 1)
+            if (B.i < -MAX_SHIFT || B.i > MAX_SHIFT)
+                R.i = 0;
+#undef MAX_SHIFT
+            else if (B.i < 0)
+                R.i = ((uint)(A.i)) >> -B.i;
+            else
+                R.i = A.i << B.i;
+            continue;
+        case PtCr_ceiling:
+            R.f = ceil(A.f);
+            continue;
+        case PtCr_cos:
+            R.f = gs_cos_degrees(A.f);
+            continue;
+        case PtCr_cvi:
+            R.i = (int)A.f;
+            continue;
+        case PtCr_div:
+            if (B.f == 0)
+                return_error(gs_error_undefinedresult);
+            R.f = A.f / B.f;
+            continue;
+        case PtCr_exp:
+            R.f = pow(A.f, B.f);
+            continue;
+        case PtCr_floor:
+            R.f = floor(A.f);
+            continue;
+        case PtCr_idiv:
+            if (B.i == 0)
+                return_error(gs_error_undefinedresult);
+            if (A.i == min_int && B.i == -1)
+                return_error(gs_error_rangecheck);
+            R.i = A.i / B.i;
+            continue;
+        case PtCr_ln:
+            R.f = log(A.f);
+            continue;
+        case PtCr_log:
+            R.f = log10(A.f);
+            continue;
+        case PtCr_mod:
+            if (B.i == 0)
+                return_error(gs_error_undefinedresult);
+            R.i = (B.i == -1 ? 0 : A.i % B.i);
+            continue;
+        case PtCr_mul:
+            R.f = A.f * B.f;
+            continue;
+        case PtCr_neg:
+            R.f = -A.f;
+            continue;
+        case PtCr_not:
+            R.i = ~A.i;
+            continue;
+        case PtCr_or:
+            R.i = A.i | B.i;
+            continue;
+        case PtCr_round:
+            R.f = floor(A.f + 0.5);
+            continue;
+        case PtCr_sin:
+            R.f = gs_sin_degrees(A.f);
+            continue;
+        case PtCr_sqrt:
+            R.f = sqrt(A.f);
+            continue;
+        case PtCr_sub:
+            R.f = A.f - B.f;
+            continue;
+        case PtCr_truncate:
+            R.f = (A.f < 0 ? ceil(A.f) : floor(A.f));
+            continue;
+        case PtCr_xor:
+            R.i = A.i ^ B.i;
+            continue;
+        case PtCr_eq_int:
+            R.i = A.i == B.i;
+            continue;
+        case PtCr_eq:
+            R.i = A.f == B.f;
+            continue;
+        case PtCr_ge_int:
+            R.i = A.i >= B.i;
+            continue;
+        case PtCr_ge:
+            R.i = A.f >= B.f;
+            continue;
+        case PtCr_gt_int:
+            R.i = A.i > B.i;
+            continue;
+        case PtCr_gt:
+            R.i = A.f > B.f;
+            continue;
+        case PtCr_le_int:
+            R.i = A.i <= B.i;
+            continue;
+        case PtCr_le:
+            R.i = A.f <= B.f;
+            continue;
+        case PtCr_lt_int:
+            R.i = A.i < B.i;
+            continue;
+        case PtCr_lt:
+            R.i = A.f < B.f;
+            continue;
+        case PtCr_ne_int:
+            R.i = A.i != B.i;
+            continue;
+        case PtCr_ne:
+            R.i = A.f != B.f;
+            continue;
+        case PtCr_int_to_float:
+            R.f = (float)A.i;
+            continue;
+        case PtCr_move:
+            R = A;
+            continue;
+        case PtCr_jump_false:
+            if (A.i)
+                continue;
+            /* falls through */
+        case PtCr_jump:
+            pc = insns + pc->d - 1;
+            continue;
+        case PtCr_return:
+            return 0;
+        default:
+            return_error(gs_error_unregistered); /* Must not happen. */
+        }
+    }
+#undef R
+#undef A
+#undef B
+}
+
+/* Evaluate a compiled PostScript Calculator function. */
+static int
+fn_PtCr_run(const gs_function_PtCr_t *pfn, const float *in, float *out)
+{
+    const calc_code_t *pcode = pfn->compiled;
+    const calc_reg_t *consts = calc_code_consts(pcode);
+    const ushort *outputs = calc_code_outputs(pcode);
+    calc_reg_t reg[CALC_MAX_REGS];
+    int i, code;
+
+    for (i = 0; i < pfn->params.m; ++i)
+        reg[i].f = in[i];
+    for (i = 0; i < pcode->num_consts; ++i)
+        reg[pcode->first_const + i] = consts[i];
+    code = calc_run(calc_code_insns(pcode), reg);
+    if (code < 0)
+        return code;
+    for (i = 0; i < pfn->params.n; ++i)
+        out[i] = reg[outputs[i]].f;
+    return 0;
+}
+
+/* Evaluate a PostScript Calculator function. */
+static int
+fn_PtCr_evaluate(const gs_function_t *pfn_common, const float *in, float *out)
+{
+    const gs_function_PtCr_t *pfn = (const gs_function_PtCr_t *)pfn_common;
+
+    if (pfn->sampled != NULL) {
+        const float *domain = pfn->params.Domain;
+        int i;
+
+        /* The samples only cover the Domain, which we don't clamp to. */
+        for (i = 0; i < pfn->params.m; ++i)
+            if (!(in[i] >= domain[2 * i] && in[i] <= domain[2 * i + 1]))
+                break;
+        if (i == pfn->params.m)
+            return gs_function_evaluate(pfn->sampled, in, out);
+    }
+    if (pfn->compiled != NULL)
+        return fn_PtCr_run(pfn, in, out);
+    return fn_PtCr_interpret(pfn, in, out);
+}
+
+/* A value on the compiler's stack. */
+typedef struct calc_slot_s {
+    calc_value_t v;		/* type, and value if constant */
+    int reg;			/* register holding the value, or -1 if constant */
+    bool mixed;			/* a real, which the interpreter may hold as */
+                                /* an integer of the same value */
+} calc_slot_t;
+
+typedef struct calc_compiler_s {
+    int m;
+    int num_temps;
+    int num_ops;
+    int nesting;
+    calc_slot_t *vstack;	/* &vstack_buf[1], as for the interpreter */
+    int sp;			/* index of the top of the stack */
+    int num_insns;
+    int num_consts;
+    calc_slot_t vstack_buf[2 + MAX_VSTACK + 1];
+    calc_insn_t insns[CALC_MAX_INSNS];
+    calc_value_t consts[CALC_MAX_REGS];
+    gs_memory_t *memory;
+} calc_compiler_t;
+
+/* Allocate a register for a temporary. */
+static int
+calc_new_reg(calc_compiler_t *pcc)
+{
+    if (pcc->m + pcc->num_temps + pcc->num_consts >= CALC_MAX_REGS)
+        return -1;
+    return pcc->m + pcc->num_temps++;
+}
+
+/* Return the register holding a value, loading a constant if needed. */
+static int
+calc_slot_reg(calc_compiler_t *pcc, const calc_slot_t *slot)
+{
+    int i;
+
+    if (slot->reg >= 0)
+        return slot->reg;
+    for (i = 0; i < pcc->num_consts; ++i)
+        if (pcc->consts[i].type == slot->v.type &&
+            pcc->consts[i].value.i == slot->v.value.i)
+            return CALC_CONST_REG + i;
+    if (pcc->m + pcc->num_temps + pcc->num_consts >= CALC_MAX_REGS)
+        return -1;
+    pcc->consts[i] = slot->v;
+    return CALC_CONST_REG + pcc->num_consts++;
+}
+
+/* Append an instruction. */
+static int
+calc_emit(calc_compiler_t *pcc, int op, int d, int a, int b)
+{
+    calc_insn_t *pi;
+
+    if (pcc->num_insns == CALC_MAX_INSNS)
+        return CALC_INTERPRET;
+    pi = &pcc->insns[pcc->num_insns++];
+    pi->op = op;
+    pi->d = d;
+    pi->a = a;
+    pi->b = b;
+    return 0;
+}
+
+/*
+ * Apply a typed operation to the top arity (1 or 2) values on the stack,
+ * replacing them with a result of the given type.
+ */
+static int
+calc_compile_op(calc_compiler_t *pcc, int op, int arity,
+                calc_value_type_t type)
+{
+    calc_slot_t *pa = &pcc->vstack[pcc->sp - arity + 1];
+    calc_slot_t *pb = &pcc->vstack[pcc->sp];
+    int code;
+
+    if (pa->reg < 0 && pb->reg < 0) {
+        /* Fold the constants by running the operation on them. */
+        calc_insn_t insns[2];
+        calc_reg_t reg[3];
+
+        insns[0].op = op, insns[0].d = 2, insns[0].a = 0, insns[0].b = 1;
+        insns[1].op = PtCr_return;
+        reg[0].i = pa->v.value.i;
+        reg[1].i = pb->v.value.i;
+        if (calc_run(insns, reg) < 0)
+            return CALC_INTERPRET;	/* the interpreter will fail too */
+        pa->v.value.i = reg[2].i;
+    } else {
+        int ra = calc_slot_reg(pcc, pa), rb = calc_slot_reg(pcc, pb);
+        int rd = calc_new_reg(pcc);
+
+        if (ra < 0 || rb < 0 || rd < 0)
+            return CALC_INTERPRET;
+        code = calc_emit(pcc, op, rd, ra, rb);
+        if (code != 0)
+            return code;
+        pa->reg = rd;
+    }
+    pa->v.type = type;
+    pa->mixed = false;
+    pcc->sp -= arity - 1;
+    return 0;
+}
+
+/* Convert an integer on the stack to a real. */
+static int
+calc_compile_int_to_float(calc_compiler_t *pcc, int index)
+{
+    calc_slot_t *ps = &pcc->vstack[index];
+
+    if (ps->reg < 0) {
+        int i = ps->v.value.i;
+
+        store_float(&ps->v, (double)i);
+        return 0;
+    } else {
+        int rd = calc_new_reg(pcc);
+        int code;
+
+        if (rd < 0)
+            return CALC_INTERPRET;
+        code = calc_emit(pcc, PtCr_int_to_float, rd, ps->reg, ps->reg);
+        if (code != 0)
+            return code;
+        ps->reg = rd;
+        ps->v.type = CVT_FLOAT;
+        ps->mixed = false;
+        return 0;
+    }
+}
+
+/*
+ * Integer arithmetic overflows into reals, so unless its operands are
+ * constant we can't know the type of the result.  Fold it as the
+ * interpreter would.
+ */
+static int
+calc_compile_int_op(calc_compiler_t *pcc, int op)
+{
+    calc_value_t *v1 = &pcc->vstack[pcc->sp - 1].v, *v2 = &pcc->vstack[pcc->sp].v;
+
+    if (pcc->vstack[pcc->sp].reg >= 0 ||
+        (op != PtCr_abs_int && op != PtCr_neg_int &&
+         pcc->vstack[pcc->sp - 1].reg >= 0))
+        return CALC_INTERPRET;
+    switch (op) {
+    case PtCr_abs_int:
+        if (v2->value.i >= 0)
+            return 0;
+        /* fall through */
+    case PtCr_neg_int:
+        if (v2->value.i == min_int)
+            store_float(v2, (double)v2->value.i);
+        else
+            v2->value.i = -v2->value.i;
+        return 0;
+    case PtCr_add_int: {
+        int int1 = v1->value.i, int2 = v2->value.i;
+
+        if ((int1 ^ int2) >= 0 && ((int1 + int2) ^ int1) < 0)
+            store_float(v1, (double)int1 + int2);
+        else
+            v1->value.i = int1 + int2;
+        break;
+    }
+    case PtCr_sub_int: {
+        int int1 = v1->value.i, int2 = v2->value.i;
+
+        if ((int1 ^ int2) < 0 && ((int1 - int2) ^ int1) >= 0)
+            store_float(v1, (double)int1 - int2);
+        else
+            v1->value.i = int1 - int2;
+        break;
+    }
+    case PtCr_mul_int: {
+        double prod = (double)v1->value.i * v2->value.i;
+
+        if (prod < min_int || prod > max_int)
+            store_float(v1, prod);
+        else
+            v1->value.i = (int)prod;
+        break;
+    }
+    }
+    pcc->sp--;
+    return 0;
+}
+
+/* The type a mixed slot may have in the interpreter. */
+#define calc_int_type(ps) ((ps)->mixed ? CVT_INT : (ps)->v.type)
+
+/* Check for an integer constant that is exact as a real. */
+#define calc_exact_int(ps)\
+  ((ps)->v.type == CVT_INT && (ps)->reg < 0 &&\
+   (ps)->v.value.i >= -(1 << 24) && (ps)->v.value.i <= (1 << 24))
+
+/*
+ * Choose the typed operation for op, as op_defn_table does.  If an operand
+ * is mixed, the interpreter may run the integer form of op instead; that
+ * gives the same result if it converts the integer to a real anyway, or
+ * only compares it (with a real, or an integer constant exact as a real), or
+ * leaves it unchanged or takes its abs.  (neg isn't safe: it turns a real
+ * 0 into -0.)  Otherwise return PtCr_typecheck to
+ * leave the function to the interpreter.  Set *pmixed if the result is
+ * mixed.
+ */
+static int
+calc_dispatch(calc_compiler_t *pcc, int op, bool *pmixed)
+{
+    calc_slot_t *vsp = &pcc->vstack[pcc->sp];
+    int t, ti;
+
+    *pmixed = false;
+    for (;;) {
+        t = op_defn_table[op].opcode[(vsp[-1].v.type << 2) + vsp->v.type];
+        if (!vsp->mixed && !vsp[-1].mixed)
+            return t;
+        ti = op_defn_table[op].opcode[(calc_int_type(&vsp[-1]) << 2) +
+                                      calc_int_type(vsp)];
+        if (ti == t)
+            return t;
+        switch (ti) {
+        case PtCr_int_to_float:
+            vsp->mixed = false;
+            continue;
+        case PtCr_2nd_int_to_float:
+            vsp[-1].mixed = false;
+            continue;
+        case PtCr_int2_to_float:
+            vsp->mixed = vsp[-1].mixed = false;
+            continue;
+        case PtCr_eq_int: case PtCr_ge_int: case PtCr_gt_int:
+        case PtCr_le_int: case PtCr_lt_int: case PtCr_ne_int:
+            if ((vsp->v.type == CVT_INT && !calc_exact_int(vsp)) ||
+                (vsp[-1].v.type == CVT_INT && !calc_exact_int(&vsp[-1])))
+                return PtCr_typecheck;
+            return t;
+        case PtCr_abs_int:
+            *pmixed = true;
+            return t;
+        case PtCr_no_op:	/* ceiling, floor, round, truncate */
+            return (op == PtCr_cvi ? PtCr_typecheck : PtCr_no_op);
+        default:		/* integer arithmetic, idiv, mod, bitshift... */
+            return PtCr_typecheck;
+        }
+    }
+}
+
+static int calc_compile_seq(calc_compiler_t *pcc, const byte *p,
+                            const byte *end, const byte **pnext);
+
+/*
+ * Make a slot a real for a join with a real from the other arm.  Only
+ * integer constants that are exact as reals can be converted here.
+ */
+static bool
+calc_join_as_float(calc_slot_t *ps)
+{
+    if (ps->v.type == CVT_FLOAT)
+        return true;
+    if (!calc_exact_int(ps))
+        return false;
+    store_float(&ps->v, (double)ps->v.value.i);
+    return true;
+}
+
+/*
+ * Compile a conditional on a computed Boolean.  Both arms must leave the
+ * stack with the same depth and types, except that an integer constant may
+ * join a real, making the slot mixed; values that differ between the arms
+ * are moved into fresh registers at the end of each arm.
+ */
+static int
+calc_compile_if(calc_compiler_t *pcc, int cond, const byte *p,
+                const byte **pnext)
+{
+    const byte *then_end = p + 2 + (p[0] << 8) + p[1];
+    const byte *next = then_end;
+    int sp = pcc->sp, then_sp;
+    calc_slot_t *saved;
+    calc_slot_t *then_stack = NULL;
+    int *join = NULL;
+    int jump_false, jump_then, jump_end, i, code;
+    int num_joins = 0;
+
+    if (pcc->nesting == CALC_MAX_NESTING)
+        return CALC_INTERPRET;
+    saved = (calc_slot_t *)gs_alloc_bytes(pcc->memory,
+                        (sp + 2) * sizeof(calc_slot_t), "calc_compile_if(saved)");
+    if (saved == NULL)
+        return_error(gs_error_VMerror);
+    memcpy(saved, pcc->vstack_buf, (sp + 2) * sizeof(calc_slot_t));
+    pcc->nesting++;
+    jump_false = pcc->num_insns;
+    code = calc_emit(pcc, PtCr_jump_false, 0, cond, cond);
+    if (code != 0)
+        goto out;
+    /* The true arm runs to its else, or on to where the false one joins. */
+    code = calc_compile_seq(pcc, p + 2, then_end, &next);
+    if (code != 0)
+        goto out;
+    then_sp = pcc->sp;
+    then_stack = (calc_slot_t *)gs_alloc_bytes(pcc->memory,
+                        (then_sp + 2) * sizeof(calc_slot_t), "calc_compile_if(then)");
+    join = (int *)gs_alloc_bytes(pcc->memory, (then_sp + 1) * sizeof(int),
+                                 "calc_compile_if(join)");
+    if (then_stack == NULL || join == NULL) {
+        code = gs_note_error(gs_error_VMerror);
+        goto out;
+    }
+    memcpy(then_stack, pcc->vstack_buf, (then_sp + 2) * sizeof(calc_slot_t));
+    jump_then = pcc->num_insns;
+    code = calc_emit(pcc, PtCr_jump, 0, 0, 0);
+    if (code != 0)
+        goto out;
+    pcc->insns[jump_false].d = pcc->num_insns;
+    memcpy(pcc->vstack_buf, saved, (sp + 2) * sizeof(calc_slot_t));
+    pcc->sp = sp;
+    if (next != then_end) {
+        const byte *else_next;
+
+        code = calc_compile_seq(pcc, then_end, next, &else_next);
+        if (code != 0)
+            goto out;
+        if (else_next != next) {
+            code = CALC_INTERPRET;
+            goto out;
+        }
+    }
+    /* Join the arms. */
+    if (pcc->sp != then_sp) {
+        code = CALC_INTERPRET;
+        goto out;
+    }
+    for (i = 1; i <= then_sp; ++i) {
+        calc_slot_t *pf = &pcc->vstack[i], *pt = &then_stack[i + 1];
+
+        join[i] = -1;
+        /*
+         * The interpreter keeps an integer from one arm as an integer,
+         * so a slot that is an integer in one arm and a real in the other
+         * is mixed from here on (see calc_dispatch).
+         */
+        if (pf->v.type != pt->v.type) {
+            if (!calc_join_as_float(pf) || !calc_join_as_float(pt)) {
+                code = CALC_INTERPRET;
+                goto out;
+            }
+            pf->mixed = true;
+        }
+        pf->mixed |= pt->mixed;
+        if (pf->reg >= 0 ? pf->reg == pt->reg :
+            pt->reg < 0 && pf->v.value.i == pt->v.value.i)
+            continue;
+        if ((join[i] = calc_new_reg(pcc)) < 0) {
+            code = CALC_INTERPRET;
+            goto out;
+        }
+        num_joins++;
+    }
+    if (num_joins != 0) {
+        /* False arm moves, jump to the end, true arm moves. */
+        for (i = 1; i <= then_sp; ++i)
+            if (join[i] >= 0) {
+                int rs = calc_slot_reg(pcc, &pcc->vstack[i]);
+
+                if (rs < 0)
+                    code = CALC_INTERPRET;
+                else
+                    code = calc_emit(pcc, PtCr_move, join[i], rs, rs);
+                if (code != 0)
+                    goto out;
+            }
+        jump_end = pcc->num_insns;
+        code = calc_emit(pcc, PtCr_jump, 0, 0, 0);
+        if (code != 0)
+            goto out;
+        pcc->insns[jump_then].d = pcc->num_insns;
+        for (i = 1; i <= then_sp; ++i)
+            if (join[i] >= 0) {
+                int rs = calc_slot_reg(pcc, &then_stack[i + 1]);
+
+                if (rs < 0)
+                    code = CALC_INTERPRET;
+                else
+                    code = calc_emit(pcc, PtCr_move, join[i], rs, rs);
+                if (code != 0)
+                    goto out;
+                pcc->vstack[i].reg = join[i];
+            }
+        pcc->insns[jump_end].d = pcc->num_insns;
+    } else
+        pcc->insns[jump_then].d = pcc->num_insns;
+    pcc->nesting--;
+out:
+    gs_free_object(pcc->memory, join, "calc_compile_if(join)");
+    gs_free_object(pcc->memory, then_stack, "calc_compile_if(then)");
+    gs_free_object(pcc->memory, saved, "calc_compile_if(saved)");
+    *pnext = next;
+    return code;
+}
+
+/*
+ * Compile ops from p up to end, or up to an else at the end of the range;
+ * set *pnext to where execution continues (past the else's body, if any).
+ */
+static int
+calc_compile_seq(calc_compiler_t *pcc, const byte *p, const byte *end,
+                 const byte **pnext)
+{
+    while (p < end) {
+        calc_slot_t *vsp = &pcc->vstack[pcc->sp];
+        int op = *p++;
+        int code = 0, t, i, n;
+        bool mixed;
+
+        if (++pcc->num_ops > CALC_MAX_OPS)
+            return CALC_INTERPRET;
+    again:
+        switch (t = calc_dispatch(pcc, op, &mixed)) {
+
+            /* Miscellaneous */
+
+        case PtCr_no_op:
+            continue;
+        case PtCr_typecheck:
+            return CALC_INTERPRET;
+
+            /* Coerce and re-dispatch */
+
+        case PtCr_int_to_float:
+            code = calc_compile_int_to_float(pcc, pcc->sp);
+            break;
+        case PtCr_int2_to_float:
+            code = calc_compile_int_to_float(pcc, pcc->sp);
+            if (code != 0)
+                return code;
+            /* fall through */
+        case PtCr_2nd_int_to_float:
+            code = calc_compile_int_to_float(pcc, pcc->sp - 1);
+            break;
+
+            /* Arithmetic operators */
+
+        case PtCr_abs: case PtCr_ceiling: case PtCr_cos: case PtCr_floor:
+        case PtCr_ln: case PtCr_log: case PtCr_neg: case PtCr_round:
+        case PtCr_sin: case PtCr_sqrt: case PtCr_truncate:
+            code = calc_compile_op(pcc, t, 1, CVT_FLOAT);
+            if (code != 0)
+                return code;
+            pcc->vstack[pcc->sp].mixed = mixed;
+            continue;
+        case PtCr_add: case PtCr_atan: case PtCr_div: case PtCr_exp:
+        case PtCr_mul: case PtCr_sub:
+            code = calc_compile_op(pcc, t, 2, CVT_FLOAT);
+            if (code != 0)
+                return code;
+            continue;
+        case PtCr_cvi:
+            code = calc_compile_op(pcc, t, 1, CVT_INT);
+            if (code != 0)
+                return code;
+            continue;
+        case PtCr_not:
+            code = calc_compile_op(pcc, t, 1, vsp->v.type);
+            if (code != 0)
+                return code;
+            continue;
+        case PtCr_and: case PtCr_bitshift: case PtCr_idiv: case PtCr_mod:
+        case PtCr_or: case PtCr_xor:
+            code = calc_compile_op(pcc, t, 2, vsp[-1].v.type);
+            if (code != 0)
+                return code;
+            continue;
+        case PtCr_abs_int: case PtCr_add_int: case PtCr_mul_int:
+        case PtCr_neg_int: case PtCr_sub_int:
+            code = calc_compile_int_op(pcc, t);
+            if (code != 0)
+                return code;
+            continue;
+
+            /* Boolean operators */
+
+        case PtCr_eq_int: case PtCr_ge_int: case PtCr_gt_int:
+        case PtCr_le_int: case PtCr_lt_int: case PtCr_ne_int:
+        case PtCr_eq: case PtCr_ge: case PtCr_gt:
+        case PtCr_le: case PtCr_lt: case PtCr_ne:
+            code = calc_compile_op(pcc, t, 2, CVT_BOOL);
+            if (code != 0)
+                return code;
+            continue;
+
+            /* Stack operators, which need constant operands */
+
+        case PtCr_copy:
+            if (vsp->reg >= 0)
+                return CALC_INTERPRET;
+            i = vsp->v.value.i;
+            n = pcc->sp;
+            if (i < 0 || i >= n || i > MAX_VSTACK - (n - 1))
+                return CALC_INTERPRET;
+            memcpy(vsp, vsp - i, i * sizeof(*vsp));
+            pcc->sp += i - 1;
+            continue;
+        case PtCr_dup:
+            if (pcc->sp == MAX_VSTACK)
+                return CALC_INTERPRET;
+            vsp[1] = *vsp;
+            pcc->sp++;
+            continue;
+        case PtCr_exch: {
+            calc_slot_t t = *vsp;
+
+            *vsp = vsp[-1];
+            vsp[-1] = t;
+            continue;
+        }
+        case PtCr_index:
+            if (vsp->reg >= 0)
+                return CALC_INTERPRET;
+            i = vsp->v.value.i;
+            if (i < 0 || i >= pcc->sp - 1)
+                return CALC_INTERPRET;
+            *vsp = vsp[-i - 1];
+            continue;
+        case PtCr_pop:
+            pcc->sp--;
+            continue;
+        case PtCr_roll:
+            if (vsp->reg >= 0 || vsp[-1].reg >= 0)
+                return CALC_INTERPRET;
+            n = vsp[-1].v.value.i;
+            i = vsp->v.value.i;
+            if (n < 0 || n > pcc->sp - 2)
+                return CALC_INTERPRET;
+            if (n > 0)
+                i %= n;
+            else
+                i = 0;
+            for (; i > 0; i--) {
+                memmove(vsp - n, vsp - (n + 1), n * sizeof(*vsp));
+                vsp[-(n + 1)] = vsp[-1];
+            }
+            for (; i < 0; i++) {
+                vsp[-1] = vsp[-(n + 1)];
+                memmove(vsp - (n + 1), vsp - n, n * sizeof(*vsp));
+            }
+            pcc->sp -= 2;
+            continue;
+
+            /* Constants */
+
+        case PtCr_byte:
+            vsp[1].v.value.i = *p++, vsp[1].v.type = CVT_INT;
+            goto push;
+        case PtCr_int /* native */:
+            memcpy(&vsp[1].v.value.i, p, sizeof(int));
+            vsp[1].v.type = CVT_INT;
+            p += sizeof(int);
+            goto push;
+        case PtCr_float /* native */:
+            memcpy(&vsp[1].v.value.f, p, sizeof(float));
+            vsp[1].v.type = CVT_FLOAT;
+            p += sizeof(float);
+            goto push;
+        case PtCr_true:
+            vsp[1].v.value.i = true, vsp[1].v.type = CVT_BOOL;
+            goto push;
+        case PtCr_false:
+            vsp[1].v.value.i = false, vsp[1].v.type = CVT_BOOL;
+        push:
+            if (pcc->sp == MAX_VSTACK)
+                return CALC_INTERPRET;
+            vsp[1].reg = -1;
+            vsp[1].mixed = false;
+            pcc->sp++;
+            continue;
+
+            /* Special */
+
+        case PtCr_if:
+            pcc->sp--;
+            if (vsp->reg >= 0) {
+                code = calc_compile_if(pcc, vsp->reg, p, &p);
+                if (code != 0)
+                    return code;
+            } else if (vsp->v.value.i)
+                p += 2;		/* execute the body, and jump at any else */
+            else
+                p += 2 + (p[0] << 8) + p[1];
+            continue;
+        case PtCr_else: {
+            const byte *next = p + 2 + (p[0] << 8) + p[1];
+
+            if (p + 2 == end) {
+                *pnext = next;
+                return 0;
+            }
+            p = next;
+            if (p > end)
+                return CALC_INTERPRET;
+            continue;
+        }
+        case PtCr_repeat: {
+            const byte *body = p + 2;
+            const byte *body_end = body + (p[0] << 8) + p[1];
+            const byte *next;
+
+            if (vsp->reg >= 0 || body_end >= end || *body_end != PtCr_repeat_end)
+                return CALC_INTERPRET;
+            pcc->sp--;
+            for (i = vsp->v.value.i; i > 0; --i) {
+                if (++pcc->num_ops > CALC_MAX_OPS)
+                    return CALC_INTERPRET;
+                code = calc_compile_seq(pcc, body, body_end, &next);
+                if (code != 0)
+                    return code;
+                if (next != body_end)
+                    return CALC_INTERPRET;
+            }
+            p = body_end + 1;
+            continue;
+        }
+        default:		/* return and repeat_end can't occur here */
+            return CALC_INTERPRET;
+        }
+        /* Re-dispatch after a coercion. */
+        if (code != 0)
+            return code;
+        vsp = &pcc->vstack[pcc->sp];
+        goto again;
+    }
+    *pnext = p;
+    return 0;
+}
+
+/*
+ * Compile the ops of a function.  Leave pfn->compiled NULL if it's to
+ * be interpreted.
+ */
+static int
+fn_PtCr_compile(gs_function_PtCr_t *pfn, gs_memory_t *mem)
+{
+    const byte *ops = pfn->params.ops.data;
+    const byte *end = ops + pfn->params.ops.size - 1;	/* at the return */
+    const byte *next;
+    int m = pfn->params.m, n = pfn->params.n;
+    calc_compiler_t *pcc;
+    calc_code_t *pcode;
+    calc_insn_t *pi;
+    ushort outputs[MAX_VSTACK];
+    int extra, i, code, size, first_const;
+
+    pfn->compiled = NULL;
+    pcc = (calc_compiler_t *)gs_alloc_bytes(mem->non_gc_memory,
+                                sizeof(*pcc), "fn_PtCr_compile");
+    if (pcc == NULL)
+        return_error(gs_error_VMerror);
+    pcc->memory = mem->non_gc_memory;
+    pcc->m = m;
+    pcc->num_temps = pcc->num_ops = pcc->nesting = 0;
+    pcc->num_insns = pcc->num_consts = 0;
+    pcc->vstack = &pcc->vstack_buf[1];
+    pcc->vstack[-1].v.type = CVT_NONE;
+    pcc->vstack[-1].reg = -1;
+    pcc->vstack[-1].mixed = false;
+    pcc->vstack[0] = pcc->vstack[-1];
+    for (i = 0; i < m; ++i) {
+        pcc->vstack[i + 1].v.type = CVT_FLOAT;
+        pcc->vstack[i + 1].reg = i;
+        pcc->vstack[i + 1].mixed = false;
+    }
+    pcc->sp = m;
+    code = calc_compile_seq(pcc, ops, end, &next);
+    if (code == 0 && next != end)
+        code = CALC_INTERPRET;
+    if (code != 0)
+        goto out;
+    /* Following fn_PtCr_interpret, take the outputs from the top. */
+    extra = pcc->sp - n;
+    if (extra < 0) {
+        code = CALC_INTERPRET;
+        goto out;
+    }
+    for (i = 0; i < n; ++i) {
+        calc_slot_t *ps = &pcc->vstack[extra + 1 + i];
+        int reg;
+
+        if (ps->v.type == CVT_INT) {
+            code = calc_compile_int_to_float(pcc, extra + 1 + i);
+            if (code != 0)
+                goto out;
+        } else if (ps->v.type != CVT_FLOAT) {
+            code = CALC_INTERPRET;
+            goto out;
+        }
+        if ((reg = calc_slot_reg(pcc, ps)) < 0) {
+            code = CALC_INTERPRET;
+            goto out;
+        }
+        outputs[i] = reg;
+    }
+    code = calc_emit(pcc, PtCr_return, 0, 0, 0);
+    if (code != 0)
+        goto out;
+    /* Now we know where the constants go. */
+    first_const = m + pcc->num_temps;
+    for (i = 0, pi = pcc->insns; i < pcc->num_insns; ++i, ++pi) {
+        if (pi->op != PtCr_jump && pi->op != PtCr_jump_false &&
+            pi->d >= CALC_CONST_REG)
+            pi->d += first_const - CALC_CONST_REG;
+        if (pi->a >= CALC_CONST_REG)
+            pi->a += first_const - CALC_CONST_REG;
+        if (pi->b >= CALC_CONST_REG)
+            pi->b += first_const - CALC_CONST_REG;
+    }
+    for (i = 0; i < n; ++i)
+        if (outputs[i] >= CALC_CONST_REG)
+            outputs[i] += first_const - CALC_CONST_REG;
+    size = sizeof(calc_code_t) + pcc->num_insns * sizeof(calc_insn_t) +
+        pcc->num_consts * sizeof(calc_reg_t) + n * sizeof(ushort);
+    pcode = (calc_code_t *)gs_alloc_bytes(mem, size, "fn_PtCr_compile(code)");
+    if (pcode == NULL) {
+        code = gs_note_error(gs_error_VMerror);
+        goto out;
+    }
+    pcode->num_insns = pcc->num_insns;
+    pcode->num_consts = pcc->num_consts;
+    pcode->first_const = first_const;
+    memcpy((calc_insn_t *)calc_code_insns(pcode), pcc->insns,
+           pcc->num_insns * sizeof(calc_insn_t));
+    for (i = 0; i < pcc->num_consts; ++i)
+        ((calc_reg_t *)calc_code_consts(pcode))[i].i = pcc->consts[i].value.i;
+    memcpy((ushort *)calc_code_outputs(pcode), outputs, n * sizeof(ushort));
+    pfn->compiled = pcode;
+out:
+    gs_free_object(pcc->memory, pcc, "fn_PtCr_compile");
+    return (code < 0 ? code : 0);
+}
+
+/* ---------------- Sampling ---------------- */
+
+/*
+ * With -dSampleCalcFunctions, functions of up to 3 inputs whose compiled
+ * code is long enough to be worth it (or which can't be compiled) are
+ * replaced within their Domain by a Sampled function with 16 bit samples.
+ * We check the approximation at the centre of every sample cell and keep
+ * it only if the error there is within 1/CALC_SAMPLE_TOLERANCE of each
+ * output's Range.
+ */
+#define CALC_SAMPLE_MAX_M 3
+#define CALC_SAMPLE_MIN_INSNS 16
+#define CALC_SAMPLE_TOLERANCE 512
+static const int calc_sample_size[CALC_SAMPLE_MAX_M + 1] = {0, 256, 33, 17};
+
+/* Map sample indices (the first varying fastest) to inputs. */
+static void
+calc_sample_point(const gs_function_PtCr_t *pfn, int index, double offset,
+                  float *in)
+{
+    int i;
+
+    for (i = 0; i < pfn->params.m; ++i) {
+        int size = calc_sample_size[pfn->params.m];
+        float d0 = pfn->params.Domain[2 * i], d1 = pfn->params.Domain[2 * i + 1];
+        int k = index % size;
+
+        index /= size;
+        if (offset == 0 && k == size - 1)
+            in[i] = d1;
+        else
+            in[i] = d0 + (d1 - d0) * (k + offset) / (size - 1);
+    }
+}
+
+static int
+fn_PtCr_sample(gs_function_PtCr_t *pfn, gs_memory_t *mem)
+{
+    int m = pfn->params.m, n = pfn->params.n;
+    const float *range = pfn->params.Range;
+    gs_function_Sd_params_t params;
+    gs_function_t *psfn = NULL;
+    float *domain = NULL, *srange = NULL;
+    int *size = NULL;
+    byte *samples = NULL;
+    float in[CALC_SAMPLE_MAX_M];
+    float out[MAX_VSTACK], approx[MAX_VSTACK];
+    int num_samples, num_cells, i, j, code;
+
+    pfn->sampled = NULL;
+    if (!gs_lib_ctx_get_sample_calc_functions(mem) || m > CALC_SAMPLE_MAX_M ||
+        range == NULL ||
+        (pfn->compiled != NULL &&
+         pfn->compiled->num_insns <= CALC_SAMPLE_MIN_INSNS))
+        return 0;
+    for (j = 0; j < n; ++j)
+        if (!(range[2 * j] < range[2 * j + 1]))
+            return 0;
+    for (i = 0; i < m; ++i)
+        if (!(pfn->params.Domain[2 * i] < pfn->params.Domain[2 * i + 1]))
+            return 0;
+    for (num_samples = 1, num_cells = 1, i = 0; i < m; ++i) {
+        num_samples *= calc_sample_size[m];
+        num_cells *= calc_sample_size[m] - 1;
+    }
+    domain = (float *)gs_alloc_byte_array(mem, 2 * m, sizeof(float),
+                                          "fn_PtCr_sample(Domain)");
+    srange = (float *)gs_alloc_byte_array(mem, 2 * n, sizeof(float),
+                                          "fn_PtCr_sample(Range)");
+    size = (int *)gs_alloc_byte_array(mem, m, sizeof(int),
+                                      "fn_PtCr_sample(Size)");
+    samples = gs_alloc_bytes(mem, (size_t)num_samples * n * 2,
+                             "fn_PtCr_sample(samples)");
+    if (domain == NULL || srange == NULL || size == NULL || samples == NULL) {
+        code = gs_note_error(gs_error_VMerror);
+        goto fail;
+    }
+    memcpy(domain, pfn->params.Domain, 2 * m * sizeof(float));
+    memcpy(srange, range, 2 * n * sizeof(float));
+    for (i = 0; i < m; ++i)
+        size[i] = calc_sample_size[m];
+    for (i = 0; i < num_samples; ++i) {
+        calc_sample_point(pfn, i, 0, in);
+        code = fn_PtCr_evaluate((const gs_function_t *)pfn, in, out);
+        if (code < 0)
+            goto reject;
+        for (j = 0; j < n; ++j) {
+            double r0 = range[2 * j], r1 = range[2 * j + 1];
+            double v = (out[j] - r0) / (r1 - r0);
+            uint q;
+
+            if (!(v > -1.0 / CALC_SAMPLE_TOLERANCE &&
+                  v < 1 + 1.0 / CALC_SAMPLE_TOLERANCE))
+                goto reject;	/* outside the Range, or not a number */
+            q = (v <= 0 ? 0 : v >= 1 ? 0xffff : (uint)(v * 0xffff + 0.5));
+            samples[(i * n + j) * 2] = (byte)(q >> 8);
+            samples[(i * n + j) * 2 + 1] = (byte)q;
+        }
+    }
+    params.m = m;
+    params.Domain = domain;
+    params.n = n;
+    params.Range = srange;
+    params.Order = 1;
+    data_source_init_bytes(&params.DataSource, samples, num_samples * n * 2);
+    params.BitsPerSample = 16;
+    params.Encode = NULL;
+    params.Decode = NULL;
+    params.Size = size;
+    params.pole = NULL;
+    params.array_step = NULL;
+    params.stream_step = NULL;
+    params.array_size = 0;
+    code = gs_function_Sd_init(&psfn, &params, mem);
+    if (code < 0) {
+        if (code == gs_error_VMerror)
+            goto fail;
+        goto reject;
+    }
+    domain = srange = NULL;
+    size = NULL;
+    for (i = 0; i < num_cells; ++i) {
+        /* Cell i has its low corner at the sample of the same index */
+        /* in a grid one smaller; find that sample. */
+        int index = 0, rest = i, step = 1;
+
+        for (j = 0; j < m; ++j) {
+            index += (rest % (calc_sample_size[m] - 1)) * step;
+            rest /= calc_sample_size[m] - 1;
+            step *= calc_sample_size[m];
+        }
+        calc_sample_point(pfn, index, 0.5, in);
+        code = fn_PtCr_evaluate((const gs_function_t *)pfn, in, out);
+        if (code >= 0)
+            code = gs_function_evaluate(psfn, in, approx);
+        if (code < 0)
+            goto reject;
+        for (j = 0; j < n; ++j)
+            if (!(fabs(approx[j] - out[j]) <=
+                  (range[2 * j + 1] - range[2 * j]) / CALC_SAMPLE_TOLERANCE))
+                goto reject;
+    }
+    pfn->sampled = psfn;
+    return 0;
+reject:
+    code = 0;
+fail:
+    if (psfn != NULL)
+        gs_function_free(psfn, true, mem);
+    gs_free_object(mem, samples, "fn_PtCr_sample(samples)");
+    gs_free_object(mem, size, "fn_PtCr_sample(Size)");
+    gs_free_object(mem, srange, "fn_PtCr_sample(Range)");
+    gs_free_object(mem, domain, "fn_PtCr_sample(Domain)");
+    return code;
+}
+
+/* Compile a function, and sample it if that's wanted. */
+static int
+fn_PtCr_prepare(gs_function_PtCr_t *pfn, gs_memory_t *mem)
+{
+    int code = fn_PtCr_compile(pfn, mem);
+
+    if (code < 0)
+        return code;
+    return fn_PtCr_sample(pfn, mem);
+}
+
+/* Free the compiled and sampled forms of a function. */
+static void
+fn_PtCr_free_prepared(gs_function_PtCr_t *pfn, gs_memory_t *mem)
+{
+    if (pfn->sampled != NULL) {
+        gs_function_info_t info;
+
+        gs_function_get_info(pfn->sampled, &info);
+        gs_free_const_object(mem, info.DataSource->data.str.data,
+                             "fn_PtCr_free_prepared(samples)");
+        gs_function_free(pfn->sampled, true, mem);
+        pfn->sampled = NULL;
+    }
+    gs_free_object(mem, pfn->compiled, "fn_PtCr_free_prepared(code)");
+    pfn->compiled = NULL;
+}
+
+/* Free a PostScript Calculator function. */
+static void
+fn_PtCr_free(gs_function_t *pfn_common, bool free_params, gs_memory_t *mem)
+{
+    fn_PtCr_free_prepared((gs_function_PtCr_t *)pfn_common, mem);
+    fn_common_free(pfn_common, free_params, mem);
+}
+
 /* Test whether a PostScript Calculator function is monotonic. */
 static int
 fn_PtCr_is_monotonic(const gs_function_t * pfn_common,
@@ -758,6 +1978,8 @@ fn_PtCr_make_scaled(const gs_function_PtCr_t *pfn, gs_function_PtCr_t **ppsfn,
     psfn->params.ops.data = ops;
     psfn->params.ops.size = opsize;
     psfn->data_source = pfn->data_source;
+    psfn->compiled = NULL;
+    psfn->sampled = NULL;
     code = fn_common_scale((gs_function_t *)psfn, (const gs_function_t *)pfn,
                            pranges, mem);
     if (code < 0) {
@@ -792,6 +2014,11 @@ fn_PtCr_make_scaled(const gs_function_PtCr_t *pfn, gs_function_PtCr_t **ppsfn,
     psfn->params.ops.data =
         gs_resize_string(mem, ops, opsize, psfn->params.ops.size,
                          "fn_PtCr_make_scaled");
+    code = fn_PtCr_prepare(psfn, mem);
+    if (code < 0) {
+        gs_function_free((gs_function_t *)psfn, true, mem);
+        return code;
+    }
     *ppsfn = psfn;
     return 0;
 }
@@ -836,7 +2063,7 @@ gs_function_PtCr_init(gs_function_t ** ppfn,
             fn_common_get_params,
             (fn_make_scaled_proc_t) fn_PtCr_make_scaled,
             (fn_free_params_proc_t) gs_function_PtCr_free_params,
-            fn_common_free,
+            fn_PtCr_free,
             (fn_serialize_proc_t) gs_function_PtCr_serialize,
         }
     };
@@ -886,6 +2113,8 @@ gs_function_PtCr_init(gs_function_t ** ppfn,
         if (pfn == 0)
             return_error(gs_error_VMerror);
         pfn->params = *params;
+        pfn->compiled = NULL;
+        pfn->sampled = NULL;
         /*
          * We claim to have a DataSource, in order to write the function
          * definition in symbolic form for embedding in PDF files.
@@ -894,6 +2123,12 @@ gs_function_PtCr_init(gs_function_t ** ppfn,
         data_source_init_string2(&pfn->data_source, NULL, 0);
         pfn->data_source.access = calc_access;
         pfn->head = function_PtCr_head;
+        code = fn_PtCr_prepare(pfn, mem);
+        if (code < 0) {
+            /* Leave the params to the caller, as for other errors. */
+            gs_function_free((gs_function_t *)pfn, false, mem);
+            return code;
+        }
         *ppfn = (gs_function_t *) pfn;
     }
     return 0;
@@ -45,7 +45,7 @@
          *  We will likely want to do at least have an estimate of the
          *  memory used based upon how the CMS is configured.
          *  This will be done later.  For now, just limit the number
-         *  of links.
+         *  of links (the default can be changed with ICCLinkCacheSize).
          */
 #define ICC_CACHE_MAXLINKS (MAX_THREADS*2)	/* allow up to two active links per thread */
 #define ICC_CACHE_NOT_VALID_COUNT 20  /* This should not really occur. If it does we need to take a closer look */
@@ -65,6 +65,8 @@ static int gsicc_compute_linkhash(gsicc_manager_t *icc_manager, gx_device *dev,
 
 static void gsicc_remove_link(gsicc_link_t *link);
 
+static bool gsicc_evict_link(gsicc_link_cache_t *icc_link_cache, int64_t hashcode);
+
 static void gsicc_get_buff_hash(unsigned char *data, int64_t *hash, unsigned int num_bytes);
 
 static void rc_gsicc_link_cache_free(gs_memory_t * mem, void *ptr_in, client_name_t cname);
@@ -73,15 +75,55 @@ static void rc_gsicc_link_cache_free(gs_memory_t * mem, void *ptr_in, client_nam
 
 struct_proc_finalize(icc_link_finalize);
 
-gs_private_st_ptrs3_final(st_icc_link, gsicc_link_t, "gsiccmanage_link",
+gs_private_st_ptrs5_final(st_icc_link, gsicc_link_t, "gsiccmanage_link",
                     icc_link_enum_ptrs, icc_link_reloc_ptrs, icc_link_finalize,
-                    icc_link_cache, next, lock);
+                    icc_link_cache, next, lru_prev, lru_next, lock);
 
 struct_proc_finalize(icc_linkcache_finalize);
 
-gs_private_st_ptrs3_final(st_icc_linkcache, gsicc_link_cache_t, "gsiccmanage_linkcache",
-                    icc_linkcache_enum_ptrs, icc_linkcache_reloc_ptrs, icc_linkcache_finalize,
-                    head, lock, full_wait);
+/* Each shard has its lock, its buckets, and the two ends of its lru list */
+#define ICC_LINK_SHARD_PTRS (ICC_LINK_SHARD_BUCKETS + 3)
+
+static
+ENUM_PTRS_WITH(icc_linkcache_enum_ptrs, gsicc_link_cache_t *link_cache)
+    {
+        const gsicc_link_shard_t *shard;
+
+        index -= 2;
+        if (index >= ICC_LINK_CACHE_SHARDS * ICC_LINK_SHARD_PTRS)
+            return 0;
+        shard = &(link_cache->shards[index / ICC_LINK_SHARD_PTRS]);
+        index %= ICC_LINK_SHARD_PTRS;
+        if (index < ICC_LINK_SHARD_BUCKETS)
+            ENUM_RETURN(shard->buckets[index]);
+        index -= ICC_LINK_SHARD_BUCKETS;
+        ENUM_RETURN(index == 0 ? (void *)shard->lock :
+                    index == 1 ? (void *)shard->lru_head : (void *)shard->lru_tail);
+    }
+ENUM_PTR2(0, gsicc_link_cache_t, lock, full_wait);
+ENUM_PTRS_END
+
+static
+RELOC_PTRS_WITH(icc_linkcache_reloc_ptrs, gsicc_link_cache_t *link_cache)
+{
+    int i, j;
+
+    for (i = 0; i < ICC_LINK_CACHE_SHARDS; i++) {
+        gsicc_link_shard_t *shard = &(link_cache->shards[i]);
+
+        for (j = 0; j < ICC_LINK_SHARD_BUCKETS; j++)
+            RELOC_VAR(shard->buckets[j]);
+        RELOC_VAR(shard->lock);
+        RELOC_VAR(shard->lru_head);
+        RELOC_VAR(shard->lru_tail);
+    }
+    RELOC_VAR(link_cache->lock);
+    RELOC_VAR(link_cache->full_wait);
+}
+RELOC_PTRS_END
+
+gs_private_st_composite_use_final(st_icc_linkcache, gsicc_link_cache_t, "gsiccmanage_linkcache",
+                    icc_linkcache_enum_ptrs, icc_linkcache_reloc_ptrs, icc_linkcache_finalize);
 
 /* These are used to construct a hash for the ICC link based upon the
    render parameters */
@@ -99,6 +141,7 @@ gsicc_link_cache_t *
 gsicc_cache_new(gs_memory_t *memory)
 {
     gsicc_link_cache_t *result;
+    int i;
 
     /* We want this to be maintained in stable_memory.  It should be be effected by the
        save and restores */
@@ -107,11 +150,16 @@ gsicc_cache_new(gs_memory_t *memory)
                              "gsicc_cache_new");
     if ( result == NULL )
         return(NULL);
-    result->head = NULL;
+    /* Required so finaliser can work when result freed. */
+    memset(result->shards, 0, sizeof(result->shards));
     result->num_links = 0;
     result->cache_full = false;
     result->memory = memory;
-    result->full_wait = NULL; /* Required so finaliser can work when result freed. */
+    result->full_wait = NULL;
+    result->num_released = 0;
+    result->waits = 0;
+    result->evictions = 0;
+    result->row_cache = NULL;
     rc_init_free(result, memory, 1, rc_gsicc_link_cache_free);
     result->lock = gx_monitor_label(gx_monitor_alloc(memory),
                                     "gsicc_cache_new");
@@ -119,6 +167,14 @@ gsicc_cache_new(gs_memory_t *memory)
         rc_decrement(result, "gsicc_cache_new");
         return(NULL);
     }
+    for (i = 0; i < ICC_LINK_CACHE_SHARDS; i++) {
+        result->shards[i].lock = gx_monitor_label(gx_monitor_alloc(memory),
+                                                  "gsicc_cache_new(shard)");
+        if (result->shards[i].lock == NULL) {
+            rc_decrement(result, "gsicc_cache_new");
+            return(NULL);
+        }
+    }
     result->full_wait = gx_semaphore_label(gx_semaphore_alloc(memory),
                                            "gsicc_cache_new");
     if (result->full_wait == NULL) {
@@ -154,30 +210,136 @@ void
 icc_linkcache_finalize(const gs_memory_t *mem, void *ptr)
 {
     gsicc_link_cache_t *link_cache = (gsicc_link_cache_t * ) ptr;
+    ulong hits = 0, misses = 0;
+    int i, j;
 
     /* mem is unused, but we are passed it anyway by the ref counting mechanisms. */
     assert(link_cache != NULL && mem == link_cache->memory);
     if (link_cache == NULL)
         return;
-    while (link_cache->head != NULL) {
-        if (link_cache->head->ref_count != 0) {
-            emprintf2(link_cache->memory, "link at "PRI_INTPTR" being removed, but has ref_count = %d\n",
-                      (intptr_t)link_cache->head, link_cache->head->ref_count);
-            link_cache->head->ref_count = 0;	/* force removal */
+    for (i = 0; i < ICC_LINK_CACHE_SHARDS; i++) {
+        gsicc_link_shard_t *shard = &(link_cache->shards[i]);
+
+        for (j = 0; j < ICC_LINK_SHARD_BUCKETS; j++) {
+            while (shard->buckets[j] != NULL) {
+                gsicc_link_t *link = shard->buckets[j];
+
+                if (link->ref_count != 0) {
+                    emprintf2(link_cache->memory, "link at "PRI_INTPTR" being removed, but has ref_count = %d\n",
+                              (intptr_t)link, link->ref_count);
+                    link->ref_count = 0;	/* force removal */
+                }
+                gsicc_remove_link(link);
+            }
         }
-        gsicc_remove_link(link_cache->head);
+        hits += shard->hits;
+        misses += shard->misses;
     }
+    if_debug5m(gs_debug_flag_icc, link_cache->memory,
+               "[icc] Link cache "PRI_INTPTR" hits = %lu misses = %lu waits = %lu evictions = %lu\n",
+               (intptr_t)link_cache, hits, misses, link_cache->waits, link_cache->evictions);
 #ifdef DEBUG
     if (link_cache->num_links != 0) {
         emprintf1(link_cache->memory, "num_links is %d, should be 0.\n", link_cache->num_links);
     }
 #endif
     if (link_cache->rc.ref_count == 0) {
+        for (i = 0; i < ICC_LINK_CACHE_SHARDS; i++) {
+            gx_monitor_free(link_cache->shards[i].lock);
+            link_cache->shards[i].lock = NULL;
+        }
         gx_monitor_free(link_cache->lock);
         link_cache->lock = NULL;
         gx_semaphore_free(link_cache->full_wait);
         link_cache->full_wait = 0;
+        gsicc_rowcache_adjust(link_cache->row_cache, -1, "icc_linkcache_finalize");
+        link_cache->row_cache = NULL;
+    }
+}
+
+/* Find the shard, and the bucket within it, that a link hashcode belongs to */
+static gsicc_link_shard_t *
+gsicc_link_shard(gsicc_link_cache_t *icc_link_cache, int64_t hashcode, int *bucket)
+{
+    uint64_t h = (uint64_t)hashcode;
+
+    /* The hashcodes of links made by gsicc_nocm and gsicc_replacecm are */
+    /* small integers, so fold in the high bits before taking the index. */
+    h ^= h >> 32;
+    h ^= h >> 16;
+    h ^= h >> 8;
+    if (bucket != NULL)
+        *bucket = (int)((h / ICC_LINK_CACHE_SHARDS) % ICC_LINK_SHARD_BUCKETS);
+    return &(icc_link_cache->shards[h % ICC_LINK_CACHE_SHARDS]);
+}
+
+/* The lru list of unused links. These must be called with the shard locked */
+static bool
+gsicc_lru_contains(gsicc_link_shard_t *shard, gsicc_link_t *link)
+{
+    return link->lru_prev != NULL || shard->lru_head == link;
+}
+
+static void
+gsicc_lru_remove(gsicc_link_shard_t *shard, gsicc_link_t *link)
+{
+    if (link->lru_prev == NULL)
+        shard->lru_head = link->lru_next;
+    else
+        link->lru_prev->lru_next = link->lru_next;
+    if (link->lru_next == NULL)
+        shard->lru_tail = link->lru_prev;
+    else
+        link->lru_next->lru_prev = link->lru_prev;
+    link->lru_prev = link->lru_next = NULL;
+}
+
+static void
+gsicc_lru_append(gsicc_link_shard_t *shard, gsicc_link_t *link)
+{
+    link->lru_next = NULL;
+    link->lru_prev = shard->lru_tail;
+    if (shard->lru_tail == NULL)
+        shard->lru_head = link;
+    else
+        shard->lru_tail->lru_next = link;
+    shard->lru_tail = link;
+}
+
+/* Take a link out of its bucket (and the lru list) with the shard locked */
+static bool
+gsicc_unhash_link(gsicc_link_shard_t *shard, int bucket, gsicc_link_t *link)
+{
+    gsicc_link_t *curr = shard->buckets[bucket], *prev = NULL;
+
+    while (curr != NULL && curr != link) {
+        prev = curr;
+        curr = curr->next;
+    }
+    if (curr == NULL)
+        return false;
+    if (prev == NULL)
+        shard->buckets[bucket] = curr->next;
+    else
+        prev->next = curr->next;
+    if (gsicc_lru_contains(shard, link))
+        gsicc_lru_remove(shard, link);
+    return true;
+}
+
+/* Note that a link has left the cache, letting a waiting thread have its slot */
+static void
+gsicc_cache_slot_freed(gsicc_link_cache_t *icc_link_cache, bool evicted)
+{
+    gx_monitor_enter(icc_link_cache->lock);
+    icc_link_cache->num_links--;
+    if (evicted)
+        icc_link_cache->evictions++;
+    if (icc_link_cache->cache_full) {
+        icc_link_cache->cache_full = false;
+        gx_semaphore_signal(icc_link_cache->full_wait);	/* let a waiting thread run */
     }
+    gx_monitor_leave(icc_link_cache->lock);
 }
 
 /* This is a special allocation for a link that is used by devices for
@@ -211,8 +373,11 @@ gsicc_alloc_link_dev(gs_memory_t *memory, cmm_profile_t *src_profile,
     result->orig_procs.map_color = NULL;
     result->orig_procs.free_link = NULL;
     result->next = NULL;
+    result->lru_prev = NULL;
+    result->lru_next = NULL;
     result->link_handle = NULL;
     result->icc_link_cache = NULL;
+    result->lut = NULL;
     result->procs.map_buffer = gscms_transform_color_buffer;
     result->procs.map_color = gscms_transform_color;
     result->procs.free_link = gscms_release_link;
@@ -297,7 +462,10 @@ gsicc_alloc_link(gs_memory_t *memory, gsicc_hashlink_t hashcode)
     result->orig_procs.map_color = NULL;
     result->orig_procs.free_link = NULL;
     result->next = NULL;
+    result->lru_prev = NULL;
+    result->lru_next = NULL;
     result->link_handle = NULL;
+    result->lut = NULL;
     result->procs.map_buffer = gscms_transform_color_buffer;
     result->procs.map_color = gscms_transform_color;
     result->procs.free_link = gscms_release_link;
@@ -347,8 +515,11 @@ gsicc_set_link_data(gsicc_link_t *icc_link, void *link_handle,
     } else {
         icc_link->is_identity = false;
     }
-    /* Set up for monitoring */
     icc_link->data_cs = data_cs;
+    /* Convert buffers through a baked table if asked to */
+    if (gsicc_currentfastlut(icc_link->memory))
+        gsicc_lut_set_link(icc_link);
+    /* Set up for monitoring */
     if (pageneutralcolor)
         gsicc_mcm_set_link(icc_link);
 
@@ -362,6 +533,7 @@ static void
 gsicc_link_free_contents(gsicc_link_t *icc_link)
 {
     icc_link->procs.free_link(icc_link);
+    gsicc_lut_free(icc_link);
     gx_monitor_free(icc_link->lock);
     icc_link->lock = NULL;
 }
@@ -543,36 +715,29 @@ gsicc_link_t*
 gsicc_findcachelink(gsicc_hashlink_t hash, gsicc_link_cache_t *icc_link_cache,
                     bool includes_proof, bool includes_devlink)
 {
-    gsicc_link_t *curr, *prev;
+    gsicc_link_t *curr;
     int64_t hashcode = hash.link_hashcode;
     int cache_loop = 0;
+    int bucket;
+    gsicc_link_shard_t *shard = gsicc_link_shard(icc_link_cache, hashcode, &bucket);
 
-    /* Look through the cache for the hashcode */
-    gx_monitor_enter(icc_link_cache->lock);
-
-    /* List scanning is fast, so we scan the entire list, this includes   */
+    /* Look through the shard's bucket for the hashcode. This includes    */
     /* links that are currently unused, but still in the cache (zero_ref) */
-    curr = icc_link_cache->head;
-    prev = NULL;
+    gx_monitor_enter(shard->lock);
 
-    while (curr != NULL ) {
+    for (curr = shard->buckets[bucket]; curr != NULL; curr = curr->next) {
         if (curr->hashcode.link_hashcode == hashcode &&
             includes_proof == curr->includes_softproof &&
             includes_devlink == curr->includes_devlink) {
-            /* move this one to the front of the list hoping we will use it
-               again soon */
-            if (prev != NULL) {
-                /* if prev == NULL, curr is already the head */
-                prev->next = curr->next;
-                curr->next = icc_link_cache->head;
-                icc_link_cache->head = curr;
-            }
-            /* bump the ref_count since we will be using this one */
-            curr->ref_count++;
+            /* bump the ref_count since we will be using this one, */
+            /* which also means it can no longer be evicted         */
+            if (curr->ref_count++ == 0)
+                gsicc_lru_remove(shard, curr);
+            shard->hits++;
             if_debug3m('^', curr->memory, "[^]%s "PRI_INTPTR" ++ => %d\n",
                        "icclink", (intptr_t)curr, curr->ref_count);
             while (curr->valid == false) {
-                gx_monitor_leave(icc_link_cache->lock); /* exit to let other threads run briefly */
+                gx_monitor_leave(shard->lock); /* exit to let other threads run briefly */
                 if (cache_loop > ICC_CACHE_NOT_VALID_COUNT) {
                     /* Clearly something is wrong.  Return NULL.
                        File a bug report. */
@@ -588,15 +753,14 @@ gsicc_findcachelink(gsicc_hashlink_t hash, gsicc_link_cache_t *icc_link_cache,
                 if (curr->valid == false) {
 		            emprintf1(curr->memory, "link "PRI_INTPTR" lock released, but still not valid.\n", (intptr_t)curr);	/* Breakpoint here */
                 }
-                gx_monitor_enter(icc_link_cache->lock);	/* re-enter to loop and check */
+                gx_monitor_enter(shard->lock);	/* re-enter to loop and check */
             }
-            gx_monitor_leave(icc_link_cache->lock);
+            gx_monitor_leave(shard->lock);
             return curr;	/* success */
         }
-        prev = curr;
-        curr = curr->next;
     }
-    gx_monitor_leave(icc_link_cache->lock);
+    shard->misses++;
+    gx_monitor_leave(shard->lock);
     return NULL;
 }
 
@@ -604,48 +768,63 @@ gsicc_findcachelink(gsicc_hashlink_t hash, gsicc_link_cache_t *icc_link_cache,
 static void
 gsicc_remove_link(gsicc_link_t *link)
 {
-    gsicc_link_t *curr, *prev;
     gsicc_link_cache_t *icc_link_cache = link->icc_link_cache;
     const gs_memory_t *memory = link->memory;
+    int bucket;
+    gsicc_link_shard_t *shard = gsicc_link_shard(icc_link_cache,
+                                    link->hashcode.link_hashcode, &bucket);
+    bool removed = false;
 
     if_debug2m(gs_debug_flag_icc, memory,
                "[icc] Removing link = "PRI_INTPTR" memory = "PRI_INTPTR"\n",
                (intptr_t)link, (intptr_t)memory);
     /* NOTE: link->ref_count must be 0: assert ? */
-    gx_monitor_enter(icc_link_cache->lock);
+    gx_monitor_enter(shard->lock);
     if (link->ref_count != 0) {
       emprintf2(memory, "link at "PRI_INTPTR" being removed, but has ref_count = %d\n", (intptr_t)link, link->ref_count);
     }
-    curr = icc_link_cache->head;
-    prev = NULL;
-
-    while (curr != NULL ) {
-        /* don't get rid of it if another thread has decided to use it */
-        if (curr == link && link->ref_count == 0) {
-            /* remove this one from the list */
-            if (prev == NULL)
-                icc_link_cache->head = curr->next;
-            else
-                prev->next = curr->next;
-            break;
-        }
-        prev = curr;
-        curr = curr->next;
+    /* don't get rid of it if another thread has decided to use it */
+    if (link->ref_count == 0)
+        removed = gsicc_unhash_link(shard, bucket, link);
+    gx_monitor_leave(shard->lock);
+    /* if we didn't find it, or another thread may have decided to */
+    /* use it (ref_count > 0), skip freeing it.                    */
+    if (removed) {
+        gsicc_cache_slot_freed(icc_link_cache, false);	/* no longer in the cache */
+        gsicc_link_free(link);	/* outside link cache now. */
     }
-    /* if curr != link we didn't find it or another thread may have decided to */
-    /* use it (ref_count > 0). Skip freeing it if so.                          */
-    if (curr == link && link->ref_count == 0) {
-        icc_link_cache->num_links--;	/* no longer in the cache */
-        if (icc_link_cache->cache_full) {
-            icc_link_cache->cache_full = false;
-            gx_semaphore_signal(icc_link_cache->full_wait);	/* let a waiting thread run */
+}
+
+/* Remove the least recently used unused link, looking first in the shard */
+/* that 'hashcode' belongs to. Returns false if every link is in use.     */
+static bool
+gsicc_evict_link(gsicc_link_cache_t *icc_link_cache, int64_t hashcode)
+{
+    gsicc_link_shard_t *first = gsicc_link_shard(icc_link_cache, hashcode, NULL);
+    int start = first - icc_link_cache->shards;
+    int i, bucket;
+
+    for (i = 0; i < ICC_LINK_CACHE_SHARDS; i++) {
+        gsicc_link_shard_t *shard = &(icc_link_cache->shards[(start + i) % ICC_LINK_CACHE_SHARDS]);
+        gsicc_link_t *link;
+
+        gx_monitor_enter(shard->lock);
+        link = shard->lru_head;
+        if (link != NULL) {
+            gsicc_link_shard(icc_link_cache, link->hashcode.link_hashcode, &bucket);
+            gsicc_unhash_link(shard, bucket, link);
+        }
+        gx_monitor_leave(shard->lock);
+        if (link != NULL) {
+            if_debug2m(gs_debug_flag_icc, link->memory,
+                       "[icc] Evicting link = "PRI_INTPTR" memory = "PRI_INTPTR"\n",
+                       (intptr_t)link, (intptr_t)link->memory);
+            gsicc_cache_slot_freed(icc_link_cache, true);
+            gsicc_link_free(link);
+            return true;
         }
-        gx_monitor_leave(icc_link_cache->lock);
-        gsicc_link_free(link);	/* outside link cache now. */
-    } else {
-        /* even if we didn't find the link to remove, unlock the cache */
-        gx_monitor_leave(icc_link_cache->lock);
     }
+    return false;
 }
 
 static void
@@ -893,74 +1072,77 @@ gsicc_alloc_link_entry(gsicc_link_cache_t *icc_link_cache,
                        bool include_softproof, bool include_devlink)
 {
     gs_memory_t *cache_mem = icc_link_cache->memory;
-    gsicc_link_t *link;
+    uint max_links = gsicc_currentlinkcachesize(cache_mem);
+    gsicc_link_shard_t *shard;
+    int bucket;
     int retries = 0;
 
     assert(cache_mem == cache_mem->stable_memory);
 
+    if (max_links == 0)
+        max_links = ICC_CACHE_MAXLINKS;
     *ret_link = NULL;
     /* First see if we can add a link */
     /* TODO: this should be based on memory usage, not just num_links */
     gx_monitor_enter(icc_link_cache->lock);
-    while (icc_link_cache->num_links >= ICC_CACHE_MAXLINKS) {
-        /* Look through the cache for first zero ref count to re-use that entry.
-           When ref counts go to zero, the icc_link will have been moved to
-           the end of the list, so the first we find is the 'oldest'.
-           If we get to the last entry we release the lock, set the cache_full
-           flag and wait on full_wait for some other thread to let this thread
-           run again after releasing a cache slot. Release the cache lock to
-           let other threads run and finish with (release) a cache entry.
+    while (icc_link_cache->num_links >= max_links) {
+        /* Evict the least recently used zero ref count link to make room.
+           If every link is in use we set the cache_full flag and wait on
+           full_wait for some other thread to let this thread run again
+           after releasing a cache slot. The cache lock is not held while
+           looking in the shards, so if a link was released meanwhile
+           (num_released changed), look again rather than wait.
         */
-        link = icc_link_cache->head;
-        while (link != NULL ) {
-            if (link->ref_count == 0) {
-                /* we will use this one */
-                if_debug3m('^', cache_mem, "[^]%s "PRI_INTPTR" ++ => %d\n",
-                           "icclink", (intptr_t)link, link->ref_count);
-                break;
+        ulong num_released = icc_link_cache->num_released;
+
+        gx_monitor_leave(icc_link_cache->lock);
+        /* Even if we remove a link, we may still be maxed out so the */
+        /* 'while' will check to make sure some other thread did not  */
+        /* grab the slot we freed.                                    */
+        if (!gsicc_evict_link(icc_link_cache, hash.link_hashcode)) {
+            gx_monitor_enter(icc_link_cache->lock);
+            if (icc_link_cache->num_links >= max_links &&
+                icc_link_cache->num_released == num_released) {
+                icc_link_cache->cache_full = true;
+                icc_link_cache->waits++;
+                /* unlock while waiting for a link to come available */
+                gx_monitor_leave(icc_link_cache->lock);
+                gx_semaphore_wait(icc_link_cache->full_wait);
+                /* repeat the findcachelink to see if some other thread has	*/
+                /* already started building the link we need		*/
+                *ret_link = gsicc_findcachelink(hash, icc_link_cache,
+                                                include_softproof, include_devlink);
+                /* Got a hit, return link. ref_count for the link was already bumped */
+                if (*ret_link != NULL)
+                    return true;
+                if (retries++ > 10)
+                    return false;
+                gx_monitor_enter(icc_link_cache->lock);	    /* restore the lock */
             }
-            link = link->next;
-        }
-        if (link == NULL) {
-            icc_link_cache->cache_full = true;
-            /* unlock while waiting for a link to come available */
-            gx_monitor_leave(icc_link_cache->lock);
-            gx_semaphore_wait(icc_link_cache->full_wait);
-            /* repeat the findcachelink to see if some other thread has	*/
-            /* already started building the link we need		*/
-            *ret_link = gsicc_findcachelink(hash, icc_link_cache,
-                                            include_softproof, include_devlink);
-            /* Got a hit, return link. ref_count for the link was already bumped */
-            if (*ret_link != NULL)
-                return true;
-
-            gx_monitor_enter(icc_link_cache->lock);	    /* restore the lock */
-            /* we will re-test the num_links above while locked to insure */
-            /* that some other thread didn't grab the slot and max us out */
-            if (retries++ > 10)
-                return false;
-        } else {
-            /* Remove the zero ref_count link profile we found.		*/
-            /* Even if we remove this link, we may still be maxed out so*/
-            /* the outermost 'while' will check to make sure some other	*/
-            /* thread did not grab the one we remove.			*/
-            gsicc_remove_link(link);
+            continue;
         }
+        gx_monitor_enter(icc_link_cache->lock);
     }
+    /* reserve the slot so we can unlock while allocating the link */
+    icc_link_cache->num_links++;
+    gx_monitor_leave(icc_link_cache->lock);
+
     /* insert an empty link that we will reserve so we can unlock while	*/
     /* building the link contents. If successful, the entry will set	*/
     /* the hash for the link, Set valid=false, and lock the profile     */
     (*ret_link) = gsicc_alloc_link(cache_mem, hash);
     /* NB: the link returned will be have the lock owned by this thread */
     /* the lock will be released when the link becomes valid.           */
-    if (*ret_link) {
-        (*ret_link)->icc_link_cache = icc_link_cache;
-        (*ret_link)->next = icc_link_cache->head;
-        icc_link_cache->head = *ret_link;
-        icc_link_cache->num_links++;
+    if (*ret_link == NULL) {
+        gsicc_cache_slot_freed(icc_link_cache, false);
+        return false;
     }
-    /* unlock before returning */
-    gx_monitor_leave(icc_link_cache->lock);
+    (*ret_link)->icc_link_cache = icc_link_cache;
+    shard = gsicc_link_shard(icc_link_cache, hash.link_hashcode, &bucket);
+    gx_monitor_enter(shard->lock);
+    (*ret_link)->next = shard->buckets[bucket];
+    shard->buckets[bucket] = *ret_link;
+    gx_monitor_leave(shard->lock);
     return false;	/* we didn't find it, but return a link to be filled */
 }
 
@@ -1283,7 +1465,8 @@ gsicc_get_link_profile(const gs_gstate *pgs, gx_device *dev,
         if (gs_input_profile->data_cs == gsGRAY)
             pageneutralcolor = false;
 
-        gsicc_set_link_data(link, link_handle, hash, icc_link_cache->lock,
+        gsicc_set_link_data(link, link_handle, hash,
+                            gsicc_link_shard(icc_link_cache, hash.link_hashcode, NULL)->lock,
                             include_softproof, include_devicelink, pageneutralcolor,
                             gs_input_profile->data_cs);
         if_debug2m(gs_debug_flag_icc, cache_mem,
@@ -1808,57 +1991,36 @@ void
 gsicc_release_link(gsicc_link_t *icclink)
 {
     gsicc_link_cache_t *icc_link_cache;
+    gsicc_link_shard_t *shard;
+    bool unused;
 
     if (icclink == NULL)
         return;
 
     icc_link_cache = icclink->icc_link_cache;
+    shard = gsicc_link_shard(icc_link_cache, icclink->hashcode.link_hashcode, NULL);
 
-    gx_monitor_enter(icc_link_cache->lock);
+    gx_monitor_enter(shard->lock);
     if_debug2m('^', icclink->memory, "[^]icclink "PRI_INTPTR" -- => %d\n",
                (intptr_t)icclink, icclink->ref_count - 1);
     /* Decrement the reference count */
-    if (--(icclink->ref_count) == 0) {
-
-        gsicc_link_t *curr, *prev;
-
-        /* Find link in cache, and move it to the end of the list.  */
-        /* This way zero ref_count links are found LRU first	*/
-        curr = icc_link_cache->head;
-        prev = NULL;
-        while (curr != icclink) {
-            prev = curr;
-            curr = curr->next;
-        };
-        if (prev == NULL) {
-            /* this link was the head */
-            icc_link_cache->head = curr->next;
-        } else {
-            prev->next = curr->next;		/* de-link this one */
-        }
-        /* Find the first zero-ref entry on the list */
-        curr = icc_link_cache->head;
-        prev = NULL;
-        while (curr != NULL && curr->ref_count > 0) {
-            prev = curr;
-            curr = curr->next;
-        }
-        /* Found where to link this one into the tail of the list */
-        if (prev == NULL) {
-            icc_link_cache->head = icclink;
-            icclink->next = icc_link_cache->head->next;
-        } else {
-            /* link this one in here */
-            prev->next = icclink;
-            icclink->next = curr;
-        }
+    unused = --(icclink->ref_count) == 0;
+    /* Put unused links on the end of the lru list, so they are evicted */
+    /* least recently used first                                        */
+    if (unused)
+        gsicc_lru_append(shard, icclink);
+    gx_monitor_leave(shard->lock);
+
+    if (unused) {
+        gx_monitor_enter(icc_link_cache->lock);
+        icc_link_cache->num_released++;
         /* Finally, if some thread was waiting because the cache was full, let it run */
         if (icc_link_cache->cache_full) {
             icc_link_cache->cache_full = false;
             gx_semaphore_signal(icc_link_cache->full_wait);	/* let a waiting thread run */
         }
+        gx_monitor_leave(icc_link_cache->lock);
     }
-    gx_monitor_leave(icc_link_cache->lock);
 }
 
 /* Used to initialize the buffer description prior to color conversion */
@@ -67,4 +67,10 @@ int  gsicc_get_device_profile_comps(const cmm_dev_profile_t *dev_profile);
 gsicc_link_t * gsicc_alloc_link_dev(gs_memory_t *memory, cmm_profile_t *src_profile,
     cmm_profile_t *des_profile, gsicc_rendering_param_t *rendering_params);
 void gsicc_free_link_dev(gsicc_link_t *link);
+gsicc_rowcache_t *gsicc_rowcache_new(gs_memory_t *memory, size_t max_bytes);
+void gsicc_rowcache_adjust(gsicc_rowcache_t *cache, int delta, client_name_t cname);
+int gsicc_map_image_row(gx_device *dev, const gs_gstate *pgs, gsicc_link_t *link,
+                        gsicc_bufferdesc_t *input_buff_desc,
+                        gsicc_bufferdesc_t *output_buff_desc,
+                        void *inputbuffer, void *outputbuffer);
 #endif
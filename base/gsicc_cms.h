@@ -38,6 +38,8 @@ bool gsicc_mcm_monitor_lab(void *inputcolor, int num_bytes);
 void gsicc_mcm_set_link(gsicc_link_t* link);
 int gsicc_mcm_end_monitor(gsicc_link_cache_t *cache, gx_device *dev);
 int gsicc_mcm_begin_monitor(gsicc_link_cache_t *cache, gx_device *dev);
+void gsicc_lut_set_link(gsicc_link_t *link);
+void gsicc_lut_free(gsicc_link_t *link);
 gsicc_link_t* gsicc_rcm_get_link(const gs_gstate *pgs, gx_device *dev,
                                  gsicc_colorbuffer_t data_cs);
 gsicc_link_t* gsicc_nocm_get_link(const gs_gstate *pgs, gx_device *dev,
@@ -0,0 +1,471 @@
+/* Copyright (C) 2001-2023 Artifex Software, Inc.
+   All Rights Reserved.
+
+   This software is provided AS-IS with no warranty, either express or
+   implied.
+
+   This software is distributed under license and may not be copied,
+   modified or distributed except as expressly authorized under the terms
+   of the license contained in the file LICENSE in this distribution.
+
+   Refer to licensing information at http://www.artifex.com or contact
+   Artifex Software, Inc.,  1305 Grant Avenue - Suite 200, Novato,
+   CA 94945, U.S.A., +1(415)492-9861, for further information.
+*/
+
+/* Baked lookup tables for ICC buffer transforms */
+
+/*
+ * When ICCFastLUT is set, links from Gray, RGB or CMYK are given a
+ * map_buffer procedure that samples the link once over a regular grid and
+ * then converts buffers by simplex interpolation in that grid (linear for
+ * one input, tetrahedral for three, and its four dimensional analogue for
+ * four). This avoids the per call overhead of the CMS and the cloning of
+ * transforms for each buffer format, at the cost of interpolating a second
+ * time. The grid size follows ColorAccuracy, using the same number of
+ * points that lcms uses for its own precalculated tables.
+ *
+ * The table is only built on the first buffer transform, so links that are
+ * only used for single colors cost nothing. Buffers with alpha or byte
+ * swapped data are still handed to the CMS, as are single colors.
+ */
+
+#include "gx.h"
+#include "gxsync.h"
+#include "gscms.h"
+#include "gsicc_cms.h"
+#include "gsicc_manage.h"
+#include "gsicc_cache.h"
+#include "gserrors.h"
+
+#define LUT_MAX_IN 4
+#define LUT_OUT 4		/* entries per grid node, unused outputs are 0 */
+#define LUT_CHUNK 256		/* pixels interpolated per call of eval */
+
+typedef struct gsicc_lut_s gsicc_lut_t;
+
+/*
+ * Input values are first located in the grid. The position is packed into
+ * a uint as the index of the grid point below the value, followed by the
+ * fraction of the way to the next point (16.16 fixed point, so up to
+ * 0x10000).
+ */
+#define LUT_FRAC_BITS 17
+#define LUT_FRAC_MASK ((1 << LUT_FRAC_BITS) - 1)
+
+typedef void (*gsicc_lut_eval_t)(const gsicc_lut_t *lut, const uint *pos,
+                                 unsigned short *out, int num_pixels);
+
+struct gsicc_lut_s {
+    gs_memory_t *memory;
+    int num_in;
+    uint grid1;			/* grid points per input, less one */
+    uint stride[LUT_MAX_IN];	/* table entries between neighbouring nodes */
+    unsigned short *table;
+    uint pos8[256];		/* positions of the 8 bit input values */
+    gsicc_lut_eval_t eval;
+};
+
+/* Grid points per input, by ColorAccuracy and number of inputs */
+static const int lut_grid_points[MAX_COLOR_ACCURACY + 1][2] = {
+    {17, 17},			/* cmsFLAGS_LOWRESPRECALC */
+    {33, 17},			/* default */
+    {49, 23}			/* cmsFLAGS_HIGHRESPRECALC */
+};
+
+/* One dimensional tables are small, so always use a point per 8 bit value */
+#define LUT_GRID_POINTS_1D 256
+
+static forceinline uint
+lut_locate(uint v, uint grid1)
+{
+    uint fx = v * grid1;
+    uint i, fr;
+
+    /* 16.16 position in the grid, rounded as lcms does */
+    fx += (fx + 0x7fff) / 0xffff;
+    i = fx >> 16;
+    fr = fx & 0xffff;
+    if (i == grid1) {
+        /* Stay inside the table at the top of the range */
+        i--;
+        fr = 0x10000;
+    }
+    return (i << LUT_FRAC_BITS) | fr;
+}
+
+/*
+ * Find the nodes and weights of the simplex containing the input color.
+ * The fractional positions are sorted into decreasing order, and the
+ * simplex is walked from the base node one input at a time in that order.
+ * The weights are 16.16 fixed point and sum to 1, so with 16 bit table
+ * entries the weighted sum cannot overflow 32 bits. Returns the number of
+ * nodes (num_in + 1).
+ */
+static forceinline int
+lut_simplex(const gsicc_lut_t *lut, int n, const uint *pos, uint *off, uint *wt)
+{
+    uint f[LUT_MAX_IN] = { 0 }, s[LUT_MAX_IN] = { 0 };
+    uint base = 0;
+    int k, j;
+
+    for (k = 0; k < n; k++) {
+        uint fr = pos[k] & LUT_FRAC_MASK;
+
+        base += (pos[k] >> LUT_FRAC_BITS) * lut->stride[k];
+        for (j = k; j > 0 && f[j - 1] < fr; j--) {
+            f[j] = f[j - 1];
+            s[j] = s[j - 1];
+        }
+        f[j] = fr;
+        s[j] = lut->stride[k];
+    }
+    off[0] = base;
+    wt[0] = 0x10000 - f[0];
+    for (k = 1; k < n; k++) {
+        off[k] = off[k - 1] + s[k - 1];
+        wt[k] = f[k - 1] - f[k];
+    }
+    off[n] = off[n - 1] + s[n - 1];
+    wt[n] = f[n - 1];
+    return n + 1;
+}
+
+/* Runs of the same color are common in images, so remember the last one */
+static forceinline bool
+lut_same_color(const uint *pos, int n)
+{
+    int k;
+
+    for (k = 0; k < n; k++)
+        if (pos[k] != pos[k - n])
+            return false;
+    return true;
+}
+
+/*
+ * The kernels are written for any number of inputs, and instantiated for
+ * each with the count as a constant so that the loops over the inputs and
+ * nodes unroll.
+ */
+static forceinline void
+lut_eval_c(const gsicc_lut_t *lut, int n, const uint *pos,
+           unsigned short *out, int num_pixels)
+{
+    const unsigned short *table = lut->table;
+    uint off[LUT_MAX_IN + 1], wt[LUT_MAX_IN + 1];
+    int x, i, c, num_nodes;
+
+    for (x = 0; x < num_pixels; x++, pos += n, out += LUT_OUT) {
+        if (x > 0 && lut_same_color(pos, n)) {
+            for (c = 0; c < LUT_OUT; c++)
+                out[c] = out[c - LUT_OUT];
+            continue;
+        }
+        num_nodes = lut_simplex(lut, n, pos, off, wt);
+        for (c = 0; c < LUT_OUT; c++) {
+            uint acc = 0x8000;
+
+            for (i = 0; i < num_nodes; i++)
+                acc += wt[i] * table[off[i] + c];
+            out[c] = (unsigned short)(acc >> 16);
+        }
+    }
+}
+
+#define LUT_EVAL_N(name, core, n, target)\
+    static target void\
+    name(const gsicc_lut_t *lut, const uint *pos, unsigned short *out,\
+         int num_pixels)\
+    {\
+        core(lut, n, pos, out, num_pixels);\
+    }
+
+#define LUT_NO_TARGET
+
+LUT_EVAL_N(lut_eval_c_1, lut_eval_c, 1, LUT_NO_TARGET)
+LUT_EVAL_N(lut_eval_c_3, lut_eval_c, 3, LUT_NO_TARGET)
+LUT_EVAL_N(lut_eval_c_4, lut_eval_c, 4, LUT_NO_TARGET)
+
+/*
+ * With SSE4.1 the four outputs of a node are weighted in one go. As in
+ * gxblsimd.c the core is compiled for the instruction set with a target
+ * attribute and only used if the CPU supports it. The arithmetic is the
+ * same as lut_eval_c, so the results are identical.
+ */
+#if !defined(GS_NO_ICC_LUT_SIMD) && defined(__GNUC__) &&\
+    (defined(__x86_64__) || defined(__i386__)) &&\
+    (defined(__clang__) || __GNUC__ > 4 || (__GNUC__ == 4 && __GNUC_MINOR__ >= 9))
+#  define ICC_LUT_SSE41
+#endif
+
+#ifdef ICC_LUT_SSE41
+
+#include <immintrin.h>
+
+#define SSE41_TARGET __attribute__((target("sse4.1")))
+
+static SSE41_TARGET forceinline void
+lut_eval_sse41(const gsicc_lut_t *lut, int n, const uint *pos,
+               unsigned short *out, int num_pixels)
+{
+    const unsigned short *table = lut->table;
+    uint off[LUT_MAX_IN + 1], wt[LUT_MAX_IN + 1];
+    int x, i, num_nodes;
+    __m128i prev = _mm_setzero_si128();
+
+    for (x = 0; x < num_pixels; x++, pos += n, out += LUT_OUT) {
+        __m128i acc;
+
+        if (x == 0 || !lut_same_color(pos, n)) {
+            num_nodes = lut_simplex(lut, n, pos, off, wt);
+            acc = _mm_set1_epi32(0x8000);
+            for (i = 0; i < num_nodes; i++) {
+                __m128i e = _mm_cvtepu16_epi32(
+                                _mm_loadl_epi64((const __m128i *)(table + off[i])));
+
+                acc = _mm_add_epi32(acc, _mm_mullo_epi32(e, _mm_set1_epi32(wt[i])));
+            }
+            acc = _mm_srli_epi32(acc, 16);
+            prev = _mm_packus_epi32(acc, acc);
+        }
+        _mm_storel_epi64((__m128i *)out, prev);
+    }
+}
+
+LUT_EVAL_N(lut_eval_sse41_1, lut_eval_sse41, 1, SSE41_TARGET)
+LUT_EVAL_N(lut_eval_sse41_3, lut_eval_sse41, 3, SSE41_TARGET)
+LUT_EVAL_N(lut_eval_sse41_4, lut_eval_sse41, 4, SSE41_TARGET)
+
+#endif /* ICC_LUT_SSE41 */
+
+static gsicc_lut_eval_t
+lut_choose_eval(int num_in)
+{
+#ifdef ICC_LUT_SSE41
+    if (__builtin_cpu_supports("sse4.1"))
+        return (num_in == 1 ? lut_eval_sse41_1 :
+                num_in == 3 ? lut_eval_sse41_3 : lut_eval_sse41_4);
+#endif
+    return (num_in == 1 ? lut_eval_c_1 :
+            num_in == 3 ? lut_eval_c_3 : lut_eval_c_4);
+}
+
+static void
+lut_free_contents(gsicc_lut_t *lut)
+{
+    gs_free_object(lut->memory, lut->table, "lut_free_contents");
+    gs_free_object(lut->memory, lut, "lut_free_contents");
+}
+
+/* Sample the link over the grid by passing the nodes through the CMS */
+static int
+lut_bake(gx_device *dev, gsicc_link_t *icclink, gsicc_lut_t **plut)
+{
+    gs_memory_t *mem = icclink->memory->non_gc_memory;
+    int num_in = icclink->num_input;
+    int num_out = icclink->num_output;
+    int accuracy = gsicc_currentcoloraccuracy(mem);
+    int grid, num_nodes, node, k, c;
+    gsicc_bufferdesc_t in_desc, out_desc;
+    unsigned short *samples, *result;
+    gsicc_lut_t *lut;
+    int code;
+
+    if (num_in == 1) {
+        grid = LUT_GRID_POINTS_1D;
+    } else {
+        if (accuracy > MAX_COLOR_ACCURACY)
+            accuracy = MAX_COLOR_ACCURACY;
+        grid = lut_grid_points[accuracy][num_in == 4];
+    }
+    num_nodes = grid;
+    for (k = 1; k < num_in; k++)
+        num_nodes *= grid;
+
+    lut = (gsicc_lut_t *)gs_alloc_bytes(mem, sizeof(gsicc_lut_t), "lut_bake");
+    if (lut == NULL)
+        return_error(gs_error_VMerror);
+    lut->memory = mem;
+    lut->num_in = num_in;
+    lut->grid1 = grid - 1;
+    lut->stride[num_in - 1] = LUT_OUT;
+    for (k = num_in - 2; k >= 0; k--)
+        lut->stride[k] = lut->stride[k + 1] * grid;
+    lut->eval = lut_choose_eval(num_in);
+    for (k = 0; k < 256; k++)
+        lut->pos8[k] = lut_locate(k * 257, grid - 1);
+    lut->table = (unsigned short *)gs_alloc_byte_array(mem, num_nodes * LUT_OUT,
+                                        sizeof(unsigned short), "lut_bake");
+    samples = (unsigned short *)gs_alloc_byte_array(mem, num_nodes * num_in,
+                                        sizeof(unsigned short), "lut_bake");
+    result = (unsigned short *)gs_alloc_byte_array(mem, num_nodes * num_out,
+                                        sizeof(unsigned short), "lut_bake");
+    if (lut->table == NULL || samples == NULL || result == NULL) {
+        code = gs_note_error(gs_error_VMerror);
+        goto done;
+    }
+
+    /* The last input varies fastest, matching the table strides */
+    for (node = 0; node < num_nodes; node++) {
+        int i = node;
+
+        for (k = num_in - 1; k >= 0; k--) {
+            samples[node * num_in + k] =
+                (unsigned short)(((i % grid) * 65535 + (grid - 1) / 2) / (grid - 1));
+            i /= grid;
+        }
+    }
+    gsicc_init_buffer(&in_desc, num_in, 2, false, false, false, 0,
+                      num_nodes * num_in * 2, 1, num_nodes);
+    gsicc_init_buffer(&out_desc, num_out, 2, false, false, false, 0,
+                      num_nodes * num_out * 2, 1, num_nodes);
+    code = gscms_transform_color_buffer(dev, icclink, &in_desc, &out_desc,
+                                        samples, result);
+    if (code < 0)
+        goto done;
+    for (node = 0; node < num_nodes; node++) {
+        for (c = 0; c < LUT_OUT; c++)
+            lut->table[node * LUT_OUT + c] =
+                (c < num_out ? result[node * num_out + c] : 0);
+    }
+
+    /* Another thread may have beaten us to it */
+    gx_monitor_enter(icclink->lock);
+    if (icclink->lut == NULL) {
+        icclink->lut = lut;
+        lut = NULL;
+    }
+    *plut = icclink->lut;
+    gx_monitor_leave(icclink->lock);
+    if_debug3m(gs_debug_flag_icc, mem,
+               "[icc] Baked link "PRI_INTPTR", %d points per input, %d nodes\n",
+               (intptr_t)icclink, grid, num_nodes);
+
+done:
+    gs_free_object(mem, samples, "lut_bake");
+    gs_free_object(mem, result, "lut_bake");
+    if (lut != NULL)
+        lut_free_contents(lut);
+    return code;
+}
+
+static int
+gsicc_lut_transform_color_buffer(gx_device *dev, gsicc_link_t *icclink,
+                                 gsicc_bufferdesc_t *input_buff_desc,
+                                 gsicc_bufferdesc_t *output_buff_desc,
+                                 void *inputbuffer, void *outputbuffer)
+{
+    gsicc_lut_t *lut;
+    uint pos[LUT_CHUNK * LUT_MAX_IN];
+    unsigned short out16[LUT_CHUNK * LUT_OUT];
+    int num_in = input_buff_desc->num_chan;
+    int num_out = output_buff_desc->num_chan;
+    int in_bytes = input_buff_desc->bytes_per_chan;
+    int out_bytes = output_buff_desc->bytes_per_chan;
+    int in_step, in_plane, out_step, out_plane;
+    int width = input_buff_desc->pixels_per_row;
+    int x, y, n, i, k;
+    int code;
+
+    if (input_buff_desc->has_alpha || input_buff_desc->endian_swap ||
+        output_buff_desc->endian_swap || in_bytes > 2 || out_bytes > 2 ||
+        num_in != icclink->num_input || num_out != icclink->num_output)
+        return gscms_transform_color_buffer(dev, icclink, input_buff_desc,
+                                            output_buff_desc, inputbuffer,
+                                            outputbuffer);
+    /* The table is set once, but another thread may be setting it now */
+    gx_monitor_enter(icclink->lock);
+    lut = icclink->lut;
+    gx_monitor_leave(icclink->lock);
+    if (lut == NULL) {
+        code = lut_bake(dev, icclink, &lut);
+        if (code == gs_error_VMerror) {
+            /* The table is only a shortcut, so carry on with the CMS */
+            return gscms_transform_color_buffer(dev, icclink, input_buff_desc,
+                                                output_buff_desc, inputbuffer,
+                                                outputbuffer);
+        }
+        if (code < 0)
+            return code;
+    }
+
+    /* Byte offsets between pixels and between the channels of a pixel */
+    if (input_buff_desc->is_planar) {
+        in_step = in_bytes;
+        in_plane = input_buff_desc->plane_stride;
+    } else {
+        in_step = in_bytes * num_in;
+        in_plane = in_bytes;
+    }
+    if (output_buff_desc->is_planar) {
+        out_step = out_bytes;
+        out_plane = output_buff_desc->plane_stride;
+    } else {
+        out_step = out_bytes * num_out;
+        out_plane = out_bytes;
+    }
+
+    for (y = 0; y < input_buff_desc->num_rows; y++) {
+        const byte *src = (const byte *)inputbuffer +
+                                (size_t)y * input_buff_desc->row_stride;
+        byte *des = (byte *)outputbuffer +
+                                (size_t)y * output_buff_desc->row_stride;
+
+        for (x = 0; x < width; x += n) {
+            n = min(width - x, LUT_CHUNK);
+            for (k = 0; k < num_in; k++) {
+                const byte *p = src + (size_t)x * in_step + (size_t)k * in_plane;
+
+                if (in_bytes == 1) {
+                    for (i = 0; i < n; i++, p += in_step)
+                        pos[i * num_in + k] = lut->pos8[*p];
+                } else {
+                    for (i = 0; i < n; i++, p += in_step)
+                        pos[i * num_in + k] =
+                            lut_locate(*(const unsigned short *)p, lut->grid1);
+                }
+            }
+            lut->eval(lut, pos, out16, n);
+            for (k = 0; k < num_out; k++) {
+                byte *q = des + (size_t)x * out_step + (size_t)k * out_plane;
+
+                if (out_bytes == 1) {
+                    /* The 16 to 8 bit rounding that lcms uses */
+                    for (i = 0; i < n; i++, q += out_step)
+                        *q = (byte)((out16[i * LUT_OUT + k] * 65281U + 8388608U) >> 24);
+                } else {
+                    for (i = 0; i < n; i++, q += out_step)
+                        *(unsigned short *)q = out16[i * LUT_OUT + k];
+                }
+            }
+        }
+    }
+    return 0;
+}
+
+/* Use the baked table for buffers through this link, if it is suitable */
+void
+gsicc_lut_set_link(gsicc_link_t *link)
+{
+    if (link->procs.map_buffer != gscms_transform_color_buffer ||
+        link->is_identity)
+        return;
+    if (link->data_cs != gsGRAY && link->data_cs != gsRGB &&
+        link->data_cs != gsCMYK)
+        return;
+    if (link->num_input != 1 && link->num_input != 3 && link->num_input != 4)
+        return;
+    if (link->num_output < 1 || link->num_output > LUT_OUT)
+        return;
+    link->procs.map_buffer = gsicc_lut_transform_color_buffer;
+}
+
+void
+gsicc_lut_free(gsicc_link_t *link)
+{
+    if (link->lut != NULL) {
+        lut_free_contents(link->lut);
+        link->lut = NULL;
+    }
+}
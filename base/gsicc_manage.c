@@ -129,6 +129,38 @@ gsicc_currentcoloraccuracy(gs_memory_t *mem)
     return ctx->icc_color_accuracy;
 }
 
+void
+gsicc_setlinkcachesize(gs_memory_t *mem, uint size)
+{
+    gs_lib_ctx_t *ctx = gs_lib_ctx_get_interp_instance(mem);
+
+    ctx->icc_link_cache_size = size;
+}
+
+uint
+gsicc_currentlinkcachesize(gs_memory_t *mem)
+{
+    gs_lib_ctx_t *ctx = gs_lib_ctx_get_interp_instance(mem);
+
+    return ctx->icc_link_cache_size;
+}
+
+void
+gsicc_setfastlut(gs_memory_t *mem, bool enable)
+{
+    gs_lib_ctx_t *ctx = gs_lib_ctx_get_interp_instance(mem);
+
+    ctx->icc_fast_lut = enable;
+}
+
+bool
+gsicc_currentfastlut(gs_memory_t *mem)
+{
+    gs_lib_ctx_t *ctx = gs_lib_ctx_get_interp_instance(mem);
+
+    return ctx->icc_fast_lut;
+}
+
 /* Get the size of the ICC profile that is in the buffer */
 unsigned int
 gsicc_getprofilesize(unsigned char *buffer)
@@ -161,6 +161,10 @@ int gs_setlabicc(const gs_gstate * pgs, gs_param_string * pval);
 int gsicc_get_device_class(cmm_profile_t *icc_profile);
 uint gsicc_currentcoloraccuracy(gs_memory_t *mem);
 void gsicc_setcoloraccuracy(gs_memory_t *mem, uint level);
+uint gsicc_currentlinkcachesize(gs_memory_t *mem);
+void gsicc_setlinkcachesize(gs_memory_t *mem, uint size);
+bool gsicc_currentfastlut(gs_memory_t *mem);
+void gsicc_setfastlut(gs_memory_t *mem, bool enable);
 
 #if ICC_DUMP
 static void dump_icc_buffer(const gs_memory_t *mem, int buffersize, char filename[],byte *Buffer);
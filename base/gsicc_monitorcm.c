@@ -26,6 +26,7 @@
 #include "gxcspace.h"
 #include "gsicc_cms.h"
 #include "gsicc_cache.h"
+#include "gsicc_manage.h"
 #include "gxcvalue.h"
 #include "gxdevsop.h"
 #include "gdevp14.h"
@@ -410,7 +411,7 @@ gsicc_mcm_set_link(gsicc_link_t* link)
 int
 gsicc_mcm_end_monitor(gsicc_link_cache_t *cache, gx_device *dev)
 {
-    gx_monitor_t *lock = cache->lock;
+    int i, j;
     gsicc_link_t *curr;
     int code;
     cmm_dev_profile_t *dev_profile;
@@ -428,21 +429,30 @@ gsicc_mcm_end_monitor(gsicc_link_cache_t *cache, gx_device *dev)
         gs_pdf14_device_color_mon_set(dev, false);
     }
 
-    /* Lock the cache as we remove monitoring from the links */
-    gx_monitor_enter(lock);
-    curr = cache->head;
-    while (curr != NULL ) {
-        if (curr->is_monitored) {
-            curr->procs = curr->orig_procs;
-            if (curr->hashcode.des_hash == curr->hashcode.src_hash)
-                curr->is_identity = true;
-            curr->is_monitored = false;
+    /* Lock each shard of the cache as we remove monitoring from its links */
+    for (i = 0; i < ICC_LINK_CACHE_SHARDS; i++) {
+        gx_monitor_t *lock = cache->shards[i].lock;
+
+        gx_monitor_enter(lock);
+        for (j = 0; j < ICC_LINK_SHARD_BUCKETS; j++) {
+            curr = cache->shards[i].buckets[j];
+            while (curr != NULL ) {
+                if (curr->is_monitored) {
+                    curr->procs = curr->orig_procs;
+                    if (curr->hashcode.des_hash == curr->hashcode.src_hash)
+                        curr->is_identity = true;
+                    curr->is_monitored = false;
+                    /* The saved procs may predate the baked table */
+                    if (gsicc_currentfastlut(curr->memory))
+                        gsicc_lut_set_link(curr);
+                }
+                /* Now release any tasks/threads waiting for these contents */
+                gx_monitor_leave(curr->lock);
+                curr = curr->next;
+            }
         }
-        /* Now release any tasks/threads waiting for these contents */
-        gx_monitor_leave(curr->lock);
-        curr = curr->next;
+        gx_monitor_leave(lock);	/* done with updating, let everyone run */
     }
-    gx_monitor_leave(lock);	/* done with updating, let everyone run */
     return 0;
 }
 
@@ -452,7 +462,7 @@ gsicc_mcm_end_monitor(gsicc_link_cache_t *cache, gx_device *dev)
 int
 gsicc_mcm_begin_monitor(gsicc_link_cache_t *cache, gx_device *dev)
 {
-    gx_monitor_t *lock = cache->lock;
+    int i, j;
     gsicc_link_t *curr;
     int code;
     cmm_dev_profile_t *dev_profile;
@@ -469,18 +479,23 @@ gsicc_mcm_begin_monitor(gsicc_link_cache_t *cache, gx_device *dev)
         gs_pdf14_device_color_mon_set(dev, true);
     }
 
-    /* Lock the cache as we remove monitoring from the links */
-    gx_monitor_enter(lock);
-
-    curr = cache->head;
-    while (curr != NULL ) {
-        if (curr->data_cs != gsGRAY) {
-            gsicc_mcm_set_link(curr);
-            /* Now release any tasks/threads waiting for these contents */
-            gx_monitor_leave(curr->lock);
+    /* Lock each shard of the cache as we restore monitoring to its links */
+    for (i = 0; i < ICC_LINK_CACHE_SHARDS; i++) {
+        gx_monitor_t *lock = cache->shards[i].lock;
+
+        gx_monitor_enter(lock);
+        for (j = 0; j < ICC_LINK_SHARD_BUCKETS; j++) {
+            curr = cache->shards[i].buckets[j];
+            while (curr != NULL ) {
+                if (curr->data_cs != gsGRAY) {
+                    gsicc_mcm_set_link(curr);
+                    /* Now release any tasks/threads waiting for these contents */
+                    gx_monitor_leave(curr->lock);
+                }
+                curr = curr->next;
+            }
         }
-        curr = curr->next;
+        gx_monitor_leave(lock);	/* done with updating, let everyone run */
     }
-    gx_monitor_leave(lock);	/* done with updating, let everyone run */
     return 0;
 }
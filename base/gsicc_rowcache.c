@@ -0,0 +1,357 @@
+/* Copyright (C) 2001-2023 Artifex Software, Inc.
+   All Rights Reserved.
+
+   This software is provided AS-IS with no warranty, either express or
+   implied.
+
+   This software is distributed under license and may not be copied,
+   modified or distributed except as expressly authorized under the terms
+   of the license contained in the file LICENSE in this distribution.
+
+   Refer to licensing information at http://www.artifex.com or contact
+   Artifex Software, Inc.,  1305 Grant Avenue - Suite 200, Novato,
+   CA 94945, U.S.A., +1(415)492-9861, for further information.
+*/
+
+/* Cache of color converted image rows for the clist reader */
+
+/*
+ * When a page is rendered from a band list, each band replays the image
+ * data that intersects it, so rows of an image that cross a band boundary
+ * (because the image is enlarged, or is interpolated and needs its
+ * neighbours) are decoded and color converted once for every band they
+ * touch. The link cache of the clist reader can therefore carry a row
+ * cache, which remembers the output of recent buffer transforms.
+ *
+ * Entries are keyed by the hashcode of the link, the layout of the two
+ * buffers and the source data itself. The source bytes are kept in the
+ * entry and compared on a hit, so a hash collision can never change the
+ * output. The clist has no identity for an image that survives from one
+ * band to the next, so using the data as the key also catches repeated
+ * rows from different images.
+ *
+ * The cache is shared by all the rendering threads of a page (through the
+ * shared link cache, or by reference when the threads have link caches of
+ * their own), is protected by a single monitor, and holds at most
+ * ImageRowCacheSize bytes, dropping the least recently used rows first.
+ */
+
+#include "memory_.h"
+#include "gx.h"
+#include "gxsync.h"
+#include "gscms.h"
+#include "gsicc_cache.h"
+#include "gxgstate.h"
+#include "gserrors.h"
+
+#define ROWCACHE_BUCKETS 1024	/* must be a power of 2 */
+#define ROWCACHE_MIN_BYTES 64	/* smaller rows are cheaper to convert again */
+#define ROWCACHE_MAX_SHARE 16	/* no row may take more than 1/16 of the cache */
+
+/* The parts of the buffer descriptors that affect the result */
+#define ROWCACHE_DESC_INTS 5
+#define ROWCACHE_KEY_INTS (2 * ROWCACHE_DESC_INTS)
+
+typedef struct gsicc_row_s gsicc_row_t;
+
+struct gsicc_row_s {
+    gsicc_row_t *next;		/* hash chain */
+    gsicc_row_t *lru_prev;	/* more recently used */
+    gsicc_row_t *lru_next;	/* less recently used */
+    uint64_t hash;
+    int64_t link_hash;
+    int key[ROWCACHE_KEY_INTS];
+    uint src_size;
+    uint dst_size;
+    size_t size;		/* of the whole entry */
+    /* followed by src_size bytes of source, then dst_size bytes of output */
+};
+
+#define ROW_SRC(row) ((byte *)((row) + 1))
+#define ROW_DST(row) (ROW_SRC(row) + (row)->src_size)
+
+struct gsicc_rowcache_s {
+    rc_header rc;
+    gs_memory_t *memory;
+    gx_monitor_t *lock;		/* protects everything below */
+    size_t max_bytes;
+    size_t num_bytes;
+    gsicc_row_t *buckets[ROWCACHE_BUCKETS];
+    gsicc_row_t *lru_head;
+    gsicc_row_t *lru_tail;
+    ulong hits;
+    ulong misses;
+    ulong evictions;
+};
+
+static void rc_gsicc_rowcache_free(gs_memory_t *mem, void *ptr_in,
+                                   client_name_t cname);
+
+/* Allocate a row cache holding at most max_bytes, or return NULL */
+gsicc_rowcache_t *
+gsicc_rowcache_new(gs_memory_t *memory, size_t max_bytes)
+{
+    gsicc_rowcache_t *result;
+
+    memory = memory->non_gc_memory;
+    result = (gsicc_rowcache_t *)gs_alloc_bytes(memory, sizeof(*result),
+                                                "gsicc_rowcache_new");
+    if (result == NULL)
+        return NULL;
+    memset(result, 0, sizeof(*result));
+    result->memory = memory;
+    result->max_bytes = max_bytes;
+    rc_init_free(result, memory, 1, rc_gsicc_rowcache_free);
+    result->lock = gx_monitor_label(gx_monitor_alloc(memory),
+                                    "gsicc_rowcache_new");
+    if (result->lock == NULL) {
+        gs_free_object(memory, result, "gsicc_rowcache_new");
+        return NULL;
+    }
+    return result;
+}
+
+static void
+rc_gsicc_rowcache_free(gs_memory_t *mem, void *ptr_in, client_name_t cname)
+{
+    gsicc_rowcache_t *cache = (gsicc_rowcache_t *)ptr_in;
+    gsicc_row_t *row, *next;
+
+    if_debug4m(gs_debug_flag_icc, cache->memory,
+               "[icc] Row cache "PRI_INTPTR" hits = %lu misses = %lu evictions = %lu\n",
+               (intptr_t)cache, cache->hits, cache->misses, cache->evictions);
+    for (row = cache->lru_head; row != NULL; row = next) {
+        next = row->lru_next;
+        gs_free_object(cache->memory, row, "rc_gsicc_rowcache_free");
+    }
+    gx_monitor_free(cache->lock);
+    gs_free_object(cache->memory, cache, cname);
+}
+
+/* Add or drop references to a row cache, which may be NULL */
+void
+gsicc_rowcache_adjust(gsicc_rowcache_t *cache, int delta, client_name_t cname)
+{
+    rc_adjust_only(cache, delta, cname);
+}
+
+static void
+rowcache_desc_key(int *key, const gsicc_bufferdesc_t *desc)
+{
+    key[0] = desc->num_chan;
+    key[1] = desc->bytes_per_chan;
+    key[2] = desc->endian_swap;
+    key[3] = desc->is_planar;
+    key[4] = desc->pixels_per_row;
+}
+
+/* Only single rows of color data without alpha are cached. Planar output */
+/* is written plane by plane, but the source must be chunky. */
+static bool
+rowcache_usable(const gsicc_bufferdesc_t *in, const gsicc_bufferdesc_t *out)
+{
+    return in->num_rows == 1 && out->num_rows == 1 &&
+           !in->has_alpha && !out->has_alpha && !in->is_planar &&
+           in->pixels_per_row == out->pixels_per_row;
+}
+
+/* A 64 bit hash of the source data, seeded with the rest of the key */
+static uint64_t
+rowcache_hash(const byte *data, uint size, int64_t link_hash, const int *key)
+{
+    uint64_t h = (uint64_t)link_hash ^ 0x9e3779b97f4a7c15ULL;
+    uint64_t v;
+    int i;
+
+    for (i = 0; i < ROWCACHE_KEY_INTS; i++)
+        h = (h ^ (uint)key[i]) * 0x100000001b3ULL;
+    for (; size >= 8; size -= 8, data += 8) {
+        memcpy(&v, data, 8);
+        h = (h ^ v) * 0x9e3779b97f4a7c15ULL;
+        h ^= h >> 29;
+    }
+    for (; size > 0; size--)
+        h = (h ^ *data++) * 0x100000001b3ULL;
+    return h ^ (h >> 32);
+}
+
+static gsicc_row_t *
+rowcache_find(gsicc_rowcache_t *cache, uint64_t hash, int64_t link_hash,
+              const int *key, const byte *src, uint src_size)
+{
+    gsicc_row_t *row = cache->buckets[hash & (ROWCACHE_BUCKETS - 1)];
+
+    for (; row != NULL; row = row->next) {
+        if (row->hash == hash && row->link_hash == link_hash &&
+            row->src_size == src_size &&
+            memcmp(row->key, key, sizeof(row->key)) == 0 &&
+            memcmp(ROW_SRC(row), src, src_size) == 0)
+            return row;
+    }
+    return NULL;
+}
+
+static void
+rowcache_lru_unlink(gsicc_rowcache_t *cache, gsicc_row_t *row)
+{
+    if (row->lru_prev != NULL)
+        row->lru_prev->lru_next = row->lru_next;
+    else
+        cache->lru_head = row->lru_next;
+    if (row->lru_next != NULL)
+        row->lru_next->lru_prev = row->lru_prev;
+    else
+        cache->lru_tail = row->lru_prev;
+}
+
+static void
+rowcache_lru_push(gsicc_rowcache_t *cache, gsicc_row_t *row)
+{
+    row->lru_prev = NULL;
+    row->lru_next = cache->lru_head;
+    if (cache->lru_head != NULL)
+        cache->lru_head->lru_prev = row;
+    else
+        cache->lru_tail = row;
+    cache->lru_head = row;
+}
+
+/* Remove the least recently used row. Called with the lock held. */
+static void
+rowcache_evict(gsicc_rowcache_t *cache)
+{
+    gsicc_row_t *row = cache->lru_tail;
+    gsicc_row_t **prow = &(cache->buckets[row->hash & (ROWCACHE_BUCKETS - 1)]);
+
+    while (*prow != row)
+        prow = &((*prow)->next);
+    *prow = row->next;
+    rowcache_lru_unlink(cache, row);
+    cache->num_bytes -= row->size;
+    cache->evictions++;
+    gs_free_object(cache->memory, row, "rowcache_evict");
+}
+
+/* Copy between the (contiguous) output stored in an entry and the buffer */
+static void
+rowcache_copy_out(byte *dst, const gsicc_bufferdesc_t *out, const byte *stored,
+                  bool to_buffer)
+{
+    uint plane_size;
+    int k;
+
+    if (!out->is_planar) {
+        uint size = out->pixels_per_row * out->num_chan * out->bytes_per_chan;
+
+        if (to_buffer)
+            memcpy(dst, stored, size);
+        else
+            memcpy((byte *)stored, dst, size);
+        return;
+    }
+    plane_size = out->pixels_per_row * out->bytes_per_chan;
+    for (k = 0; k < out->num_chan; k++) {
+        if (to_buffer)
+            memcpy(dst + (size_t)k * out->plane_stride, stored + k * plane_size,
+                   plane_size);
+        else
+            memcpy((byte *)stored + k * plane_size,
+                   dst + (size_t)k * out->plane_stride, plane_size);
+    }
+}
+
+/*
+ * Convert a row of image data through a link, using the row cache of the
+ * link cache of the gstate when it has one.
+ */
+int
+gsicc_map_image_row(gx_device *dev, const gs_gstate *pgs, gsicc_link_t *link,
+                    gsicc_bufferdesc_t *input_buff_desc,
+                    gsicc_bufferdesc_t *output_buff_desc,
+                    void *inputbuffer, void *outputbuffer)
+{
+    gsicc_rowcache_t *cache = NULL;
+    int key[ROWCACHE_KEY_INTS];
+    const byte *src = (const byte *)inputbuffer;
+    uint src_size, dst_size;
+    size_t size;
+    uint64_t hash;
+    int64_t link_hash;
+    gsicc_row_t *row, *found;
+    int code;
+
+    if (pgs != NULL && pgs->icc_link_cache != NULL)
+        cache = pgs->icc_link_cache->row_cache;
+    if (cache == NULL || link->is_monitored ||
+        !rowcache_usable(input_buff_desc, output_buff_desc))
+        return link->procs.map_buffer(dev, link, input_buff_desc,
+                                      output_buff_desc, inputbuffer,
+                                      outputbuffer);
+
+    src_size = input_buff_desc->pixels_per_row * input_buff_desc->num_chan *
+               input_buff_desc->bytes_per_chan;
+    dst_size = output_buff_desc->pixels_per_row * output_buff_desc->num_chan *
+               output_buff_desc->bytes_per_chan;
+    size = sizeof(gsicc_row_t) + src_size + dst_size;
+    if (src_size < ROWCACHE_MIN_BYTES || size > cache->max_bytes / ROWCACHE_MAX_SHARE)
+        return link->procs.map_buffer(dev, link, input_buff_desc,
+                                      output_buff_desc, inputbuffer,
+                                      outputbuffer);
+
+    rowcache_desc_key(key, input_buff_desc);
+    rowcache_desc_key(key + ROWCACHE_DESC_INTS, output_buff_desc);
+    link_hash = link->hashcode.link_hashcode;
+    hash = rowcache_hash(src, src_size, link_hash, key);
+
+    gx_monitor_enter(cache->lock);
+    row = rowcache_find(cache, hash, link_hash, key, src, src_size);
+    if (row != NULL) {
+        rowcache_copy_out((byte *)outputbuffer, output_buff_desc, ROW_DST(row), true);
+        if (row != cache->lru_head) {
+            rowcache_lru_unlink(cache, row);
+            rowcache_lru_push(cache, row);
+        }
+        cache->hits++;
+        gx_monitor_leave(cache->lock);
+        return 0;
+    }
+    cache->misses++;
+    gx_monitor_leave(cache->lock);
+
+    code = link->procs.map_buffer(dev, link, input_buff_desc, output_buff_desc,
+                                  inputbuffer, outputbuffer);
+    if (code < 0)
+        return code;
+
+    /* Failing to remember the row is not an error */
+    row = (gsicc_row_t *)gs_alloc_bytes(cache->memory, size, "gsicc_map_image_row");
+    if (row == NULL)
+        return code;
+    row->hash = hash;
+    row->link_hash = link_hash;
+    memcpy(row->key, key, sizeof(row->key));
+    row->src_size = src_size;
+    row->dst_size = dst_size;
+    row->size = size;
+    memcpy(ROW_SRC(row), src, src_size);
+    rowcache_copy_out((byte *)outputbuffer, output_buff_desc, ROW_DST(row), false);
+
+    gx_monitor_enter(cache->lock);
+    /* Another thread may have added the same row meanwhile */
+    found = rowcache_find(cache, hash, link_hash, key, src, src_size);
+    if (found == NULL) {
+        gsicc_row_t **bucket = &(cache->buckets[hash & (ROWCACHE_BUCKETS - 1)]);
+
+        row->next = *bucket;
+        *bucket = row;
+        rowcache_lru_push(cache, row);
+        cache->num_bytes += size;
+        while (cache->num_bytes > cache->max_bytes)
+            rowcache_evict(cache);
+        row = NULL;
+    }
+    gx_monitor_leave(cache->lock);
+    if (row != NULL)
+        gs_free_object(cache->memory, row, "gsicc_map_image_row");
+    return code;
+}
@@ -106,6 +106,47 @@ gs_lib_ctx_set_icc_directory(const gs_memory_t *mem_gc, const char* pname,
     return 0;
 }
 
+int
+gs_lib_ctx_set_glyph_cache_file(const gs_memory_t *mem, const char *fname)
+{
+    gs_lib_ctx_t *p_ctx = mem->gs_lib_ctx;
+    gs_memory_t *ctx_mem = p_ctx->memory;
+    size_t len = strlen(fname);
+    char *result;
+    int code;
+
+    /* A file written by another version is replaced by renaming a new one */
+    /* over it, written under a unique name of the form <fname>.<hex>.new. */
+    result = (char *)gs_alloc_bytes(ctx_mem, len + 7,
+                                    "gs_lib_ctx_set_glyph_cache_file");
+    if (result == NULL)
+        return_error(gs_error_VMerror);
+    memcpy(result, fname, len);
+    memcpy(result + len, ".*.new", 7);
+    code = gs_add_control_path(mem, gs_permit_file_reading, fname);
+    if (code >= 0)
+        code = gs_add_outputfile_control_path((gs_memory_t *)mem, fname);
+    if (code >= 0)
+        code = gs_add_outputfile_control_path((gs_memory_t *)mem, result);
+    if (code < 0) {
+        gs_free_object(ctx_mem, result, "gs_lib_ctx_set_glyph_cache_file");
+        return code;
+    }
+    result[len] = 0;
+    gs_free_object(ctx_mem, p_ctx->glyph_cache_file,
+                   "gs_lib_ctx_set_glyph_cache_file");
+    p_ctx->glyph_cache_file = result;
+    return 0;
+}
+
+const char *
+gs_lib_ctx_get_glyph_cache_file(const gs_memory_t *mem)
+{
+    if (mem == NULL)
+        return NULL;
+    return mem->gs_lib_ctx->glyph_cache_file;
+}
+
 /* Sets/Gets the string containing the list of default devices we should try */
 int
 gs_lib_ctx_set_default_device_list(const gs_memory_t *mem, const char* dev_list_str,
@@ -361,6 +402,14 @@ core_create_failed:
     pio->profiledir = NULL;
     pio->profiledir_len = 0;
     pio->icc_color_accuracy = MAX_COLOR_ACCURACY;
+    pio->icc_link_cache_size = 0;
+    pio->icc_fast_lut = false;
+    pio->sample_calc_functions = false;
+    pio->num_shading_threads = 0;
+    pio->fast_band_list_compression = false;
+    pio->band_list_compression_threshold = BAND_LIST_COMPRESSION_THRESHOLD;
+    pio->image_row_cache_size = 0;
+    pio->glyph_cache_file = NULL;
     if (gs_lib_ctx_set_icc_directory(mem, DEFAULT_DIR_ICC, strlen(DEFAULT_DIR_ICC)) < 0)
       goto Failure;
 
@@ -425,6 +474,8 @@ void gs_lib_ctx_fin(gs_memory_t *mem)
     gs_free_object(ctx_mem, ctx->default_device_list,
                 "gs_lib_ctx_fin");
 
+    gs_free_object(ctx_mem, ctx->glyph_cache_file, "gs_lib_ctx_fin");
+
     gs_free_object(ctx_mem, ctx->name_table_root, "gs_lib_ctx_fin");
     gs_free_object(ctx_mem, ctx->io_device_table_root, "gs_lib_ctx_fin");
     gs_free_object(ctx_mem, ctx->font_dir_root, "gs_lib_ctx_fin");
@@ -489,6 +540,71 @@ int gs_lib_ctx_get_act_on_uel( const gs_memory_t *mem )
     return mem->gs_lib_ctx->core->act_on_uel;
 }
 
+bool gs_lib_ctx_get_sample_calc_functions( const gs_memory_t *mem )
+{
+    if (mem == NULL)
+        return false;
+    return mem->gs_lib_ctx->sample_calc_functions;
+}
+
+void gs_lib_ctx_set_sample_calc_functions( const gs_memory_t *mem, bool sample )
+{
+    if (mem != NULL)
+        mem->gs_lib_ctx->sample_calc_functions = sample;
+}
+
+int gs_lib_ctx_get_shading_threads( const gs_memory_t *mem )
+{
+    if (mem == NULL)
+        return 0;
+    return mem->gs_lib_ctx->num_shading_threads;
+}
+
+void gs_lib_ctx_set_shading_threads( const gs_memory_t *mem, int num_threads )
+{
+    if (mem != NULL)
+        mem->gs_lib_ctx->num_shading_threads = (num_threads < 0 ? 0 : num_threads);
+}
+
+bool gs_lib_ctx_get_fast_band_list_compression( const gs_memory_t *mem )
+{
+    if (mem == NULL)
+        return false;
+    return mem->gs_lib_ctx->fast_band_list_compression;
+}
+
+void gs_lib_ctx_set_fast_band_list_compression( const gs_memory_t *mem, bool fast )
+{
+    if (mem != NULL)
+        mem->gs_lib_ctx->fast_band_list_compression = fast;
+}
+
+int64_t gs_lib_ctx_get_band_list_compression_threshold( const gs_memory_t *mem )
+{
+    if (mem == NULL)
+        return BAND_LIST_COMPRESSION_THRESHOLD;
+    return mem->gs_lib_ctx->band_list_compression_threshold;
+}
+
+void gs_lib_ctx_set_band_list_compression_threshold( const gs_memory_t *mem, int64_t threshold )
+{
+    if (mem != NULL)
+        mem->gs_lib_ctx->band_list_compression_threshold = (threshold < 0 ? 0 : threshold);
+}
+
+int gs_lib_ctx_get_image_row_cache_size( const gs_memory_t *mem )
+{
+    if (mem == NULL)
+        return 0;
+    return mem->gs_lib_ctx->image_row_cache_size;
+}
+
+void gs_lib_ctx_set_image_row_cache_size( const gs_memory_t *mem, int size )
+{
+    if (mem != NULL)
+        mem->gs_lib_ctx->image_row_cache_size = (size < 0 ? 0 : size);
+}
+
 /* Provide a single point for all "C" stdout and stderr.
  */
 
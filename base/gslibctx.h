@@ -150,6 +150,15 @@ typedef struct {
     gs_globals *globals;
 } gs_lib_ctx_core_t;
 
+/* The default BandListCompressionThreshold. As a testing measure,
+ * TEST_BAND_LIST_COMPRESSION sets it to a low value so as to cause
+ * compression to trigger. */
+#ifdef TEST_BAND_LIST_COMPRESSION
+#  define BAND_LIST_COMPRESSION_THRESHOLD 1024 /* Low value to force compression */
+#else
+#  define BAND_LIST_COMPRESSION_THRESHOLD 500000000 /* 0.5 Gb for host machines */
+#endif
+
 typedef struct gs_lib_ctx_s
 {
     gs_memory_t *memory;  /* mem->gs_lib_ctx->memory == mem */
@@ -175,6 +184,20 @@ typedef struct gs_lib_ctx_s
     uint screen_min_screen_levels;
     /* Accuracy vs. performance for ICC color */
     uint icc_color_accuracy;
+    /* Maximum number of links in an ICC link cache (0 for the default) */
+    uint icc_link_cache_size;
+    /* Convert ICC buffers through tables baked from the links */
+    bool icc_fast_lut;
+    /* Replace low-dimensional Type 4 functions by sampled ones */
+    bool sample_calc_functions;
+    /* Render mesh shadings in this many horizontal strips at once */
+    int num_shading_threads;
+    /* Compress RAM band lists with the fast LZ4 filters */
+    bool fast_band_list_compression;
+    /* Compress RAM band lists once they use more than this many bytes */
+    int64_t band_list_compression_threshold;
+    /* Bytes of color converted image rows kept by the clist reader */
+    int image_row_cache_size;
     /* real time clock 'bias' value. Not strictly required, but some FTS
      * tests work better if realtime starts from 0 at boot time. */
     long real_time_0[2];
@@ -191,6 +214,7 @@ typedef struct gs_lib_ctx_s
     char *default_device_list;
     int gcsignal;
     void *sjpxd_private; /* optional for use of jpx codec */
+    char *glyph_cache_file; /* persistent glyph cache, or NULL */
 } gs_lib_ctx_t;
 
 enum {
@@ -217,6 +241,16 @@ gs_lib_ctx_t *gs_lib_ctx_get_interp_instance( const gs_memory_t *mem );
 
 void *gs_lib_ctx_get_cms_context( const gs_memory_t *mem );
 int gs_lib_ctx_get_act_on_uel( const gs_memory_t *mem );
+bool gs_lib_ctx_get_sample_calc_functions( const gs_memory_t *mem );
+void gs_lib_ctx_set_sample_calc_functions( const gs_memory_t *mem, bool sample );
+int gs_lib_ctx_get_shading_threads( const gs_memory_t *mem );
+void gs_lib_ctx_set_shading_threads( const gs_memory_t *mem, int num_threads );
+bool gs_lib_ctx_get_fast_band_list_compression( const gs_memory_t *mem );
+void gs_lib_ctx_set_fast_band_list_compression( const gs_memory_t *mem, bool fast );
+int64_t gs_lib_ctx_get_band_list_compression_threshold( const gs_memory_t *mem );
+void gs_lib_ctx_set_band_list_compression_threshold( const gs_memory_t *mem, int64_t threshold );
+int gs_lib_ctx_get_image_row_cache_size( const gs_memory_t *mem );
+void gs_lib_ctx_set_image_row_cache_size( const gs_memory_t *mem, int size );
 
 int gs_lib_ctx_register_callout(gs_memory_t *mem, gs_callout_fn, void *arg);
 void gs_lib_ctx_deregister_callout(gs_memory_t *mem, gs_callout_fn, void *arg);
@@ -227,6 +261,12 @@ int gs_lib_ctx_nts_adjust(gs_memory_t *mem, int adjust);
 int gs_lib_ctx_set_icc_directory(const gs_memory_t *mem_gc, const char* pname,
                                  int dir_namelen);
 
+/* Sets the file used to keep rendered glyphs between runs, and permits
+ * reading and replacing it. Get returns NULL if there is none.
+ */
+int gs_lib_ctx_set_glyph_cache_file(const gs_memory_t *mem, const char *fname);
+const char *gs_lib_ctx_get_glyph_cache_file(const gs_memory_t *mem);
+
 
 /* Sets/Gets the string containing the list of device names we should search
  * to find a suitable default
@@ -161,6 +161,15 @@ typedef struct chunk_slab_s {
     struct chunk_slab_s *next;
 } chunk_slab_t;
 
+/*
+ * Allocators made by gs_memory_chunk_wrap_thread keep freed large blocks
+ * for reuse rather than returning them to the target. To make a cached
+ * block reusable for requests of similar size, such blocks are rounded up
+ * to one of 4 sizes per power of 2 above the single object threshold.
+ */
+#define LARGE_CLASS_SHIFT 15	/* log2(CHUNK_SIZE>>1) */
+#define NUM_LARGE_CLASSES 64	/* blocks up to 2^(15+16) bytes */
+
 typedef struct gs_memory_chunk_s {
     gs_memory_common;           /* interface outside world sees */
     gs_memory_t *target;        /* base allocator */
@@ -176,6 +185,10 @@ typedef struct gs_memory_chunk_s {
     unsigned int sequence;
 #endif
     int deferring;
+    size_t slab_size;           /* size of slabs taken from the target */
+    size_t cache_limit;         /* max bytes of large blocks to cache, 0 = none */
+    size_t cached;              /* bytes of large blocks in large_cache */
+    chunk_obj_node_t *large_cache[NUM_LARGE_CLASSES]; /* freed large blocks */
 } gs_memory_chunk_t;
 
 #define SIZEOF_ROUND_ALIGN(a) ROUND_UP(sizeof(a), obj_align_mod)
@@ -217,6 +230,10 @@ gs_memory_chunk_wrap(gs_memory_t **wrapped,      /* chunk allocator init */
     cmem->deferring = 0;
     cmem->defer_finalize_list = NULL;
     cmem->defer_free_list = NULL;
+    cmem->slab_size = CHUNK_SIZE;
+    cmem->cache_limit = 0;
+    cmem->cached = 0;
+    memset(cmem->large_cache, 0, sizeof(cmem->large_cache));
 
 #ifdef DEBUG_CHUNK_PRINT
     dmlprintf1(non_gc_target, "New chunk "PRI_INTPTR"\n", (intptr_t)cmem);
@@ -227,6 +244,26 @@ gs_memory_chunk_wrap(gs_memory_t **wrapped,      /* chunk allocator init */
     return 0;
 }
 
+/* Initialize a gs_memory_chunk_t for the exclusive use of one thread */
+int
+gs_memory_chunk_wrap_thread(gs_memory_t **wrapped, gs_memory_t *target,
+                            size_t slab_size, size_t cache_limit)
+{
+    int code = gs_memory_chunk_wrap(wrapped, target);
+    gs_memory_chunk_t *cmem;
+
+    if (code < 0)
+        return code;
+    cmem = (gs_memory_chunk_t *)*wrapped;
+    if (slab_size > CHUNK_SIZE)
+        cmem->slab_size = slab_size;
+#if !defined(MEMENTO) && !defined(SINGLE_OBJECT_MEMORY_BLOCKS_ONLY)
+    /* Those builds want every block to go back to the target when freed */
+    cmem->cache_limit = cache_limit;
+#endif
+    return 0;
+}
+
 /* Release a chunk memory manager. */
 /* Note that this has no effect on the target. */
 void
@@ -270,6 +307,23 @@ gs_memory_chunk_target(const gs_memory_t *mem)
 
 /* Procedures */
 
+/* Return any cached large blocks to the target */
+static void
+chunk_mem_node_free_large_cache(gs_memory_chunk_t *cmem)
+{
+    chunk_obj_node_t *obj, *next;
+    int i;
+
+    for (i = 0; i < NUM_LARGE_CLASSES; i++) {
+        for (obj = cmem->large_cache[i]; obj != NULL; obj = next) {
+            next = obj->defer_next;
+            gs_free_object(cmem->target, obj, "chunk_mem_node_free_large_cache");
+        }
+        cmem->large_cache[i] = NULL;
+    }
+    cmem->cached = 0;
+}
+
 static void
 chunk_mem_node_free_all_slabs(gs_memory_chunk_t *cmem)
 {
@@ -280,6 +334,7 @@ chunk_mem_node_free_all_slabs(gs_memory_chunk_t *cmem)
         next = slab->next;
         gs_free_object(target, slab, "chunk_mem_node_free_all_slabs");
     }
+    chunk_mem_node_free_large_cache(cmem);
 
     cmem->slabs = NULL;
     cmem->free_size = NULL;
@@ -769,6 +824,27 @@ static void remove_free(gs_memory_chunk_t *cmem, chunk_free_node_t *node)
 #define SINGLE_OBJECT_CHUNK(size) ((size) > (CHUNK_SIZE>>1))
 #endif
 
+/* Round a large block size up to its size class, and return the class, */
+/* or -1 if the block is too large to be cached. */
+static int
+chunk_large_class(size_t *psize)
+{
+    size_t size = *psize, step;
+    int b = LARGE_CLASS_SHIFT;
+
+    if (size > ((size_t)1 << (LARGE_CLASS_SHIFT + NUM_LARGE_CLASSES / 4)))
+        return -1;
+    if (size <= ((size_t)1 << b))
+        size = ((size_t)1 << b) + 1;
+    while (((size_t)1 << (b + 1)) < size)
+        b++;
+    /* Now 2^b < size <= 2^(b+1); round up to a multiple of 2^(b-2). */
+    step = (size_t)1 << (b - 2);
+    size = (size + step - 1) & ~(step - 1);
+    *psize = size;
+    return (b - LARGE_CLASS_SHIFT) * 4 + (int)(size >> (b - 2)) - 5;
+}
+
 /* All of the allocation routines reduce to this function */
 static byte *
 chunk_obj_alloc(gs_memory_t *mem, size_t size, gs_memory_type_ptr_t type, client_name_t cname)
@@ -802,11 +878,31 @@ chunk_obj_alloc(gs_memory_t *mem, size_t size, gs_memory_type_ptr_t type, client
 #endif
 #endif
 
-    /* Large blocks are allocated directly */
+    /* Large blocks are allocated directly, or reused from the cache */
     if (SINGLE_OBJECT_CHUNK(size)) {
-        obj = (chunk_obj_node_t *)gs_alloc_bytes_immovable(cmem->target, newsize, cname);
-        if (obj == NULL)
-            return NULL;
+        if (cmem->cache_limit != 0) {
+            size_t class_size = newsize;
+            int c = chunk_large_class(&class_size);
+
+            if (c >= 0) {
+                newsize = class_size;
+                obj = cmem->large_cache[c];
+                if (obj != NULL) {
+                    cmem->large_cache[c] = obj->defer_next;
+                    cmem->cached -= newsize;
+                }
+            }
+        }
+        if (obj == NULL) {
+            obj = (chunk_obj_node_t *)gs_alloc_bytes_immovable(cmem->target, newsize, cname);
+            if (obj == NULL && cmem->cached != 0) {
+                /* The target may be at its limit because of our cache */
+                chunk_mem_node_free_large_cache(cmem);
+                obj = (chunk_obj_node_t *)gs_alloc_bytes_immovable(cmem->target, newsize, cname);
+            }
+            if (obj == NULL)
+                return NULL;
+        }
     } else {
         /* Find the smallest free block that's large enough */
         /* okp points to the parent pointer to the block we pick */
@@ -924,8 +1020,12 @@ chunk_obj_alloc(gs_memory_t *mem, size_t size, gs_memory_type_ptr_t type, client
             uint slab_size = newsize + SIZEOF_ROUND_ALIGN(chunk_slab_t);
 
             if (slab_size <= (CHUNK_SIZE>>1))
-                slab_size = CHUNK_SIZE;
+                slab_size = cmem->slab_size;
             slab = (chunk_slab_t *)gs_alloc_bytes_immovable(cmem->target, slab_size, cname);
+            if (slab == NULL && cmem->cached != 0) {
+                chunk_mem_node_free_large_cache(cmem);
+                slab = (chunk_slab_t *)gs_alloc_bytes_immovable(cmem->target, slab_size, cname);
+            }
             if (slab == NULL)
                 return NULL;
             slab->next = cmem->slabs;
@@ -960,6 +1060,8 @@ chunk_obj_alloc(gs_memory_t *mem, size_t size, gs_memory_type_ptr_t type, client
     }
 
     cmem->used += newsize;
+    if (cmem->used > cmem->max_used)
+        cmem->max_used = cmem->used;
     obj->size = newsize; /* actual size */
     obj->padding = newsize - size; /* actual size - client requested size */
     obj->type = type;    /* and client desired type */
@@ -1119,6 +1221,18 @@ chunk_free_object(gs_memory_t *mem, void *ptr, client_name_t cname)
     cmem->used -= obj->size;
 
     if (SINGLE_OBJECT_CHUNK(obj->size - obj->padding)) {
+        if (cmem->cache_limit != 0 && cmem->cached + obj->size <= cmem->cache_limit) {
+            size_t class_size = obj->size;
+            int c = chunk_large_class(&class_size);
+
+            /* Only blocks that were rounded to their class can be reused */
+            if (c >= 0 && class_size == obj->size) {
+                obj->defer_next = cmem->large_cache[c];
+                cmem->large_cache[c] = obj;
+                cmem->cached += obj->size;
+                return;
+            }
+        }
         gs_free_object(cmem->target, obj, "chunk_free_object(single object)");
 #ifdef DEBUG_CHUNK
         gs_memory_chunk_dump_memory(cmem);
@@ -1421,6 +1535,7 @@ static void chunk_defer_frees(gs_memory_t *mem, int defer)
 static void
 chunk_consolidate_free(gs_memory_t *mem)
 {
+    chunk_mem_node_free_large_cache((gs_memory_chunk_t *)mem);
 }
 
 /* accessors to get size and type given the pointer returned to the client */
@@ -30,6 +30,16 @@
 int gs_memory_chunk_wrap(gs_memory_t **wrapped,	/* chunk allocator init */
                       gs_memory_t * target );	/* base allocator */
 
+/* Initialize a gs_memory_chunk_t for the exclusive use of one thread,  */
+/* such as a rendering thread. It takes slabs of slab_size bytes from    */
+/* the target, and keeps up to cache_limit bytes of freed large blocks   */
+/* for reuse, so that it needs the (locked) target less often. Cached    */
+/* blocks are returned to the target by gs_consolidate_free, or if the   */
+/* target refuses an allocation.                                         */
+        /* -ve error code or 0 */
+int gs_memory_chunk_wrap_thread(gs_memory_t **wrapped, gs_memory_t *target,
+                                size_t slab_size, size_t cache_limit);
+
 /* Release a chunk memory manager and all of the memory it held */
 void gs_memory_chunk_release(gs_memory_t *cmem);
 
@@ -1701,7 +1701,7 @@ gx_pattern_cache_lookup(gx_device_color * pdevc, const gs_gstate * pgs,
         return true;
     }
     if (pcache != 0) {
-        gx_color_tile *ctile = gx_pattern_cache_find_tile_for_id(pcache, id);
+        gx_color_tile *ctile = gx_pattern_cache_lookup_tile(pcache, id);
         bool internal_accum = true;
         if (pgs->have_pattern_streams) {
             int code = dev_proc(dev, dev_spec_op)(dev, gxdso_pattern_load, &id, sizeof(gx_bitmap_id));
@@ -1709,7 +1709,7 @@ gx_pattern_cache_lookup(gx_device_color * pdevc, const gs_gstate * pgs,
             if (code < 0)
                 return false;
         }
-        if (ctile->id == id &&
+        if (ctile != NULL &&
             ctile->is_dummy == !internal_accum
             ) {
             int px = pgs->screen_phase[select].x;
@@ -2319,8 +2319,8 @@ gx_dc_pattern_read(
 
         /* If the pattern tile is already in the cache, make sure it isn't locked */
         /* The lock will be reset below, but the read logic needs to finish loading the pattern. */
-        ptile = &(pgs->pattern_cache->tiles[buf.id % pgs->pattern_cache->num_tiles]);
-        if (ptile->id != gs_no_id && ptile->is_locked) {
+        ptile = gx_pattern_cache_find_tile_for_id(pgs->pattern_cache, buf.id);
+        if (ptile != NULL && ptile->id != gs_no_id && ptile->is_locked) {
             /* we shouldn't have miltiple tiles locked, but check if OK before unlocking */
             if (ptile->id != buf.id)
                 return_error(gs_error_unregistered);	/* can't unlock some other tile in this slot */
@@ -18,6 +18,7 @@
 
 #include "stdint_.h"   /* for tiff.h */
 #include "stdio_.h"
+#include "string_.h"
 #include "time_.h"
 #include "malloc_.h"
 #include "gstypes.h"
@@ -39,6 +40,12 @@ typedef struct tifs_io_private_t
 {
     gp_file *f;
     gs_memory_t *memory;
+    /* When f is NULL, the TIFF is held in this block instead (see
+     * tiff_in_memory). */
+    byte *data;
+    size_t size;                /* allocated */
+    size_t len;                 /* written */
+    size_t pos;
 } tifs_io_private;
 
 /* libtiff i/o hooks */
@@ -68,9 +75,41 @@ gs_tifsReadProc(thandle_t fd, void* buf, size_t size)
     if ((size_t) size_io != size) {
         return (size_t) -1;
     }
+    if (tiffio->f == NULL) {
+        if (tiffio->pos >= tiffio->len)
+            return 0;
+        if (size_io > tiffio->len - tiffio->pos)
+            size_io = tiffio->len - tiffio->pos;
+        memcpy(buf, tiffio->data + tiffio->pos, size_io);
+        tiffio->pos += size_io;
+        return size_io;
+    }
     return((size_t) gp_fread (buf, 1, size_io, tiffio->f));
 }
 
+/* Make room for the memory file to reach 'end' bytes, doubling as we go. */
+static int
+gs_tifsGrowMemory(tifs_io_private *tiffio, size_t end)
+{
+    size_t new_size = tiffio->size ? tiffio->size : 4096;
+    byte *new_data;
+
+    if (end <= tiffio->size)
+        return 0;
+    while (new_size < end)
+        new_size *= 2;
+    new_data = (byte *)gs_malloc(tiffio->memory, new_size, 1, "gs_tifsGrowMemory");
+    if (new_data == NULL)
+        return -1;
+    if (tiffio->data != NULL) {
+        memcpy(new_data, tiffio->data, tiffio->len);
+        gs_free(tiffio->memory, tiffio->data, tiffio->size, 1, "gs_tifsGrowMemory");
+    }
+    tiffio->data = new_data;
+    tiffio->size = new_size;
+    return 0;
+}
+
 static size_t
 gs_tifsWriteProc(thandle_t fd, void* buf, size_t size)
 {
@@ -81,6 +120,18 @@ gs_tifsWriteProc(thandle_t fd, void* buf, size_t size)
     if ((size_t) size_io != size) {
         return (size_t) -1;
     }
+    if (tiffio->f == NULL) {
+        if (gs_tifsGrowMemory(tiffio, tiffio->pos + size_io) < 0)
+            return (size_t) -1;
+        /* Seeking past the end leaves a hole, which reads back as zero. */
+        if (tiffio->pos > tiffio->len)
+            memset(tiffio->data + tiffio->len, 0, tiffio->pos - tiffio->len);
+        memcpy(tiffio->data + tiffio->pos, buf, size_io);
+        tiffio->pos += size_io;
+        if (tiffio->pos > tiffio->len)
+            tiffio->len = tiffio->pos;
+        return size_io;
+    }
     written = (size_t) gp_fwrite (buf, 1, size_io, tiffio->f);
     return written;
 }
@@ -94,6 +145,16 @@ gs_tifsSeekProc(thandle_t fd, uint64_t off, int whence)
     if ((uint64_t) off_io != off) {
         return (uint64_t) -1; /* this is really gross */
     }
+    if (tiffio->f == NULL) {
+        if (whence == SEEK_CUR)
+            off_io += tiffio->pos;
+        else if (whence == SEEK_END)
+            off_io += tiffio->len;
+        if (off_io < 0)
+            return (uint64_t) -1;
+        tiffio->pos = (size_t)off_io;
+        return (uint64_t)tiffio->pos;
+    }
     if (gp_fseek(tiffio->f , (gs_offset_t)off_io, whence) < 0) {
         return (uint64_t) -1;
     }
@@ -108,6 +169,8 @@ gs_tifsCloseProc(thandle_t fd)
     /* We don't close tiffio->f as this will be closed later by the
      * device. */
 
+    if (tiffio->data != NULL)
+        gs_free(tiffio->memory, tiffio->data, tiffio->size, 1, "gs_tifsCloseProc");
     gs_free(tiffio->memory, tiffio, sizeof(tifs_io_private), 1, "gs_tifsCloseProc");
 
     return 0;
@@ -118,8 +181,12 @@ gs_tifsSizeProc(thandle_t fd)
 {
     tifs_io_private *tiffio = (tifs_io_private *)fd;
     uint64_t length;
-    gs_offset_t curpos = gp_ftell(tiffio->f);
+    gs_offset_t curpos;
 
+    if (tiffio->f == NULL)
+        return (uint64_t)tiffio->len;
+
+    curpos = gp_ftell(tiffio->f);
     if (curpos < 0) {
         return(0);
     }
@@ -158,6 +225,7 @@ tiff_from_filep(gx_device_printer *dev,  const char *name, gp_file *filep, int b
     if (!tiffio) {
         return NULL;
     }
+    memset(tiffio, 0, sizeof(*tiffio));
     tiffio->f = filep;
     tiffio->memory = dev->memory;
 
@@ -170,6 +238,41 @@ tiff_from_filep(gx_device_printer *dev,  const char *name, gp_file *filep, int b
     return t;
 }
 
+TIFF *
+tiff_in_memory(gs_memory_t *mem, const char *name, int big_endian)
+{
+    TIFF *t;
+    tifs_io_private *tiffio;
+
+    tiffio = (tifs_io_private *)gs_malloc(mem, sizeof(tifs_io_private), 1, "tiff_in_memory");
+    if (!tiffio) {
+        return NULL;
+    }
+    memset(tiffio, 0, sizeof(*tiffio));
+    tiffio->memory = mem;
+
+    t = TIFFClientOpen(name, big_endian ? "wb" : "wl",
+        (thandle_t) tiffio, (TIFFReadWriteProc)gs_tifsReadProc,
+        (TIFFReadWriteProc)gs_tifsWriteProc, (TIFFSeekProc)gs_tifsSeekProc,
+        gs_tifsCloseProc, (TIFFSizeProc)gs_tifsSizeProc, gs_tifsDummyMapProc,
+        gs_tifsDummyUnmapProc);
+
+    return t;
+}
+
+const byte *
+tiff_memory_data(TIFF *t, size_t *len)
+{
+    tifs_io_private *tiffio = (tifs_io_private *)TIFFClientdata(t);
+
+    if (tiffio->f != NULL) {
+        *len = 0;
+        return NULL;
+    }
+    *len = tiffio->len;
+    return tiffio->data;
+}
+
 int tiff_filename_from_tiff(TIFF *t, char **name)
 {
     *name = (char *)TIFFFileName(t);
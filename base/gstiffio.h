@@ -22,6 +22,15 @@
 
 TIFF *
 tiff_from_filep(gx_device_printer *dev,  const char *name, gp_file *filep, int big_endian, bool usebigtiff);
+/*
+ * Open a TIFF for writing into a private memory block rather than a file.
+ * Used to encode strips away from the main output file; the strips are
+ * then found with TIFFGetStrileOffset/TIFFGetStrileByteCount within the
+ * block returned by tiff_memory_data. TIFFClose frees the block.
+ */
+TIFF *
+tiff_in_memory(gs_memory_t *mem, const char *name, int big_endian);
+const byte *tiff_memory_data(TIFF *t, size_t *len);
 void tiff_set_handlers (void);
 int tiff_filename_from_tiff(TIFF *t, char **name);
 
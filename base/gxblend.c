@@ -26,6 +26,7 @@
 #include "gdevp14.h"
 #include "gsrect.h"		/* for rect_merge */
 #include "math_.h"		/* for ceil, floor */
+#include "gxblsimd.h"
 #ifdef WITH_CAL
 #include "cal.h"
 #endif
@@ -3371,6 +3372,163 @@ compose_group_nonknockout_noblend_general(byte *tos_ptr, bool tos_isolated, int
         backdrop_ptr, has_matte, n_chan, additive, num_spots, overprint, drawn_comps, x0, y0, x1, y1, pblend_procs, pdev, 1);
 }
 
+/* Vectorised versions of the most common of the above. The SIMD kernels
+ * composite as much of each row as they can, and we finish off with the
+ * scalar code (which they match exactly). */
+static void
+compose_group_nonknockout_nonblend_isolated_allmask_simd(byte *tos_ptr, bool tos_isolated, int tos_planestride, int tos_rowstride, byte alpha, byte shape, gs_blend_mode_t blend_mode, bool tos_has_shape,
+              int tos_shape_offset, int tos_alpha_g_offset, int tos_tag_offset, bool tos_has_tag, byte *tos_alpha_g_ptr,
+              byte *nos_ptr, bool nos_isolated, int nos_planestride, int nos_rowstride, byte *nos_alpha_g_ptr, bool nos_knockout,
+              int nos_shape_offset, int nos_tag_offset,
+              byte *mask_row_ptr, int has_mask, pdf14_buf *maskbuf, byte mask_bg_alpha, const byte *mask_tr_fn,
+              byte *backdrop_ptr,
+              bool has_matte, int n_chan, bool additive, int num_spots, bool overprint, gx_color_index drawn_comps, int x0, int y0, int x1, int y1,
+              const pdf14_nonseparable_blending_procs_t *pblend_procs, pdf14_device *pdev)
+{
+    const gx_blend_simd_procs_t *simd = gx_blend_simd_procs();
+    int width = x1 - x0;
+    int y, done;
+
+    for (y = y0; y < y1; y++) {
+        done = simd->compose_isolated(tos_ptr, tos_planestride, nos_ptr, nos_planestride,
+                                      mask_row_ptr, true, n_chan, width, alpha, true);
+        if (done < width)
+            compose_group_nonknockout_nonblend_isolated_allmask_common(tos_ptr + done, tos_isolated, tos_planestride, tos_rowstride, alpha, shape, blend_mode, tos_has_shape,
+                tos_shape_offset, tos_alpha_g_offset, tos_tag_offset, tos_has_tag, tos_alpha_g_ptr,
+                nos_ptr + done, nos_isolated, nos_planestride, nos_rowstride, nos_alpha_g_ptr, nos_knockout,
+                nos_shape_offset, nos_tag_offset, mask_row_ptr + done, has_mask, maskbuf, mask_bg_alpha, mask_tr_fn,
+                backdrop_ptr, has_matte, n_chan, additive, num_spots, overprint, drawn_comps, x0 + done, y, x1, y + 1, pblend_procs, pdev);
+        tos_ptr += tos_rowstride;
+        nos_ptr += nos_rowstride;
+        mask_row_ptr += maskbuf->rowstride;
+    }
+}
+
+static void
+compose_group_nonknockout_nonblend_isolated_nomask_simd(byte *tos_ptr, bool tos_isolated, int tos_planestride, int tos_rowstride, byte alpha, byte shape, gs_blend_mode_t blend_mode, bool tos_has_shape,
+              int tos_shape_offset, int tos_alpha_g_offset, int tos_tag_offset, bool tos_has_tag, byte *tos_alpha_g_ptr,
+              byte *nos_ptr, bool nos_isolated, int nos_planestride, int nos_rowstride, byte *nos_alpha_g_ptr, bool nos_knockout,
+              int nos_shape_offset, int nos_tag_offset,
+              byte *mask_row_ptr, int has_mask, pdf14_buf *maskbuf, byte mask_bg_alpha, const byte *mask_tr_fn,
+              byte *backdrop_ptr,
+              bool has_matte, int n_chan, bool additive, int num_spots, bool overprint, gx_color_index drawn_comps, int x0, int y0, int x1, int y1,
+              const pdf14_nonseparable_blending_procs_t *pblend_procs, pdf14_device *pdev)
+{
+    const gx_blend_simd_procs_t *simd = gx_blend_simd_procs();
+    int width = x1 - x0;
+    int y, done;
+
+    for (y = y0; y < y1; y++) {
+        done = simd->compose_isolated(tos_ptr, tos_planestride, nos_ptr, nos_planestride,
+                                      NULL, false, n_chan, width, alpha, true);
+        if (done < width)
+            compose_group_nonknockout_nonblend_isolated_nomask_common(tos_ptr + done, tos_isolated, tos_planestride, tos_rowstride, alpha, shape, blend_mode, tos_has_shape,
+                tos_shape_offset, tos_alpha_g_offset, tos_tag_offset, tos_has_tag, tos_alpha_g_ptr,
+                nos_ptr + done, nos_isolated, nos_planestride, nos_rowstride, nos_alpha_g_ptr, nos_knockout,
+                nos_shape_offset, nos_tag_offset, mask_row_ptr, has_mask, maskbuf, mask_bg_alpha, mask_tr_fn,
+                backdrop_ptr, has_matte, n_chan, additive, num_spots, overprint, drawn_comps, x0 + done, y, x1, y + 1, pblend_procs, pdev);
+        tos_ptr += tos_rowstride;
+        nos_ptr += nos_rowstride;
+    }
+}
+
+static void
+compose_group_nonknockout_nonblend_nonisolated_nomask_simd(byte *tos_ptr, bool tos_isolated, int tos_planestride, int tos_rowstride, byte alpha, byte shape, gs_blend_mode_t blend_mode, bool tos_has_shape,
+              int tos_shape_offset, int tos_alpha_g_offset, int tos_tag_offset, bool tos_has_tag, byte *tos_alpha_g_ptr,
+              byte *nos_ptr, bool nos_isolated, int nos_planestride, int nos_rowstride, byte *nos_alpha_g_ptr, bool nos_knockout,
+              int nos_shape_offset, int nos_tag_offset,
+              byte *mask_row_ptr, int has_mask, pdf14_buf *maskbuf, byte mask_bg_alpha, const byte *mask_tr_fn,
+              byte *backdrop_ptr,
+              bool has_matte, int n_chan, bool additive, int num_spots, bool overprint, gx_color_index drawn_comps, int x0, int y0, int x1, int y1,
+              const pdf14_nonseparable_blending_procs_t *pblend_procs, pdf14_device *pdev)
+{
+    const gx_blend_simd_procs_t *simd = gx_blend_simd_procs();
+    int width = x1 - x0;
+    int y, done;
+
+    for (y = y0; y < y1; y++) {
+        done = simd->compose_nonisolated(tos_ptr, tos_planestride, tos_alpha_g_offset,
+                                         nos_ptr, nos_planestride, n_chan, width, alpha, true);
+        if (done < width)
+            compose_group_nonknockout_nonblend_nonisolated_nomask_common(tos_ptr + done, tos_isolated, tos_planestride, tos_rowstride, alpha, shape, blend_mode, tos_has_shape,
+                tos_shape_offset, tos_alpha_g_offset, tos_tag_offset, tos_has_tag, tos_alpha_g_ptr,
+                nos_ptr + done, nos_isolated, nos_planestride, nos_rowstride, nos_alpha_g_ptr, nos_knockout,
+                nos_shape_offset, nos_tag_offset, mask_row_ptr, has_mask, maskbuf, mask_bg_alpha, mask_tr_fn,
+                backdrop_ptr, has_matte, n_chan, additive, num_spots, overprint, drawn_comps, x0 + done, y, x1, y + 1, pblend_procs, pdev);
+        tos_ptr += tos_rowstride;
+        nos_ptr += nos_rowstride;
+    }
+}
+
+static void
+compose_group_nonknockout_blend_isolated_nomask_simd(byte *tos_ptr, bool tos_isolated, int tos_planestride, int tos_rowstride, byte alpha, byte shape, gs_blend_mode_t blend_mode, bool tos_has_shape,
+              int tos_shape_offset, int tos_alpha_g_offset, int tos_tag_offset, bool tos_has_tag, byte *tos_alpha_g_ptr,
+              byte *nos_ptr, bool nos_isolated, int nos_planestride, int nos_rowstride, byte *nos_alpha_g_ptr, bool nos_knockout,
+              int nos_shape_offset, int nos_tag_offset,
+              byte *mask_row_ptr, int has_mask, pdf14_buf *maskbuf, byte mask_bg_alpha, const byte *mask_tr_fn,
+              byte *backdrop_ptr,
+              bool has_matte, int n_chan, bool additive, int num_spots, bool overprint, gx_color_index drawn_comps, int x0, int y0, int x1, int y1,
+              const pdf14_nonseparable_blending_procs_t *pblend_procs, pdf14_device *pdev)
+{
+    const gx_blend_simd_procs_t *simd = gx_blend_simd_procs();
+    int width = x1 - x0;
+    int y, done;
+
+    for (y = y0; y < y1; y++) {
+        done = simd->blend_isolated(tos_ptr, tos_planestride, nos_ptr, nos_planestride,
+                                    n_chan, width, alpha, blend_mode, additive);
+        if (done < width)
+            compose_group_nonknockout_blend(tos_ptr + done, tos_isolated, tos_planestride, tos_rowstride, alpha, shape, blend_mode, tos_has_shape,
+                tos_shape_offset, tos_alpha_g_offset, tos_tag_offset, tos_has_tag, tos_alpha_g_ptr,
+                nos_ptr + done, nos_isolated, nos_planestride, nos_rowstride, nos_alpha_g_ptr, nos_knockout,
+                nos_shape_offset, nos_tag_offset, mask_row_ptr, has_mask, maskbuf, mask_bg_alpha, mask_tr_fn,
+                backdrop_ptr, has_matte, n_chan, additive, num_spots, overprint, drawn_comps, x0 + done, y, x1, y + 1, pblend_procs, pdev);
+        tos_ptr += tos_rowstride;
+        nos_ptr += nos_rowstride;
+    }
+}
+
+/* As compose_group_nonknockout_noblend_general, for the cases that the
+ * _common functions above do not cover but the SIMD kernels can: these
+ * follow template_compose_group exactly, including for subtractive spaces.
+ * Outside the soft mask (has_mask false, maskbuf non-NULL) the group alpha
+ * is simply mask_bg_alpha; otherwise the mask covers the whole area. */
+static void
+compose_group_nonknockout_noblend_general_simd(byte *tos_ptr, bool tos_isolated, int tos_planestride, int tos_rowstride, byte alpha, byte shape, gs_blend_mode_t blend_mode, bool tos_has_shape,
+              int tos_shape_offset, int tos_alpha_g_offset, int tos_tag_offset, bool tos_has_tag, byte *tos_alpha_g_ptr,
+              byte *nos_ptr, bool nos_isolated, int nos_planestride, int nos_rowstride, byte *nos_alpha_g_ptr, bool nos_knockout,
+              int nos_shape_offset, int nos_tag_offset,
+              byte *mask_row_ptr, int has_mask, pdf14_buf *maskbuf, byte mask_bg_alpha, const byte *mask_tr_fn,
+              byte *backdrop_ptr,
+              bool has_matte, int n_chan, bool additive, int num_spots, bool overprint, gx_color_index drawn_comps, int x0, int y0, int x1, int y1,
+              const pdf14_nonseparable_blending_procs_t *pblend_procs, pdf14_device *pdev)
+{
+    const gx_blend_simd_procs_t *simd = gx_blend_simd_procs();
+    int width = x1 - x0;
+    int y, done;
+
+    if (maskbuf != NULL && !has_mask)
+        alpha = mask_bg_alpha;
+    for (y = y0; y < y1; y++) {
+        if (tos_isolated)
+            done = simd->compose_isolated(tos_ptr, tos_planestride, nos_ptr, nos_planestride,
+                                          mask_row_ptr, false, n_chan, width, alpha, additive);
+        else
+            done = simd->compose_nonisolated(tos_ptr, tos_planestride, tos_alpha_g_offset,
+                                             nos_ptr, nos_planestride, n_chan, width, alpha, additive);
+        if (done < width)
+            compose_group_nonknockout_noblend_general(tos_ptr + done, tos_isolated, tos_planestride, tos_rowstride, alpha, shape, blend_mode, tos_has_shape,
+                tos_shape_offset, tos_alpha_g_offset, tos_tag_offset, tos_has_tag, tos_alpha_g_ptr,
+                nos_ptr + done, nos_isolated, nos_planestride, nos_rowstride, nos_alpha_g_ptr, nos_knockout,
+                nos_shape_offset, nos_tag_offset, mask_row_ptr == NULL ? NULL : mask_row_ptr + done, has_mask, maskbuf, mask_bg_alpha, mask_tr_fn,
+                backdrop_ptr, has_matte, n_chan, additive, num_spots, overprint, drawn_comps, x0 + done, y, x1, y + 1, pblend_procs, pdev);
+        tos_ptr += tos_rowstride;
+        nos_ptr += nos_rowstride;
+        if (mask_row_ptr != NULL)
+            mask_row_ptr += maskbuf->rowstride;
+    }
+}
+
 static void
 compose_group_alphaless_knockout(byte *tos_ptr, bool tos_isolated, int tos_planestride, int tos_rowstride, byte alpha, byte shape, gs_blend_mode_t blend_mode, bool tos_has_shape,
               int tos_shape_offset, int tos_alpha_g_offset, int tos_tag_offset, bool tos_has_tag, byte *tos_alpha_g_ptr,
@@ -3448,6 +3606,8 @@ do_compose_group(pdf14_buf *tos, pdf14_buf *nos, pdf14_buf *maskbuf,
     int width = x1 - x0;
 #endif
     art_pdf_compose_group_fn fn;
+    const gx_blend_simd_procs_t *simd;
+    bool simple;
 
     if ((tos->n_chan == 0) || (nos->n_chan == 0))
         return;
@@ -3547,15 +3707,24 @@ do_compose_group(pdf14_buf *tos, pdf14_buf *nos, pdf14_buf *maskbuf,
     }
 #endif
 
+    /* Groups needing none of the shape, tag, alpha_g, backdrop, matte, spot
+     * or overprint handling. (Neither nos_isolated nor the tos alpha_g plane
+     * matter for non-knockout groups without a backdrop.) */
+    simple = (tos->has_shape == 0 && tos_has_tag == 0 && nos_alpha_g_ptr == NULL &&
+              nos_shape_offset == 0 && nos_tag_offset == 0 && backdrop_ptr == NULL && has_matte == 0 && num_spots == 0 &&
+              overprint == 0);
+    simd = gx_blend_simd_procs();
+
     /* We have tested the files on the cluster to see what percentage of
      * files/devices hit the different options. */
     if (nos_knockout)
         fn = &compose_group_knockout; /* Small %ages, nothing more than 1.1% */
-    else if (blend_mode != 0)
+    else if (blend_mode != 0) {
         fn = &compose_group_nonknockout_blend; /* Small %ages, nothing more than 2% */
-    else if (tos->has_shape == 0 && tos_has_tag == 0 && nos_isolated == 0 && nos_alpha_g_ptr == NULL &&
-             nos_shape_offset == 0 && nos_tag_offset == 0 && backdrop_ptr == NULL && has_matte == 0 && num_spots == 0 &&
-             overprint == 0 && tos_alpha_g_ptr == NULL) {
+        if (simd != NULL && simple && tos_isolated && !has_mask && maskbuf == NULL &&
+            (blend_mode == BLEND_MODE_Multiply || blend_mode == BLEND_MODE_Screen))
+            fn = &compose_group_nonknockout_blend_isolated_nomask_simd;
+    } else if (simple && nos_isolated == 0 && tos_alpha_g_ptr == NULL) {
              /* Additive vs Subtractive makes no difference in normal blend mode with no spots */
         if (tos_isolated) {
             if (has_mask && maskbuf) {/* 7% */
@@ -3572,6 +3741,8 @@ do_compose_group(pdf14_buf *tos, pdf14_buf *nos, pdf14_buf *maskbuf,
 					 (cal_composer_proc_t *)fn,
 					 tos->n_chan-1);
 #endif
+                        if (fn == compose_group_nonknockout_nonblend_isolated_allmask_common && simd != NULL)
+                            fn = compose_group_nonknockout_nonblend_isolated_allmask_simd;
                     } else {
                         fn = compose_group_nonknockout_nonblend_isolated_allmask_common;
                     }
@@ -3581,15 +3752,24 @@ do_compose_group(pdf14_buf *tos, pdf14_buf *nos, pdf14_buf *maskbuf,
                 if (maskbuf) {
                     /* Outside mask */
                     fn = &compose_group_nonknockout_nonblend_isolated_mask_common;
-                } else
+                } else if (simd != NULL)
+                    fn = &compose_group_nonknockout_nonblend_isolated_nomask_simd;
+                else
                     fn = &compose_group_nonknockout_nonblend_isolated_nomask_common;
         } else {
             if (has_mask || maskbuf) /* 4% */
                 fn = &compose_group_nonknockout_nonblend_nonisolated_mask_common;
-            else /* 15% */
+            else if (simd != NULL) /* 15% */
+                fn = &compose_group_nonknockout_nonblend_nonisolated_nomask_simd;
+            else
                 fn = &compose_group_nonknockout_nonblend_nonisolated_nomask_common;
         }
-    } else
+    } else if (simd != NULL && simple &&
+               (!has_mask || (tos_isolated && is_ident &&
+                              maskbuf->rect.p.x <= x0 && maskbuf->rect.p.y <= y0 &&
+                              maskbuf->rect.q.x >= x1 && maskbuf->rect.q.y >= y1)))
+        fn = compose_group_nonknockout_noblend_general_simd;
+    else
         fn = compose_group_nonknockout_noblend_general;
 
     fn(tos_ptr, tos_isolated, tos_planestride, tos->rowstride, alpha, shape,
@@ -0,0 +1,179 @@
+/* Copyright (C) 2001-2023 Artifex Software, Inc.
+   All Rights Reserved.
+
+   This software is provided AS-IS with no warranty, either express or
+   implied.
+
+   This software is distributed under license and may not be copied,
+   modified or distributed except as expressly authorized under the terms
+   of the license contained in the file LICENSE in this distribution.
+
+   Refer to licensing information at http://www.artifex.com or contact
+   Artifex Software, Inc.,  1305 Grant Avenue - Suite 200, Novato,
+   CA 94945, U.S.A., +1(415)492-9861, for further information.
+*/
+
+/* Vectorised row kernels for the common PDF 1.4 group compositions */
+
+#include "std.h"
+#include "gxblsimd.h"
+
+/*
+ * As with CAL, we build every core the compiler understands and choose
+ * between them at run time, so a single binary runs everywhere. Each core
+ * is compiled with just the machine flags it needs by way of function
+ * target attributes, which saves per-file compiler flags in the makefiles.
+ * Define GS_NO_BLEND_SIMD to leave the scalar code in sole charge.
+ */
+#if !defined(GS_NO_BLEND_SIMD) && defined(__GNUC__) &&\
+    (defined(__x86_64__) || defined(__i386__)) &&\
+    (defined(__clang__) || __GNUC__ > 4 || (__GNUC__ == 4 && __GNUC_MINOR__ >= 9))
+#  define BLEND_SIMD_X86
+#endif
+
+#ifdef BLEND_SIMD_X86
+
+#include <immintrin.h>
+
+/* ---------------- AVX2: 8 pixels at a time ---------------- */
+
+#define AVX2_TARGET __attribute__((target("avx2")))
+
+static AVX2_TARGET forceinline __m256i
+avx2_load(const byte *p)
+{
+    return _mm256_cvtepu8_epi32(_mm_loadl_epi64((const __m128i *)p));
+}
+
+static AVX2_TARGET forceinline void
+avx2_store(byte *p, __m256i v)
+{
+    __m128i w = _mm_packus_epi32(_mm256_castsi256_si128(v),
+                                 _mm256_extracti128_si256(v, 1));
+
+    _mm_storel_epi64((__m128i *)p, _mm_packus_epi16(w, w));
+}
+
+/* The dividends are below 2^25, so double division truncates exactly. */
+static AVX2_TARGET forceinline __m256i
+avx2_div(__m256i n, __m256i d)
+{
+    __m128i lo = _mm256_cvttpd_epi32(
+                    _mm256_div_pd(_mm256_cvtepi32_pd(_mm256_castsi256_si128(n)),
+                                  _mm256_cvtepi32_pd(_mm256_castsi256_si128(d))));
+    __m128i hi = _mm256_cvttpd_epi32(
+                    _mm256_div_pd(_mm256_cvtepi32_pd(_mm256_extracti128_si256(n, 1)),
+                                  _mm256_cvtepi32_pd(_mm256_extracti128_si256(d, 1))));
+
+    return _mm256_inserti128_si256(_mm256_castsi128_si256(lo), hi, 1);
+}
+
+#define TEMPLATE_NAME(n) avx2_##n
+#define V_TARGET AVX2_TARGET
+#define VEC __m256i
+#define VN 8
+#define V_LOAD(p) avx2_load(p)
+#define V_STORE(p, v) avx2_store(p, v)
+#define V_SET1(x) _mm256_set1_epi32(x)
+#define V_ADD(a, b) _mm256_add_epi32(a, b)
+#define V_SUB(a, b) _mm256_sub_epi32(a, b)
+#define V_MUL(a, b) _mm256_mullo_epi32(a, b)
+#define V_SLL(a, n) _mm256_slli_epi32(a, n)
+#define V_SRL(a, n) _mm256_srli_epi32(a, n)
+#define V_SRA(a, n) _mm256_srai_epi32(a, n)
+#define V_OR(a, b) _mm256_or_si256(a, b)
+#define V_XOR(a, b) _mm256_xor_si256(a, b)
+#define V_EQ(a, b) _mm256_cmpeq_epi32(a, b)
+#define V_MIN(a, b) _mm256_min_epi32(a, b)
+#define V_MAX(a, b) _mm256_max_epi32(a, b)
+#define V_SEL(a, b, m) _mm256_blendv_epi8(a, b, m)
+#define V_ALL(m) (_mm256_movemask_epi8(m) == -1)
+#define V_DIV(n, d) avx2_div(n, d)
+#include "gxblsimdt.h"
+
+static const gx_blend_simd_procs_t avx2_procs = {
+    "avx2",
+    avx2_compose_isolated,
+    avx2_compose_nonisolated,
+    avx2_blend_isolated
+};
+
+/* ---------------- SSE4.1: 4 pixels at a time ---------------- */
+
+#define SSE41_TARGET __attribute__((target("sse4.1")))
+
+/* We build with -fno-builtin, so avoid memcpy for these 4 byte moves. */
+static SSE41_TARGET forceinline __m128i
+sse41_load(const byte *p)
+{
+    uint v = p[0] | (p[1] << 8) | (p[2] << 16) | ((uint)p[3] << 24);
+
+    return _mm_cvtepu8_epi32(_mm_cvtsi32_si128((int)v));
+}
+
+static SSE41_TARGET forceinline void
+sse41_store(byte *p, __m128i v)
+{
+    __m128i w = _mm_packus_epi32(v, v);
+    uint r = (uint)_mm_cvtsi128_si32(_mm_packus_epi16(w, w));
+
+    p[0] = (byte)r;
+    p[1] = (byte)(r >> 8);
+    p[2] = (byte)(r >> 16);
+    p[3] = (byte)(r >> 24);
+}
+
+static SSE41_TARGET forceinline __m128i
+sse41_div(__m128i n, __m128i d)
+{
+    __m128i lo = _mm_cvttpd_epi32(_mm_div_pd(_mm_cvtepi32_pd(n),
+                                             _mm_cvtepi32_pd(d)));
+    __m128i hi = _mm_cvttpd_epi32(_mm_div_pd(_mm_cvtepi32_pd(_mm_srli_si128(n, 8)),
+                                             _mm_cvtepi32_pd(_mm_srli_si128(d, 8))));
+
+    return _mm_unpacklo_epi64(lo, hi);
+}
+
+#define TEMPLATE_NAME(n) sse41_##n
+#define V_TARGET SSE41_TARGET
+#define VEC __m128i
+#define VN 4
+#define V_LOAD(p) sse41_load(p)
+#define V_STORE(p, v) sse41_store(p, v)
+#define V_SET1(x) _mm_set1_epi32(x)
+#define V_ADD(a, b) _mm_add_epi32(a, b)
+#define V_SUB(a, b) _mm_sub_epi32(a, b)
+#define V_MUL(a, b) _mm_mullo_epi32(a, b)
+#define V_SLL(a, n) _mm_slli_epi32(a, n)
+#define V_SRL(a, n) _mm_srli_epi32(a, n)
+#define V_SRA(a, n) _mm_srai_epi32(a, n)
+#define V_OR(a, b) _mm_or_si128(a, b)
+#define V_XOR(a, b) _mm_xor_si128(a, b)
+#define V_EQ(a, b) _mm_cmpeq_epi32(a, b)
+#define V_MIN(a, b) _mm_min_epi32(a, b)
+#define V_MAX(a, b) _mm_max_epi32(a, b)
+#define V_SEL(a, b, m) _mm_blendv_epi8(a, b, m)
+#define V_ALL(m) (_mm_movemask_epi8(m) == 0xffff)
+#define V_DIV(n, d) sse41_div(n, d)
+#include "gxblsimdt.h"
+
+static const gx_blend_simd_procs_t sse41_procs = {
+    "sse4.1",
+    sse41_compose_isolated,
+    sse41_compose_nonisolated,
+    sse41_blend_isolated
+};
+
+#endif /* BLEND_SIMD_X86 */
+
+const gx_blend_simd_procs_t *
+gx_blend_simd_procs(void)
+{
+#ifdef BLEND_SIMD_X86
+    if (__builtin_cpu_supports("avx2"))
+        return &avx2_procs;
+    if (__builtin_cpu_supports("sse4.1"))
+        return &sse41_procs;
+#endif
+    return NULL;
+}
@@ -0,0 +1,64 @@
+/* Copyright (C) 2001-2023 Artifex Software, Inc.
+   All Rights Reserved.
+
+   This software is provided AS-IS with no warranty, either express or
+   implied.
+
+   This software is distributed under license and may not be copied,
+   modified or distributed except as expressly authorized under the terms
+   of the license contained in the file LICENSE in this distribution.
+
+   Refer to licensing information at http://www.artifex.com or contact
+   Artifex Software, Inc.,  1305 Grant Avenue - Suite 200, Novato,
+   CA 94945, U.S.A., +1(415)492-9861, for further information.
+*/
+
+/* Vectorised row kernels for the common PDF 1.4 group compositions */
+
+#ifndef gxblsimd_INCLUDED
+#  define gxblsimd_INCLUDED
+
+#include "stdpre.h"
+#include "gstparam.h"
+
+/*
+ * These kernels work on a single row of 8 bit planar pdf14 buffers, with
+ * the alpha plane immediately after the n_chan colour planes. Each returns
+ * the number of leading pixels it has composited (always a multiple of the
+ * vector width); the caller finishes the row with the scalar code in
+ * gxblend.c, which remains the reference implementation. Results are bit
+ * for bit identical to that scalar code.
+ *
+ * Subtractive colorants are complemented on the way in and out when
+ * !additive, as template_compose_group does.
+ *
+ * compose_isolated: Normal blend of an isolated group with constant group
+ *   alpha. If mask_ptr is non-NULL it points to an identity-mapped soft mask
+ *   row which is multiplied into alpha. allmask selects the handling of
+ *   compose_group_nonknockout_nonblend_isolated_allmask_common for pixels
+ *   that the mask makes fully transparent.
+ * compose_nonisolated: Normal blend of a non-isolated group, whose group
+ *   alpha is found at tos_alpha_g_offset.
+ * blend_isolated: Multiply or Screen blend of an isolated group.
+ */
+typedef struct gx_blend_simd_procs_s {
+    const char *name;
+    int (*compose_isolated)(byte *gs_restrict tos_ptr, int tos_planestride,
+                            byte *gs_restrict nos_ptr, int nos_planestride,
+                            const byte *gs_restrict mask_ptr, bool allmask,
+                            int n_chan, int width, byte alpha, bool additive);
+    int (*compose_nonisolated)(byte *gs_restrict tos_ptr, int tos_planestride,
+                               int tos_alpha_g_offset,
+                               byte *gs_restrict nos_ptr, int nos_planestride,
+                               int n_chan, int width, byte alpha, bool additive);
+    int (*blend_isolated)(byte *gs_restrict tos_ptr, int tos_planestride,
+                          byte *gs_restrict nos_ptr, int nos_planestride,
+                          int n_chan, int width, byte alpha,
+                          gs_blend_mode_t blend_mode, bool additive);
+} gx_blend_simd_procs_t;
+
+/* Return the best kernels the running CPU supports, or NULL if there are
+ * none (in which case the scalar code should be used throughout). */
+const gx_blend_simd_procs_t *gx_blend_simd_procs(void);
+
+#endif /* gxblsimd_INCLUDED */
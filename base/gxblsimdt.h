@@ -0,0 +1,267 @@
+/* Copyright (C) 2001-2023 Artifex Software, Inc.
+   All Rights Reserved.
+
+   This software is provided AS-IS with no warranty, either express or
+   implied.
+
+   This software is distributed under license and may not be copied,
+   modified or distributed except as expressly authorized under the terms
+   of the license contained in the file LICENSE in this distribution.
+
+   Refer to licensing information at http://www.artifex.com or contact
+   Artifex Software, Inc.,  1305 Grant Avenue - Suite 200, Novato,
+   CA 94945, U.S.A., +1(415)492-9861, for further information.
+*/
+
+
+/* This file is repeatedly included by gxblsimd.c to 'autogenerate' the
+ * compositing kernels for each instruction set. DO NOT USE THIS FILE
+ * EXCEPT FROM gxblsimd.c.
+ */
+
+/* Set the following defines on entry:
+ *   TEMPLATE_NAME(n) Compulsory  Makes the name of a generated function.
+ *   V_TARGET         Compulsory  Function attributes enabling the ISA.
+ *   VEC, VN          Compulsory  A vector of VN 32 bit ints, and VN.
+ *   V_LOAD(p)        Compulsory  Load VN bytes from p, zero extended.
+ *   V_STORE(p, v)    Compulsory  Store the low byte of each lane to p.
+ *   V_SET1(x), V_ADD, V_SUB, V_MUL, V_SLL, V_SRL, V_SRA, V_OR, V_XOR,
+ *   V_EQ, V_MIN, V_MAX
+ *                    Compulsory  The obvious 32 bit lane operations; V_EQ
+ *                                gives all ones in lanes that compare equal.
+ *   V_SEL(a, b, m)   Compulsory  b in lanes where m is set, otherwise a.
+ *   V_ALL(m)         Compulsory  True iff every lane of m is set.
+ *   V_DIV(n, d)      Compulsory  n / d for non-negative n and positive d,
+ *                                truncated exactly as C integer division.
+ *
+ * The arithmetic mirrors the scalar code in gxblend.c step for step; see
+ * art_pdf_composite_pixel_alpha_8_inline and friends there.
+ */
+
+#if defined(TEMPLATE_NAME)
+
+/* (a * b) / 255, rounded, for a, b in 0..255. */
+static V_TARGET forceinline VEC
+TEMPLATE_NAME(mul8)(VEC a, VEC b)
+{
+    VEC tmp = V_ADD(V_MUL(a, b), V_SET1(0x80));
+
+    return V_SRL(V_ADD(tmp, V_SRL(tmp, 8)), 8);
+}
+
+/* a_s / a_r in 16.16 format, as used to mix source over backdrop. */
+static V_TARGET forceinline VEC
+TEMPLATE_NAME(src_scale)(VEC a_s, VEC a_r)
+{
+    return V_DIV(V_ADD(V_SLL(a_s, 16), V_SRL(a_r, 1)),
+                 V_MAX(a_r, V_SET1(1)));
+}
+
+static V_TARGET int
+TEMPLATE_NAME(compose_isolated)(byte *gs_restrict tos_ptr, int tos_planestride,
+                                byte *gs_restrict nos_ptr, int nos_planestride,
+                                const byte *gs_restrict mask_ptr, bool allmask,
+                                int n_chan, int width, byte alpha, bool additive)
+{
+    const VEC zero = V_SET1(0);
+    const VEC ff = V_SET1(0xff);
+    const VEC round16 = V_SET1(0x8000);
+    const VEC valpha = V_SET1(alpha);
+    /* Subtractive colorants are complemented by XOR with 0xff */
+    const VEC comp = V_SET1(additive ? 0 : 0xff);
+    int tos_alpha_offset = n_chan * tos_planestride;
+    int nos_alpha_offset = n_chan * nos_planestride;
+    int x, i;
+
+    for (x = 0; x + VN <= width; x += VN, tos_ptr += VN, nos_ptr += VN) {
+        VEC a_s, a_b, a_r, src_scale, skip, copy;
+        VEC src_alpha = V_LOAD(tos_ptr + tos_alpha_offset);
+
+        if (mask_ptr != NULL) {
+            VEC pix_alpha = V_LOAD(mask_ptr);
+
+            mask_ptr += VN;
+            pix_alpha = TEMPLATE_NAME(mul8)(valpha, pix_alpha);
+            a_s = TEMPLATE_NAME(mul8)(src_alpha, pix_alpha);
+        } else
+            a_s = TEMPLATE_NAME(mul8)(src_alpha, valpha);
+        /* Pixels whose alpha comes out as zero are untouched, except that
+           in the allmask case a soft mask reducing alpha to zero still
+           copies onto an empty backdrop. */
+        skip = V_EQ(allmask ? src_alpha : a_s, zero);
+        if (V_ALL(skip))
+            continue;
+
+        a_b = V_LOAD(nos_ptr + nos_alpha_offset);
+        copy = V_EQ(a_b, zero);
+        /* Result alpha is Union of backdrop and source alpha */
+        a_r = V_SUB(ff, TEMPLATE_NAME(mul8)(V_SUB(ff, a_b), V_SUB(ff, a_s)));
+        src_scale = TEMPLATE_NAME(src_scale)(a_s, a_r);
+
+        for (i = 0; i < n_chan; i++) {
+            VEC c_s = V_XOR(V_LOAD(tos_ptr + i * tos_planestride), comp);
+            VEC c_b = V_XOR(V_LOAD(nos_ptr + i * nos_planestride), comp);
+            VEC tmp = V_ADD(V_MUL(src_scale, V_SUB(c_s, c_b)), round16);
+            VEC c_r = V_ADD(c_b, V_SRA(tmp, 16));
+
+            c_r = V_SEL(c_r, c_s, copy);
+            c_r = V_SEL(c_r, c_b, skip);
+            V_STORE(nos_ptr + i * nos_planestride, V_XOR(c_r, comp));
+        }
+        a_r = V_SEL(a_r, a_s, copy);
+        V_STORE(nos_ptr + nos_alpha_offset, V_SEL(a_r, a_b, skip));
+    }
+    return x;
+}
+
+static V_TARGET int
+TEMPLATE_NAME(compose_nonisolated)(byte *gs_restrict tos_ptr, int tos_planestride,
+                                   int tos_alpha_g_offset,
+                                   byte *gs_restrict nos_ptr, int nos_planestride,
+                                   int n_chan, int width, byte alpha, bool additive)
+{
+    const VEC zero = V_SET1(0);
+    const VEC ff = V_SET1(0xff);
+    const VEC round8 = V_SET1(0x80);
+    const VEC round16 = V_SET1(0x8000);
+    const VEC valpha = V_SET1(alpha);
+    const VEC comp = V_SET1(additive ? 0 : 0xff);
+    int nos_alpha_offset = n_chan * nos_planestride;
+    int x, i;
+
+    for (x = 0; x + VN <= width; x += VN, tos_ptr += VN, nos_ptr += VN) {
+        VEC a_s, a_b, a_r, src_scale, skip, copy, keep, scale;
+        VEC alpha_g = V_LOAD(tos_ptr + tos_alpha_g_offset);
+
+        skip = V_EQ(alpha_g, zero);
+        if (V_ALL(skip))
+            continue;
+
+        if (alpha == 255) {
+            /* Uncompositing and recompositing cancel each other out, so
+               the group simply replaces the backdrop. */
+            for (i = 0; i <= n_chan; i++) {
+                VEC c_s = V_LOAD(tos_ptr + i * tos_planestride);
+                VEC c_b = V_LOAD(nos_ptr + i * nos_planestride);
+
+                V_STORE(nos_ptr + i * nos_planestride, V_SEL(c_s, c_b, skip));
+            }
+            continue;
+        }
+
+        a_b = V_LOAD(nos_ptr + nos_alpha_offset);
+        /* Uncomposite except where alpha_g == 255 || a_b == 0 */
+        keep = V_OR(V_EQ(alpha_g, ff), V_EQ(a_b, zero));
+        scale = V_SUB(V_DIV(V_ADD(V_MUL(a_b, V_SET1(255 * 2)), alpha_g),
+                            V_MAX(V_ADD(alpha_g, alpha_g), V_SET1(1))), a_b);
+        a_s = TEMPLATE_NAME(mul8)(alpha_g, valpha);
+        skip = V_OR(skip, V_EQ(a_s, zero));
+        copy = V_EQ(a_b, zero);
+        a_r = V_SUB(ff, TEMPLATE_NAME(mul8)(V_SUB(ff, a_b), V_SUB(ff, a_s)));
+        src_scale = TEMPLATE_NAME(src_scale)(a_s, a_r);
+
+        for (i = 0; i < n_chan; i++) {
+            VEC c_s = V_XOR(V_LOAD(tos_ptr + i * tos_planestride), comp);
+            VEC c_b = V_XOR(V_LOAD(nos_ptr + i * nos_planestride), comp);
+            VEC tmp = V_ADD(V_MUL(V_SUB(c_s, c_b), scale), round8);
+            VEC c_r;
+
+            tmp = V_ADD(c_s, V_SRA(V_ADD(tmp, V_SRA(tmp, 8)), 8));
+            tmp = V_MIN(V_MAX(tmp, zero), ff);
+            c_s = V_SEL(tmp, c_s, keep);
+
+            tmp = V_ADD(V_MUL(src_scale, V_SUB(c_s, c_b)), round16);
+            c_r = V_ADD(c_b, V_SRA(tmp, 16));
+            c_r = V_SEL(c_r, c_s, copy);
+            c_r = V_SEL(c_r, c_b, skip);
+            V_STORE(nos_ptr + i * nos_planestride, V_XOR(c_r, comp));
+        }
+        a_r = V_SEL(a_r, a_s, copy);
+        V_STORE(nos_ptr + nos_alpha_offset, V_SEL(a_r, a_b, skip));
+    }
+    return x;
+}
+
+static V_TARGET int
+TEMPLATE_NAME(blend_isolated)(byte *gs_restrict tos_ptr, int tos_planestride,
+                              byte *gs_restrict nos_ptr, int nos_planestride,
+                              int n_chan, int width, byte alpha,
+                              gs_blend_mode_t blend_mode, bool additive)
+{
+    const VEC zero = V_SET1(0);
+    const VEC ff = V_SET1(0xff);
+    const VEC round8 = V_SET1(0x80);
+    const VEC round16 = V_SET1(0x8000);
+    const VEC valpha = V_SET1(alpha);
+    const VEC comp = V_SET1(additive ? 0 : 0xff);
+    bool screen = (blend_mode == BLEND_MODE_Screen);
+    int tos_alpha_offset = n_chan * tos_planestride;
+    int nos_alpha_offset = n_chan * nos_planestride;
+    int x, i;
+
+    if (blend_mode != BLEND_MODE_Multiply && blend_mode != BLEND_MODE_Screen)
+        return 0;
+
+    for (x = 0; x + VN <= width; x += VN, tos_ptr += VN, nos_ptr += VN) {
+        VEC a_s, a_b, a_r, src_scale, skip, copy;
+
+        a_s = TEMPLATE_NAME(mul8)(V_LOAD(tos_ptr + tos_alpha_offset), valpha);
+        skip = V_EQ(a_s, zero);
+        if (V_ALL(skip))
+            continue;
+
+        a_b = V_LOAD(nos_ptr + nos_alpha_offset);
+        copy = V_EQ(a_b, zero);
+        a_r = V_SUB(ff, TEMPLATE_NAME(mul8)(V_SUB(ff, a_b), V_SUB(ff, a_s)));
+        src_scale = TEMPLATE_NAME(src_scale)(a_s, a_r);
+
+        for (i = 0; i < n_chan; i++) {
+            VEC c_s = V_XOR(V_LOAD(tos_ptr + i * tos_planestride), comp);
+            VEC c_b = V_XOR(V_LOAD(nos_ptr + i * nos_planestride), comp);
+            VEC c_bl, tmp, c_r;
+
+            if (screen)
+                c_bl = V_SUB(ff, TEMPLATE_NAME(mul8)(V_SUB(ff, c_b), V_SUB(ff, c_s)));
+            else
+                c_bl = TEMPLATE_NAME(mul8)(c_b, c_s);
+            /* Mix the blend result with the source color */
+            tmp = V_ADD(V_MUL(a_b, V_SUB(c_bl, c_s)), round8);
+            c_bl = V_ADD(c_s, V_SRA(V_ADD(V_SRA(tmp, 8), tmp), 8));
+
+            tmp = V_ADD(V_MUL(src_scale, V_SUB(c_bl, c_b)), round16);
+            c_r = V_ADD(c_b, V_SRA(tmp, 16));
+            c_r = V_SEL(c_r, c_s, copy);
+            c_r = V_SEL(c_r, c_b, skip);
+            V_STORE(nos_ptr + i * nos_planestride, V_XOR(c_r, comp));
+        }
+        a_r = V_SEL(a_r, a_s, copy);
+        V_STORE(nos_ptr + nos_alpha_offset, V_SEL(a_r, a_b, skip));
+    }
+    return x;
+}
+
+#undef TEMPLATE_NAME
+#undef V_TARGET
+#undef VEC
+#undef VN
+#undef V_LOAD
+#undef V_STORE
+#undef V_SET1
+#undef V_ADD
+#undef V_SUB
+#undef V_MUL
+#undef V_SLL
+#undef V_SRL
+#undef V_SRA
+#undef V_OR
+#undef V_XOR
+#undef V_EQ
+#undef V_MIN
+#undef V_MAX
+#undef V_SEL
+#undef V_ALL
+#undef V_DIV
+
+#else
+int dummy;
+#endif
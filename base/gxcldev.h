@@ -408,7 +408,8 @@ struct gx_clist_state_s {
         { 0, 0 }, /* cmd_list */\
         { 0, /* or */\
           0, /* slow rop */\
-          { { max_int, max_int }, /* p */ { min_int, min_int } /* q */ } /* trans_bbox */\
+          { { max_int, max_int }, /* p */ { min_int, min_int } /* q */ }, /* trans_bbox */\
+          0 /* drawn */\
         } /* color_usage */
 
 /* Define the size of the command buffer used for reading. */
@@ -882,6 +883,8 @@ int clist_writer_pop_cropping(gx_device_clist_writer *cdev);
 int clist_writer_check_empty_cropping_stack(gx_device_clist_writer *cdev);
 int clist_read_icctable(gx_device_clist_reader *crdev);
 int clist_read_color_usage_array(gx_device_clist_reader *crdev);
+int clist_read_band_index(gx_device_clist_reader *crdev);
+void clist_prefetch_band(gx_device_clist_reader *crdev, int band);
 int clist_read_op_equiv_cmyk_colors(gx_device_clist_reader *crdev,
     equivalent_cmyk_color_params *op_equiv);
 
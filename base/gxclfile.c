@@ -552,6 +552,19 @@ clist_fseek(clist_file_ptr cf, int64_t offset, int mode, const char *ignore_fnam
     return res;
 }
 
+static int
+clist_prefetch(clist_file_ptr cf, int64_t offset, int64_t len)
+{
+    IFILE *ifile = (IFILE *)cf;
+
+    /* Without pread, the file position is shared, so leave it alone */
+    if (!gp_can_share_fdesc() || offset >= ifile->filesize)
+        return 0;
+    if (len > ifile->filesize - offset)
+        len = ifile->filesize - offset;
+    return gp_fprefetch(ifile->f, offset, len);
+}
+
 static clist_io_procs_t clist_io_procs_file = {
     clist_fopen,
     clist_fclose,
@@ -563,6 +576,7 @@ static clist_io_procs_t clist_io_procs_file = {
     clist_ftell,
     clist_rewind,
     clist_fseek,
+    clist_prefetch,
 };
 
 init_proc(gs_gxclfile_init);
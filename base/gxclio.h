@@ -88,6 +88,12 @@ struct clist_io_procs_s {
     int (*rewind)(clist_file_ptr cf, bool discard_data, const char *fname);
 
     int (*fseek)(clist_file_ptr cf, int64_t offset, int mode, const char *fname);
+    /*
+     * Advise that len bytes at offset will be read soon.  This is only a
+     * hint, so that rendering can overlap with reading in the next band;
+     * an implementation that has nothing to gain may just return 0.
+     */
+    int (*prefetch)(clist_file_ptr cf, int64_t offset, int64_t len);
 };
 
 typedef struct clist_io_procs_s clist_io_procs_t;
@@ -141,6 +141,23 @@ gx_destroy_clip_device_on_stack(gx_device_clip * dev)
         ((gx_clip_path *)dev->cpath)->cached = (dev->current == &dev->list.single ? NULL : dev->current); /* Cast away const */
 }
 
+/*
+ * Copy a clipping device onto the stack, with a cursor of its own so that
+ * the copy can be used on another thread.  Return NULL if dev isn't a
+ * clipping device.
+ */
+gx_device *
+gx_copy_clip_device_on_stack(gx_device_clip * copy, const gx_device *dev)
+{
+    if (dev_proc(dev, open_device) != clip_open)
+        return NULL;
+    *copy = *(const gx_device_clip *)dev;
+    copy->current = (copy->list.head == 0 ? &copy->list.single : copy->list.head);
+    copy->clipping_box_set = false;
+    copy->cpath = NULL;
+    return (gx_device *)copy;
+}
+
 gx_device *
 gx_make_clip_device_on_stack_if_needed(gx_device_clip * dev, const gx_clip_path *pcpath, gx_device *target, gs_fixed_rect *rect)
 {
@@ -54,8 +54,8 @@ ENUM_PTRS_WITH(device_clist_enum_ptrs, gx_device_clist *cdev)
         return (ret ? ret : ENUM_OBJ(0));
     }
     index -= st_device_forward_max_ptrs;
-    /* RJW: We do not enumerate icc_cache_cl or icc_cache_list as they
-     * are allocated in non gc space */
+    /* RJW: We do not enumerate icc_cache_cl, icc_cache_list, render_pool
+     * or render_spares as they are allocated in non gc space */
     if (CLIST_IS_WRITER(cdev)) {
         switch (index) {
         case 0: return ENUM_OBJ((cdev->writer.image_enum_id != gs_no_id ?
@@ -698,6 +698,10 @@ clist_open(gx_device *dev)
 
     cdev->icc_cache_list_len = 0;
     cdev->icc_cache_list = NULL;
+    cdev->render_pool_len = 0;
+    cdev->render_pool = NULL;
+    cdev->render_spare_len = 0;
+    cdev->render_spares = NULL;
     code = clist_open_output_file(dev);
     if ( code >= 0)
         code = clist_emit_page_header(dev);
@@ -732,6 +736,7 @@ clist_close(gx_device *dev)
     cdev->icc_cache_list_len = 0;
     gs_free_object(cdev->memory->thread_safe_memory, cdev->icc_cache_list, "clist_close");
     cdev->icc_cache_list = NULL;
+    clist_free_render_pool(dev);
 
     /* So despite the comment above, it seems necessary to free the cache_chunk here,
      * if the device is not being retained.  The code in gx_pattern_cache_free_entry() doesn't
@@ -778,6 +783,8 @@ clist_finish_page(gx_device *dev, bool flush)
         clist_teardown_render_threads(dev);
         gs_free_object(cdev->memory, crdev->color_usage_array, "clist_color_usage_array");
         crdev->color_usage_array = NULL;
+        clist_free_band_index(crdev->band_index);
+        crdev->band_index = NULL;
 
        /* Free the icc table associated with this device.
            The threads that may have pointed to this were destroyed in
@@ -169,6 +169,7 @@ typedef struct cmd_list_s {
  * and reading (second) phase.
  */
 typedef struct gx_clist_state_s gx_clist_state;
+typedef struct clist_render_worker_s clist_render_worker_t;
 
 #define gx_device_clist_common_members\
         gx_device_forward_common;	/* (see gxdevice.h) */\
@@ -202,7 +203,11 @@ typedef struct gx_clist_state_s gx_clist_state;
                                            file location. */\
         gsicc_link_cache_t *icc_cache_cl; /* Link cache */\
         int icc_cache_list_len;         /* Length of list of caches, one per rendering thread */\
-        gsicc_link_cache_t **icc_cache_list  /* Link cache list */
+        gsicc_link_cache_t **icc_cache_list;  /* Link cache list */\
+        int render_pool_len;            /* Number of persistent rendering threads */\
+        clist_render_worker_t **render_pool;  /* Rendering threads, kept across pages */\
+        int render_spare_len;           /* Number of band devices kept for the next page */\
+        gx_device **render_spares       /* Band devices kept across pages */
 
 /* Define a structure to hold where the ICC profiles are stored in the clist
    Profiles are added into psuedo bands of the clist, these are bands that exist beyond
@@ -382,6 +387,10 @@ struct gx_device_clist_writer_s {
 
 typedef struct clist_render_thread_control_s clist_render_thread_control_t;
 
+/* An index of the band file, listing the command runs for each band. */
+/* This is private to gxclread.c. */
+typedef struct clist_band_index_s clist_band_index_t;
+
 /* Define the state of a band list when reading. */
 /* For normal rasterizing, pages and num_pages are both 0. */
 typedef struct gx_device_clist_reader_s {
@@ -390,14 +399,21 @@ typedef struct gx_device_clist_reader_s {
                                         /* means all planes */
     const gx_placed_page *pages;
     gx_color_usage_t *color_usage_array; /* per band color_usage */
+    clist_band_index_t *band_index;	/* per band bfile runs, may be NULL */
+    int solid_band;			/* 1 if bands with nothing drawn in them */
+                                        /* are solid, -1 if not, 0 if unknown */
+    byte solid_band_pixel[8];		/* the pixel value of those bands */
     int num_pages;
     void *offset_map; /* Just against collecting the map as garbage. */
-    int num_render_threads;		/* number of threads being used */
-    clist_render_thread_control_t *render_threads;	/* array of threads */
+    int num_render_threads;		/* number of band devices being used */
+    clist_render_thread_control_t *render_threads;	/* array of band devices */
+    int num_render_workers;		/* number of threads rendering bands */
     byte *main_thread_data;		/* saved data pointer of main thread */
-    int curr_render_thread;		/* index into array */
     int thread_lookahead_direction;	/* +1 or -1 */
     int next_band;			/* may be < 0 or >= num bands when no more remain to render */
+    struct gx_monitor_s *render_lock;	/* protects next_band and band device status */
+    struct gx_semaphore_s *render_idle;	/* signalled as each thread finishes the page */
+    bool render_stop;			/* true when the threads should finish the page */
 
 } gx_device_clist_reader;
 
@@ -520,6 +536,9 @@ int clist_icc_addentry(gx_device_clist_writer *cdev, int64_t hashcode,
 /* Free the table and its entries */
 int clist_free_icc_table(clist_icctable_t *icc_table, gs_memory_t *memory);
 
+/* Free a band file index made by clist_read_band_index */
+void clist_free_band_index(clist_band_index_t *band_index);
+
 /* Generic read function used with ICC and could be used with others.
    A different of this and clist_get_data is that here we reset the
    cfile position when we are done and this only reads from the cfile
@@ -552,6 +571,11 @@ clist_enable_multi_thread_render(gx_device *dev);
 void
 clist_teardown_render_threads(gx_device *dev);
 
+/* Stop the persistent rendering threads and free the band devices */
+/* kept across pages (at clist_close) */
+void
+clist_free_render_pool(gx_device *dev);
+
 /* Minimum BufferSpace needed when writing the clist */
 /* This is an exported function because it is used to set up render threads */
 /* and in clist_init_states to make sure the buffer is large enough */
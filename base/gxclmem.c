@@ -20,6 +20,8 @@
 #include "gserrors.h"
 #include "gxclmem.h"
 #include "gssprintf.h"
+#include "gslibctx.h"
+#include "slz4x.h"
 
 #include "valgrind.h"
 
@@ -132,23 +134,14 @@ LIMITATIONS.
    The need to compress should be conditional on the amount of available
    memory, but we don't have a way to communicate this to these routines.
    Instead, we simply start compressing when we've allocated more than
-   COMPRESSION_THRESHOLD amount of data.  The threshold should be at
-   least as large as the fixed overhead of the compressor plus the
-   decompressor, plus the expected compressed size of a block that size.
-
-   As a testing measure we have a a define TEST_BAND_LIST_COMPRESSION
-   which, if set, will set the threshold to a low value so as to cause
-   compression to trigger.
+   the BandListCompressionThreshold device parameter (see gslibctx.c for
+   the default), which is read when the file is created. The threshold
+   should be at least as large as the fixed overhead of the compressor
+   plus the decompressor, plus the expected compressed size of a block
+   that size.
  */
-static const int64_t COMPRESSION_THRESHOLD =
-#ifdef TEST_BAND_LIST_COMPRESSION
-    1024; /* Low value to force compression */
-#else
-    500000000;  /* 0.5 Gb for host machines */
-#endif
-
 #define NEED_TO_COMPRESS(f)\
-  ((f)->ok_to_compress && (f)->total_space > COMPRESSION_THRESHOLD)
+  ((f)->ok_to_compress && (f)->total_space > (f)->compress_threshold)
 
    /* FOR NOW ALLOCATE 1 raw buffer for every 32 blocks (at least 8, no more than 64)    */
 #define GET_NUM_RAW_BUFFERS( f ) \
@@ -192,6 +185,71 @@ const byte *decomp_rd_ptr1, *decomp_rd_limit1;
 
 #endif
 
+/* ------------------------------ Compression --------------------------- */
+
+/*
+ * Allocate the compressor or decompressor state for a file.  Files use the
+ * fast LZ4 filters if -dFastBandListCompression was given when they were
+ * created, otherwise the filters selected by BAND_LIST_COMPRESSOR.
+ */
+static stream_state *
+memfile_alloc_codec_state(MEMFILE * f, gs_memory_t *mem, bool compress)
+{
+    const stream_template *templat;
+    stream_state *st;
+
+    if (f->fast_compress)
+        templat = (compress ? &s_LZ4E_template : &s_LZ4D_template);
+    else if (compress)
+        templat = clist_compressor_template();
+    else
+        templat = clist_decompressor_template();
+    st = gs_alloc_struct(mem, stream_state, templat->stype,
+                         (compress ? "memfile_open_scratch(compress_state)" :
+                          "memfile_open_scratch(decompress_state)"));
+    if (st == NULL)
+        return NULL;
+    if (f->fast_compress)
+        st->templat = templat;
+    else if (compress)
+        clist_compressor_init(st);
+    else
+        clist_decompressor_init(st);
+    st->memory = mem;
+    if (templat->set_defaults)
+        (*templat->set_defaults) (st);
+    return st;
+}
+
+/* Return the real time in microseconds, for the statistics. */
+static int64_t
+memfile_time(void)
+{
+    long t[2];
+
+    gp_get_realtime(t);
+    return (int64_t)t[0] * 1000000 + t[1] / 1000;
+}
+
+static void
+memfile_report_stats(MEMFILE * f)
+{
+    const MEMFILE_STATS *ps = &f->stats;
+    int64_t raw = ps->compressed_blocks * MEMFILE_DATA_SIZE;
+
+    /* Unlike most -Z: output, this is available in release builds too. */
+    if (!gs_debug_c(':') ||
+        (ps->compressed_blocks == 0 && ps->decompressed_blocks == 0))
+        return;
+    dmlprintf8(f->memory,
+               "[:]memfile "PRI_INTPTR" (%s): %"PRId64" bytes compressed to %"PRId64" (%d%%) in %"PRId64"us, %"PRId64" blocks decompressed in %"PRId64"us\n",
+               (intptr_t)f, (f->fast_compress ? "lz4" : "default"),
+               raw, ps->compressed_bytes,
+               (int)(raw == 0 ? 0 : ps->compressed_bytes * 100 / raw),
+               ps->compress_time, ps->decompressed_blocks,
+               ps->decompress_time);
+}
+
 /* ----------------------------- Memory Allocation --------------------- */
 static void *   /* allocated memory's address, 0 if failure */
 allocateWithReserve(
@@ -289,6 +347,7 @@ memfile_fopen(char fname[gp_file_name_sizeof], const char *fmode,
             f->log_curr_pos = 0;
             f->raw_head = NULL;
             f->error_code = 0;
+            memset(&f->stats, 0, sizeof(f->stats));
 
             if (f->log_head->phys_blk->data_limit != NULL) {
                 /* The file is compressed, so we need to copy the logical block */
@@ -297,7 +356,6 @@ memfile_fopen(char fname[gp_file_name_sizeof], const char *fmode,
                 LOG_MEMFILE_BLK *log_block, *new_log_block;
                 int i;
                 int num_log_blocks = (f->log_length + MEMFILE_DATA_SIZE - 1) / MEMFILE_DATA_SIZE;
-                const stream_template *decompress_template = clist_decompressor_template();
 
                 new_log_block = MALLOC(f, num_log_blocks * sizeof(LOG_MEMFILE_BLK), "memfile_fopen" );
                 if (new_log_block == NULL) {
@@ -315,9 +373,7 @@ memfile_fopen(char fname[gp_file_name_sizeof], const char *fmode,
                 f->log_head = new_log_block;
 
                 /* NB: don't need compress_state for reading */
-                f->decompress_state =
-                    gs_alloc_struct(mem, stream_state, decompress_template->stype,
-                                    "memfile_open_scratch(decompress_state)");
+                f->decompress_state = memfile_alloc_codec_state(f, mem, false);
                 if (f->decompress_state == 0) {
                     emprintf1(mem,
                               "memfile_open_scratch(%s): gs_alloc_struct failed\n",
@@ -325,10 +381,6 @@ memfile_fopen(char fname[gp_file_name_sizeof], const char *fmode,
                     code = gs_note_error(gs_error_VMerror);
                     goto finish;
                 }
-                clist_decompressor_init(f->decompress_state);
-                f->decompress_state->memory = mem;
-                if (decompress_template->set_defaults)
-                    (*decompress_template->set_defaults) (f->decompress_state);
             }
             f->log_curr_blk = f->log_head;
             memfile_get_pdata(f);               /* set up the initial block */
@@ -358,6 +410,9 @@ memfile_fopen(char fname[gp_file_name_sizeof], const char *fmode,
     f->reservePhysBlockCount = 0;
     f->reserveLogBlockChain = NULL;
     f->reserveLogBlockCount = 0;
+    f->fast_compress = gs_lib_ctx_get_fast_band_list_compression(mem);
+    f->compress_threshold = gs_lib_ctx_get_band_list_compression_threshold(mem);
+    memset(&f->stats, 0, sizeof(f->stats));
     /* init an empty file           */
     if ((code = memfile_init_empty(f)) < 0)
         goto finish;
@@ -371,15 +426,8 @@ memfile_fopen(char fname[gp_file_name_sizeof], const char *fmode,
     f->compress_state = 0;      /* make clean for GC */
     f->decompress_state = 0;
     if (f->ok_to_compress) {
-        const stream_template *compress_template = clist_compressor_template();
-        const stream_template *decompress_template = clist_decompressor_template();
-
-        f->compress_state =
-            gs_alloc_struct(mem, stream_state, compress_template->stype,
-                            "memfile_open_scratch(compress_state)");
-        f->decompress_state =
-            gs_alloc_struct(mem, stream_state, decompress_template->stype,
-                            "memfile_open_scratch(decompress_state)");
+        f->compress_state = memfile_alloc_codec_state(f, mem, true);
+        f->decompress_state = memfile_alloc_codec_state(f, mem, false);
         if (f->compress_state == 0 || f->decompress_state == 0) {
             emprintf1(mem,
                       "memfile_open_scratch(%s): gs_alloc_struct failed\n",
@@ -387,14 +435,6 @@ memfile_fopen(char fname[gp_file_name_sizeof], const char *fmode,
             code = gs_note_error(gs_error_VMerror);
             goto finish;
         }
-        clist_compressor_init(f->compress_state);
-        clist_decompressor_init(f->decompress_state);
-        f->compress_state->memory = mem;
-        f->decompress_state->memory = mem;
-        if (compress_template->set_defaults)
-            (*compress_template->set_defaults) (f->compress_state);
-        if (decompress_template->set_defaults)
-            (*decompress_template->set_defaults) (f->decompress_state);
     }
     f->total_space = 0;
 
@@ -449,28 +489,26 @@ memfile_fclose(clist_file_ptr cf, const char *fname, bool delete)
                 return_error(gs_error_invalidfileaccess);
             }
             prev_f->openlist = f->openlist;     /* link around the one being fclosed */
+            f->base_memfile->stats.decompressed_blocks += f->stats.decompressed_blocks;
+            f->base_memfile->stats.decompress_time += f->stats.decompress_time;
             /* Now delete this MEMFILE reader instance */
             /* NB: we don't delete 'base' instances until we delete */
             /* If the file is compressed, free the logical blocks, but not */
             /* the phys_blk info (that is still used by the base memfile   */
             if (f->log_head->phys_blk->data_limit != NULL) {
-                LOG_MEMFILE_BLK *tmpbp, *bp = f->log_head;
-
-                while (bp != NULL) {
-                    tmpbp = bp->link;
-                    FREE(f, bp, "memfile_free_mem(log_blk)");
-                    bp = tmpbp;
-                }
+                /* memfile_fopen allocated the copy as a single array. */
+                FREE(f, f->log_head, "memfile_free_mem(log_blk)");
                 f->log_head = NULL;
 
-                /* Free any internal compressor state. */
-                if (f->compressor_initialized) {
+                /* Free the decompressor state (there is no compressor). */
+                if (f->decompress_state != NULL) {
                     if (f->decompress_state->templat->release != 0)
                         (*f->decompress_state->templat->release) (f->decompress_state);
-                    if (f->compress_state->templat->release != 0)
-                        (*f->compress_state->templat->release) (f->compress_state);
-                    f->compressor_initialized = false;
+                    gs_free_object(f->memory, f->decompress_state,
+                                   "memfile_fclose(decompress_state)");
+                    f->decompress_state = NULL;
                 }
+                f->compressor_initialized = false;
                 /* free the raw buffers                                           */
                 while (f->raw_head != NULL) {
                     RAW_BUFFER *tmpraw = f->raw_head->fwd;
@@ -615,6 +653,7 @@ compress_log_blk(MEMFILE * f, LOG_MEMFILE_BLK * bp)
     long compressed_size;
     byte *start_ptr;
     PHYS_MEMFILE_BLK *newphys;
+    int64_t start_time = memfile_time();
 
     /* compress this block */
     f->rd.ptr = (const byte *)(bp->phys_blk->data) - 1;
@@ -631,9 +670,16 @@ compress_log_blk(MEMFILE * f, LOG_MEMFILE_BLK * bp)
                                                     &(f->rd), &(f->wt), true);
     bp->phys_blk->data_limit = (char *)(f->wt.ptr);
 
-    if (status == 1) {          /* More output space needed (see strimpl.h) */
-        /* allocate another physical block, then compress remainder       */
-        compressed_size = f->wt.limit - start_ptr;
+    /*
+     * More output space needed (see strimpl.h): allocate another physical
+     * block, then compress the remainder.  With zlib 1 src block never ends
+     * up getting split across 3 dest blocks, but the LZ4 filter expands data
+     * that doesn't compress by up to 67 bytes, so a block that starts near
+     * the end of a physical block can spill into a third one.  That is rare
+     * enough for memfile_set_memory_warning to allow for only one.
+     */
+    while (status == 1) {
+        compressed_size += f->wt.limit - start_ptr;
         newphys =
             allocateWithReserve(f, sizeof(*newphys), &code, "memfile newphys",
                         "compress_log_blk : MALLOC for 'newphys' failed\n");
@@ -641,7 +687,7 @@ compress_log_blk(MEMFILE * f, LOG_MEMFILE_BLK * bp)
             return code;
         ecode |= code;  /* accumulate any low-memory warnings */
         newphys->link = NULL;
-        bp->phys_blk->link = newphys;
+        f->phys_curr->link = newphys;
         f->phys_curr = newphys;
         f->wt.ptr = (byte *) (newphys->data) - 1;
         f->wt.limit = f->wt.ptr + MEMFILE_DATA_SIZE;
@@ -650,20 +696,11 @@ compress_log_blk(MEMFILE * f, LOG_MEMFILE_BLK * bp)
         status =
             (*f->compress_state->templat->process)(f->compress_state,
                                                    &(f->rd), &(f->wt), true);
-        if (status != 0) {
-            /*
-             * You'd think the above line is a bug, but in real life 1 src
-             * block never ends up getting split across 3 dest blocks.
-             */
-            /* CHANGE memfile_set_memory_warning if this assumption changes. */
-            emprintf(f->memory,
-                     "Compression required more than one full block!\n");
-            return_error(gs_error_Fatal);
-        }
         newphys->data_limit = (char *)(f->wt.ptr);
     }
     compressed_size += f->wt.ptr - start_ptr;
-    if (compressed_size > MEMFILE_DATA_SIZE) {
+    /* LZ4 expanding data that doesn't compress is expected, not news. */
+    if (compressed_size > MEMFILE_DATA_SIZE && !f->fast_compress) {
         emprintf2(f->memory,
                   "\nCompression didn't - raw=%d, compressed=%ld\n",
                   MEMFILE_DATA_SIZE,
@@ -672,6 +709,9 @@ compress_log_blk(MEMFILE * f, LOG_MEMFILE_BLK * bp)
 #ifdef DEBUG
     tot_compressed += compressed_size;
 #endif
+    f->stats.compressed_blocks++;
+    f->stats.compressed_bytes += compressed_size;
+    f->stats.compress_time += memfile_time() - start_time;
     return (status < 0 ? gs_note_error(gs_error_ioerror) : ecode);
 }                               /* end "compress_log_blk()"                                     */
 
@@ -843,6 +883,8 @@ memfile_get_pdata(MEMFILE * f)
 {
     int code, i, num_raw_buffers, status;
     LOG_MEMFILE_BLK *bp = f->log_curr_blk;
+    PHYS_MEMFILE_BLK *pphys;
+    int64_t start_time;
 
     if (bp->phys_blk->data_limit == NULL) {
         /* Not compressed, return this data pointer                       */
@@ -926,6 +968,7 @@ memfile_get_pdata(MEMFILE * f)
 
             /* Decompress the data into this raw block                     */
             /* Initialize the decompressor                              */
+            start_time = memfile_time();
             if (f->decompress_state->templat->reinit != 0)
                 (*f->decompress_state->templat->reinit) (f->decompress_state);
             /* Set pointers and call the decompress routine             */
@@ -941,18 +984,26 @@ memfile_get_pdata(MEMFILE * f)
 #endif
             status = (*f->decompress_state->templat->process)
                 (f->decompress_state, &(f->rd), &(f->wt), true);
-            if (status == 0) {  /* More input data needed */
+            pphys = bp->phys_blk;
+            while (status == 0) {  /* More input data needed */
                 /* switch to next block and continue decompress             */
                 int back_up = 0;        /* adjust pointer backwards     */
 
+                /* See compress_log_blk for how many blocks data can span. */
+                if (pphys->link == NULL) {
+                    emprintf(f->memory,
+                             "Decompression ran out of compressed data!\n");
+                    return_error(gs_error_Fatal);
+                }
                 if (f->rd.ptr != f->rd.limit) {
                     /* transfer remainder bytes from the previous block      */
                     back_up = f->rd.limit - f->rd.ptr;
                     for (i = 0; i < back_up; i++)
-                        *(bp->phys_blk->link->data - back_up + i) = *++f->rd.ptr;
+                        *(pphys->link->data - back_up + i) = *++f->rd.ptr;
                 }
-                f->rd.ptr = (const byte *)bp->phys_blk->link->data - back_up - 1;
-                f->rd.limit = (const byte *)bp->phys_blk->link->data_limit;
+                pphys = pphys->link;
+                f->rd.ptr = (const byte *)pphys->data - back_up - 1;
+                f->rd.limit = (const byte *)pphys->data_limit;
 #ifdef DEBUG
                 decomp_wt_ptr1 = f->wt.ptr;
                 decomp_wt_limit1 = f->wt.limit;
@@ -961,13 +1012,10 @@ memfile_get_pdata(MEMFILE * f)
 #endif
                 status = (*f->decompress_state->templat->process)
                     (f->decompress_state, &(f->rd), &(f->wt), true);
-                if (status == 0) {
-                    emprintf(f->memory,
-                             "Decompression required more than one full block!\n");
-                    return_error(gs_error_Fatal);
-                }
             }
             bp->raw_block = f->raw_head;        /* point to raw block           */
+            f->stats.decompressed_blocks++;
+            f->stats.decompress_time += memfile_time() - start_time;
         }
         /* end if( raw_block == NULL ) meaning need to decompress data    */
         else {
@@ -1149,6 +1197,8 @@ memfile_free_mem(MEMFILE * f)
     tot_cache_miss = 0;
     tot_swap_out = 0;
 #endif
+    memfile_report_stats(f);
+    memset(&f->stats, 0, sizeof(f->stats));
 
     /* Free up memory that was allocated for the memfile              */
     bp = f->log_head;
@@ -1250,6 +1300,13 @@ memfile_init_empty(MEMFILE * f)
     return 0;
 }
 
+/* The data is in memory already, so there is nothing to read ahead */
+static int
+memfile_prefetch(clist_file_ptr cf, int64_t offset, int64_t len)
+{
+    return 0;
+}
+
 clist_io_procs_t clist_io_procs_memory = {
     memfile_fopen,
     memfile_fclose,
@@ -1261,6 +1318,7 @@ clist_io_procs_t clist_io_procs_memory = {
     memfile_ftell,
     memfile_rewind,
     memfile_fseek,
+    memfile_prefetch,
 };
 
 init_proc(gs_gxclmem_init);
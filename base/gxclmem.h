@@ -63,10 +63,26 @@ typedef struct LOG_MEMFILE_BLK {
     RAW_BUFFER *raw_block;	/* or NULL */
 } LOG_MEMFILE_BLK;
 
+/*
+ * Statistics about the compression of a file, reported with -Z: when the
+ * file is freed or rewritten.  Reader instances fold their decompression
+ * statistics into the base file when they are closed.
+ */
+typedef struct MEMFILE_STATS_s {
+    int64_t compressed_blocks;	/* logical blocks compressed */
+    int64_t compressed_bytes;	/* total size of those blocks compressed */
+    int64_t compress_time;	/* microseconds spent compressing */
+    int64_t decompressed_blocks;	/* logical blocks decompressed */
+    int64_t decompress_time;	/* microseconds spent decompressing */
+} MEMFILE_STATS;
+
 struct MEMFILE_s {
     gs_memory_t *memory;	/* storage allocator */
     gs_memory_t *data_memory;	/* storage allocator for data */
     bool ok_to_compress;	/* if true, OK to compress this file */
+    bool fast_compress;		/* use the LZ4 filters, not the */
+                                /* BAND_LIST_COMPRESSOR ones */
+    int64_t compress_threshold;	/* compress once total_space passes this */
     bool is_open;		/* track open/closed for each access struct */
         /*
          * We need to maintain a linked list of other structs that
@@ -120,6 +136,7 @@ struct MEMFILE_s {
     bool compressor_initialized;
     stream_state *compress_state;
     stream_state *decompress_state;					/******* READER INSTANCE *******/
+    MEMFILE_STATS stats;						/******* READER INSTANCE *******/
 };
 typedef struct MEMFILE_s MEMFILE;
 
@@ -548,6 +548,9 @@ clist_playback_band(clist_playback_action playback_action, /* lgtm [cpp/use-of-g
     gs_gstate gs_gstate;
     gx_device_color fill_color = { 0 };
     gx_device_color stroke_color = { 0 };
+    /* Pattern tiles held by fill_color and stroke_color, pinned so that */
+    /* loading another pattern can't free them from under us.            */
+    gx_color_tile *pinned_tiles[2] = { NULL, NULL };
     float dash_pattern[cmd_max_dash];
     gx_fill_params fill_params;
     gx_stroke_params stroke_params;
@@ -1902,6 +1905,11 @@ idata:                  data_size = 0;
                                     offset = 0;
                                     if (is_continuation)
                                         enc_u_getw(offset, cbp);
+                                    else if (pdcolor == &fill_color || pdcolor == &stroke_color) {
+                                        l = (pdcolor == &stroke_color);
+                                        gx_pattern_cache_unpin_tile(pinned_tiles[l]);
+                                        pinned_tiles[l] = NULL;
+                                    }
                                     enc_u_getw(color_size, cbp);
                                     left = color_size;
                                     if (!left) {
@@ -1934,6 +1942,11 @@ idata:                  data_size = 0;
                                                          tdev);
                                     if (code < 0)
                                         goto out;
+                                    if (pdcolor == &fill_color || pdcolor == &stroke_color) {
+                                        l = (pdcolor == &stroke_color);
+                                        if (pinned_tiles[l] == NULL)
+                                            pinned_tiles[l] = gx_pattern_cache_pin_color(pdcolor);
+                                    }
                                 }
                                 break;
                             default:
@@ -2024,12 +2037,9 @@ idata:                  data_size = 0;
                     cmd_get_value(id, cbp);
                     if_debug2m('L', mem, "id=0x%lx, lock=%d\n", id, lock);
                     /* We currently lock the pattern in all the bands, even in ones
-                     * where we haven't used the pattern. This can cause the following
-                     * call to return with 'undefined' because the pattern is not
-                     * found. Just swallow this error and continue. */
+                     * where we haven't used the pattern. The following call does
+                     * nothing if the pattern is not found. */
                     code = gx_pattern_cache_entry_set_lock(&gs_gstate, id, lock);
-                    if (code == gs_error_undefined)
-                        code = 0;
                     if (code < 0)
                         goto out;
                     continue;
@@ -2404,6 +2414,8 @@ idata:                  data_size = 0;
     }
     gx_cpath_free(&clip_path, "clist_render_band exit");
     gx_path_free(&path, "clist_render_band exit");
+    gx_pattern_cache_unpin_tile(pinned_tiles[0]);
+    gx_pattern_cache_unpin_tile(pinned_tiles[1]);
     if (gs_gstate.pattern_cache != NULL) {
         gx_pattern_cache_free(gs_gstate.pattern_cache);
         gs_gstate.pattern_cache = NULL;
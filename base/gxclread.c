@@ -47,6 +47,203 @@
 private_st_clist_icctable_entry();
 private_st_clist_icctable();
 
+/* ------ Band file index ------ */
+
+/*
+ * Without an index, reading a band means reading every cmd_block in the
+ * bfile to find the ones for the band, so rendering a page costs
+ * O(bands * blocks) reads; with thousands of bands (large format, high
+ * resolution) that dominates.  So once the page is complete we read the
+ * whole bfile once, and list the runs of cfile data for each band.
+ *
+ * Run 0 is the data before the first cmd_block, and is for band 0.  Run
+ * k > 0 is the data from blocks[k - 1].pos to blocks[k].pos, for bands
+ * blocks[k - 1].band_min to blocks[k - 1].band_max (see
+ * s_band_read_process).  Runs for a single band are listed under that
+ * band; runs for a range of bands, or for a pseudo-band, are listed
+ * together in multi_runs, and filtered as the band is read.  Each list is
+ * in file order, so merging a band's list with multi_runs gives the same
+ * runs, in the same order, as scanning the bfile.
+ */
+struct clist_band_index_s {
+    gs_memory_t *memory;
+    int64_t bfile_end_pos;	/* the bfile this was made from */
+    int nbands;
+    uint nblocks;
+    cmd_block *blocks;		/* the whole bfile */
+    uint *band_start;		/* [nbands + 1] indices into band_runs */
+    uint *band_runs;		/* runs for each single band */
+    uint *multi_runs;		/* runs for anything else */
+    uint num_multi;
+};
+
+/* Don't ask for more than this much unwanted data to be read ahead, */
+/* just so that two runs can be prefetched in one request.            */
+#define BAND_PREFETCH_GAP 65536
+
+/* Get the bands and cfile start position of a run. */
+static inline void
+band_index_run(const clist_band_index_t *index, uint run, int *pbmin, int *pbmax,
+               int64_t *pstart)
+{
+    if (run == 0) {
+        *pbmin = *pbmax = 0;
+        *pstart = 0;
+    } else {
+        const cmd_block *cb = &index->blocks[run - 1];
+
+        *pbmin = cb->band_min;
+        *pbmax = cb->band_max;
+        *pstart = cb->pos;
+    }
+}
+
+void
+clist_free_band_index(clist_band_index_t *index)
+{
+    gs_memory_t *mem;
+
+    if (index == NULL)
+        return;
+    mem = index->memory;
+    gs_free_object(mem, index->multi_runs, "clist_free_band_index");
+    gs_free_object(mem, index->band_runs, "clist_free_band_index");
+    gs_free_object(mem, index->band_start, "clist_free_band_index");
+    gs_free_object(mem, index->blocks, "clist_free_band_index");
+    gs_free_object(mem, index, "clist_free_band_index");
+}
+
+/*
+ * Read the bfile, and make the index of the runs for each band.  If the
+ * bfile isn't as expected we just don't make an index, so that reading
+ * falls back to scanning the bfile (and reports any error then).
+ */
+int
+clist_read_band_index(gx_device_clist_reader *crdev)
+{
+    gx_band_page_info_t *page_info = &crdev->page_info;
+    const clist_io_procs_t *io_procs = page_info->io_procs;
+    gs_memory_t *mem = crdev->memory->non_gc_memory;
+    int64_t size = page_info->bfile_end_pos;
+    int nbands = crdev->nbands;
+    clist_band_index_t *index;
+    uint nblocks, run, total = 0, nmulti = 0;
+    int band;
+    int nread;
+
+    clist_free_band_index(crdev->band_index);
+    crdev->band_index = NULL;
+    if (page_info->bfile == NULL || nbands <= 0 || size <= 0 ||
+        size % sizeof(cmd_block) != 0 || size / sizeof(cmd_block) > max_uint / sizeof(cmd_block))
+        return 0;
+    nblocks = (uint)(size / sizeof(cmd_block));
+    index = (clist_band_index_t *)gs_alloc_bytes(mem, sizeof(*index),
+                                                 "clist_read_band_index");
+    if (index == NULL)
+        return_error(gs_error_VMerror);
+    memset(index, 0, sizeof(*index));
+    index->memory = mem;
+    index->bfile_end_pos = size;
+    index->nbands = nbands;
+    index->nblocks = nblocks;
+    index->blocks = (cmd_block *)gs_alloc_byte_array(mem, nblocks, sizeof(cmd_block),
+                                                     "clist_read_band_index");
+    index->band_start = (uint *)gs_alloc_byte_array(mem, nbands + 1, sizeof(uint),
+                                                    "clist_read_band_index");
+    if (index->blocks == NULL || index->band_start == NULL) {
+        clist_free_band_index(index);
+        return_error(gs_error_VMerror);
+    }
+    io_procs->fseek(page_info->bfile, 0, SEEK_SET, page_info->bfname);
+    nread = io_procs->fread_chars(index->blocks, nblocks * sizeof(cmd_block), page_info->bfile);
+    io_procs->fseek(page_info->bfile, size, SEEK_SET, page_info->bfname);
+    if (nread != nblocks * sizeof(cmd_block) ||
+        index->blocks[nblocks - 1].band_min != cmd_band_end) {
+        clist_free_band_index(index);
+        return 0;
+    }
+
+    /* Count the runs for each band, in band_start[band + 1]. */
+    memset(index->band_start, 0, (nbands + 1) * sizeof(uint));
+    for (run = 0; run < nblocks; run++) {
+        int bmin, bmax;
+        int64_t start;
+
+        band_index_run(index, run, &bmin, &bmax, &start);
+        if (index->blocks[run].pos == start)
+            continue;		/* no data */
+        if (bmin == bmax && bmin >= 0 && bmin < nbands)
+            index->band_start[bmin + 1]++;
+        else
+            nmulti++;
+    }
+    for (band = 0; band < nbands; band++) {
+        uint count = index->band_start[band + 1];
+
+        index->band_start[band + 1] = total;
+        total += count;
+    }
+    index->band_runs = (uint *)gs_alloc_byte_array(mem, max(total, 1), sizeof(uint),
+                                                   "clist_read_band_index");
+    index->multi_runs = (uint *)gs_alloc_byte_array(mem, max(nmulti, 1), sizeof(uint),
+                                                    "clist_read_band_index");
+    if (index->band_runs == NULL || index->multi_runs == NULL) {
+        clist_free_band_index(index);
+        return_error(gs_error_VMerror);
+    }
+    /* Fill in the lists, using band_start[band + 1] as the fill point */
+    /* for band, which leaves it as the end of the band's list.         */
+    for (run = 0; run < nblocks; run++) {
+        int bmin, bmax;
+        int64_t start;
+
+        band_index_run(index, run, &bmin, &bmax, &start);
+        if (index->blocks[run].pos == start)
+            continue;
+        if (bmin == bmax && bmin >= 0 && bmin < nbands)
+            index->band_runs[index->band_start[bmin + 1]++] = run;
+        else
+            index->multi_runs[index->num_multi++] = run;
+    }
+    index->band_start[0] = 0;
+    crdev->band_index = index;
+    return 0;
+}
+
+/*
+ * Ask for the cfile data for a band to be read ahead, so that it can
+ * arrive while the current band is rendered.  This is only a hint, and
+ * does nothing without an index (or for a RAM band list).
+ */
+void
+clist_prefetch_band(gx_device_clist_reader *crdev, int band)
+{
+    const clist_band_index_t *index = crdev->band_index;
+    gx_band_page_info_t *page_info = &crdev->page_info;
+    int64_t start = 0, end = 0;
+    uint i;
+
+    if (index == NULL || band < 0 || band >= index->nbands ||
+        page_info->cfile == NULL || index->bfile_end_pos != page_info->bfile_end_pos)
+        return;
+    for (i = index->band_start[band]; i < index->band_start[band + 1]; i++) {
+        uint run = index->band_runs[i];
+        int bmin, bmax;
+        int64_t pos;
+
+        band_index_run(index, run, &bmin, &bmax, &pos);
+        if (end > start && pos - end > BAND_PREFETCH_GAP) {
+            page_info->io_procs->prefetch(page_info->cfile, start, end - start);
+            start = end = 0;
+        }
+        if (end == start)
+            start = pos;
+        end = index->blocks[run].pos;
+    }
+    if (end > start)
+        page_info->io_procs->prefetch(page_info->cfile, start, end - start);
+}
+
 /* ------ Band file reading stream ------ */
 
 #ifdef DEBUG
@@ -70,6 +267,9 @@ typedef struct stream_band_read_state_s {
     int band_first, band_last;
     uint left;			/* amount of data left in this run */
     cmd_block b_this;
+    const clist_band_index_t *index;	/* if not NULL, use instead of bfile */
+    uint next_run, end_run;	/* remaining part of index->band_runs */
+    uint next_multi;		/* next entry of index->multi_runs */
     gs_memory_t *local_memory;
 #ifdef DEBUG
     bool skip_first;
@@ -91,9 +291,44 @@ s_band_read_init(stream_state * st)
     ss->b_this.band_min = 0;
     ss->b_this.band_max = 0;
     ss->b_this.pos = 0;
+    if (ss->index != NULL) {
+        ss->next_run = ss->index->band_start[ss->band_first];
+        ss->end_run = ss->index->band_start[ss->band_first + 1];
+        ss->next_multi = 0;
+        return 0;
+    }
     return io_procs->rewind(ss->page_bfile, false, ss->page_bfname);
 }
 
+/*
+ * Find the next run from the index for the band being read: the earlier
+ * of the band's own next run, and the next run for a range of bands that
+ * includes it.  Return index->nblocks if there are none left.
+ */
+static uint
+s_band_read_next_run(stream_band_read_state *ss)
+{
+    const clist_band_index_t *index = ss->index;
+    uint run = (ss->next_run < ss->end_run ? index->band_runs[ss->next_run] :
+                index->nblocks);
+
+    while (ss->next_multi < index->num_multi) {
+        uint multi = index->multi_runs[ss->next_multi];
+        int bmin, bmax;
+        int64_t start;
+
+        if (multi > run)
+            break;
+        ss->next_multi++;
+        band_index_run(index, multi, &bmin, &bmax, &start);
+        if (!(ss->band_last < bmin || ss->band_first > bmax))
+            return multi;
+    }
+    if (run < index->nblocks)
+        ss->next_run++;
+    return run;
+}
+
 #ifdef DEBUG
 static int
 s_band_read_init_offset_map(gx_device_clist_reader *crdev, stream_state * st)
@@ -194,7 +429,20 @@ s_band_read_process(stream_state * st, stream_cursor_read * ignore_pr,
         }
         /* The current command is over. So find the next command in the bfile
          * that applies to the current band(s) and read that in. */
-        do {
+        if (ss->index != NULL) {
+            uint run = s_band_read_next_run(ss);
+
+            if (run == ss->index->nblocks) {
+                pw->ptr = q;
+                ss->left = left;
+                return EOFC;
+            }
+            band_index_run(ss->index, run, &bmin, &bmax, &pos);
+            ss->b_this = ss->index->blocks[run];
+            if_debug4m('l', ss->local_memory,
+                       "[l]reading for bands (%d,%d) at bfile %"PRId64", cfile %"PRId64"\n",
+                       bmin, bmax, (int64_t)run * (int64_t)sizeof(cmd_block), (int64_t)pos);
+        } else do {
             int nread;
             /* If we hit eof, end! */
             /* Could this test be moved into the nread < sizeof() test below? */
@@ -233,10 +481,11 @@ s_band_read_process(stream_state * st, stream_cursor_read * ignore_pr,
             ss->offset_map_length++;
         }
 #endif
-        if_debug5m('l', ss->local_memory,
-                   "[l]reading for bands (%d,%d) at bfile %"PRId64", cfile %"PRId64", length %u\n",
-                   bmin, bmax,
-                   (io_procs->ftell(bfile) - sizeof(ss->b_this)), (int64_t)pos, left);
+        if (ss->index == NULL)
+            if_debug5m('l', ss->local_memory,
+                       "[l]reading for bands (%d,%d) at bfile %"PRId64", cfile %"PRId64", length %u\n",
+                       bmin, bmax,
+                       (io_procs->ftell(bfile) - sizeof(ss->b_this)), (int64_t)pos, left);
     }
     pw->ptr = q;
     ss->left = left;
@@ -460,6 +709,7 @@ clist_close_writer_and_init_reader(gx_device_clist *cldev)
     gx_device_clist_reader * const crdev = &cldev->reader;
     gs_memory_t *base_mem = crdev->memory->thread_safe_memory;
     gs_memory_status_t mem_status;
+    int row_cache_size;
     int code = 0;
 
     /* Initialize for rendering if we haven't done so yet. */
@@ -472,6 +722,10 @@ clist_close_writer_and_init_reader(gx_device_clist *cldev)
             return code;
         /* allocate and load the color_usage_array */
         code = clist_read_color_usage_array(crdev);
+        if (code < 0)
+            return code;
+        /* index the bfile, so that each band can be read directly */
+        code = clist_read_band_index(crdev);
         if (code < 0)
             return code;
         /* Check for and get ICC profile table */
@@ -488,6 +742,11 @@ clist_close_writer_and_init_reader(gx_device_clist *cldev)
 
         if (crdev->icc_cache_cl == NULL) {
             code = (crdev->icc_cache_cl = gsicc_cache_new(base_mem)) == NULL ? gs_error_VMerror : code;
+            /* Rows of images that cross bands are only converted once. */
+            /* Not having the row cache just costs time. */
+            row_cache_size = gs_lib_ctx_get_image_row_cache_size(base_mem);
+            if (code >= 0 && row_cache_size > 0)
+                crdev->icc_cache_cl->row_cache = gsicc_rowcache_new(base_mem, row_cache_size);
         }
     }
 
@@ -704,6 +963,8 @@ clist_render_init(gx_device_clist *dev)
     crdev->offset_map = NULL;
     crdev->icc_table = NULL;
     crdev->color_usage_array = NULL;
+    crdev->band_index = NULL;
+    crdev->solid_band = 0;
     crdev->render_threads = NULL;
 
     return 0;
@@ -872,6 +1133,9 @@ clist_rasterize_lines(gx_device *dev, int y, int line_count,
 
         if (y < 0 || y > dev->height)
             return_error(gs_error_rangecheck);
+        /* Bands are normally rendered in order, so start reading the */
+        /* next one while we do this one.                             */
+        clist_prefetch_band(crdev, band + 1);
         code = crdev->buf_procs.setup_buf_device
             (bdev, mdata, raster, (byte **)mlines, 0, band_num_lines, band_num_lines);
         band_rect.p.x = 0;
@@ -902,6 +1166,71 @@ clist_rasterize_lines(gx_device *dev, int y, int line_count,
     return line_count;
 }
 
+/*
+ * Bands that nothing was drawn in only contain the commands written for
+ * the whole page. The only one of those that draws is fillpage, and the
+ * writer marks every band as drawn when that uses a halftone or pattern
+ * color, so the others all render the same way whatever their position.
+ * Once one of them has turned out to be a single solid color,
+ * the others are filled with that color instead of being played back.
+ * This is only done for whole bands of chunky memory devices whose rows
+ * are a whole number of bytes.
+ */
+static bool
+clist_band_is_undrawn(gx_device_clist_reader *crdev, const gs_int_rect *prect,
+                      gx_device *bdev, const gx_render_plane_t *render_plane)
+{
+    int band_height = crdev->page_band_height;
+    int band = prect->p.y / band_height;
+    int depth = bdev->color_info.depth;
+
+    if (crdev->solid_band < 0 || crdev->pages != NULL ||
+        crdev->color_usage_array == NULL ||
+        crdev->color_usage_array[band].drawn)
+        return false;
+    if ((render_plane != NULL && render_plane->index >= 0) ||
+        prect->p.x != 0 || prect->q.x != crdev->width ||
+        prect->p.y != band * band_height ||
+        prect->q.y != min(prect->p.y + band_height, crdev->height))
+        return false;
+    if (!gs_device_is_memory(bdev) || bdev->is_planar ||
+        bdev->width != crdev->width || depth > 64)
+        return false;
+    return (depth & 7) == 0 ||
+           (8 % depth == 0 && ((int64_t)crdev->width * depth & 7) == 0);
+}
+
+/* Check whether a rendered undrawn band is solid, or fill one that is */
+static void
+clist_solid_band(gx_device_clist_reader *crdev, gx_device *bdev,
+                 int num_lines, bool fill)
+{
+    gx_device_memory *mdev = (gx_device_memory *)bdev;
+    int depth = bdev->color_info.depth;
+    uint psize = (depth < 8 ? 1 : depth >> 3);
+    uint nbytes = (uint)(((int64_t)bdev->width * depth) >> 3);
+    byte *row0 = mdev->line_ptrs[0];
+    uint n;
+    int y;
+
+    if (fill) {
+        memcpy(row0, crdev->solid_band_pixel, min(psize, nbytes));
+        for (n = psize; n < nbytes; n += n)
+            memcpy(row0 + n, row0, min(n, nbytes - n));
+        for (y = 1; y < num_lines; y++)
+            memcpy(mdev->line_ptrs[y], row0, nbytes);
+        return;
+    }
+    crdev->solid_band = -1;
+    if (nbytes < psize || memcmp(row0 + psize, row0, nbytes - psize) != 0)
+        return;
+    for (y = 1; y < num_lines; y++)
+        if (memcmp(mdev->line_ptrs[y], row0, nbytes) != 0)
+            return;
+    memcpy(crdev->solid_band_pixel, row0, psize);
+    crdev->solid_band = 1;
+}
+
 /*
  * Render a rectangle to a client-supplied device.  There is no necessary
  * relationship between band boundaries and the region being rendered.
@@ -922,6 +1251,7 @@ clist_render_rectangle(gx_device_clist *cldev, const gs_int_rect *prect,
     int code = 0;
     int i;
     bool save_pageneutralcolor;
+    bool undrawn;
 
     if (render_plane)
         crdev->yplane = *render_plane;
@@ -929,6 +1259,13 @@ clist_render_rectangle(gx_device_clist *cldev, const gs_int_rect *prect,
         crdev->yplane.index = -1;
     if_debug2m('l', bdev->memory, "[l]rendering bands (%d,%d)\n", band_first, band_last);
 
+    undrawn = clist_band_is_undrawn(crdev, prect, bdev, render_plane);
+    if (undrawn && crdev->solid_band > 0) {
+        if_debug1m('l', bdev->memory, "[l]band %d is solid\n", band_first);
+        clist_solid_band(crdev, bdev, prect->q.y - prect->p.y, true);
+        return 0;
+    }
+
     ppages = crdev->pages;
 
     /* Before playing back the clist, make sure that the gray detection is disabled */
@@ -999,6 +1336,8 @@ clist_render_rectangle(gx_device_clist *cldev, const gs_int_rect *prect,
                                          prect->p.y);
     }
     crdev->icc_struct->pageneutralcolor = save_pageneutralcolor;	/* restore it */
+    if (undrawn && code >= 0)
+        clist_solid_band(crdev, bdev, prect->q.y - prect->p.y, false);
     return code;
 }
 
@@ -1024,6 +1363,13 @@ clist_playback_file_bands(clist_playback_action action,
     rs.band_first = band_first;
     rs.band_last = band_last;
     rs.page_info = *page_info;
+    /* The index is for the current page, and for reading a single band. */
+    rs.index = crdev->band_index;
+    if (rs.index != NULL &&
+        (page_info != &crdev->page_info || band_first != band_last ||
+         band_first < 0 || band_first >= rs.index->nbands ||
+         rs.index->bfile_end_pos != page_info->bfile_end_pos))
+        rs.index = NULL;
     rs.local_memory = mem;
 
     /* If this is a saved page, open the files. */
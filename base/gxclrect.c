@@ -321,6 +321,12 @@ clist_fillpage(gx_device * dev, gs_gstate *pgs, gx_drawing_color *pdcolor)
     code = cmd_put_drawing_color(cdev, pcls, pdcolor, NULL, devn_not_tile_fill);
     if (code >= 0)
         code = cmd_write_page_rect_cmd(cdev, cmd_op_fill_rect);
+    /* A halftone or pattern fill depends on where the band is, so bands */
+    /* with nothing else in them no longer all render the same way.      */
+    if (code >= 0 && !gx_dc_is_pure(pdcolor) && !gx_dc_is_devn(pdcolor)) {
+        for (pcls = cdev->states; pcls < cdev->states + cdev->nbands; pcls++)
+            pcls->color_usage.drawn = true;
+    }
     return code;
 }
 
@@ -38,9 +38,172 @@
 #include "gstrans.h"
 #include "gzht.h"		/* for gx_ht_cache_default_bits_size */
 
+/* Each rendering thread may run this many bands ahead of the band being */
+/* collected, so that one slow band doesn't leave the other threads idle. */
+/* Every band in flight needs its own band device, so this is only done  */
+/* when the extra devices fit within the memory limit (-K), see          */
+/* clist_render_bands_per_thread.                                        */
+#define CLIST_RENDER_BANDS_PER_THREAD 2
+
+/* Each band device takes memory from the shared (locked) allocator in */
+/* slabs of this size, rather than CHUNK_SIZE.                         */
+#define CLIST_RENDER_SLAB_SIZE (4 * CHUNK_SIZE)
+
+/* The most band devices a page can use, and so the most that are kept */
+/* from one page for the next (see clist_park_thread_device).          */
+#define CLIST_RENDER_MAX_DEVICES ((MAX_THREADS - 2) * CLIST_RENDER_BANDS_PER_THREAD)
+
 /* Forward reference prototypes */
-static int clist_start_render_thread(gx_device *dev, int thread_index, int band);
-static void clist_render_thread(void *param);
+static void clist_render_thread(clist_render_thread_control_t *thread);
+static void clist_render_worker(void *param);
+static int clist_grow_render_pool(gx_device *dev, int count);
+static void clist_post_render_work(gx_device_clist_reader *crdev);
+static void clist_stop_render_workers(gx_device_clist_reader *crdev);
+static int clist_render_thread_reserve(gx_device *dev, int *pdf14_size);
+static int clist_render_bands_per_thread(gs_memory_t *mem, int workers, size_t per_band, int kept);
+
+/* If the device ICC profile (or proof) is OI_PROFILE, then that was not handled
+ * by put/get params, and we cannot share the profiles between the 'parent' output device
+ * and the devices created for each thread. Thus we also cannot share the icc_struct.
+ * In this case we need to create a new icc_struct and clone the profiles.  The clone
+ * operation also initializes some of the required data
+ */
+#define DEV_PROFILE_IS(DEV, PROFILE, MATCH) \
+    ((DEV)->icc_struct != NULL &&\
+     (DEV)->icc_struct->PROFILE != NULL &&\
+     strcmp((DEV)->icc_struct->PROFILE->name, MATCH) == 0)
+
+static bool
+clist_thread_shares_icc_struct(gx_device *dev, bool bg_print)
+{
+    return !(bg_print ||
+             !gscms_is_threadsafe() ||
+             DEV_PROFILE_IS(dev, device_profile[GS_DEFAULT_DEVICE_PROFILE], OI_PROFILE) ||
+             DEV_PROFILE_IS(dev, proof_profile, OI_PROFILE));
+}
+
+/* Point a band device at the page in the main device's band files: open  */
+/* the files for reading, set the device up for rendering, and share (or,  */
+/* for background printing, read its own copy of) the tables of the page.  */
+static int
+clist_attach_thread_page(gx_device *dev, gx_device *ndev, bool bg_print, gsicc_link_cache_t **cachep)
+{
+    gx_device_clist_common *cdev = (gx_device_clist_common *)dev;
+    gx_device_clist_common *ncdev = (gx_device_clist_common *)ndev;
+    gs_memory_t *thread_mem = ndev->memory;
+    char fmode[4];
+    int code;
+
+    /* open the main thread's files for this thread */
+    strcpy(fmode, "r");                 /* read access for threads */
+    strncat(fmode, gp_fmode_binary_suffix, 1);
+    if ((code=cdev->page_info.io_procs->fopen(cdev->page_info.cfname, fmode, &ncdev->page_info.cfile,
+                        thread_mem, thread_mem, true)) < 0 ||
+         (code=cdev->page_info.io_procs->fopen(cdev->page_info.bfname, fmode, &ncdev->page_info.bfile,
+                        thread_mem, thread_mem, false)) < 0)
+        return code;
+
+    strcpy((ncdev->page_info.cfname), (cdev->page_info.cfname));
+    strcpy((ncdev->page_info.bfname), (cdev->page_info.bfname));
+    clist_render_init((gx_device_clist *)ndev);      /* Initialize clist device for reading */
+    ncdev->page_info.bfile_end_pos = cdev->page_info.bfile_end_pos;
+
+    /* The threads are maintained until clist_finish_page.  At which
+       point, the threads are torn down, the master clist reader device
+       is changed to writer, and the icc_table and the icc_cache_cl freed */
+    if (dev->icc_struct == ndev->icc_struct) {
+    /* safe to share the link cache */
+        ncdev->icc_cache_cl = cdev->icc_cache_cl;
+        rc_increment(cdev->icc_cache_cl);		/* FIXME: needs to be incdemented safely */
+    } else {
+        /* each thread needs its own link cache */
+        if (cachep != NULL) {
+            if (*cachep == NULL) {
+                /* We don't have one cached that we can reuse, so make one. */
+                if ((*cachep = gsicc_cache_new(thread_mem->thread_safe_memory)) == NULL)
+                    return_error(gs_error_VMerror);
+            }
+            rc_increment(*cachep);
+                ncdev->icc_cache_cl = *cachep;
+        } else if ((ncdev->icc_cache_cl = gsicc_cache_new(thread_mem->thread_safe_memory)) == NULL)
+            return_error(gs_error_VMerror);
+        /* The converted image rows of the page can still be shared */
+        if (ncdev->icc_cache_cl->row_cache != cdev->icc_cache_cl->row_cache) {
+            gsicc_rowcache_adjust(ncdev->icc_cache_cl->row_cache, -1,
+                                  "setup_device_and_mem_for_thread");
+            ncdev->icc_cache_cl->row_cache = cdev->icc_cache_cl->row_cache;
+            gsicc_rowcache_adjust(ncdev->icc_cache_cl->row_cache, 1,
+                                  "setup_device_and_mem_for_thread");
+        }
+    }
+    if (bg_print) {
+        gx_device_clist_reader *ncrdev = (gx_device_clist_reader *)ncdev;
+
+        if (cdev->icc_table != NULL) {
+            /* This is a background printing thread, so it cannot share the icc_table  */
+            /* since this probably was created with a GC'ed allocator and the bg_print */
+            /* thread can't deal with the relocation. Free the cdev->icc_table and get */
+            /* a new one from the clist.                                               */
+            clist_free_icc_table(cdev->icc_table, cdev->memory);
+            cdev->icc_table = NULL;
+            if ((code = clist_read_icctable((gx_device_clist_reader *)ncdev)) < 0)
+                return code;
+        }
+        /* Similarly for the color_usage_array, when the foreground device switches to */
+        /* writer mode, the foreground's array will be freed.                          */
+        if ((code = clist_read_color_usage_array(ncrdev)) < 0)
+            return code;
+        if ((code = clist_read_band_index(ncrdev)) < 0)
+            return code;
+    } else {
+    /* Use the same profile table, color usage array and band index in each thread */
+        ncdev->icc_table = cdev->icc_table;		/* OK for multiple rendering threads */
+        ((gx_device_clist_reader *)ncdev)->color_usage_array =
+                ((gx_device_clist_reader *)cdev)->color_usage_array;
+        ((gx_device_clist_reader *)ncdev)->band_index =
+                ((gx_device_clist_reader *)cdev)->band_index;
+    }
+    /* Needed for case when the target has cielab profile and pdf14 device
+       has a RGB profile stored in the profile list of the clist */
+    ncdev->trans_dev_icc_hash = cdev->trans_dev_icc_hash;
+    return 0;
+}
+
+/* Undo clist_attach_thread_page: close the band files (but don't unlink  */
+/* them) and let go of the tables of the page, so the device can be freed */
+/* or kept for the next page.                                             */
+static void
+clist_detach_thread_page(gx_device *dev, bool bg_print)
+{
+    gx_device_clist_common *thread_cdev = (gx_device_clist_common *)dev;
+    gx_device_clist_reader *thread_crdev = (gx_device_clist_reader *)dev;
+
+    if (!bg_print) {
+        /* make sure these don't get freed by gdev_prn_free_memory */
+        thread_crdev->color_usage_array = NULL;
+        thread_crdev->band_index = NULL;
+
+        /* For non-bg_print cases the icc_table is shared between devices, but
+         * is not reference counted or anything. We rely on it being shared with
+         * and owned by the "parent" device in the interpreter thread, hence
+         * null it here to avoid it being freed as we cleanup the thread device.
+         */
+        thread_crdev->icc_table = NULL;
+    }
+    rc_decrement(thread_crdev->icc_cache_cl, "teardown_render_thread");
+    thread_crdev->icc_cache_cl = NULL;
+    /* If this thread was being used for background printing and NumRenderingThreads > 0 */
+    /* the clist_setup_render_threads may have already closed these files                */
+    /* Note that in the case of back ground printing, we only want to close the instance  */
+    /* of the files for the reader (hence the final parameter being false). We'll clean  */
+    /* the original instance of the files in prn_finish_bg_print()                       */
+    if (thread_cdev->page_info.bfile != NULL)
+        thread_cdev->page_info.io_procs->fclose(thread_cdev->page_info.bfile, thread_cdev->page_info.bfname, false);
+    if (thread_cdev->page_info.cfile != NULL)
+        thread_cdev->page_info.io_procs->fclose(thread_cdev->page_info.cfile, thread_cdev->page_info.cfname, false);
+    thread_cdev->page_info.bfile = thread_cdev->page_info.cfile = NULL;
+    thread_cdev->do_not_open_or_close_bandfiles = true; /* we already closed the files */
+}
 
 /* clone a device and set params and its chunk memory                   */
 /* The chunk_base_mem MUST be thread safe                               */
@@ -51,13 +214,11 @@ gx_device *
 setup_device_and_mem_for_thread(gs_memory_t *chunk_base_mem, gx_device *dev, bool bg_print, gsicc_link_cache_t **cachep)
 {
     int i, code;
-    char fmode[4];
     gs_memory_t *thread_mem;
     gx_device_clist *cldev = (gx_device_clist *)dev;
     gx_device_printer *pdev = (gx_device_printer *)dev;
     gx_device_clist_common *cdev = (gx_device_clist_common *)cldev;
     gx_device *ndev;
-    gx_device_clist *ncldev;
     gx_device_clist_common *ncdev;
     gx_device_printer *npdev;
     gx_device *protodev;
@@ -69,9 +230,21 @@ setup_device_and_mem_for_thread(gs_memory_t *chunk_base_mem, gx_device *dev, boo
 
     /* Every thread will have a 'chunk allocator' to reduce the interaction
      * with the 'base' allocator which has 'mutex' (locking) protection.
-     * This improves performance of the threads.
+     * This improves performance of the threads. Rendering threads free and
+     * allocate the same large buffers band after band, so they also keep
+     * up to the memory reserved for them at startup (which is what the
+     * base allocator's limit was checked against) of freed large blocks.
      */
-    if ((code = gs_memory_chunk_wrap(&(thread_mem), chunk_base_mem )) < 0) {
+    if (bg_print)
+        code = gs_memory_chunk_wrap_thread(&thread_mem, chunk_base_mem, CLIST_RENDER_SLAB_SIZE, 0);
+    else {
+        int pdf14_size;
+        int reserve = clist_render_thread_reserve(dev, &pdf14_size);
+
+        code = gs_memory_chunk_wrap_thread(&thread_mem, chunk_base_mem, CLIST_RENDER_SLAB_SIZE,
+                                           reserve + pdf14_size);
+    }
+    if (code < 0) {
         emprintf1(dev->memory, "chunk_wrap returned error code: %d\n", code);
         return NULL;
     }
@@ -87,7 +260,6 @@ setup_device_and_mem_for_thread(gs_memory_t *chunk_base_mem, gx_device *dev, boo
         gs_memory_chunk_release(thread_mem);
         return NULL;
     }
-    ncldev = (gx_device_clist *)ndev;
     ncdev = (gx_device_clist_common *)ndev;
     npdev = (gx_device_printer *)ndev;
     gx_device_fill_in_procs(ndev);
@@ -104,24 +276,12 @@ setup_device_and_mem_for_thread(gs_memory_t *chunk_base_mem, gx_device *dev, boo
     ndev->is_planar = dev->is_planar;
     ndev->icc_struct = NULL;
 
-    /* If the device ICC profile (or proof) is OI_PROFILE, then that was not handled
-     * by put/get params, and we cannot share the profiles between the 'parent' output device
-     * and the devices created for each thread. Thus we also cannot share the icc_struct.
-     * In this case we need to create a new icc_struct and clone the profiles.  The clone
-     * operation also initializes some of the required data
-     * We need to do this *before* the gs_getdeviceparams/gs_putdeviceparams so gs_putdeviceparams
-     * will spot the same profile being used, and treat it as a no-op. Otherwise it will try to find
-     * a profile with the 'special' name "OI_PROFILE" and throw an error.
+    /* We need to set up the icc_struct *before* the gs_getdeviceparams/gs_putdeviceparams
+     * so gs_putdeviceparams will spot the same profile being used, and treat it as a no-op.
+     * Otherwise it will try to find a profile with the 'special' name "OI_PROFILE" and
+     * throw an error.
      */
-#define DEV_PROFILE_IS(DEV, PROFILE, MATCH) \
-    ((DEV)->icc_struct != NULL &&\
-     (DEV)->icc_struct->PROFILE != NULL &&\
-     strcmp((DEV)->icc_struct->PROFILE->name, MATCH) == 0)
-
-    if (bg_print ||
-        !gscms_is_threadsafe() ||
-        DEV_PROFILE_IS(dev, device_profile[GS_DEFAULT_DEVICE_PROFILE], OI_PROFILE) ||
-        DEV_PROFILE_IS(dev, proof_profile, OI_PROFILE)) {
+    if (!clist_thread_shares_icc_struct(dev, bg_print)) {
         ndev->icc_struct = gsicc_new_device_profile_array(ndev);
         if (!ndev->icc_struct) {
             emprintf1(ndev->memory,
@@ -224,67 +384,9 @@ setup_device_and_mem_for_thread(gs_memory_t *chunk_base_mem, gx_device *dev, boo
     ncdev->page_info.io_procs->fclose(ncdev->page_info.bfile, ncdev->page_info.bfname, true);
     ncdev->page_info.cfile = ncdev->page_info.bfile = NULL;
 
-    /* open the main thread's files for this thread */
-    strcpy(fmode, "r");                 /* read access for threads */
-    strncat(fmode, gp_fmode_binary_suffix, 1);
-    if ((code=cdev->page_info.io_procs->fopen(cdev->page_info.cfname, fmode, &ncdev->page_info.cfile,
-                        thread_mem, thread_mem, true)) < 0 ||
-         (code=cdev->page_info.io_procs->fopen(cdev->page_info.bfname, fmode, &ncdev->page_info.bfile,
-                        thread_mem, thread_mem, false)) < 0)
+    if ((code = clist_attach_thread_page(dev, ndev, bg_print, cachep)) < 0)
         goto out_cleanup;
 
-    strcpy((ncdev->page_info.cfname), (cdev->page_info.cfname));
-    strcpy((ncdev->page_info.bfname), (cdev->page_info.bfname));
-    clist_render_init(ncldev);      /* Initialize clist device for reading */
-    ncdev->page_info.bfile_end_pos = cdev->page_info.bfile_end_pos;
-
-    /* The threads are maintained until clist_finish_page.  At which
-       point, the threads are torn down, the master clist reader device
-       is changed to writer, and the icc_table and the icc_cache_cl freed */
-    if (dev->icc_struct == ndev->icc_struct) {
-    /* safe to share the link cache */
-        ncdev->icc_cache_cl = cdev->icc_cache_cl;
-        rc_increment(cdev->icc_cache_cl);		/* FIXME: needs to be incdemented safely */
-    } else {
-        /* each thread needs its own link cache */
-        if (cachep != NULL) {
-            if (*cachep == NULL) {
-                /* We don't have one cached that we can reuse, so make one. */
-                if ((*cachep = gsicc_cache_new(thread_mem->thread_safe_memory)) == NULL)
-                    goto out_cleanup;
-            }
-            rc_increment(*cachep);
-                ncdev->icc_cache_cl = *cachep;
-        } else if ((ncdev->icc_cache_cl = gsicc_cache_new(thread_mem->thread_safe_memory)) == NULL)
-            goto out_cleanup;
-    }
-    if (bg_print) {
-        gx_device_clist_reader *ncrdev = (gx_device_clist_reader *)ncdev;
-
-        if (cdev->icc_table != NULL) {
-            /* This is a background printing thread, so it cannot share the icc_table  */
-            /* since this probably was created with a GC'ed allocator and the bg_print */
-            /* thread can't deal with the relocation. Free the cdev->icc_table and get */
-            /* a new one from the clist.                                               */
-            clist_free_icc_table(cdev->icc_table, cdev->memory);
-            cdev->icc_table = NULL;
-            if ((code = clist_read_icctable((gx_device_clist_reader *)ncdev)) < 0)
-                goto out_cleanup;
-        }
-        /* Similarly for the color_usage_array, when the foreground device switches to */
-        /* writer mode, the foreground's array will be freed.                          */
-        if ((code = clist_read_color_usage_array(ncrdev)) < 0)
-            goto out_cleanup;
-    } else {
-    /* Use the same profile table and color usage array in each thread */
-        ncdev->icc_table = cdev->icc_table;		/* OK for multiple rendering threads */
-        ((gx_device_clist_reader *)ncdev)->color_usage_array =
-                ((gx_device_clist_reader *)cdev)->color_usage_array;
-    }
-    /* Needed for case when the target has cielab profile and pdf14 device
-       has a RGB profile stored in the profile list of the clist */
-    ncdev->trans_dev_icc_hash = cdev->trans_dev_icc_hash;
-
     /* success */
     return ndev;
 
@@ -303,6 +405,156 @@ out_cleanup:
     return NULL;
 }
 
+/* Set up a band device kept from an earlier page to render this page.   */
+/* That is only possible if the page has the same size, depth and bands  */
+/* as the one the device was made for, so that its band buffer and clist */
+/* state still fit. Returns < 0 if they don't, and the caller then frees */
+/* the device (see teardown_device_and_mem_for_thread) and makes another. */
+static int
+clist_reuse_thread_device(gx_device *dev, gx_device *ndev, gsicc_link_cache_t **cachep)
+{
+    gx_device_printer *pdev = (gx_device_printer *)dev;
+    gx_device_clist_common *cdev = (gx_device_clist_common *)dev;
+    gx_device_printer *npdev = (gx_device_printer *)ndev;
+    gx_device_clist_common *ncdev = (gx_device_clist_common *)ndev;
+    gdev_space_params space_params;
+    gs_c_param_list paramlist;
+    int code;
+
+    if (ndev->width != dev->width || ndev->height != dev->height ||
+        ndev->color_info.depth != dev->color_info.depth ||
+        ndev->color_info.num_components != dev->color_info.num_components ||
+        ndev->pad != dev->pad || ndev->log2_align_mod != dev->log2_align_mod ||
+        ncdev->is_planar != cdev->is_planar || ncdev->nbands != cdev->nbands ||
+        ncdev->page_info.band_params.BandHeight != cdev->page_info.band_params.BandHeight ||
+        ncdev->page_info.tile_cache_size != cdev->page_info.tile_cache_size)
+        return_error(gs_error_rangecheck);
+
+    /* The device must still share the icc_struct, or have its own copy of */
+    /* the same profiles, as setup_device_and_mem_for_thread would give it. */
+    if (clist_thread_shares_icc_struct(dev, false)) {
+        if (ndev->icc_struct != dev->icc_struct)
+            return_error(gs_error_rangecheck);
+    } else {
+        cmm_profile_t *proof = dev->icc_struct->proof_profile;
+        cmm_profile_t *nproof = ndev->icc_struct->proof_profile;
+
+        if (ndev->icc_struct == dev->icc_struct ||
+            ndev->icc_struct->device_profile[GS_DEFAULT_DEVICE_PROFILE]->hashcode !=
+                dev->icc_struct->device_profile[GS_DEFAULT_DEVICE_PROFILE]->hashcode ||
+            (proof == NULL) != (nproof == NULL) ||
+            (proof != NULL && proof->hashcode != nproof->hashcode))
+            return_error(gs_error_rangecheck);
+    }
+
+    /* Pick up any parameters changed since the last page, but keep the */
+    /* band space the device was allocated with.                        */
+    ndev->PageCount = dev->PageCount;       /* copy to prevent mismatch error */
+    npdev->file = pdev->file;
+    strcpy((npdev->fname), (pdev->fname));
+    ndev->color_info = dev->color_info;
+    space_params = ncdev->space_params;
+    gs_c_param_list_write(&paramlist, ndev->memory);
+    if ((code = gs_getdeviceparams(dev, (gs_param_list *)&paramlist)) >= 0) {
+        gs_c_param_list_read(&paramlist);
+        code = gs_putdeviceparams(ndev, (gs_param_list *)&paramlist);
+    }
+    gs_c_param_list_release(&paramlist);
+    ncdev->space_params = space_params;
+    if (code < 0)
+        return code;
+
+    if (dev_proc(dev, ret_devn_params)(dev) != NULL) {
+        devn_free_params(ndev);
+        if ((code = devn_copy_params(dev, ndev)) < 0)
+            return code;
+    }
+    ndev->icc_struct->supports_devn = cdev->icc_struct->supports_devn;
+    ncdev->page_uses_transparency = cdev->page_uses_transparency;
+
+    return clist_attach_thread_page(dev, ndev, false, cachep);
+}
+
+/* Keep a band device, with its allocator, for the next page rather than */
+/* freeing it. Returns false if there is no room to keep it.             */
+static bool
+clist_park_thread_device(gx_device *dev, gx_device *ndev)
+{
+    gx_device_clist_common *cdev = (gx_device_clist_common *)dev;
+
+    if (cdev->render_spares == NULL) {
+        cdev->render_spares = (gx_device **)gs_alloc_byte_array(cdev->memory->thread_safe_memory,
+                                    CLIST_RENDER_MAX_DEVICES, sizeof(gx_device *),
+                                    "clist_park_thread_device");
+        if (cdev->render_spares == NULL)
+            return false;
+    }
+    if (cdev->render_spare_len >= CLIST_RENDER_MAX_DEVICES)
+        return false;
+    clist_detach_thread_page(ndev, false);
+    /* The band buffers were swapped around as the bands were collected, */
+    /* so give the device back its own.                                  */
+    ((gx_device_clist_common *)ndev)->data = ((gx_device_printer *)ndev)->buf;
+    cdev->render_spares[cdev->render_spare_len++] = ndev;
+    return true;
+}
+
+/* Estimate the memory each rendering thread will need besides its band */
+/* buffer: space for the halftone cache plus 2Mb for other allocations   */
+/* during rendering (paths, etc.), increased by the measured profile     */
+/* storage and icclinks (estimated). The estimate for the pdf14 buffers  */
+/* is returned separately.                                               */
+static int
+clist_render_thread_reserve(gx_device *dev, int *pdf14_size)
+{
+    gx_device_clist_reader *crdev = &((gx_device_clist *)dev)->reader;
+    int reserve_size = 2 * 1024 * 1024 + (gx_ht_cache_default_bits_size() * dev->color_info.num_components);
+    clist_icctable_entry_t *curr_entry;
+    bool deep = device_is_deep(dev);
+
+    *pdf14_size = 0;
+    if (crdev->page_uses_transparency) {
+        *pdf14_size = (ESTIMATED_PDF14_ROW_SPACE(max(1, crdev->width), crdev->color_info.num_components, deep ? 16 : 8) >> 3);
+        *pdf14_size *= crdev->page_info.band_params.BandHeight;	/* BandHeight set by writer */
+    }
+    /* scan the profile table sizes to get the total each thread will need */
+    if (crdev->icc_table != NULL) {
+        for (curr_entry = crdev->icc_table->head; curr_entry != NULL; curr_entry = curr_entry->next) {
+            reserve_size += curr_entry->serial_data.size;
+            /* FIXME: Should actually measure the icclink size to device (or pdf14 blend space) */
+            reserve_size += 2 * 1024 * 1024;		/* a worst case estimate */
+        }
+    }
+    return reserve_size;
+}
+
+/* Decide how many band devices each rendering thread gets. Running */
+/* ahead only pays while the band buffers stay in memory, so if a    */
+/* memory limit is set and the extra band devices would take more    */
+/* than half of what is left under it, use one band per thread. The  */
+/* 'kept' band devices from the last page count as available, since  */
+/* they will be used again (or freed).                               */
+static int
+clist_render_bands_per_thread(gs_memory_t *mem, int workers, size_t per_band, int kept)
+{
+    gs_memory_status_t mem_status;
+    size_t avail;
+
+    gs_memory_status(mem, &mem_status);
+    if (mem_status.limit == 0 || mem_status.limit == max_size_t)
+        return CLIST_RENDER_BANDS_PER_THREAD;
+    avail = mem_status.limit > mem_status.allocated ? mem_status.limit - mem_status.allocated : 0;
+    avail += (size_t)kept * per_band;
+    if (per_band > 0 &&
+        (size_t)workers * (CLIST_RENDER_BANDS_PER_THREAD - 1) > (avail / 2) / per_band) {
+        if (gs_debug[':'] != 0)
+            dmprintf2(mem, "%% Memory limit: rendering %d bands at a time, not %d.\n",
+                      workers, workers * CLIST_RENDER_BANDS_PER_THREAD);
+        return 1;
+    }
+    return CLIST_RENDER_BANDS_PER_THREAD;
+}
+
 /* Set up and start the render threads */
 static int
 clist_setup_render_threads(gx_device *dev, int y, gx_process_page_options_t *options)
@@ -319,35 +571,30 @@ clist_setup_render_threads(gx_device *dev, int y, gx_process_page_options_t *opt
     int band_count = cdev->nbands;
     int band_height = crdev->page_info.band_params.BandHeight;
     byte **reserve_memory_array = NULL;
-    int reserve_pdf14_memory_size = 0;
-    /* space for the halftone cache plus 2Mb for other allocations during rendering (paths, etc.) */
-    /* this will be increased by the measured profile storage and icclinks (estimated).		  */
-    int reserve_size = 2 * 1024 * 1024 + (gx_ht_cache_default_bits_size() * dev->color_info.num_components);
-    clist_icctable_entry_t *curr_entry;
-    bool deep = device_is_deep(dev);
+    int reserve_pdf14_memory_size;
+    int reserve_size = clist_render_thread_reserve(dev, &reserve_pdf14_memory_size);
+    int reused = 0;
 
-    crdev->num_render_threads = pdev->num_render_threads_requested;
+    crdev->num_render_workers = pdev->num_render_threads_requested;
 
     if(gs_debug[':'] != 0)
         dmprintf1(mem, "%% %d rendering threads requested.\n", pdev->num_render_threads_requested);
 
-    if (crdev->page_uses_transparency) {
-        reserve_pdf14_memory_size = (ESTIMATED_PDF14_ROW_SPACE(max(1, crdev->width), crdev->color_info.num_components, deep ? 16 : 8) >> 3);
-        reserve_pdf14_memory_size *= crdev->page_info.band_params.BandHeight;	/* BandHeight set by writer */
-    }
-    /* scan the profile table sizes to get the total each thread will need */
-    if (crdev->icc_table != NULL) {
-        for (curr_entry = crdev->icc_table->head; curr_entry != NULL; curr_entry = curr_entry->next) {
-            reserve_size += curr_entry->serial_data.size;
-            /* FIXME: Should actually measure the icclink size to device (or pdf14 blend space) */
-            reserve_size += 2 * 1024 * 1024;		/* a worst case estimate */
-        }
-    }
-    if (crdev->num_render_threads > band_count)
-        crdev->num_render_threads = band_count; /* don't bother starting more threads than bands */
+    if (crdev->num_render_workers > band_count)
+        crdev->num_render_workers = band_count; /* don't bother starting more threads than bands */
     /* don't exceed our limit (allow for BGPrint and main thread) */
-    if (crdev->num_render_threads > MAX_THREADS - 2)
-        crdev->num_render_threads = MAX_THREADS - 2;
+    if (crdev->num_render_workers > MAX_THREADS - 2)
+        crdev->num_render_workers = MAX_THREADS - 2;
+    /* Each band in flight (rendering, or rendered and waiting to be collected) */
+    /* needs its own band device, so allow for the threads running ahead.       */
+    crdev->num_render_threads = crdev->num_render_workers *
+        clist_render_bands_per_thread(chunk_base_mem, crdev->num_render_workers,
+                                      (size_t)crdev->page_info.band_params.BandBufferSpace +
+                                      crdev->page_info.tile_cache_size +
+                                      reserve_size + reserve_pdf14_memory_size,
+                                      cdev->render_spare_len);
+    if (crdev->num_render_threads > band_count)
+        crdev->num_render_threads = band_count;
 
     /* Allocate and initialize an array of thread control structures */
     crdev->render_threads = (clist_render_thread_control_t *)
@@ -403,6 +650,23 @@ clist_setup_render_threads(gx_device *dev, int y, gx_process_page_options_t *opt
         gs_free_object(mem, old, "clist_render_setup_threads");
     }
 
+    /* Make sure there are enough persistent threads to render the bands, */
+    /* and set up the shared queue the threads take bands from.           */
+    if ((code = clist_grow_render_pool(dev, crdev->num_render_workers)) < 0 ||
+        (crdev->render_lock = gx_monitor_label(gx_monitor_alloc(mem), "Band queue")) == NULL ||
+        (crdev->render_idle = gx_semaphore_label(gx_semaphore_alloc(mem), "Band idle")) == NULL) {
+        if (code >= 0)
+            code = gs_note_error(gs_error_VMerror);
+        gx_monitor_free(crdev->render_lock);
+        crdev->render_lock = NULL;
+        gs_free_object(mem, reserve_memory_array, "clist_setup_render_threads");
+        gs_free_object(mem, crdev->render_threads, "clist_setup_render_threads");
+        crdev->render_threads = NULL;
+        emprintf1(mem, "Rendering threads not started, code=%d.\n", code);
+        return code;
+    }
+    crdev->render_stop = false;
+
     /* Loop creating the devices and semaphores for each thread, then start them */
     for (i=0; (i < crdev->num_render_threads) && (band >= 0) && (band < band_count);
             i++, band += crdev->thread_lookahead_direction) {
@@ -417,7 +681,18 @@ clist_setup_render_threads(gx_device *dev, int y, gx_process_page_options_t *opt
             code = gs_error_VMerror;	/* set code to an error for cleanup after the loop */
         break;
         }
-        ndev = setup_device_and_mem_for_thread(chunk_base_mem, dev, false, &crdev->icc_cache_list[i]);
+        /* Use a band device kept from the last page if it fits this one */
+        ndev = NULL;
+        while (ndev == NULL && cdev->render_spare_len > 0) {
+            ndev = cdev->render_spares[--cdev->render_spare_len];
+            if (clist_reuse_thread_device(dev, ndev, &crdev->icc_cache_list[i]) < 0) {
+                teardown_device_and_mem_for_thread(ndev, NULL, false);
+                ndev = NULL;
+            } else
+                reused++;
+        }
+        if (ndev == NULL)
+            ndev = setup_device_and_mem_for_thread(chunk_base_mem, dev, false, &crdev->icc_cache_list[i]);
         if (ndev == NULL) {
             code = gs_error_VMerror;	/* set code to an error for cleanup after the loop */
             break;
@@ -445,10 +720,13 @@ clist_setup_render_threads(gx_device *dev, int y, gx_process_page_options_t *opt
             code = gs_error_VMerror;
             break;
         }
-        /* We don't start the threads yet until we  free up the */
-        /* reserve memory we have allocated for that band. */
-        thread->band = band;
+        /* The band is claimed by whichever thread renders it (see   */
+        /* clist_render_worker), so leave this one idle for now.      */
+        thread->status = THREAD_IDLE;
     }
+    /* Free any kept band devices this page didn't need */
+    while (cdev->render_spare_len > 0)
+        teardown_device_and_mem_for_thread(cdev->render_spares[--cdev->render_spare_len], NULL, false);
     /* If the code < 0, the last thread creation failed -- clean it up */
     if (code < 0) {
         /* NB: 'band' will be the one that failed, so will be the next_band needed to start */
@@ -490,6 +768,10 @@ clist_setup_render_threads(gx_device *dev, int y, gx_process_page_options_t *opt
         }
         gs_free_object(mem, crdev->render_threads, "clist_setup_render_threads");
         crdev->render_threads = NULL;
+        gx_monitor_free(crdev->render_lock);
+        gx_semaphore_free(crdev->render_idle);
+        crdev->render_lock = NULL;
+        crdev->render_idle = NULL;
         /* restore the file pointers */
         if (cdev->page_info.cfile == NULL) {
             char fmode[4];
@@ -510,20 +792,29 @@ clist_setup_render_threads(gx_device *dev, int y, gx_process_page_options_t *opt
      * threads since we deferred that in the thread setup loop above.
      * We know if we get here we can start at least 1 thread.
      */
-    for (j=0, code = 0; j<crdev->num_render_threads; j++) {
+    for (j=0; j<crdev->num_render_threads; j++)
         gs_free_object(mem, reserve_memory_array[j], "clist_setup_render_threads");
-        if (code == 0 && j < i)
-            code = clist_start_render_thread(dev, j, crdev->render_threads[j].band);
-    }
     gs_free_object(mem, reserve_memory_array, "clist_setup_render_threads");
     crdev->num_render_threads = i;
-    crdev->curr_render_thread = 0;
-    crdev->next_band = band;
+    if (crdev->num_render_workers > i)
+        crdev->num_render_workers = i;
+    crdev->next_band = y / band_height;
+
+    /* Hand the page to the threads and let them start taking bands */
+    gx_monitor_enter(crdev->render_lock);
+    for (j=0; j<crdev->num_render_workers; j++) {
+        crdev->render_pool[j]->crdev = crdev;
+        crdev->render_pool[j]->waiting = false;
+        gx_semaphore_signal(crdev->render_pool[j]->sema_start);
+    }
+    clist_post_render_work(crdev);
+    gx_monitor_leave(crdev->render_lock);
 
     if(gs_debug[':'] != 0)
-        dmprintf1(mem, "%% Using %d rendering threads\n", i);
+        dmprintf3(mem, "%% Using %d rendering threads, %d band buffers (%d kept from the last page)\n",
+                  crdev->num_render_workers, i, reused);
 
-    return code;
+    return 0;
 }
 
 /* This is also exported for teardown after background printing */
@@ -545,42 +836,27 @@ teardown_device_and_mem_for_thread(gx_device *dev, gp_thread_id thread_id, bool
         clist_free_icc_table(thread_crdev->icc_table, thread_memory);
         thread_crdev->icc_table = NULL;
         /* NB: gdev_prn_free_memory below will free the color_usage_array */
-    } else {
-        /* make sure this doesn't get freed by gdev_prn_free_memory below */
-        ((gx_device_clist_reader *)thread_cdev)->color_usage_array = NULL;
-
-        /* For non-bg_print cases the icc_table is shared between devices, but
-         * is not reference counted or anything. We rely on it being shared with
-         * and owned by the "parent" device in the interpreter thread, hence
-         * null it here to avoid it being freed as we cleanup the thread device.
-         */
-        thread_crdev->icc_table = NULL;
     }
-    rc_decrement(thread_crdev->icc_cache_cl, "teardown_render_thread");
-    thread_crdev->icc_cache_cl = NULL;
     /*
      * Free the BufferSpace, close the band files, optionally unlinking them.
      * We unlink the files if this call is cleaning up from bg printing.
      * Note that the BufferSpace is freed using 'ppdev->buf' so the 'data'
      * pointer doesn't need to be the one that the thread started with
      */
-    /* If this thread was being used for background printing and NumRenderingThreads > 0 */
-    /* the clist_setup_render_threads may have already closed these files                */
-    /* Note that in the case of back ground printing, we only want to close the instance  */
-    /* of the files for the reader (hence the final parameter being false). We'll clean  */
-    /* the original instance of the files in prn_finish_bg_print()                       */
-    if (thread_cdev->page_info.bfile != NULL)
-        thread_cdev->page_info.io_procs->fclose(thread_cdev->page_info.bfile, thread_cdev->page_info.bfname, false);
-    if (thread_cdev->page_info.cfile != NULL)
-        thread_cdev->page_info.io_procs->fclose(thread_cdev->page_info.cfile, thread_cdev->page_info.cfname, false);
-    thread_cdev->page_info.bfile = thread_cdev->page_info.cfile = NULL;
-    thread_cdev->do_not_open_or_close_bandfiles = true; /* we already closed the files */
+    clist_detach_thread_page(dev, bg_print);
 
     gdev_prn_free_memory((gx_device *)thread_cdev);
     /* Free the device copy this thread used.  Note that the
        deviceN stuff if was allocated and copied earlier for the device
        will be freed with this call and the icc_struct ref count will be decremented. */
     gs_free_object(thread_memory, thread_cdev, "clist_teardown_render_threads");
+    if (gs_debug[':'] != 0) {
+        gs_memory_status_t mem_status;
+
+        gs_memory_status(thread_memory, &mem_status);
+        dmprintf1(thread_memory, "%% rendering thread peak memory use %"PRIuSIZE" bytes.\n",
+                  mem_status.max_used);
+    }
 #ifdef DEBUG
     dmprintf(thread_memory, "rendering thread ending memory state...\n");
     gs_memory_chunk_dump_memory(thread_memory);
@@ -600,12 +876,7 @@ clist_teardown_render_threads(gx_device *dev)
 
     if (crdev->render_threads != NULL) {
         /* Wait for all threads to finish */
-        for (i = (crdev->num_render_threads - 1); i >= 0; i--) {
-            clist_render_thread_control_t *thread = &(crdev->render_threads[i]);
-
-            if (thread->status == THREAD_BUSY)
-                gx_semaphore_wait(thread->sema_this);
-        }
+        clist_stop_render_workers(crdev);
         /* then free each thread's memory */
         for (i = (crdev->num_render_threads - 1); i >= 0; i--) {
             clist_render_thread_control_t *thread = &(crdev->render_threads[i]);
@@ -635,10 +906,17 @@ clist_teardown_render_threads(gx_device *dev)
                 dmprintf2(thread->memory, "%% Thread %d total usertime=%ld msec\n", i, thread->cputime);
             dmprintf1(thread->memory, "\nThread %d ", i);
 #endif
-            teardown_device_and_mem_for_thread((gx_device *)thread_cdev, thread->thread, false);
+            /* The OS thread is persistent, so there is nothing to 'finish' here, */
+            /* and the device is kept for the next page if there is room.         */
+            if (!clist_park_thread_device(dev, (gx_device *)thread_cdev))
+                teardown_device_and_mem_for_thread((gx_device *)thread_cdev, NULL, false);
         }
         gs_free_object(mem, crdev->render_threads, "clist_teardown_render_threads");
         crdev->render_threads = NULL;
+        gx_monitor_free(crdev->render_lock);
+        gx_semaphore_free(crdev->render_idle);
+        crdev->render_lock = NULL;
+        crdev->render_idle = NULL;
 
         /* Now re-open the clist temp files so we can write to them */
         if (cdev->page_info.cfile == NULL) {
@@ -656,29 +934,240 @@ clist_teardown_render_threads(gx_device *dev)
     }
 }
 
+/* Make sure the device has at least 'count' persistent rendering threads */
 static int
-clist_start_render_thread(gx_device *dev, int thread_index, int band)
+clist_grow_render_pool(gx_device *dev, int count)
 {
-    gx_device_clist *cldev = (gx_device_clist *)dev;
-    gx_device_clist_reader *crdev = &cldev->reader;
+    gx_device_clist_common *cdev = (gx_device_clist_common *)dev;
+    gs_memory_t *mem = cdev->memory->thread_safe_memory;
+    clist_render_worker_t **old = cdev->render_pool;
     int code;
 
-    crdev->render_threads[thread_index].band = band;
-    crdev->render_threads[thread_index].status = THREAD_BUSY;
+    if (count <= cdev->render_pool_len)
+        return 0;
+    cdev->render_pool = (clist_render_worker_t **)gs_alloc_byte_array(mem, count,
+                                sizeof(clist_render_worker_t *), "clist_grow_render_pool");
+    if (cdev->render_pool == NULL) {
+        cdev->render_pool = old;
+        return_error(gs_error_VMerror);
+    }
+    if (cdev->render_pool_len > 0)
+        memcpy(cdev->render_pool, old, cdev->render_pool_len * sizeof(clist_render_worker_t *));
+    gs_free_object(mem, old, "clist_grow_render_pool");
 
-    /* Finally, fire it up */
-    code = gp_thread_start(clist_render_thread,
-                           &(crdev->render_threads[thread_index]),
-                           &(crdev->render_threads[thread_index].thread));
-    gp_thread_label(crdev->render_threads[thread_index].thread, "Band");
+    while (cdev->render_pool_len < count) {
+        clist_render_worker_t *worker = (clist_render_worker_t *)gs_alloc_bytes(mem,
+                                sizeof(clist_render_worker_t), "clist_grow_render_pool");
 
-    return code;
+        if (worker == NULL)
+            return_error(gs_error_VMerror);
+        worker->crdev = NULL;
+        worker->waiting = false;
+        worker->thread = NULL;
+        if ((worker->sema_start = gx_semaphore_label(gx_semaphore_alloc(mem), "Band start")) == NULL) {
+            gs_free_object(mem, worker, "clist_grow_render_pool");
+            return_error(gs_error_VMerror);
+        }
+        if ((code = gp_thread_start(clist_render_worker, worker, &worker->thread)) < 0) {
+            gx_semaphore_free(worker->sema_start);
+            gs_free_object(mem, worker, "clist_grow_render_pool");
+            return code;
+        }
+        gp_thread_label(worker->thread, "Band");
+        cdev->render_pool[cdev->render_pool_len++] = worker;
+    }
+    return 0;
+}
+
+void
+clist_free_render_pool(gx_device *dev)
+{
+    gx_device_clist_common *cdev = (gx_device_clist_common *)dev;
+    gs_memory_t *mem = cdev->memory->thread_safe_memory;
+    int i;
+
+    for (i = 0; i < cdev->render_pool_len; i++) {
+        clist_render_worker_t *worker = cdev->render_pool[i];
+
+        /* A NULL page tells the thread to exit once it is idle */
+        worker->crdev = NULL;
+        gx_semaphore_signal(worker->sema_start);
+        gp_thread_finish(worker->thread);
+        gx_semaphore_free(worker->sema_start);
+        gs_free_object(mem, worker, "clist_free_render_pool");
+    }
+    gs_free_object(mem, cdev->render_pool, "clist_free_render_pool");
+    cdev->render_pool = NULL;
+    cdev->render_pool_len = 0;
+
+    /* Free the band devices kept for the next page */
+    while (cdev->render_spare_len > 0)
+        teardown_device_and_mem_for_thread(cdev->render_spares[--cdev->render_spare_len], NULL, false);
+    gs_free_object(mem, cdev->render_spares, "clist_free_render_pool");
+    cdev->render_spares = NULL;
+}
+
+/* Count the bands that are still to be taken by a rendering thread */
+static int
+clist_bands_remaining(gx_device_clist_reader *crdev)
+{
+    if (crdev->next_band < 0 || crdev->next_band >= crdev->nbands)
+        return 0;
+    return crdev->thread_lookahead_direction > 0 ?
+                crdev->nbands - crdev->next_band : crdev->next_band + 1;
 }
 
+/* Wake a waiting thread for each band that an idle band device could  */
+/* take now. Must be called with render_lock held.                      */
+/* NB: each thread waits on its own semaphore, since a gp_semaphore     */
+/* may not wake every waiter when several are signalled at once.        */
 static void
-clist_render_thread(void *data)
+clist_post_render_work(gx_device_clist_reader *crdev)
+{
+    gx_device_clist_common *cdev = (gx_device_clist_common *)crdev;
+    int i, idle = 0;
+    int remaining = clist_bands_remaining(crdev);
+
+    for (i = 0; i < crdev->num_render_threads; i++)
+        if (crdev->render_threads[i].status == THREAD_IDLE)
+            idle++;
+    if (idle > remaining)
+        idle = remaining;
+    for (i = 0; i < crdev->num_render_workers && idle > 0; i++) {
+        clist_render_worker_t *worker = cdev->render_pool[i];
+
+        if (worker->waiting) {
+            worker->waiting = false;
+            gx_semaphore_signal(worker->sema_start);
+            idle--;
+        }
+    }
+}
+
+/* Take the next band to render, and an idle band device to render it */
+/* with. Must be called with render_lock held. Returns NULL if there   */
+/* is nothing to do.                                                   */
+static clist_render_thread_control_t *
+clist_claim_band(gx_device_clist_reader *crdev)
+{
+    int i;
+
+    if (clist_bands_remaining(crdev) == 0)
+        return NULL;
+    for (i = 0; i < crdev->num_render_threads; i++) {
+        clist_render_thread_control_t *thread = &(crdev->render_threads[i]);
+
+        if (thread->status == THREAD_IDLE) {
+            thread->band = crdev->next_band;
+            thread->status = THREAD_BUSY;
+            crdev->next_band += crdev->thread_lookahead_direction;
+            return thread;
+        }
+    }
+    return NULL;
+}
+
+/* Find the band device that has (or is rendering) 'band'. Must be called */
+/* with render_lock held.                                                 */
+static clist_render_thread_control_t *
+clist_find_band(gx_device_clist_reader *crdev, int band)
+{
+    int i;
+
+    for (i = 0; i < crdev->num_render_threads; i++) {
+        clist_render_thread_control_t *thread = &(crdev->render_threads[i]);
+
+        if (thread->status != THREAD_IDLE && thread->band == band)
+            return thread;
+    }
+    return NULL;
+}
+
+/* Stop the threads taking any more bands, wait for the bands in flight, */
+/* and discard them. Every band device is left idle.                      */
+static void
+clist_drain_render_threads(gx_device_clist_reader *crdev)
+{
+    int i;
+
+    gx_monitor_enter(crdev->render_lock);
+    crdev->next_band = -1;
+    gx_monitor_leave(crdev->render_lock);
+    /* Nothing can be claimed now, so the non-idle set can't grow */
+    for (i = 0; i < crdev->num_render_threads; i++) {
+        clist_render_thread_control_t *thread = &(crdev->render_threads[i]);
+
+        if (thread->status != THREAD_IDLE) {
+            gx_semaphore_wait(thread->sema_this);
+            thread->status = THREAD_IDLE;
+            thread->band = -1;
+        }
+    }
+}
+
+/* Wait for the threads to finish with this page, and return them to the pool */
+static void
+clist_stop_render_workers(gx_device_clist_reader *crdev)
+{
+    gx_device_clist_common *cdev = (gx_device_clist_common *)crdev;
+    int i;
+
+    clist_drain_render_threads(crdev);
+    gx_monitor_enter(crdev->render_lock);
+    crdev->render_stop = true;
+    for (i = 0; i < crdev->num_render_workers; i++) {
+        clist_render_worker_t *worker = cdev->render_pool[i];
+
+        if (worker->waiting) {
+            worker->waiting = false;
+            gx_semaphore_signal(worker->sema_start);
+        }
+    }
+    gx_monitor_leave(crdev->render_lock);
+    for (i = 0; i < crdev->num_render_workers; i++)
+        gx_semaphore_wait(crdev->render_idle);
+}
+
+/* The body of each persistent rendering thread. Each time it is handed a */
+/* page it takes bands from the page's queue until the page is finished.  */
+static void
+clist_render_worker(void *data)
+{
+    clist_render_worker_t *worker = (clist_render_worker_t *)data;
+    gx_device_clist_reader *crdev;
+    clist_render_thread_control_t *thread;
+    int next_band;
+
+    for (;;) {
+        gx_semaphore_wait(worker->sema_start);
+        crdev = worker->crdev;
+        if (crdev == NULL)
+            break;
+        gx_monitor_enter(crdev->render_lock);
+        while (!crdev->render_stop) {
+            thread = clist_claim_band(crdev);
+            next_band = crdev->next_band;
+            if (thread == NULL)
+                worker->waiting = true;     /* nothing to take yet, so wait to be woken */
+            gx_monitor_leave(crdev->render_lock);
+            if (thread != NULL) {
+                /* Start reading in the band that will be taken next, */
+                /* so that it is ready by the time a thread is free.   */
+                clist_prefetch_band((gx_device_clist_reader *)thread->cdev, next_band);
+                clist_render_thread(thread);
+            } else
+                gx_semaphore_wait(worker->sema_start);
+            gx_monitor_enter(crdev->render_lock);
+        }
+        worker->crdev = NULL;
+        gx_monitor_leave(crdev->render_lock);
+        gx_semaphore_signal(crdev->render_idle);
+    }
+}
+
+static void
+clist_render_thread(clist_render_thread_control_t *thread)
 {
-    clist_render_thread_control_t *thread = (clist_render_thread_control_t *)data;
     gx_device *dev = thread->cdev;
     gx_device_clist *cldev = (gx_device_clist *)dev;
     gx_device_clist_reader *crdev = &cldev->reader;
@@ -742,8 +1231,10 @@ clist_render_thread(void *data)
  * device (the main thread)
  * Return 0 if OK, < 0 is the error code from the thread
  *
- * After swapping the pointers, start up the completed thread with the
- * next band remaining to do (if any)
+ * Bands may complete in any order; the band devices holding completed
+ * bands act as a reorder buffer, and are collected here in the order
+ * the caller asks for them. After swapping the pointers, the band device
+ * is free for the threads to take the next band remaining (if any)
  */
 static int
 clist_get_band_from_thread(gx_device *dev, int band_needed, gx_process_page_options_t *options)
@@ -751,86 +1242,87 @@ clist_get_band_from_thread(gx_device *dev, int band_needed, gx_process_page_opti
     gx_device_clist *cldev = (gx_device_clist *)dev;
     gx_device_clist_common *cdev = (gx_device_clist_common *)dev;
     gx_device_clist_reader *crdev = &cldev->reader;
-    int i, code = 0;
-    int thread_index = crdev->curr_render_thread;
-    clist_render_thread_control_t *thread = &(crdev->render_threads[thread_index]);
-    gx_device_clist_common *thread_cdev = (gx_device_clist_common *)thread->cdev;
+    int code = 0;
+    clist_render_thread_control_t *thread;
+    gx_device_clist_common *thread_cdev;
     int band_height = crdev->page_info.band_params.BandHeight;
     int band_count = cdev->nbands;
     byte *tmp;                  /* for swapping data areas */
+    bool claimed = false;
+
+    gx_monitor_enter(crdev->render_lock);
+    thread = clist_find_band(crdev, band_needed);
+    if (thread == NULL && band_needed == crdev->next_band) {
+        /* No thread has taken this band yet, so rather than wait, take it */
+        /* and render it on this thread.                                    */
+        thread = clist_claim_band(crdev);
+        if (thread != NULL)
+            claimed = true;
+    }
+    gx_monitor_leave(crdev->render_lock);
 
-    /* We expect that the thread needed will be the 'current' thread */
-    if (thread->band != band_needed) {
-        int band = band_needed;
-
-        emprintf3(thread->memory,
-                  "thread->band = %d, band_needed = %d, direction = %d, ",
-                  thread->band, band_needed, crdev->thread_lookahead_direction);
+    if (claimed)
+        clist_render_thread(thread);
+    /* We expect that the band needed will be rendered or in progress */
+    if (thread == NULL) {
+        emprintf2(dev->memory,
+                  "band_needed = %d, direction = %d, ",
+                  band_needed, crdev->thread_lookahead_direction);
 
         /* Probably we went in the wrong direction, so let the threads */
         /* all complete, then restart them in the opposite direction   */
         /* If the caller is 'bouncing around' we may end up back here, */
         /* but that is a VERY rare case (we haven't seen it yet).      */
-        for (i=0; i < crdev->num_render_threads; i++) {
-            clist_render_thread_control_t *thread = &(crdev->render_threads[i]);
-
-            if (thread->status == THREAD_BUSY)
-                gx_semaphore_wait(thread->sema_this);
-        }
+        clist_drain_render_threads(crdev);
         crdev->thread_lookahead_direction *= -1;      /* reverse direction (but may be overruled below) */
         if (band_needed == band_count-1)
             crdev->thread_lookahead_direction = -1;   /* assume backwards if we are asking for the last band */
         if (band_needed == 0)
             crdev->thread_lookahead_direction = 1;    /* force forward if we are looking for band 0 */
 
-        dmprintf1(thread->memory, "new_direction = %d\n", crdev->thread_lookahead_direction);
-
-        /* Loop starting the threads in the new lookahead_direction */
-        for (i=0; (i < crdev->num_render_threads) && (band >= 0) && (band < band_count);
-                i++, band += crdev->thread_lookahead_direction) {
-            thread = &(crdev->render_threads[i]);
-            thread->band = -1;          /* a value that won't match any valid band */
-            /* Start thread 'i' to do band */
-            if ((code = clist_start_render_thread(dev, i, band)) < 0)
-                break;
-        }
-        crdev->next_band = i;			/* may be < 0 or == band_count, but that is handled later */
-        crdev->curr_render_thread = thread_index = 0;
-        thread = &(crdev->render_threads[0]);
-        thread_cdev = (gx_device_clist_common *)thread->cdev;
+        dmprintf1(dev->memory, "new_direction = %d\n", crdev->thread_lookahead_direction);
+
+        /* Restart the threads in the new lookahead_direction */
+        gx_monitor_enter(crdev->render_lock);
+        crdev->next_band = band_needed;
+        thread = clist_claim_band(crdev);
+        clist_post_render_work(crdev);
+        gx_monitor_leave(crdev->render_lock);
+        if (thread == NULL)
+            return_error(gs_error_rangecheck);
+        clist_render_thread(thread);
     }
-    /* Wait for this thread */
+    thread_cdev = (gx_device_clist_common *)thread->cdev;
+
+    /* Wait for this band */
     gx_semaphore_wait(thread->sema_this);
-    gp_thread_finish(thread->thread);
-    thread->thread = NULL;
-    if (thread->status == THREAD_ERROR)
+    if (thread->status == THREAD_ERROR) {
+        gx_monitor_enter(crdev->render_lock);
+        thread->status = THREAD_IDLE;
+        thread->band = -1;
+        gx_monitor_leave(crdev->render_lock);
         return_error(gs_error_unknownerror);          /* FAIL */
+    }
 
-    if (options && options->output_fn) {
+    if (options && options->output_fn)
         code = options->output_fn(options->arg, dev, thread->buffer);
-        if (code < 0)
-            return code;
-    }
 
     /* Swap the data areas to avoid the copy */
     tmp = cdev->data;
     cdev->data = thread_cdev->data;
     thread_cdev->data = tmp;
-    thread->status = THREAD_IDLE;        /* the data is no longer valid */
-    thread->band = -1;
     /* Update the bounds for this band */
     cdev->ymin =  band_needed * band_height;
     cdev->ymax =  cdev->ymin + band_height;
     if (cdev->ymax > dev->height)
         cdev->ymax = dev->height;
 
-    if (crdev->next_band >= 0 && crdev->next_band < band_count) {
-        code = clist_start_render_thread(dev, thread_index, crdev->next_band);
-        crdev->next_band += crdev->thread_lookahead_direction;
-    }
-    /* bump the 'curr' to the next thread */
-    crdev->curr_render_thread = crdev->curr_render_thread == crdev->num_render_threads - 1 ?
-                0 : crdev->curr_render_thread + 1;
+    /* The data is no longer valid, so the band device can take another band */
+    gx_monitor_enter(crdev->render_lock);
+    thread->status = THREAD_IDLE;
+    thread->band = -1;
+    clist_post_render_work(crdev);
+    gx_monitor_leave(crdev->render_lock);
 
     return code;
 }
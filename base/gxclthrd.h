@@ -55,7 +55,6 @@ struct clist_render_thread_control_s {
     gx_device *cdev;	/* clist device copy */
     gx_device *bdev;	/* this thread's buffer device */
     int band;
-    gp_thread_id thread;
 
     /* For process_page mode */
     gx_process_page_options_t *options;
@@ -65,4 +64,17 @@ struct clist_render_thread_control_s {
 #endif
 };
 
+/* The OS threads that do the band rendering are persistent. They are    */
+/* kept by the clist device from page to page (see clist_close), and are */
+/* handed each page to render by setting 'crdev' and signalling          */
+/* 'sema_start'. They then take bands from the page's queue until the    */
+/* page is finished, waiting on 'sema_start' again whenever there is no  */
+/* band they can take. A NULL 'crdev' asks the thread to exit.           */
+struct clist_render_worker_s {
+    gp_thread_id thread;
+    gx_semaphore_t *sema_start;
+    gx_device_clist_reader *crdev;
+    bool waiting;		/* waiting for a band (protected by render_lock) */
+};
+
 #endif /* gxclthrd_INCLUDED */
@@ -408,6 +408,13 @@ cmd_put_list_op(gx_device_clist_writer * cldev, cmd_list * pcl, uint size)
         pcl->tail = cp;
         cldev->ccl = pcl;
         cp->size = size;
+        /* Anything written for a single band may draw in it */
+        if (pcl != cldev->band_range_list) {
+            gx_clist_state *pcls = (gx_clist_state *)
+                ((byte *)pcl - offset_of(gx_clist_state, list));
+
+            pcls->color_usage.drawn = true;
+        }
     }
     cldev->cnext = dp + size;
     return dp;
@@ -110,6 +110,7 @@ extern_st(st_device_clip);
     gx_device_finalize)
 void gx_make_clip_device_on_stack(gx_device_clip * dev, const gx_clip_path *pcpath, gx_device *target);
 void gx_destroy_clip_device_on_stack(gx_device_clip * dev);
+gx_device *gx_copy_clip_device_on_stack(gx_device_clip * copy, const gx_device *dev);
 gx_device *gx_make_clip_device_on_stack_if_needed(gx_device_clip * dev, const gx_clip_path *pcpath, gx_device *target, gs_fixed_rect *rect);
 void gx_make_clip_device_in_heap(gx_device_clip * dev, const gx_clip_path *pcpath, gx_device *target,
                               gs_memory_t *mem);
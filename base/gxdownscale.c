@@ -3239,7 +3239,9 @@ static int downscaler_process_fn(void *arg_, gx_device *dev, gx_device *bdev, co
     code = dev_proc(bdev, get_bits_rectangle)(bdev, &in_rect, &params);
     if (code < 0)
         return code;
-    raster_in = params.raster;
+    /* A returned pointer need not come with a raster. */
+    raster_in = (params.options & GB_RASTER_SPECIFIED ? params.raster :
+                 gx_device_raster(bdev, true));
     in_ptr = params.data[0];
 
     /* Where do we write it to? */
@@ -3247,7 +3249,8 @@ static int downscaler_process_fn(void *arg_, gx_device *dev, gx_device *bdev, co
         code = dev_proc(bdev, get_bits_rectangle)(buffer->bdev, &out_rect, &params);
         if (code < 0)
             return code;
-        raster_out = params.raster;
+        raster_out = (params.options & GB_RASTER_SPECIFIED ? params.raster :
+                      gx_device_raster(buffer->bdev, true));
         out_ptr = params.data[0];
     } else {
         raster_out = raster_in;
@@ -38,6 +38,7 @@ typedef struct gx_ttfReader_s gx_ttfReader;
 typedef struct ttfInterpreter_s ttfInterpreter;
 typedef struct gx_ttfMemory_s gx_ttfMemory;
 typedef struct gx_device_spot_analyzer_s gx_device_spot_analyzer;
+typedef struct gx_ttf_outline_cache_s gx_ttf_outline_cache;
 
 /*
  * Define the entry for a cached (font,matrix) pair.  If the UID
@@ -261,6 +262,8 @@ struct gs_font_dir_s {
     /* User parameter GridFitTT. */
     uint grid_fit_tt;
     gx_device_spot_analyzer *san;
+    /* Grid fitted TrueType outlines, not in GC memory (see gxttfb.c). */
+    gx_ttf_outline_cache *tt_outlines;
     int (*global_glyph_code)(const gs_font *pfont, gs_const_string *gstr, gs_glyph *pglyph);
     ulong text_enum_id; /* debug purpose only. */
 };
@@ -304,6 +307,7 @@ int  gx_provide_fm_pair_attributes(gs_font_dir * dir,
 int  gx_touch_fm_pair(gs_font_dir *dir, cached_fm_pair *pair);
 
 void gs_clean_fm_pair(gs_font_dir * dir, cached_fm_pair * pair);
+void gx_ttf_outline_cache_free(gs_font_dir * dir); /* in gxttfb.c */
 int  gs_purge_fm_pair(gs_font_dir *, cached_fm_pair *, int);
 int  gs_purge_font_from_char_caches(gs_font *);
 int  gs_purge_font_from_char_caches_completely(gs_font * font);
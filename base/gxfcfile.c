@@ -0,0 +1,407 @@
+/* Copyright (C) 2001-2023 Artifex Software, Inc.
+   All Rights Reserved.
+
+   This software is provided AS-IS with no warranty, either express or
+   implied.
+
+   This software is distributed under license and may not be copied,
+   modified or distributed except as expressly authorized under the terms
+   of the license contained in the file LICENSE in this distribution.
+
+   Refer to licensing information at http://www.artifex.com or contact
+   Artifex Software, Inc.,  1305 Grant Avenue - Suite 200, Novato,
+   CA 94945, U.S.A., +1(415)492-9861, for further information.
+*/
+
+
+/* Persistent glyph cache file */
+
+#include "memory_.h"
+#include "string_.h"
+#include "gx.h"
+#include "gp.h"
+#include "gserrors.h"
+#include "gssprintf.h"
+#include "gxfcfile.h"
+
+/*
+ * The file starts with the magic string "GSFC", the format number and the
+ * client's version string.  Each record is then
+ *      magic, key, data size, checksum, data
+ * with all numbers 32 bit little-endian, and the checksum taken over the
+ * key and the data.
+ */
+#define FCF_FORMAT 1
+#define FCF_RECORD_MAGIC 0x43455247	/* "GREC" */
+#define FCF_RECORD_HEADER_SIZE (4 + gx_font_cache_file_key_size + 4 + 4)
+/*
+ * Records are appended with a single buffered write, which stdio only
+ * passes to the system as one write if it fits in the buffer.  Larger
+ * records could be interleaved with another process's, so we keep them in
+ * memory only.
+ */
+#define FCF_MAX_FILE_RECORD 4096
+
+typedef struct fcf_entry_s {
+    const byte *key;		/* followed by the data */
+    const byte *data;
+    uint size;
+} fcf_entry;
+
+/* Records added by this process, chained for freeing. */
+typedef struct fcf_added_s fcf_added;
+struct fcf_added_s {
+    fcf_added *next;
+};
+
+struct gx_font_cache_file_s {
+    gs_memory_t *memory;
+    gp_file *out;		/* append stream, NULL if we can't write */
+    gs_offset_t file_size;
+    size_t max_size;
+    byte *contents;		/* the file as read when opened */
+    fcf_entry *table;		/* open hash table, keyed by digest */
+    uint table_size;		/* a power of 2 */
+    uint count;
+    fcf_added *added;
+};
+
+static uint
+fcf_get32(const byte *p)
+{
+    return p[0] | (p[1] << 8) | (p[2] << 16) | ((uint)p[3] << 24);
+}
+
+static void
+fcf_put32(byte *p, uint v)
+{
+    p[0] = (byte)v;
+    p[1] = (byte)(v >> 8);
+    p[2] = (byte)(v >> 16);
+    p[3] = (byte)(v >> 24);
+}
+
+/* FNV-1a */
+static uint
+fcf_checksum(const byte *key, const byte *data, uint size)
+{
+    uint h = 2166136261u;
+    uint i;
+
+    for (i = 0; i < gx_font_cache_file_key_size; i++)
+        h = (h ^ key[i]) * 16777619u;
+    for (i = 0; i < size; i++)
+        h = (h ^ data[i]) * 16777619u;
+    return h;
+}
+
+static fcf_entry *
+fcf_find(const gx_font_cache_file *pfcf, const byte *key)
+{
+    /* The keys are digests, so any 4 bytes of them hash well enough. */
+    uint mask = pfcf->table_size - 1;
+    uint i = fcf_get32(key) & mask;
+
+    for (;; i = (i + 1) & mask) {
+        fcf_entry *pe = &pfcf->table[i];
+
+        if (pe->key == NULL ||
+            !memcmp(pe->key, key, gx_font_cache_file_key_size))
+            return pe;
+    }
+}
+
+static int
+fcf_insert(gx_font_cache_file *pfcf, const byte *key, const byte *data,
+           uint size)
+{
+    fcf_entry *pe;
+
+    if ((pfcf->count + 1) * 4 > pfcf->table_size * 3) {
+        uint old_size = pfcf->table_size;
+        fcf_entry *old_table = pfcf->table;
+        uint new_size = (old_size == 0 ? 256 : old_size * 2);
+        fcf_entry *new_table = (fcf_entry *)
+            gs_alloc_byte_array(pfcf->memory, new_size, sizeof(fcf_entry),
+                                "fcf_insert");
+        uint i;
+
+        if (new_table == NULL)
+            return_error(gs_error_VMerror);
+        memset(new_table, 0, new_size * sizeof(fcf_entry));
+        pfcf->table = new_table;
+        pfcf->table_size = new_size;
+        for (i = 0; i < old_size; i++)
+            if (old_table[i].key != NULL)
+                *fcf_find(pfcf, old_table[i].key) = old_table[i];
+        gs_free_object(pfcf->memory, old_table, "fcf_insert");
+    }
+    pe = fcf_find(pfcf, key);
+    if (pe->key == NULL)
+        pfcf->count++;
+    pe->key = key;
+    pe->data = data;
+    pe->size = size;
+    return 0;
+}
+
+static uint
+fcf_make_header(byte *buf, const char *version)
+{
+    uint len = strlen(version);
+
+    memcpy(buf, "GSFC", 4);
+    fcf_put32(buf + 4, FCF_FORMAT);
+    fcf_put32(buf + 8, len);
+    memcpy(buf + 12, version, len);
+    return 12 + len;
+}
+
+/* Index the records of a file we have read.  A record left incomplete */
+/* by a process that died while appending is skipped, along with anything */
+/* else that isn't a good record, by looking for the next record magic. */
+static int
+fcf_read_records(gx_font_cache_file *pfcf, const byte *p, const byte *end)
+{
+    while (end - p >= FCF_RECORD_HEADER_SIZE) {
+        const byte *key = p + 4;
+        uint size = fcf_get32(key + gx_font_cache_file_key_size);
+        const byte *data = p + FCF_RECORD_HEADER_SIZE;
+        int code;
+
+        if (fcf_get32(p) != FCF_RECORD_MAGIC ||
+            size > FCF_MAX_FILE_RECORD || size > end - data ||
+            fcf_get32(key + gx_font_cache_file_key_size + 4) !=
+                fcf_checksum(key, data, size)) {
+            p++;
+            continue;
+        }
+        code = fcf_insert(pfcf, key, data, size);
+        if (code < 0)
+            return code;
+        p = data + size;
+    }
+    return 0;
+}
+
+/*
+ * Replace a file written by another version with one holding only our
+ * header.  The new file is written beside the old one, under a name made
+ * from the time and an address so that no other process writes to it, and
+ * renamed over it, so readers see either the old file or the new.  There
+ * is no portable file locking, so if two processes replace the file at
+ * once, the appends of the one that renames first are lost; they only cost
+ * the glyphs being rendered again.
+ */
+static int
+fcf_replace(gs_memory_t *mem, const char *fname, const byte *header,
+            uint hlen)
+{
+    char tname[gp_file_name_sizeof];
+    long t[2];
+    uint h;
+    gp_file *f;
+    int code = 0;
+
+    gp_get_realtime(t);
+    h = ((uint)t[0] * 1000003u + (uint)t[1]) * 31 + (uint)(size_t)&t;
+    if (strlen(fname) + 14 >= sizeof(tname))
+        return_error(gs_error_rangecheck);
+    /* The name must match the permission given in gslibctx.c. */
+    gs_snprintf(tname, sizeof(tname), "%s.%08x.new", fname, h);
+    f = gp_fopen(mem, tname, "wb");
+    if (f == NULL)
+        return_error(gs_error_invalidfileaccess);
+    if (gp_fwrite(header, 1, hlen, f) != hlen)
+        code = gs_note_error(gs_error_ioerror);
+    if (gp_fclose(f) != 0 && code == 0)
+        code = gs_note_error(gs_error_ioerror);
+    if (code == 0 && gp_rename(mem, tname, fname) != 0)
+        code = gs_note_error(gs_error_invalidfileaccess);
+    if (code < 0)
+        gp_unlink(mem, tname);
+    return code;
+}
+
+int
+gx_font_cache_file_open(gs_memory_t *mem, const char *fname,
+                        const char *version, size_t max_size,
+                        gx_font_cache_file **ppfcf)
+{
+    gx_font_cache_file *pfcf;
+    uint vlen = strlen(version);
+    byte *header = NULL;
+    uint hlen;
+    gp_file *f;
+    bool usable = false;        /* the file can be appended to */
+    bool replace = false;       /* the file was written by another version */
+    gs_offset_t length = 0;
+    int code = 0;
+
+    *ppfcf = NULL;
+    pfcf = (gx_font_cache_file *)gs_alloc_bytes(mem, sizeof(*pfcf),
+                                                "gx_font_cache_file_open");
+    header = gs_alloc_bytes(mem, 12 + vlen, "gx_font_cache_file_open");
+    if (pfcf == NULL || header == NULL) {
+        code = gs_note_error(gs_error_VMerror);
+        goto fail;
+    }
+    memset(pfcf, 0, sizeof(*pfcf));
+    pfcf->memory = mem;
+    pfcf->max_size = max_size;
+    hlen = fcf_make_header(header, version);
+
+    /* Read whatever the file holds now. */
+    f = gp_fopen(mem, fname, "rb");
+    if (f != NULL) {
+        if (gp_fseek(f, 0, SEEK_END) == 0)
+            length = gp_ftell(f);
+        if (length > (gs_offset_t)max_size)
+            length = max_size;
+        if (length >= hlen) {
+            pfcf->contents = gs_alloc_bytes(mem, length,
+                                            "gx_font_cache_file_open");
+            if (pfcf->contents == NULL) {
+                gp_fclose(f);
+                code = gs_note_error(gs_error_VMerror);
+                goto fail;
+            }
+            gp_rewind(f);
+            length = gp_fread(pfcf->contents, 1, length, f);
+            if (length >= hlen && !memcmp(pfcf->contents, header, hlen)) {
+                code = fcf_read_records(pfcf, pfcf->contents + hlen,
+                                        pfcf->contents + length);
+                if (code < 0) {
+                    gp_fclose(f);
+                    goto fail;
+                }
+                usable = true;
+            } else
+                replace = true;
+        } else if (length == 0)
+            usable = true;
+        /* Otherwise another process may be writing the header: leave it. */
+        gp_fclose(f);
+    } else
+        usable = true;
+    if (replace) {
+        gs_free_object(mem, pfcf->contents, "gx_font_cache_file_open");
+        pfcf->contents = NULL;
+        if (fcf_replace(mem, fname, header, hlen) < 0) {
+            /* Carry on without the file. */
+            if_debug1m('k', mem, "[k]can't replace glyph cache file %s\n",
+                       fname);
+            goto done;
+        }
+        usable = true;
+    }
+    if (!usable)
+        goto done;
+    pfcf->out = gp_fopen(mem, fname, "ab");
+    if (pfcf->out != NULL) {
+        if (gp_fseek(pfcf->out, 0, SEEK_END) == 0)
+            pfcf->file_size = gp_ftell(pfcf->out);
+        if (pfcf->file_size == 0) {
+            /* A new file. Should another process create it at the same */
+            /* time, its header is skipped as a bad record. */
+            if (gp_fwrite(header, 1, hlen, pfcf->out) == hlen)
+                gp_fflush(pfcf->out);
+            pfcf->file_size = hlen;
+        }
+        if (gp_ferror(pfcf->out)) {
+            gp_fclose(pfcf->out);
+            pfcf->out = NULL;
+        }
+    }
+done:
+    if_debug3m('k', mem, "[k]glyph cache file %s: %u glyphs%s\n", fname,
+               pfcf->count, (pfcf->out == NULL ? ", read only" : ""));
+    gs_free_object(mem, header, "gx_font_cache_file_open");
+    *ppfcf = pfcf;
+    return 0;
+fail:
+    gs_free_object(mem, header, "gx_font_cache_file_open");
+    gx_font_cache_file_close(pfcf);
+    return code;
+}
+
+void
+gx_font_cache_file_close(gx_font_cache_file *pfcf)
+{
+    gs_memory_t *mem;
+
+    if (pfcf == NULL)
+        return;
+    mem = pfcf->memory;
+    if (pfcf->out != NULL)
+        gp_fclose(pfcf->out);
+    while (pfcf->added != NULL) {
+        fcf_added *next = pfcf->added->next;
+
+        gs_free_object(mem, pfcf->added, "gx_font_cache_file_close");
+        pfcf->added = next;
+    }
+    gs_free_object(mem, pfcf->table, "gx_font_cache_file_close");
+    gs_free_object(mem, pfcf->contents, "gx_font_cache_file_close");
+    gs_free_object(mem, pfcf, "gx_font_cache_file_close");
+}
+
+const byte *
+gx_font_cache_file_lookup(gx_font_cache_file *pfcf, const byte *key,
+                          uint *psize)
+{
+    fcf_entry *pe;
+
+    if (pfcf->table == NULL)
+        return NULL;
+    pe = fcf_find(pfcf, key);
+    if (pe->key == NULL)
+        return NULL;
+    *psize = pe->size;
+    return pe->data;
+}
+
+int
+gx_font_cache_file_add(gx_font_cache_file *pfcf, const byte *key,
+                       const byte *data, uint size)
+{
+    uint rsize = FCF_RECORD_HEADER_SIZE + size;
+    fcf_added *padd;
+    byte *record;
+    int code;
+
+    if (pfcf->table != NULL && fcf_find(pfcf, key)->key != NULL)
+        return 0;
+    /* Keep the record in file form, so it can be written as it is. */
+    padd = (fcf_added *)gs_alloc_bytes(pfcf->memory, sizeof(fcf_added) + rsize,
+                                       "gx_font_cache_file_add");
+    if (padd == NULL)
+        return_error(gs_error_VMerror);
+    record = (byte *)(padd + 1);
+    fcf_put32(record, FCF_RECORD_MAGIC);
+    memcpy(record + 4, key, gx_font_cache_file_key_size);
+    fcf_put32(record + 4 + gx_font_cache_file_key_size, size);
+    fcf_put32(record + 8 + gx_font_cache_file_key_size,
+              fcf_checksum(key, data, size));
+    memcpy(record + FCF_RECORD_HEADER_SIZE, data, size);
+    code = fcf_insert(pfcf, record + 4, record + FCF_RECORD_HEADER_SIZE, size);
+    if (code < 0) {
+        gs_free_object(pfcf->memory, padd, "gx_font_cache_file_add");
+        return code;
+    }
+    padd->next = pfcf->added;
+    pfcf->added = padd;
+
+    if (pfcf->out != NULL && rsize <= FCF_MAX_FILE_RECORD &&
+        pfcf->file_size + rsize <= (gs_offset_t)pfcf->max_size) {
+        if (gp_fwrite(record, 1, rsize, pfcf->out) == rsize)
+            gp_fflush(pfcf->out);
+        if (gp_ferror(pfcf->out)) {
+            /* Give up writing, but keep what we have in memory. */
+            gp_fclose(pfcf->out);
+            pfcf->out = NULL;
+        } else
+            pfcf->file_size += rsize;
+    }
+    return 0;
+}
@@ -0,0 +1,67 @@
+/* Copyright (C) 2001-2023 Artifex Software, Inc.
+   All Rights Reserved.
+
+   This software is provided AS-IS with no warranty, either express or
+   implied.
+
+   This software is distributed under license and may not be copied,
+   modified or distributed except as expressly authorized under the terms
+   of the license contained in the file LICENSE in this distribution.
+
+   Refer to licensing information at http://www.artifex.com or contact
+   Artifex Software, Inc.,  1305 Grant Avenue - Suite 200, Novato,
+   CA 94945, U.S.A., +1(415)492-9861, for further information.
+*/
+
+
+/* Persistent glyph cache file */
+
+#ifndef gxfcfile_INCLUDED
+#  define gxfcfile_INCLUDED
+
+#include "std.h"
+#include "gsmemory.h"
+
+/*
+ * A font cache file holds rendered glyphs from one run of Ghostscript to
+ * the next, so that short jobs needn't rasterise the same fonts at the same
+ * sizes again.  The cache doesn't know what it holds: a client supplies a
+ * digest of everything that determines the glyph as the key, and an opaque
+ * record of the result as the value.
+ *
+ * The file is a header followed by records that are only ever appended, each
+ * written with a single write and carrying a checksum.  When opened, the
+ * file is read into memory once, skipping any incomplete or damaged record,
+ * so any number of processes may read and append to the same file at once
+ * without locking.  The file is never rewritten while in use, except that
+ * one written by a different version (as described by the client's version
+ * string) is replaced.  The file is not allowed to grow beyond max_size
+ * bytes; once it is full, new glyphs are only kept in memory.
+ */
+typedef struct gx_font_cache_file_s gx_font_cache_file;
+
+#define gx_font_cache_file_key_size 16
+
+#ifndef GX_FONT_CACHE_FILE_MAX_SIZE
+#  define GX_FONT_CACHE_FILE_MAX_SIZE (64 * 1024 * 1024)
+#endif
+
+/* Open (or create) a cache file.  *ppfcf is left NULL if the file can't */
+/* be used; this isn't an error. */
+int gx_font_cache_file_open(gs_memory_t *mem, const char *fname,
+                            const char *version, size_t max_size,
+                            gx_font_cache_file **ppfcf);
+
+/* Close a cache file and free everything it holds. */
+void gx_font_cache_file_close(gx_font_cache_file *pfcf);
+
+/* Look up a key, returning the record (valid until the cache is closed) */
+/* or NULL. */
+const byte *gx_font_cache_file_lookup(gx_font_cache_file *pfcf,
+                                      const byte *key, uint *psize);
+
+/* Add a record, appending it to the file if there is room. */
+int gx_font_cache_file_add(gx_font_cache_file *pfcf, const byte *key,
+                           const byte *data, uint size);
+
+#endif /* gxfcfile_INCLUDED */
@@ -2214,9 +2214,9 @@ image_render_interpolate_icc(gx_image_enum * penum, const byte * buffer,
                           1, width_in);
             /* Do the transformation */
             psrc = (byte*) (stream_r.ptr + 1);
-            code = (penum->icc_link->procs.map_buffer)(dev, penum->icc_link, &input_buff_desc,
-                                                &output_buff_desc, (void*) psrc,
-                                                (void*) p_cm_buff);
+            code = gsicc_map_image_row(dev, pgs, penum->icc_link, &input_buff_desc,
+                                       &output_buff_desc, (void*) psrc,
+                                       (void*) p_cm_buff);
             if (code < 0)
                 return code;
 
@@ -2708,9 +2708,9 @@ image_render_interpolate_landscape_icc(gx_image_enum * penum,
                           1, width_in);
             /* Do the transformation */
             psrc = (byte*) (stream_r.ptr + 1);
-            code = (penum->icc_link->procs.map_buffer)(dev, penum->icc_link, &input_buff_desc,
-                                                &output_buff_desc, (void*) psrc,
-                                                (void*) p_cm_buff);
+            code = gsicc_map_image_row(dev, pgs, penum->icc_link, &input_buff_desc,
+                                       &output_buff_desc, (void*) psrc,
+                                       (void*) p_cm_buff);
             if (code < 0)
                 return code;
 
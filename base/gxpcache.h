@@ -23,25 +23,43 @@
 #include "gsdcolor.h"
 
 /*
- * Define a cache for rendered Patterns.  This is currently an open
- * hash table with single probing (no reprobing) and round-robin
- * replacement.  Obviously, we can do better in both areas.
+ * Define a cache for rendered Patterns.  Tiles are found by id through a
+ * chained hash table, and the cache is governed by a budget of bytes: when
+ * a new tile would exceed it (or there are no tiles left), the least
+ * recently used tiles are freed first.  Tiles that are locked (see
+ * gx_pattern_cache_entry_set_lock) or pinned by a band renderer are never
+ * freed to make room.  The lists link tiles by their index in the array,
+ * so that the GC needn't know about them.
  */
 typedef struct gx_pattern_cache_s gx_pattern_cache;
 
+#define gx_pattern_cache_no_tile ((uint)-1)
+
+typedef struct gx_pattern_cache_stats_s {
+    ulong hits;			/* lookups that found the tile */
+    ulong misses;		/* lookups that didn't */
+    ulong evictions;		/* tiles freed to make room for others */
+} gx_pattern_cache_stats_t;
+
 struct gx_pattern_cache_s {
     gs_memory_t *memory;
     gx_color_tile *tiles;
     uint num_tiles;
     uint tiles_used;
-    uint next;			/* round-robin index */
+    uint *buckets;		/* hash chains, through hash_next */
+    uint num_buckets;
+    uint free_tiles;		/* unused tiles, through hash_next */
+    uint lru_first;		/* least recently used tile */
+    uint lru_last;		/* most recently used tile */
     size_t bits_used;
     size_t max_bits;
+    gx_pattern_cache_stats_t stats;
     void (*free_all) (gx_pattern_cache *);
 };
 
 #define private_st_pattern_cache() /* in gxpcmap.c */\
-  gs_private_st_ptrs1(st_pattern_cache, gx_pattern_cache,\
-    "gx_pattern_cache", pattern_cache_enum, pattern_cache_reloc, tiles)
+  gs_private_st_ptrs2(st_pattern_cache, gx_pattern_cache,\
+    "gx_pattern_cache", pattern_cache_enum, pattern_cache_reloc, tiles,\
+    buckets)
 
 #endif /* gxpcache_INCLUDED */
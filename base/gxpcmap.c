@@ -48,8 +48,8 @@ unsigned int global_pat_index = 0;
 #endif
 
 /* Define the default size of the Pattern cache. */
-#define max_cached_patterns_LARGE 50
-#define max_pattern_bits_LARGE 100000
+#define max_cached_patterns_LARGE 256
+#define max_pattern_bits_LARGE 2000000
 #define max_cached_patterns_SMALL 5
 #define max_pattern_bits_SMALL 1000
 uint
@@ -820,9 +820,13 @@ gx_pattern_alloc_cache(gs_memory_t * mem, uint num_tiles, ulong max_bits)
     gs_alloc_struct_array(mem, num_tiles, gx_color_tile,
                           &st_color_tile_element,
                           "gx_pattern_alloc_cache(tiles)");
+    uint *buckets =
+    (uint *)gs_alloc_byte_array(mem, num_tiles, sizeof(uint),
+                                "gx_pattern_alloc_cache(buckets)");
     uint i;
 
-    if (pcache == 0 || tiles == 0) {
+    if (pcache == 0 || tiles == 0 || buckets == 0) {
+        gs_free_object(mem, buckets, "gx_pattern_alloc_cache(buckets)");
         gs_free_object(mem, tiles, "gx_pattern_alloc_cache(tiles)");
         gs_free_object(mem, pcache, "gx_pattern_alloc_cache(struct)");
         return 0;
@@ -831,10 +835,16 @@ gx_pattern_alloc_cache(gs_memory_t * mem, uint num_tiles, ulong max_bits)
     pcache->tiles = tiles;
     pcache->num_tiles = num_tiles;
     pcache->tiles_used = 0;
-    pcache->next = 0;
+    pcache->buckets = buckets;
+    pcache->num_buckets = num_tiles;
+    pcache->free_tiles = 0;
+    pcache->lru_first = pcache->lru_last = gx_pattern_cache_no_tile;
     pcache->bits_used = 0;
     pcache->max_bits = max_bits;
+    memset(&pcache->stats, 0, sizeof(pcache->stats));
     pcache->free_all = pattern_cache_free_all;
+    for (i = 0; i < num_tiles; i++)
+        buckets[i] = gx_pattern_cache_no_tile;
     for (i = 0; i < num_tiles; tiles++, i++) {
         tiles->id = gx_no_bitmap_id;
         /* Clear the pointers to pacify the GC. */
@@ -858,6 +868,12 @@ gx_pattern_alloc_cache(gs_memory_t * mem, uint num_tiles, ulong max_bits)
         tiles->tmask.data = 0;
 #endif
         tiles->index = i;
+        /* All tiles start out on the free list. */
+        tiles->hash_next = gx_pattern_cache_no_tile;
+        tiles->lru_prev = (i == 0 ? gx_pattern_cache_no_tile : i - 1);
+        tiles->lru_next = (i == num_tiles - 1 ? gx_pattern_cache_no_tile : i + 1);
+        tiles->pin_count = 0;
+        tiles->is_locked = false;
         tiles->cdev = NULL;
         tiles->ttrans = NULL;
         tiles->is_planar = false;
@@ -887,7 +903,13 @@ gx_pattern_cache_free(gx_pattern_cache *pcache)
 {
     if (pcache == NULL)
         return;
+    if_debug3m('v', pcache->memory,
+               "[v]Pattern cache hits=%lu misses=%lu evictions=%lu\n",
+               pcache->stats.hits, pcache->stats.misses,
+               pcache->stats.evictions);
     pattern_cache_free_all(pcache);
+    gs_free_object(pcache->memory, pcache->buckets, "gx_pattern_cache_free");
+    pcache->buckets = NULL;
     gs_free_object(pcache->memory, pcache->tiles, "gx_pattern_cache_free");
     pcache->tiles = NULL;
     gs_free_object(pcache->memory, pcache, "gx_pattern_cache_free");
@@ -905,119 +927,248 @@ gstate_set_pattern_cache(gs_gstate * pgs, gx_pattern_cache * pcache)
     pgs->pattern_cache = pcache;
 }
 
-/* Free a Pattern cache entry. */
-/* This will not free a pattern if it is 'locked' which should only be for */
-/* a stroke pattern during fill_stroke_path.                               */
+/*
+ * The tiles in use are chained into hash buckets by id through hash_next,
+ * and into a list in order of use, least recent first, through lru_prev
+ * and lru_next.  Unused tiles have an id of gx_no_bitmap_id and are kept
+ * on the free list, which reuses the lru links.
+ */
 static void
-gx_pattern_cache_free_entry(gx_pattern_cache * pcache, gx_color_tile * ctile)
+pattern_cache_list_remove(gx_pattern_cache *pcache, gx_color_tile *ctile,
+                          uint *pfirst, uint *plast)
 {
-    gx_device *temp_device;
+    if (ctile->lru_prev == gx_pattern_cache_no_tile)
+        *pfirst = ctile->lru_next;
+    else
+        pcache->tiles[ctile->lru_prev].lru_next = ctile->lru_next;
+    if (ctile->lru_next != gx_pattern_cache_no_tile)
+        pcache->tiles[ctile->lru_next].lru_prev = ctile->lru_prev;
+    else if (plast != NULL)
+        *plast = ctile->lru_prev;
+    ctile->lru_prev = ctile->lru_next = gx_pattern_cache_no_tile;
+}
 
-    if ((ctile->id != gx_no_bitmap_id) && !ctile->is_dummy && !ctile->is_locked) {
-        gs_memory_t *mem = pcache->memory;
+/* Make a tile the most recently used one. */
+static void
+pattern_cache_lru_append(gx_pattern_cache *pcache, gx_color_tile *ctile)
+{
+    ctile->lru_next = gx_pattern_cache_no_tile;
+    ctile->lru_prev = pcache->lru_last;
+    if (pcache->lru_last == gx_pattern_cache_no_tile)
+        pcache->lru_first = ctile->index;
+    else
+        pcache->tiles[pcache->lru_last].lru_next = ctile->index;
+    pcache->lru_last = ctile->index;
+}
 
-        /*
-         * We must initialize the memory device properly, even though
-         * we aren't using it for drawing.
-         */
-        if (ctile->tmask.data != 0) {
-            gs_free_object(mem, ctile->tmask.data,
-                           "free_pattern_cache_entry(mask data)");
-            ctile->tmask.data = 0;      /* for GC */
-        }
-        if (ctile->tbits.data != 0) {
-            gs_free_object(mem, ctile->tbits.data,
-                           "free_pattern_cache_entry(bits data)");
-            ctile->tbits.data = 0;      /* for GC */
-        }
-        if (ctile->cdev != NULL) {
-            ctile->cdev->common.do_not_open_or_close_bandfiles = false;  /* make sure memfile gets freed/closed */
-            dev_proc(&ctile->cdev->common, close_device)((gx_device *)&ctile->cdev->common);
-            /* Free up the icc based stuff in the clist device.  I am puzzled
-               why the other objects are not released */
-            clist_free_icc_table(ctile->cdev->common.icc_table,
-                            ctile->cdev->common.memory);
-            ctile->cdev->common.icc_table = NULL;
-            rc_decrement(ctile->cdev->common.icc_cache_cl,
-                            "gx_pattern_cache_free_entry");
-            ctile->cdev->common.icc_cache_cl = NULL;
-            ctile->cdev->writer.pinst = NULL;
-            gs_free_object(ctile->cdev->common.memory->non_gc_memory, ctile->cdev->common.cache_chunk, "free tile cache for clist");
-            ctile->cdev->common.cache_chunk = 0;
-            temp_device = (gx_device *)ctile->cdev;
-            gx_device_retain(temp_device, false);
-            ctile->cdev = NULL;
+static gx_color_tile *
+pattern_cache_find(const gx_pattern_cache *pcache, gx_bitmap_id id)
+{
+    uint i = pcache->buckets[id % pcache->num_buckets];
+
+    while (i != gx_pattern_cache_no_tile) {
+        if (pcache->tiles[i].id == id)
+            return &pcache->tiles[i];
+        i = pcache->tiles[i].hash_next;
+    }
+    return NULL;
+}
+
+/* Take a tile off the free list and enter it in the cache under id. */
+static void
+pattern_cache_link(gx_pattern_cache *pcache, gx_color_tile *ctile,
+                   gx_bitmap_id id)
+{
+    uint *pbucket = &pcache->buckets[id % pcache->num_buckets];
+
+    pattern_cache_list_remove(pcache, ctile, &pcache->free_tiles, NULL);
+    ctile->id = id;
+    ctile->hash_next = *pbucket;
+    *pbucket = ctile->index;
+    pattern_cache_lru_append(pcache, ctile);
+}
+
+/* Remove a tile from the cache and return it to the free list. */
+static void
+pattern_cache_unlink(gx_pattern_cache *pcache, gx_color_tile *ctile)
+{
+    uint *pi = &pcache->buckets[ctile->id % pcache->num_buckets];
+
+    while (*pi != gx_pattern_cache_no_tile) {
+        if (*pi == ctile->index) {
+            *pi = ctile->hash_next;
+            break;
         }
+        pi = &pcache->tiles[*pi].hash_next;
+    }
+    ctile->hash_next = gx_pattern_cache_no_tile;
+    pattern_cache_list_remove(pcache, ctile, &pcache->lru_first,
+                              &pcache->lru_last);
+    ctile->lru_next = pcache->free_tiles;
+    if (pcache->free_tiles != gx_pattern_cache_no_tile)
+        pcache->tiles[pcache->free_tiles].lru_prev = ctile->index;
+    pcache->free_tiles = ctile->index;
+    ctile->id = gx_no_bitmap_id;
+}
 
-        if (ctile->ttrans != NULL) {
-            if_debug2m('v', mem,
-                       "[v*] Freeing trans pattern from cache, uid = %ld id = %ld\n",
-                       ctile->uid.id, ctile->id);
-            if ( ctile->ttrans->pdev14 == NULL) {
-                /* This can happen if we came from the clist */
-                if (ctile->ttrans->mem != NULL)
-                    gs_free_object(ctile->ttrans->mem ,ctile->ttrans->transbytes,
-                                   "free_pattern_cache_entry(transbytes)");
-                gs_free_object(mem,ctile->ttrans->fill_trans_buffer,
-                                "free_pattern_cache_entry(fill_trans_buffer)");
-                ctile->ttrans->transbytes = NULL;
-                ctile->ttrans->fill_trans_buffer = NULL;
-            } else {
-                dev_proc(ctile->ttrans->pdev14, close_device)((gx_device *)ctile->ttrans->pdev14);
-                temp_device = (gx_device *)(ctile->ttrans->pdev14);
-                gx_device_retain(temp_device, false);
-                rc_decrement(temp_device,"gx_pattern_cache_free_entry");
-                ctile->ttrans->pdev14 = NULL;
-                ctile->ttrans->transbytes = NULL;  /* should be ok due to pdf14_close */
-                ctile->ttrans->fill_trans_buffer = NULL; /* This is always freed */
-            }
+/* A tile may be freed to make room for another if nothing holds it. */
+#define pattern_tile_is_evictable(ctile)\
+  (!(ctile)->is_dummy && !(ctile)->is_locked && (ctile)->pin_count == 0)
 
-            gs_free_object(mem, ctile->ttrans,
-                           "free_pattern_cache_entry(ttrans)");
-            ctile->ttrans = NULL;
+/* Free the data of a Pattern cache entry, leaving its bookkeeping alone. */
+static void
+pattern_cache_free_tile_data(gx_pattern_cache * pcache, gx_color_tile * ctile)
+{
+    gx_device *temp_device;
+    gs_memory_t *mem = pcache->memory;
 
+    /*
+     * We must initialize the memory device properly, even though
+     * we aren't using it for drawing.
+     */
+    if (ctile->tmask.data != 0) {
+        gs_free_object(mem, ctile->tmask.data,
+                       "free_pattern_cache_entry(mask data)");
+        ctile->tmask.data = 0;      /* for GC */
+    }
+    if (ctile->tbits.data != 0) {
+        gs_free_object(mem, ctile->tbits.data,
+                       "free_pattern_cache_entry(bits data)");
+        ctile->tbits.data = 0;      /* for GC */
+    }
+    if (ctile->cdev != NULL) {
+        ctile->cdev->common.do_not_open_or_close_bandfiles = false;  /* make sure memfile gets freed/closed */
+        dev_proc(&ctile->cdev->common, close_device)((gx_device *)&ctile->cdev->common);
+        /* Free up the icc based stuff in the clist device.  I am puzzled
+           why the other objects are not released */
+        clist_free_icc_table(ctile->cdev->common.icc_table,
+                        ctile->cdev->common.memory);
+        ctile->cdev->common.icc_table = NULL;
+        rc_decrement(ctile->cdev->common.icc_cache_cl,
+                        "gx_pattern_cache_free_entry");
+        ctile->cdev->common.icc_cache_cl = NULL;
+        ctile->cdev->writer.pinst = NULL;
+        gs_free_object(ctile->cdev->common.memory->non_gc_memory, ctile->cdev->common.cache_chunk, "free tile cache for clist");
+        ctile->cdev->common.cache_chunk = 0;
+        temp_device = (gx_device *)ctile->cdev;
+        gx_device_retain(temp_device, false);
+        ctile->cdev = NULL;
+    }
+
+    if (ctile->ttrans != NULL) {
+        if_debug2m('v', mem,
+                   "[v*] Freeing trans pattern from cache, uid = %ld id = %ld\n",
+                   ctile->uid.id, ctile->id);
+        if ( ctile->ttrans->pdev14 == NULL) {
+            /* This can happen if we came from the clist */
+            if (ctile->ttrans->mem != NULL)
+                gs_free_object(ctile->ttrans->mem ,ctile->ttrans->transbytes,
+                               "free_pattern_cache_entry(transbytes)");
+            gs_free_object(mem,ctile->ttrans->fill_trans_buffer,
+                            "free_pattern_cache_entry(fill_trans_buffer)");
+            ctile->ttrans->transbytes = NULL;
+            ctile->ttrans->fill_trans_buffer = NULL;
+        } else {
+            dev_proc(ctile->ttrans->pdev14, close_device)((gx_device *)ctile->ttrans->pdev14);
+            temp_device = (gx_device *)(ctile->ttrans->pdev14);
+            gx_device_retain(temp_device, false);
+            rc_decrement(temp_device,"gx_pattern_cache_free_entry");
+            ctile->ttrans->pdev14 = NULL;
+            ctile->ttrans->transbytes = NULL;  /* should be ok due to pdf14_close */
+            ctile->ttrans->fill_trans_buffer = NULL; /* This is always freed */
         }
 
+        gs_free_object(mem, ctile->ttrans,
+                       "free_pattern_cache_entry(ttrans)");
+        ctile->ttrans = NULL;
+
+    }
+}
+
+/* Free a Pattern cache entry. */
+/* This will not free a pattern if it is 'locked' which should only be for */
+/* a stroke pattern during fill_stroke_path, or pinned by a band renderer. */
+static void
+gx_pattern_cache_free_entry(gx_pattern_cache * pcache, gx_color_tile * ctile)
+{
+    if (ctile->id != gx_no_bitmap_id && pattern_tile_is_evictable(ctile)) {
+        pattern_cache_free_tile_data(pcache, ctile);
         pcache->tiles_used--;
         pcache->bits_used -= ctile->bits_used;
-        ctile->id = gx_no_bitmap_id;
+        pattern_cache_unlink(pcache, ctile);
     }
 }
 
 /*
-    Historically, the pattern cache has used a very simple hashing
-    scheme whereby pattern A goes into slot idx = (A.id % num_tiles).
-    Unfortunately, now we allow tiles to be 'locked' into the
-    pattern cache, we might run into the case where we want both
-    tiles A and B to be in the cache at once where:
-      (A.id % num_tiles) == (B.id % num_tiles).
-
-    We have a maximum of 2 locked tiles, and one of those can be
-    placed while the other one is locked. So we only need to cope
-    with a single 'collision'.
-
-    We therefore allow tiles to either go in at idx or at
-    (idx + 1) % num_tiles. This means we need to be prepared to
-    search a bit further for them, hence we now have 2 helper
-    functions to do this.
-*/
-
-/* We can have at most 1 locked tile while looking for a place to
- * put another tile. */
+ * Return the tile holding id if there is one, otherwise the tile that a
+ * new entry for id should use: a free one if possible, else the least
+ * recently used tile that nothing holds.  Return NULL if every tile is
+ * locked or pinned.
+ */
 gx_color_tile *
 gx_pattern_cache_find_tile_for_id(gx_pattern_cache *pcache, gs_id id)
 {
-    gx_color_tile *ctile  = &pcache->tiles[id % pcache->num_tiles];
-    gx_color_tile *ctile2 = &pcache->tiles[(id+1) % pcache->num_tiles];
-    if (ctile->id == id || ctile->id == gs_no_id)
-        return ctile;
-    if (ctile2->id == id || ctile2->id == gs_no_id)
-        return ctile2;
-    if (!ctile->is_locked)
+    gx_color_tile *ctile = pattern_cache_find(pcache, id);
+    uint i;
+
+    if (ctile != NULL)
         return ctile;
-    return ctile2;
+    if (pcache->free_tiles != gx_pattern_cache_no_tile)
+        return &pcache->tiles[pcache->free_tiles];
+    for (i = pcache->lru_first; i != gx_pattern_cache_no_tile;
+         i = pcache->tiles[i].lru_next) {
+        ctile = &pcache->tiles[i];
+        if (!ctile->is_locked && ctile->pin_count == 0)
+            return ctile;
+    }
+    return NULL;
 }
 
+/* Look up a tile by id, keeping the statistics and the order of use. */
+gx_color_tile *
+gx_pattern_cache_lookup_tile(gx_pattern_cache *pcache, gs_id id)
+{
+    gx_color_tile *ctile = pattern_cache_find(pcache, id);
+
+    if (ctile == NULL) {
+        pcache->stats.misses++;
+        return NULL;
+    }
+    pcache->stats.hits++;
+    if (ctile->index != pcache->lru_last) {
+        pattern_cache_list_remove(pcache, ctile, &pcache->lru_first,
+                                  &pcache->lru_last);
+        pattern_cache_lru_append(pcache, ctile);
+    }
+    return ctile;
+}
+
+/*
+ * Claim the tile for a new entry for id, emptying it first.  A tile that
+ * already holds id is replaced even if it is pinned, since whoever holds
+ * it will find the same pattern there.  Return NULL if every tile is held
+ * for some other pattern; a held tile is never given to a new id.
+ */
+static gx_color_tile *
+pattern_cache_claim_tile(gx_pattern_cache *pcache, gx_bitmap_id id)
+{
+    gx_color_tile *ctile = gx_pattern_cache_find_tile_for_id(pcache, id);
+
+    if (ctile == NULL)
+        return NULL;
+    if (ctile->id != gx_no_bitmap_id) {
+        if (ctile->id != id && !ctile->is_dummy)
+            pcache->stats.evictions++;
+        if (!ctile->is_dummy && !ctile->is_locked)
+            pattern_cache_free_tile_data(pcache, ctile);
+        pcache->tiles_used--;
+        pcache->bits_used -= ctile->bits_used;
+        pattern_cache_unlink(pcache, ctile);
+    }
+    pattern_cache_link(pcache, ctile, id);
+    ctile->bits_used = 0;
+    return ctile;
+}
 
 /* Given the size of a new pattern tile, free entries from the cache until  */
 /* enough space is available (or nothing left to free).                     */
@@ -1027,25 +1178,24 @@ gx_pattern_cache_ensure_space(gs_gstate * pgs, size_t needed)
 {
     int code = ensure_pattern_cache(pgs);
     gx_pattern_cache *pcache;
-    int start_free_id;
+    uint i;
 
     if (code < 0)
         return;                 /* no cache -- just exit */
 
     pcache = pgs->pattern_cache;
-    start_free_id = pcache->next;	/* for scan wrap check */
-    /* If too large then start freeing entries */
-    /* By starting just after 'next', we attempt to first free the oldest entries */
+    /* Free the least recently used entries first, skipping any that are */
+    /* locked (stroke pattern for fill_stroke_path) or pinned.            */
+    i = pcache->lru_first;
     while (pcache->bits_used + needed > pcache->max_bits &&
-           pcache->bits_used != 0) {
-        pcache->next = (pcache->next + 1) % pcache->num_tiles;
-        gx_pattern_cache_free_entry(pcache, &pcache->tiles[pcache->next]);
-        /* since a pattern may be temporarily locked (stroke pattern for fill_stroke_path) */
-        /* we may not have freed all entries even though we've scanned the entire cache.   */
-        /* The following check for wrapping prevents infinite loop if stroke pattern was   */
-        /* larger than pcache->max_bits,                                                   */
-        if (pcache->next == start_free_id)
-            break;		/* we wrapped -- cache may not be empty */
+           pcache->bits_used != 0 && i != gx_pattern_cache_no_tile) {
+        gx_color_tile *ctile = &pcache->tiles[i];
+
+        i = ctile->lru_next;
+        if (pattern_tile_is_evictable(ctile)) {
+            gx_pattern_cache_free_entry(pcache, ctile);
+            pcache->stats.evictions++;
+        }
     }
 }
 
@@ -1163,9 +1313,9 @@ gx_pattern_cache_add_entry(gs_gstate * pgs,
         used = size_b + size_c;
     }
     id = pinst->id;
-    ctile = gx_pattern_cache_find_tile_for_id(pcache, id);
-    gx_pattern_cache_free_entry(pcache, ctile);         /* ensure that this cache slot is empty */
-    ctile->id = id;
+    ctile = pattern_cache_claim_tile(pcache, id);
+    if (ctile == NULL)
+        return_error(gs_error_limitcheck);
     ctile->is_planar = pinst->is_planar;
     ctile->depth = fdev->color_info.depth;
     ctile->uid = pinst->templat.uid;
@@ -1238,13 +1388,46 @@ gx_pattern_cache_entry_set_lock(gs_gstate *pgs, gs_id id, bool new_lock_value)
 
     if (code < 0)
         return code;
-    ctile = gx_pattern_cache_find_tile_for_id(pgs->pattern_cache, id);
-    if (ctile == NULL)
-        return_error(gs_error_undefined);
-    ctile->is_locked = new_lock_value;
+    ctile = pattern_cache_find(pgs->pattern_cache, id);
+    if (ctile != NULL)
+        ctile->is_locked = new_lock_value;
     return 0;
 }
 
+gx_color_tile *
+gx_pattern_cache_pin_color(const gx_device_color *pdevc)
+{
+    gx_color_tile *ctile = NULL;
+
+    if (gx_dc_is_pattern1_color(pdevc))
+        ctile = pdevc->colors.pattern.p_tile;
+    else if (pdevc->type == &gx_dc_pure_masked ||
+             pdevc->type == &gx_dc_binary_masked ||
+             pdevc->type == &gx_dc_colored_masked ||
+             pdevc->type == &gx_dc_devn_masked)
+        ctile = pdevc->mask.m_tile;
+    if (ctile != NULL)
+        ctile->pin_count++;
+    return ctile;
+}
+
+void
+gx_pattern_cache_unpin_tile(gx_color_tile *ctile)
+{
+    if (ctile != NULL && ctile->pin_count > 0)
+        ctile->pin_count--;
+}
+
+void
+gx_pattern_cache_get_stats(const gx_pattern_cache *pcache,
+                           gx_pattern_cache_stats_t *pstats)
+{
+    if (pcache == NULL)
+        memset(pstats, 0, sizeof(*pstats));
+    else
+        *pstats = pcache->stats;
+}
+
 /* Get entry for reading a pattern from clist. */
 int
 gx_pattern_cache_get_entry(gs_gstate * pgs, gs_id id, gx_color_tile ** pctile)
@@ -1256,9 +1439,9 @@ gx_pattern_cache_get_entry(gs_gstate * pgs, gs_id id, gx_color_tile ** pctile)
     if (code < 0)
         return code;
     pcache = pgs->pattern_cache;
-    ctile = gx_pattern_cache_find_tile_for_id(pcache, id);
-    gx_pattern_cache_free_entry(pgs->pattern_cache, ctile);
-    ctile->id = id;
+    ctile = pattern_cache_claim_tile(pcache, id);
+    if (ctile == NULL)
+        return_error(gs_error_limitcheck);
     *pctile = ctile;
     return 0;
 }
@@ -1283,9 +1466,9 @@ gx_pattern_cache_add_dummy_entry(gs_gstate *pgs,
     if (code < 0)
         return code;
     pcache = pgs->pattern_cache;
-    ctile = gx_pattern_cache_find_tile_for_id(pcache, id);
-    gx_pattern_cache_free_entry(pcache, ctile);
-    ctile->id = id;
+    ctile = pattern_cache_claim_tile(pcache, id);
+    if (ctile == NULL)
+        return_error(gs_error_limitcheck);
     ctile->depth = depth;
     ctile->uid = pinst->templat.uid;
     ctile->tiling_type = pinst->templat.TilingType;
@@ -1432,6 +1615,7 @@ gx_pattern_cache_winnow(gx_pattern_cache * pcache,
         gx_color_tile *ctile = &pcache->tiles[i];
 
         ctile->is_locked = false;		/* force freeing */
+        ctile->pin_count = 0;
         if (ctile->id != gx_no_bitmap_id && (*proc) (ctile, proc_data))
             gx_pattern_cache_free_entry(pcache, ctile);
     }
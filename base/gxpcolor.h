@@ -223,8 +223,12 @@ struct gx_color_tile_s {
                                    is */
     byte is_locked;		/* stroke patterns cannot be freed during fill_stroke_path */
     byte pad[2];		/* structure members alignment. */
-    /* The following is neither key nor value. */
+    /* The following are neither key nor value. */
     uint index;			/* the index of the tile within the cache (for GC) */
+    uint hash_next;		/* next tile in the hash chain or free list */
+    uint lru_prev;		/* neighbours in order of use, */
+    uint lru_next;		/* least recent first */
+    int pin_count;		/* > 0 while a band renderer holds the tile */
 };
 
 #define private_st_color_tile()	/* in gxpcmap.c */\
@@ -318,6 +322,20 @@ int gx_pattern_cache_add_dummy_entry(gs_gstate *pgs, gs_pattern1_instance_t *pin
 /* set or clear the lock for a tile in the cache. Returns error if tile not in cache */
 int gx_pattern_cache_entry_set_lock(gs_gstate * pgs, gs_id id, bool new_lock_value);
 
+/* Pin the tile of a pattern color so that it can't be freed to make room */
+/* for others, and return it (or NULL if the color has no tile). */
+gx_color_tile *gx_pattern_cache_pin_color(const gx_device_color *pdevc);
+/* Release a tile returned by gx_pattern_cache_pin_color. */
+void gx_pattern_cache_unpin_tile(gx_color_tile *ctile);
+
+/* Look up a tile by id, counting the hit or miss and marking it used. */
+gx_color_tile *gx_pattern_cache_lookup_tile(gx_pattern_cache *pcache, gs_id id);
+
+/* Return the cache's hit, miss and eviction counts (all 0 if there is no */
+/* cache). These are the PatternCache... system parameters. */
+void gx_pattern_cache_get_stats(const gx_pattern_cache *pcache,
+                                gx_pattern_cache_stats_t *pstats);
+
 /* Get entry for reading a pattern from clist. */
 int gx_pattern_cache_get_entry(gs_gstate * pgs, gs_id id, gx_color_tile ** pctile);
 
@@ -86,6 +86,110 @@ Gt_fill_triangle(patch_fill_state_t * pfs, const shading_vertex_t * va,
     return code;
 }
 
+/*
+ * When the triangles are rendered by strips, they are batched like
+ * patches are (see patch_fill_by_strips). A record holds the 3 vertices
+ * followed by their colors, each of them color_stack_step bytes long.
+ */
+typedef struct triangle_batch_s {
+    shade_strips_t strips;
+    byte *data;                 /* NULL when filling serially. */
+    int color_offset;
+    int record_size;
+    int count;
+    int max_count;
+} triangle_batch_t;
+
+static int
+triangle_batch_init(triangle_batch_t *ptb, patch_fill_state_t *pfs)
+{
+    int code;
+
+    ptb->data = NULL;
+    ptb->count = 0;
+    ptb->color_offset = (3 * sizeof(gs_fixed_point) + 7) & ~7;
+    ptb->record_size = ptb->color_offset + 3 * pfs->color_stack_step;
+    ptb->max_count = max(SHADE_STRIPS_BATCH_SIZE / ptb->record_size, 1);
+    code = gx_shade_strips_init(&ptb->strips, pfs, ptb->max_count);
+    if (code <= 0)
+        return code;
+    ptb->data = gs_alloc_bytes(pfs->memory, (size_t)ptb->max_count * ptb->record_size,
+                               "triangle_batch_init");
+    if (ptb->data == NULL) {
+        gx_shade_strips_free(&ptb->strips);
+        return_error(gs_error_VMerror);
+    }
+    return 0;
+}
+
+static int
+triangle_batch_fill(patch_fill_state_t *pfs, void *data, int index)
+{
+    const triangle_batch_t *ptb = (const triangle_batch_t *)data;
+    const byte *rec = ptb->data + (size_t)index * ptb->record_size;
+    shading_vertex_t v[3];
+    int i;
+
+    for (i = 0; i < 3; i++) {
+        v[i].p = ((const gs_fixed_point *)rec)[i];
+        v[i].c = (const patch_color_t *)(rec + ptb->color_offset +
+                                         i * pfs->color_stack_step);
+    }
+    return Gt_fill_triangle(pfs, &v[0], &v[1], &v[2]);
+}
+
+static int
+triangle_batch_flush(triangle_batch_t *ptb)
+{
+    int code = 0;
+
+    if (ptb->count > 0)
+        code = gx_shade_strips_fill(&ptb->strips, triangle_batch_fill, ptb);
+    ptb->count = 0;
+    return code;
+}
+
+static void
+triangle_batch_free(triangle_batch_t *ptb)
+{
+    if (ptb->data == NULL)
+        return;
+    gs_free_object(ptb->strips.memory, ptb->data, "triangle_batch_free");
+    gx_shade_strips_free(&ptb->strips);
+    ptb->data = NULL;
+}
+
+/* Fill a triangle now, or add it to the batch when rendering by strips. */
+static int
+Gt_fill_or_batch(patch_fill_state_t *pfs, triangle_batch_t *ptb,
+                 const shading_vertex_t *va, const shading_vertex_t *vb,
+                 const shading_vertex_t *vc)
+{
+    byte *rec;
+    gs_fixed_point *pt;
+    gs_fixed_rect bbox;
+    int step = pfs->color_stack_step;
+
+    if (ptb->data == NULL)
+        return Gt_fill_triangle(pfs, va, vb, vc);
+    rec = ptb->data + (size_t)ptb->count * ptb->record_size;
+    pt = (gs_fixed_point *)rec;
+    pt[0] = va->p;
+    pt[1] = vb->p;
+    pt[2] = vc->p;
+    memcpy(rec + ptb->color_offset, va->c, step);
+    memcpy(rec + ptb->color_offset + step, vb->c, step);
+    memcpy(rec + ptb->color_offset + 2 * step, vc->c, step);
+    bbox.p.x = min(min(pt[0].x, pt[1].x), pt[2].x);
+    bbox.p.y = min(min(pt[0].y, pt[1].y), pt[2].y);
+    bbox.q.x = max(max(pt[0].x, pt[1].x), pt[2].x);
+    bbox.q.y = max(max(pt[0].y, pt[1].y), pt[2].y);
+    gx_shade_strips_add(&ptb->strips, ptb->count, &bbox);
+    if (++ptb->count < ptb->max_count)
+        return 0;
+    return triangle_batch_flush(ptb);
+}
+
 int
 gs_shading_FfGt_fill_rectangle(const gs_shading_t * psh0, const gs_rect * rect,
                                const gs_fixed_rect * rect_clip,
@@ -100,7 +204,8 @@ gs_shading_FfGt_fill_rectangle(const gs_shading_t * psh0, const gs_rect * rect,
     shading_vertex_t va, vb, vc;
     patch_color_t *c, *C[3], *ca, *cb, *cc; /* va.c == ca && vb.c == cb && vc.c == cc always,
                                         provides a non-const access. */
-    int code;
+    triangle_batch_t tb;
+    int code, code1;
 
     code = shade_init_fill_state((shading_fill_state_t *)&pfs,
                                  (const gs_shading_t *)psh, dev, pgs);
@@ -119,6 +224,9 @@ gs_shading_FfGt_fill_rectangle(const gs_shading_t * psh0, const gs_rect * rect,
     vc.c = cc = C[2];
     shade_next_init(&cs, (const gs_shading_mesh_params_t *)&psh->params,
                     pgs);
+    code = triangle_batch_init(&tb, &pfs);
+    if (code < 0)
+        goto error;
     /* CET 09-47J.PS SpecialTestI04Test01 does not need the color data alignment. */
     while ((flag = shade_next_flag(&cs, num_bits)) >= 0) {
         switch (flag) {
@@ -146,12 +254,16 @@ gs_shading_FfGt_fill_rectangle(const gs_shading_t * psh0, const gs_rect * rect,
                 vc.c = cc = c;
 v2:		if ((code = Gt_next_vertex(pshm, &cs, &vc, cc)) < 0)
                     break;
-                if ((code = Gt_fill_triangle(&pfs, &va, &vb, &vc)) < 0)
+                if ((code = Gt_fill_or_batch(&pfs, &tb, &va, &vb, &vc)) < 0)
                     break;
         }
         cs.align(&cs, 8); /* Debugged with 12-14O.PS page 2. */
     }
 error:
+    code1 = triangle_batch_flush(&tb);
+    if (code >= 0)
+        code = code1;
+    triangle_batch_free(&tb);
     release_colors(&pfs, pfs.color_stack, 3);
     if (pfs.icclink != NULL) gsicc_release_link(pfs.icclink);
     if (term_patch_fill_state(&pfs))
@@ -176,7 +288,8 @@ gs_shading_LfGt_fill_rectangle(const gs_shading_t * psh0, const gs_rect * rect,
     shading_vertex_t next;
     int per_row = psh->params.VerticesPerRow;
     patch_color_t *c, *cn; /* cn == next.c always, provides a non-contst access. */
-    int i, code;
+    triangle_batch_t tb;
+    int i, code, code1;
 
     code = shade_init_fill_state((shading_fill_state_t *)&pfs,
                                  (const gs_shading_t *)psh, dev, pgs);
@@ -184,6 +297,7 @@ gs_shading_LfGt_fill_rectangle(const gs_shading_t * psh0, const gs_rect * rect,
         return code;
     pfs.Function = pshm->params.Function;
     pfs.rect = *rect_clip;
+    tb.data = NULL;
     code = init_patch_fill_state(&pfs);
     if (code < 0)
         goto out;
@@ -211,6 +325,9 @@ gs_shading_LfGt_fill_rectangle(const gs_shading_t * psh0, const gs_rect * rect,
         code = gs_note_error(gs_error_VMerror);
         goto out;
     }
+    code = triangle_batch_init(&tb, &pfs);
+    if (code < 0)
+        goto out;
     /* CET 09-47K.PS SpecialTestJ02Test05 needs the color data alignment. */
     for (i = 0; i < per_row; ++i) {
         color_buffer_ptrs[i] = (patch_color_t *)(color_buffer + pfs.color_stack_step * i);
@@ -223,7 +340,7 @@ gs_shading_LfGt_fill_rectangle(const gs_shading_t * psh0, const gs_rect * rect,
         if (code < 0)
             goto out;
         for (i = 1; i < per_row; ++i) {
-            code = Gt_fill_triangle(&pfs, &vertex[i - 1], &vertex[i], &next);
+            code = Gt_fill_or_batch(&pfs, &tb, &vertex[i - 1], &vertex[i], &next);
             if (code < 0)
                 goto out;
             c = color_buffer_ptrs[i - 1];
@@ -233,7 +350,7 @@ gs_shading_LfGt_fill_rectangle(const gs_shading_t * psh0, const gs_rect * rect,
             code = Gt_next_vertex(pshm, &cs, &next, cn);
             if (code < 0)
                 goto out;
-            code = Gt_fill_triangle(&pfs, &vertex[i], &vertex[i - 1], &next);
+            code = Gt_fill_or_batch(&pfs, &tb, &vertex[i], &vertex[i - 1], &next);
             if (code < 0)
                 goto out;
         }
@@ -243,6 +360,12 @@ gs_shading_LfGt_fill_rectangle(const gs_shading_t * psh0, const gs_rect * rect,
         next.c = cn = c;
     }
 out:
+    if (tb.data != NULL) {
+        code1 = triangle_batch_flush(&tb);
+        if (code >= 0)
+            code = code1;
+        triangle_batch_free(&tb);
+    }
     gs_free_object(pgs->memory, vertex, "gs_shading_LfGt_render");
     gs_free_object(pgs->memory, color_buffer, "gs_shading_LfGt_render");
     gs_free_object(pgs->memory, color_buffer_ptrs, "gs_shading_LfGt_render");
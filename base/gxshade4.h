@@ -22,6 +22,7 @@
 #include "gxshade.h"
 #include "gxdevcli.h"
 #include "gscicach.h"
+#include "gxsync.h"
 
 /* Configuration flags for development needs only. Users should not modify them. */
 #define USE_LINEAR_COLOR_PROCS 1 /* Old code = 0, new code = 1. */
@@ -141,6 +142,8 @@ struct patch_fill_state_s {
     byte *color_stack_limit;
     gs_memory_t *memory; /* Where color_buffer is allocated. */
     gs_color_index_cache_t *pcic;
+    gx_monitor_t *color_lock; /* Serializes color space conversions of strip threads. */
+    gx_monitor_t *function_lock; /* Serializes the Function, if not reentrant. */
 } ;
 
 /* Define a structure for mesh or patch vertex. */
@@ -200,4 +203,47 @@ void release_colors(patch_fill_state_t *pfs, byte *ptr, int n);
 
 dev_proc_fill_linear_color_triangle(gx_fill_triangle_small);
 
+/*
+ * A mesh shading may be rendered by several threads at once, each filling
+ * its own horizontal strip of the clipping box. The caller reads the mesh
+ * ahead in batches and passes the bounding box of every element of a batch
+ * to gx_shade_strips_add, which queues the element on the strips it
+ * reaches; gx_shade_strips_fill then has each strip fill its own queue with
+ * a fill state and a color cache of its own. The threads are started by
+ * gx_shade_strips_init and wait for the batches until gx_shade_strips_free.
+ * Only colors that miss the caches, and Functions that may not be evaluated
+ * concurrently, are computed under a lock. Since each strip sees its
+ * elements in the original order, the output is identical to the serial
+ * path.
+ */
+typedef struct shade_strip_s shade_strip_t;
+
+/* Fill element index of the batch described by data. */
+typedef int (*shade_strip_proc_t)(patch_fill_state_t *pfs, void *data, int index);
+
+typedef struct shade_strips_s {
+    int num_strips;
+    shade_strip_t *strips;
+    int max_items;              /* The size of a batch. */
+    int *items;                 /* The queues of the strips. */
+    shade_strip_proc_t proc;
+    void *data;
+    bool finish;                /* Tells the threads to exit. */
+    gx_monitor_t *color_lock;
+    gx_monitor_t *function_lock;
+    gs_memory_t *memory;
+} shade_strips_t;
+
+/* Return 1 and set up the strips if the shading should be rendered */
+/* by strips, 0 if it should be rendered serially. */
+int gx_shade_strips_init(shade_strips_t *pss, patch_fill_state_t *pfs, int max_items);
+/* Queue element index of the batch on the strips that bbox reaches. */
+void gx_shade_strips_add(shade_strips_t *pss, int index, const gs_fixed_rect *bbox);
+/* Fill the queued elements and empty the queues. */
+int gx_shade_strips_fill(shade_strips_t *pss, shade_strip_proc_t proc, void *data);
+void gx_shade_strips_free(shade_strips_t *pss);
+
+/* The size in bytes of a batch of mesh elements that are read ahead. */
+#define SHADE_STRIPS_BATCH_SIZE 262144
+
 #endif /* gxshade4_INCLUDED */
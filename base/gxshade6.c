@@ -31,12 +31,18 @@
 #include "gxshade.h"
 #include "gxdevcli.h"
 #include "gxshade4.h"
+#include "gsfunc3.h"
+#include "gsfunc4.h"
 #include "gxarith.h"
 #include "gzpath.h"
 #include "stdint_.h"
 #include "math_.h"
 #include "gsicc_cache.h"
 #include "gxdevsop.h"
+#include "gzcpath.h"
+#include "gxdevmem.h"
+#include "gslibctx.h"
+#include "gpsync.h"
 
 /* The original version of the shading code 'decompose's shadings into
  * smaller and smaller regions until they are smaller than 1 pixel, and then
@@ -296,6 +302,8 @@ init_patch_fill_state(patch_fill_state_t *pfs)
     pfs->color_stack_limit = NULL;
     pfs->unlinear = !is_linear_color_applicable(pfs);
     pfs->pcic = NULL;
+    pfs->color_lock = NULL;
+    pfs->function_lock = NULL;
     return alloc_patch_fill_memory(pfs, pfs->pgs->memory, pcs);
 }
 
@@ -313,6 +321,26 @@ term_patch_fill_state(patch_fill_state_t *pfs)
     return b;
 }
 
+/*
+ * When a shading is rendered by strips, the threads share the color
+ * spaces, ICC links and graphics state, none of which are safe to use
+ * concurrently, so they take turns with them; and the same for the
+ * Function, unless it may be evaluated concurrently.
+ */
+static inline void
+shade_lock_enter(gx_monitor_t *lock)
+{
+    if (lock != NULL)
+        gx_monitor_enter(lock);
+}
+
+static inline void
+shade_lock_leave(gx_monitor_t *lock)
+{
+    if (lock != NULL)
+        gx_monitor_leave(lock);
+}
+
 /* Resolve a patch color using the Function if necessary. */
 static inline void
 patch_resolve_color_inline(patch_color_t * ppcr, const patch_fill_state_t *pfs)
@@ -320,7 +348,9 @@ patch_resolve_color_inline(patch_color_t * ppcr, const patch_fill_state_t *pfs)
     if (pfs->Function) {
         const gs_color_space *pcs = pfs->direct_space;
 
+        shade_lock_enter(pfs->function_lock);
         gs_function_evaluate(pfs->Function, ppcr->t, ppcr->cc.paint.values);
+        shade_lock_leave(pfs->function_lock);
         pcs->type->restrict_color(&ppcr->cc, pcs);
     }
 }
@@ -355,6 +385,284 @@ patch_interpolate_color(patch_color_t * ppcr, const patch_color_t * ppc0,
     }
 }
 
+/* ================ Strip rendering ================ */
+
+/* Strips shorter than this aren't worth a thread. */
+#define SHADE_STRIP_MIN_HEIGHT 16
+
+struct shade_strip_s {
+    patch_fill_state_t pfs;
+    gx_device_clip clipper;     /* The caller's clipping, with our own cursor. */
+    gx_device_clip strip_clipper;
+    gx_clip_path strip_path;
+    shade_strips_t *owner;
+    int *items;                 /* The elements of the batch that reach the strip. */
+    int num_items;
+    gx_semaphore_t *start;      /* Signalled when a batch is ready... */
+    gx_semaphore_t *done;       /* ...and by the thread when it is filled. */
+    gp_thread_id thread;        /* NULL if the strip is filled by the caller. */
+    int code;
+};
+
+/*
+ * Can the Function be evaluated by several threads at once? Exponential
+ * and calculator functions only use their own stacks (a calculator
+ * function may be sampled, but always with Order 1 and in memory), while
+ * sampled functions cache poles or read from a stream.
+ */
+static bool
+function_is_reentrant(const gs_function_t *pfn)
+{
+    gs_function_info_t info;
+    int i;
+
+    switch (FunctionType(pfn)) {
+        case function_type_ExponentialInterpolation:
+        case function_type_PostScript_Calculator:
+            return true;
+        case function_type_1InputStitching:
+        case function_type_ArrayedOutput:
+            gs_function_get_info(pfn, &info);
+            for (i = 0; i < info.num_Functions; i++)
+                if (!function_is_reentrant(info.Functions[i]))
+                    return false;
+            return true;
+        default:
+            return false;
+    }
+}
+
+static void
+shade_strip_run(shade_strip_t *s)
+{
+    shade_strips_t *pss = s->owner;
+    int i, code = 0;
+
+    for (i = 0; i < s->num_items && code >= 0; i++)
+        code = pss->proc(&s->pfs, pss->data, s->items[i]);
+    s->code = code;
+}
+
+static void
+shade_strip_thread(void *arg)
+{
+    shade_strip_t *s = (shade_strip_t *)arg;
+
+    for (;;) {
+        gx_semaphore_wait(s->start);
+        if (s->owner->finish)
+            break;
+        shade_strip_run(s);
+        gx_semaphore_signal(s->done);
+    }
+}
+
+/*
+ * Prepare to render a shading in horizontal strips, one per thread, in
+ * batches of up to max_items elements. Return 1 if the strips are ready,
+ * or 0 if the shading should be rendered serially with pfs as usual.
+ */
+int
+gx_shade_strips_init(shade_strips_t *pss, patch_fill_state_t *pfs, int max_items)
+{
+    gx_device *dev = pfs->dev, *target = dev;
+    gs_memory_t *mem = pfs->memory;
+    gx_device_clip probe;
+    bool clipped;
+    int n = gs_lib_ctx_get_shading_threads(mem);
+    int y0, h, i, code = 0;
+
+    pss->num_strips = 0;
+    pss->strips = NULL;
+    pss->max_items = max_items;
+    pss->items = NULL;
+    pss->proc = NULL;
+    pss->data = NULL;
+    pss->finish = false;
+    pss->color_lock = NULL;
+    pss->function_lock = NULL;
+    pss->memory = mem;
+    if (n < 2 || pfs->trans_device != dev)
+        return 0;
+    clipped = (gx_copy_clip_device_on_stack(&probe, dev) != NULL);
+    if (clipped)
+        target = probe.target;
+    /*
+     * Only a chunky memory device is known to leave distinct rows
+     * independent; planar ones switch their parameters for each plane.
+     */
+    if (target == NULL || !gs_device_is_memory(target) || target->is_planar ||
+        gx_get_cmap_procs(pfs->pgs, dev)->is_halftoned(pfs->pgs, dev))
+        return 0;
+    if (pfs->rect.p.x <= min_fixed + fixed_1 || pfs->rect.q.x >= max_fixed - fixed_1 ||
+        pfs->rect.p.y <= min_fixed + fixed_1 || pfs->rect.q.y >= max_fixed - fixed_1)
+        return 0;
+    y0 = fixed2int(pfs->rect.p.y);
+    h = fixed2int_ceiling(pfs->rect.q.y) - y0;
+    n = min(n, h / SHADE_STRIP_MIN_HEIGHT);
+    if (n < 2)
+        return 0;
+    pss->color_lock = gx_monitor_alloc(mem);
+    if (pss->color_lock == NULL)
+        return_error(gs_error_VMerror);
+    if (pfs->Function != NULL && !function_is_reentrant(pfs->Function)) {
+        pss->function_lock = gx_monitor_alloc(mem);
+        if (pss->function_lock == NULL) {
+            gx_shade_strips_free(pss);
+            return_error(gs_error_VMerror);
+        }
+    }
+    pss->strips = (shade_strip_t *)gs_alloc_byte_array(mem, n, sizeof(shade_strip_t),
+                                                       "gx_shade_strips_init");
+    pss->items = (int *)gs_alloc_byte_array(mem, (size_t)n * max_items, sizeof(int),
+                                            "gx_shade_strips_init");
+    if (pss->strips == NULL || pss->items == NULL) {
+        gx_shade_strips_free(pss);
+        return_error(gs_error_VMerror);
+    }
+    for (i = 0; i < n; i++) {
+        shade_strip_t *s = &pss->strips[i];
+        int sy0 = y0 + (int)((int64_t)h * i / n);
+        int sy1 = y0 + (int)((int64_t)h * (i + 1) / n);
+        gs_fixed_rect r;
+        gx_device *inner = target;
+
+        s->pfs = *pfs;
+        s->owner = pss;
+        s->items = pss->items + (size_t)i * max_items;
+        s->num_items = 0;
+        s->start = s->done = NULL;
+        s->thread = NULL;
+        s->code = 0;
+        /*
+         * The strip clipper owns rows sy0 to sy1 exactly, except that the
+         * outer strips keep whatever the caller's rectangle allows. The
+         * decomposition only needs to look a little beyond the strip.
+         */
+        r.p.x = pfs->rect.p.x - fixed_1;
+        r.q.x = pfs->rect.q.x + fixed_1;
+        r.p.y = (i == 0 ? pfs->rect.p.y - fixed_1 : int2fixed(sy0));
+        r.q.y = (i == n - 1 ? pfs->rect.q.y + fixed_1 : int2fixed(sy1));
+        if (i > 0)
+            s->pfs.rect.p.y = max(pfs->rect.p.y, int2fixed(sy0 - 1));
+        if (i < n - 1)
+            s->pfs.rect.q.y = min(pfs->rect.q.y, int2fixed(sy1 + 1));
+        gx_cpath_init_local(&s->strip_path, mem);
+        code = gx_cpath_from_rectangle(&s->strip_path, &r);
+        if (code < 0) {
+            gx_cpath_free(&s->strip_path, "gx_shade_strips_init");
+            break;
+        }
+        if (clipped)
+            inner = gx_copy_clip_device_on_stack(&s->clipper, dev);
+        gx_make_clip_device_on_stack(&s->strip_clipper, &s->strip_path, inner);
+        s->pfs.dev = s->pfs.trans_device = (gx_device *)&s->strip_clipper;
+        s->pfs.color_stack = NULL;
+        s->pfs.wedge_vertex_list_elem_buffer = NULL;
+        s->pfs.pcic = NULL;
+        s->pfs.color_lock = pss->color_lock;
+        s->pfs.function_lock = pss->function_lock;
+        pss->num_strips = i + 1;
+        code = alloc_patch_fill_memory(&s->pfs, mem, pfs->direct_space);
+        if (code < 0)
+            break;
+        if (s->pfs.pcic != NULL)
+            gs_color_index_cache_set_lock(s->pfs.pcic, pss->color_lock);
+        if (i == 0)
+            continue;           /* The caller fills the first strip. */
+        s->start = gx_semaphore_alloc(mem);
+        s->done = gx_semaphore_alloc(mem);
+        if (s->start == NULL || s->done == NULL) {
+            code = gs_note_error(gs_error_VMerror);
+            break;
+        }
+        /* If we can't have a thread, the caller fills the strip too. */
+        if (gp_thread_start(shade_strip_thread, s, &s->thread) < 0)
+            s->thread = NULL;
+    }
+    if (i < n) {
+        gx_shade_strips_free(pss);
+        return code;
+    }
+    return 1;
+}
+
+void
+gx_shade_strips_add(shade_strips_t *pss, int index, const gs_fixed_rect *bbox)
+{
+    /* Allow for the paddings between patches, and for rounding. */
+    fixed y0 = bbox->p.y - INTERPATCH_PADDING - fixed_1;
+    fixed y1 = bbox->q.y + INTERPATCH_PADDING + fixed_1;
+    int i;
+
+    for (i = 0; i < pss->num_strips; i++) {
+        shade_strip_t *s = &pss->strips[i];
+
+        if (y0 < s->pfs.rect.q.y && y1 > s->pfs.rect.p.y)
+            s->items[s->num_items++] = index;
+    }
+}
+
+/* Fill the queues of all the strips at once, and wait until they are done. */
+int
+gx_shade_strips_fill(shade_strips_t *pss, shade_strip_proc_t proc, void *data)
+{
+    int i, code = 0;
+
+    pss->proc = proc;
+    pss->data = data;
+    for (i = 1; i < pss->num_strips; i++)
+        if (pss->strips[i].thread != NULL)
+            gx_semaphore_signal(pss->strips[i].start);
+    for (i = 0; i < pss->num_strips; i++)
+        if (pss->strips[i].thread == NULL)
+            shade_strip_run(&pss->strips[i]);
+    for (i = 0; i < pss->num_strips; i++) {
+        shade_strip_t *s = &pss->strips[i];
+
+        if (s->thread != NULL)
+            gx_semaphore_wait(s->done);
+        if (s->code < 0 && code == 0)
+            code = s->code;
+        s->num_items = 0;
+    }
+    return code;
+}
+
+void
+gx_shade_strips_free(shade_strips_t *pss)
+{
+    int i;
+
+    pss->finish = true;
+    for (i = 0; i < pss->num_strips; i++) {
+        shade_strip_t *s = &pss->strips[i];
+
+        if (s->thread != NULL) {
+            gx_semaphore_signal(s->start);
+            gp_thread_finish(s->thread);
+        }
+        if (s->start != NULL)
+            gx_semaphore_free(s->start);
+        if (s->done != NULL)
+            gx_semaphore_free(s->done);
+        term_patch_fill_state(&s->pfs);
+        gx_destroy_clip_device_on_stack(&s->strip_clipper);
+        gx_cpath_free(&s->strip_path, "gx_shade_strips_free");
+    }
+    gs_free_object(pss->memory, pss->items, "gx_shade_strips_free");
+    gs_free_object(pss->memory, pss->strips, "gx_shade_strips_free");
+    if (pss->color_lock != NULL)
+        gx_monitor_free(pss->color_lock);
+    if (pss->function_lock != NULL)
+        gx_monitor_free(pss->function_lock);
+    pss->num_strips = 0;
+    pss->strips = NULL;
+    pss->items = NULL;
+    pss->color_lock = NULL;
+    pss->function_lock = NULL;
+}
+
 /* ================ Specific shadings ================ */
 
 /*
@@ -402,6 +710,131 @@ curve_eval(gs_fixed_point * pt, const gs_fixed_point * p0,
               fixed2float(pt->y));
 }
 
+/*
+ * Rendering by strips reads the patches of the mesh into a batch here, and
+ * queues each of them on the strips that its bounding box reaches. A
+ * record holds the 4 vertices, the 8 control points and the 4 interior
+ * points (already swapped into Tpp_transform order) of a patch, followed
+ * by the colors of the 4 vertices.
+ */
+typedef void (*patch_transform_proc_t)(gs_fixed_point *, const patch_curve_t[4],
+                                       const gs_fixed_point[4], double, double);
+
+typedef struct patch_batch_s {
+    byte *data;
+    int record_size;
+    int num_values;             /* Color values per vertex. */
+    int count;
+    int max_count;
+    bool tensor;
+    patch_transform_proc_t transform;
+} patch_batch_t;
+
+static void patch_bbox(gs_fixed_rect *bbox, const patch_curve_t curve[4],
+                       const gs_fixed_point interior[4]);
+
+static void
+patch_batch_add(patch_batch_t *pb, shade_strips_t *pss, const patch_curve_t curve[4],
+                const gs_fixed_point interior[4])
+{
+    byte *rec = pb->data + (size_t)pb->count * pb->record_size;
+    gs_fixed_point *pt = (gs_fixed_point *)rec;
+    float *cc = (float *)(pt + 16);
+    gs_fixed_rect bbox;
+    int i;
+
+    for (i = 0; i < 4; i++) {
+        pt[i * 3] = curve[i].vertex.p;
+        pt[i * 3 + 1] = curve[i].control[0];
+        pt[i * 3 + 2] = curve[i].control[1];
+        memcpy(cc + i * pb->num_values, curve[i].vertex.cc,
+               pb->num_values * sizeof(float));
+    }
+    if (pb->tensor) {
+        pt[12] = interior[0];
+        pt[13] = interior[3];
+        pt[14] = interior[2];
+        pt[15] = interior[1];
+    }
+    patch_bbox(&bbox, curve, (pb->tensor ? pt + 12 : NULL));
+    gx_shade_strips_add(pss, pb->count, &bbox);
+    pb->count++;
+}
+
+static int
+patch_batch_fill(patch_fill_state_t *pfs, void *data, int index)
+{
+    const patch_batch_t *pb = (const patch_batch_t *)data;
+    const gs_fixed_point *pt =
+        (const gs_fixed_point *)(pb->data + (size_t)index * pb->record_size);
+    const float *cc = (const float *)(pt + 16);
+    patch_curve_t curve[4];
+    int i;
+
+    for (i = 0; i < 4; i++) {
+        curve[i].vertex.p = pt[i * 3];
+        curve[i].control[0] = pt[i * 3 + 1];
+        curve[i].control[1] = pt[i * 3 + 2];
+        curve[i].straight = false;
+        memcpy(curve[i].vertex.cc, cc + i * pb->num_values,
+               pb->num_values * sizeof(float));
+    }
+    return patch_fill(pfs, curve, (pb->tensor ? pt + 12 : NULL), pb->transform);
+}
+
+/*
+ * Read the patches of a shading and fill them by strips. Return 1 if done,
+ * or 0 if the shading should be rendered serially.
+ */
+static int
+patch_fill_by_strips(patch_fill_state_t *pfs, shade_coord_stream_t *cs,
+                     int BitsPerFlag, bool tensor, patch_transform_proc_t transform)
+{
+    shade_strips_t strips, *pss = &strips;
+    patch_batch_t pb;
+    patch_curve_t curve[4];
+    gs_fixed_point interior[4];
+    int code, code1;
+
+    pb.num_values = (pfs->Function != NULL ? 2 : pfs->num_components);
+    pb.record_size = (16 * sizeof(gs_fixed_point) +
+                      4 * pb.num_values * sizeof(float) + 7) & ~7;
+    pb.max_count = max(SHADE_STRIPS_BATCH_SIZE / pb.record_size, 1);
+    pb.count = 0;
+    pb.tensor = tensor;
+    pb.transform = transform;
+    code = gx_shade_strips_init(pss, pfs, pb.max_count);
+    if (code <= 0)
+        return code;
+    pb.data = gs_alloc_bytes(pfs->memory, (size_t)pb.max_count * pb.record_size,
+                             "patch_fill_by_strips");
+    if (pb.data == NULL) {
+        gx_shade_strips_free(pss);
+        return_error(gs_error_VMerror);
+    }
+    for (;;) {
+        code = shade_next_patch(cs, BitsPerFlag, curve, (tensor ? interior : NULL));
+        if (code == 0) {
+            patch_batch_add(&pb, pss, curve, interior);
+            if (pb.count < pb.max_count)
+                continue;
+        }
+        if (pb.count > 0) {
+            code1 = gx_shade_strips_fill(pss, patch_batch_fill, &pb);
+            pb.count = 0;
+            if (code1 < 0) {
+                code = code1;
+                break;
+            }
+        }
+        if (code != 0)
+            break;
+    }
+    gs_free_object(pfs->memory, pb.data, "patch_fill_by_strips");
+    gx_shade_strips_free(pss);
+    return (code < 0 ? code : 1);
+}
+
 /* ---------------- Coons patch shading ---------------- */
 
 /* Calculate the device-space coordinate corresponding to (u,v). */
@@ -464,11 +897,15 @@ gs_shading_Cp_fill_rectangle(const gs_shading_t * psh0, const gs_rect * rect,
 
     curve[0].straight = curve[1].straight = curve[2].straight = curve[3].straight = false;
     shade_next_init(&cs, (const gs_shading_mesh_params_t *)&psh->params, pgs);
-    while ((code = shade_next_patch(&cs, psh->params.BitsPerFlag,
-                                    curve, NULL)) == 0 &&
-           (code = patch_fill(&state, curve, NULL, Cp_transform)) >= 0
-        ) {
-        DO_NOTHING;
+    code = patch_fill_by_strips(&state, &cs, psh->params.BitsPerFlag,
+                                false, Cp_transform);
+    if (code == 0) {
+        while ((code = shade_next_patch(&cs, psh->params.BitsPerFlag,
+                                        curve, NULL)) == 0 &&
+               (code = patch_fill(&state, curve, NULL, Cp_transform)) >= 0
+            ) {
+            DO_NOTHING;
+        }
     }
     if (term_patch_fill_state(&state))
         return_error(gs_error_unregistered); /* Must not happen. */
@@ -551,21 +988,25 @@ gs_shading_Tpp_fill_rectangle(const gs_shading_t * psh0, const gs_rect * rect,
         return code;
     curve[0].straight = curve[1].straight = curve[2].straight = curve[3].straight = false;
     shade_next_init(&cs, (const gs_shading_mesh_params_t *)&psh->params, pgs);
-    while ((code = shade_next_patch(&cs, psh->params.BitsPerFlag,
-                                    curve, interior)) == 0) {
-        /*
-         * The order of points appears to be consistent with that for Coons
-         * patches, which is different from that documented in Red Book 3.
-         */
-        gs_fixed_point swapped_interior[4];
+    code = patch_fill_by_strips(&state, &cs, psh->params.BitsPerFlag,
+                                true, Tpp_transform);
+    if (code == 0) {
+        while ((code = shade_next_patch(&cs, psh->params.BitsPerFlag,
+                                        curve, interior)) == 0) {
+            /*
+             * The order of points appears to be consistent with that for Coons
+             * patches, which is different from that documented in Red Book 3.
+             */
+            gs_fixed_point swapped_interior[4];
 
-        swapped_interior[0] = interior[0];
-        swapped_interior[1] = interior[3];
-        swapped_interior[2] = interior[2];
-        swapped_interior[3] = interior[1];
-        code = patch_fill(&state, curve, swapped_interior, Tpp_transform);
-        if (code < 0)
-            break;
+            swapped_interior[0] = interior[0];
+            swapped_interior[1] = interior[3];
+            swapped_interior[2] = interior[2];
+            swapped_interior[3] = interior[1];
+            code = patch_fill(&state, curve, swapped_interior, Tpp_transform);
+            if (code < 0)
+                break;
+        }
     }
     if (term_patch_fill_state(&state))
         return_error(gs_error_unregistered); /* Must not happen. */
@@ -1370,8 +1811,10 @@ patch_color_to_device_color_inline(const patch_fill_state_t *pfs,
                 pdevc = &devc;
             memcpy(fcc.paint.values, c->cc.paint.values,
                         sizeof(fcc.paint.values[0]) * pfs->num_components);
+            shade_lock_enter(pfs->color_lock);
             code = pcs->type->remap_color(&fcc, pcs, pdevc, pfs->pgs,
                                       pfs->trans_device, gs_color_select_texture);
+            shade_lock_leave(pfs->color_lock);
             if (code < 0)
                 return code;
             if (frac_values != NULL) {
@@ -1459,8 +1902,11 @@ isnt_color_monotonic(const patch_fill_state_t *pfs, const patch_color_t *c0, con
        and the result with them may be imprecise.
      */
     uint mask;
-    int code = gs_function_is_monotonic(pfs->Function, c0->t, c1->t, &mask);
+    int code;
 
+    shade_lock_enter(pfs->function_lock);
+    code = gs_function_is_monotonic(pfs->Function, c0->t, c1->t, &mask);
+    shade_lock_leave(pfs->function_lock);
     if (code >= 0)
         return mask;
     return code;
@@ -1543,8 +1989,10 @@ is_color_linear(const patch_fill_state_t *pfs, const patch_color_t *c0, const pa
             return 0;
         if (pfs->cs_always_linear)
             return 1;
+        shade_lock_enter(pfs->color_lock);
         code = cs_is_linear(cs, pfs->pgs, pfs->trans_device,
                 &c0->cc, &c1->cc, NULL, NULL, pfs->smoothness - s, pfs->icclink);
+        shade_lock_leave(pfs->color_lock);
         if (code <= 0)
             return code;
         return 1;
@@ -2080,10 +2528,13 @@ try_device_linear_color(patch_fill_state_t *pfs, bool wedge,
             s012 = max(s01, s2);
             if (pfs->cs_always_linear)
                 code = 1;
-            else
+            else {
+                shade_lock_enter(pfs->color_lock);
                 code = cs_is_linear(cs, pfs->pgs, pfs->trans_device,
                                   &p0->c->cc, &p1->c->cc, &p2->c->cc, NULL,
                                   pfs->smoothness - s012, pfs->icclink);
+                shade_lock_leave(pfs->color_lock);
+            }
             if (code < 0)
                 return code;
             if (code == 0)
@@ -3035,6 +3486,8 @@ gx_init_patch_fill_state_for_clist(gx_device *dev, patch_fill_state_t *pfs, gs_m
     pfs->color_stack = NULL; /* fixme */
     pfs->color_stack_limit = NULL; /* fixme */
     pfs->pcic = NULL; /* Will do someday. */
+    pfs->color_lock = NULL;
+    pfs->function_lock = NULL;
     pfs->trans_device = NULL;
     pfs->icclink = NULL;
     return alloc_patch_fill_memory(pfs, memory, NULL);
@@ -4048,64 +4501,91 @@ patch_set_color(const patch_fill_state_t *pfs, patch_color_t *c, const float *cc
         memcpy(c->cc.paint.values, cc, sizeof(c->cc.paint.values[0]) * pfs->num_components);
 }
 
+/* Compute the poles of a Coons or tensor patch. */
 static void
-make_tensor_patch(const patch_fill_state_t *pfs, tensor_patch *p, const patch_curve_t curve[4],
+make_tensor_patch_poles(gs_fixed_point pole[4][4], const patch_curve_t curve[4],
            const gs_fixed_point interior[4])
 {
-    const gs_color_space *pcs = pfs->direct_space;
-
-    p->pole[0][0] = curve[0].vertex.p;
-    p->pole[1][0] = curve[0].control[0];
-    p->pole[2][0] = curve[0].control[1];
-    p->pole[3][0] = curve[1].vertex.p;
-    p->pole[3][1] = curve[1].control[0];
-    p->pole[3][2] = curve[1].control[1];
-    p->pole[3][3] = curve[2].vertex.p;
-    p->pole[2][3] = curve[2].control[0];
-    p->pole[1][3] = curve[2].control[1];
-    p->pole[0][3] = curve[3].vertex.p;
-    p->pole[0][2] = curve[3].control[0];
-    p->pole[0][1] = curve[3].control[1];
+    pole[0][0] = curve[0].vertex.p;
+    pole[1][0] = curve[0].control[0];
+    pole[2][0] = curve[0].control[1];
+    pole[3][0] = curve[1].vertex.p;
+    pole[3][1] = curve[1].control[0];
+    pole[3][2] = curve[1].control[1];
+    pole[3][3] = curve[2].vertex.p;
+    pole[2][3] = curve[2].control[0];
+    pole[1][3] = curve[2].control[1];
+    pole[0][3] = curve[3].vertex.p;
+    pole[0][2] = curve[3].control[0];
+    pole[0][1] = curve[3].control[1];
     if (interior != NULL) {
-        p->pole[1][1] = interior[0];
-        p->pole[1][2] = interior[1];
-        p->pole[2][2] = interior[2];
-        p->pole[2][1] = interior[3];
+        pole[1][1] = interior[0];
+        pole[1][2] = interior[1];
+        pole[2][2] = interior[2];
+        pole[2][1] = interior[3];
     } else {
-        p->pole[1][1].x = (fixed)((3*(lcp1(p->pole[0][1].x, p->pole[3][1].x) +
-                                      lcp1(p->pole[1][0].x, p->pole[1][3].x)) -
-                                   lcp1(lcp1(p->pole[0][0].x, p->pole[0][3].x),
-                                        lcp1(p->pole[3][0].x, p->pole[3][3].x)))/9);
-        p->pole[1][2].x = (fixed)((3*(lcp1(p->pole[0][2].x, p->pole[3][2].x) +
-                                      lcp2(p->pole[1][0].x, p->pole[1][3].x)) -
-                                   lcp1(lcp2(p->pole[0][0].x, p->pole[0][3].x),
-                                        lcp2(p->pole[3][0].x, p->pole[3][3].x)))/9);
-        p->pole[2][1].x = (fixed)((3*(lcp2(p->pole[0][1].x, p->pole[3][1].x) +
-                                      lcp1(p->pole[2][0].x, p->pole[2][3].x)) -
-                                   lcp2(lcp1(p->pole[0][0].x, p->pole[0][3].x),
-                                        lcp1(p->pole[3][0].x, p->pole[3][3].x)))/9);
-        p->pole[2][2].x = (fixed)((3*(lcp2(p->pole[0][2].x, p->pole[3][2].x) +
-                                      lcp2(p->pole[2][0].x, p->pole[2][3].x)) -
-                                   lcp2(lcp2(p->pole[0][0].x, p->pole[0][3].x),
-                                        lcp2(p->pole[3][0].x, p->pole[3][3].x)))/9);
-
-        p->pole[1][1].y = (fixed)((3*(lcp1(p->pole[0][1].y, p->pole[3][1].y) +
-                                      lcp1(p->pole[1][0].y, p->pole[1][3].y)) -
-                                   lcp1(lcp1(p->pole[0][0].y, p->pole[0][3].y),
-                                        lcp1(p->pole[3][0].y, p->pole[3][3].y)))/9);
-        p->pole[1][2].y = (fixed)((3*(lcp1(p->pole[0][2].y, p->pole[3][2].y) +
-                                      lcp2(p->pole[1][0].y, p->pole[1][3].y)) -
-                                   lcp1(lcp2(p->pole[0][0].y, p->pole[0][3].y),
-                                        lcp2(p->pole[3][0].y, p->pole[3][3].y)))/9);
-        p->pole[2][1].y = (fixed)((3*(lcp2(p->pole[0][1].y, p->pole[3][1].y) +
-                                      lcp1(p->pole[2][0].y, p->pole[2][3].y)) -
-                                   lcp2(lcp1(p->pole[0][0].y, p->pole[0][3].y),
-                                        lcp1(p->pole[3][0].y, p->pole[3][3].y)))/9);
-        p->pole[2][2].y = (fixed)((3*(lcp2(p->pole[0][2].y, p->pole[3][2].y) +
-                                      lcp2(p->pole[2][0].y, p->pole[2][3].y)) -
-                                   lcp2(lcp2(p->pole[0][0].y, p->pole[0][3].y),
-                                        lcp2(p->pole[3][0].y, p->pole[3][3].y)))/9);
+        pole[1][1].x = (fixed)((3*(lcp1(pole[0][1].x, pole[3][1].x) +
+                                   lcp1(pole[1][0].x, pole[1][3].x)) -
+                                lcp1(lcp1(pole[0][0].x, pole[0][3].x),
+                                     lcp1(pole[3][0].x, pole[3][3].x)))/9);
+        pole[1][2].x = (fixed)((3*(lcp1(pole[0][2].x, pole[3][2].x) +
+                                   lcp2(pole[1][0].x, pole[1][3].x)) -
+                                lcp1(lcp2(pole[0][0].x, pole[0][3].x),
+                                     lcp2(pole[3][0].x, pole[3][3].x)))/9);
+        pole[2][1].x = (fixed)((3*(lcp2(pole[0][1].x, pole[3][1].x) +
+                                   lcp1(pole[2][0].x, pole[2][3].x)) -
+                                lcp2(lcp1(pole[0][0].x, pole[0][3].x),
+                                     lcp1(pole[3][0].x, pole[3][3].x)))/9);
+        pole[2][2].x = (fixed)((3*(lcp2(pole[0][2].x, pole[3][2].x) +
+                                   lcp2(pole[2][0].x, pole[2][3].x)) -
+                                lcp2(lcp2(pole[0][0].x, pole[0][3].x),
+                                     lcp2(pole[3][0].x, pole[3][3].x)))/9);
+
+        pole[1][1].y = (fixed)((3*(lcp1(pole[0][1].y, pole[3][1].y) +
+                                   lcp1(pole[1][0].y, pole[1][3].y)) -
+                                lcp1(lcp1(pole[0][0].y, pole[0][3].y),
+                                     lcp1(pole[3][0].y, pole[3][3].y)))/9);
+        pole[1][2].y = (fixed)((3*(lcp1(pole[0][2].y, pole[3][2].y) +
+                                   lcp2(pole[1][0].y, pole[1][3].y)) -
+                                lcp1(lcp2(pole[0][0].y, pole[0][3].y),
+                                     lcp2(pole[3][0].y, pole[3][3].y)))/9);
+        pole[2][1].y = (fixed)((3*(lcp2(pole[0][1].y, pole[3][1].y) +
+                                   lcp1(pole[2][0].y, pole[2][3].y)) -
+                                lcp2(lcp1(pole[0][0].y, pole[0][3].y),
+                                     lcp1(pole[3][0].y, pole[3][3].y)))/9);
+        pole[2][2].y = (fixed)((3*(lcp2(pole[0][2].y, pole[3][2].y) +
+                                   lcp2(pole[2][0].y, pole[2][3].y)) -
+                                lcp2(lcp2(pole[0][0].y, pole[0][3].y),
+                                     lcp2(pole[3][0].y, pole[3][3].y)))/9);
     }
+}
+
+/* Compute the bounding box of a patch, for rendering it by strips. */
+static void
+patch_bbox(gs_fixed_rect *bbox, const patch_curve_t curve[4],
+           const gs_fixed_point interior[4])
+{
+    gs_fixed_point pole[4][4];
+    int i, j;
+
+    make_tensor_patch_poles(pole, curve, interior);
+    bbox->p = bbox->q = pole[0][0];
+    for (i = 0; i < 4; i++)
+        for (j = 0; j < 4; j++) {
+            bbox->p.x = min(bbox->p.x, pole[i][j].x);
+            bbox->p.y = min(bbox->p.y, pole[i][j].y);
+            bbox->q.x = max(bbox->q.x, pole[i][j].x);
+            bbox->q.y = max(bbox->q.y, pole[i][j].y);
+        }
+}
+
+static void
+make_tensor_patch(const patch_fill_state_t *pfs, tensor_patch *p, const patch_curve_t curve[4],
+           const gs_fixed_point interior[4])
+{
+    const gs_color_space *pcs = pfs->direct_space;
+
+    make_tensor_patch_poles(p->pole, curve, interior);
     patch_set_color(pfs, p->c[0][0], curve[0].vertex.cc);
     patch_set_color(pfs, p->c[1][0], curve[1].vertex.cc);
     patch_set_color(pfs, p->c[1][1], curve[2].vertex.cc);
@@ -436,22 +436,43 @@ int ttfFont__Open_aux(ttfFont *self, ttfInterpreter *tti, gx_ttfReader *r, gs_fo
 {
     gs_point char_size, subpix_origin;
     gs_matrix post_transform;
+    bool dg;
+
+    /* The face isn't opened until a glyph misses the outline cache,
+       since the font's programs may never have to be run at this size. */
+    decompose_matrix(pfont, char_tm, log2_scale, design_grid, &char_size, &subpix_origin, &post_transform, &dg);
+    self->tti = tti;
+    self->design_grid = dg;
+    self->w = char_size.x;
+    self->h = char_size.y;
+    self->opened = false;
+    return 0;
+}
+
+static int ttfFont__open_now(ttfFont *self, gx_ttfReader *r, gs_font_type42 *pfont)
+{
     /*
      * Ghostscript proceses a TTC index in gs/lib/gs_ttf.ps,
      * and *pfont already adjusted to it.
      * Therefore TTC headers never comes here.
      */
     unsigned int nTTC = 0;
-    bool dg;
+    int code;
 
-    decompose_matrix(pfont, char_tm, log2_scale, design_grid, &char_size, &subpix_origin, &post_transform, &dg);
-    switch(ttfFont__Open(tti, self, &r->super, nTTC, char_size.x, char_size.y, dg)) {
+    if (self->opened)
+        return self->open_code;
+    self->opened = true;
+    gx_ttfReader__Reset(r);
+    switch(ttfFont__Open(self->tti, self, &r->super, nTTC, self->w, self->h, self->design_grid)) {
         case fNoError:
-            return 0;
+            code = 0;
+            break;
         case fMemoryError:
-            return_error(gs_error_VMerror);
+            code = gs_note_error(gs_error_VMerror);
+            break;
         case fUnimplemented:
-            return_error(gs_error_unregistered);
+            code = gs_note_error(gs_error_unregistered);
+            break;
         case fBadInstruction:
             WarnBadInstruction(pfont, -1);
             goto recover;
@@ -459,15 +480,219 @@ int ttfFont__Open_aux(ttfFont *self, ttfInterpreter *tti, gx_ttfReader *r, gs_fo
             WarnPatented(pfont, self, "The font");
         recover:
             self->patented = true;
-            return 0;
+            code = 0;
+            break;
         default:
-            {	int code = r->super.Error(&r->super);
+            code = r->super.Error(&r->super);
+            if (code >= 0)
+                code = gs_note_error(gs_error_invalidfont);
+            break;
+    }
+    self->open_code = code;
+    return code;
+}
 
-                if (code < 0)
-                    return code;
-                return_error(gs_error_invalidfont);
+/*----------------------------------------------*/
+
+/*
+ * Grid fitting a glyph gives the same points for every transformation with
+ * the same scale, because rotation and skewing are applied after the
+ * interpreter (see decompose_matrix). But each font/matrix pair has its own
+ * face instance, so text shown at many angles would run the font's prep and
+ * every glyph program again for each angle. The font directory keeps the
+ * fitted outlines, keyed by the font, the scale and grid the instance is
+ * opened with, the subpixel origin and the glyph, and a pair only opens its
+ * instance when it meets a glyph that isn't there.
+ */
+#define TTF_OUTLINE_CACHE_SIZE (4 * 1024 * 1024)
+#define TTF_OUTLINE_CACHE_HASH 1024 /* A power of 2. */
+
+typedef struct gx_ttf_cached_outline_s gx_ttf_cached_outline;
+struct gx_ttf_cached_outline_s {
+    gx_ttf_cached_outline *next;  /* in the hash chain */
+    gx_ttf_cached_outline *prev_used, *next_used; /* most recently used first */
+    uint hash;
+    uint size;
+    /* The key. */
+    gs_uid UID;			/* XUID values follow the structure */
+    font_type FontType;
+    gs_id font_id;		/* if the UID isn't valid */
+    long ww, hh;		/* the scale in 26.6, 0 for the design grid */
+    bool design_grid;
+    float orig_x, orig_y;
+    uint glyph_index;
+    bool vertical;
+    /* The value. */
+    ttfSavedGlyph glyph;
+};
+
+struct gx_ttf_outline_cache_s {
+    gs_memory_t *memory;
+    gx_ttf_cached_outline *table[TTF_OUTLINE_CACHE_HASH];
+    gx_ttf_cached_outline *first_used, *last_used;
+    uint size;
+};
+
+/* Fill in the key of a cache entry, except for the XUID values. */
+static void
+ttf_outline_key(gx_ttf_cached_outline *key, const ttfFont *ttf, const gs_font_type42 *pfont,
+                int glyph_index, const gs_point *subpix_origin)
+{
+    uint i, h;
+
+    key->UID = pfont->UID;
+    key->FontType = pfont->FontType;
+    key->font_id = (uid_is_valid(&pfont->UID) ? 0 : pfont->id);
+    key->design_grid = ttf->design_grid;
+    /* Rounded as ttfFont__Open rounds them. */
+    key->ww = (ttf->design_grid ? 0 : (long)(ttf->w * (1 << 6) + 0.5));
+    key->hh = (ttf->design_grid ? 0 : (long)(ttf->h * (1 << 6) + 0.5));
+    key->orig_x = subpix_origin->x;
+    key->orig_y = subpix_origin->y;
+    key->glyph_index = glyph_index;
+    key->vertical = (pfont->WMode != 0);
+    h = (uint)key->font_id * 31 + (uint)key->UID.id;
+    if (uid_is_XUID(&pfont->UID))
+        for (i = 0; i < uid_XUID_size(&pfont->UID); i++)
+            h = h * 31 + (uint)uid_XUID_values(&pfont->UID)[i];
+    h = h * 31 + (uint)key->ww;
+    h = h * 31 + (uint)key->hh;
+    h = h * 31 + (uint)(int)(key->orig_x * 64) + (uint)(int)(key->orig_y * 4096);
+    key->hash = h * 59 + glyph_index * 73;
+}
+
+static bool
+ttf_outline_key_equal(const gx_ttf_cached_outline *e, const gx_ttf_cached_outline *key)
+{
+    return e->hash == key->hash && e->glyph_index == key->glyph_index &&
+        e->ww == key->ww && e->hh == key->hh &&
+        e->design_grid == key->design_grid && e->vertical == key->vertical &&
+        e->orig_x == key->orig_x && e->orig_y == key->orig_y &&
+        e->font_id == key->font_id && e->FontType == key->FontType &&
+        uid_equal(&e->UID, &key->UID);
+}
+
+static void
+ttf_outline_unlink_used(gx_ttf_outline_cache *c, gx_ttf_cached_outline *e)
+{
+    if (e->prev_used)
+        e->prev_used->next_used = e->next_used;
+    else
+        c->first_used = e->next_used;
+    if (e->next_used)
+        e->next_used->prev_used = e->prev_used;
+    else
+        c->last_used = e->prev_used;
+}
+
+static void
+ttf_outline_link_used(gx_ttf_outline_cache *c, gx_ttf_cached_outline *e)
+{
+    e->prev_used = NULL;
+    e->next_used = c->first_used;
+    if (c->first_used)
+        c->first_used->prev_used = e;
+    else
+        c->last_used = e;
+    c->first_used = e;
+}
+
+static void
+ttf_outline_remove(gx_ttf_outline_cache *c, gx_ttf_cached_outline *e)
+{
+    gx_ttf_cached_outline **pe = &c->table[e->hash & (TTF_OUTLINE_CACHE_HASH - 1)];
+
+    while (*pe != e)
+        pe = &(*pe)->next;
+    *pe = e->next;
+    ttf_outline_unlink_used(c, e);
+    c->size -= e->size;
+    gs_free_object(c->memory, e, "ttf_outline_remove");
+}
+
+static gx_ttf_cached_outline *
+ttf_outline_lookup(gx_ttf_outline_cache *c, const gx_ttf_cached_outline *key)
+{
+    gx_ttf_cached_outline *e = c->table[key->hash & (TTF_OUTLINE_CACHE_HASH - 1)];
+
+    for (; e != NULL; e = e->next) {
+        if (ttf_outline_key_equal(e, key)) {
+            if (c->first_used != e) {
+                ttf_outline_unlink_used(c, e);
+                ttf_outline_link_used(c, e);
             }
+            return e;
+        }
+    }
+    return NULL;
+}
+
+/* Save the outline just fitted by the interpreter. */
+static int
+ttf_outline_add(gx_ttf_outline_cache *c, const gx_ttf_cached_outline *key, ttfOutliner *o)
+{
+    uint xsize = (uid_is_XUID(&key->UID) ? uid_XUID_size(&key->UID) : 0);
+    uint size = sizeof(gx_ttf_cached_outline) + xsize * sizeof(long) +
+                ttfOutliner__SavedGlyphSize(o);
+    gx_ttf_cached_outline *e;
+    int code;
+
+    if (size > TTF_OUTLINE_CACHE_SIZE / 4)
+        return 0;
+    while (c->last_used != NULL && c->size + size > TTF_OUTLINE_CACHE_SIZE)
+        ttf_outline_remove(c, c->last_used);
+    e = (gx_ttf_cached_outline *)gs_alloc_bytes(c->memory, size, "ttf_outline_add");
+    if (e == NULL)
+        return 0; /* Not worth failing the glyph for. */
+    *e = *key;
+    e->size = size;
+    if (xsize != 0) {
+        e->UID.xvalues = (long *)(e + 1);
+        memcpy(e->UID.xvalues, uid_XUID_values(&key->UID), xsize * sizeof(long));
+    }
+    code = ttfOutliner__SaveGlyphOutline(o, &e->glyph,
+                (byte *)((long *)(e + 1) + xsize));
+    if (code < 0) {
+        gs_free_object(c->memory, e, "ttf_outline_add");
+        return code;
+    }
+    e->next = c->table[e->hash & (TTF_OUTLINE_CACHE_HASH - 1)];
+    c->table[e->hash & (TTF_OUTLINE_CACHE_HASH - 1)] = e;
+    ttf_outline_link_used(c, e);
+    c->size += size;
+    return 0;
+}
+
+static gx_ttf_outline_cache *
+ttf_outline_cache(gs_font_dir *dir)
+{
+    gx_ttf_outline_cache *c = dir->tt_outlines;
+
+    if (c == NULL) {
+        gs_memory_t *mem = dir->memory->non_gc_memory;
+
+        c = (gx_ttf_outline_cache *)gs_alloc_bytes(mem, sizeof(*c),
+                                                   "ttf_outline_cache");
+        if (c == NULL)
+            return NULL;
+        memset(c, 0, sizeof(*c));
+        c->memory = mem;
+        dir->tt_outlines = c;
     }
+    return c;
+}
+
+void
+gx_ttf_outline_cache_free(gs_font_dir *dir)
+{
+    gx_ttf_outline_cache *c = dir->tt_outlines;
+
+    if (c == NULL)
+        return;
+    while (c->first_used != NULL)
+        ttf_outline_remove(c, c->first_used);
+    gs_free_object(c->memory, c, "gx_ttf_outline_cache_free");
+    dir->tt_outlines = NULL;
 }
 
 /*----------------------------------------------*/
@@ -756,6 +981,9 @@ int gx_ttf_outline(ttfFont *ttf, gx_ttfReader *r, gs_font_type42 *pfont, int gly
     uint gftt = gs_currentgridfittt(pfont->dir);
     bool ttin = (gftt & 1);
     int code;
+    FontError error;
+    gx_ttf_outline_cache *c = NULL;
+    gx_ttf_cached_outline key;
     /*	gs_currentgridfittt values (binary) :
         00 - no grid fitting;
         01 - Grid fit with TT interpreter; On failure warn and render unhinted.
@@ -785,9 +1013,26 @@ int gx_ttf_outline(ttfFont *ttf, gx_ttfReader *r, gs_font_type42 *pfont, int gly
     e.w.x = 0;
     e.w.y = 0;
     e.monotonize = auth;
-    gx_ttfReader__Reset(r);
     ttfOutliner__init(&o, ttf, &r->super, &e.super, true, false, pfont->WMode != 0);
-    switch(ttfOutliner__Outline(&o, glyph_index, subpix_origin.x, subpix_origin.y, &m1)) {
+    /* The autohinter works on the transformed outline, so only an outline
+       drawn straight from the interpreter's points can be cached. */
+    if (design_grid || ttin || !auth) {
+        c = ttf_outline_cache(pfont->dir);
+        if (c != NULL) {
+            gx_ttf_cached_outline *entry;
+
+            ttf_outline_key(&key, ttf, pfont, glyph_index, &subpix_origin);
+            entry = ttf_outline_lookup(c, &key);
+            if (entry != NULL)
+                return ttfOutliner__DrawSavedGlyphOutline(&o, &entry->glyph, &m1);
+        }
+    }
+    code = ttfFont__open_now(ttf, r, pfont);
+    if (code < 0)
+        return code;
+    gx_ttfReader__Reset(r);
+    error = ttfOutliner__Outline(&o, glyph_index, subpix_origin.x, subpix_origin.y, &m1);
+    switch(error) {
         case fBadInstruction:
             WarnBadInstruction(pfont, glyph_index);
             goto recover;
@@ -802,6 +1047,11 @@ int gx_ttf_outline(ttfFont *ttf, gx_ttfReader *r, gs_font_type42 *pfont, int gly
         case fNoError:
             if (!design_grid && !ttin && auth)
                 return grid_fit(pfont->dir->san, path, pfont, pscale, &e, &o);
+            if (c != NULL && error == fNoError) {
+                code = ttf_outline_add(c, &key, &o);
+                if (code < 0)
+                    return code;
+            }
             code = ttfOutliner__DrawGlyphOutline(&o);
             if (code < 0)
                 return code;
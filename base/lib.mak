@@ -539,6 +539,7 @@ gxclip2_h=$(GLSRC)gxclip2.h
 gxclipm_h=$(GLSRC)gxclipm.h
 gxctable_h=$(GLSRC)gxctable.h
 gxfcache_h=$(GLSRC)gxfcache.h
+gxfcfile_h=$(GLSRC)gxfcfile.h
 
 gxfont_h=$(GLSRC)gxfont.h
 gxiparam_h=$(GLSRC)gxiparam.h
@@ -595,6 +596,7 @@ shc_h=$(GLSRC)shc.h
 sisparam_h=$(GLSRC)sisparam.h
 sjpeg_h=$(GLSRC)sjpeg.h
 slzwx_h=$(GLSRC)slzwx.h
+slz4x_h=$(GLSRC)slz4x.h
 smd5_h=$(GLSRC)smd5.h
 sarc4_h=$(GLSRC)sarc4.h
 saes_h=$(GLSRC)saes.h
@@ -962,7 +964,7 @@ $(GLOBJ)gscspace.$(OBJ) : $(GLSRC)gscspace.c $(AK) $(gx_h)\
 
 $(GLOBJ)gscicach.$(OBJ) : $(GLSRC)gscicach.c $(AK) $(gx_h)\
  $(gserrors_h) $(gsccolor_h) $(gxcspace_h) $(gxdcolor_h) $(gscicach_h)\
- $(memory__h) $(LIB_MAK) $(MAKEDIRS)
+ $(gxsync_h) $(memory__h) $(LIB_MAK) $(MAKEDIRS)
 	$(GLCC) $(GLO_)gscicach.$(OBJ) $(C_) $(GLSRC)gscicach.c
 
 $(GLOBJ)gsovrc.$(OBJ) : $(GLSRC)gsovrc.c $(AK) $(gx_h) $(gserrors_h)\
@@ -1323,9 +1325,10 @@ $(GLD)fapib.dev : $(INT_MAK) $(ECHOGS_XE) $(LIB_MAK) $(MAKEDIRS)
 
 $(GLD)fapif1.dev : $(INT_MAK) $(ECHOGS_XE) $(GLOBJ)fapi_ft.$(OBJ) \
  $(GLOBJ)write_t1.$(OBJ) $(GLOBJ)write_t2.$(OBJ) $(GLOBJ)wrfont.$(OBJ) \
- $(GLD)freetype.dev $(LIB_MAK) $(MAKEDIRS)
+ $(GLOBJ)gxfcfile.$(OBJ) $(md5_) $(GLD)freetype.dev $(LIB_MAK) $(MAKEDIRS)
 	$(SETMOD) $(GLD)fapif1 $(GLOBJ)fapi_ft.$(OBJ) $(GLOBJ)write_t1.$(OBJ)
 	$(ADDMOD) $(GLD)fapif1 $(GLOBJ)write_t2.$(OBJ) $(GLOBJ)wrfont.$(OBJ)
+	$(ADDMOD) $(GLD)fapif1 $(GLOBJ)gxfcfile.$(OBJ) $(md5_)
 	$(ADDMOD) $(GLD)fapif1 -include $(GLD)freetype
 	$(ADDMOD) $(GLD)fapif1 -fapi fapi_ft
 
@@ -1333,19 +1336,25 @@ $(GLOBJ)fapi_ft_0.$(OBJ) : $(GLSRC)fapi_ft.c $(AK)\
  $(stdio__h) $(malloc__h) $(write_t1_h) $(write_t2_h) $(math__h) $(gserrors_h)\
  $(gsmemory_h) $(gsmalloc_h) $(gxfixed_h) $(gdebug_h) $(gxbitmap_h)\
  $(gsmchunk_h) $(stream_h) $(gxiodev_h) $(gsfname_h) $(gxfapi_h) $(gxfont1_h)\
- $(gxfont_h) $(BASEFTCONFH) $(LIB_MAK) $(MAKEDIRS)
+ $(gxfont_h) $(gxfcfile_h) $(gsmd5_h) $(gscdefs_h) $(gslibctx_h) $(gssprintf_h)\
+ $(gxsync_h) $(BASEFTCONFH) $(LIB_MAK) $(MAKEDIRS)
 	$(GLFTCC) $(FT_CFLAGS) $(D_)FT_CONFIG_OPTIONS_H=\"$(FTCONFH)\"$(_D) $(GLO_)fapi_ft_0.$(OBJ) $(C_) $(GLSRC)fapi_ft.c
 
 $(GLOBJ)fapi_ft_1.$(OBJ) : $(GLSRC)fapi_ft.c $(AK)\
  $(stdio__h) $(malloc__h) $(write_t1_h) $(write_t2_h) $(math__h) $(gserrors_h)\
  $(gsmemory_h) $(gsmalloc_h) $(gxfixed_h) $(gdebug_h) $(gxbitmap_h)\
  $(gsmchunk_h) $(stream_h) $(gxiodev_h) $(gsfname_h) $(gxfapi_h) $(gxfont1_h)\
- $(gxfont_h) $(BASEFTCONFH) $(LIB_MAK) $(MAKEDIRS)
+ $(gxfont_h) $(gxfcfile_h) $(gsmd5_h) $(gscdefs_h) $(gslibctx_h) $(gssprintf_h)\
+ $(gxsync_h) $(BASEFTCONFH) $(LIB_MAK) $(MAKEDIRS)
 	$(GLCC) $(FT_CFLAGS) $(GLO_)fapi_ft_1.$(OBJ) $(C_) $(GLSRC)fapi_ft.c
 
 $(GLOBJ)fapi_ft.$(OBJ) : $(GLOBJ)fapi_ft_$(SHARE_FT).$(OBJ)
 	$(CP_) $(GLOBJ)fapi_ft_$(SHARE_FT).$(OBJ) $(GLOBJ)fapi_ft.$(OBJ)
 
+$(GLOBJ)gxfcfile.$(OBJ) : $(GLSRC)gxfcfile.c $(AK) $(gx_h) $(gserrors_h)\
+ $(memory__h) $(string__h) $(gp_h) $(gssprintf_h) $(gxfcfile_h) $(LIB_MAK) $(MAKEDIRS)
+	$(GLCC) $(GLO_)gxfcfile.$(OBJ) $(C_) $(GLSRC)gxfcfile.c
+
 # stub for FreeType bridge :
 
 $(GLD)fapif0.dev : $(INT_MAK) $(ECHOGS_XE) $(LIB_MAK) $(MAKEDIRS)
@@ -1789,6 +1798,17 @@ $(GLOBJ)slzwd.$(OBJ) : $(GLSRC)slzwd.c $(AK) $(stdio__h) $(gdebug_h)\
  $(slzwx_h) $(strimpl_h) $(LIB_MAK) $(MAKEDIRS)
 	$(GLCC) $(GLO_)slzwd.$(OBJ) $(C_) $(GLSRC)slzwd.c
 
+# ---------------- Fast LZ (LZ4-style) filters ---------------- #
+# These are only used internally, for RAM-based band lists.
+
+$(GLOBJ)slz4e.$(OBJ) : $(GLSRC)slz4e.c $(AK) $(memory__h) $(stdint__h)\
+ $(slz4x_h) $(strimpl_h) $(LIB_MAK) $(MAKEDIRS)
+	$(GLCC) $(GLO_)slz4e.$(OBJ) $(C_) $(GLSRC)slz4e.c
+
+$(GLOBJ)slz4d.$(OBJ) : $(GLSRC)slz4d.c $(AK) $(memory__h)\
+ $(slz4x_h) $(strimpl_h) $(LIB_MAK) $(MAKEDIRS)
+	$(GLCC) $(GLO_)slz4d.$(OBJ) $(C_) $(GLSRC)slz4d.c
+
 # ---------------- MD5 digest filter ---------------- #
 
 smd5_=$(GLOBJ)smd5.$(OBJ)
@@ -2278,7 +2298,8 @@ $(GLOBJ)gxclfile.$(OBJ) : $(GLSRC)gxclfile.c $(stdio__h) $(string__h)\
 
 # Implement band lists in memory (RAM).
 
-clmemory_=$(GLOBJ)gxclmem.$(OBJ) $(GLOBJ)gxcl$(BAND_LIST_COMPRESSOR).$(OBJ)
+clmemory_=$(GLOBJ)gxclmem.$(OBJ) $(GLOBJ)gxcl$(BAND_LIST_COMPRESSOR).$(OBJ)\
+ $(GLOBJ)slz4e.$(OBJ) $(GLOBJ)slz4d.$(OBJ)
 $(GLD)clmemory.dev : $(LIB_MAK) $(ECHOGS_XE) $(clmemory_) $(GLD)s$(BAND_LIST_COMPRESSOR)e.dev \
   $(GLD)s$(BAND_LIST_COMPRESSOR)d.dev $(LIB_MAK) $(MAKEDIRS)
 	$(SETMOD) $(GLD)clmemory $(clmemory_)
@@ -2289,7 +2310,8 @@ $(GLD)clmemory.dev : $(LIB_MAK) $(ECHOGS_XE) $(clmemory_) $(GLD)s$(BAND_LIST_COM
 gxclmem_h=$(GLSRC)gxclmem.h
 
 $(GLOBJ)gxclmem.$(OBJ) : $(GLSRC)gxclmem.c $(AK) $(gx_h) $(gserrors_h)\
- $(LIB_MAK) $(memory__h) $(gxclmem_h) $(gssprintf_h) $(valgrind_h) $(LIB_MAK) $(MAKEDIRS)
+ $(LIB_MAK) $(memory__h) $(gxclmem_h) $(gssprintf_h) $(gslibctx_h) $(slz4x_h)\
+ $(valgrind_h) $(LIB_MAK) $(MAKEDIRS)
 	$(GLCC) $(GLO_)gxclmem.$(OBJ) $(C_) $(GLSRC)gxclmem.c
 
 # Implement the compression method for RAM-based band lists.
@@ -2876,7 +2898,7 @@ $(GLD)func4lib.dev : $(LIB_MAK) $(ECHOGS_XE) $(func4lib_) $(GLD)funclib.dev \
 	$(ADDMOD) $(GLD)func4lib -include $(GLD)funclib
 
 $(GLOBJ)gsfunc4.$(OBJ) : $(GLSRC)gsfunc4.c $(AK) $(gx_h) $(math__h)\
- $(memory__h) $(gsdsrc_h) $(gserrors_h) $(gsfunc4_h)\
+ $(memory__h) $(gsdsrc_h) $(gserrors_h) $(gsfunc0_h) $(gsfunc4_h) $(gslibctx_h)\
  $(gxfarith_h) $(gxfunc_h) $(stream_h)\
  $(sfilter_h) $(spprint_h) $(strimpl_h) $(LIB_MAK) $(MAKEDIRS)
 	$(GLCC) $(GLO_)gsfunc4.$(OBJ) $(C_) $(GLSRC)gsfunc4.c
@@ -2947,7 +2969,8 @@ gsicc_=$(GLOBJ)gsicc_manage.$(OBJ) $(GLOBJ)gsicc_cache.$(OBJ)\
  $(GLOBJ)gsicc_$(WHICH_CMS).$(OBJ) $(GLOBJ)gsicc_profilecache.$(OBJ)\
  $(GLOBJ)gsicc_create.$(OBJ)  $(GLOBJ)gsicc_nocm.$(OBJ)\
  $(GLOBJ)gsicc_replacecm.$(OBJ) $(GLOBJ)gsicc_monitorcm.$(OBJ)\
- $(GLOBJ)gsicc_blacktext.$(OBJ)
+ $(GLOBJ)gsicc_blacktext.$(OBJ) $(GLOBJ)gsicc_lut.$(OBJ)\
+ $(GLOBJ)gsicc_rowcache.$(OBJ)
 
 sicclib_=$(GLOBJ)gsicc.$(OBJ)
 $(GLD)sicclib.dev : $(LIB_MAK) $(ECHOGS_XE) $(sicclib_) $(gsicc_) $(md5_)\
@@ -2972,10 +2995,20 @@ gsicc_blacktext_h=$(GLSRC)gsicc_blacktext.h
 
 $(GLOBJ)gsicc_monitorcm.$(OBJ) : $(GLSRC)gsicc_monitorcm.c $(AK) $(std_h)\
  $(stdpre_h) $(gstypes_h) $(gsmemory_h) $(gxdevcli_h)\
- $(gxcspace_h) $(gsicc_cms_h) $(gxcvalue_h)\
+ $(gxcspace_h) $(gsicc_cms_h) $(gxcvalue_h) $(gsicc_manage_h)\
  $(gsicc_cache_h) $(gxdevsop_h) $(gdevp14_h) $(string__h) $(LIB_MAK) $(MAKEDIRS)
 	$(GLCC) $(GLO_)gsicc_monitorcm.$(OBJ) $(C_) $(GLSRC)gsicc_monitorcm.c
 
+$(GLOBJ)gsicc_lut.$(OBJ) : $(GLSRC)gsicc_lut.c $(AK) $(gx_h)\
+ $(gxsync_h) $(gscms_h) $(gsicc_cms_h) $(gsicc_manage_h) $(gsicc_cache_h)\
+ $(gserrors_h) $(LIB_MAK) $(MAKEDIRS)
+	$(GLCC) $(GLO_)gsicc_lut.$(OBJ) $(C_) $(GLSRC)gsicc_lut.c
+
+$(GLOBJ)gsicc_rowcache.$(OBJ) : $(GLSRC)gsicc_rowcache.c $(AK) $(gx_h)\
+ $(memory__h) $(gxsync_h) $(gscms_h) $(gsicc_cache_h) $(gxgstate_h)\
+ $(gserrors_h) $(LIB_MAK) $(MAKEDIRS)
+	$(GLCC) $(GLO_)gsicc_rowcache.$(OBJ) $(C_) $(GLSRC)gsicc_rowcache.c
+
 $(GLOBJ)gsicc_nocm.$(OBJ) : $(GLSRC)gsicc_nocm.c $(AK) $(std_h) $(gx_h)\
  $(stdpre_h) $(gstypes_h) $(gsmemory_h) $(gsstruct_h) $(scommon_h) $(strmio_h)\
  $(string__h) $(gxgstate_h) $(gxcspace_h) $(gsicc_cms_h)\
@@ -3183,6 +3216,7 @@ $(GLOBJ)gsequivc.$(OBJ) : $(GLSRC)gsequivc.c $(math__h) $(PDEVH) $(gsparam_h)\
 gsipar3x_h=$(GLSRC)gsipar3x.h
 gximag3x_h=$(GLSRC)gximag3x.h
 gxblend_h=$(GLSRC)gxblend.h
+gxblsimd_h=$(GLSRC)gxblsimd.h
 gdevp14_h=$(GLSRC)gdevp14.h
 
 $(GLOBJ)gstrans.$(OBJ) : $(GLSRC)gstrans.c $(AK) $(gx_h) $(gserrors_h)\
@@ -3200,18 +3234,24 @@ $(GLOBJ)gximag3x.$(OBJ) : $(GLSRC)gximag3x.c $(AK) $(gx_h)\
 
 $(GLOBJ)gxblend_0.$(OBJ) : $(GLSRC)gxblend.c $(AK) $(gx_h) $(memory__h)\
  $(gstparam_h) $(gxblend_h) $(gxcolor2_h) $(gsicc_cache_h) $(gsrect_h)\
- $(gsicc_manage_h) $(gdevp14_h) $(gp_h) $(math__h) $(LIB_MAK) $(MAKEDIRS)
+ $(gsicc_manage_h) $(gdevp14_h) $(gp_h) $(math__h) $(gxblsimd_h)\
+ $(LIB_MAK) $(MAKEDIRS)
 	$(GLCC) $(GLO_)gxblend_0.$(OBJ) $(C_) $(GLSRC)gxblend.c
 
 $(GLOBJ)gxblend_1.$(OBJ) : $(GLSRC)gxblend.c $(AK) $(gx_h) $(memory__h)\
  $(gstparam_h) $(gxblend_h) $(gxcolor2_h) $(gsicc_cache_h) $(gsrect_h)\
- $(gsicc_manage_h) $(gdevp14_h) $(gp_h) $(math__h) $(LIB_MAK) $(MAKEDIRS)
+ $(gsicc_manage_h) $(gdevp14_h) $(gp_h) $(math__h) $(gxblsimd_h)\
+ $(LIB_MAK) $(MAKEDIRS)
 	$(GLCC) $(D_)WITH_CAL$(_D) $(I_)$(CALSRCDIR)$(_I) $(GLO_)gxblend_1.$(OBJ) $(C_) $(GLSRC)gxblend.c
 
 $(GLOBJ)gxblend.$(OBJ) : $(GLOBJ)gxblend_$(WITH_CAL).$(OBJ) $(AK) $(gx_h)\
  $(LIB_MAK) $(MAKEDIRS)
 	$(CP_) $(GLOBJ)gxblend_$(WITH_CAL).$(OBJ) $(GLOBJ)gxblend.$(OBJ)
 
+$(GLOBJ)gxblsimd.$(OBJ) : $(GLSRC)gxblsimd.c $(GLSRC)gxblsimdt.h $(AK)\
+ $(std_h) $(gxblsimd_h) $(LIB_MAK) $(MAKEDIRS)
+	$(GLCC) $(GLO_)gxblsimd.$(OBJ) $(C_) $(GLSRC)gxblsimd.c
+
 $(GLOBJ)gxblend1.$(OBJ) : $(GLSRC)gxblend1.c $(AK) $(gx_h) $(memory__h)\
  $(gstparam_h) $(gsrect_h) $(gxdcconv_h) $(gxblend_h) $(gxdevcli_h)\
  $(gxgstate_h) $(gdevdevn_h) $(gdevp14_h) $(png__h) $(gp_h)\
@@ -3246,7 +3286,8 @@ $(GLOBJ)gdevp14.$(OBJ) : $(GLOBJ)gdevp14_$(WITH_CAL).$(OBJ) $(LIB_MAK) $(MAKEDIR
 	$(CP_) $(GLOBJ)gdevp14_$(WITH_CAL).$(OBJ) $(GLOBJ)gdevp14.$(OBJ)
 
 translib_=$(GLOBJ)gstrans.$(OBJ) $(GLOBJ)gximag3x.$(OBJ)\
- $(GLOBJ)gxblend.$(OBJ) $(GLOBJ)gxblend1.$(OBJ) $(GLOBJ)gdevp14.$(OBJ) $(GLOBJ)gdevdevn.$(OBJ)\
+ $(GLOBJ)gxblend.$(OBJ) $(GLOBJ)gxblend1.$(OBJ) $(GLOBJ)gxblsimd.$(OBJ)\
+ $(GLOBJ)gdevp14.$(OBJ) $(GLOBJ)gdevdevn.$(OBJ)\
  $(GLOBJ)gsequivc.$(OBJ)  $(GLOBJ)gdevdcrd.$(OBJ)
 
 $(GLD)translib.dev : $(LIB_MAK) $(ECHOGS_XE) $(translib_)\
@@ -3306,14 +3347,15 @@ $(GLOBJ)gxshade4.$(OBJ) : $(GLSRC)gxshade4.c $(AK) $(gx_h)\
  $(gserrors_h) $(math__h) $(memory__h)\
  $(gscoord_h) $(gsmatrix_h) $(gsptype2_h)\
  $(gxcspace_h) $(gxdcolor_h) $(gxdevcli_h) $(gxgstate_h) $(gxpath_h)\
- $(gxshade_h) $(gxshade4_h) $(gsicc_cache_h) $(LIB_MAK) $(MAKEDIRS)
+ $(gxshade_h) $(gxshade4_h) $(gsicc_cache_h) $(gxsync_h) $(LIB_MAK) $(MAKEDIRS)
 	$(GLCC) $(GLO_)gxshade4.$(OBJ) $(C_) $(GLSRC)gxshade4.c
 
 $(GLOBJ)gxshade6.$(OBJ) : $(GLSRC)gxshade6.c $(AK) $(gx_h)\
  $(gserrors_h) $(memory__h) $(gxdevsop_h) $(stdint__h) $(gscoord_h)\
  $(gscicach_h) $(gsmatrix_h) $(gxcspace_h) $(gxdcolor_h) $(gxgstate_h)\
  $(gxshade_h) $(gxshade4_h) $(gxdevcli_h) $(gxarith_h) $(gzpath_h) $(math__h)\
- $(gsicc_cache_h) $(LIB_MAK) $(MAKEDIRS)
+ $(gsicc_cache_h) $(gzcpath_h) $(gxdevmem_h) $(gslibctx_h) $(gpsync_h)\
+ $(gxsync_h) $(gsfunc3_h) $(gsfunc4_h) $(LIB_MAK) $(MAKEDIRS)
 	$(GLCC) $(GLO_)gxshade6.$(OBJ) $(C_) $(GLSRC)gxshade6.c
 
 shadelib_1=$(GLOBJ)gscolor3.$(OBJ) $(GLOBJ)gsfunc3.$(OBJ) $(GLOBJ)gsptype2.$(OBJ) $(GLOBJ)gsshade.$(OBJ)
@@ -3704,7 +3746,7 @@ $(GLOBJ)gp_dosfe.$(OBJ) : $(GLSRC)gp_dosfe.c $(AK)\
 
 # Unix(-like) file system, also used by Desqview/X.
 $(GLOBJ)gp_unifs.$(OBJ) : $(GLSRC)gp_unifs.c $(AK)\
- $(memory__h) $(string__h) $(stdio__h) $(unistd__h) \
+ $(memory__h) $(string__h) $(stdio__h) $(unistd__h) $(fcntl__h) \
  $(gx_h) $(gp_h) $(gpmisc_h) $(gsstruct_h) $(gsutil_h) \
  $(stat__h) $(dirent__h) $(LIB_MAK) $(MAKEDIRS)
 	$(GLCC) $(GLO_)gp_unifs.$(OBJ) $(C_) $(GLSRC)gp_unifs.c
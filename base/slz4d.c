@@ -0,0 +1,193 @@
+/* Copyright (C) 2001-2023 Artifex Software, Inc.
+   All Rights Reserved.
+
+   This software is provided AS-IS with no warranty, either express or
+   implied.
+
+   This software is distributed under license and may not be copied,
+   modified or distributed except as expressly authorized under the terms
+   of the license contained in the file LICENSE in this distribution.
+
+   Refer to licensing information at http://www.artifex.com or contact
+   Artifex Software, Inc.,  1305 Grant Avenue - Suite 200, Novato,
+   CA 94945, U.S.A., +1(415)492-9861, for further information.
+*/
+
+
+/* Fast LZ (LZ4-style) decoding filter */
+#include "memory_.h"
+#include "strimpl.h"
+#include "slz4x.h"
+
+/* ------ LZ4Decode ------ */
+
+private_st_LZ4D_state();
+
+/* What the next input byte is, or (for LZ4D_OUTPUT) that we are writing */
+/* out a finished block. */
+enum {
+    LZ4D_SIZE0,
+    LZ4D_SIZE1,
+    LZ4D_TOKEN,
+    LZ4D_LITLEN,
+    LZ4D_LITERALS,
+    LZ4D_OFFSET0,
+    LZ4D_OFFSET1,
+    LZ4D_MATCHLEN,
+    LZ4D_OUTPUT
+};
+
+/* Initialize LZ4Decode filter */
+static int
+s_LZ4D_init(stream_state * st)
+{
+    stream_LZ4D_state *const ss = (stream_LZ4D_state *) st;
+
+    ss->phase = LZ4D_SIZE0;
+    ss->size = 0;
+    ss->count = 0;
+    ss->out_pos = 0;
+    return 0;
+}
+
+/*
+ * Process a buffer.  All the input is consumed, even if the current block
+ * isn't complete, but we stop as soon as a block has been written out and
+ * the output is full, so that a client reading one block needn't supply
+ * exactly one block of input.
+ */
+static int
+s_LZ4D_process(stream_state * st, stream_cursor_read * pr,
+               stream_cursor_write * pw, bool last)
+{
+    stream_LZ4D_state *const ss = (stream_LZ4D_state *) st;
+    const byte *p = pr->ptr;
+    const byte *const rlimit = pr->limit;
+    byte *const block = ss->block;
+    int status;
+
+    for (;;) {
+        uint n, b;
+
+        if (ss->phase == LZ4D_LITERALS) {
+            n = rlimit - p;
+            if (n > ss->literals)
+                n = ss->literals;
+            memcpy(block + ss->count, p + 1, n);
+            p += n;
+            ss->count += n;
+            ss->literals -= n;
+            if (ss->literals != 0)
+                goto need_input;
+            if (ss->count == ss->size)
+                ss->phase = LZ4D_OUTPUT;
+            else
+                ss->phase = LZ4D_OFFSET0;
+            continue;
+        }
+        if (ss->phase == LZ4D_OUTPUT) {
+            n = ss->size - ss->out_pos;
+            if (n > pw->limit - pw->ptr)
+                n = pw->limit - pw->ptr;
+            memcpy(pw->ptr + 1, block + ss->out_pos, n);
+            pw->ptr += n;
+            ss->out_pos += n;
+            if (ss->out_pos < ss->size) {
+                status = 1;
+                goto out;
+            }
+            ss->phase = LZ4D_SIZE0;
+            ss->count = 0;
+            ss->out_pos = 0;
+            if (pw->ptr == pw->limit) {
+                status = 1;
+                goto out;
+            }
+            continue;
+        }
+        if (p == rlimit)
+            goto need_input;
+        b = *++p;
+        switch (ss->phase) {
+            case LZ4D_SIZE0:
+                ss->size = b;
+                ss->phase = LZ4D_SIZE1;
+                break;
+            case LZ4D_SIZE1:
+                ss->size += b << 8;
+                if (ss->size == 0 || ss->size > LZ4_BLOCK_SIZE)
+                    goto error;
+                ss->phase = LZ4D_TOKEN;
+                break;
+            case LZ4D_TOKEN:
+                ss->literals = b >> 4;
+                ss->match = (b & 15) + LZ4_MIN_MATCH;
+                ss->phase = (ss->literals == 15 ? LZ4D_LITLEN : LZ4D_LITERALS);
+                if (ss->literals > ss->size - ss->count)
+                    goto error;
+                break;
+            case LZ4D_LITLEN:
+                ss->literals += b;
+                if (ss->literals > ss->size - ss->count)
+                    goto error;
+                if (b != 255)
+                    ss->phase = LZ4D_LITERALS;
+                break;
+            case LZ4D_OFFSET0:
+                ss->offset = b;
+                ss->phase = LZ4D_OFFSET1;
+                break;
+            case LZ4D_OFFSET1:
+                ss->offset += b << 8;
+                if (ss->offset == 0 || ss->offset > ss->count)
+                    goto error;
+                if (ss->match == 15 + LZ4_MIN_MATCH) {
+                    ss->phase = LZ4D_MATCHLEN;
+                    break;
+                }
+                goto copy;
+            case LZ4D_MATCHLEN:
+                ss->match += b;
+                if (ss->match > ss->size - ss->count)
+                    goto error;
+                if (b == 255)
+                    break;
+copy:
+                if (ss->match > ss->size - ss->count)
+                    goto error;
+                {
+                    byte *dst = block + ss->count;
+                    const byte *src = dst - ss->offset;
+
+                    if (ss->offset >= ss->match)
+                        memcpy(dst, src, ss->match);
+                    else {
+                        /* Overlapping copy: repeat the last offset bytes. */
+                        byte *end = dst + ss->match;
+
+                        while (dst < end)
+                            *dst++ = *src++;
+                    }
+                }
+                ss->count += ss->match;
+                ss->phase = (ss->count == ss->size ? LZ4D_OUTPUT : LZ4D_TOKEN);
+                break;
+            default:
+                goto error;
+        }
+    }
+need_input:
+    status = (last && ss->phase == LZ4D_SIZE0 ? EOFC : 0);
+    goto out;
+error:
+    status = ERRC;
+out:
+    pr->ptr = p;
+    return status;
+}
+
+/* Stream template */
+const stream_template s_LZ4D_template = {
+    &st_LZ4D_state, s_LZ4D_init, s_LZ4D_process, 1, 1,
+    NULL, NULL, s_LZ4D_init
+};
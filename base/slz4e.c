@@ -0,0 +1,207 @@
+/* Copyright (C) 2001-2023 Artifex Software, Inc.
+   All Rights Reserved.
+
+   This software is provided AS-IS with no warranty, either express or
+   implied.
+
+   This software is distributed under license and may not be copied,
+   modified or distributed except as expressly authorized under the terms
+   of the license contained in the file LICENSE in this distribution.
+
+   Refer to licensing information at http://www.artifex.com or contact
+   Artifex Software, Inc.,  1305 Grant Avenue - Suite 200, Novato,
+   CA 94945, U.S.A., +1(415)492-9861, for further information.
+*/
+
+
+/* Fast LZ (LZ4-style) encoding filter */
+#include "memory_.h"
+#include "stdint_.h"
+#include "strimpl.h"
+#include "slz4x.h"
+
+/* ------ LZ4Encode ------ */
+
+private_st_LZ4E_state();
+
+/* Initialize LZ4Encode filter */
+static int
+s_LZ4E_init(stream_state * st)
+{
+    stream_LZ4E_state *const ss = (stream_LZ4E_state *) st;
+
+    ss->in_count = 0;
+    ss->out_count = 0;
+    ss->out_pos = 0;
+    return 0;
+}
+
+static inline uint32_t
+lz4_read32(const byte *p)
+{
+    uint32_t v;
+
+    memcpy(&v, p, sizeof(v));
+    return v;
+}
+
+#define LZ4_HASH(p)\
+  ((lz4_read32(p) * 2654435761U) >> (32 - LZ4_HASH_BITS))
+
+/* Write a length that didn't fit in a token nibble. */
+static inline byte *
+lz4_put_length(byte *op, uint len)
+{
+    while (len >= 255) {
+        *op++ = 255;
+        len -= 255;
+    }
+    *op++ = (byte)len;
+    return op;
+}
+
+/* Write a sequence of literals, and the token for the following match. */
+static inline byte *
+lz4_put_literals(byte *op, const byte *lit, uint nlit, uint mlen)
+{
+    byte *token = op++;
+
+    if (nlit >= 15) {
+        *token = 15 << 4;
+        op = lz4_put_length(op, nlit - 15);
+    } else
+        *token = (byte)(nlit << 4);
+    memcpy(op, lit, nlit);
+    op += nlit;
+    if (mlen >= 15 + LZ4_MIN_MATCH)
+        *token |= 15;
+    else if (mlen >= LZ4_MIN_MATCH)
+        *token |= (byte)(mlen - LZ4_MIN_MATCH);
+    return op;
+}
+
+/*
+ * Compress len (1 .. LZ4_BLOCK_SIZE) bytes from src into a block at dst,
+ * which must have room for LZ4_COMPRESS_BOUND(len) bytes.  Return the size
+ * of the block.
+ */
+static uint
+lz4_compress_block(stream_LZ4E_state *ss, const byte *src, uint len, byte *dst)
+{
+    const byte *ip = src;
+    const byte *anchor = src;
+    const byte *const iend = src + len;
+    const byte *const mflimit = iend - (LZ4_MIN_MATCH_INPUT - 1);
+    const byte *const matchlimit = iend - LZ4_LAST_LITERALS;
+    ushort *const hash = ss->hash;
+    byte *op = dst;
+
+    *op++ = (byte)len;
+    *op++ = (byte)(len >> 8);
+    if (len < LZ4_MIN_MATCH_INPUT)
+        goto last;
+    memset(hash, 0, sizeof(ss->hash));
+    ip++;
+    for (;;) {
+        const byte *ref;
+        const byte *mstart;
+        uint step = 1 << 6;
+        uint mlen, offset;
+
+        /*
+         * Look for a match, skipping ahead faster and faster the longer
+         * we go without finding one, since then the data probably doesn't
+         * compress.
+         */
+        for (;;) {
+            uint h = LZ4_HASH(ip);
+
+            ref = src + hash[h];
+            hash[h] = (ushort)(ip - src);
+            if (ref < ip && lz4_read32(ref) == lz4_read32(ip))
+                break;
+            ip += step++ >> 6;
+            if (ip > mflimit)
+                goto last;
+        }
+        /* Extend the match backwards over any pending literals. */
+        while (ip > anchor && ref > src && ip[-1] == ref[-1])
+            ip--, ref--;
+        offset = ip - ref;
+        mstart = ip;
+        ip += LZ4_MIN_MATCH;
+        ref += LZ4_MIN_MATCH;
+        while (ip < matchlimit && *ip == *ref)
+            ip++, ref++;
+        mlen = ip - mstart;
+        op = lz4_put_literals(op, anchor, mstart - anchor, mlen);
+        *op++ = (byte)offset;
+        *op++ = (byte)(offset >> 8);
+        if (mlen >= 15 + LZ4_MIN_MATCH)
+            op = lz4_put_length(op, mlen - 15 - LZ4_MIN_MATCH);
+        anchor = ip;
+        if (ip > mflimit)
+            break;
+        hash[LZ4_HASH(ip - 2)] = (ushort)(ip - 2 - src);
+    }
+last:
+    return lz4_put_literals(op, anchor, iend - anchor, 0) - dst;
+}
+
+/* Process a buffer */
+static int
+s_LZ4E_process(stream_state * st, stream_cursor_read * pr,
+               stream_cursor_write * pw, bool last)
+{
+    stream_LZ4E_state *const ss = (stream_LZ4E_state *) st;
+
+    for (;;) {
+        uint rcount, wcount, n;
+        const byte *src;
+
+        /* Write out any block we have compressed already. */
+        if (ss->out_pos < ss->out_count) {
+            n = ss->out_count - ss->out_pos;
+            wcount = pw->limit - pw->ptr;
+            if (n > wcount)
+                n = wcount;
+            memcpy(pw->ptr + 1, ss->outbuf + ss->out_pos, n);
+            pw->ptr += n;
+            ss->out_pos += n;
+            if (ss->out_pos < ss->out_count)
+                return 1;
+        }
+        rcount = pr->limit - pr->ptr;
+        if (ss->in_count == 0 &&
+            (rcount >= LZ4_BLOCK_SIZE || (last && rcount > 0))) {
+            /* Compress straight from the input. */
+            n = min(rcount, LZ4_BLOCK_SIZE);
+            src = pr->ptr + 1;
+            pr->ptr += n;
+        } else {
+            n = min(rcount, LZ4_BLOCK_SIZE - ss->in_count);
+            memcpy(ss->inbuf + ss->in_count, pr->ptr + 1, n);
+            pr->ptr += n;
+            ss->in_count += n;
+            if (ss->in_count < LZ4_BLOCK_SIZE &&
+                !(last && ss->in_count > 0 && pr->ptr == pr->limit))
+                return 0;
+            n = ss->in_count;
+            src = ss->inbuf;
+            ss->in_count = 0;
+        }
+        if (pw->limit - pw->ptr >= LZ4_COMPRESS_BOUND(n)) {
+            /* There is room to compress straight into the output. */
+            pw->ptr += lz4_compress_block(ss, src, n, pw->ptr + 1);
+        } else {
+            ss->out_count = lz4_compress_block(ss, src, n, ss->outbuf);
+            ss->out_pos = 0;
+        }
+    }
+}
+
+/* Stream template */
+const stream_template s_LZ4E_template = {
+    &st_LZ4E_state, s_LZ4E_init, s_LZ4E_process, 1, 1,
+    NULL, NULL, s_LZ4E_init
+};
@@ -0,0 +1,84 @@
+/* Copyright (C) 2001-2023 Artifex Software, Inc.
+   All Rights Reserved.
+
+   This software is provided AS-IS with no warranty, either express or
+   implied.
+
+   This software is distributed under license and may not be copied,
+   modified or distributed except as expressly authorized under the terms
+   of the license contained in the file LICENSE in this distribution.
+
+   Refer to licensing information at http://www.artifex.com or contact
+   Artifex Software, Inc.,  1305 Grant Avenue - Suite 200, Novato,
+   CA 94945, U.S.A., +1(415)492-9861, for further information.
+*/
+
+
+/* Definitions for the fast LZ (LZ4-style) filters */
+/* Requires scommon.h; strimpl.h if any templates are referenced */
+
+#ifndef slz4x_INCLUDED
+#  define slz4x_INCLUDED
+
+#include "scommon.h"
+
+/*
+ * These filters are meant for data that is compressed and decompressed by
+ * Ghostscript itself (such as RAM-based band lists), where speed matters
+ * far more than the compression ratio.  The format is not compatible with
+ * any other program.
+ *
+ * The data is divided into blocks of at most LZ4_BLOCK_SIZE bytes, each of
+ * which is compressed independently.  A block starts with its decoded size
+ * as 2 bytes, low byte first, followed by a sequence of LZ4 style
+ * (literals, match) pairs: a token byte whose high 4 bits are the literal
+ * count and low 4 bits the match length - 4, where 15 in either means that
+ * more bytes follow (each adding 0..255, a byte < 255 ending the count);
+ * then the literals; then a 2 byte match offset, low byte first, which is
+ * omitted once the block is complete.  Every block ends with at least
+ * LZ4_LAST_LITERALS literals, unless it is shorter than LZ4_MIN_MATCH_INPUT,
+ * in which case it is all literals.
+ */
+#define LZ4_BLOCK_SIZE 16384
+#define LZ4_MIN_MATCH 4
+#define LZ4_LAST_LITERALS 5
+#define LZ4_MIN_MATCH_INPUT 13
+#define LZ4_HASH_BITS 12
+/* The largest encoding of a block of n bytes. */
+#define LZ4_COMPRESS_BOUND(n) (2 + 1 + (n) + (n) / 255 + 1)
+
+/* LZ4Encode */
+typedef struct stream_LZ4E_state_s {
+    stream_state_common;
+    /* The following change dynamically. */
+    uint in_count;		/* bytes accumulated in inbuf */
+    uint out_count;		/* bytes of outbuf to write */
+    uint out_pos;		/* bytes of outbuf already written */
+    ushort hash[1 << LZ4_HASH_BITS];	/* block offsets of recent 4 byte strings */
+    byte inbuf[LZ4_BLOCK_SIZE];
+    byte outbuf[LZ4_COMPRESS_BOUND(LZ4_BLOCK_SIZE)];
+} stream_LZ4E_state;
+
+#define private_st_LZ4E_state()	/* in slz4e.c */\
+  gs_private_st_simple(st_LZ4E_state, stream_LZ4E_state, "LZ4Encode state")
+extern const stream_template s_LZ4E_template;
+
+/* LZ4Decode */
+typedef struct stream_LZ4D_state_s {
+    stream_state_common;
+    /* The following change dynamically. */
+    int phase;			/* what the next input byte is */
+    uint size;			/* decoded size of the current block */
+    uint count;			/* bytes of the block decoded so far */
+    uint out_pos;		/* bytes of the block already written */
+    uint literals;		/* literals still to copy */
+    uint match;			/* length of the current match */
+    uint offset;		/* offset of the current match */
+    byte block[LZ4_BLOCK_SIZE];
+} stream_LZ4D_state;
+
+#define private_st_LZ4D_state()	/* in slz4d.c */\
+  gs_private_st_simple(st_LZ4D_state, stream_LZ4D_state, "LZ4Decode state")
+extern const stream_template s_LZ4D_template;
+
+#endif /* slz4x_INCLUDED */
@@ -886,34 +886,19 @@ static FontError ttfOutliner__BuildGlyphOutline(ttfOutliner *self, int glyphInde
 
 #define AVECTOR_BUG 1 /* Work around a bug in AVector fonts. */
 
-int ttfOutliner__DrawGlyphOutline(ttfOutliner *self)
+static int ttfOutliner__DrawOutline(ttfOutliner *self,
+            const F26Dot6 *x, const F26Dot6 *y, const byte *onCurve,
+            const short *endP, F26Dot6 expand_x, F26Dot6 expand_y)
 {   ttfGlyphOutline* out = &self->out;
     FloatMatrix *m = &self->post_transform;
-    ttfFont *pFont = self->pFont;
     ttfExport *exp = self->exp;
-    TExecution_Context *exec = pFont->exec;
-    TGlyph_Zone *epts = &exec->pts;
-    short* endP = epts->contours;
-    byte* onCurve = epts->touch;
-    F26Dot6* x = epts->org_x;
-    F26Dot6* y = epts->org_y;
     F26Dot6 px, py;
     short sp, ctr;
     FloatPoint p0, p1, p2, p3;
 #   if AVECTOR_BUG
-    F26Dot6 expand_x;
-    F26Dot6 expand_y;
     F26Dot6 xMin, xMax;
     F26Dot6 yMin, yMax;
 
-
-    if (exec->metrics.x_scale1 == 0 || exec->metrics.x_scale2 == 0
-    ||  exec->metrics.y_scale1 == 0 || exec->metrics.y_scale2 == 0) {
-        return_error(gs_error_invalidfont);
-    }
-
-    expand_x = Scale_X(&exec->metrics, pFont->nUnitsPerEm * 2);
-    expand_y = Scale_Y(&exec->metrics, pFont->nUnitsPerEm * 2);
     xMin = out->xMinB - expand_x;
     xMax = out->xMaxB + expand_x;
     yMin = out->yMinB - expand_y;
@@ -1041,6 +1026,80 @@ int ttfOutliner__DrawGlyphOutline(ttfOutliner *self)
     return 0;
 }
 
+int ttfOutliner__DrawGlyphOutline(ttfOutliner *self)
+{   ttfFont *pFont = self->pFont;
+    TExecution_Context *exec = pFont->exec;
+    TGlyph_Zone *epts = &exec->pts;
+
+    if (exec->metrics.x_scale1 == 0 || exec->metrics.x_scale2 == 0
+    ||  exec->metrics.y_scale1 == 0 || exec->metrics.y_scale2 == 0) {
+        return_error(gs_error_invalidfont);
+    }
+    return ttfOutliner__DrawOutline(self, epts->org_x, epts->org_y, epts->touch,
+                epts->contours,
+                Scale_X(&exec->metrics, pFont->nUnitsPerEm * 2),
+                Scale_Y(&exec->metrics, pFont->nUnitsPerEm * 2));
+}
+
+/* Return the number of points of the outline left by ttfOutliner__Outline. */
+static uint ttfOutliner__PointCount(ttfOutliner *self)
+{   TGlyph_Zone *epts = &self->pFont->exec->pts;
+
+    if (self->out.contourCount <= 0)
+        return 0;
+    return epts->contours[self->out.contourCount - 1] + 1;
+}
+
+uint ttfOutliner__SavedGlyphSize(ttfOutliner *self)
+{   uint n = ttfOutliner__PointCount(self);
+
+    return n * (2 * sizeof(F26Dot6) + sizeof(byte)) +
+           max(self->out.contourCount, 0) * sizeof(short);
+}
+
+int ttfOutliner__SaveGlyphOutline(ttfOutliner *self, ttfSavedGlyph *g, byte *data)
+{   ttfFont *pFont = self->pFont;
+    TExecution_Context *exec = pFont->exec;
+    TGlyph_Zone *epts = &exec->pts;
+    uint n = ttfOutliner__PointCount(self);
+    int nc = max(self->out.contourCount, 0);
+
+    if (exec->metrics.x_scale1 == 0 || exec->metrics.x_scale2 == 0
+    ||  exec->metrics.y_scale1 == 0 || exec->metrics.y_scale2 == 0) {
+        return_error(gs_error_invalidfont);
+    }
+    g->out = self->out;
+    g->expand_x = Scale_X(&exec->metrics, pFont->nUnitsPerEm * 2);
+    g->expand_y = Scale_Y(&exec->metrics, pFont->nUnitsPerEm * 2);
+    g->nUnitsPerEm = pFont->nUnitsPerEm;
+    g->design_grid = pFont->design_grid;
+    /* The coordinates go first to keep them aligned. */
+    g->x = (F26Dot6 *)data;
+    g->y = g->x + n;
+    g->endP = (short *)(g->y + n);
+    g->onCurve = (byte *)(g->endP + nc);
+    memcpy(g->x, epts->org_x, n * sizeof(F26Dot6));
+    memcpy(g->y, epts->org_y, n * sizeof(F26Dot6));
+    memcpy(g->endP, epts->contours, nc * sizeof(short));
+    memcpy(g->onCurve, epts->touch, n);
+    return 0;
+}
+
+int ttfOutliner__DrawSavedGlyphOutline(ttfOutliner *self, const ttfSavedGlyph *g,
+        FloatMatrix *m1)
+{
+    self->out = g->out;
+    self->post_transform = *m1;
+    if (g->design_grid) {
+        self->post_transform.a /= g->nUnitsPerEm;
+        self->post_transform.b /= g->nUnitsPerEm;
+        self->post_transform.c /= g->nUnitsPerEm;
+        self->post_transform.d /= g->nUnitsPerEm;
+    }
+    return ttfOutliner__DrawOutline(self, g->x, g->y, g->onCurve, g->endP,
+                g->expand_x, g->expand_y);
+}
+
 FontError ttfOutliner__Outline(ttfOutliner *self, int glyphIndex,
         float orig_x, float orig_y, FloatMatrix *m1)
 {   ttfFont *pFont = self->pFont;
@@ -132,6 +132,11 @@ struct ttfFont_s {
     unsigned int nIndexToLocFormat;
     bool    patented;
     bool    design_grid;
+    /* The size to open the face at, kept until the face is opened
+       by the first glyph that needs the interpreter (see gxttfb.c). */
+    float   w, h;
+    bool    opened;
+    int     open_code;
     TFace *face;
     TInstance *inst;
     TExecution_Context  *exec;
@@ -191,10 +196,26 @@ typedef struct {
     FloatMatrix post_transform;
 } ttfOutliner;
 
+/* Define a grid fitted outline copied out of the interpreter,
+   so that it can be drawn again with another post transform. */
+typedef struct {
+    ttfGlyphOutline out;
+    F26Dot6 expand_x, expand_y;
+    unsigned short nUnitsPerEm;
+    bool design_grid;
+    F26Dot6 *x, *y;
+    short *endP;
+    byte *onCurve;
+} ttfSavedGlyph;
+
 void ttfOutliner__init(ttfOutliner *, ttfFont *f, ttfReader *r, ttfExport *exp,
                         bool bOutline, bool bFirst, bool bVertical);
 FontError ttfOutliner__Outline(ttfOutliner *this, int glyphIndex,
         float orig_x, float orig_y, FloatMatrix *m1);
 int ttfOutliner__DrawGlyphOutline(ttfOutliner *this);
+uint ttfOutliner__SavedGlyphSize(ttfOutliner *this);
+int ttfOutliner__SaveGlyphOutline(ttfOutliner *this, ttfSavedGlyph *g, byte *data);
+int ttfOutliner__DrawSavedGlyphOutline(ttfOutliner *this, const ttfSavedGlyph *g,
+        FloatMatrix *m1);
 
 #endif
@@ -22,6 +22,8 @@
 #include "sdct.h"
 #include "sjpeg.h"
 #include "gxdownscale.h"
+#include "gxdevsop.h"
+#include "gxgetbit.h"
 
 /* Structure for the JPEG-writing device. */
 typedef struct gx_device_jpeg_s {
@@ -41,6 +43,10 @@ typedef struct gx_device_jpeg_s {
     gs_point ViewTrans;
 
     gx_downscaler_params downscale;
+
+    /** MCU rows between restart markers, 0 for none.
+     */
+    int RestartInterval;
 } gx_device_jpeg;
 
 /* The device descriptor */
@@ -51,6 +57,7 @@ static dev_proc_print_page(jpeg_print_page);
 static dev_proc_map_color_rgb(jpegcmyk_map_color_rgb);
 static dev_proc_map_cmyk_color(jpegcmyk_map_cmyk_color);
 static dev_proc_decode_color(jpegcmyk_decode_color);
+static dev_proc_dev_spec_op(jpeg_spec_op);
 
 /* ------ The device descriptors ------ */
 
@@ -72,6 +79,7 @@ jpeg_initialize_device_procs(gx_device *dev)
     set_dev_proc(dev, get_initial_matrix, jpeg_get_initial_matrix);
     set_dev_proc(dev, get_params, jpeg_get_params);
     set_dev_proc(dev, put_params, jpeg_put_params);
+    set_dev_proc(dev, dev_spec_op, jpeg_spec_op);
 }
 
 const gx_device_jpeg gs_jpeg_device =
@@ -82,7 +90,8 @@ const gx_device_jpeg gs_jpeg_device =
  0.0,				/* QFactor: 0 indicates not specified */
  { 1.0, 1.0 },                  /* ViewScale 1 to 1 */
  { 0.0, 0.0 },                  /* translation 0 */
- GX_DOWNSCALER_PARAMS_DEFAULTS
+ GX_DOWNSCALER_PARAMS_DEFAULTS,
+ 0				/* RestartInterval: no restart markers */
 };
 
 /* 8-bit gray */
@@ -95,6 +104,7 @@ jpeggray_initialize_device_procs(gx_device *dev)
     set_dev_proc(dev, get_initial_matrix, jpeg_get_initial_matrix);
     set_dev_proc(dev, get_params, jpeg_get_params);
     set_dev_proc(dev, put_params, jpeg_put_params);
+    set_dev_proc(dev, dev_spec_op, jpeg_spec_op);
     set_dev_proc(dev, encode_color, gx_default_8bit_map_gray_color);
     set_dev_proc(dev, decode_color, gx_default_8bit_map_color_gray);
 }
@@ -109,7 +119,8 @@ const gx_device_jpeg gs_jpeggray_device =
  0.0,				/* QFactor: 0 indicates not specified */
  { 1.0, 1.0 },                  /* ViewScale 1 to 1 */
  { 0.0, 0.0 },                   /* translation 0 */
- GX_DOWNSCALER_PARAMS_DEFAULTS
+ GX_DOWNSCALER_PARAMS_DEFAULTS,
+ 0				/* RestartInterval: no restart markers */
 };
 
 /* 32-bit CMYK */
@@ -123,6 +134,7 @@ jpegcmyk_initialize_device_procs(gx_device *dev)
     set_dev_proc(dev, map_color_rgb, jpegcmyk_map_color_rgb);
     set_dev_proc(dev, get_params, jpeg_get_params);
     set_dev_proc(dev, put_params, jpeg_put_params);
+    set_dev_proc(dev, dev_spec_op, jpeg_spec_op);
     set_dev_proc(dev, map_cmyk_color, jpegcmyk_map_cmyk_color);
 
     set_dev_proc(dev, encode_color, jpegcmyk_map_cmyk_color);
@@ -137,7 +149,8 @@ const gx_device_jpeg gs_jpegcmyk_device =
  0.0,				/* QFactor: 0 indicates not specified */
  { 1.0, 1.0 },                  /* ViewScale 1 to 1 */
  { 0.0, 0.0 },                   /* translation 0 */
- GX_DOWNSCALER_PARAMS_DEFAULTS
+ GX_DOWNSCALER_PARAMS_DEFAULTS,
+ 0				/* RestartInterval: no restart markers */
 };
 
 /* Apparently Adobe Photoshop and some other applications that	*/
@@ -213,6 +226,8 @@ jpeg_get_params(gx_device * dev, gs_param_list * plist)
     float2double = jdev->ViewTrans.y;
     if ((ecode = param_write_float(plist, "ViewTransY", &float2double)) < 0)
         code = ecode;
+    if ((ecode = param_write_int(plist, "RestartInterval", &jdev->RestartInterval)) < 0)
+        code = ecode;
 
     return code;
 }
@@ -227,6 +242,7 @@ jpeg_put_params(gx_device * dev, gs_param_list * plist)
     gs_param_name param_name;
     int jq = jdev->JPEGQ;
     float qf = jdev->QFactor;
+    int ri = jdev->RestartInterval;
     float fparam;
 
     ecode = gx_downscaler_read_params(plist, &jdev->downscale, 0);
@@ -301,6 +317,20 @@ jpeg_put_params(gx_device * dev, gs_param_list * plist)
         ecode = code;
         param_signal_error(plist, param_name, code);
     }
+
+    switch (code = param_read_int(plist, (param_name = "RestartInterval"), &ri)) {
+        case 0:
+            if (ri < 0)
+                ecode = gs_error_rangecheck;
+            else
+                break;
+            goto rie;
+        default:
+            ecode = code;
+          rie:param_signal_error(plist, param_name, ecode);
+        case 1:
+            break;
+    }
     code = gdev_prn_put_params(dev, plist);
     if (code < 0)
         return code;
@@ -310,6 +340,7 @@ jpeg_put_params(gx_device * dev, gs_param_list * plist)
 
     jdev->JPEGQ = jq;
     jdev->QFactor = qf;
+    jdev->RestartInterval = ri;
     return 0;
 }
 
@@ -390,78 +421,53 @@ jpeg_get_initial_matrix(gx_device *dev, gs_matrix *pmat)
 
 }
 
-/* Send the page to the file. */
+/* Set up the DCT encoder state to compress an image of the given height,
+ * with restart markers every restart_rows MCU rows if that is possible.
+ * Returns the image rows between restart markers, or 0 if there are none.
+ * On failure, there is nothing more to clean up. */
 static int
-jpeg_print_page(gx_device_printer * pdev, gp_file * prn_stream)
+jpeg_setup_compress(gx_device_jpeg *jdev, gs_memory_t *mem, stream_DCT_state *state,
+                    jpeg_compress_data *jcdp, int height, int restart_rows)
 {
-    gx_device_jpeg *jdev = (gx_device_jpeg *) pdev;
-    gs_memory_t *mem = pdev->memory;
-    int line_size = gdev_mem_bytes_per_scan_line((gx_device *) pdev);
-    byte *in = gs_alloc_bytes(mem, line_size, "jpeg_print_page(in)");
-    jpeg_compress_data *jcdp = gs_alloc_struct_immovable(mem, jpeg_compress_data,
-      &st_jpeg_compress_data, "jpeg_print_page(jpeg_compress_data)");
-    byte *fbuf = 0;
-    uint fbuf_size;
-    byte *jbuf = 0;
-    uint jbuf_size;
-    int lnum;
-    int code;
-    stream_DCT_state state;
-    stream fstrm, jstrm;
-    gx_downscaler_t ds;
-
-    if (jcdp == 0 || in == 0) {
-        code = gs_note_error(gs_error_VMerror);
-        goto fail;
-    }
-    code = gx_downscaler_init(&ds, (gx_device *)jdev, 8, 8,
-                              jdev->color_info.depth/8,
-                              &jdev->downscale, NULL, 0);
-    if (code < 0) {
-        gs_free_object(mem, jcdp, "jpeg_print_page(jpeg_compress_data)");
-        jcdp = NULL;
-        goto fail;
-    }
+    gx_device_printer *pdev = (gx_device_printer *)jdev;
+    int code, i, h_samp = 1, v_samp = 1, mcus_per_row;
 
     /* Create the DCT encoder state. */
     jcdp->templat = s_DCTE_template;
-    s_init_state((stream_state *)&state, &jcdp->templat, 0);
-    if (state.templat->set_defaults) {
-        state.memory = mem;
-        (*state.templat->set_defaults) ((stream_state *) & state);
-        state.memory = NULL;
-    }
-    state.QFactor = 1.0;	/* disable quality adjustment in zfdcte.c */
-    state.ColorTransform = 1;	/* default for RGB */
+    s_init_state((stream_state *)state, &jcdp->templat, 0);
+    if (state->templat->set_defaults) {
+        state->memory = mem;
+        (*state->templat->set_defaults) ((stream_state *) state);
+        state->memory = NULL;
+    }
+    state->QFactor = 1.0;	/* disable quality adjustment in zfdcte.c */
+    state->ColorTransform = 1;	/* default for RGB */
     /* We insert no markers, allowing the IJG library to emit */
     /* the format it thinks best. */
-    state.NoMarker = true;	/* do not insert our own Adobe marker */
-    state.Markers.data = 0;
-    state.Markers.size = 0;
-    state.data.compress = jcdp;
+    state->NoMarker = true;	/* do not insert our own Adobe marker */
+    state->Markers.data = 0;
+    state->Markers.size = 0;
+    state->data.compress = jcdp;
     /* Add in ICC profile */
-    state.icc_profile = NULL; /* In case it is not set here */
+    state->icc_profile = NULL; /* In case it is not set here */
     if (pdev->icc_struct != NULL &&
         pdev->icc_struct->device_profile[GS_DEFAULT_DEVICE_PROFILE] != NULL) {
         cmm_profile_t *icc_profile = pdev->icc_struct->device_profile[GS_DEFAULT_DEVICE_PROFILE];
         if (icc_profile->num_comps == pdev->color_info.num_components &&
             !(pdev->icc_struct->usefastcolor)) {
-            state.icc_profile = icc_profile;
+            state->icc_profile = icc_profile;
         }
     }
-    /* We need state.memory for gs_jpeg_create_compress().... */
-    jcdp->memory = state.jpeg_memory = state.memory = mem;
-    if ((code = gs_jpeg_create_compress(&state)) < 0)
-    {
-        gx_downscaler_fin(&ds);
-        goto fail;
-    }
+    /* We need state->memory for gs_jpeg_create_compress().... */
+    jcdp->memory = state->jpeg_memory = state->memory = mem;
+    if ((code = gs_jpeg_create_compress(state)) < 0)
+        return code;
     /* ....but we need it to be NULL so we don't try to free
      * the stack based state...
      */
-    state.memory = NULL;
+    state->memory = NULL;
     jcdp->cinfo.image_width = gx_downscaler_scale(pdev->width, jdev->downscale.downscale_factor);
-    jcdp->cinfo.image_height = gx_downscaler_scale(pdev->height, jdev->downscale.downscale_factor);
+    jcdp->cinfo.image_height = height;
     switch (pdev->color_info.depth) {
         case 32:
             jcdp->cinfo.input_components = 4;
@@ -477,33 +483,480 @@ jpeg_print_page(gx_device_printer * pdev, gp_file * prn_stream)
             break;
     }
     /* Set compression parameters. */
-    if ((code = gs_jpeg_set_defaults(&state)) < 0)
-        goto done;
+    if ((code = gs_jpeg_set_defaults(state)) < 0)
+        goto fail;
     if (jdev->JPEGQ > 0) {
-        code = gs_jpeg_set_quality(&state, jdev->JPEGQ, TRUE);
+        code = gs_jpeg_set_quality(state, jdev->JPEGQ, TRUE);
         if (code < 0)
-            goto done;
+            goto fail;
     } else if (jdev->QFactor > 0.0) {
-        code = gs_jpeg_set_linear_quality(&state,
+        code = gs_jpeg_set_linear_quality(state,
                                           (int)(min(jdev->QFactor, 100.0)
                                                 * 100.0 + 0.5),
                                           TRUE);
         if (code < 0)
-            goto done;
+            goto fail;
     }
-    jcdp->cinfo.restart_interval = 0;
+    /* The restart interval is counted in MCUs, which set_defaults has
+     * sized; there are at most 65535 of them between markers. */
+    for (i = 0; i < jcdp->cinfo.num_components; i++) {
+        h_samp = max(h_samp, jcdp->cinfo.comp_info[i].h_samp_factor);
+        v_samp = max(v_samp, jcdp->cinfo.comp_info[i].v_samp_factor);
+    }
+    if (jcdp->cinfo.num_components == 1)
+        h_samp = v_samp = 1;    /* a single component isn't interleaved */
+    mcus_per_row = (jcdp->cinfo.image_width + h_samp * DCTSIZE - 1) / (h_samp * DCTSIZE);
+    restart_rows = min(restart_rows, 65535 / max(mcus_per_row, 1));
+    jcdp->cinfo.restart_interval = restart_rows * mcus_per_row;
     jcdp->cinfo.density_unit = 1;	/* dots/inch (no #define or enum) */
     jcdp->cinfo.X_density = (UINT16)pdev->HWResolution[0];
     jcdp->cinfo.Y_density = (UINT16)pdev->HWResolution[1];
     /* Create the filter. */
     /* Make sure we get at least a full scan line of input. */
-    state.scan_line_size = jcdp->cinfo.input_components *
+    state->scan_line_size = jcdp->cinfo.input_components *
         jcdp->cinfo.image_width;
     jcdp->templat.min_in_size =
-        max(s_DCTE_template.min_in_size, state.scan_line_size);
+        max(s_DCTE_template.min_in_size, state->scan_line_size);
     /* Make sure we can write the user markers in a single go. */
     jcdp->templat.min_out_size =
-        max(s_DCTE_template.min_out_size, state.Markers.size);
+        max(s_DCTE_template.min_out_size, state->Markers.size);
+    return restart_rows * v_samp * DCTSIZE;
+  fail:
+    gs_jpeg_destroy(state);
+    return code;
+}
+
+/*
+ * With restart markers, the entropy coded data between them depends only
+ * on the rows of its own interval, so the rendering threads can compress
+ * the intervals ("segments") of their bands. Each segment is compressed
+ * as a JPEG image of its own, with the encoding of the whole page; the
+ * main thread then writes the headers of the first with the height of the
+ * page, and the coded data of each in turn, separated by restart markers.
+ */
+typedef struct jpeg_segment_s {
+    gs_memory_t *memory;
+    byte *data;                 /* the segment, as a JPEG file */
+    uint size;
+    uint length;
+} jpeg_segment_t;
+
+typedef struct jpeg_segment_encoder_s {
+    gx_device_jpeg *dev;
+    gp_file *file;
+    gs_memory_t *memory;
+    int height;                 /* of the image, after any downscaling */
+    int segment_rows;           /* image rows between restart markers */
+    uint line_size;
+    /* The rows of a segment that straddles bands, collected by the main
+     * thread. */
+    byte *pending;
+    int pending_y;
+    int pending_rows;
+} jpeg_segment_encoder_t;
+
+typedef struct jpeg_band_segments_s {
+    byte *data;                 /* the band's rows */
+    int y0, y1;                 /* the rows of the image it holds */
+    int first_segment;
+    int num_segments;
+    int max_segments;
+    jpeg_segment_t *segments;   /* the whole segments it holds */
+} jpeg_band_segments_t;
+
+static void
+jpeg_segment_free(jpeg_segment_t *seg)
+{
+    gs_free_object(seg->memory, seg->data, "jpeg_segment_free");
+    seg->data = NULL;
+    seg->size = seg->length = 0;
+}
+
+/* Make room for at least size bytes of a segment. */
+static int
+jpeg_segment_grow(jpeg_segment_t *seg, uint size)
+{
+    byte *data;
+
+    if (seg->size >= size)
+        return 0;
+    data = gs_alloc_bytes(seg->memory, size, "jpeg_segment_grow");
+    if (data == NULL)
+        return_error(gs_error_VMerror);
+    if (seg->length > 0)
+        memcpy(data, seg->data, seg->length);
+    gs_free_object(seg->memory, seg->data, "jpeg_segment_grow");
+    seg->data = data;
+    seg->size = size;
+    return 0;
+}
+
+/* Compress the segment beginning at row y of the image. */
+static int
+jpeg_compress_segment(const jpeg_segment_encoder_t *enc, jpeg_segment_t *seg,
+                      const byte *rows, int y)
+{
+    gs_memory_t *mem = seg->memory;
+    int nrows = min(enc->segment_rows, enc->height - y);
+    jpeg_compress_data *jcdp = gs_alloc_struct_immovable(mem, jpeg_compress_data,
+      &st_jpeg_compress_data, "jpeg_compress_segment");
+    stream_DCT_state state;
+    stream_cursor_read r;
+    stream_cursor_write w;
+    int status = 0, code;
+
+    if (jcdp == NULL)
+        return_error(gs_error_VMerror);
+    code = jpeg_setup_compress(enc->dev, mem, &state, jcdp, nrows,
+                               enc->dev->RestartInterval);
+    if (code < 0) {
+        gs_free_object(mem, jcdp, "jpeg_compress_segment");
+        return code;
+    }
+    if (state.templat->init)
+        (*state.templat->init) ((stream_state *) & state);
+    r.ptr = rows - 1;
+    r.limit = r.ptr + (size_t)nrows * enc->line_size;
+    seg->length = 0;
+    code = jpeg_segment_grow(seg, max(jcdp->templat.min_out_size,
+                                      (uint)(r.limit - r.ptr) / 4));
+    while (code >= 0) {
+        w.ptr = seg->data + seg->length - 1;
+        w.limit = seg->data + seg->size - 1;
+        status = (*state.templat->process) ((stream_state *) & state, &r, &w, true);
+        seg->length = w.ptr + 1 - seg->data;
+        /* The filter asks for more room by returning 1. */
+        if (status != 1)
+            break;
+        code = jpeg_segment_grow(seg, seg->size * 2);
+    }
+    if (code >= 0 && status != EOFC)
+        code = gs_note_error(gs_error_ioerror);
+    gs_jpeg_destroy(&state);
+    gs_free_object(mem, jcdp, "jpeg_compress_segment");
+    return code;
+}
+
+/* Write a compressed segment out as part of the page: the headers of the
+ * first, with the height of the page, then the entropy coded data of each,
+ * followed by a restart marker or, after the last, the end of the image. */
+static int
+jpeg_write_segment(jpeg_segment_encoder_t *enc, const jpeg_segment_t *seg, int y)
+{
+    const byte *data = seg->data;
+    uint pos = 2, sof = 0;
+    int marker = 0;
+    byte b[2];
+
+    /* Find the frame header and the end of the scan header. */
+    while (pos + 4 <= seg->length && data[pos] == 0xff && marker != 0xda) {
+        marker = data[pos + 1];
+        if (marker >= 0xc0 && marker <= 0xcf && marker != 0xc4 &&
+            marker != 0xc8 && marker != 0xcc)
+            sof = pos;
+        pos += 2 + ((data[pos + 2] << 8) | data[pos + 3]);
+    }
+    if (marker != 0xda || sof == 0 || pos + 2 > seg->length)
+        return_error(gs_error_ioerror);
+    if (y == 0) {
+        gp_fwrite(data, 1, sof + 5, enc->file);
+        b[0] = (byte)(enc->height >> 8);
+        b[1] = (byte)enc->height;
+        gp_fwrite(b, 1, 2, enc->file);
+        gp_fwrite(data + sof + 7, 1, pos - sof - 7, enc->file);
+    }
+    /* The coded data, without the end of image marker. */
+    gp_fwrite(data + pos, 1, seg->length - 2 - pos, enc->file);
+    b[0] = 0xff;
+    if (y + enc->segment_rows >= enc->height)
+        b[1] = JPEG_EOI;
+    else
+        b[1] = JPEG_RST0 + (y / enc->segment_rows) % 8;
+    gp_fwrite(b, 1, 2, enc->file);
+    return 0;
+}
+
+/* On the main thread, collect rows of a segment that isn't compressed by
+ * a rendering thread, writing it out once it is complete. */
+static int
+jpeg_segment_pending(jpeg_segment_encoder_t *enc, const byte *rows, int y, int nrows)
+{
+    while (nrows > 0) {
+        int segment_rows, n;
+
+        if (enc->pending_rows == 0)
+            enc->pending_y = y;
+        segment_rows = min(enc->segment_rows, enc->height - enc->pending_y);
+        n = min(nrows, segment_rows - enc->pending_rows);
+        memcpy(enc->pending + (size_t)enc->pending_rows * enc->line_size,
+               rows, (size_t)n * enc->line_size);
+        enc->pending_rows += n;
+        rows += (size_t)n * enc->line_size;
+        y += n;
+        nrows -= n;
+        if (enc->pending_rows == segment_rows) {
+            jpeg_segment_t seg;
+            int code;
+
+            memset(&seg, 0, sizeof(seg));
+            seg.memory = enc->memory;
+            code = jpeg_compress_segment(enc, &seg, enc->pending, enc->pending_y);
+            if (code >= 0)
+                code = jpeg_write_segment(enc, &seg, enc->pending_y);
+            jpeg_segment_free(&seg);
+            if (code < 0)
+                return code;
+            enc->pending_rows = 0;
+        }
+    }
+    return 0;
+}
+
+/* The process_page callbacks. */
+static void
+jpeg_band_free(void *arg, gx_device *dev, gs_memory_t *memory, void *buffer)
+{
+    jpeg_band_segments_t *segments = (jpeg_band_segments_t *)buffer;
+    int i;
+
+    if (segments == NULL)
+        return;
+    if (segments->segments != NULL) {
+        for (i = 0; i < segments->max_segments; i++)
+            jpeg_segment_free(&segments->segments[i]);
+    }
+    gs_free_object(memory, segments->segments, "jpeg_band_free");
+    gs_free_object(memory, segments->data, "jpeg_band_free");
+    gs_free_object(memory, segments, "jpeg_band_free");
+}
+
+static int
+jpeg_band_init(void *arg, gx_device *dev, gs_memory_t *memory, int w, int h, void **pbuffer)
+{
+    jpeg_segment_encoder_t *enc = (jpeg_segment_encoder_t *)arg;
+    jpeg_band_segments_t *segments;
+    int i;
+
+    segments = (jpeg_band_segments_t *)gs_alloc_bytes(memory, sizeof(*segments),
+                                                      "jpeg_band_init");
+    if (segments == NULL)
+        return_error(gs_error_VMerror);
+    memset(segments, 0, sizeof(*segments));
+    /* The most whole segments a band can hold, the last being short. */
+    segments->max_segments = h / enc->segment_rows + 1;
+    segments->data = gs_alloc_bytes(memory, (size_t)h * enc->line_size, "jpeg_band_init");
+    segments->segments = (jpeg_segment_t *)
+        gs_alloc_bytes(memory, segments->max_segments * sizeof(jpeg_segment_t),
+                       "jpeg_band_init");
+    if (segments->segments != NULL) {
+        for (i = 0; i < segments->max_segments; i++) {
+            memset(&segments->segments[i], 0, sizeof(jpeg_segment_t));
+            segments->segments[i].memory = memory;
+        }
+    }
+    if (segments->data == NULL || segments->segments == NULL) {
+        jpeg_band_free(arg, dev, memory, segments);
+        return_error(gs_error_VMerror);
+    }
+    *pbuffer = segments;
+    return 0;
+}
+
+/* Runs on the rendering thread: copy out the band, and compress the
+ * segments that lie wholly within it. */
+static int
+jpeg_band_process(void *arg, gx_device *dev, gx_device *bdev, const gs_int_rect *rect, void *buffer)
+{
+    jpeg_segment_encoder_t *enc = (jpeg_segment_encoder_t *)arg;
+    jpeg_band_segments_t *segments = (jpeg_band_segments_t *)buffer;
+    int n = enc->segment_rows;
+    /* A downscaled band may end with a partial row beyond the image. */
+    int h = max(min(rect->q.y, enc->height) - rect->p.y, 0);
+    int end_segment, i, y, code;
+    gs_int_rect band_rect;
+    gs_get_bits_params_t params;
+    uint raster;
+
+    band_rect.p.x = 0;
+    band_rect.p.y = 0;
+    band_rect.q.x = rect->q.x - rect->p.x;
+    band_rect.q.y = h;
+    params.options = GB_COLORS_NATIVE | GB_ALPHA_NONE | GB_PACKING_CHUNKY |
+                     GB_RETURN_POINTER | GB_ALIGN_ANY | GB_OFFSET_0 |
+                     GB_RASTER_ANY;
+    code = dev_proc(bdev, get_bits_rectangle)(bdev, &band_rect, &params);
+    if (code < 0)
+        return code;
+    raster = (params.options & GB_RASTER_SPECIFIED ? params.raster :
+              gx_device_raster(bdev, true));
+    for (y = 0; y < h; y++)
+        memcpy(segments->data + (size_t)y * enc->line_size,
+               params.data[0] + (size_t)y * raster, enc->line_size);
+
+    segments->y0 = rect->p.y;
+    segments->y1 = rect->p.y + h;
+    /* The last segment of the image may be short. */
+    segments->first_segment = (segments->y0 + n - 1) / n;
+    end_segment = (segments->y1 == enc->height ? segments->y1 + n - 1 : segments->y1) / n;
+    segments->num_segments = max(end_segment - segments->first_segment, 0);
+    for (i = 0; i < segments->num_segments; i++) {
+        y = (segments->first_segment + i) * n;
+        code = jpeg_compress_segment(enc, &segments->segments[i],
+                                     segments->data + (size_t)(y - segments->y0) * enc->line_size,
+                                     y);
+        if (code < 0)
+            return code;
+    }
+    return 0;
+}
+
+/* On the main thread, in page order: append the band to the file. */
+static int
+jpeg_band_output(void *arg, gx_device *dev, void *buffer)
+{
+    jpeg_segment_encoder_t *enc = (jpeg_segment_encoder_t *)arg;
+    jpeg_band_segments_t *segments = (jpeg_band_segments_t *)buffer;
+    int n = enc->segment_rows;
+    int y = segments->y0;
+    int whole = (segments->num_segments > 0 ? segments->first_segment * n : segments->y1);
+    int i, code;
+
+    /* Rows before the first whole segment finish one begun in an earlier
+     * band (or, failing any whole segments, may begin one for a later
+     * band). */
+    if (whole > y) {
+        code = jpeg_segment_pending(enc, segments->data, y, whole - y);
+        if (code < 0)
+            return code;
+    }
+    if (segments->num_segments == 0)
+        return 0;
+
+    for (i = 0; i < segments->num_segments; i++) {
+        code = jpeg_write_segment(enc, &segments->segments[i],
+                                  (segments->first_segment + i) * n);
+        if (code < 0)
+            return code;
+    }
+    y = min((segments->first_segment + segments->num_segments) * n, segments->y1);
+
+    /* Rows after the last whole segment begin one for the next band. */
+    if (y < segments->y1)
+        return jpeg_segment_pending(enc,
+                                    segments->data + (size_t)(y - segments->y0) * enc->line_size,
+                                    y, segments->y1 - y);
+    return 0;
+}
+
+/* Can the rendering threads compress the segments? The downscaling, if
+ * any, must then be done by gx_downscaler_process_page, which goes by the
+ * component depth (not always filled in, as for jpegcmyk), and the bands
+ * must hold whole output rows (see jpeg_spec_op). */
+static bool
+jpeg_can_compress_bands(gx_device_jpeg *jdev)
+{
+    gx_downscaler_params *params = &jdev->downscale;
+    int factor = params->downscale_factor;
+
+    if (!PRINTER_IS_CLIST((gx_device_printer *)jdev) ||
+        jdev->num_render_threads_requested < 1)
+        return false;
+    if (factor <= 1)
+        return true;
+    return factor <= 8 && jdev->color_info.comp_bits[0] == 8 &&
+           params->min_feature_size <= 1 &&
+           params->trap_w == 0 && params->trap_h == 0 && params->ets == 0 &&
+           !params->do_skew_detection &&
+           ((gx_device_clist_common *)jdev)->page_info.band_params.BandHeight % factor == 0;
+}
+
+/* Compress the page a segment at a time on the rendering threads. */
+static int
+jpeg_print_segments(gx_device_jpeg *jdev, gp_file *prn_stream, int height,
+                    int segment_rows, uint line_size)
+{
+    jpeg_segment_encoder_t enc;
+    gx_process_page_options_t process = { 0 };
+    int factor = jdev->downscale.downscale_factor;
+    int code;
+
+    enc.dev = jdev;
+    enc.file = prn_stream;
+    enc.memory = jdev->memory;
+    enc.height = height;
+    enc.segment_rows = segment_rows;
+    enc.line_size = line_size;
+    enc.pending_y = 0;
+    enc.pending_rows = 0;
+    enc.pending = gs_alloc_bytes(enc.memory, (size_t)segment_rows * line_size,
+                                 "jpeg_print_segments");
+    if (enc.pending == NULL)
+        return_error(gs_error_VMerror);
+    process.init_buffer_fn = jpeg_band_init;
+    process.free_buffer_fn = jpeg_band_free;
+    process.process_fn = jpeg_band_process;
+    process.output_fn = jpeg_band_output;
+    process.arg = &enc;
+    if (factor > 1)
+        code = gx_downscaler_process_page((gx_device *)jdev, &process, factor);
+    else
+        code = dev_proc(jdev, process_page)((gx_device *)jdev, &process);
+    gs_free_object(enc.memory, enc.pending, "jpeg_print_segments");
+    return code;
+}
+
+static int
+jpeg_spec_op(gx_device *dev, int op, void *data, int datasize)
+{
+    gx_device_jpeg *jdev = (gx_device_jpeg *)dev;
+
+    /* Bands of whole output rows let the rendering threads downscale
+     * the segments they compress. */
+    if (op == gxdso_adjust_bandheight && jdev->RestartInterval > 0)
+        return gx_downscaler_adjust_bandheight(jdev->downscale.downscale_factor,
+                                               datasize);
+    return gdev_prn_dev_spec_op(dev, op, data, datasize);
+}
+
+/* Send the page to the file. */
+static int
+jpeg_print_page(gx_device_printer * pdev, gp_file * prn_stream)
+{
+    gx_device_jpeg *jdev = (gx_device_jpeg *) pdev;
+    gs_memory_t *mem = pdev->memory;
+    int line_size = gdev_mem_bytes_per_scan_line((gx_device *) pdev);
+    byte *in = gs_alloc_bytes(mem, line_size, "jpeg_print_page(in)");
+    jpeg_compress_data *jcdp = gs_alloc_struct_immovable(mem, jpeg_compress_data,
+      &st_jpeg_compress_data, "jpeg_print_page(jpeg_compress_data)");
+    byte *fbuf = 0;
+    uint fbuf_size;
+    byte *jbuf = 0;
+    uint jbuf_size;
+    int lnum;
+    int code;
+    stream_DCT_state state;
+    stream fstrm, jstrm;
+    gx_downscaler_t ds;
+
+    if (jcdp == 0 || in == 0) {
+        code = gs_note_error(gs_error_VMerror);
+        goto fail;
+    }
+    code = jpeg_setup_compress(jdev, mem, &state, jcdp,
+                               gx_downscaler_scale(pdev->height, jdev->downscale.downscale_factor),
+                               jdev->RestartInterval);
+    if (code < 0)
+        goto fail;
+    if (code > 0 && jpeg_can_compress_bands(jdev)) {
+        code = jpeg_print_segments(jdev, prn_stream, jcdp->cinfo.image_height,
+                                   code, state.scan_line_size);
+        goto done;
+    }
+    code = gx_downscaler_init(&ds, (gx_device *)jdev, 8, 8,
+                              jdev->color_info.depth/8,
+                              &jdev->downscale, NULL, 0);
+    if (code < 0)
+        goto done;
 
     /* Set up the streams. */
     fbuf_size = max(512 /* arbitrary */ , jcdp->templat.min_out_size);
@@ -512,7 +965,7 @@ jpeg_print_page(gx_device_printer * pdev, gp_file * prn_stream)
         (jbuf = gs_alloc_bytes(mem, jbuf_size, "jpeg_print_page(jbuf)")) == 0
         ) {
         code = gs_note_error(gs_error_VMerror);
-        goto done;
+        goto done_ds;
     }
     s_init(&fstrm, mem);
     swrite_file(&fstrm, prn_stream, fbuf, fbuf_size);
@@ -531,7 +984,7 @@ jpeg_print_page(gx_device_printer * pdev, gp_file * prn_stream)
 
         if (jstrm.end_status) {
             code = gs_note_error(gs_error_ioerror);
-            goto done;
+            goto done_ds;
         }
         gx_downscaler_getbits(&ds, in, lnum);
         sputs(&jstrm, in, state.scan_line_size, &ignore_used);
@@ -540,14 +993,14 @@ jpeg_print_page(gx_device_printer * pdev, gp_file * prn_stream)
     /* Wrap up. */
     sclose(&jstrm);
     sflush(&fstrm);
+    code = 0;
+  done_ds:
+    gx_downscaler_fin(&ds);
   done:
     gs_free_object(mem, jbuf, "jpeg_print_page(jbuf)");
     gs_free_object(mem, fbuf, "jpeg_print_page(fbuf)");
-    if (jcdp) {
-        gs_jpeg_destroy(&state);
-        gs_free_object(mem, jcdp, "jpeg_print_page(jpeg_compress_data)");
-    }
-    gx_downscaler_fin(&ds);
+    gs_jpeg_destroy(&state);
+    gs_free_object(mem, jcdp, "jpeg_print_page(jpeg_compress_data)");
     gs_free_object(mem, in, "jpeg_print_page(in)");
     return code;
   fail:
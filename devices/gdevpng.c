@@ -49,6 +49,7 @@
  */
 /*#define PNG_NO_STDIO*/
 #include "png_.h"
+#include "zlib.h"
 
 #include "gdevprn.h"
 #include "gdevmem.h"
@@ -57,6 +58,7 @@
 #include "gxdownscale.h"
 #include "gxdevsop.h"
 #include "gscms.h"
+#include "gxgetbit.h"
 
 /* ------ The device descriptors ------ */
 
@@ -82,19 +84,33 @@ static dev_proc_put_params(png_put_params_downscale);
 static dev_proc_get_params(png_get_params_downscale_mfs);
 static dev_proc_put_params(png_put_params_downscale_mfs);
 static dev_proc_dev_spec_op(pngalpha_spec_op);
+static dev_proc_get_params(png_get_params);
+static dev_proc_put_params(png_put_params);
+static dev_proc_dev_spec_op(png_spec_op);
 
 typedef struct gx_device_png_s gx_device_png;
 struct gx_device_png_s {
     gx_device_common;
     gx_prn_device_common;
     gx_downscaler_params downscale;
+    int deflate_block_rows;     /* 0 = let libpng deflate the image */
 };
 
 /* Monochrome. */
 
+/* Since the print_page doesn't alter the device, this device can print in the background */
+static void
+pngmono_initialize_device_procs(gx_device *dev)
+{
+    gdev_prn_initialize_device_procs_mono_bg(dev);
+
+    set_dev_proc(dev, get_params, png_get_params);
+    set_dev_proc(dev, put_params, png_put_params);
+}
+
 const gx_device_png gs_pngmono_device =
 { /* The print_page proc is compatible with allowing bg printing */
-  prn_device_body(gx_device_png, gdev_prn_initialize_device_procs_mono_bg, "pngmono",
+  prn_device_body(gx_device_png, pngmono_initialize_device_procs, "pngmono",
            DEFAULT_WIDTH_10THS, DEFAULT_HEIGHT_10THS,
            X_DPI, Y_DPI,
            0, 0, 0, 0,		/* margins */
@@ -115,6 +131,8 @@ png16_initialize_device_procs(gx_device *dev)
     set_dev_proc(dev, map_color_rgb, pc_4bit_map_color_rgb);
     set_dev_proc(dev, encode_color, pc_4bit_map_rgb_color);
     set_dev_proc(dev, decode_color, pc_4bit_map_color_rgb);
+    set_dev_proc(dev, get_params, png_get_params);
+    set_dev_proc(dev, put_params, png_put_params);
 }
 
 const gx_device_png gs_png16_device = {
@@ -139,6 +157,8 @@ png256_initialize_device_procs(gx_device *dev)
     set_dev_proc(dev, map_color_rgb, pc_8bit_map_color_rgb);
     set_dev_proc(dev, encode_color, pc_8bit_map_rgb_color);
     set_dev_proc(dev, decode_color, pc_8bit_map_color_rgb);
+    set_dev_proc(dev, get_params, png_get_params);
+    set_dev_proc(dev, put_params, png_put_params);
 }
 
 const gx_device_png gs_png256_device = {
@@ -160,6 +180,7 @@ pnggray_initialize_device_procs(gx_device *dev)
 
     set_dev_proc(dev, get_params, png_get_params_downscale);
     set_dev_proc(dev, put_params, png_put_params_downscale);
+    set_dev_proc(dev, dev_spec_op, png_spec_op);
     set_dev_proc(dev, encode_color, gx_default_8bit_map_gray_color);
     set_dev_proc(dev, decode_color, gx_default_8bit_map_color_gray);
 }
@@ -206,6 +227,7 @@ png16m_initialize_device_procs(gx_device *dev)
 
     set_dev_proc(dev, get_params, png_get_params_downscale);
     set_dev_proc(dev, put_params, png_put_params_downscale);
+    set_dev_proc(dev, dev_spec_op, png_spec_op);
 
     /* The prn macros used in previous versions of the code leave
      * encode_color and decode_color set to NULL (which are then rewritten
@@ -230,6 +252,9 @@ png48_initialize_device_procs(gx_device *dev)
 {
     gdev_prn_initialize_device_procs_rgb_bg(dev);
 
+    set_dev_proc(dev, get_params, png_get_params);
+    set_dev_proc(dev, put_params, png_put_params);
+
     /* The prn macros used in previous versions of the code leave
      * encode_color and decode_color set to NULL (which are then rewritten
      * by the system to the default. For compatibility we do the same. */
@@ -260,6 +285,7 @@ struct gx_device_pngalpha_s {
     gx_device_common;
     gx_prn_device_common;
     gx_downscaler_params downscale;
+    int deflate_block_rows;     /* as gx_device_png */
     int background;
 };
 
@@ -315,6 +341,7 @@ const gx_device_pngalpha gs_pngalpha_device = {
         std_device_part3_(),
         prn_device_body_rest_(png_print_page),
         GX_DOWNSCALER_PARAMS_DEFAULTS,
+        0,		/* deflate_block_rows */
         0xffffff	/* white background */
 };
 
@@ -350,11 +377,72 @@ const gx_device_pngalpha gs_png16malpha_device = {
         std_device_part3_(),
         prn_device_body_rest_(png_print_page),
         GX_DOWNSCALER_PARAMS_DEFAULTS,
+        0,		/* deflate_block_rows */
         0xffffff	/* white background */
 };
 
 /* ------ Private definitions ------ */
 
+/* DeflateBlockRows, which all the PNG devices take. */
+static int
+png_write_block_params(gx_device_png *pdev, gs_param_list *plist)
+{
+    return param_write_int(plist, "DeflateBlockRows", &pdev->deflate_block_rows);
+}
+
+static int
+png_read_block_params(gx_device_png *pdev, gs_param_list *plist)
+{
+    int rows;
+    int code;
+
+    switch (code = param_read_int(plist, "DeflateBlockRows", &rows)) {
+        case 0:
+            if (rows < 0) {
+                code = gs_note_error(gs_error_rangecheck);
+                param_signal_error(plist, "DeflateBlockRows", code);
+                break;
+            }
+            pdev->deflate_block_rows = rows;
+            break;
+        case 1:		/* not found */
+            code = 0;
+            break;
+        default:
+            param_signal_error(plist, "DeflateBlockRows", code);
+            break;
+    }
+    return code;
+}
+
+static int
+png_get_params(gx_device *dev, gs_param_list *plist)
+{
+    int code, ecode;
+
+    ecode = png_write_block_params((gx_device_png *)dev, plist);
+
+    code = gdev_prn_get_params(dev, plist);
+    if (code < 0)
+        ecode = code;
+
+    return ecode;
+}
+
+static int
+png_put_params(gx_device *dev, gs_param_list *plist)
+{
+    int code, ecode;
+
+    ecode = png_read_block_params((gx_device_png *)dev, plist);
+
+    code = gdev_prn_put_params(dev, plist);
+    if (code < 0)
+        ecode = code;
+
+    return ecode;
+}
+
 static int
 png_get_params_downscale(gx_device * dev, gs_param_list * plist)
 {
@@ -364,6 +452,8 @@ png_get_params_downscale(gx_device * dev, gs_param_list * plist)
     ecode = 0;
     if ((code = gx_downscaler_write_params(plist, &pdev->downscale, 0)) < 0)
         ecode = code;
+    if ((code = png_write_block_params(pdev, plist)) < 0)
+        ecode = code;
 
     code = gdev_prn_get_params(dev, plist);
     if (code < 0)
@@ -379,6 +469,8 @@ png_put_params_downscale(gx_device *dev, gs_param_list *plist)
     int code, ecode;
 
     ecode = gx_downscaler_read_params(plist, &pdev->downscale, 0);
+    if ((code = png_read_block_params(pdev, plist)) < 0)
+        ecode = code;
 
     code = gdev_prn_put_params(dev, plist);
     if (code < 0)
@@ -395,6 +487,8 @@ png_get_params_downscale_mfs(gx_device *dev, gs_param_list *plist)
 
     ecode = gx_downscaler_write_params(plist, &pdev->downscale,
                                       GX_DOWNSCALER_PARAMS_MFS);
+    if ((code = png_write_block_params(pdev, plist)) < 0)
+        ecode = code;
 
     code = gdev_prn_get_params(dev, plist);
     if (code < 0)
@@ -411,6 +505,8 @@ png_put_params_downscale_mfs(gx_device *dev, gs_param_list *plist)
 
     ecode = gx_downscaler_read_params(plist, &pdev->downscale,
                                       GX_DOWNSCALER_PARAMS_MFS);
+    if ((code = png_read_block_params(pdev, plist)) < 0)
+        ecode = code;
 
     code = gdev_prn_put_params(dev, plist);
     if (code < 0)
@@ -419,6 +515,19 @@ png_put_params_downscale_mfs(gx_device *dev, gs_param_list *plist)
     return ecode;
 }
 
+static int
+png_spec_op(gx_device *dev, int op, void *data, int datasize)
+{
+    gx_device_png *pdev = (gx_device_png *)dev;
+
+    /* Bands of whole output rows let the rendering threads downscale
+     * the blocks they deflate. */
+    if (op == gxdso_adjust_bandheight && pdev->deflate_block_rows > 0)
+        return gx_downscaler_adjust_bandheight(pdev->downscale.downscale_factor,
+                                               datasize);
+    return gdev_prn_dev_spec_op(dev, op, data, datasize);
+}
+
 #define PNG_MEM_ALIGN 16
 static png_voidp
 gdevpng_malloc(png_structp png, png_size_t size)
@@ -465,6 +574,498 @@ my_png_flush(png_struct *png)
     (void)gp_fflush(file);
 }
 
+/* ------ Deflating the image in blocks of rows ------ */
+
+/*
+ * With DeflateBlockRows set, the image data is filtered and deflated in
+ * blocks of that many rows, rather than by libpng as a single stream. The
+ * first row of a block is filtered without reference to the row above it,
+ * and each block's deflate data is flushed to a byte boundary at its end,
+ * so the blocks can be compressed independently of one another and simply
+ * concatenated. When the clist is rendered by several threads, each thread
+ * compresses the blocks lying wholly within its own band, and the main
+ * thread writes them out in page order, compressing itself only the odd
+ * block that straddles two bands. Otherwise the main thread compresses
+ * every block in turn, so the file is byte for byte the same either way.
+ * Each block is written as an IDAT chunk of its own.
+ */
+
+typedef struct png_block_encoder_s {
+    gp_file *file;
+    gs_memory_t *memory;
+    int height;                 /* of the image */
+    int block_rows;
+    uint rowbytes;
+    int bpp;                    /* bytes per pixel to filter by, 0 for none */
+    /* The libpng transformations set up in do_png_print_page. (The
+     * byte swap isn't one: png_set_swap is called before libpng knows the
+     * bit depth, so it does nothing, and 16 bit rows are already stored
+     * most significant byte first.) */
+    bool invert;
+    bool invert_alpha;
+    byte last_mask;             /* clears the padding at the end of a row */
+    uint block_size;            /* room for one block, deflated */
+    /* The rows of a block that straddles bands, collected by the main
+     * thread, and the room to compress it. */
+    byte *pending;
+    int pending_y;
+    int pending_rows;
+    byte *filtered;
+    byte *deflated;
+    uLong adler;                /* of the image data written so far */
+} png_block_encoder_t;
+
+typedef struct png_band_blocks_s {
+    gs_memory_t *memory;
+    byte *data;                 /* the band, as PNG rows */
+    int y0, y1;                 /* the rows of the image it holds */
+    int first_block;
+    int num_blocks;
+    byte *filtered;             /* room to filter one block */
+    byte *deflated;             /* the whole blocks, one after another */
+    uint *lengths;              /* of each deflated block */
+    uLong *adlers;              /* of each block's filtered data */
+} png_band_blocks_t;
+
+static void *
+png_zalloc(void *mem, uInt items, uInt size)
+{
+    return gs_alloc_bytes((gs_memory_t *)mem, (size_t)items * size, "png_zalloc");
+}
+
+static void
+png_zfree(void *mem, void *address)
+{
+    gs_free_object((gs_memory_t *)mem, address, "png_zfree");
+}
+
+/* Copy a row as rendered into the form it takes in the file. */
+static void
+png_block_row(const png_block_encoder_t *enc, byte *dst, const byte *src)
+{
+    uint i;
+
+    if (dst != src)
+        memcpy(dst, src, enc->rowbytes);
+    if (enc->invert) {
+        for (i = 0; i < enc->rowbytes; i++)
+            dst[i] = ~dst[i];
+    } else if (enc->invert_alpha) {
+        for (i = 3; i < enc->rowbytes; i += 4)
+            dst[i] = ~dst[i];
+    }
+    dst[enc->rowbytes - 1] &= enc->last_mask;
+}
+
+static int
+png_paeth(int a, int b, int c)
+{
+    int pa = any_abs(b - c);
+    int pb = any_abs(a - c);
+    int pc = any_abs(a + b - 2 * c);
+
+    if (pa <= pb && pa <= pc)
+        return a;
+    return pb <= pc ? b : c;
+}
+
+static byte
+png_filter_byte(int type, const byte *row, const byte *prev, int i, int bpp)
+{
+    int a = (i >= bpp ? row[i - bpp] : 0);
+
+    switch (type) {
+        case PNG_FILTER_VALUE_SUB:
+            return (byte)(row[i] - a);
+        case PNG_FILTER_VALUE_UP:
+            return (byte)(row[i] - prev[i]);
+        case PNG_FILTER_VALUE_AVG:
+            return (byte)(row[i] - ((a + prev[i]) >> 1));
+        case PNG_FILTER_VALUE_PAETH:
+            return (byte)(row[i] - png_paeth(a, prev[i], i >= bpp ? prev[i - bpp] : 0));
+        default:
+            return row[i];
+    }
+}
+
+/* Filter a row with the filter that gives the smallest sum of absolute
+ * (signed) differences, as libpng does by default. prev is NULL for the
+ * first row of a block, which can only use None and Sub. */
+static void
+png_filter_row(const png_block_encoder_t *enc, const byte *row, const byte *prev,
+               byte *out)
+{
+    int last_type = (prev != NULL ? PNG_FILTER_VALUE_PAETH : PNG_FILTER_VALUE_SUB);
+    int type, best = PNG_FILTER_VALUE_NONE;
+    ulong best_sum = ~(ulong)0;
+    uint i;
+
+    if (enc->bpp > 0) {
+        for (type = PNG_FILTER_VALUE_NONE; type <= last_type; type++) {
+            ulong sum = 0;
+
+            for (i = 0; i < enc->rowbytes && sum < best_sum; i++) {
+                byte v = png_filter_byte(type, row, prev, i, enc->bpp);
+
+                sum += (v < 128 ? v : 256 - v);
+            }
+            if (sum < best_sum) {
+                best = type;
+                best_sum = sum;
+            }
+        }
+    }
+    out[0] = best;
+    if (best == PNG_FILTER_VALUE_NONE)
+        memcpy(out + 1, row, enc->rowbytes);
+    else
+        for (i = 0; i < enc->rowbytes; i++)
+            out[i + 1] = png_filter_byte(best, row, prev, i, enc->bpp);
+}
+
+/* Filter and deflate the rows of the block beginning at row y. Only the
+ * last block of the image ends the deflate stream. */
+static int
+png_deflate_block(const png_block_encoder_t *enc, gs_memory_t *mem,
+                  const byte *rows, int y, byte *filtered, byte *deflated,
+                  uint *plength, uLong *padler)
+{
+    int nrows = min(enc->block_rows, enc->height - y);
+    bool last = (y + nrows == enc->height);
+    uint size = nrows * (enc->rowbytes + 1);
+    z_stream zs;
+    int i, err;
+
+    for (i = 0; i < nrows; i++)
+        png_filter_row(enc, rows + (size_t)i * enc->rowbytes,
+                       i > 0 ? rows + (size_t)(i - 1) * enc->rowbytes : NULL,
+                       filtered + (size_t)i * (enc->rowbytes + 1));
+    *padler = adler32(adler32(0L, Z_NULL, 0), filtered, size);
+
+    memset(&zs, 0, sizeof(zs));
+    zs.zalloc = png_zalloc;
+    zs.zfree = png_zfree;
+    zs.opaque = mem;
+    if (deflateInit2(&zs, Z_DEFAULT_COMPRESSION, Z_DEFLATED, -MAX_WBITS, 8,
+                     enc->bpp > 0 ? Z_FILTERED : Z_DEFAULT_STRATEGY) != Z_OK)
+        return_error(gs_error_VMerror);
+    zs.next_in = filtered;
+    zs.avail_in = size;
+    zs.next_out = deflated;
+    zs.avail_out = enc->block_size;
+    err = deflate(&zs, last ? Z_FINISH : Z_SYNC_FLUSH);
+    *plength = enc->block_size - zs.avail_out;
+    (void)deflateEnd(&zs);
+    if (last ? err != Z_STREAM_END : (err != Z_OK || zs.avail_out == 0))
+        return_error(gs_error_unknownerror);
+    return 0;
+}
+
+static void
+png_write_be32(gp_file *file, uLong v)
+{
+    byte b[4];
+
+    b[0] = (byte)(v >> 24);
+    b[1] = (byte)(v >> 16);
+    b[2] = (byte)(v >> 8);
+    b[3] = (byte)v;
+    gp_fwrite(b, 1, 4, file);
+}
+
+/* Write a deflated block as an IDAT chunk, with the zlib header before
+ * the first block and the checksum after the last. */
+static void
+png_write_block(png_block_encoder_t *enc, int y, const byte *data, uint length,
+                uLong adler)
+{
+    static const byte zlib_header[2] = { 0x78, 0x9c };
+    int nrows = min(enc->block_rows, enc->height - y);
+    bool first = (y == 0);
+    bool last = (y + nrows == enc->height);
+    byte trailer[4];
+    uLong crc;
+
+    enc->adler = adler32_combine(enc->adler, adler,
+                                 (z_off_t)nrows * (enc->rowbytes + 1));
+    png_write_be32(enc->file, length + (first ? 2 : 0) + (last ? 4 : 0));
+    gp_fwrite("IDAT", 1, 4, enc->file);
+    crc = crc32(crc32(0L, Z_NULL, 0), (const byte *)"IDAT", 4);
+    if (first) {
+        gp_fwrite(zlib_header, 1, 2, enc->file);
+        crc = crc32(crc, zlib_header, 2);
+    }
+    gp_fwrite(data, 1, length, enc->file);
+    crc = crc32(crc, data, length);
+    if (last) {
+        trailer[0] = (byte)(enc->adler >> 24);
+        trailer[1] = (byte)(enc->adler >> 16);
+        trailer[2] = (byte)(enc->adler >> 8);
+        trailer[3] = (byte)enc->adler;
+        gp_fwrite(trailer, 1, 4, enc->file);
+        crc = crc32(crc, trailer, 4);
+    }
+    png_write_be32(enc->file, crc);
+}
+
+/* On the main thread, collect rows of a block that isn't compressed by a
+ * rendering thread, writing it out once it is complete. */
+static int
+png_block_pending(png_block_encoder_t *enc, const byte *rows, int y, int nrows)
+{
+    while (nrows > 0) {
+        int block_rows, n;
+
+        if (enc->pending_rows == 0)
+            enc->pending_y = y;
+        block_rows = min(enc->block_rows, enc->height - enc->pending_y);
+        n = min(nrows, block_rows - enc->pending_rows);
+        memcpy(enc->pending + (size_t)enc->pending_rows * enc->rowbytes,
+               rows, (size_t)n * enc->rowbytes);
+        enc->pending_rows += n;
+        rows += (size_t)n * enc->rowbytes;
+        y += n;
+        nrows -= n;
+        if (enc->pending_rows == block_rows) {
+            uint length;
+            uLong adler;
+            int code = png_deflate_block(enc, enc->memory, enc->pending,
+                                         enc->pending_y, enc->filtered,
+                                         enc->deflated, &length, &adler);
+
+            if (code < 0)
+                return code;
+            png_write_block(enc, enc->pending_y, enc->deflated, length, adler);
+            enc->pending_rows = 0;
+        }
+    }
+    return 0;
+}
+
+/* The process_page callbacks. */
+static void
+png_band_free(void *arg, gx_device *dev, gs_memory_t *memory, void *buffer)
+{
+    png_band_blocks_t *blocks = (png_band_blocks_t *)buffer;
+
+    if (blocks == NULL)
+        return;
+    gs_free_object(memory, blocks->data, "png_band_free");
+    gs_free_object(memory, blocks->filtered, "png_band_free");
+    gs_free_object(memory, blocks->deflated, "png_band_free");
+    gs_free_object(memory, blocks->lengths, "png_band_free");
+    gs_free_object(memory, blocks->adlers, "png_band_free");
+    gs_free_object(memory, blocks, "png_band_free");
+}
+
+static int
+png_band_init(void *arg, gx_device *dev, gs_memory_t *memory, int w, int h, void **pbuffer)
+{
+    png_block_encoder_t *enc = (png_block_encoder_t *)arg;
+    /* The most whole blocks a band can hold, the last being short. */
+    int max_blocks = h / enc->block_rows + 1;
+    png_band_blocks_t *blocks;
+
+    blocks = (png_band_blocks_t *)gs_alloc_bytes(memory, sizeof(*blocks), "png_band_init");
+    if (blocks == NULL)
+        return_error(gs_error_VMerror);
+    memset(blocks, 0, sizeof(*blocks));
+    blocks->memory = memory;
+    blocks->data = gs_alloc_bytes(memory, (size_t)h * enc->rowbytes, "png_band_init");
+    blocks->filtered = gs_alloc_bytes(memory,
+                                      (size_t)enc->block_rows * (enc->rowbytes + 1),
+                                      "png_band_init");
+    blocks->deflated = gs_alloc_bytes(memory, (size_t)max_blocks * enc->block_size,
+                                      "png_band_init");
+    blocks->lengths = (uint *)gs_alloc_bytes(memory, max_blocks * sizeof(uint),
+                                             "png_band_init");
+    blocks->adlers = (uLong *)gs_alloc_bytes(memory, max_blocks * sizeof(uLong),
+                                             "png_band_init");
+    if (blocks->data == NULL || blocks->filtered == NULL ||
+        blocks->deflated == NULL || blocks->lengths == NULL ||
+        blocks->adlers == NULL) {
+        png_band_free(arg, dev, memory, blocks);
+        return_error(gs_error_VMerror);
+    }
+    *pbuffer = blocks;
+    return 0;
+}
+
+/* Runs on the rendering thread: copy out the band, and compress the
+ * blocks that lie wholly within it. */
+static int
+png_band_process(void *arg, gx_device *dev, gx_device *bdev, const gs_int_rect *rect, void *buffer)
+{
+    png_block_encoder_t *enc = (png_block_encoder_t *)arg;
+    png_band_blocks_t *blocks = (png_band_blocks_t *)buffer;
+    int n = enc->block_rows;
+    /* A downscaled band may end with a partial row beyond the image. */
+    int h = max(min(rect->q.y, enc->height) - rect->p.y, 0);
+    int end_block, i, y, code;
+    gs_int_rect band_rect;
+    gs_get_bits_params_t params;
+    uint raster;
+    byte *p;
+
+    band_rect.p.x = 0;
+    band_rect.p.y = 0;
+    band_rect.q.x = rect->q.x - rect->p.x;
+    band_rect.q.y = h;
+    params.options = GB_COLORS_NATIVE | GB_ALPHA_NONE | GB_PACKING_CHUNKY |
+                     GB_RETURN_POINTER | GB_ALIGN_ANY | GB_OFFSET_0 |
+                     GB_RASTER_ANY;
+    code = dev_proc(bdev, get_bits_rectangle)(bdev, &band_rect, &params);
+    if (code < 0)
+        return code;
+    raster = (params.options & GB_RASTER_SPECIFIED ? params.raster :
+              gx_device_raster(bdev, true));
+    for (y = 0; y < h; y++)
+        png_block_row(enc, blocks->data + (size_t)y * enc->rowbytes,
+                      params.data[0] + (size_t)y * raster);
+
+    blocks->y0 = rect->p.y;
+    blocks->y1 = rect->p.y + h;
+    /* The last block of the image may be short. */
+    blocks->first_block = (blocks->y0 + n - 1) / n;
+    end_block = (blocks->y1 == enc->height ? blocks->y1 + n - 1 : blocks->y1) / n;
+    blocks->num_blocks = max(end_block - blocks->first_block, 0);
+    p = blocks->deflated;
+    for (i = 0; i < blocks->num_blocks; i++) {
+        y = (blocks->first_block + i) * n;
+        code = png_deflate_block(enc, blocks->memory,
+                                 blocks->data + (size_t)(y - blocks->y0) * enc->rowbytes,
+                                 y, blocks->filtered, p,
+                                 &blocks->lengths[i], &blocks->adlers[i]);
+        if (code < 0)
+            return code;
+        p += blocks->lengths[i];
+    }
+    return 0;
+}
+
+/* On the main thread, in page order: append the band to the file. */
+static int
+png_band_output(void *arg, gx_device *dev, void *buffer)
+{
+    png_block_encoder_t *enc = (png_block_encoder_t *)arg;
+    png_band_blocks_t *blocks = (png_band_blocks_t *)buffer;
+    int n = enc->block_rows;
+    int y = blocks->y0;
+    int whole = (blocks->num_blocks > 0 ? blocks->first_block * n : blocks->y1);
+    const byte *p = blocks->deflated;
+    int i, code;
+
+    /* Rows before the first whole block finish one begun in an earlier
+     * band (or, failing any whole blocks, may begin one for a later band). */
+    if (whole > y) {
+        code = png_block_pending(enc, blocks->data, y, whole - y);
+        if (code < 0)
+            return code;
+    }
+    if (blocks->num_blocks == 0)
+        return 0;
+
+    for (i = 0; i < blocks->num_blocks; i++) {
+        png_write_block(enc, (blocks->first_block + i) * n, p,
+                        blocks->lengths[i], blocks->adlers[i]);
+        p += blocks->lengths[i];
+    }
+    y = min((blocks->first_block + blocks->num_blocks) * n, blocks->y1);
+
+    /* Rows after the last whole block begin one for the next band. */
+    if (y < blocks->y1)
+        return png_block_pending(enc,
+                                 blocks->data + (size_t)(y - blocks->y0) * enc->rowbytes,
+                                 y, blocks->y1 - y);
+    return 0;
+}
+
+/* Can the rendering threads compress the blocks? The downscaling, if any,
+ * must then be done by gx_downscaler_process_page, which only manages
+ * whole factors of 8 bit data without the error diffusion that pngmonod
+ * needs, and bands that hold whole output rows (see png_spec_op). */
+static bool
+png_can_encode_bands(gx_device_png *pdev, bool monod, int factor)
+{
+    gx_downscaler_params *params = &pdev->downscale;
+
+    if (!PRINTER_IS_CLIST((gx_device_printer *)pdev) ||
+        pdev->num_render_threads_requested < 1 || monod)
+        return false;
+    if (factor == 1)
+        return true;
+    return factor > 1 && factor <= 8 &&
+           pdev->color_info.depth == 8 * pdev->color_info.num_components &&
+           params->min_feature_size <= 1 && params->trap_w == 0 &&
+           params->trap_h == 0 && params->ets == 0 && !params->do_skew_detection &&
+           ((gx_device_clist_common *)pdev)->page_info.band_params.BandHeight % factor == 0;
+}
+
+/* Write the image data, and the end of the file, in blocks. factor is the
+ * downscale factor, or 0 if it includes an upscale. */
+static int
+png_print_blocks(gx_device_png *pdev, png_block_encoder_t *enc, bool monod,
+                 int factor, int src_bpc, int dst_bpc, int depth, byte *row)
+{
+    gs_memory_t *mem = enc->memory;
+    int code;
+
+    enc->block_size = deflateBound(NULL, enc->block_rows * (enc->rowbytes + 1)) + 16;
+    enc->adler = adler32(0L, Z_NULL, 0);
+    enc->pending = gs_alloc_bytes(mem, (size_t)enc->block_rows * enc->rowbytes,
+                                  "png_print_blocks");
+    enc->filtered = gs_alloc_bytes(mem, (size_t)enc->block_rows * (enc->rowbytes + 1),
+                                   "png_print_blocks");
+    enc->deflated = gs_alloc_bytes(mem, enc->block_size, "png_print_blocks");
+    if (enc->pending == NULL || enc->filtered == NULL || enc->deflated == NULL) {
+        code = gs_note_error(gs_error_VMerror);
+        goto done;
+    }
+
+    if (png_can_encode_bands(pdev, monod, factor)) {
+        gx_process_page_options_t process = { 0 };
+
+        process.init_buffer_fn = png_band_init;
+        process.free_buffer_fn = png_band_free;
+        process.process_fn = png_band_process;
+        process.output_fn = png_band_output;
+        process.arg = enc;
+        if (factor > 1)
+            code = gx_downscaler_process_page((gx_device *)pdev, &process, factor);
+        else
+            code = dev_proc(pdev, process_page)((gx_device *)pdev, &process);
+    } else {
+        gx_downscaler_t ds;
+        int y;
+
+        code = gx_downscaler_init(&ds, (gx_device *)pdev, src_bpc, dst_bpc,
+                                  depth/dst_bpc, &pdev->downscale, NULL, 0);
+        if (code >= 0) {
+            for (y = 0; y < enc->height && code >= 0; y++) {
+                code = gx_downscaler_getbits(&ds, row, y);
+                if (code >= 0) {
+                    png_block_row(enc, row, row);
+                    code = png_block_pending(enc, row, y, 1);
+                }
+            }
+            gx_downscaler_fin(&ds);
+        }
+    }
+    if (code >= 0) {
+        static const byte iend[4] = { 'I', 'E', 'N', 'D' };
+
+        png_write_be32(enc->file, 0);
+        gp_fwrite(iend, 1, 4, enc->file);
+        png_write_be32(enc->file, crc32(crc32(0L, Z_NULL, 0), iend, 4));
+    }
+
+  done:
+    gs_free_object(mem, enc->pending, "png_print_blocks");
+    gs_free_object(mem, enc->filtered, "png_print_blocks");
+    gs_free_object(mem, enc->deflated, "png_print_blocks");
+    return code;
+}
+
 /* Write out a page in PNG format. */
 /* This routine is used for all formats. */
 static int
@@ -749,36 +1350,54 @@ do_png_print_page(gx_device_png * pdev, gp_file * file, bool monod)
     info_ptr->text = NULL;
 #endif
 
-    /* For simplicity of code, we always go through the downscaler. For
-     * non-supported depths, it will pass through with minimal performance
-     * hit. So ensure that we only trigger downscales when we need them.
-     */
-    code = gx_downscaler_init(&ds, (gx_device *)pdev, src_bpc, dst_bpc,
-                              depth/dst_bpc, &pdev->downscale, NULL, 0);
-    if (code >= 0)
-    {
+    if (pdev->deflate_block_rows > 0) {
+        /* We write the image data and the end of the file ourselves. */
+        png_block_encoder_t enc;
+
+        memset(&enc, 0, sizeof(enc));
+        enc.file = file;
+        enc.memory = mem;
+        enc.height = height;
+        enc.block_rows = max(min(pdev->deflate_block_rows, (int)height), 1);
+        enc.rowbytes = (width * depth + 7) >> 3;
+        enc.bpp = (color_type == PNG_COLOR_TYPE_PALETTE || bit_depth < 8 ? 0 : depth >> 3);
+        enc.invert = invert && depth != 32;
+        enc.invert_alpha = invert && depth == 32;
+        enc.last_mask = (byte)(0xff << (-(int)(width * depth) & 7));
+        code = png_print_blocks(pdev, &enc, monod, upfactor == 1 ? downfactor : 0,
+                                src_bpc, dst_bpc, depth, row);
+    } else {
+        /* For simplicity of code, we always go through the downscaler. For
+         * non-supported depths, it will pass through with minimal performance
+         * hit. So ensure that we only trigger downscales when we need them.
+         */
+        code = gx_downscaler_init(&ds, (gx_device *)pdev, src_bpc, dst_bpc,
+                                  depth/dst_bpc, &pdev->downscale, NULL, 0);
+        if (code >= 0)
+        {
 #ifdef CLUSTER
-        int bitlen = width*dst_bpc;
-        int end = bitlen>>3;
-        int mask = 255>>(bitlen&7);
-        if (bitlen & 7)
-            mask = ~mask;
-        else
-            end--;
+            int bitlen = width*dst_bpc;
+            int end = bitlen>>3;
+            int mask = 255>>(bitlen&7);
+            if (bitlen & 7)
+                mask = ~mask;
+            else
+                end--;
 #endif
-        /* Write the contents of the image. */
-        for (y = 0; y < height; y++) {
-            gx_downscaler_getbits(&ds, row, y);
+            /* Write the contents of the image. */
+            for (y = 0; y < height; y++) {
+                gx_downscaler_getbits(&ds, row, y);
 #ifdef CLUSTER
-            row[end] &= mask;
+                row[end] &= mask;
 #endif
-            png_write_rows(png_ptr, &row, 1);
+                png_write_rows(png_ptr, &row, 1);
+            }
+            gx_downscaler_fin(&ds);
         }
-        gx_downscaler_fin(&ds);
-    }
 
-    /* write the rest of the file */
-    png_write_end(png_ptr, info_ptr);
+        /* write the rest of the file */
+        png_write_end(png_ptr, info_ptr);
+    }
 
 #if PNG_LIBPNG_VER_MINOR >= 5
 #else
@@ -899,6 +1518,8 @@ pngalpha_put_params(gx_device * pdev, gs_param_list * plist)
 
     if ((ecode = gx_downscaler_read_params(plist, &ppdev->downscale, 0)) < 0)
         code = ecode;
+    if ((ecode = png_read_block_params((gx_device_png *)pdev, plist)) < 0)
+        code = ecode;
 
     if (code == 0) {
         code = gdev_prn_put_params(pdev, plist);
@@ -920,6 +1541,8 @@ pngalpha_get_params(gx_device * pdev, gs_param_list * plist)
     ecode = 0;
     if ((ecode = gx_downscaler_write_params(plist, &ppdev->downscale, 0)) < 0)
         code = ecode;
+    if ((ecode = png_write_block_params((gx_device_png *)pdev, plist)) < 0)
+        code = ecode;
 
     return code;
 }
@@ -31,6 +31,7 @@
 #include "gsicc_cache.h"
 #include "gscms.h"
 #include "gstiffio.h"
+#include "gxgetbit.h"
 #include "gdevkrnlsclass.h" /* 'standard' built in subclasses, currently First/Last Page and obejct filter */
 
 int
@@ -423,6 +424,381 @@ int tiff_set_fields_for_printer(gx_device_printer *pdev,
     return 0;
 }
 
+/* ------ Band-parallel strip encoding ------ */
+
+/*
+ * TIFF strips are compressed independently of one another, so when the
+ * clist is rendered by several threads, each thread can also pack and
+ * compress the strips lying wholly within its own band. The main thread
+ * then appends the finished strips to the file in page order, encoding
+ * itself only the odd strip that straddles two bands. The result is byte
+ * for byte the same as writing the scanlines one at a time.
+ *
+ * The threads compress their strips by writing them to a scratch TIFF in
+ * memory, set up with the same encoding fields as the real one.
+ */
+#ifdef TIFF_ENCODE_BANDS
+
+static const uint32_t tiff_band_tags[TIFF_BAND_TAGS] = {
+    TIFFTAG_COMPRESSION, TIFFTAG_BITSPERSAMPLE, TIFFTAG_SAMPLESPERPIXEL,
+    TIFFTAG_PHOTOMETRIC, TIFFTAG_FILLORDER, TIFFTAG_PLANARCONFIG,
+    TIFFTAG_RESOLUTIONUNIT
+};
+
+int
+tiff_band_encoder_init(tiff_band_encoder_t *enc, TIFF *tif, gs_memory_t *mem)
+{
+    uint32_t rows_per_strip, height;
+    uint16_t bps, spp;
+    int i;
+
+    memset(enc, 0, sizeof(*enc));
+    enc->tif = tif;
+    enc->memory = mem;
+    enc->name = TIFFFileName(tif);
+    enc->big_endian = TIFFIsBigEndian(tif);
+    for (i = 0; i < TIFF_BAND_TAGS; i++)
+        enc->has_tag[i] = TIFFGetField(tif, tiff_band_tags[i], &enc->tags[i]);
+    TIFFGetField(tif, TIFFTAG_IMAGEWIDTH, &enc->width);
+    TIFFGetField(tif, TIFFTAG_IMAGELENGTH, &height);
+    TIFFGetField(tif, TIFFTAG_ROWSPERSTRIP, &rows_per_strip);
+    enc->height = height;
+    enc->rows_per_strip = min(rows_per_strip, height);
+    TIFFGetFieldDefaulted(tif, TIFFTAG_XRESOLUTION, &enc->xres);
+    TIFFGetFieldDefaulted(tif, TIFFTAG_YRESOLUTION, &enc->yres);
+    if (enc->tags[0] == COMPRESSION_CCITTFAX3)
+        TIFFGetFieldDefaulted(tif, TIFFTAG_GROUP3OPTIONS, &enc->fax_options);
+    else if (enc->tags[0] == COMPRESSION_CCITTFAX4)
+        TIFFGetFieldDefaulted(tif, TIFFTAG_GROUP4OPTIONS, &enc->fax_options);
+    TIFFGetFieldDefaulted(tif, TIFFTAG_BITSPERSAMPLE, &bps);
+    TIFFGetFieldDefaulted(tif, TIFFTAG_SAMPLESPERPIXEL, &spp);
+    enc->bps = bps;
+    enc->last_bits = -(int)(enc->width * bps * spp) & 7;
+    enc->scanline_size = TIFFScanlineSize(tif);
+
+    enc->pending = gs_alloc_bytes(mem, enc->scanline_size * enc->rows_per_strip,
+                                  "tiff_band_encoder_init");
+    if (enc->pending == NULL)
+        return_error(gs_error_VMerror);
+    return 0;
+}
+
+void
+tiff_band_encoder_fin(tiff_band_encoder_t *enc)
+{
+    gs_free_object(enc->memory, enc->pending, "tiff_band_encoder_fin");
+    enc->pending = NULL;
+}
+
+static int
+tiff_band_set_fields(const tiff_band_encoder_t *enc, TIFF *to, int height)
+{
+    int i;
+
+    /* Compression comes first, as it defines the codec's own tags. */
+    for (i = 0; i < TIFF_BAND_TAGS; i++)
+        if (enc->has_tag[i])
+            TIFFSetField(to, tiff_band_tags[i], enc->tags[i]);
+    TIFFSetField(to, TIFFTAG_IMAGEWIDTH, enc->width);
+    TIFFSetField(to, TIFFTAG_IMAGELENGTH, height);
+    TIFFSetField(to, TIFFTAG_ROWSPERSTRIP, enc->rows_per_strip);
+    TIFFSetField(to, TIFFTAG_XRESOLUTION, enc->xres);
+    TIFFSetField(to, TIFFTAG_YRESOLUTION, enc->yres);
+    if (enc->tags[0] == COMPRESSION_CCITTFAX3)
+        TIFFSetField(to, TIFFTAG_GROUP3OPTIONS, enc->fax_options);
+    else if (enc->tags[0] == COMPRESSION_CCITTFAX4)
+        TIFFSetField(to, TIFFTAG_GROUP4OPTIONS, enc->fax_options);
+
+    return TIFFScanlineSize(to) == enc->scanline_size ? 0 :
+                gs_note_error(gs_error_unknownerror);
+}
+
+int
+tiff_band_strips_alloc(const tiff_band_encoder_t *enc, tiff_band_strips_t *strips,
+                       gs_memory_t *mem, int h)
+{
+    memset(strips, 0, sizeof(*strips));
+    strips->memory = mem;
+    strips->data = gs_alloc_bytes(mem, enc->scanline_size * h, "tiff_band_strips_alloc");
+    if (strips->data == NULL)
+        return_error(gs_error_VMerror);
+    return 0;
+}
+
+void
+tiff_band_strips_free(tiff_band_strips_t *strips)
+{
+    if (strips->encoded != NULL)
+        TIFFClose(strips->encoded);
+    strips->encoded = NULL;
+    gs_free_object(strips->memory, strips->data, "tiff_band_strips_free");
+    strips->data = NULL;
+}
+
+int
+tiff_band_encode_strips(const tiff_band_encoder_t *enc, tiff_band_strips_t *strips,
+                        int y0, int h)
+{
+    int rps = enc->rows_per_strip;
+    uint32_t strip, end_strip;
+    byte *p;
+    int y, code;
+
+    strips->y0 = y0;
+    strips->y1 = y0 + h;
+
+    /* The last strip of the page may be short. */
+    strips->first_strip = (y0 + rps - 1) / rps;
+    end_strip = (strips->y1 == enc->height ? strips->y1 + rps - 1 : strips->y1) / rps;
+    strips->num_strips = end_strip > strips->first_strip ?
+                            end_strip - strips->first_strip : 0;
+    if (strips->encoded != NULL) {
+        TIFFClose(strips->encoded);
+        strips->encoded = NULL;
+    }
+    if (strips->num_strips == 0)
+        return 0;
+
+    strips->encoded = tiff_in_memory(strips->memory, enc->name, enc->big_endian);
+    if (strips->encoded == NULL)
+        return_error(gs_error_VMerror);
+    y = strips->first_strip * rps;
+    code = tiff_band_set_fields(enc, strips->encoded,
+                                min(end_strip * rps, strips->y1) - y);
+    if (code < 0)
+        return code;
+    p = strips->data + (size_t)(y - y0) * enc->scanline_size;
+    for (strip = 0; strip < strips->num_strips; strip++) {
+        int rows = min(rps, strips->y1 - y);
+
+        if (TIFFWriteEncodedStrip(strips->encoded, strip, p,
+                                  rows * enc->scanline_size) < 0)
+            return_error(gs_error_ioerror);
+        p += (size_t)rows * enc->scanline_size;
+        y += rows;
+    }
+    return 0;
+}
+
+/* Collect rows of a strip that straddles bands, writing it out once it
+ * is complete. */
+static int
+tiff_band_pending(tiff_band_encoder_t *enc, const byte *data, int y, int rows)
+{
+    while (rows > 0) {
+        int strip_rows, n;
+
+        if (enc->pending_rows == 0)
+            enc->pending_y = y;
+        strip_rows = min(enc->rows_per_strip, enc->height - enc->pending_y);
+        n = min(rows, strip_rows - enc->pending_rows);
+        memcpy(enc->pending + (size_t)enc->pending_rows * enc->scanline_size,
+               data, (size_t)n * enc->scanline_size);
+        enc->pending_rows += n;
+        data += (size_t)n * enc->scanline_size;
+        y += n;
+        rows -= n;
+        if (enc->pending_rows == strip_rows) {
+            if (TIFFWriteEncodedStrip(enc->tif, enc->pending_y / enc->rows_per_strip,
+                                      enc->pending,
+                                      strip_rows * enc->scanline_size) < 0)
+                return_error(gs_error_ioerror);
+            enc->pending_rows = 0;
+        }
+    }
+    return 0;
+}
+
+int
+tiff_band_write_strips(tiff_band_encoder_t *enc, const tiff_band_strips_t *strips)
+{
+    int rps = enc->rows_per_strip;
+    int y = strips->y0;
+    int whole = (strips->num_strips > 0 ? strips->first_strip * rps : strips->y1);
+    const byte *data;
+    size_t len;
+    uint32_t strip;
+    int code;
+
+    /* Rows before the first whole strip finish one begun in an earlier
+     * band (or, failing any whole strips, may begin one for a later band). */
+    if (whole > y) {
+        code = tiff_band_pending(enc, strips->data, y, whole - y);
+        if (code < 0)
+            return code;
+        y = whole;
+    }
+    if (strips->num_strips == 0)
+        return 0;
+
+    data = tiff_memory_data(strips->encoded, &len);
+    for (strip = 0; strip < strips->num_strips; strip++) {
+        uint64_t offset = TIFFGetStrileOffset(strips->encoded, strip);
+        uint64_t count = TIFFGetStrileByteCount(strips->encoded, strip);
+
+        if (offset + count > len)
+            return_error(gs_error_unknownerror);
+        if (TIFFWriteRawStrip(enc->tif, strips->first_strip + strip,
+                              (void *)(data + offset), (tmsize_t)count) < 0)
+            return_error(gs_error_ioerror);
+    }
+    y = min((strips->first_strip + strips->num_strips) * rps, strips->y1);
+
+    /* Rows after the last whole strip begin one for the next band. */
+    if (y < strips->y1)
+        return tiff_band_pending(enc,
+                                 strips->data + (size_t)(y - strips->y0) * enc->scanline_size,
+                                 y, strips->y1 - y);
+    return 0;
+}
+
+bool
+tiff_can_encode_bands(gx_device_printer *dev, TIFF *tif)
+{
+    uint32_t rows_per_strip, height;
+    uint16_t planar;
+
+    if (!PRINTER_IS_CLIST(dev) || dev->num_render_threads_requested < 1 ||
+        TIFFIsTiled(tif))
+        return false;
+    if (!TIFFGetField(tif, TIFFTAG_PLANARCONFIG, &planar) ||
+        planar != PLANARCONFIG_CONTIG)
+        return false;
+    return TIFFGetField(tif, TIFFTAG_ROWSPERSTRIP, &rows_per_strip) &&
+           TIFFGetField(tif, TIFFTAG_IMAGELENGTH, &height) &&
+           rows_per_strip < height;
+}
+
+/* The process_page callbacks for a single TIFF file. */
+static int
+tiff_band_init(void *arg, gx_device *dev, gs_memory_t *memory, int w, int h, void **pbuffer)
+{
+    tiff_band_strips_t *strips;
+    int code;
+
+    strips = (tiff_band_strips_t *)gs_alloc_bytes(memory, sizeof(*strips), "tiff_band_init");
+    if (strips == NULL)
+        return_error(gs_error_VMerror);
+    code = tiff_band_strips_alloc((tiff_band_encoder_t *)arg, strips, memory, h);
+    if (code < 0) {
+        gs_free_object(memory, strips, "tiff_band_init");
+        return code;
+    }
+    *pbuffer = strips;
+    return 0;
+}
+
+static void
+tiff_band_free(void *arg, gx_device *dev, gs_memory_t *memory, void *buffer)
+{
+    if (buffer == NULL)
+        return;
+    tiff_band_strips_free((tiff_band_strips_t *)buffer);
+    gs_free_object(memory, buffer, "tiff_band_free");
+}
+
+/* Runs on the rendering thread: pack the band, and compress the strips
+ * that lie wholly within it. */
+static int
+tiff_band_process(void *arg, gx_device *dev, gx_device *bdev, const gs_int_rect *rect, void *buffer)
+{
+    tiff_band_encoder_t *enc = (tiff_band_encoder_t *)arg;
+    tiff_band_strips_t *strips = (tiff_band_strips_t *)buffer;
+    /* A downscaled band may end with a partial row beyond the image. */
+    int h = max(min(rect->q.y, enc->height) - rect->p.y, 0);
+    gs_int_rect band_rect;
+    gs_get_bits_params_t params;
+    uint raster;
+    byte *p;
+    int y, code;
+
+    band_rect.p.x = 0;
+    band_rect.p.y = 0;
+    band_rect.q.x = rect->q.x - rect->p.x;
+    band_rect.q.y = h;
+    params.options = GB_COLORS_NATIVE | GB_ALPHA_NONE | GB_PACKING_CHUNKY |
+                     GB_RETURN_POINTER | GB_ALIGN_ANY | GB_OFFSET_0 |
+                     GB_RASTER_ANY;
+    code = dev_proc(bdev, get_bits_rectangle)(bdev, &band_rect, &params);
+    if (code < 0)
+        return code;
+    raster = (params.options & GB_RASTER_SPECIFIED ? params.raster :
+              gx_device_raster(bdev, true));
+
+    /* As gdev_prn_get_bits, clear the padding at the end of each row. */
+    p = strips->data;
+    for (y = 0; y < h; y++) {
+        memcpy(p, params.data[0] + (size_t)y * raster, enc->scanline_size);
+        if (enc->last_bits != 0)
+            p[enc->scanline_size - 1] &= 0xff << enc->last_bits;
+#if defined(ARCH_IS_BIG_ENDIAN) && (!ARCH_IS_BIG_ENDIAN)
+        if (enc->bps == 16)
+            TIFFSwabArrayOfShort((uint16_t *)p, enc->scanline_size / 2);
+#endif
+        p += enc->scanline_size;
+    }
+    return tiff_band_encode_strips(enc, strips, rect->p.y, h);
+}
+
+static int
+tiff_band_output(void *arg, gx_device *dev, void *buffer)
+{
+    return tiff_band_write_strips((tiff_band_encoder_t *)arg,
+                                  (tiff_band_strips_t *)buffer);
+}
+
+/* Can the rendering threads do the downscaling as well? Only if
+ * gx_downscaler_process_page can: whole factors of 8 bit data, with
+ * none of the downscaler's other features, and bands that hold whole
+ * output rows (see tiffscaled_spec_op). */
+static bool
+tiff_can_downscale_bands(gx_device_printer *dev, gx_downscaler_params *params,
+                         int aw, int bpc, int num_comps)
+{
+    int factor = params->downscale_factor;
+    int width = gx_downscaler_scale(dev->width, factor);
+
+    if (factor < 1 || factor > 8 || bpc != 8 ||
+        dev->color_info.depth != 8 * num_comps ||
+        params->min_feature_size > 1 || params->trap_w != 0 ||
+        params->trap_h != 0 || params->ets != 0 || params->do_skew_detection ||
+        fax_adjusted_width(width, aw) != width)
+        return false;
+    return PRINTER_IS_CLIST(dev) &&
+           ((gx_device_clist_common *)dev)->page_info.band_params.BandHeight % factor == 0;
+}
+
+static int
+tiff_print_page_bands(gx_device_printer *dev, TIFF *tif, int factor)
+{
+    tiff_band_encoder_t enc;
+    gx_process_page_options_t process = { 0 };
+    int code;
+
+    if (TIFFScanlineSize(tif) > gdev_mem_bytes_per_scan_line((gx_device *)dev))
+        return_error(gs_error_rangecheck);
+    code = tiff_band_encoder_init(&enc, tif, dev->memory);
+    if (code >= 0)
+        code = TIFFCheckpointDirectory(tif);
+    if (code >= 0) {
+        process.init_buffer_fn = tiff_band_init;
+        process.free_buffer_fn = tiff_band_free;
+        process.process_fn = tiff_band_process;
+        process.output_fn = tiff_band_output;
+        process.arg = &enc;
+        if (factor > 1)
+            code = gx_downscaler_process_page((gx_device *)dev, &process, factor);
+        else
+            code = dev_proc(dev, process_page)((gx_device *)dev, &process);
+    }
+    if (code >= 0)
+        code = TIFFWriteDirectory(tif);
+    tiff_band_encoder_fin(&enc);
+    return code;
+}
+
+#endif /* TIFF_ENCODE_BANDS */
+
 int
 tiff_print_page(gx_device_printer *dev, TIFF *tif, int min_feature_size)
 {
@@ -436,6 +812,11 @@ tiff_print_page(gx_device_printer *dev, TIFF *tif, int min_feature_size)
     int line_lag = 0;
     int filtered_count;
 
+#ifdef TIFF_ENCODE_BANDS
+    if ((bpc != 1 || min_feature_size <= 1) && tiff_can_encode_bands(dev, tif))
+        return tiff_print_page_bands(dev, tif, 1);
+#endif
+
     data = gs_alloc_bytes(dev->memory, max_size, "tiff_print_page(data)");
     if (data == NULL)
         return_error(gs_error_VMerror);
@@ -525,6 +906,13 @@ tiff_downscale_and_print_page(gx_device_printer *dev, TIFF *tif,
     int height = dev->height/factor;
     gx_downscaler_t ds;
 
+#ifdef TIFF_ENCODE_BANDS
+    if (tfdev->icclink == NULL &&
+        tiff_can_downscale_bands(dev, params, aw, bpc, num_comps) &&
+        tiff_can_encode_bands(dev, tif))
+        return tiff_print_page_bands(dev, tif, factor);
+#endif
+
     code = TIFFCheckpointDirectory(tif);
     if (code < 0)
         return code;
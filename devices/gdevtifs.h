@@ -93,4 +93,72 @@ int tiff_compression_id(uint16_t *id, gs_param_string *param);
  */
 int tiff_compression_allowed(uint16_t compression, byte depth);
 
+/*
+ * Encoding the strips of a page band by band, on the rendering threads
+ * (see gdevtifs.c). A tiff_band_encoder_t is set up for each output file
+ * before the page is rendered; each band then fills the rows of a
+ * tiff_band_strips_t for the file and compresses them on its rendering
+ * thread, and the main thread writes the bands out in page order.
+ */
+#if TIFFLIB_VERSION >= 20191103 /* for TIFFGetStrileOffset */
+#  define TIFF_ENCODE_BANDS
+#endif
+
+#ifdef TIFF_ENCODE_BANDS
+
+#define TIFF_BAND_TAGS 7        /* the tags that affect how a strip is encoded */
+
+typedef struct tiff_band_encoder_s {
+    TIFF *tif;                  /* the output file */
+    gs_memory_t *memory;
+    int height;                 /* of the image, after any downscaling */
+    int rows_per_strip;
+    tmsize_t scanline_size;
+    int bps;                    /* bits per sample */
+    int last_bits;              /* padding bits at the end of a row */
+    /* The encoding fields of tif, read before the threads start. */
+    const char *name;
+    int big_endian;
+    uint32_t width;
+    uint16_t tags[TIFF_BAND_TAGS];
+    bool has_tag[TIFF_BAND_TAGS];
+    float xres, yres;
+    uint32_t fax_options;
+    /* The start of a strip that straddles bands, collected by the main
+     * thread. */
+    byte *pending;
+    int pending_y;
+    int pending_rows;
+} tiff_band_encoder_t;
+
+typedef struct tiff_band_strips_s {
+    gs_memory_t *memory;
+    byte *data;                 /* the band, as packed TIFF scanlines */
+    int y0, y1;                 /* the rows of the image it holds */
+    TIFF *encoded;              /* scratch TIFF holding the whole strips */
+    uint32_t first_strip;
+    uint32_t num_strips;
+} tiff_band_strips_t;
+
+/* Is it worth encoding the strips of this page band by band? */
+bool tiff_can_encode_bands(gx_device_printer *dev, TIFF *tif);
+
+int tiff_band_encoder_init(tiff_band_encoder_t *enc, TIFF *tif, gs_memory_t *mem);
+void tiff_band_encoder_fin(tiff_band_encoder_t *enc);
+
+/* Allocate and free the rows of a band of up to h rows. */
+int tiff_band_strips_alloc(const tiff_band_encoder_t *enc, tiff_band_strips_t *strips,
+                           gs_memory_t *mem, int h);
+void tiff_band_strips_free(tiff_band_strips_t *strips);
+
+/* On a rendering thread, once the h rows of the band beginning at y0 have
+ * been filled in: compress the strips that lie wholly within them. */
+int tiff_band_encode_strips(const tiff_band_encoder_t *enc, tiff_band_strips_t *strips,
+                            int y0, int h);
+
+/* On the main thread, in page order: append the band to the file. */
+int tiff_band_write_strips(tiff_band_encoder_t *enc, const tiff_band_strips_t *strips);
+
+#endif /* TIFF_ENCODE_BANDS */
+
 #endif /* gdevtifs_INCLUDED */
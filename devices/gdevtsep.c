@@ -52,6 +52,7 @@
 #include "gsicc_cache.h"
 #include "gxdevsop.h"
 #include "gsicc.h"
+#include "gxsync.h"
 
 /*
  * Some of the code in this module is based upon the gdevtfnx.c module.
@@ -107,6 +108,10 @@ tiffscaled_spec_op(gx_device *dev_, int op, void *data, int datasize)
     if (op == gxdso_supports_iccpostrender) {
         return true;
     }
+    /* Bands of whole output rows let the rendering threads downscale. */
+    if (op == gxdso_adjust_bandheight)
+        return gx_downscaler_adjust_bandheight(
+                    ((gx_device_tiff *)dev_)->downscale.downscale_factor, datasize);
     return gdev_prn_dev_spec_op(dev_, op, data, datasize);
 }
 
@@ -2046,6 +2051,352 @@ print_cmyk_equivalent_colors(tiffsep_device *tfdev, int num_comp, cmyk_composite
     return 0;
 }
 
+/* ------ Writing the separation files on several threads ------ */
+
+/*
+ * Compressing the separation files can take longer than rendering them.
+ * Each file has its own TIFF, so when NumRenderingThreads is set and the
+ * files are compressed, the separations are shared out among up to that
+ * many threads. The print thread hands the rows over through a ring of
+ * TIFFSEP_QUEUE_ROWS row buffers, and goes on to the CMYK composite.
+ * Every file still gets the same scanlines in the same order, so the
+ * output is the same as writing them one at a time.
+ */
+#define TIFFSEP_QUEUE_ROWS 16
+
+typedef struct tiffsep_sep_writer_s tiffsep_sep_writer_t;
+
+typedef struct tiffsep_sep_worker_s {
+    tiffsep_sep_writer_t *writer;
+    int first_comp, end_comp;   /* the separations it writes */
+    gx_semaphore_t *full;       /* signalled for each row handed over */
+    gx_semaphore_t *free;       /* signalled for each row written */
+    gp_thread_id thread;
+} tiffsep_sep_worker_t;
+
+struct tiffsep_sep_writer_s {
+    gs_memory_t *memory;
+    tiffsep_device *tfdev;
+    int num_comp;
+    int byte_width;
+    byte *rows;                 /* num_comp rows for each slot */
+    int slot_y[TIFFSEP_QUEUE_ROWS]; /* the row in each slot, or -1 to stop */
+    int next;                   /* the next slot to fill */
+    int num_workers;
+    tiffsep_sep_worker_t workers[GX_DEVICE_COLOR_MAX_COMPONENTS];
+};
+
+static void
+tiffsep_sep_thread(void *arg)
+{
+    tiffsep_sep_worker_t *w = (tiffsep_sep_worker_t *)arg;
+    tiffsep_sep_writer_t *sw = w->writer;
+    int slot = 0;
+
+    for (;;) {
+        byte *row;
+        int y, comp_num;
+
+        gx_semaphore_wait(w->full);
+        y = sw->slot_y[slot];
+        if (y < 0)
+            break;
+        row = sw->rows + (size_t)slot * sw->num_comp * sw->byte_width;
+        for (comp_num = w->first_comp; comp_num < w->end_comp; comp_num++)
+            TIFFWriteScanline(sw->tfdev->tiff[comp_num],
+                              (tdata_t)(row + (size_t)comp_num * sw->byte_width), y, 0);
+        gx_semaphore_signal(w->free);
+        slot = (slot + 1) % TIFFSEP_QUEUE_ROWS;
+    }
+}
+
+/* Wait until every worker has written the next slot, and return it. */
+static byte *
+tiffsep_sep_writer_next(tiffsep_sep_writer_t *sw)
+{
+    int i;
+
+    for (i = 0; i < sw->num_workers; i++)
+        gx_semaphore_wait(sw->workers[i].free);
+    return sw->rows + (size_t)sw->next * sw->num_comp * sw->byte_width;
+}
+
+/* Hand the slot returned by tiffsep_sep_writer_next over to the workers. */
+static void
+tiffsep_sep_writer_post(tiffsep_sep_writer_t *sw, int y)
+{
+    int i;
+
+    sw->slot_y[sw->next] = y;
+    sw->next = (sw->next + 1) % TIFFSEP_QUEUE_ROWS;
+    for (i = 0; i < sw->num_workers; i++)
+        gx_semaphore_signal(sw->workers[i].full);
+}
+
+/* Wait for the workers to write out the rows handed to them, and free
+ * the writer. */
+static void
+tiffsep_sep_writer_finish(tiffsep_sep_writer_t *sw)
+{
+    int i;
+
+    if (sw->num_workers > 0) {
+        tiffsep_sep_writer_next(sw);
+        tiffsep_sep_writer_post(sw, -1);
+    }
+    for (i = 0; i < sw->num_workers; i++)
+        gp_thread_finish(sw->workers[i].thread);
+    for (i = 0; i < GX_DEVICE_COLOR_MAX_COMPONENTS; i++) {
+        if (sw->workers[i].full != NULL)
+            gx_semaphore_free(sw->workers[i].full);
+        if (sw->workers[i].free != NULL)
+            gx_semaphore_free(sw->workers[i].free);
+    }
+    gs_free_object(sw->memory, sw->rows, "tiffsep_sep_writer_finish(rows)");
+    gs_free_object(sw->memory, sw, "tiffsep_sep_writer_finish");
+}
+
+/*
+ * Start the threads writing the separation files, once their directories
+ * have been set up. *psw is left NULL if the files should be written by
+ * the print thread, as they are without compression, since then there is
+ * little to share out.
+ */
+static int
+tiffsep_sep_writer_start(tiffsep_device *tfdev, int num_comp, int byte_width,
+                         tiffsep_sep_writer_t **psw)
+{
+    gs_memory_t *mem = tfdev->memory->non_gc_memory;
+    int num_workers = min(tfdev->num_render_threads_requested, num_comp);
+    tiffsep_sep_writer_t *sw;
+    int i, j;
+
+    *psw = NULL;
+    if (num_workers < 1 || tfdev->NoSeparationFiles ||
+        tfdev->Compression == COMPRESSION_NONE)
+        return 0;
+    sw = (tiffsep_sep_writer_t *)gs_alloc_bytes(mem, sizeof(*sw),
+                                                "tiffsep_sep_writer_start");
+    if (sw == NULL)
+        return_error(gs_error_VMerror);
+    memset(sw, 0, sizeof(*sw));
+    sw->memory = mem;
+    sw->tfdev = tfdev;
+    sw->num_comp = num_comp;
+    sw->byte_width = byte_width;
+    sw->rows = gs_alloc_bytes(mem, (size_t)TIFFSEP_QUEUE_ROWS * num_comp * byte_width,
+                              "tiffsep_sep_writer_start(rows)");
+    if (sw->rows == NULL)
+        goto fail;
+    for (i = 0; i < num_workers; i++) {
+        tiffsep_sep_worker_t *w = &sw->workers[i];
+
+        w->writer = sw;
+        w->first_comp = num_comp * i / num_workers;
+        w->end_comp = num_comp * (i + 1) / num_workers;
+        w->full = gx_semaphore_label(gx_semaphore_alloc(mem), "tiffsep full");
+        w->free = gx_semaphore_label(gx_semaphore_alloc(mem), "tiffsep free");
+        if (w->full == NULL || w->free == NULL)
+            goto fail;
+        for (j = 0; j < TIFFSEP_QUEUE_ROWS; j++)
+            gx_semaphore_signal(w->free);
+    }
+    for (i = 0; i < num_workers; i++) {
+        if (gp_thread_start(tiffsep_sep_thread, &sw->workers[i],
+                            &sw->workers[i].thread) < 0) {
+            /* Stop the threads already started, and write serially. */
+            sw->num_workers = i;
+            tiffsep_sep_writer_finish(sw);
+            return 0;
+        }
+        gp_thread_label(sw->workers[i].thread, "tiffsep writer");
+        sw->num_workers = i + 1;
+    }
+    *psw = sw;
+    return 0;
+
+fail:
+    tiffsep_sep_writer_finish(sw);
+    return_error(gs_error_VMerror);
+}
+
+#ifdef TIFF_ENCODE_BANDS
+
+/* ------ Encoding the separations band by band ------ */
+
+/*
+ * With NumRenderingThreads, each rendering thread builds the separation
+ * and composite rows of its own band and compresses the strips that lie
+ * wholly within it, as tiff_print_page does (see gdevtifs.c). This needs
+ * 8 bit output straight from the rendered planes: no downscaling,
+ * trapping, deskewing or post render profile, and no SeparationOrder, for
+ * which the serial path below lays out the planes itself.
+ */
+typedef struct tiffsep_band_arg_s {
+    tiffsep_device *tfdev;
+    int num_comp;
+    cmyk_composite_map *cmyk_map;
+    int num_seps;               /* separation files; then the composite */
+    tiff_band_encoder_t enc[GX_DEVICE_COLOR_MAX_COMPONENTS + 1];
+} tiffsep_band_arg_t;
+
+typedef struct tiffsep_band_buffer_s {
+    tiff_band_strips_t strips[GX_DEVICE_COLOR_MAX_COMPONENTS + 1];
+} tiffsep_band_buffer_t;
+
+static bool
+tiffsep_can_encode_bands(tiffsep_device *tfdev, int dst_bpc)
+{
+    const gx_downscaler_params *ds = &tfdev->downscale;
+
+    return dst_bpc == 8 && tfdev->devn_params.num_separation_order_names == 0 &&
+           tfdev->color_info.depth == 8 * tfdev->color_info.num_components &&
+           ds->downscale_factor <= 1 && ds->trap_w == 0 && ds->trap_h == 0 &&
+           !ds->do_skew_detection && tfdev->icclink == NULL &&
+           tiff_can_encode_bands((gx_device_printer *)tfdev, tfdev->tiff_comp);
+}
+
+static void
+tiffsep_band_free(void *arg_, gx_device *dev, gs_memory_t *memory, void *buffer_)
+{
+    tiffsep_band_arg_t *arg = (tiffsep_band_arg_t *)arg_;
+    tiffsep_band_buffer_t *buffer = (tiffsep_band_buffer_t *)buffer_;
+    int i;
+
+    if (buffer == NULL)
+        return;
+    for (i = 0; i <= arg->num_seps; i++)
+        tiff_band_strips_free(&buffer->strips[i]);
+    gs_free_object(memory, buffer, "tiffsep_band_free");
+}
+
+static int
+tiffsep_band_init(void *arg_, gx_device *dev, gs_memory_t *memory, int w, int h, void **pbuffer)
+{
+    tiffsep_band_arg_t *arg = (tiffsep_band_arg_t *)arg_;
+    tiffsep_band_buffer_t *buffer;
+    int i, code = 0;
+
+    buffer = (tiffsep_band_buffer_t *)gs_alloc_bytes(memory, sizeof(*buffer),
+                                                     "tiffsep_band_init");
+    if (buffer == NULL)
+        return_error(gs_error_VMerror);
+    memset(buffer, 0, sizeof(*buffer));
+    for (i = 0; i <= arg->num_seps && code >= 0; i++)
+        code = tiff_band_strips_alloc(&arg->enc[i], &buffer->strips[i], memory, h);
+    if (code < 0) {
+        tiffsep_band_free(arg_, dev, memory, buffer);
+        return code;
+    }
+    *pbuffer = buffer;
+    return 0;
+}
+
+/* Runs on the rendering thread: build the rows of each file for the band,
+ * and compress the strips that lie wholly within it. */
+static int
+tiffsep_band_process(void *arg_, gx_device *dev, gx_device *bdev, const gs_int_rect *rect, void *buffer_)
+{
+    tiffsep_band_arg_t *arg = (tiffsep_band_arg_t *)arg_;
+    tiffsep_band_buffer_t *buffer = (tiffsep_band_buffer_t *)buffer_;
+    tiffsep_device *tfdev = arg->tfdev;
+    int width = rect->q.x - rect->p.x;
+    int h = rect->q.y - rect->p.y;
+    gs_int_rect row_rect;
+    gs_get_bits_params_t row;
+    int y, i, comp_num, pixel, code;
+
+    row_rect.p.x = 0;
+    row_rect.q.x = width;
+    for (y = 0; y < h; y++) {
+        /* A row at a time, so nothing depends on how the planes are laid out. */
+        row_rect.p.y = y;
+        row_rect.q.y = y + 1;
+        row.options = GB_COLORS_NATIVE | GB_ALPHA_NONE | GB_PACKING_PLANAR |
+                      GB_RETURN_POINTER | GB_ALIGN_ANY | GB_OFFSET_0 |
+                      GB_RASTER_ANY;
+        code = dev_proc(bdev, get_bits_rectangle)(bdev, &row_rect, &row);
+        if (code < 0)
+            return code;
+        /* Separation data (tiffgray format) */
+        for (comp_num = 0; comp_num < arg->num_seps; comp_num++) {
+            const byte *src = row.data[comp_num];
+            byte *dest = buffer->strips[comp_num].data +
+                            (size_t)y * arg->enc[comp_num].scanline_size;
+
+            for (pixel = 0; pixel < width; pixel++)
+                dest[pixel] = MAX_COLOR_VALUE - src[pixel];    /* Gray is additive */
+        }
+        /* CMYK equivalent data */
+        build_cmyk_raster_line_fromplanar(&row,
+                buffer->strips[arg->num_seps].data +
+                    (size_t)y * arg->enc[arg->num_seps].scanline_size,
+                width, arg->num_comp, arg->cmyk_map, 0, tfdev);
+    }
+    for (i = 0; i <= arg->num_seps; i++) {
+        code = tiff_band_encode_strips(&arg->enc[i], &buffer->strips[i], rect->p.y, h);
+        if (code < 0)
+            return code;
+    }
+    return 0;
+}
+
+/* Runs on the main thread, in page order: append the band to each file. */
+static int
+tiffsep_band_output(void *arg_, gx_device *dev, void *buffer_)
+{
+    tiffsep_band_arg_t *arg = (tiffsep_band_arg_t *)arg_;
+    tiffsep_band_buffer_t *buffer = (tiffsep_band_buffer_t *)buffer_;
+    int i, code;
+
+    for (i = 0; i <= arg->num_seps; i++) {
+        code = tiff_band_write_strips(&arg->enc[i], &buffer->strips[i]);
+        if (code < 0)
+            return code;
+    }
+    return 0;
+}
+
+static int
+tiffsep_print_page_bands(tiffsep_device *tfdev, int num_comp,
+                         cmyk_composite_map *cmyk_map)
+{
+    gs_memory_t *mem = tfdev->memory->non_gc_memory;
+    tiffsep_band_arg_t *arg;
+    gx_process_page_options_t process = { 0 };
+    int i, num_enc = 0, code = 0;
+
+    arg = (tiffsep_band_arg_t *)gs_alloc_bytes(mem, sizeof(*arg),
+                                               "tiffsep_print_page_bands");
+    if (arg == NULL)
+        return_error(gs_error_VMerror);
+    arg->tfdev = tfdev;
+    arg->num_comp = num_comp;
+    arg->cmyk_map = cmyk_map;
+    arg->num_seps = (tfdev->NoSeparationFiles ? 0 : num_comp);
+    for (i = 0; i <= arg->num_seps && code >= 0; i++, num_enc++) {
+        TIFF *tif = (i < arg->num_seps ? tfdev->tiff[i] : tfdev->tiff_comp);
+
+        code = tiff_band_encoder_init(&arg->enc[i], tif, mem);
+        if (code >= 0)
+            code = TIFFCheckpointDirectory(tif);
+    }
+    if (code >= 0) {
+        process.init_buffer_fn = tiffsep_band_init;
+        process.free_buffer_fn = tiffsep_band_free;
+        process.process_fn = tiffsep_band_process;
+        process.output_fn = tiffsep_band_output;
+        process.arg = arg;
+        code = dev_proc(tfdev, process_page)((gx_device *)tfdev, &process);
+    }
+    for (i = 0; i < num_enc; i++)
+        tiff_band_encoder_fin(&arg->enc[i]);
+    gs_free_object(mem, arg, "tiffsep_print_page_bands");
+    return code;
+}
+
+#endif /* TIFF_ENCODE_BANDS */
+
 /*
  * Output the image data for the tiff separation (tiffsep) device.  The data
  * for the tiffsep device is written in separate planes to separate files.
@@ -2217,7 +2568,14 @@ tiffsep_print_page(gx_device_printer * pdev, gp_file * file)
         byte * sep_line;
         int plane_index;
         int offset_plane = 0;
+        tiffsep_sep_writer_t *sw = NULL;
 
+#ifdef TIFF_ENCODE_BANDS
+        if (tiffsep_can_encode_bands(tfdev, dst_bpc)) {
+            code = tiffsep_print_page_bands(tfdev, num_comp, cmyk_map);
+            goto write_directories;
+        }
+#endif
         sep_line =
             gs_alloc_bytes(pdev->memory, cmyk_raster, "tiffsep_print_page");
         if (!sep_line) {
@@ -2306,15 +2664,21 @@ tiffsep_print_page(gx_device_printer * pdev, gp_file * file)
             if (code < 0)
                 goto cleanup;
             byte_width = (width * dst_bpc + 7)>>3;
+            code = tiffsep_sep_writer_start(tfdev, num_comp, byte_width, &sw);
+            if (code < 0)
+                goto cleanup;
             for (y = 0; y < height; ++y) {
                 code = gx_downscaler_get_bits_rectangle(&ds, &params, y);
                 if (code < 0)
                     goto cleanup;
                 /* Write separation data (tiffgray format) */
                 if (!tfdev->NoSeparationFiles) {
+                    byte *sep_rows = (sw != NULL ? tiffsep_sep_writer_next(sw) : NULL);
+
                     for (comp_num = 0; comp_num < num_comp; comp_num++) {
                         byte *src;
-                        byte *dest = sep_line;
+                        byte *dest = (sep_rows != NULL ?
+                                      sep_rows + (size_t)comp_num * byte_width : sep_line);
 
                         if (num_order > 0) {
                             src = params.data[tfdev->devn_params.separation_order_map[comp_num]];
@@ -2323,8 +2687,11 @@ tiffsep_print_page(gx_device_printer * pdev, gp_file * file)
                             src = params.data[comp_num];
                         for (pixel = 0; pixel < byte_width; pixel++, dest++, src++)
                             *dest = MAX_COLOR_VALUE - *src;    /* Gray is additive */
-                        TIFFWriteScanline(tfdev->tiff[comp_num], (tdata_t)sep_line, y, 0);
+                        if (sep_rows == NULL)
+                            TIFFWriteScanline(tfdev->tiff[comp_num], (tdata_t)sep_line, y, 0);
                     }
+                    if (sep_rows != NULL)
+                        tiffsep_sep_writer_post(sw, y);
                 }
                 /* Write CMYK equivalent data */
                 switch(dst_bpc)
@@ -2354,6 +2721,8 @@ tiffsep_print_page(gx_device_printer * pdev, gp_file * file)
                 TIFFWriteScanline(tfdev->tiff_comp, (tdata_t)sep_line, y, 0);
             }
 cleanup:
+            if (sw != NULL)
+                tiffsep_sep_writer_finish(sw);
             if (num_order > 0) {
                 /* Free up the standard colorants if num_order was set.
                    In this process, we need to make sure that none of them
@@ -2373,6 +2742,9 @@ cleanup:
             gx_downscaler_fin(&ds);
             gs_free_object(pdev->memory, sep_line, "tiffsep_print_page");
         }
+#ifdef TIFF_ENCODE_BANDS
+write_directories:
+#endif
         code1 = code;
         if (!tfdev->NoSeparationFiles) {
             for (comp_num = 0; comp_num < num_comp; comp_num++) {
@@ -70,6 +70,9 @@ ENUM_PTRS_WITH(device_pdfwrite_enum_ptrs, gx_device_pdf *pdev)
     if (index < NUM_RESOURCE_TYPES * NUM_RESOURCE_CHAINS)
         ENUM_RETURN(pdev->resources[index / NUM_RESOURCE_CHAINS].chains[index % NUM_RESOURCE_CHAINS]);
     index -= NUM_RESOURCE_TYPES * NUM_RESOURCE_CHAINS;
+    if (index < 1)
+        ENUM_RETURN(pdev->resource_index);
+    index -= 1;
     if (index <= pdev->outline_depth && pdev->outline_levels)
         ENUM_RETURN(pdev->outline_levels[index].first.action);
     index -= pdev->outline_depth + 1;
@@ -192,6 +195,7 @@ static RELOC_PTRS_WITH(device_pdfwrite_reloc_ptrs, gx_device_pdf *pdev)
         for (i = 0; i < NUM_RESOURCE_TYPES; ++i)
             for (j = 0; j < NUM_RESOURCE_CHAINS; ++j)
                 RELOC_PTR(gx_device_pdf, resources[i].chains[j]);
+        RELOC_PTR(gx_device_pdf, resource_index);
         if (pdev->outline_levels) {
             for (i = 0; i <= pdev->outline_depth; ++i) {
                 RELOC_PTR(gx_device_pdf, outline_levels[i].first.action);
@@ -881,6 +885,9 @@ pdf_open(gx_device * dev)
             for (j = 0; j < NUM_RESOURCE_CHAINS; ++j)
                 pdev->resources[i].chains[j] = 0;
     }
+    code = pdf_alloc_resource_index(pdev);
+    if (code < 0)
+        goto fail;
     pdev->outline_levels = (pdf_outline_level_t *)gs_alloc_bytes(mem, INITIAL_MAX_OUTLINE_DEPTH * sizeof(pdf_outline_level_t), "outline_levels array");
     memset(pdev->outline_levels, 0x00, INITIAL_MAX_OUTLINE_DEPTH * sizeof(pdf_outline_level_t));
     pdev->max_outline_depth = INITIAL_MAX_OUTLINE_DEPTH;
@@ -3258,6 +3265,8 @@ error_cleanup:
      * specifically altered to remove the reference to the metadata from the resourceOther resource chain immediately
      * after it has been created. Ick.....
      */
+    /* The digest index must go first; the resources it links are freed below. */
+    pdf_free_resource_index(pdev);
     {
         int j;
 
@@ -133,6 +133,7 @@ const gx_device_pdf PDF_DEVICE_IDENT =
  {
      {
          {0}}},	/* resources */
+ 0,				/* resource_index */
  {0},			/* cs_Patterns */
  {0},			/* Identity_ToUnicode_CMaps */
  0,				/* last_resource */
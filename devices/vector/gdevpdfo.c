@@ -171,6 +171,7 @@ cos_object_init(cos_object_t *pco, gx_device_pdf *pdev,
         pco->pieces = 0;
         pco->mem = pdev->pdf_memory;
         pco->pres = 0;
+        pco->digest_pres = 0;
         pco->is_open = true;
         pco->is_graphics = false;
         pco->written = false;
@@ -182,6 +183,18 @@ cos_object_init(cos_object_t *pco, gx_device_pdf *pdev,
     }
 }
 
+/*
+ * Note that a Cos object has been modified. Its hash is no longer valid,
+ * and if a resource was indexed by its digest, that entry is stale too.
+ */
+static void
+cos_object_modified(cos_object_t *pco)
+{
+    pco->md5_valid = false;
+    if (pco->digest_pres != NULL)
+        pdf_resource_modified(pco->digest_pres);
+}
+
 /* Get the allocator for a Cos object. */
 gs_memory_t *
 cos_object_memory(const cos_object_t *pco)
@@ -639,7 +652,7 @@ cos_array_put(cos_array_t *pca, long index, const cos_value_t *pvalue)
         if (code < 0)
             cos_uncopy_element_value(&value, mem, true);
     }
-    pca->md5_valid = false;
+    cos_object_modified((cos_object_t *)pca);
     return code;
 }
 int
@@ -668,7 +681,7 @@ cos_array_put_no_copy(cos_array_t *pca, long index, const cos_value_t *pvalue)
         *ppcae = pcae;
     }
     pcae->value = *pvalue;
-    pca->md5_valid = false;
+    cos_object_modified((cos_object_t *)pca);
     return 0;
 }
 static long
@@ -679,13 +692,13 @@ cos_array_next_index(const cos_array_t *pca)
 int
 cos_array_add(cos_array_t *pca, const cos_value_t *pvalue)
 {
-    pca->md5_valid = false;
+    cos_object_modified((cos_object_t *)pca);
     return cos_array_put(pca, cos_array_next_index(pca), pvalue);
 }
 int
 cos_array_add_no_copy(cos_array_t *pca, const cos_value_t *pvalue)
 {
-    pca->md5_valid = false;
+    cos_object_modified((cos_object_t *)pca);
     return cos_array_put_no_copy(pca, cos_array_next_index(pca), pvalue);
 }
 int
@@ -742,7 +755,7 @@ cos_array_unadd(cos_array_t *pca, cos_value_t *pvalue)
     *pvalue = pcae->value;
     pca->elements = pcae->next;
     gs_free_object(COS_OBJECT_MEMORY(pca), pcae, "cos_array_unadd");
-    pca->md5_valid = false;
+    cos_object_modified((cos_object_t *)pca);
     return 0;
 }
 
@@ -825,6 +838,7 @@ cos_dict_delete(cos_dict_t *pcd, const byte *key_data, uint key_size)
             else
                 pcd->elements = pcde->next;
             cos_dict_element_free(pcd, pcde, "cos_dict_delete");
+            cos_object_modified((cos_object_t *)pcd);
             return 0;
         }
         prev = pcde;
@@ -1344,7 +1358,7 @@ cos_dict_put_copy(cos_dict_t *pcd, const byte *key_data, uint key_size,
         *ppcde = pcde;
     }
     pcde->value = value;
-    pcd->md5_valid = false;
+    cos_object_modified((cos_object_t *)pcd);
     return 0;
 }
 int
@@ -1467,7 +1481,8 @@ cos_dict_move_all(cos_dict_t *pcdto, cos_dict_t *pcdfrom)
     }
     pcdto->elements = head;
     pcdfrom->elements = 0;
-    pcdto->md5_valid = false;
+    cos_object_modified((cos_object_t *)pcdto);
+    cos_object_modified((cos_object_t *)pcdfrom);
     return 0;
 }
 
@@ -1785,6 +1800,44 @@ cos_stream_equal(const cos_object_t *pco0, const cos_object_t *pco1, gx_device_p
     return true;
 }
 
+/* Get a digest of the contents of an array, dictionary or stream. */
+int
+cos_object_digest(const cos_object_t *pco, gx_device_pdf *pdev, uint *pdigest)
+{
+    uint digest = 0;
+    int code, i;
+
+    if (cos_type(pco) == cos_type_stream) {
+        if (!pco->stream_md5_valid || !pco->md5_valid) {
+            gs_md5_state_t md5;
+            gs_md5_byte_t hash[16];
+
+            /* As for cos_stream_equal, a stream we can't hash is never equal to anything */
+            gs_md5_init(&md5);
+            code = cos_stream_hash(pco, &md5, hash, pdev);
+            if (code < 0)
+                return 1;
+        }
+        for (i = 0; i < sizeof(digest); i++)
+            digest = (digest << 8) | pco->stream_hash[i];
+    } else if (cos_type(pco) == cos_type_dict || cos_type(pco) == cos_type_array) {
+        if (!pco->md5_valid) {
+            gs_md5_init((gs_md5_state_t *)&pco->md5);
+            code = pco->cos_procs->hash(pco, (gs_md5_state_t *)&pco->md5, (gs_md5_byte_t *)pco->hash, pdev);
+            if (code < 0)
+                return code;
+            gs_md5_finish((gs_md5_state_t *)&pco->md5, (gs_md5_byte_t *)pco->hash);
+            ((cos_object_t *)pco)->md5_valid = true;
+        }
+    } else
+        return 1;
+
+    for (i = 0; i < sizeof(digest); i++)
+        digest ^= (uint)pco->hash[i] << (8 * (sizeof(digest) - 1 - i));
+    *pdigest = digest;
+    return 0;
+}
+
 /* Find the total length of a stream. */
 long
 cos_stream_length(const cos_stream_t *pcs)
@@ -1916,6 +1969,8 @@ cos_stream_add(gx_device_pdf *pdev, cos_stream_t *pcs, uint size)
         pcs->pieces = pcsp;
     }
     pcs->length += size;
+    if (pcs->digest_pres != NULL)
+        pdf_resource_modified(pcs->digest_pres);
     return 0;
 }
 
@@ -111,6 +111,7 @@ struct otype_s {\
     cos_stream_piece_t *pieces;\
     gs_memory_t *mem;\
     pdf_resource_t *pres;	/* only for BP/EP XObjects */\
+    pdf_resource_t *digest_pres; /* resource indexed by this object's digest */\
     byte is_open;		/* see above */\
     byte is_graphics;		/* see above */\
     byte written;		/* see above */\
@@ -126,9 +127,9 @@ struct otype_s {\
 }
 cos_object_struct(cos_object_s, cos_element_t);
 #define private_st_cos_object()	/* in gdevpdfo.c */\
-  gs_private_st_ptrs4(st_cos_object, cos_object_t, "cos_object_t",\
+  gs_private_st_ptrs5(st_cos_object, cos_object_t, "cos_object_t",\
     cos_object_enum_ptrs, cos_object_reloc_ptrs, elements, pieces,\
-    pres, input_strm)
+    pres, input_strm, digest_pres)
 extern const cos_object_procs_t cos_generic_procs;
 #define cos_type_generic (&cos_generic_procs)
 
@@ -225,6 +226,12 @@ cos_proc_write(cos_write);
 int cos_write_dict_as_ordered_array(cos_object_t *pco, gx_device_pdf *pdev, pdf_resource_type_t type);
 #define COS_WRITE(pc, pdev) cos_write(CONST_COS_OBJECT(pc), pdev, (pc)->id)
 
+/* Get a digest of the contents of an array, dictionary or stream. Objects
+ * which are equal according to their 'equal' procedure have the same
+ * digest. Returns 1 for other types of object.
+ */
+int cos_object_digest(const cos_object_t *pco, gx_device_pdf *pdev, uint *pdigest);
+
 /* Make a value to store into a composite object. */
 const cos_value_t *cos_string_value(cos_value_t *, const byte *, uint);
 const cos_value_t *cos_c_string_value(cos_value_t *, const char *);
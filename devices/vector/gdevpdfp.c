@@ -42,8 +42,16 @@ static int pdf_dsc_process(gx_device_pdf * pdev,
                             const gs_param_string_array * pma);
 
 static const int CoreDistVersion = 5000;	/* Distiller 5.0 */
+/*
+ * The offsets in a gs_param_item_t are shorts, and gx_device_pdf is only
+ * just small enough for that, so refuse to compile if a parameter moves
+ * out of reach rather than let its offset wrap.
+ */
+#define pdf_param_offset(memb)\
+  (offset_of(gx_device_pdf, memb) +\
+   0 * sizeof(char[offset_of(gx_device_pdf, memb) <= max_short ? 1 : -1]))
 static const gs_param_item_t pdf_param_items[] = {
-#define pi(key, type, memb) { key, type, offset_of(gx_device_pdf, memb) }
+#define pi(key, type, memb) { key, type, pdf_param_offset(memb) }
 
         /* Acrobat Distiller 4 parameters */
 
@@ -135,6 +143,7 @@ static const gs_param_item_t pdf_param_items[] = {
     pi("ModifiesPageSize", gs_param_type_bool, ModifiesPageSize),
     pi("ModifiesPageOrder", gs_param_type_bool, ModifiesPageOrder),
 #undef pi
+#undef pdf_param_offset
     gs_param_item_end
 };
 
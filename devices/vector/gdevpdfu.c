@@ -75,6 +75,17 @@ extern_st(st_pdf_font_resource);
 extern_st(st_pdf_char_proc);
 extern_st(st_pdf_font_descriptor);
 public_st_pdf_resource();
+private_st_pdf_resource_index();
+gs_private_st_ptr(st_pdf_resource_index_ptr, pdf_resource_index_t *, "pdf_resource_index_t *",
+                  pdf_resource_index_ptr_enum_ptrs, pdf_resource_index_ptr_reloc_ptrs);
+gs_private_st_element(st_pdf_resource_index_ptr_element, pdf_resource_index_t *,
+                      "pdf_resource_index_t *[]", pdf_resource_index_ptr_element_enum_ptrs,
+                      pdf_resource_index_ptr_element_reloc_ptrs, st_pdf_resource_index_ptr);
+gs_private_st_ptr(st_pdf_resource_ptr, pdf_resource_t *, "pdf_resource_t *",
+                  pdf_resource_ptr_enum_ptrs, pdf_resource_ptr_reloc_ptrs);
+gs_private_st_element(st_pdf_resource_ptr_element, pdf_resource_t *,
+                      "pdf_resource_t *[]", pdf_resource_ptr_element_enum_ptrs,
+                      pdf_resource_ptr_element_reloc_ptrs, st_pdf_resource_ptr);
 private_st_pdf_x_object();
 private_st_pdf_pattern();
 
@@ -1284,6 +1295,8 @@ pdf_forget_resource(gx_device_pdf * pdev, pdf_resource_t *pres1, pdf_resource_ty
         }
     }
 
+    pdf_unindex_resource(pdev, pres1, rtype);
+
     for (; (pres = *pprev) != 0; pprev = &pres->prev)
         if (pres == pres1) {
             *pprev = pres->prev;
@@ -1388,9 +1401,180 @@ pdf_find_resource_by_resource_id(gx_device_pdf * pdev, pdf_resource_type_t rtype
     return 0;
 }
 
-/* Find same resource. */
+/* Link a resource at the head of a digest list. */
+static void
+pdf_link_digest(pdf_resource_t **plist, pdf_resource_t *pres)
+{
+    pres->digest_prev = NULL;
+    pres->digest_next = *plist;
+    if (*plist != NULL)
+        (*plist)->digest_prev = pres;
+    *plist = pres;
+}
+
+/* Add a resource just linked into a resource chain to the digest index. */
+void
+pdf_list_resource(gx_device_pdf * pdev, pdf_resource_t *pres, pdf_resource_type_t rtype)
+{
+    if (pdev->resource_index == NULL || pres->digest_listed)
+        return;
+    pres->digest_index = pdev->resource_index[rtype];
+    pdf_link_digest(&pres->digest_index->unindexed, pres);
+    pres->digest_listed = true;
+    pres->digest_indexed = false;
+}
+
+/* Take a resource out of its digest chain, leaving it unlinked. */
+static void
+pdf_unlink_digest(pdf_resource_t *pres)
+{
+    pdf_resource_index_t *pindex = pres->digest_index;
+
+    if (pres->digest_prev != NULL)
+        pres->digest_prev->digest_next = pres->digest_next;
+    else if (pres->digest_indexed)
+        pindex->chains[pres->digest_key & (pindex->num_chains - 1)] = pres->digest_next;
+    else
+        pindex->unindexed = pres->digest_next;
+    if (pres->digest_next != NULL)
+        pres->digest_next->digest_prev = pres->digest_prev;
+    if (pres->digest_indexed) {
+        pindex->num_indexed--;
+        if (pres->object != NULL && pres->object->digest_pres == pres)
+            pres->object->digest_pres = NULL;
+    }
+    pres->digest_next = pres->digest_prev = NULL;
+    pres->digest_indexed = false;
+}
+
+/* Remove a resource from the digest index. */
+void
+pdf_unindex_resource(gx_device_pdf * pdev, pdf_resource_t *pres, pdf_resource_type_t rtype)
+{
+    if (!pres->digest_listed)
+        return;
+    pdf_unlink_digest(pres);
+    pres->digest_index = NULL;
+    pres->digest_listed = false;
+}
+
+/* The object of an indexed resource was modified, so its digest is stale. */
+/* Put it back on the unindexed list; it is indexed again if it goes      */
+/* through pdf_find_same_resource again.                                  */
+void
+pdf_resource_modified(pdf_resource_t *pres)
+{
+    if (pres == NULL || !pres->digest_indexed)
+        return;
+    pdf_unlink_digest(pres);
+    pdf_link_digest(&pres->digest_index->unindexed, pres);
+}
+
+/* Add a resource to the digest index, growing the index if needed. */
+static int
+pdf_index_resource(gx_device_pdf * pdev, pdf_resource_t *pres, pdf_resource_type_t rtype,
+                   uint digest)
+{
+    pdf_resource_index_t *pindex = pdev->resource_index[rtype];
+    pdf_resource_t **chains;
+    uint i, n;
+
+    /* Resources which aren't in a resource chain aren't indexed either. */
+    if (!pres->digest_listed)
+        return 0;
+    if (pindex->chains == NULL || pindex->num_indexed >= pindex->num_chains) {
+        n = (pindex->chains == NULL ? INITIAL_DIGEST_CHAINS : pindex->num_chains * 2);
+        chains = gs_alloc_struct_array(pdev->pdf_memory, n, pdf_resource_t *,
+                                       &st_pdf_resource_ptr_element,
+                                       "pdf_index_resource");
+        if (chains == NULL)
+            return_error(gs_error_VMerror);
+        memset(chains, 0, n * sizeof(*chains));
+        if (pindex->chains != NULL) {
+            /* Rehash the existing entries into the larger table. */
+            for (i = 0; i < pindex->num_chains; i++) {
+                pdf_resource_t *p = pindex->chains[i], *next;
+
+                for (; p != NULL; p = next) {
+                    next = p->digest_next;
+                    pdf_link_digest(&chains[p->digest_key & (n - 1)], p);
+                }
+            }
+            gs_free_object(pdev->pdf_memory, pindex->chains, "pdf_index_resource");
+        }
+        pindex->chains = chains;
+        pindex->num_chains = n;
+    }
+    pdf_unlink_digest(pres);
+    pres->digest_key = digest;
+    pdf_link_digest(&pindex->chains[digest & (pindex->num_chains - 1)], pres);
+    pres->digest_indexed = true;
+    pindex->num_indexed++;
+    /* Let the object tell us if it changes (see pdf_resource_modified). */
+    pres->object->digest_pres = pres;
+    return 0;
+}
+
+/* Allocate the digest index of every resource type. */
 int
-pdf_find_same_resource(gx_device_pdf * pdev, pdf_resource_type_t rtype, pdf_resource_t **ppres,
+pdf_alloc_resource_index(gx_device_pdf * pdev)
+{
+    int i;
+
+    pdev->resource_index = gs_alloc_struct_array(pdev->pdf_memory, NUM_RESOURCE_TYPES,
+                                                 pdf_resource_index_t *,
+                                                 &st_pdf_resource_index_ptr_element,
+                                                 "pdf_alloc_resource_index");
+    if (pdev->resource_index == NULL)
+        return_error(gs_error_VMerror);
+    memset(pdev->resource_index, 0, NUM_RESOURCE_TYPES * sizeof(pdf_resource_index_t *));
+    for (i = 0; i < NUM_RESOURCE_TYPES; i++) {
+        pdev->resource_index[i] = gs_alloc_struct(pdev->pdf_memory, pdf_resource_index_t,
+                                                  &st_pdf_resource_index,
+                                                  "pdf_alloc_resource_index");
+        if (pdev->resource_index[i] == NULL) {
+            pdf_free_resource_index(pdev);
+            return_error(gs_error_VMerror);
+        }
+        memset(pdev->resource_index[i], 0, sizeof(pdf_resource_index_t));
+    }
+    return 0;
+}
+
+/* Free the digest index of every resource type. */
+void
+pdf_free_resource_index(gx_device_pdf * pdev)
+{
+    pdf_resource_t *pres;
+    int i, j;
+
+    if (pdev->resource_index == NULL)
+        return;
+    for (i = 0; i < NUM_RESOURCE_TYPES; i++) {
+        for (j = 0; j < NUM_RESOURCE_CHAINS; j++)
+            for (pres = pdev->resources[i].chains[j]; pres != NULL; pres = pres->next) {
+                if (pres->digest_indexed && pres->object != NULL &&
+                    pres->object->digest_pres == pres)
+                    pres->object->digest_pres = NULL;
+                pres->digest_next = pres->digest_prev = NULL;
+                pres->digest_index = NULL;
+                pres->digest_listed = false;
+                pres->digest_indexed = false;
+            }
+        if (pdev->resource_index[i] != NULL) {
+            gs_free_object(pdev->pdf_memory, pdev->resource_index[i]->chains,
+                           "pdf_free_resource_index");
+            gs_free_object(pdev->pdf_memory, pdev->resource_index[i],
+                           "pdf_free_resource_index");
+        }
+    }
+    gs_free_object(pdev->pdf_memory, pdev->resource_index, "pdf_free_resource_index");
+    pdev->resource_index = NULL;
+}
+
+/* Find same resource by scanning every resource of the type. */
+static int
+pdf_find_same_resource_linear(gx_device_pdf * pdev, pdf_resource_type_t rtype, pdf_resource_t **ppres,
         int (*eq)(gx_device_pdf * pdev, pdf_resource_t *pres0, pdf_resource_t *pres1))
 {
     pdf_resource_t **pchain = pdev->resources[rtype].chains;
@@ -1424,6 +1608,80 @@ pdf_find_same_resource(gx_device_pdf * pdev, pdf_resource_type_t rtype, pdf_reso
     return 0;
 }
 
+/* Compare a resource with a candidate, as pdf_find_same_resource_linear does. */
+static int
+pdf_same_resource_candidate(gx_device_pdf * pdev, pdf_resource_t *pres0, pdf_resource_t *pres1,
+        int (*eq)(gx_device_pdf * pdev, pdf_resource_t *pres0, pdf_resource_t *pres1))
+{
+    cos_object_t *pco0 = pres0->object, *pco1 = pres1->object;
+    int code;
+
+    if (pco1 == NULL || cos_type(pco0) != cos_type(pco1))
+        return 0;
+    code = pco0->cos_procs->equal(pco0, pco1, pdev);
+    if (code <= 0)
+        return code;
+    return eq(pdev, pres0, pres1);
+}
+
+/*
+ * Find same resource. Indexed resources are looked up by a digest of their
+ * content, and the unindexed ones are compared one by one, so every resource
+ * of the type is considered. If the object can't be digested, or more than
+ * one resource is equal to it, fall back to comparing against every resource
+ * so that the choice follows chain order.
+ */
+int
+pdf_find_same_resource(gx_device_pdf * pdev, pdf_resource_type_t rtype, pdf_resource_t **ppres,
+        int (*eq)(gx_device_pdf * pdev, pdf_resource_t *pres0, pdf_resource_t *pres1))
+{
+    pdf_resource_index_t *pindex;
+    pdf_resource_t *pres, *found = NULL;
+    cos_object_t *pco0 = (*ppres)->object;
+    uint digest;
+    int code, matches = 0;
+
+    if (pco0 == NULL || pdev->resource_index == NULL)
+        return pdf_find_same_resource_linear(pdev, rtype, ppres, eq);
+    code = cos_object_digest(pco0, pdev, &digest);
+    if (code < 0)
+        return code;
+    if (code > 0)
+        return pdf_find_same_resource_linear(pdev, rtype, ppres, eq);
+    pindex = pdev->resource_index[rtype];
+    pres = (pindex->chains == NULL ? NULL :
+            pindex->chains[digest & (pindex->num_chains - 1)]);
+    for (; pres != NULL; pres = pres->digest_next) {
+        if (pres == *ppres || pres->digest_key != digest)
+            continue;
+        code = pdf_same_resource_candidate(pdev, *ppres, pres, eq);
+        if (code < 0)
+            return code;
+        if (code > 0) {
+            found = pres;
+            matches++;
+        }
+    }
+    for (pres = pindex->unindexed; pres != NULL; pres = pres->digest_next) {
+        if (pres == *ppres)
+            continue;
+        code = pdf_same_resource_candidate(pdev, *ppres, pres, eq);
+        if (code < 0)
+            return code;
+        if (code > 0) {
+            found = pres;
+            matches++;
+        }
+    }
+    if (matches == 1) {
+        *ppres = found;
+        return 1;
+    }
+    if (matches > 1)
+        return pdf_find_same_resource_linear(pdev, rtype, ppres, eq);
+    return pdf_index_resource(pdev, *ppres, rtype, digest);
+}
+
 void
 pdf_drop_resource_from_chain(gx_device_pdf * pdev, pdf_resource_t *pres1, pdf_resource_type_t rtype)
 {
@@ -1447,6 +1705,8 @@ pdf_drop_resource_from_chain(gx_device_pdf * pdev, pdf_resource_t *pres1, pdf_re
         }
     }
 
+    pdf_unindex_resource(pdev, pres1, rtype);
+
     for (; (pres = *pprev) != 0; pprev = &pres->prev)
         if (pres == pres1) {
             *pprev = pres->prev;
@@ -1485,6 +1745,7 @@ pdf_drop_resources(gx_device_pdf * pdev, pdf_resource_type_t rtype,
         pprev = pchain + i;
         for (; (pres = *pprev) != 0; ) {
             if (cond(pdev, pres)) {
+                pdf_unindex_resource(pdev, pres, rtype);
                 *pprev = pres->next;
                 pres->next = pres; /* A temporary mark - see below */
             } else
@@ -1584,6 +1845,11 @@ pdf_alloc_aside(gx_device_pdf * pdev, pdf_resource_t ** plist,
     pres->named = false;
     pres->global = false;
     pres->where_used = pdev->used_mask;
+    pres->digest_next = pres->digest_prev = NULL;
+    pres->digest_index = NULL;
+    pres->digest_listed = false;
+    pres->digest_indexed = false;
+    pres->digest_key = 0;
     *ppres = pres;
     return 0;
 }
@@ -1617,8 +1883,10 @@ pdf_begin_resource_body(gx_device_pdf * pdev, pdf_resource_type_t rtype,
     code = pdf_begin_aside(pdev, PDF_RESOURCE_CHAIN(pdev, rtype, rid),
                                pdf_resource_type_structs[rtype], ppres, rtype);
 
-    if (code >= 0)
+    if (code >= 0) {
         (*ppres)->rid = rid;
+        pdf_list_resource(pdev, *ppres, rtype);
+    }
     return code;
 }
 int
@@ -1665,8 +1933,10 @@ pdf_alloc_resource(gx_device_pdf * pdev, pdf_resource_type_t rtype, gs_id rid,
     code = pdf_alloc_aside(pdev, PDF_RESOURCE_CHAIN(pdev, rtype, rid),
                                pdf_resource_type_structs[rtype], ppres, id);
 
-    if (code >= 0)
+    if (code >= 0) {
         (*ppres)->rid = rid;
+        pdf_list_resource(pdev, *ppres, rtype);
+    }
     return code;
 }
 
@@ -1765,6 +2035,7 @@ pdf_free_resource_objects(gx_device_pdf *pdev, pdf_resource_type_t rtype)
             if (pres->named) {	/* named, don't free */
                 prev = &pres->next;
             } else {
+                pdf_unindex_resource(pdev, pres, rtype);
                 if (pres->object) {
                     cos_free(pres->object, "pdf_free_resource_objects");
                     pres->object = 0;
@@ -195,8 +195,15 @@ typedef enum {
     bool global;                /* ps2write only */\
     char rname[1/*R*/ + (sizeof(long) * 8 / 3 + 1) + 1/*\0*/];\
     ulong where_used;                /* 1 bit per level of content stream */\
-    cos_object_t *object
+    cos_object_t *object;\
+    pdf_resource_t *digest_next;     /* next resource in the same digest list */\
+    pdf_resource_t *digest_prev;     /* previous resource in the same digest list */\
+    pdf_resource_index_t *digest_index; /* index of its type, if in a digest list */\
+    bool digest_listed;              /* true if in a digest list */\
+    bool digest_indexed;             /* true if in a digest chain */\
+    uint digest_key                  /* content digest, when it was indexed */
 typedef struct pdf_resource_s pdf_resource_t;
+typedef struct pdf_resource_index_s pdf_resource_index_t;
 struct pdf_resource_s {
     pdf_resource_common(pdf_resource_t);
 };
@@ -204,8 +211,9 @@ struct pdf_resource_s {
 /* The descriptor is public for subclassing. */
 extern_st(st_pdf_resource);
 #define public_st_pdf_resource()  /* in gdevpdfu.c */\
-  gs_public_st_ptrs3(st_pdf_resource, pdf_resource_t, "pdf_resource_t",\
-    pdf_resource_enum_ptrs, pdf_resource_reloc_ptrs, next, prev, object)
+  gs_public_st_ptrs6(st_pdf_resource, pdf_resource_t, "pdf_resource_t",\
+    pdf_resource_enum_ptrs, pdf_resource_reloc_ptrs, next, prev, object,\
+    digest_next, digest_prev, digest_index)
 
 /*
  * We define XObject resources here because they are used for Image,
@@ -287,6 +295,29 @@ typedef struct pdf_resource_list_s {
     pdf_resource_t *chains[NUM_RESOURCE_CHAINS];
 } pdf_resource_list_t;
 
+/* Resources which have been through pdf_find_same_resource, and were not
+ * found to be duplicates, are also hashed by a digest of their content so
+ * that later duplicates can be found without comparing every resource.
+ * Every other resource in the resource chains is kept on the 'unindexed'
+ * list, and is compared one by one. The number of digest chains is a
+ * power of 2, and grows with the number of resources indexed.
+ * The index is allocated separately, one per resource type, to keep the
+ * parameters of gx_device_pdf within reach of gs_param_item_t offsets.
+ * When the object of an indexed resource is modified, its digest no longer
+ * holds, so it goes back on the 'unindexed' list (see pdf_resource_modified).
+ */
+#define INITIAL_DIGEST_CHAINS 64
+struct pdf_resource_index_s {
+    pdf_resource_t **chains;
+    pdf_resource_t *unindexed;
+    uint num_chains;
+    uint num_indexed;
+};
+#define private_st_pdf_resource_index()\
+  gs_private_st_ptrs2(st_pdf_resource_index, pdf_resource_index_t,\
+    "pdf_resource_index_t", pdf_resource_index_enum_ptrs,\
+    pdf_resource_index_reloc_ptrs, chains, unindexed)
+
 /* Define the hash function for gs_ids. */
 #define gs_id_hash(rid) ((rid) + ((rid) / NUM_RESOURCE_CHAINS))
 /* Define the accessor for the proper hash chain. */
@@ -724,6 +755,7 @@ struct gx_device_pdf_s {
     int num_pages;
     ulong used_mask;                /* for where_used: page level = 1 */
     pdf_resource_list_t resources[NUM_RESOURCE_TYPES];
+    pdf_resource_index_t **resource_index; /* [NUM_RESOURCE_TYPES] */
     /* cs_Patterns[0] is colored; 1,3,4 are uncolored + Gray,RGB,CMYK */
     pdf_resource_t *cs_Patterns[5];
     pdf_resource_t *Identity_ToUnicode_CMaps[2]; /* WMode = 0,1 */
@@ -1162,6 +1194,21 @@ pdf_resource_t *pdf_find_resource_by_gs_id(gx_device_pdf * pdev,
 void
 pdf_drop_resource_from_chain(gx_device_pdf * pdev, pdf_resource_t *pres1, pdf_resource_type_t rtype);
 
+/* Add a resource just linked into a resource chain to the digest index. */
+void pdf_list_resource(gx_device_pdf * pdev, pdf_resource_t *pres, pdf_resource_type_t rtype);
+
+/* Remove a resource from the digest index, before it is freed. */
+void pdf_unindex_resource(gx_device_pdf * pdev, pdf_resource_t *pres, pdf_resource_type_t rtype);
+
+/* Note that the object of a resource was modified, invalidating its digest. */
+void pdf_resource_modified(pdf_resource_t *pres);
+
+/* Allocate the digest index of every resource type. */
+int pdf_alloc_resource_index(gx_device_pdf * pdev);
+
+/* Free the digest index of every resource type. */
+void pdf_free_resource_index(gx_device_pdf * pdev);
+
 void pdf_drop_resources(gx_device_pdf * pdev, pdf_resource_type_t rtype,
         int (*cond)(gx_device_pdf * pdev, pdf_resource_t *pres));
 
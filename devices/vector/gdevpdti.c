@@ -704,6 +704,7 @@ pdf_open_aside(gx_device_pdf *pdev, pdf_resource_type_t rtype,
                 pdf_resource_type_structs[rtype], &pres, reserve_object_id ? 0 : -1);
     if (code < 0)
         return code;
+    pdf_list_resource(pdev, pres, rtype);
     cos_become(pres->object, cos_type_stream);
     s = cos_write_stream_alloc((cos_stream_t *)pres->object, pdev, "pdf_enter_substream");
     if (s == 0)
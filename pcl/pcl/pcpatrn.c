@@ -1331,13 +1331,7 @@ pattern_do_reset(pcl_state_t * pcs, pcl_reset_type_t type)
         if (gstate_pattern_cache(pcs->pgs)) {
             gs_gstate *pgs = pcs->pgs;
 
-            (gstate_pattern_cache(pgs)->free_all) (gstate_pattern_cache(pgs));
-            gs_free_object(pcs->memory,
-                           gstate_pattern_cache(pgs)->tiles,
-                           "pattern_do_reset(tiles)");
-            gs_free_object(pcs->memory,
-                           gstate_pattern_cache(pgs),
-                           "pattern_do_reset(struct)");
+            gx_pattern_cache_free(gstate_pattern_cache(pgs));
             while (pgs) {
                 gstate_set_pattern_cache(pgs, 0);
                 pgs = gs_gstate_saved(pgs);
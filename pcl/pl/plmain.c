@@ -2313,6 +2313,8 @@ handle_dash_s(pl_main_instance_t *pmi, const char *arg)
         if (code < 0)
             return code;
         code = pl_main_set_string_param(pmi, arg);
+    } else if (argis(arg, "GlyphCacheFile") && strlen(eqp) > 0) {
+        code = gs_lib_ctx_set_glyph_cache_file(pmi->memory, eqp+1);
     } else {
         code = pl_main_set_string_param(pmi, arg);
     }
@@ -38,6 +38,7 @@
 #include "pdf_doc.h"
 #include "pdf_repair.h"
 #include "pdf_xref.h"
+#include "pdf_deref.h"
 #include "pdf_device.h"
 
 #include "gsstate.h"        /* For gs_gstate */
@@ -716,49 +717,108 @@ pdfi_report_errors(pdf_context *ctx)
  * be evaded. We need functions to get an index for a given string (which will
  * add the string to the table if its not present) and to cleear up the table
  * on finishing a PDF file.
+ * Documents can use many hundreds of separation and glyph names, so the names
+ * are hashed to find an existing entry, and the entries are kept in an array
+ * in index order so that retrieving the name for an index is O(1).
  */
+#define PDFI_NAME_TABLE_INITIAL_SIZE 64
 
-int pdfi_get_name_index(pdf_context *ctx, char *name, int len, unsigned int *returned)
+static unsigned int pdfi_name_hash(const char *name, int len)
 {
-    pdfi_name_entry_t *e = NULL, *last_entry = NULL, *new_entry = NULL;
-    int index = 0;
+    /* FNV-1a */
+    unsigned int hash = 2166136261U;
+    int i;
 
-    if (ctx->name_table == NULL) {
-        e = NULL;
-    } else {
-        e = ctx->name_table;
+    for (i = 0; i < len; i++) {
+        hash ^= (byte)name[i];
+        hash *= 16777619U;
     }
+    return hash;
+}
+
+/* Double the number of hash buckets, and redistribute the existing entries */
+static int pdfi_grow_name_hash(pdf_context *ctx)
+{
+    pdfi_name_table_t *table = &ctx->name_table;
+    unsigned int new_size = table->num_buckets == 0 ? PDFI_NAME_TABLE_INITIAL_SIZE : table->num_buckets * 2;
+    pdfi_name_entry_t **new_buckets = NULL;
+    unsigned int i;
+
+    new_buckets = (pdfi_name_entry_t **)gs_alloc_bytes(ctx->memory, new_size * sizeof(pdfi_name_entry_t *), "pdfi_grow_name_hash");
+    if (new_buckets == NULL)
+        return_error(gs_error_VMerror);
+    memset(new_buckets, 0x00, new_size * sizeof(pdfi_name_entry_t *));
+
+    for (i = 0; i < table->num_entries; i++) {
+        pdfi_name_entry_t *e = table->entries[i];
+        unsigned int bucket = pdfi_name_hash(e->name, e->len) & (new_size - 1);
+
+        e->next = new_buckets[bucket];
+        new_buckets[bucket] = e;
+    }
+    gs_free_object(ctx->memory, table->buckets, "pdfi_grow_name_hash");
+    table->buckets = new_buckets;
+    table->num_buckets = new_size;
+    return 0;
+}
 
-    while(e != NULL) {
-        if (e->len == len) {
-            if (memcmp(e->name, name, e->len) == 0) {
-                *returned = e->index;
-                return 0;
+int pdfi_get_name_index(pdf_context *ctx, char *name, int len, unsigned int *returned)
+{
+    pdfi_name_table_t *table = &ctx->name_table;
+    pdfi_name_entry_t *e = NULL, *new_entry = NULL;
+    unsigned int hash = pdfi_name_hash(name, len), bucket;
+    int code;
+
+    if (table->num_buckets != 0) {
+        e = table->buckets[hash & (table->num_buckets - 1)];
+
+        while(e != NULL) {
+            if (e->len == len) {
+                if (memcmp(e->name, name, e->len) == 0) {
+                    *returned = e->index;
+                    return 0;
+                }
             }
+            e = e->next;
         }
-        last_entry = e;
-        index = e->index;
-        e = e->next;
     }
 
-    new_entry = (pdfi_name_entry_t *)gs_alloc_bytes(ctx->memory, sizeof(pdfi_name_entry_t), "Alloc name table entry");
+    /* Not found, add a new entry. Keep the load factor at or below 1 */
+    if (table->num_entries >= table->num_buckets) {
+        code = pdfi_grow_name_hash(ctx);
+        if (code < 0)
+            return code;
+    }
+    if (table->num_entries >= table->max_entries) {
+        unsigned int new_max = table->max_entries == 0 ? PDFI_NAME_TABLE_INITIAL_SIZE : table->max_entries * 2;
+        pdfi_name_entry_t **new_entries = NULL;
+
+        new_entries = (pdfi_name_entry_t **)gs_alloc_bytes(ctx->memory, new_max * sizeof(pdfi_name_entry_t *), "Alloc name table index");
+        if (new_entries == NULL)
+            return_error(gs_error_VMerror);
+        if (table->num_entries != 0)
+            memcpy(new_entries, table->entries, table->num_entries * sizeof(pdfi_name_entry_t *));
+        gs_free_object(ctx->memory, table->entries, "Alloc name table index");
+        table->entries = new_entries;
+        table->max_entries = new_max;
+    }
+
+    /* The name is stored immediately after the entry */
+    new_entry = (pdfi_name_entry_t *)gs_alloc_bytes(ctx->memory, sizeof(pdfi_name_entry_t) + len + 1, "Alloc name table entry");
     if (new_entry == NULL)
         return_error(gs_error_VMerror);
     memset(new_entry, 0x00, sizeof(pdfi_name_entry_t));
-    new_entry->name = (char *)gs_alloc_bytes(ctx->memory, len+1, "Alloc name table name");
-    if (new_entry->name == NULL) {
-        gs_free_object(ctx->memory, new_entry, "Failed to allocate name entry");
-            return_error(gs_error_VMerror);
-    }
-    memset(new_entry->name, 0x00, len+1);
+    new_entry->name = (char *)new_entry + sizeof(pdfi_name_entry_t);
     memcpy(new_entry->name, name, len);
+    new_entry->name[len] = 0x00;
     new_entry->len = len;
-    new_entry->index = ++index;
 
-    if (last_entry)
-        last_entry->next = new_entry;
-    else
-        ctx->name_table = new_entry;
+    table->entries[table->num_entries++] = new_entry;
+    new_entry->index = table->num_entries;
+
+    bucket = hash & (table->num_buckets - 1);
+    new_entry->next = table->buckets[bucket];
+    table->buckets[bucket] = new_entry;
 
     *returned = new_entry->index;
     return 0;
@@ -766,41 +826,34 @@ int pdfi_get_name_index(pdf_context *ctx, char *name, int len, unsigned int *ret
 
 static int pdfi_free_name_table(pdf_context *ctx)
 {
-    if (ctx->name_table) {
-        pdfi_name_entry_t *next = NULL, *e = (pdfi_name_entry_t *)ctx->name_table;
-
-        while (e != NULL) {
-            next = (pdfi_name_entry_t *)e->next;
-            gs_free_object(ctx->memory, e->name, "free name table entries");
-            gs_free_object(ctx->memory, e, "free name table entries");
-            e = next;
-        }
-    }
-    ctx->name_table = NULL;
+    pdfi_name_table_t *table = &ctx->name_table;
+    unsigned int i;
+
+    for (i = 0; i < table->num_entries; i++)
+        gs_free_object(ctx->memory, table->entries[i], "free name table entries");
+    gs_free_object(ctx->memory, table->entries, "free name table entries");
+    gs_free_object(ctx->memory, table->buckets, "free name table entries");
+    memset(table, 0x00, sizeof(pdfi_name_table_t));
     return 0;
 }
 
 int pdfi_name_from_index(pdf_context *ctx, int index, unsigned char **name, unsigned int *len)
 {
-    pdfi_name_entry_t *e = (pdfi_name_entry_t *)ctx->name_table;
+    pdfi_name_entry_t *e = NULL;
 
-    while (e != NULL) {
-        if (e->index == index) {
-            *name = (unsigned char *)e->name;
-            *len = e->len;
-            return 0;
-        }
-        e = e->next;
-    }
+    if (index < 1 || (unsigned int)index > ctx->name_table.num_entries)
+        return_error(gs_error_undefined);
 
-    return_error(gs_error_undefined);
+    e = ctx->name_table.entries[index - 1];
+    *name = (unsigned char *)e->name;
+    *len = e->len;
+    return 0;
 }
 
 int pdfi_separation_name_from_index(gs_gstate *pgs, gs_separation_name index, unsigned char **name, unsigned int *len)
 {
     pdfi_int_gstate *igs = (pdfi_int_gstate *)pgs->client_data;
     pdf_context *ctx = NULL;
-    pdfi_name_entry_t *e = NULL;
 
     if (igs == NULL)
         return_error(gs_error_undefined);
@@ -809,18 +862,10 @@ int pdfi_separation_name_from_index(gs_gstate *pgs, gs_separation_name index, un
     if (ctx == NULL)
         return_error(gs_error_undefined);
 
-    e = (pdfi_name_entry_t *)ctx->name_table;
-
-    while (e != NULL) {
-        if (e->index == index) {
-            *name = (unsigned char *)e->name;
-            *len = e->len;
-            return 0;
-        }
-        e = e->next;
-    }
+    if (index > ctx->name_table.num_entries)
+        return_error(gs_error_undefined);
 
-    return_error(gs_error_undefined);
+    return pdfi_name_from_index(ctx, (int)index, name, len);
 }
 
 /* These functions are used by the 'PL' implementation, eventually we will */
@@ -1152,7 +1197,9 @@ static int pdfi_init_file(pdf_context *ctx)
     int code = 0;
     pdf_obj *o = NULL;
 
-    code = pdfi_read_xref(ctx);
+    /* The xref may have been read already by another context (see pdfi_share_xref()) */
+    if (ctx->xref_table == NULL)
+        code = pdfi_read_xref(ctx);
     if (code < 0) {
         if (ctx->is_hybrid) {
             /* If its a hybrid file, and we failed to read the XrefStm, try
@@ -1302,6 +1349,14 @@ int pdfi_set_input_stream(pdf_context *ctx, stream *stm)
     bytes = BUF_SIZE;
     pdfi_seek(ctx, ctx->main_stream, 0, SEEK_SET);
 
+    /* If another context has read the xref for us, it has read the header
+     * and found the startxref too (see pdfi_share_xref()).
+     */
+    if (ctx->xref_table != NULL) {
+        code = pdfi_init_file(ctx);
+        goto error;
+    }
+
     bytes = Offset = min(BUF_SIZE - 1, ctx->main_stream_length);
 
     if (ctx->args.pdfdebug)
@@ -1819,6 +1874,7 @@ pdf_context *pdfi_create_context(gs_memory_t *mem)
 
     /* Setup some flags that don't default to 'false' */
     ctx->args.showannots = true;
+    ctx->args.objectcachesize = DEFAULT_OBJECT_CACHE_BYTES;
     ctx->args.preserveannots = true;
     /* NOTE: For testing certain annotations on cluster, might want to set this to false */
     ctx->args.printed = false; /* True if OutputFile is set, false otherwise see pdftop.c, pdf_impl_set_param() */
@@ -1847,12 +1903,12 @@ pdf_context *pdfi_create_context(gs_memory_t *mem)
 #if REFCNT_DEBUG
     ctx->UID = 1;
 #endif
-#if CACHE_STATISTICS
     ctx->hits = 0;
     ctx->misses = 0;
     ctx->compressed_hits = 0;
     ctx->compressed_misses = 0;
-#endif
+    ctx->evictions = 0;
+    ctx->peak_cache_bytes = 0;
 #ifdef DEBUG
     ctx->args.verbose_errors = ctx->args.verbose_warnings = 1;
 #endif
@@ -1904,10 +1960,11 @@ pdfi_purge_obj_cache(pdf_context *ctx)
 
         while(entry) {
             next = entry->next;
-            if (entry->o->object_num != 0) {
-                ctx->xref_table->xref[entry->o->object_num].cache = NULL;
+            if (entry->o->object_num != 0 && entry->o->object_num < ctx->xref_table->cache_size) {
+                ctx->xref_table->cache[entry->o->object_num] = NULL;
             }
             pdfi_countdown(entry->o);
+            pdfi_free_objstm_data(ctx, entry->objstm);
             ctx->cache_entries--;
             gs_free_object(ctx->memory, entry, "pdfi_clear_context, free LRU");
             entry = next;
@@ -1917,6 +1974,7 @@ pdfi_purge_obj_cache(pdf_context *ctx)
         }
         ctx->cache_LRU = ctx->cache_MRU = NULL;
         ctx->cache_entries = 0;
+        ctx->cache_bytes = 0;
     }
 }
 #endif
@@ -1928,21 +1986,28 @@ pdfi_purge_obj_cache(pdf_context *ctx)
  */
 int pdfi_clear_context(pdf_context *ctx)
 {
-#if CACHE_STATISTICS
-    float compressed_hit_rate = 0.0, hit_rate = 0.0;
-
-    if (ctx->compressed_hits > 0 || ctx->compressed_misses > 0)
-        compressed_hit_rate = (float)ctx->compressed_hits / (float)(ctx->compressed_hits + ctx->compressed_misses);
-    if (ctx->hits > 0 || ctx->misses > 0)
-        hit_rate = (float)ctx->hits / (float)(ctx->hits + ctx->misses);
-
-    dmprintf1(ctx->memory, "Number of normal object cache hits: %"PRIi64"\n", ctx->hits);
-    dmprintf1(ctx->memory, "Number of normal object cache misses: %"PRIi64"\n", ctx->misses);
-    dmprintf1(ctx->memory, "Number of compressed object cache hits: %"PRIi64"\n", ctx->compressed_hits);
-    dmprintf1(ctx->memory, "Number of compressed object cache misses: %"PRIi64"\n", ctx->compressed_misses);
-    dmprintf1(ctx->memory, "Normal object cache hit rate: %f\n", hit_rate);
-    dmprintf1(ctx->memory, "Compressed object cache hit rate: %f\n", compressed_hit_rate);
-#endif
+    if ((CACHE_STATISTICS || ctx->args.cachestatistics) &&
+        (ctx->hits > 0 || ctx->misses > 0 || ctx->compressed_hits > 0 || ctx->compressed_misses > 0)) {
+        float compressed_hit_rate = 0.0, hit_rate = 0.0;
+
+        if (ctx->compressed_hits > 0 || ctx->compressed_misses > 0)
+            compressed_hit_rate = (float)ctx->compressed_hits / (float)(ctx->compressed_hits + ctx->compressed_misses);
+        if (ctx->hits > 0 || ctx->misses > 0)
+            hit_rate = (float)ctx->hits / (float)(ctx->hits + ctx->misses);
+
+        dmprintf1(ctx->memory, "Number of normal object cache hits: %"PRIi64"\n", ctx->hits);
+        dmprintf1(ctx->memory, "Number of normal object cache misses: %"PRIi64"\n", ctx->misses);
+        dmprintf1(ctx->memory, "Number of compressed object cache hits: %"PRIi64"\n", ctx->compressed_hits);
+        dmprintf1(ctx->memory, "Number of compressed object cache misses: %"PRIi64"\n", ctx->compressed_misses);
+        dmprintf1(ctx->memory, "Normal object cache hit rate: %f\n", hit_rate);
+        dmprintf1(ctx->memory, "Compressed object cache hit rate: %f\n", compressed_hit_rate);
+        dmprintf1(ctx->memory, "Number of object cache evictions: %"PRIi64"\n", ctx->evictions);
+        dmprintf2(ctx->memory, "Object cache peak size: %"PRIi64" bytes (limit %d bytes)\n",
+                  ctx->peak_cache_bytes, ctx->args.objectcachesize);
+        /* Only report each file once */
+        ctx->hits = ctx->misses = ctx->compressed_hits = ctx->compressed_misses = 0;
+        ctx->evictions = ctx->peak_cache_bytes = 0;
+    }
     if (ctx->PathSegments != NULL) {
         gs_free_object(ctx->memory, ctx->PathSegments, "pdfi_clear_context");
         ctx->PathSegments = NULL;
@@ -2050,6 +2115,8 @@ int pdfi_clear_context(pdf_context *ctx)
         ctx->encryption.Password = NULL;
     }
 
+    pdfi_free_last_objstm(ctx);
+
     if (ctx->cache_entries != 0) {
         pdf_obj_cache_entry *entry = ctx->cache_LRU, *next;
 
@@ -2074,6 +2141,7 @@ int pdfi_clear_context(pdf_context *ctx)
                 if (entry->o->refcnt == 1) {
                     stop = false;
                     pdfi_countdown(entry->o);
+                    pdfi_free_objstm_data(ctx, entry->objstm);
                     if (prev != NULL)
                         prev->next = next;
                     else
@@ -2100,6 +2168,7 @@ int pdfi_clear_context(pdf_context *ctx)
         while(entry) {
             next = entry->next;
             pdfi_countdown(entry->o);
+            pdfi_free_objstm_data(ctx, entry->objstm);
             ctx->cache_entries--;
             gs_free_object(ctx->memory, entry, "pdfi_clear_context, free LRU");
             entry = next;
@@ -2110,6 +2179,7 @@ int pdfi_clear_context(pdf_context *ctx)
 #endif
         ctx->cache_LRU = ctx->cache_MRU = NULL;
         ctx->cache_entries = 0;
+        ctx->cache_bytes = 0;
     }
 
     /* We can't free the font directory before the graphics library fonts fonts are freed, as they reference the font_dir.
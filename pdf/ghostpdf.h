@@ -89,7 +89,10 @@ typedef enum pdf_type3_d_type_e {
 
 #define INITIAL_STACK_SIZE 32
 #define MAX_STACK_SIZE 524288
-#define MAX_OBJECT_CACHE_SIZE 200
+/* The object cache is limited by the (estimated) memory used by the cached objects,
+ * this can be changed with -dPDFObjectCacheSize=
+ */
+#define DEFAULT_OBJECT_CACHE_BYTES (8 * 1024 * 1024)
 #define INITIAL_LOOP_TRACKER_SIZE 32
 
 typedef struct pdf_transfer_s {
@@ -110,9 +113,21 @@ typedef struct name_entry_s {
     char *name;
     int len;
     unsigned int index;
-    void *next;
+    void *next;                 /* Next entry in the same hash bucket */
 } pdfi_name_entry_t;
 
+/* The name table is hashed on the name for interning, and keeps an array of the
+ * entries ordered by index (the index of an entry is its position + 1) so that
+ * looking up a name from its index is a simple array access.
+ */
+typedef struct name_table_s {
+    pdfi_name_entry_t **buckets;
+    unsigned int num_buckets;   /* Always a power of 2 */
+    pdfi_name_entry_t **entries;
+    unsigned int num_entries;
+    unsigned int max_entries;
+} pdfi_name_table_t;
+
 typedef struct cmd_args_s {
     /* These are various command line switches, the list is not yet complete */
     int first_page;             /* -dFirstPage= */
@@ -156,6 +171,9 @@ typedef struct cmd_args_s {
 
     bool ignoretounicode;
     bool nonativefontmap;
+    int objectcachesize;        /* -dPDFObjectCacheSize=, in bytes */
+    bool cachestatistics;       /* -dPDFCacheStatistics */
+    int pageworkers;            /* -dPDFPageWorkers=, gpdf only */
 } cmd_args_t;
 
 typedef struct encryption_state_s {
@@ -440,8 +458,14 @@ typedef struct pdf_context_s
 
     /* The object cache */
     uint32_t cache_entries;
+    uint64_t cache_bytes;       /* Estimated size of all the objects in the cache */
     pdf_obj_cache_entry *cache_LRU;
     pdf_obj_cache_entry *cache_MRU;
+    /* The last ObjStm decoded that couldn't be kept with its cache entry, and
+     * its object number and offset in the file */
+    pdf_objstm_data *last_objstm;
+    uint64_t last_objstm_num;
+    gs_offset_t last_objstm_offset;
 
     /* The loop detection state */
     uint32_t loop_detection_size;
@@ -463,7 +487,7 @@ typedef struct pdf_context_s
     stream_save current_stream_save;
 
     /* A name table :-( */
-    pdfi_name_entry_t *name_table;
+    pdfi_name_table_t name_table;
 
     gs_string *fontmapfiles;
     int num_fontmapfiles;
@@ -473,6 +497,8 @@ typedef struct pdf_context_s
     pdf_dict *pdfnativefontmap; /* Explicit mappings take precedence, hence we need separate dictionaries */
     pdf_dict *pdf_substitute_fonts;
     pdf_dict *pdfcidfmap;
+    /* Font files shared with the other page workers, or NULL (see pdf_font.c) */
+    struct pdfi_font_files_s *font_files;
 
     gx_device *devbbox; /* Cached for use in pdfi_string_bbox */
     /* These function pointers can be replaced by ones intended to replicate
@@ -486,12 +512,13 @@ typedef struct pdf_context_s
 #if REFCNT_DEBUG
     uint64_t ref_UID;
 #endif
-#if CACHE_STATISTICS
+    /* Object cache statistics, printed if CACHE_STATISTICS is set or -dPDFCacheStatistics */
     uint64_t hits;
     uint64_t misses;
     uint64_t compressed_hits;
     uint64_t compressed_misses;
-#endif
+    uint64_t evictions;
+    uint64_t peak_cache_bytes;
 #if PDFI_LEAK_CHECK
     gs_memory_status_t memstat;
 #endif
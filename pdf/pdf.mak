@@ -80,7 +80,7 @@ $(PDFOBJ)pdf_fapi.$(OBJ): $(PDFSRC)pdf_fapi.c $(PDFINCLUDES) \
 	$(PDFCCC) $(PDFSRC)pdf_fapi.c $(PDFO_)pdf_fapi.$(OBJ)
 
 $(PDFOBJ)pdf_font.$(OBJ): $(PDFSRC)pdf_font.c $(PDFINCLUDES) $(PDF_MAK) \
-	$(gscencs_h) $(stream_h) $(strmio_h) $(gsstate_h) $(MAKEDIRS)
+	$(gscencs_h) $(stream_h) $(strmio_h) $(gsstate_h) $(gxsync_h) $(MAKEDIRS)
 	$(PDFCCC) $(PDFSRC)pdf_font.c $(PDFO_)pdf_font.$(OBJ)
 
 $(PDFOBJ)pdf_font0.$(OBJ): $(PDFSRC)pdf_font0.c $(PDFINCLUDES) $(PDF_MAK) \
@@ -282,7 +282,9 @@ $(PLOBJ)pdfimpl.$(OBJ): $(PDFGEN)pdfimpl.c          \
 
 $(PDF_TOP_OBJ): $(PDFSRC)pdftop.c $(plmain_h) $(pltop_h) $(PDFINCLUDES) \
     $(GLGEN)gconfig.$(OBJ) $(pltop_h) $(plmain_h) $(plparse_h) $(gxdevice_h) \
-    $(gxht_h) $(gsht1_h) $(pconfig_h) \
+    $(gxht_h) $(gsht1_h) $(pconfig_h) $(gslib_h) $(gxiodev_h) \
+    $(gxfapi_h) $(gsmchunk_h) $(gsicc_manage_h) $(gdevprn_h) $(gdevdevn_h) \
+    $(gxdevsop_h) $(gdevepo_h) $(gpsync_h) \
      $(PDF_MAK) $(MAKEDIRS)
 	$(PDFCCC) $(D_)GS_LIB_DEFAULT=$(GS_LIB_DEFAULT)$(_D) $(D_)COMPILE_INITS=$(COMPILE_INITS)$(_D) $(PDFSRC)pdftop.c $(PDFO_)pdftop.$(OBJ)
 
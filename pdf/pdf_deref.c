@@ -33,55 +33,202 @@
 
 /* Start with the object caching functions */
 
-/* given an object, create a cache entry for it. If we have too many entries
- * then delete the leat-recently-used cache entry. Make the new entry be the
- * most-recently-used entry. The actual entries are attached to the xref table
+/* Estimate the memory used by an object, for limiting the size of the object cache.
+ * We count the direct objects contained in arrays and dictionaries (those with an
+ * object number of 0), but not indirect objects, those are cached (and counted)
+ * separately. Stream data is not held in memory, so only the dictionary is counted.
+ * Strings and names are allocated with only as much data as they need.
+ * Fonts and CMaps hold graphics library structures and font programs which we can't
+ * cheaply measure, so we use a fixed estimate for those.
+ */
+#define PDFI_CACHE_FONT_SIZE (32 * 1024)
+#define PDFI_CACHE_MAX_DEPTH 16
+
+static uint64_t pdfi_cache_size_of(pdf_obj *o, int depth)
+{
+    uint64_t size = 0, i;
+
+    if ((uintptr_t)o < TOKEN__LAST_KEY)
+        return 0;
+
+    switch (pdfi_type_of(o)) {
+        case PDF_STRING:
+            return offsetof(pdf_string, data) + ((pdf_string *)o)->length;
+        case PDF_NAME:
+            return offsetof(pdf_name, data) + ((pdf_name *)o)->length;
+        case PDF_BUFFER:
+            return sizeof(pdf_buffer) + ((pdf_buffer *)o)->length;
+        case PDF_INT:
+        case PDF_REAL:
+            return sizeof(pdf_num);
+        case PDF_INDIRECT:
+            return sizeof(pdf_indirect_ref);
+        case PDF_ARRAY:
+            {
+                pdf_array *a = (pdf_array *)o;
+
+                size = sizeof(pdf_array) + a->size * sizeof(pdf_obj *);
+                if (depth < PDFI_CACHE_MAX_DEPTH) {
+                    for (i = 0; i < a->size; i++) {
+                        if ((uintptr_t)a->values[i] >= TOKEN__LAST_KEY && a->values[i]->object_num == 0)
+                            size += pdfi_cache_size_of(a->values[i], depth + 1);
+                    }
+                }
+                return size;
+            }
+        case PDF_DICT:
+            {
+                pdf_dict *d = (pdf_dict *)o;
+
+                size = sizeof(pdf_dict) + d->size * sizeof(pdf_dict_entry);
+                if (depth < PDFI_CACHE_MAX_DEPTH) {
+                    for (i = 0; i < d->entries; i++) {
+                        size += pdfi_cache_size_of(d->list[i].key, depth + 1);
+                        if ((uintptr_t)d->list[i].value >= TOKEN__LAST_KEY && d->list[i].value->object_num == 0)
+                            size += pdfi_cache_size_of(d->list[i].value, depth + 1);
+                    }
+                }
+                return size;
+            }
+        case PDF_STREAM:
+            return sizeof(pdf_stream) + pdfi_cache_size_of((pdf_obj *)((pdf_stream *)o)->stream_dict, depth + 1);
+        case PDF_FONT:
+        case PDF_CMAP:
+            return PDFI_CACHE_FONT_SIZE;
+        default:
+            return sizeof(pdf_obj);
+    }
+}
+
+/* The cache entry for an object, or NULL if it isn't cached */
+static pdf_obj_cache_entry *pdfi_cache_entry(pdf_context *ctx, uint64_t obj)
+{
+    if (obj >= ctx->xref_table->cache_size)
+        return NULL;
+    return ctx->xref_table->cache[obj];
+}
+
+static int pdfi_set_cache_entry(pdf_context *ctx, uint64_t obj, pdf_obj_cache_entry *entry)
+{
+    xref_table_t *xref = ctx->xref_table;
+    pdf_obj_cache_entry **cache;
+
+    if (obj >= xref->cache_size) {
+        if (entry == NULL)
+            return 0;
+
+        /* Allocated when the first object is cached, and again if the table
+         * has grown since (a repair can add objects).
+         */
+        cache = (pdf_obj_cache_entry **)gs_alloc_bytes(ctx->memory, xref->xref_size * sizeof(pdf_obj_cache_entry *),
+                                                       "pdfi_set_cache_entry");
+        if (cache == NULL)
+            return_error(gs_error_VMerror);
+        memset(cache, 0x00, xref->xref_size * sizeof(pdf_obj_cache_entry *));
+        if (xref->cache != NULL) {
+            memcpy(cache, xref->cache, xref->cache_size * sizeof(pdf_obj_cache_entry *));
+            gs_free_object(ctx->memory, xref->cache, "pdfi_set_cache_entry");
+        }
+        xref->cache = cache;
+        xref->cache_size = xref->xref_size;
+    }
+    xref->cache[obj] = entry;
+    return 0;
+}
+
+/* Remove the least-recently-used entry from the cache */
+static void pdfi_evict_cache_entry(pdf_context *ctx)
+{
+    pdf_obj_cache_entry *entry = ctx->cache_LRU;
+
+#if DEBUG_CACHE
+    dbgmprintf(ctx->memory, "Cache full, evicting LRU\n");
+#endif
+    ctx->cache_LRU = entry->next;
+    if (entry->next)
+        ((pdf_obj_cache_entry *)entry->next)->previous = NULL;
+    else
+        ctx->cache_MRU = NULL;
+    (void)pdfi_set_cache_entry(ctx, entry->o->object_num, NULL);
+    ctx->cache_bytes -= entry->size;
+    ctx->cache_entries--;
+    ctx->evictions++;
+    pdfi_countdown(entry->o);
+    pdfi_free_objstm_data(ctx, entry->objstm);
+    gs_free_object(ctx->memory, entry, "pdfi_add_to_cache, free LRU");
+}
+
+static uint64_t pdfi_objstm_size(pdf_objstm_data *objstm)
+{
+    if (objstm == NULL)
+        return 0;
+    return sizeof(pdf_objstm_data) + objstm->length + (uint64_t)objstm->num_entries * 2 * sizeof(int);
+}
+
+void pdfi_free_objstm_data(pdf_context *ctx, pdf_objstm_data *objstm)
+{
+    if (objstm == NULL)
+        return;
+    gs_free_object(ctx->memory, objstm->data, "pdfi_free_objstm_data");
+    gs_free_object(ctx->memory, objstm->offsets, "pdfi_free_objstm_data");
+    gs_free_object(ctx->memory, objstm, "pdfi_free_objstm_data");
+}
+
+void pdfi_free_last_objstm(pdf_context *ctx)
+{
+    pdfi_free_objstm_data(ctx, ctx->last_objstm);
+    ctx->last_objstm = NULL;
+}
+
+/* given an object, create a cache entry for it. If adding the object would take the
+ * cache over its size limit then delete least-recently-used cache entries until it
+ * fits. Make the new entry be the most-recently-used entry. Objects which are large
+ * compared to the whole cache are not cached at all, rather than flushing many smaller
+ * objects which are likely to be reused. The actual entries are attached to the xref table
  * (as well as being a double-linked list), because we detect an existing
- * cache entry by seeing that the xref table for the object number has a non-NULL
- * 'cache' member.
+ * cache entry by seeing that the xref table has a non-NULL 'cache' pointer for
+ * the object number.
  * So we need to update the xref as well if we add or delete cache entries.
  */
 static int pdfi_add_to_cache(pdf_context *ctx, pdf_obj *o)
 {
     pdf_obj_cache_entry *entry;
+    uint64_t size;
+    int code;
 
     if (o < PDF_TOKEN_AS_OBJ(TOKEN__LAST_KEY))
         return 0;
 
-    if (ctx->xref_table->xref[o->object_num].cache != NULL) {
+    if (o->object_num >= ctx->xref_table->xref_size)
+        return_error(gs_error_rangecheck);
+
+    if (pdfi_cache_entry(ctx, o->object_num) != NULL) {
 #if DEBUG_CACHE
         dmprintf1(ctx->memory, "Attempting to add object %d to cache when the object is already cached!\n", o->object_num);
 #endif
         return_error(gs_error_unknownerror);
     }
 
-    if (o->object_num > ctx->xref_table->xref_size)
-        return_error(gs_error_rangecheck);
+    size = pdfi_cache_size_of(o, 0);
+    if (size > ctx->args.objectcachesize / 4)
+        return 0;
+
+    while (ctx->cache_bytes + size > ctx->args.objectcachesize && ctx->cache_LRU != NULL)
+        pdfi_evict_cache_entry(ctx);
 
-    if (ctx->cache_entries == MAX_OBJECT_CACHE_SIZE)
-    {
-#if DEBUG_CACHE
-        dbgmprintf(ctx->memory, "Cache full, evicting LRU\n");
-#endif
-        if (ctx->cache_LRU) {
-            entry = ctx->cache_LRU;
-            ctx->cache_LRU = entry->next;
-            if (entry->next)
-                ((pdf_obj_cache_entry *)entry->next)->previous = NULL;
-            ctx->xref_table->xref[entry->o->object_num].cache = NULL;
-            pdfi_countdown(entry->o);
-            ctx->cache_entries--;
-            gs_free_object(ctx->memory, entry, "pdfi_add_to_cache, free LRU");
-        } else
-            return_error(gs_error_unknownerror);
-    }
     entry = (pdf_obj_cache_entry *)gs_alloc_bytes(ctx->memory, sizeof(pdf_obj_cache_entry), "pdfi_add_to_cache");
     if (entry == NULL)
         return_error(gs_error_VMerror);
 
     memset(entry, 0x00, sizeof(pdf_obj_cache_entry));
+    code = pdfi_set_cache_entry(ctx, o->object_num, entry);
+    if (code < 0) {
+        gs_free_object(ctx->memory, entry, "pdfi_add_to_cache");
+        return code;
+    }
 
     entry->o = o;
+    entry->size = (uint32_t)size;
     pdfi_countup(o);
     if (ctx->cache_MRU) {
         entry->previous = ctx->cache_MRU;
@@ -92,7 +239,9 @@ static int pdfi_add_to_cache(pdf_context *ctx, pdf_obj *o)
         ctx->cache_LRU = entry;
 
     ctx->cache_entries++;
-    ctx->xref_table->xref[o->object_num].cache = entry;
+    ctx->cache_bytes += size;
+    if (ctx->cache_bytes > ctx->peak_cache_bytes)
+        ctx->peak_cache_bytes = ctx->cache_bytes;
     return 0;
 }
 
@@ -128,7 +277,6 @@ static void pdfi_promote_cache_entry(pdf_context *ctx, pdf_obj_cache_entry *cach
  */
 int replace_cache_entry(pdf_context *ctx, pdf_obj *o)
 {
-    xref_entry *entry;
     pdf_obj_cache_entry *cache_entry;
     pdf_obj *old_cached_obj = NULL;
 
@@ -136,8 +284,7 @@ int replace_cache_entry(pdf_context *ctx, pdf_obj *o)
      * validity of the object (eg not a free oobject) have already been handled.
      */
 
-    entry = &ctx->xref_table->xref[o->object_num];
-    cache_entry = entry->cache;
+    cache_entry = pdfi_cache_entry(ctx, o->object_num);
 
     if (cache_entry == NULL) {
         return(pdfi_add_to_cache(ctx, o));
@@ -153,6 +300,17 @@ int replace_cache_entry(pdf_context *ctx, pdf_obj *o)
         pdfi_countup(o);
         pdfi_promote_cache_entry(ctx, cache_entry);
 
+        /* The new object may be larger than the old one, make room for it, but
+         * don't evict the entry we've just promoted to be the MRU.
+         */
+        ctx->cache_bytes -= cache_entry->size;
+        cache_entry->size = (uint32_t)(pdfi_cache_size_of(o, 0) + pdfi_objstm_size(cache_entry->objstm));
+        ctx->cache_bytes += cache_entry->size;
+        while (ctx->cache_bytes > ctx->args.objectcachesize && ctx->cache_LRU != cache_entry)
+            pdfi_evict_cache_entry(ctx);
+        if (ctx->cache_bytes > ctx->peak_cache_bytes)
+            ctx->peak_cache_bytes = ctx->cache_bytes;
+
         /* Now decrement the old cache entry, if any */
         pdfi_countdown(old_cached_obj);
     }
@@ -583,22 +741,168 @@ static int pdfi_read_object(pdf_context *ctx, pdf_c_stream *s, gs_offset_t strea
     return pdfi_read_bare_object(ctx, s, stream_offset, objnum, gen);
 }
 
+/* Decompress an ObjStm, and read the table of object numbers and offsets
+ * at the start of it.
+ */
+static int pdfi_decode_objstm(pdf_context *ctx, pdf_stream *compressed_object, int64_t Length,
+                              int64_t First, int64_t num_entries, pdf_objstm_data **objstm)
+{
+    int code = 0;
+    pdf_c_stream *SubFile_stream = NULL;
+    pdf_c_stream *compressed_stream = NULL;
+    pdf_c_stream *header_stream = NULL;
+    pdf_objstm_data *d = NULL;
+    uint32_t buffer_size = 8192;
+    int bytes;
+    int64_t i;
+
+    *objstm = NULL;
+    if (First < 0)
+        First = 0;
+
+    d = (pdf_objstm_data *)gs_alloc_bytes(ctx->memory, sizeof(pdf_objstm_data), "pdfi_decode_objstm");
+    if (d == NULL)
+        return_error(gs_error_VMerror);
+    memset(d, 0x00, sizeof(pdf_objstm_data));
+
+    d->data = gs_alloc_bytes(ctx->memory, buffer_size, "pdfi_decode_objstm (data)");
+    if (d->data == NULL) {
+        code = gs_note_error(gs_error_VMerror);
+        goto exit;
+    }
+
+    code = pdfi_seek(ctx, ctx->main_stream, pdfi_stream_offset(ctx, compressed_object), SEEK_SET);
+    if (code < 0)
+        goto exit;
+
+    code = pdfi_apply_SubFileDecode_filter(ctx, Length, NULL, ctx->main_stream, &SubFile_stream, false);
+    if (code < 0)
+        goto exit;
+
+    code = pdfi_filter(ctx, compressed_object, SubFile_stream, &compressed_stream, false);
+    if (code < 0)
+        goto exit;
+
+    do {
+        if (d->length == buffer_size) {
+            byte *new_data;
+
+            if (buffer_size > max_uint / 2) {
+                code = gs_note_error(gs_error_limitcheck);
+                goto exit;
+            }
+            new_data = gs_alloc_bytes(ctx->memory, buffer_size * 2, "pdfi_decode_objstm (data)");
+            if (new_data == NULL) {
+                code = gs_note_error(gs_error_VMerror);
+                goto exit;
+            }
+            memcpy(new_data, d->data, d->length);
+            gs_free_object(ctx->memory, d->data, "pdfi_decode_objstm (data)");
+            d->data = new_data;
+            buffer_size *= 2;
+        }
+        bytes = pdfi_read_bytes(ctx, d->data + d->length, 1, buffer_size - d->length, compressed_stream);
+        if (bytes < 0) {
+            code = gs_note_error(gs_error_ioerror);
+            goto exit;
+        }
+        d->length += bytes;
+    } while (bytes > 0 && !compressed_stream->eof);
+
+    if (First > d->length) {
+        code = gs_note_error(gs_error_ioerror);
+        goto exit;
+    }
+    d->first = (uint32_t)First;
+    d->num_entries = (uint32_t)num_entries;
+
+    if (num_entries > 0) {
+        d->offsets = (int *)gs_alloc_bytes(ctx->memory, num_entries * 2 * sizeof(int), "pdfi_decode_objstm (offsets)");
+        if (d->offsets == NULL) {
+            code = gs_note_error(gs_error_VMerror);
+            goto exit;
+        }
+    }
+
+    code = pdfi_open_memory_stream_from_memory(ctx, d->length, d->data, &header_stream, true);
+    if (code < 0)
+        goto exit;
+
+    for (i=0;i < num_entries;i++)
+    {
+        code = pdfi_read_bare_int(ctx, header_stream, &d->offsets[i * 2]);
+        if (code < 0)
+            goto exit;
+        if (code == 0) {
+            code = gs_note_error(gs_error_syntaxerror);
+            goto exit;
+        }
+        code = pdfi_read_bare_int(ctx, header_stream, &d->offsets[i * 2 + 1]);
+        if (code < 0)
+            goto exit;
+        if (code == 0) {
+            code = gs_note_error(gs_error_syntaxerror);
+            goto exit;
+        }
+    }
+    code = 0;
+    *objstm = d;
+
+ exit:
+    if (header_stream)
+        pdfi_close_memory_stream(ctx, NULL, header_stream);
+    if (compressed_stream)
+        pdfi_close_file(ctx, compressed_stream);
+    if (SubFile_stream)
+        pdfi_close_file(ctx, SubFile_stream);
+    if (code < 0)
+        pdfi_free_objstm_data(ctx, d);
+    return code;
+}
+
+/* Keep the decoded ObjStm with the ObjStm's own cache entry, if it's not too large.
+ * Otherwise keep it as the last ObjStm decoded, replacing the previous one, so that
+ * reading the objects of a large ObjStm in turn only decodes it once.
+ */
+static void pdfi_cache_objstm(pdf_context *ctx, pdf_stream *compressed_object,
+                              pdf_obj_cache_entry *cache_entry, pdf_objstm_data *objstm)
+{
+    uint64_t size = pdfi_objstm_size(objstm);
+
+    if (cache_entry == NULL || size > ctx->args.objectcachesize / 4) {
+        pdfi_free_last_objstm(ctx);
+        ctx->last_objstm = objstm;
+        ctx->last_objstm_num = compressed_object->object_num;
+        ctx->last_objstm_offset = pdfi_stream_offset(ctx, compressed_object);
+        return;
+    }
+
+    cache_entry->objstm = objstm;
+    cache_entry->size += size;
+    ctx->cache_bytes += size;
+    pdfi_promote_cache_entry(ctx, cache_entry);
+    while (ctx->cache_bytes > ctx->args.objectcachesize && ctx->cache_LRU != cache_entry)
+        pdfi_evict_cache_entry(ctx);
+    if (ctx->cache_bytes > ctx->peak_cache_bytes)
+        ctx->peak_cache_bytes = ctx->cache_bytes;
+}
+
 static int pdfi_deref_compressed(pdf_context *ctx, uint64_t obj, uint64_t gen, pdf_obj **object,
                                  const xref_entry *entry, bool cache)
 {
     int code = 0;
     xref_entry *compressed_entry;
-    pdf_c_stream *compressed_stream = NULL;
-    pdf_c_stream *SubFile_stream = NULL;
+    pdf_obj_cache_entry *compressed_cache;
     pdf_c_stream *Object_stream = NULL;
-    int i = 0, object_length = 0;
+    int object_length = 0;
     int64_t num_entries;
-    int found_object;
     int64_t Length, First;
-    gs_offset_t offset = 0;
+    int offset = 0;
+    uint32_t index, skip, window;
     pdf_stream *compressed_object = NULL;
     pdf_dict *compressed_sdict = NULL; /* alias */
     pdf_name *Type = NULL;
+    pdf_objstm_data *objstm = NULL;
 
     if (entry->u.compressed.compressed_stream_num > ctx->xref_table->xref_size - 1)
         return_error(gs_error_undefined);
@@ -610,10 +914,9 @@ static int pdfi_deref_compressed(pdf_context *ctx, uint64_t obj, uint64_t gen, p
         dmprintf1(ctx->memory, " from ObjStm with object number %"PRIi64"\n", compressed_entry->object_num);
     }
 
-    if (compressed_entry->cache == NULL) {
-#if CACHE_STATISTICS
+    compressed_cache = pdfi_cache_entry(ctx, entry->u.compressed.compressed_stream_num);
+    if (compressed_cache == NULL) {
         ctx->compressed_misses++;
-#endif
         code = pdfi_seek(ctx, ctx->main_stream, compressed_entry->u.uncompressed.offset, SEEK_SET);
         if (code < 0)
             goto exit;
@@ -645,188 +948,132 @@ static int pdfi_deref_compressed(pdf_context *ctx, uint64_t obj, uint64_t gen, p
         if (code < 0)
             goto exit;
     } else {
-#if CACHE_STATISTICS
         ctx->compressed_hits++;
-#endif
-        compressed_object = (pdf_stream *)compressed_entry->cache->o;
+        compressed_object = (pdf_stream *)compressed_cache->o;
         pdfi_countup(compressed_object);
-        pdfi_promote_cache_entry(ctx, compressed_entry->cache);
+        pdfi_promote_cache_entry(ctx, compressed_cache);
     }
-    code = pdfi_dict_from_obj(ctx, (pdf_obj *)compressed_object, &compressed_sdict);
-    if (code < 0)
-        return code;
-
-    if (ctx->loop_detection != NULL) {
-        code = pdfi_loop_detector_mark(ctx);
+    /* If we've already decompressed this ObjStm, then the data and the table of
+     * objects in it are held with its cache entry, or as the last ObjStm decoded.
+     * Otherwise decompress it now and keep it.
+     */
+    compressed_cache = pdfi_cache_entry(ctx, entry->u.compressed.compressed_stream_num);
+    if (compressed_cache != NULL && compressed_cache->o == (pdf_obj *)compressed_object &&
+        compressed_cache->objstm != NULL) {
+        objstm = compressed_cache->objstm;
+    } else if (ctx->last_objstm != NULL && ctx->last_objstm_num == compressed_object->object_num &&
+               ctx->last_objstm_offset == pdfi_stream_offset(ctx, compressed_object)) {
+        objstm = ctx->last_objstm;
+    } else {
+        code = pdfi_dict_from_obj(ctx, (pdf_obj *)compressed_object, &compressed_sdict);
         if (code < 0)
             goto exit;
-        if (compressed_sdict->object_num != 0) {
-            if (pdfi_loop_detector_check_object(ctx, compressed_sdict->object_num)) {
-                code = gs_note_error(gs_error_circular_reference);
-            } else {
-                code = pdfi_loop_detector_add_object(ctx, compressed_sdict->object_num);
-            }
-            if (code < 0) {
-                (void)pdfi_loop_detector_cleartomark(ctx);
+
+        if (ctx->loop_detection != NULL) {
+            code = pdfi_loop_detector_mark(ctx);
+            if (code < 0)
                 goto exit;
+            if (compressed_sdict->object_num != 0) {
+                if (pdfi_loop_detector_check_object(ctx, compressed_sdict->object_num)) {
+                    code = gs_note_error(gs_error_circular_reference);
+                } else {
+                    code = pdfi_loop_detector_add_object(ctx, compressed_sdict->object_num);
+                }
+                if (code < 0) {
+                    (void)pdfi_loop_detector_cleartomark(ctx);
+                    goto exit;
+                }
             }
         }
-    }
-    /* Check its an ObjStm ! */
-    code = pdfi_dict_get_type(ctx, compressed_sdict, "Type", PDF_NAME, (pdf_obj **)&Type);
-    if (code < 0) {
-        if (ctx->loop_detection != NULL)
-            (void)pdfi_loop_detector_cleartomark(ctx);
-        goto exit;
-    }
+        /* Check its an ObjStm ! */
+        code = pdfi_dict_get_type(ctx, compressed_sdict, "Type", PDF_NAME, (pdf_obj **)&Type);
+        if (code < 0) {
+            if (ctx->loop_detection != NULL)
+                (void)pdfi_loop_detector_cleartomark(ctx);
+            goto exit;
+        }
 
-    if (!pdfi_name_is(Type, "ObjStm")){
-        if (ctx->loop_detection != NULL)
-            (void)pdfi_loop_detector_cleartomark(ctx);
-        code = gs_note_error(gs_error_syntaxerror);
-        goto exit;
-    }
+        if (!pdfi_name_is(Type, "ObjStm")){
+            if (ctx->loop_detection != NULL)
+                (void)pdfi_loop_detector_cleartomark(ctx);
+            code = gs_note_error(gs_error_syntaxerror);
+            goto exit;
+        }
 
-    /* Need to check the /N entry to see if the object is actually in this stream! */
-    code = pdfi_dict_get_int(ctx, compressed_sdict, "N", &num_entries);
-    if (code < 0) {
-        if (ctx->loop_detection != NULL)
-            (void)pdfi_loop_detector_cleartomark(ctx);
-        goto exit;
-    }
+        /* Need to check the /N entry to see if the object is actually in this stream! */
+        code = pdfi_dict_get_int(ctx, compressed_sdict, "N", &num_entries);
+        if (code < 0) {
+            if (ctx->loop_detection != NULL)
+                (void)pdfi_loop_detector_cleartomark(ctx);
+            goto exit;
+        }
 
-    if (num_entries < 0 || num_entries > ctx->xref_table->xref_size) {
-        if (ctx->loop_detection != NULL)
-            (void)pdfi_loop_detector_cleartomark(ctx);
-        code = gs_note_error(gs_error_rangecheck);
-        goto exit;
-    }
+        if (num_entries < 0 || num_entries > ctx->xref_table->xref_size) {
+            if (ctx->loop_detection != NULL)
+                (void)pdfi_loop_detector_cleartomark(ctx);
+            code = gs_note_error(gs_error_rangecheck);
+            goto exit;
+        }
 
-    code = pdfi_dict_get_int(ctx, compressed_sdict, "Length", &Length);
-    if (code < 0) {
-        if (ctx->loop_detection != NULL)
-            (void)pdfi_loop_detector_cleartomark(ctx);
-        goto exit;
-    }
+        code = pdfi_dict_get_int(ctx, compressed_sdict, "Length", &Length);
+        if (code < 0) {
+            if (ctx->loop_detection != NULL)
+                (void)pdfi_loop_detector_cleartomark(ctx);
+            goto exit;
+        }
+
+        code = pdfi_dict_get_int(ctx, compressed_sdict, "First", &First);
+        if (code < 0) {
+            if (ctx->loop_detection != NULL)
+                (void)pdfi_loop_detector_cleartomark(ctx);
+            goto exit;
+        }
 
-    code = pdfi_dict_get_int(ctx, compressed_sdict, "First", &First);
-    if (code < 0) {
         if (ctx->loop_detection != NULL)
             (void)pdfi_loop_detector_cleartomark(ctx);
-        goto exit;
-    }
-
-    if (ctx->loop_detection != NULL)
-        (void)pdfi_loop_detector_cleartomark(ctx);
-
-    code = pdfi_seek(ctx, ctx->main_stream, pdfi_stream_offset(ctx, compressed_object), SEEK_SET);
-    if (code < 0)
-        goto exit;
-
-    code = pdfi_apply_SubFileDecode_filter(ctx, Length, NULL, ctx->main_stream, &SubFile_stream, false);
-    if (code < 0)
-        goto exit;
-
-    code = pdfi_filter(ctx, compressed_object, SubFile_stream, &compressed_stream, false);
-    if (code < 0)
-        goto exit;
 
-    for (i=0;i < num_entries;i++)
-    {
-        int new_offset;
-        code = pdfi_read_bare_int(ctx, compressed_stream, &found_object);
-        if (code < 0)
-            goto exit;
-        if (code == 0) {
-            code = gs_note_error(gs_error_syntaxerror);
-            goto exit;
-        }
-        code = pdfi_read_bare_int(ctx, compressed_stream, &new_offset);
+        code = pdfi_decode_objstm(ctx, compressed_object, Length, First, num_entries, &objstm);
         if (code < 0)
             goto exit;
-        if (code == 0) {
-            code = gs_note_error(gs_error_syntaxerror);
+
+        compressed_cache = pdfi_cache_entry(ctx, entry->u.compressed.compressed_stream_num);
+        pdfi_cache_objstm(ctx, compressed_object,
+                          compressed_cache != NULL && compressed_cache->o == (pdf_obj *)compressed_object ?
+                          compressed_cache : NULL, objstm);
+    }
+
+    index = entry->u.compressed.object_index;
+    if (index < objstm->num_entries) {
+        if (objstm->offsets[index * 2] != obj) {
+            code = gs_note_error(gs_error_undefined);
             goto exit;
         }
-        if (i == entry->u.compressed.object_index) {
-            if (found_object != obj) {
-                code = gs_note_error(gs_error_undefined);
-                goto exit;
-            }
-            offset = new_offset;
-        }
-        if (i == entry->u.compressed.object_index + 1)
-            object_length = new_offset - offset;
+        offset = objstm->offsets[index * 2 + 1];
+        if (index + 1 < objstm->num_entries)
+            object_length = objstm->offsets[(index + 1) * 2 + 1] - offset;
     }
 
     /* Bug #705259 - The first object need not lie immediately after the initial
      * table of object numbers and offsets. The start of the first object is given
-     * by the value of First. We don't know how many bytes we consumed getting to
-     * the end of the table, unfortunately, so we close the stream, rewind the main
-     * stream back to the beginning of the ObjStm, and then read and discard 'First'
-     * bytes in order to get to the start of the first object. Then we read the
-     * number of bytes required to get from there to the start of the object we
-     * actually want.
-     * If this ever looks like it's causing performance problems we could read the
-     * initial table above manually instead of using the existing code, and track
-     * how many bytes we'd read, which would avoid us having to tear down and
-     * rebuild the stream.
+     * by the value of First, and the offsets in the table are relative to that.
      */
-    if (compressed_stream)
-        pdfi_close_file(ctx, compressed_stream);
-    if (SubFile_stream)
-        pdfi_close_file(ctx, SubFile_stream);
-
-    code = pdfi_seek(ctx, ctx->main_stream, pdfi_stream_offset(ctx, compressed_object), SEEK_SET);
-    if (code < 0)
+    if (offset > 0 && (uint32_t)offset > objstm->length - objstm->first) {
+        code = gs_note_error(gs_error_ioerror);
         goto exit;
-
-    /* We already dereferenced this above, so we don't need the loop detection checking here */
-    code = pdfi_dict_get_int(ctx, compressed_sdict, "Length", &Length);
-    if (code < 0)
-        goto exit;
-
-    code = pdfi_apply_SubFileDecode_filter(ctx, Length, NULL, ctx->main_stream, &SubFile_stream, false);
-    if (code < 0)
-        goto exit;
-
-    code = pdfi_filter(ctx, compressed_object, SubFile_stream, &compressed_stream, false);
-    if (code < 0)
-        goto exit;
-
-    for (i=0;i < First;i++)
-    {
-        int c = pdfi_read_byte(ctx, compressed_stream);
-        if (c < 0) {
-            code = gs_note_error(gs_error_ioerror);
-            goto exit;
-        }
     }
+    skip = objstm->first + (offset > 0 ? offset : 0);
 
-    /* Skip to the offset of the object we want to read */
-    for (i=0;i < offset;i++)
-    {
-        int c = pdfi_read_byte(ctx, compressed_stream);
-        if (c < 0) {
-            code = gs_note_error(gs_error_ioerror);
-            goto exit;
-        }
-    }
-
-    /* If object_length is not 0, then we want to apply a SubFileDecode filter to limit
-     * the number of bytes we read to the declared size of the object (difference between
-     * the offsets of the object we want to read, and the next object). If it is 0 then
-     * we're reading the last object in the stream, so we just rely on the SubFileDecode
-     * we set up when we created compressed_stream to limit the bytes to the length of
-     * that stream.
+    /* If object_length is not 0, then we want to limit the number of bytes we read
+     * to the declared size of the object (difference between the offsets of the object
+     * we want to read, and the next object). If it is 0 then we're reading the last
+     * object in the stream, so we just limit the bytes to the length of the stream.
      */
-    if (object_length > 0) {
-        code = pdfi_apply_SubFileDecode_filter(ctx, object_length, NULL, compressed_stream, &Object_stream, false);
-        if (code < 0)
-            goto exit;
-    } else {
-        Object_stream = compressed_stream;
-    }
+    window = objstm->length - skip;
+    if (object_length > 0 && (uint32_t)object_length < window)
+        window = object_length;
+    code = pdfi_open_memory_stream_from_memory(ctx, window, objstm->data + skip, &Object_stream, true);
+    if (code < 0)
+        goto exit;
 
     code = pdfi_read_token(ctx, Object_stream, obj, gen);
     if (code < 0)
@@ -847,7 +1094,8 @@ static int pdfi_deref_compressed(pdf_context *ctx, uint64_t obj, uint64_t gen, p
                 code = gs_note_error(gs_error_syntaxerror);
                 goto exit;
             }
-            if (compressed_stream->eof == true) {
+            /* Running out of the ObjStm itself in the middle of an object is an error */
+            if (skip + window == objstm->length && Object_stream->eof == true) {
                 code = gs_note_error(gs_error_ioerror);
                 goto exit;
             }
@@ -865,6 +1113,10 @@ static int pdfi_deref_compressed(pdf_context *ctx, uint64_t obj, uint64_t gen, p
     }
     pdfi_pop(ctx, 1);
 
+    /* Done with the ObjStm data, which adding the object to the cache might evict */
+    pdfi_close_memory_stream(ctx, NULL, Object_stream);
+    Object_stream = NULL;
+
     if (cache) {
         code = pdfi_add_to_cache(ctx, *object);
         if (code < 0) {
@@ -875,12 +1127,7 @@ static int pdfi_deref_compressed(pdf_context *ctx, uint64_t obj, uint64_t gen, p
 
  exit:
     if (Object_stream)
-        pdfi_close_file(ctx, Object_stream);
-    if (Object_stream != compressed_stream)
-        if (compressed_stream)
-            pdfi_close_file(ctx, compressed_stream);
-    if (SubFile_stream)
-        pdfi_close_file(ctx, SubFile_stream);
+        pdfi_close_memory_stream(ctx, NULL, Object_stream);
     pdfi_countdown(compressed_object);
     pdfi_countdown(Type);
     return code;
@@ -892,6 +1139,7 @@ static int pdfi_deref_compressed(pdf_context *ctx, uint64_t obj, uint64_t gen, p
 static int pdfi_dereference_main(pdf_context *ctx, uint64_t obj, uint64_t gen, pdf_obj **object, bool cache)
 {
     xref_entry *entry;
+    pdf_obj_cache_entry *cache_entry;
     int code, stack_depth = pdfi_count_stack(ctx);
     gs_offset_t saved_stream_offset;
     bool saved_decrypt_strings = ctx->encryption.decrypt_strings;
@@ -948,12 +1196,9 @@ static int pdfi_dereference_main(pdf_context *ctx, uint64_t obj, uint64_t gen, p
                 return code;
         }
     }
-    if (entry->cache != NULL){
-        pdf_obj_cache_entry *cache_entry = entry->cache;
-
-#if CACHE_STATISTICS
+    cache_entry = pdfi_cache_entry(ctx, obj);
+    if (cache_entry != NULL){
         ctx->hits++;
-#endif
         *object = cache_entry->o;
         pdfi_countup(*object);
 
@@ -969,9 +1214,7 @@ static int pdfi_dereference_main(pdf_context *ctx, uint64_t obj, uint64_t gen, p
             if (code < 0 || *object == NULL)
                 goto error;
         } else {
-#if CACHE_STATISTICS
             ctx->misses++;
-#endif
             ctx->encryption.decrypt_strings = true;
 
             code = pdfi_seek(ctx, ctx->main_stream, entry->u.uncompressed.offset, SEEK_SET);
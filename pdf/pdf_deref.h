@@ -17,6 +17,8 @@
 #define PDF_DEREFERENCE
 
 int replace_cache_entry(pdf_context *ctx, pdf_obj *o);
+void pdfi_free_objstm_data(pdf_context *ctx, pdf_objstm_data *objstm);
+void pdfi_free_last_objstm(pdf_context *ctx);
 int is_compressed_object(pdf_context *ctx, uint32_t obj, uint32_t gen);
 int pdfi_dereference(pdf_context *ctx, uint64_t obj, uint64_t gen, pdf_obj **object);
 int pdfi_dereference_nocache(pdf_context *ctx, uint64_t obj, uint64_t gen, pdf_obj **object);
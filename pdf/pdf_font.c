@@ -39,6 +39,7 @@
 #include "strmio.h"
 #include "stream.h"
 #include "gsstate.h"            /* For gs_setPDFfontsize() */
+#include "gxsync.h"
 
 extern single_glyph_list_t SingleGlyphList[];
 
@@ -152,6 +153,185 @@ pdfi_font_match_glyph_widths(pdf_font *pdfont)
     return code;
 }
 
+/* The font files used by the page workers of a document: the contents of
+ * the embedded FontFile streams, by object number, and of the font files
+ * read from disk, by file name. Whichever worker needs a file first reads
+ * it and adds it; after that it is only read, until the workers are done
+ * and the cache is freed.
+ */
+typedef struct pdfi_font_file_s pdfi_font_file_t;
+
+struct pdfi_font_file_s {
+    pdfi_font_file_t *next;
+    uint64_t object_num;        /* of a FontFile stream, or 0 */
+    char *name;                 /* of a file on disk, or NULL */
+    byte *data;
+    int64_t length;
+};
+
+struct pdfi_font_files_s {
+    gs_memory_t *memory;        /* thread safe */
+    gx_monitor_t *lock;
+    pdfi_font_file_t *files;
+};
+
+int pdfi_font_files_alloc(gs_memory_t *mem, pdfi_font_files_t **pfiles)
+{
+    pdfi_font_files_t *files;
+
+    *pfiles = NULL;
+    files = (pdfi_font_files_t *)gs_alloc_bytes(mem, sizeof(pdfi_font_files_t), "pdfi_font_files_alloc");
+    if (files == NULL)
+        return_error(gs_error_VMerror);
+    files->memory = mem;
+    files->files = NULL;
+    files->lock = gx_monitor_alloc(mem);
+    if (files->lock == NULL) {
+        gs_free_object(mem, files, "pdfi_font_files_alloc");
+        return_error(gs_error_VMerror);
+    }
+    *pfiles = files;
+    return 0;
+}
+
+void pdfi_font_files_free(pdfi_font_files_t *files)
+{
+    pdfi_font_file_t *file, *next;
+
+    if (files == NULL)
+        return;
+
+    for (file = files->files; file != NULL; file = next) {
+        next = file->next;
+        gs_free_object(files->memory, file->data, "pdfi_font_files_free");
+        gs_free_object(files->memory, file->name, "pdfi_font_files_free");
+        gs_free_object(files->memory, file, "pdfi_font_files_free");
+    }
+    gx_monitor_free(files->lock);
+    gs_free_object(files->memory, files, "pdfi_font_files_free");
+}
+
+static pdfi_font_file_t *pdfi_font_files_lookup(pdfi_font_files_t *files, uint64_t object_num, const char *name)
+{
+    pdfi_font_file_t *file;
+
+    for (file = files->files; file != NULL; file = file->next) {
+        if (name != NULL ? file->name != NULL && strcmp(file->name, name) == 0 : file->object_num == object_num)
+            break;
+    }
+    return file;
+}
+
+/* Copy a font file out of the shared cache, returns 1 if it was there */
+static int pdfi_font_files_get(pdf_context *ctx, uint64_t object_num, const char *name, byte **buf, int64_t *buflen)
+{
+    pdfi_font_files_t *files = ctx->font_files;
+    pdfi_font_file_t *file;
+    int code = 0;
+
+    if (files == NULL)
+        return 0;
+
+    gx_monitor_enter(files->lock);
+    file = pdfi_font_files_lookup(files, object_num, name);
+    if (file != NULL) {
+        *buf = gs_alloc_bytes(ctx->memory, file->length, "pdfi_font_files_get(buf)");
+        if (*buf == NULL)
+            code = gs_note_error(gs_error_VMerror);
+        else {
+            memcpy(*buf, file->data, file->length);
+            *buflen = file->length;
+            code = 1;
+        }
+    }
+    gx_monitor_leave(files->lock);
+    return code;
+}
+
+/* Add a copy of a font file to the shared cache, if we can */
+static void pdfi_font_files_add(pdf_context *ctx, uint64_t object_num, const char *name, const byte *buf, int64_t buflen)
+{
+    pdfi_font_files_t *files = ctx->font_files;
+    pdfi_font_file_t *file;
+
+    if (files == NULL || buflen <= 0)
+        return;
+
+    gx_monitor_enter(files->lock);
+    /* Another worker may have got here first */
+    if (pdfi_font_files_lookup(files, object_num, name) == NULL) {
+        file = (pdfi_font_file_t *)gs_alloc_bytes(files->memory, sizeof(pdfi_font_file_t), "pdfi_font_files_add");
+        if (file != NULL) {
+            file->object_num = object_num;
+            file->name = NULL;
+            file->length = buflen;
+            file->data = gs_alloc_bytes(files->memory, buflen, "pdfi_font_files_add(data)");
+            if (name != NULL)
+                file->name = (char *)gs_alloc_bytes(files->memory, strlen(name) + 1, "pdfi_font_files_add(name)");
+            if (file->data == NULL || (name != NULL && file->name == NULL)) {
+                gs_free_object(files->memory, file->data, "pdfi_font_files_add(data)");
+                gs_free_object(files->memory, file->name, "pdfi_font_files_add(name)");
+                gs_free_object(files->memory, file, "pdfi_font_files_add");
+            }
+            else {
+                memcpy(file->data, buf, buflen);
+                if (name != NULL)
+                    strcpy(file->name, name);
+                file->next = files->files;
+                files->files = file;
+            }
+        }
+    }
+    gx_monitor_leave(files->lock);
+}
+
+/* Decode an embedded font file */
+static int pdfi_font_stream_to_buffer(pdf_context *ctx, pdf_stream *fontfile, byte **buf, int64_t *buflen)
+{
+    uint64_t object_num = pdf_object_num((pdf_obj *)fontfile);
+    int code;
+
+    if (object_num != 0) {
+        code = pdfi_font_files_get(ctx, object_num, NULL, buf, buflen);
+        if (code != 0)
+            return code < 0 ? code : 0;
+    }
+    code = pdfi_stream_to_buffer(ctx, fontfile, buf, buflen);
+    if (code >= 0 && object_num != 0)
+        pdfi_font_files_add(ctx, object_num, NULL, *buf, *buflen);
+    return code;
+}
+
+/* Read the whole of a font file from disk */
+static int pdfi_font_file_to_buffer(pdf_context *ctx, stream *s, byte **buf, int64_t *buflen)
+{
+    char name[gp_file_name_sizeof];
+    gs_const_string fname;
+    int code;
+
+    sfilename(s, &fname);
+    if (fname.size < gp_file_name_sizeof) {
+        memcpy(name, fname.data, fname.size);
+        name[fname.size] = '\0';
+        code = pdfi_font_files_get(ctx, 0, name, buf, buflen);
+        if (code != 0)
+            return code < 0 ? code : 0;
+    }
+    else
+        name[0] = '\0';
+
+    sfseek(s, 0, SEEK_END);
+    *buflen = sftell(s);
+    sfseek(s, 0, SEEK_SET);
+    *buf = gs_alloc_bytes(ctx->memory, *buflen, "pdfi_font_file_to_buffer(buf)");
+    if (*buf == NULL)
+        return_error(gs_error_VMerror);
+    sfread(*buf, 1, *buflen, s);
+    if (name[0] != '\0')
+        pdfi_font_files_add(ctx, 0, name, *buf, *buflen);
+    return 0;
+}
+
 /* Print a name object to stdout */
 static void pdfi_print_font_name(pdf_context *ctx, pdf_name *n)
 {
@@ -281,16 +461,7 @@ pdfi_open_CIDFont_substitute_file(pdf_context *ctx, pdf_dict *font_dict, pdf_dic
                     pdfi_print_cstring(ctx, "\n");
 
 
-                    sfseek(s, 0, SEEK_END);
-                    *buflen = sftell(s);
-                    sfseek(s, 0, SEEK_SET);
-                    *buf = gs_alloc_bytes(ctx->memory, *buflen, "pdfi_open_CIDFont_file(buf)");
-                    if (*buf != NULL) {
-                        sfread(*buf, 1, *buflen, s);
-                    }
-                    else {
-                        code = gs_note_error(gs_error_VMerror);
-                    }
+                    code = pdfi_font_file_to_buffer(ctx, s, buf, buflen);
                     sfclose(s);
                 }
             }
@@ -326,16 +497,7 @@ pdfi_open_CIDFont_substitute_file(pdf_context *ctx, pdf_dict *font_dict, pdf_dic
                 }
                 pdfi_print_cstring(ctx, fontfname);
                 pdfi_print_cstring(ctx, "\n");
-                sfseek(s, 0, SEEK_END);
-                *buflen = sftell(s);
-                sfseek(s, 0, SEEK_SET);
-                *buf = gs_alloc_bytes(ctx->memory, *buflen, "pdfi_open_CIDFont_file(buf)");
-                if (*buf != NULL) {
-                    sfread(*buf, 1, *buflen, s);
-                }
-                else {
-                    code = gs_note_error(gs_error_VMerror);
-                }
+                code = pdfi_font_file_to_buffer(ctx, s, buf, buflen);
                 sfclose(s);
             }
         }
@@ -359,16 +521,9 @@ pdfi_open_CIDFont_substitute_file(pdf_context *ctx, pdf_dict *font_dict, pdf_dic
             code = gs_note_error(gs_error_invalidfont);
         }
         else {
-            sfseek(s, 0, SEEK_END);
-            *buflen = sftell(s);
-            sfseek(s, 0, SEEK_SET);
-            *buf = gs_alloc_bytes(ctx->memory, *buflen, "pdfi_open_CIDFont_file(buf)");
-            if (*buf != NULL) {
-                sfread(*buf, 1, *buflen, s);
-            }
-            else {
+            code = pdfi_font_file_to_buffer(ctx, s, buf, buflen);
+            if (code < 0)
                 code = gs_note_error(gs_error_invalidfont);
-            }
             sfclose(s);
         }
     }
@@ -651,7 +806,7 @@ static int pdfi_load_font_file(pdf_context *ctx, int fftype, pdf_name *Subtype,
     const char *fn;
     int findex = 0;
     byte *buf;
-    int buflen;
+    int64_t buflen;
     pdf_font *pdffont = NULL;
     pdf_font *substpdffont = NULL;
     bool f_retry = true;
@@ -766,16 +921,7 @@ static int pdfi_load_font_file(pdf_context *ctx, int fftype, pdf_name *Subtype,
                 else {
                     strcpy(fontfname, "unnamed file");
                 }
-                sfseek(s, 0, SEEK_END);
-                buflen = sftell(s);
-                sfseek(s, 0, SEEK_SET);
-                buf = gs_alloc_bytes(ctx->memory, buflen, "pdfi_open_t1_font_file(buf)");
-                if (buf != NULL) {
-                    sfread(buf, 1, buflen, s);
-                }
-                else {
-                    code = gs_note_error(gs_error_VMerror);
-                }
+                code = pdfi_font_file_to_buffer(ctx, s, &buf, &buflen);
                 sfclose(s);
                 /* Buffer owership moves to the font object */
                 code = pdfi_load_font_buffer(ctx, buf, buflen, no_type_font, NULL, findex, stream_dict, page_dict, NULL, &pdffont, false);
@@ -934,7 +1080,7 @@ int pdfi_load_font(pdf_context *ctx, pdf_dict *stream_dict, pdf_dict *page_dict,
         }
 
         if (fontfile != NULL) {
-            code = pdfi_stream_to_buffer(ctx, (pdf_stream *) fontfile, &fbuf, &fbuflen);
+            code = pdfi_font_stream_to_buffer(ctx, (pdf_stream *) fontfile, &fbuf, &fbuflen);
             pdfi_countdown(fontfile);
             if (fbuflen == 0) {
                 char obj[129];
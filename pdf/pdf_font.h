@@ -57,6 +57,12 @@ static inline pdf_font *pdfi_get_current_pdf_font(pdf_context *ctx)
     return NULL;
 }
 
+/* The font files shared by the page workers of a document (pdftop.c) */
+typedef struct pdfi_font_files_s pdfi_font_files_t;
+
+int pdfi_font_files_alloc(gs_memory_t *mem, pdfi_font_files_t **pfiles);
+void pdfi_font_files_free(pdfi_font_files_t *files);
+
 int pdfi_create_Widths(pdf_context *ctx, pdf_dict *font_dict, pdf_font *pdffont);
 int pdfi_create_Encoding(pdf_context *ctx, pdf_obj *pdf_Encoding, pdf_obj *font_Encoding, pdf_obj **Encoding);
 gs_glyph pdfi_encode_char(gs_font * pfont, gs_char chr, gs_glyph_space_t not_used);
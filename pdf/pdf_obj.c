@@ -208,6 +208,102 @@ int pdfi_num_alloc(pdf_context *ctx, double d, pdf_num **num)
     return 0;
 }
 
+static int pdfi_obj_copy_direct_inner(pdf_context *ctx, pdf_obj *o, pdf_obj **copy, int depth)
+{
+    pdf_obj *c = NULL;
+    uint64_t i;
+    int code = 0;
+
+    *copy = NULL;
+    if ((uintptr_t)o <= TOKEN__LAST_KEY) {
+        /* null, true, false and the fast keywords aren't allocated */
+        *copy = o;
+        return 0;
+    }
+    if (depth > MAX_NESTING_DEPTH)
+        return_error(gs_error_limitcheck);
+
+    switch (pdfi_type_of(o)) {
+        case PDF_INT:
+        case PDF_REAL:
+            code = pdfi_object_alloc(ctx, pdfi_type_of(o), 0, &c);
+            if (code < 0)
+                return code;
+            ((pdf_num *)c)->value = ((pdf_num *)o)->value;
+            break;
+        case PDF_NAME:
+        case PDF_STRING:
+            code = pdfi_object_alloc(ctx, pdfi_type_of(o), ((pdf_string *)o)->length, &c);
+            if (code < 0)
+                return code;
+            memcpy(((pdf_string *)c)->data, ((pdf_string *)o)->data, ((pdf_string *)o)->length);
+            break;
+        case PDF_INDIRECT:
+            code = pdfi_object_alloc(ctx, PDF_INDIRECT, 0, &c);
+            if (code < 0)
+                return code;
+            ((pdf_indirect_ref *)c)->ref_object_num = ((pdf_indirect_ref *)o)->ref_object_num;
+            ((pdf_indirect_ref *)c)->ref_generation_num = ((pdf_indirect_ref *)o)->ref_generation_num;
+            break;
+        case PDF_ARRAY:
+            {
+                pdf_array *a = (pdf_array *)o;
+
+                code = pdfi_object_alloc(ctx, PDF_ARRAY, a->size, &c);
+                if (code < 0)
+                    return code;
+                for (i = 0; i < a->size; i++) {
+                    code = pdfi_obj_copy_direct_inner(ctx, a->values[i], &((pdf_array *)c)->values[i], depth + 1);
+                    if (code < 0)
+                        break;
+                }
+            }
+            break;
+        case PDF_DICT:
+            {
+                pdf_dict *d = (pdf_dict *)o;
+
+                code = pdfi_object_alloc(ctx, PDF_DICT, d->size, &c);
+                if (code < 0)
+                    return code;
+                for (i = 0; i < d->entries; i++) {
+                    code = pdfi_obj_copy_direct_inner(ctx, d->list[i].key, &((pdf_dict *)c)->list[i].key, depth + 1);
+                    if (code >= 0)
+                        code = pdfi_obj_copy_direct_inner(ctx, d->list[i].value, &((pdf_dict *)c)->list[i].value, depth + 1);
+                    ((pdf_dict *)c)->entries = i + 1;
+                    if (code < 0)
+                        break;
+                }
+                ((pdf_dict *)c)->is_sorted = d->is_sorted;
+            }
+            break;
+        default:
+            /* Streams and the interpreter's own objects can't be copied */
+            return_error(gs_error_typecheck);
+    }
+    c->object_num = o->object_num;
+    c->generation_num = o->generation_num;
+    c->indirect_num = o->indirect_num;
+    c->indirect_gen = o->indirect_gen;
+    pdfi_countup(c);
+    if (code < 0) {
+        pdfi_countdown(c);
+        return code;
+    }
+    *copy = c;
+    return 0;
+}
+
+/* Make a copy of a direct object, which may belong to another context, in
+ * this context. Arrays and dictionaries are copied in full. The source is
+ * only read, its reference counts are not touched, so the other context
+ * need not be one we may use. Returns the copy with a reference count of 1.
+ */
+int pdfi_obj_copy_direct(pdf_context *ctx, pdf_obj *o, pdf_obj **copy)
+{
+    return pdfi_obj_copy_direct_inner(ctx, o, copy, 0);
+}
+
 /***********************************************************************************/
 /* Functions to free the various kinds of 'PDF objects'.                           */
 /* All objects are reference counted, newly allocated objects, as noted above have */
@@ -235,7 +331,9 @@ static void pdfi_free_xref_table(pdf_obj *o)
 {
     xref_table_t *xref = (xref_table_t *)o;
 
-    gs_free_object(OBJ_MEMORY(xref), xref->xref, "pdfi_free_xref_table");
+    if (!xref->shared)
+        gs_free_object(OBJ_MEMORY(xref), xref->xref, "pdfi_free_xref_table");
+    gs_free_object(OBJ_MEMORY(xref), xref->cache, "pdfi_free_xref_table");
     gs_free_object(OBJ_MEMORY(xref), xref, "pdfi_free_xref_table");
 }
 
@@ -25,6 +25,7 @@ int pdfi_obj_charstr_to_string(pdf_context *ctx, const char *charstr, pdf_string
 int pdfi_obj_charstr_to_name(pdf_context *ctx, const char *charstr, pdf_name **name);
 int pdfi_obj_get_label(pdf_context *ctx, pdf_obj *obj, char **label);
 int pdfi_num_alloc(pdf_context *ctx, double d, pdf_num **num);
+int pdfi_obj_copy_direct(pdf_context *ctx, pdf_obj *o, pdf_obj **copy);
 
 static inline int
 pdfi_obj_to_real(pdf_context *ctx, pdf_obj *obj, double *d)
@@ -24,6 +24,7 @@
 #include "pdf_file.h"
 #include "pdf_misc.h"
 #include "pdf_repair.h"
+#include "pdf_xref.h"
 
 static int pdfi_repair_add_object(pdf_context *ctx, int64_t obj, int64_t gen, gs_offset_t offset)
 {
@@ -94,6 +95,11 @@ int pdfi_repair_file(pdf_context *ctx)
         return_error(gs_error_undefined);
     }
 
+    /* The repair adds to the xref, which may be shared (see pdfi_share_xref()) */
+    code = pdfi_unshare_xref(ctx);
+    if (code < 0)
+        return code;
+
     saved_offset = pdfi_unread_tell(ctx);
 
     ctx->repaired = true;
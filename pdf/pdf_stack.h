@@ -91,9 +91,9 @@ static inline void pdfi_countdown_impl(pdf_obj *o)
 #endif
 #ifdef DEBUG
     if (ctx->xref_table != NULL && o->object_num > 0 &&
-        o->object_num < ctx->xref_table->xref_size &&
-        ctx->xref_table->xref[o->object_num].cache != NULL &&
-        ctx->xref_table->xref[o->object_num].cache->o == o) {
+        o->object_num < ctx->xref_table->cache_size &&
+        ctx->xref_table->cache[o->object_num] != NULL &&
+        ctx->xref_table->cache[o->object_num]->o == o) {
         dmprintf1(OBJ_MEMORY(o), "Freeing object %d while it is still in the object cache!\n", o->object_num);
     }
 #endif
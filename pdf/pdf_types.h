@@ -211,10 +211,24 @@ typedef struct pdf_indirect_ref_s {
     bool is_marking; /* Are we in the middle of marking this? */
 } pdf_indirect_ref;
 
+/* The decoded contents of an ObjStm, and the object number/offset pairs from
+ * its header, kept with the cache entry for the ObjStm so that reading
+ * compressed objects does not have to decompress the stream every time.
+ */
+typedef struct pdf_objstm_data_s {
+    byte *data;             /* The decompressed stream */
+    uint32_t length;
+    uint32_t first;         /* Value of /First, the offset of the first object */
+    uint32_t num_entries;   /* Value of /N */
+    int *offsets;           /* num_entries pairs of object number and offset */
+} pdf_objstm_data;
+
 typedef struct pdf_obj_cache_entry_s {
     void *next;
     void *previous;
     pdf_obj *o;
+    uint32_t size;      /* Estimated memory used by 'o' (and objstm), see pdfi_cache_size_of() */
+    pdf_objstm_data *objstm;    /* Only for ObjStm streams, may be NULL */
 }pdf_obj_cache_entry;
 
 /* The compressed and uncompressed xref entries are identical, they only differ
@@ -236,13 +250,20 @@ typedef struct xref_entry_s {
             uint32_t object_index;          /* Index of object in compressed stream */
         }compressed;
     }u;
-    pdf_obj_cache_entry *cache;     /* Pointer to cache entry if cached, or NULL if not */
 } xref_entry;
 
+/* The cache entries for the objects are kept by object number alongside the
+ * xref entries rather than in them, so that the entries can be shared by
+ * the tables of several contexts (the page workers, see pdftop.c), each of
+ * which has its own object cache.
+ */
 typedef struct xref_s {
     pdf_obj_common;
     uint64_t xref_size;
     xref_entry *xref;
+    bool shared;                    /* 'xref' belongs to another table, don't change or free it */
+    uint64_t cache_size;
+    pdf_obj_cache_entry **cache;    /* Pointer to cache entry if cached, or NULL if not */
 } xref_table_t;
 
 #define UNREAD_BUFFER_SIZE 256
@@ -22,6 +22,7 @@
 #include "pdf_loop_detect.h"
 #include "pdf_dict.h"
 #include "pdf_array.h"
+#include "pdf_obj.h"
 #include "pdf_repair.h"
 
 static int resize_xref(pdf_context *ctx, uint64_t new_size)
@@ -114,7 +115,6 @@ static int read_xref_stream_entries(pdf_context *ctx, pdf_c_stream *s, int64_t f
         entry->compressed = false;
         entry->free = false;
         entry->object_num = i;
-        entry->cache = NULL;
 
         switch(type) {
             case 0:
@@ -1136,3 +1136,59 @@ repair:
         return(pdfi_repair_file(ctx));
     return 0;
 }
+
+/* Give a context the xref and trailer which another context has read from
+ * the same file, so that opening the file doesn't read them again (see
+ * pdfi_set_input_stream()). This is for the page workers (pdftop.c); it is
+ * done before they start, while 'from' isn't being used for anything else.
+ * The xref entries are shared, and must not be changed or freed until ctx is
+ * done with them; the trailer is copied, as objects are reference counted.
+ */
+int pdfi_share_xref(pdf_context *ctx, pdf_context *from)
+{
+    xref_table_t *xref;
+    int code;
+
+    if (from->xref_table == NULL || from->Trailer == NULL)
+        return_error(gs_error_undefined);
+
+    code = pdfi_object_alloc(ctx, PDF_XREF_TABLE, 0, (pdf_obj **)&xref);
+    if (code < 0)
+        return code;
+    pdfi_countup(xref);
+    xref->xref_size = from->xref_table->xref_size;
+    xref->xref = from->xref_table->xref;
+    xref->shared = true;
+
+    code = pdfi_obj_copy_direct(ctx, (pdf_obj *)from->Trailer, (pdf_obj **)&ctx->Trailer);
+    if (code < 0) {
+        pdfi_countdown(xref);
+        return code;
+    }
+    ctx->xref_table = xref;
+
+    ctx->HeaderVersion = from->HeaderVersion;
+    ctx->startxref = from->startxref;
+    ctx->prefer_xrefstm = from->prefer_xrefstm;
+    ctx->is_hybrid = from->is_hybrid;
+    ctx->repaired = from->repaired;
+    return 0;
+}
+
+/* Make a shared xref our own, before changing it */
+int pdfi_unshare_xref(pdf_context *ctx)
+{
+    xref_table_t *xref = ctx->xref_table;
+    xref_entry *entries;
+
+    if (xref == NULL || !xref->shared)
+        return 0;
+
+    entries = (xref_entry *)gs_alloc_bytes(ctx->memory, xref->xref_size * sizeof(xref_entry), "pdfi_unshare_xref");
+    if (entries == NULL)
+        return_error(gs_error_VMerror);
+    memcpy(entries, xref->xref, xref->xref_size * sizeof(xref_entry));
+    xref->xref = entries;
+    xref->shared = false;
+    return 0;
+}
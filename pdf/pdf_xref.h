@@ -18,5 +18,7 @@
 #define PDF_XREF_PARSER
 
 int pdfi_read_xref(pdf_context *ctx);
+int pdfi_share_xref(pdf_context *ctx, pdf_context *from);
+int pdfi_unshare_xref(pdf_context *ctx);
 
 #endif
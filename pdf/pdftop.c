@@ -28,20 +28,49 @@
 #include "gsht1.h"
 #include "pdf_device.h"
 #include "pdf_misc.h"
+#include "pdf_page.h"
+#include "pdf_font.h"
+#include "pdf_xref.h"
 
 #include "gsstate.h"        /* For gs_sethalftonephase() */
 #include "gspaint.h"        /* For gs_erasepage() */
 #include "gscolor3.h"       /* For gs_setsmoothness() */
+#include "gslib.h"          /* For gs_lib_init1() */
+#include "gxiodev.h"        /* For gs_iodev_init() */
+#include "gxfapi.h"         /* For gs_fapi_finit() */
+#include "gsmchunk.h"       /* For gs_memory_chunk_wrap() */
+#include "gsicc_manage.h"   /* For gsicc_clone_profile() */
+#include "gdevprn.h"        /* For gx_device_printer */
+#include "gdevdevn.h"       /* For devn_copy_params() */
+#include "gxdevsop.h"
+#include "gdevepo.h"        /* For EPO_DEVICENAME */
+#include "gpsync.h"
 
 extern const char gp_file_name_list_separator;
 
 static int pdfi_install_halftone(pdf_context *ctx, gx_device *pdevice);
 static int pdf_impl_add_path(pl_interp_implementation_t *impl, const char *path);
+static int pdf_impl_set_param(pl_interp_implementation_t *impl, gs_param_list *plist);
+static int pdf_impl_init_job(pl_interp_implementation_t *impl, gx_device *device);
+static int pdf_impl_dnit_job(pl_interp_implementation_t *impl);
+static int pdf_impl_deallocate_interp_instance(pl_interp_implementation_t *impl);
 
 /*
  * The PDF interpreter instance is derived from pl_interp_implementation_t.
  */
 
+/* A copy of one parameter list passed to pdf_impl_set_param. We keep the
+ * latest one for each key (in the order they were set) so that page workers
+ * can replay them into their own contexts.
+ */
+typedef struct pdf_saved_param_s pdf_saved_param_t;
+struct pdf_saved_param_s
+{
+    pdf_saved_param_t *next;
+    gs_c_param_list list;
+    char key[1];                        /* the key pdf_impl_set_param handled, NUL terminated */
+};
+
 typedef struct pdf_interp_instance_s
 {
     gs_memory_t *memory;                /* memory allocator to use */
@@ -49,6 +78,10 @@ typedef struct pdf_interp_instance_s
     pdf_context *ctx;
     gp_file *scratch_file;
     char scratch_name[gp_file_name_sizeof];
+
+    pdf_saved_param_t *saved_params;    /* parameters, in the order they were set */
+    pdf_saved_param_t *last_saved_param;
+    char *saved_paths;                  /* paths from pdf_impl_add_path, separated by gp_file_name_list_separator */
 }pdf_interp_instance_t;
 
 extern const char gp_file_name_list_separator;
@@ -134,6 +167,8 @@ pdf_impl_allocate_interp_instance(pl_interp_implementation_t *impl,
     instance->scratch_file = NULL;
     instance->scratch_name[0] = 0;
     instance->memory = pmem;
+    instance->saved_params = instance->last_saved_param = NULL;
+    instance->saved_paths = NULL;
 
     impl->interp_client_data = instance;
     if (COMPILE_INITS == 1) {
@@ -260,6 +295,365 @@ cleanup_setdevice:
     return code;
 }
 
+/*
+ * Page workers.
+ *
+ * With -dPDFPageWorkers=N, and a printer device which writes each page to
+ * its own file, the pages of a file are shared out between N workers which
+ * render them at the same time. A pdf_context is not thread safe (objects
+ * are reference counted without locking, and so are the fonts and the FAPI
+ * server behind them) so each worker is a complete interpreter instance,
+ * with its own heap and library context, its own context and its own copy
+ * of the device, and its own stream on the file. The parameters and paths
+ * given to this instance are replayed into each worker.
+ *
+ * We open the file first, and keep it open while the workers run, so that
+ * they can share, read only, what we have read of it: the xref entries (see
+ * pdfi_share_xref()) and the font files the pages use, which are read or
+ * decoded once, by the first worker to need them (see pdf_font.c).
+ *
+ * Worker n renders every Nth page, starting with the nth, and sets the
+ * device PageCount before each page so that the output files are named
+ * exactly as they would be if the pages were rendered in order.
+ */
+typedef struct pdf_page_worker_s
+{
+    pl_interp_implementation_t impl;    /* copy of ours, with the worker's instance as client data */
+    gs_memory_t *memory;                /* chunk allocator over the worker's heap */
+    gx_device *device;
+    gp_thread_id thread;
+    const char *filename;
+    int page;                           /* first page for this worker (0 based) */
+    int first_page, last_page;          /* page range of the job (0 based) */
+    int step;                           /* number of workers */
+    int64_t page_count;                 /* device PageCount for first_page */
+    int code;
+} pdf_page_worker_t;
+
+/* The device the workers copy. The erasepage optimisation subclass (see
+ * gdevepo.c) is only an optimisation, which a worker's device gets for
+ * itself, so we look through it to the device underneath.
+ */
+static gx_device *
+pdf_page_worker_target(pdf_context *ctx)
+{
+    gx_device *dev = gs_currentdevice(ctx->pgs);
+
+    if (dev->child != NULL && strcmp(dev->dname, EPO_DEVICENAME) == 0)
+        dev = dev->child;
+    return dev;
+}
+
+/* Can we use page workers with the current device ? */
+static bool
+pdf_page_workers_usable(pdf_context *ctx)
+{
+    gx_device *dev = pdf_page_worker_target(ctx);
+
+    if (ctx->args.pageworkers < 2 || ctx->args.pdfinfo)
+        return false;
+
+    /* Anything other than a plain printer device writing one file per
+     * page (high level devices, subclassed devices, a single output file)
+     * has to see the pages in order.
+     */
+    if (dev->child != NULL)
+        return false;
+    if (dev_proc(dev, dev_spec_op)(dev, gxdso_supports_saved_pages, NULL, 0) <= 0)
+        return false;
+    return gx_outputfile_is_separate_pages(((gx_device_printer *)dev)->fname, ctx->memory);
+}
+
+/* Make a copy of the device for a worker, in the same way as the clist
+ * rendering threads do; start from the prototype and copy the parameters.
+ */
+static int
+pdf_page_worker_device(gx_device *dev, gs_memory_t *mem, gx_device **pndev)
+{
+    gx_device *protodev, *ndev = NULL;
+    gs_c_param_list paramlist;
+    int i, code;
+
+    for (i = 0; (protodev = (gx_device *)gs_getdevice(i)) != NULL; i++)
+        if (strcmp(protodev->dname, dev->dname) == 0)
+            break;
+    if (protodev == NULL)
+        return_error(gs_error_undefined);
+
+    code = gs_copydevice(&ndev, protodev, mem);
+    if (code < 0)
+        return code;
+    gx_device_retain(ndev, true);
+    ndev->PageCount = dev->PageCount;       /* copy to prevent mismatch error */
+
+    /* Profiles are reference counted without locking, so the worker
+     * cannot share ours; give it clones of them.
+     */
+    rc_decrement(ndev->icc_struct, "pdf_page_worker_device");
+    ndev->icc_struct = NULL;
+    if (dev->icc_struct != NULL) {
+        ndev->icc_struct = gsicc_new_device_profile_array(ndev);
+        if (ndev->icc_struct == NULL) {
+            code = gs_note_error(gs_error_VMerror);
+            goto exit;
+        }
+        code = gsicc_clone_profile(dev->icc_struct->device_profile[GS_DEFAULT_DEVICE_PROFILE],
+                                   &ndev->icc_struct->device_profile[GS_DEFAULT_DEVICE_PROFILE], mem);
+        if (code >= 0 && dev->icc_struct->proof_profile != NULL)
+            code = gsicc_clone_profile(dev->icc_struct->proof_profile,
+                                       &ndev->icc_struct->proof_profile, mem);
+        if (code < 0)
+            goto exit;
+    }
+
+    gs_c_param_list_write(&paramlist, mem);
+    code = gs_getdeviceparams(dev, (gs_param_list *)&paramlist);
+    if (code >= 0) {
+        gs_c_param_list_read(&paramlist);
+        code = gs_putdeviceparams(ndev, (gs_param_list *)&paramlist);
+    }
+    gs_c_param_list_release(&paramlist);
+    if (code < 0)
+        goto exit;
+
+    /* Separation devices need the spot colours as well */
+    if (dev_proc(dev, ret_devn_params)(dev) != NULL)
+        code = devn_copy_params(dev, ndev);
+
+exit:
+    if (code < 0) {
+        gx_device_retain(ndev, false);
+        return code;
+    }
+    *pndev = ndev;
+    return 0;
+}
+
+static void
+pdf_page_worker_free(pdf_page_worker_t *worker)
+{
+    gs_memory_t *mem = worker->memory;
+
+    if (mem == NULL)
+        return;
+
+    if (worker->device != NULL)
+        (void)gs_closedevice(worker->device);
+    if (worker->impl.interp_client_data != NULL)
+        (void)pdf_impl_deallocate_interp_instance(&worker->impl);
+    if (worker->device != NULL)
+        gx_device_retain(worker->device, false);
+    worker->device = NULL;
+
+    gs_iodev_finit(mem);
+    gs_fapi_finit(mem);
+    mem->gs_lib_ctx->top_of_system = NULL;
+    gs_malloc_release(gs_memory_chunk_unwrap(mem));
+    worker->memory = NULL;
+}
+
+/* Build a worker; this is done on the main thread, before any of the
+ * workers start, as it reads our instance, device and open file.
+ */
+static int
+pdf_page_worker_init(pl_interp_implementation_t *impl, pdf_page_worker_t *worker,
+                     pdfi_font_files_t *font_files)
+{
+    pdf_interp_instance_t *instance = impl->interp_client_data;
+    gs_lib_ctx_t *lib_ctx = instance->memory->gs_lib_ctx;
+    pdf_context *worker_ctx;
+    pdf_saved_param_t *saved;
+    gs_memory_t *heap;
+    int code;
+
+    /* A heap with its own library context, which shares the core (files,
+     * permissions, CMS context, ids) with ours.
+     */
+    heap = gs_malloc_init_with_context(lib_ctx);
+    /* That made the new heap this thread's debug allocator, put ours back */
+    gp_set_debug_mem_ptr(instance->memory);
+    if (heap == NULL)
+        return_error(gs_error_VMerror);
+    code = gs_memory_chunk_wrap(&worker->memory, heap);
+    if (code < 0) {
+        gs_malloc_release(heap);
+        return code;
+    }
+    worker->memory->gs_lib_ctx->top_of_system = lib_ctx->top_of_system;
+    worker->memory->gs_lib_ctx->icc_color_accuracy = lib_ctx->icc_color_accuracy;
+    worker->memory->gs_lib_ctx->icc_link_cache_size = lib_ctx->icc_link_cache_size;
+    if (lib_ctx->profiledir != NULL) {
+        code = gs_lib_ctx_set_icc_directory(worker->memory, lib_ctx->profiledir, lib_ctx->profiledir_len);
+        if (code < 0)
+            return code;
+    }
+    code = gs_lib_init1(worker->memory);
+    if (code < 0)
+        return code;
+    code = gs_iodev_init(worker->memory);
+    if (code < 0)
+        return code;
+
+    worker->impl = *impl;
+    worker->impl.interp_client_data = NULL;
+    code = pdf_impl_allocate_interp_instance(&worker->impl, worker->memory);
+    if (code < 0)
+        return code;
+    worker_ctx = ((pdf_interp_instance_t *)worker->impl.interp_client_data)->ctx;
+
+    code = pdfi_share_xref(worker_ctx, instance->ctx);
+    if (code < 0)
+        return code;
+    worker_ctx->font_files = font_files;
+
+    for (saved = instance->saved_params; saved != NULL; saved = saved->next) {
+        gs_c_param_list_read(&saved->list);
+        code = pdf_impl_set_param(&worker->impl, (gs_param_list *)&saved->list);
+        if (code < 0)
+            return code;
+    }
+    if (instance->saved_paths != NULL) {
+        code = pdf_impl_add_path(&worker->impl, instance->saved_paths);
+        if (code < 0)
+            return code;
+    }
+
+    return pdf_page_worker_device(pdf_page_worker_target(instance->ctx), worker->memory, &worker->device);
+}
+
+static void
+pdf_page_worker_run(void *data)
+{
+    pdf_page_worker_t *worker = (pdf_page_worker_t *)data;
+    pdf_interp_instance_t *instance = worker->impl.interp_client_data;
+    pdf_context *ctx = instance->ctx;
+    gx_device *dev;
+    int code, i;
+
+    code = pdf_impl_init_job(&worker->impl, worker->device);
+    if (code < 0) {
+        worker->code = code;
+        return;
+    }
+
+    code = pdfi_open_pdf_file(ctx, (char *)worker->filename);
+    if (code < 0) {
+        pdfi_report_errors(ctx);
+    } else {
+        pdfi_device_misc_config(ctx);
+
+        for (i = worker->page; i <= worker->last_page; i += worker->step) {
+            /* The device may have been subclassed (see pdf_page_worker_target()) */
+            for (dev = gs_currentdevice(ctx->pgs); dev != NULL; dev = dev->child)
+                dev->PageCount = worker->page_count + i - worker->first_page;
+            code = pdfi_page_render(ctx, i, true);
+            if (code < 0 && ctx->args.pdfstoponerror)
+                break;
+            code = 0;
+        }
+        pdfi_report_errors(ctx);
+        pdfi_close_pdf_file(ctx);
+    }
+
+    (void)pdf_impl_dnit_job(&worker->impl);
+    worker->code = code;
+}
+
+static int
+pdf_impl_process_file_page_workers(pl_interp_implementation_t *impl, const char *filename)
+{
+    pdf_interp_instance_t *instance = impl->interp_client_data;
+    pdf_context *ctx = instance->ctx;
+    gx_device *dev = pdf_page_worker_target(ctx);
+    pdf_page_worker_t *workers;
+    pdfi_font_files_t *font_files = NULL;
+    int code, i, num_pages, first, last, num_workers;
+
+    /* Open the file here to find out how many pages there are, and to
+     * read the xref for the workers.
+     */
+    code = pdfi_open_pdf_file(ctx, (char *)filename);
+    if (code < 0) {
+        pdfi_report_errors(ctx);
+        return code;
+    }
+    num_pages = ctx->num_pages;
+
+    first = ctx->args.first_page > 0 ? ctx->args.first_page - 1 : 0;
+    last = num_pages - 1;
+    if (ctx->args.last_page > 0 && ctx->args.last_page - 1 < last)
+        last = ctx->args.last_page - 1;
+    num_workers = min(ctx->args.pageworkers, last - first + 1);
+
+    if (ctx->Collection != NULL || num_workers < 2) {
+        pdfi_close_pdf_file(ctx);
+        return pdfi_process_pdf_file(ctx, (char *)filename);
+    }
+
+    workers = (pdf_page_worker_t *)gs_alloc_bytes(ctx->memory, num_workers * sizeof(pdf_page_worker_t),
+                                                  "pdf_impl_process_file_page_workers");
+    if (workers == NULL) {
+        pdfi_close_pdf_file(ctx);
+        return_error(gs_error_VMerror);
+    }
+    memset(workers, 0x00, num_workers * sizeof(pdf_page_worker_t));
+
+    /* The workers can do without sharing font files, if we can't manage it */
+    if (ctx->memory->thread_safe_memory != NULL)
+        (void)pdfi_font_files_alloc(ctx->memory->thread_safe_memory, &font_files);
+
+    for (i = 0; i < num_workers; i++) {
+        workers[i].filename = filename;
+        workers[i].page = first + i;
+        workers[i].first_page = first;
+        workers[i].last_page = last;
+        workers[i].step = num_workers;
+        workers[i].page_count = dev->PageCount;
+        code = pdf_page_worker_init(impl, &workers[i], font_files);
+        if (code < 0)
+            break;
+    }
+
+    if (code < 0) {
+        /* We couldn't build the workers, process the file the usual way */
+        for (i = 0; i < num_workers; i++)
+            pdf_page_worker_free(&workers[i]);
+        gs_free_object(ctx->memory, workers, "pdf_impl_process_file_page_workers");
+        pdfi_font_files_free(font_files);
+        pdfi_close_pdf_file(ctx);
+        return pdfi_process_pdf_file(ctx, (char *)filename);
+    }
+
+    for (i = 0; i < num_workers; i++) {
+        if (gp_thread_start(pdf_page_worker_run, &workers[i], &workers[i].thread) < 0) {
+            /* No threads, render this worker's pages ourselves */
+            workers[i].thread = NULL;
+            pdf_page_worker_run(&workers[i]);
+        }
+    }
+    for (i = 0; i < num_workers; i++) {
+        if (workers[i].thread != NULL)
+            gp_thread_finish(workers[i].thread);
+        if (workers[i].code < 0 && code >= 0)
+            code = workers[i].code;
+    }
+    dev->PageCount += last - first + 1;
+    /* A subclass device takes its PageCount from the child after each page */
+    gs_currentdevice(ctx->pgs)->PageCount = dev->PageCount;
+    ctx->Pdfmark_InitialPage += num_pages;
+
+    for (i = 0; i < num_workers; i++)
+        pdf_page_worker_free(&workers[i]);
+    gs_free_object(ctx->memory, workers, "pdf_impl_process_file_page_workers");
+    pdfi_font_files_free(font_files);
+    /* Anything wrong with the file that we found opening it, the workers
+     * haven't had to find again.
+     */
+    pdfi_report_errors(ctx);
+    pdfi_close_pdf_file(ctx);
+    return code;
+}
+
 /* Parse an entire random access file */
 static int
 pdf_impl_process_file(pl_interp_implementation_t *impl, const char *filename)
@@ -268,7 +662,10 @@ pdf_impl_process_file(pl_interp_implementation_t *impl, const char *filename)
     pdf_context *ctx = instance->ctx;
     int code;
 
-    code = pdfi_process_pdf_file(ctx, (char *)filename);
+    if (pdf_page_workers_usable(ctx))
+        code = pdf_impl_process_file_page_workers(impl, filename);
+    else
+        code = pdfi_process_pdf_file(ctx, (char *)filename);
     if (code)
         return code;
 
@@ -474,6 +871,77 @@ static int plist_value_get_bool(gs_param_typed_value *pvalue, bool *pbool)
 #define argis(P, S) \
 (!strncmp((P), (S), sizeof(S)-1) && ((P)[sizeof(S)-1] == 0 || (P)[sizeof(S)-1] == '=' || (P)[sizeof(S)-1] == '#'))
 
+/* Keep a copy of a parameter, so that page workers can replay it. This
+ * replaces any copy kept for the same key.
+ *
+ * We only keep the one parameter; the list we are given may hold every
+ * parameter set so far, and pdf_impl_set_param() only looks at the first.
+ * The interpreter's parameters are all simple values, so there are no
+ * collections to copy.
+ */
+static int
+pdf_impl_save_param(pdf_interp_instance_t *instance, const char *key, const gs_param_typed_value *pvalue)
+{
+    pdf_saved_param_t *saved, *old, *prev;
+    size_t len = strlen(key);
+    gs_param_typed_value value = *pvalue;
+    int code;
+
+    switch (value.type) {
+        case gs_param_type_dict:
+        case gs_param_type_dict_int_keys:
+        case gs_param_type_array:
+            return 0;
+        case gs_param_type_string:
+        case gs_param_type_name:
+        case gs_param_type_int_array:
+        case gs_param_type_float_array:
+        case gs_param_type_string_array:
+        case gs_param_type_name_array:
+            /* The data belongs to the caller's list, take a copy */
+            value.value.s.persistent = false;
+            break;
+        default:
+            break;
+    }
+
+    saved = (pdf_saved_param_t *)gs_alloc_bytes(instance->memory, sizeof(pdf_saved_param_t) + len, "pdf_impl_save_param");
+    if (saved == NULL)
+        return_error(gs_error_VMerror);
+
+    saved->next = NULL;
+    memcpy(saved->key, key, len + 1);
+    gs_c_param_list_write(&saved->list, instance->memory);
+    gs_param_list_set_persistent_keys((gs_param_list *)&saved->list, false);
+    code = param_write_typed((gs_param_list *)&saved->list, saved->key, &value);
+    if (code < 0) {
+        gs_c_param_list_release(&saved->list);
+        gs_free_object(instance->memory, saved, "pdf_impl_save_param");
+        return code;
+    }
+
+    for (prev = NULL, old = instance->saved_params; old != NULL; prev = old, old = old->next) {
+        if (strcmp(old->key, key) == 0) {
+            if (prev == NULL)
+                instance->saved_params = old->next;
+            else
+                prev->next = old->next;
+            if (instance->last_saved_param == old)
+                instance->last_saved_param = prev;
+            gs_c_param_list_release(&old->list);
+            gs_free_object(instance->memory, old, "pdf_impl_save_param");
+            break;
+        }
+    }
+
+    if (instance->last_saved_param == NULL)
+        instance->saved_params = saved;
+    else
+        instance->last_saved_param->next = saved;
+    instance->last_saved_param = saved;
+    return 0;
+}
+
 static int
 pdf_impl_set_param(pl_interp_implementation_t *impl,
                    gs_param_list    *plist)
@@ -721,10 +1189,37 @@ pdf_impl_set_param(pl_interp_implementation_t *impl,
             if (code < 0)
                 return code;
         }
+        if (argis(param, "PDFObjectCacheSize")) {
+            int size;
+
+            code = plist_value_get_int(&pvalue, &size);
+            if (code < 0)
+                return code;
+            if (size < 0)
+                return_error(gs_error_rangecheck);
+            ctx->args.objectcachesize = size;
+        }
+        if (argis(param, "PDFCacheStatistics")) {
+            code = plist_value_get_bool(&pvalue, &ctx->args.cachestatistics);
+            if (code < 0)
+                return code;
+        }
+        if (argis(param, "PDFPageWorkers")) {
+            int workers;
+
+            code = plist_value_get_int(&pvalue, &workers);
+            if (code < 0)
+                return code;
+            if (workers < 0)
+                return_error(gs_error_rangecheck);
+            ctx->args.pageworkers = workers;
+        }
         if (argis(param, "OutputFile")) {
             if (!Printed_set)
                 ctx->args.printed = true;
         }
+
+        code = pdf_impl_save_param(instance, param, &pvalue);
     }
 
  exit:
@@ -736,8 +1231,28 @@ pdf_impl_add_path(pl_interp_implementation_t *impl, const char *path)
 {
     pdf_interp_instance_t *instance = impl->interp_client_data;
     pdf_context *ctx = instance->ctx;
+    int code;
+    char *paths;
+    size_t len = 0;
 
-    return pdfi_add_paths_to_search_paths(ctx, path, strlen(path), false);
+    code = pdfi_add_paths_to_search_paths(ctx, path, strlen(path), false);
+    if (code < 0)
+        return code;
+
+    /* Remember the path, so that page workers can add it too */
+    if (instance->saved_paths != NULL)
+        len = strlen(instance->saved_paths) + 1;
+    paths = (char *)gs_alloc_bytes(instance->memory, len + strlen(path) + 1, "pdf_impl_add_path");
+    if (paths == NULL)
+        return_error(gs_error_VMerror);
+    if (instance->saved_paths != NULL) {
+        memcpy(paths, instance->saved_paths, len - 1);
+        paths[len - 1] = gp_file_name_list_separator;
+        gs_free_object(instance->memory, instance->saved_paths, "pdf_impl_add_path");
+    }
+    memcpy(paths + len, path, strlen(path) + 1);
+    instance->saved_paths = paths;
+    return 0;
 }
 
 static int
@@ -785,6 +1300,15 @@ pdf_impl_deallocate_interp_instance(pl_interp_implementation_t *impl)
 
     code = pdfi_free_context(ctx);
 
+    while (instance->saved_params != NULL) {
+        pdf_saved_param_t *next = instance->saved_params->next;
+
+        gs_c_param_list_release(&instance->saved_params->list);
+        gs_free_object(mem, instance->saved_params, "pdf_impl_deallocate_interp_instance");
+        instance->saved_params = next;
+    }
+    gs_free_object(mem, instance->saved_paths, "pdf_impl_deallocate_interp_instance");
+
     gs_free_object(mem, instance, "pdf_impl_deallocate_interp_instance");
 
     return code;
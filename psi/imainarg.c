@@ -36,8 +36,10 @@
 #include "gdevprn.h"
 #include "stream.h"
 #include "ierrors.h"
+#include "dstack.h"
 #include "estack.h"
 #include "ialloc.h"
+#include "idict.h"
 #include "strimpl.h"            /* for sfilter.h */
 #include "sfilter.h"            /* for iscan.h */
 #include "ostack.h"             /* must precede iscan.h */
@@ -100,6 +102,8 @@ static int run_string(gs_main_instance *, const char *, int, int, int *, ref *);
 static int run_finish(gs_main_instance *, int, int, ref *);
 static int try_stdout_redirect(gs_main_instance * minst,
                                 const char *command, const char *filename);
+static int fork_jobs(gs_main_instance *, arg_list *);
+static int job_server(gs_main_instance *);
 
 /* Forward references for help printout */
 static void print_help(gs_main_instance *);
@@ -466,6 +470,16 @@ run_stdin:
                 code = gs_add_explicit_control_path(minst->heap, arg, gs_permit_file_control);
                 if (code < 0) return code;
                 break;
+            } else if (strcmp(arg, "fork-jobs") == 0) {
+                code = fork_jobs(minst, pal);
+                if (code < 0)
+                    return code;
+                break;
+            } else if (strcmp(arg, "job-server") == 0) {
+                code = job_server(minst);
+                if (code < 0)
+                    return code;
+                break;
             } else if (arg_match(&arg, "permit-file-all")) {
                 code = gs_add_explicit_control_path(minst->heap, arg, gs_permit_file_reading);
                 if (code < 0) return code;
@@ -838,6 +852,13 @@ run_stdin:
                             return code;
                         }
                     }
+                    else if (strcmp(adef, "GlyphCacheFile") == 0 && strlen(eqp) > 0) {
+                        code = gs_lib_ctx_set_glyph_cache_file(minst->heap, eqp);
+                        if (code < 0) {
+                            arg_free((char *)adef, minst->heap);
+                            return code;
+                        }
+                    }
 
                     ialloc_set_space(idmemory, avm_system);
                     if (isd) {
@@ -1240,6 +1261,594 @@ try_stdout_redirect(gs_main_instance * minst,
     return 1;
 }
 
+/* These set up the device of a job the way gs_init.ps sets up the initial
+ * device, using the same procedures. JOB_DEVICE_SELECT pushes the device
+ * named by DEVICE, or else the current device; JOB_DEVICE_PROPS then
+ * applies the properties in systemdict to it, and JOB_DEVICE_SET selects
+ * it and gives it the graphics state, character cache limit and (for
+ * pdfwrite) distiller parameters it gets at startup.
+ */
+#define JOB_DEVICE_SELECT \
+"systemdict /DEVICE .knownget { finddevice } { currentdevice } ifelse "
+#define JOB_DEVICE_PROPS \
+".configuredevice "
+#define JOB_DEVICE_SET \
+"setdevice .initializedevice " \
+"/IsDistiller /GetDeviceParam .special_op { exch pop } { //false } ifelse " \
+"{ .setdefaultdistillerparams newpath fill } if "
+
+/* The switches that a job line may use to set up the device. */
+#define JOB_DEVICE_SWITCHES "dDsSogr"
+
+#define JOB_LINE_MAX 8192
+
+#ifdef HAVE_FORK
+#include "errno_.h"
+#include "fcntl_.h"
+#include <unistd.h>
+#include <sys/wait.h>
+#endif
+
+/* Read one byte of the job stream. If 'unbuffered' is set, the byte is
+ * read straight from file descriptor 0, so that nothing beyond it is
+ * taken from stdin; otherwise it goes through the (buffered) stdin of
+ * this instance.
+ */
+static int
+job_read_byte(gs_main_instance *minst, bool unbuffered, char *pc)
+{
+#ifdef HAVE_FORK
+    if (unbuffered) {
+        int n;
+
+        while ((n = read(0, pc, 1)) < 0 && errno == EINTR)
+            DO_NOTHING;
+        return n;
+    }
+#endif
+    return gp_stdin_read(pc, 1, 1, minst->heap->gs_lib_ctx->core->fstdin);
+}
+
+/* Read the next job line from stdin, skipping blank and over-long lines.
+ * Returns the length of the line, or -1 at end of file.
+ */
+static int
+job_read_line(gs_main_instance *minst, char *line, bool unbuffered)
+{
+    int len, n;
+    char c;
+
+    do {
+        len = 0;
+        while ((n = job_read_byte(minst, unbuffered, &c)) == 1 && c != '\n') {
+            if (len < JOB_LINE_MAX - 1)
+                line[len] = c;
+            len++;
+        }
+        if (n <= 0 && len == 0)
+            return -1;
+        if (len >= JOB_LINE_MAX) {
+            emprintf1(minst->heap, "Job line longer than %d bytes - ignoring\n",
+                      JOB_LINE_MAX - 1);
+            len = 0;
+        }
+        while (len > 0 && line[len - 1] == '\r')
+            len--;
+        line[len] = 0;
+    } while (len == 0);
+    return len;
+}
+
+/* Run jobs in copies of this instance:
+ *  --fork-jobs
+ * Finish initialization, then read one job per line from stdin. Each job
+ * runs in a forked child, which starts from the fully initialized VM (a
+ * copy-on-write snapshot of this process) instead of running the
+ * initialization files again. The job line holds arguments as they would
+ * appear on the command line after the last switch.
+ * Leading -d, -s, -o, -g and -r switches on the line are applied to the
+ * output device, much as the initialization files do at startup, before
+ * the rest of the line is processed. The jobs can't read stdin, which
+ * holds the job stream; in the child it is /dev/null.
+ * Returns 0 in the child, which carries on with the job's arguments,
+ * and gs_error_Quit in the parent once stdin is exhausted.
+ */
+#ifdef HAVE_FORK
+static const char fork_job_device[] =
+JOB_DEVICE_SELECT JOB_DEVICE_PROPS JOB_DEVICE_SET;
+
+static int
+fork_job_start(gs_main_instance *minst, arg_list *pal, char *line)
+{
+    const char *arg;
+    bool device_args = false;
+    int code;
+
+    if (arg_push_decoded_memory_string(pal, line, false, true, minst->heap))
+        return gs_error_Fatal;
+    /* stdin holds the job stream, so never fall into the executive. */
+    code = swproc(minst, "-dBATCH", pal);
+    if (code < 0)
+        return code;
+    while ((code = arg_next(pal, &arg, minst->heap)) > 0) {
+        if (arg[0] != '-' || arg[1] == 0 || strchr(JOB_DEVICE_SWITCHES, arg[1]) == NULL) {
+            /* Unread the argument for gs_main_init_with_args01. */
+            char *copy = arg_copy(arg, minst->heap);
+
+            if (copy == NULL ||
+                arg_push_memory_string(pal, copy, true, minst->heap))
+                return gs_error_Fatal;
+            break;
+        }
+        code = gs_lib_ctx_stash_sanitized_arg(minst->heap->gs_lib_ctx, arg);
+        if (code < 0)
+            return code;
+        code = swproc(minst, arg, pal);
+        if (code < 0)
+            return code;
+        if (code > 0)
+            outprintf(minst->heap, "Unknown switch %s - ignoring\n", arg);
+        device_args = true;
+    }
+    if (code < 0)
+        return code;
+    if (device_args)
+        code = run_string(minst, fork_job_device, runFlush, minst->user_errors, NULL, NULL);
+    return code;
+}
+
+static int
+fork_jobs(gs_main_instance *minst, arg_list *pal)
+{
+    char *line;
+    int njobs = 0;
+    int code = gs_main_init2(minst);
+
+    if (code < 0)
+        return code;
+    line = (char *)gs_alloc_bytes(minst->heap, JOB_LINE_MAX, "fork_jobs");
+    if (line == NULL)
+        return_error(gs_error_VMerror);
+    /* The job lines are read unbuffered, so that the children don't
+     * inherit the lines after their own in a stdin buffer. */
+    while (job_read_line(minst, line, true) > 0) {
+        long t0[2], t1[2];
+        int status;
+        pid_t pid;
+
+        njobs++;
+        outflush(minst->heap);
+        errflush(minst->heap);
+        gp_get_realtime(t0);
+        pid = fork();
+        if (pid < 0) {
+            emprintf(minst->heap, "Unable to fork a job\n");
+            code = gs_note_error(gs_error_Fatal);
+            break;
+        }
+        if (pid == 0) {
+            char *job = arg_copy(line, minst->heap);
+            int fd = open("/dev/null", O_RDONLY);
+
+            /* The rest of stdin belongs to the parent. */
+            if (fd >= 0) {
+                dup2(fd, 0);
+                close(fd);
+            }
+
+            gs_free_object(minst->heap, line, "fork_jobs");
+            if (job == NULL)
+                return gs_error_Fatal;
+            return fork_job_start(minst, pal, job);
+        }
+        while (waitpid(pid, &status, 0) < 0) {
+            if (errno != EINTR) {
+                status = -1;
+                break;
+            }
+        }
+        gp_get_realtime(t1);
+        errprintf(minst->heap, "%%%%[ Job %d: exit status %d, %.3f s ]%%%%\n",
+                  njobs, WIFEXITED(status) ? WEXITSTATUS(status) : -1,
+                  (t1[0] - t0[0]) + (t1[1] - t0[1]) / 1e9);
+    }
+    gs_free_object(minst->heap, line, "fork_jobs");
+    return code < 0 ? code : gs_error_Quit;
+}
+#else
+static int
+fork_jobs(gs_main_instance *minst, arg_list *pal)
+{
+    outprintf(minst->heap, "   --fork-jobs is not supported on this platform.\n");
+    return gs_error_Fatal;
+}
+#endif
+
+/* Run jobs in this instance:
+ *  --job-server
+ * Finish initialization, then read one job per line from stdin and run
+ * each one as an encapsulated job (see .startnewjob in gs_lev2.ps), so that
+ * whatever it does to local VM is undone by the restore at its end, while
+ * fonts, ICC links and caches stay warm for the next job. A job line holds
+ * -d, -s, -o, -g and -r switches, which set up a fresh copy of the output
+ * device for the job, and the files to run; -c and -f work as they do on
+ * the command line. The switches change systemdict, which is in global VM
+ * and so is not restored with the job: we put the old values back.
+ */
+typedef struct job_server_name_s job_server_name_t;
+struct job_server_name_s {
+    job_server_name_t *next;
+    bool known;                 /* the name was defined before the job */
+    ref value;                  /* the value it had, if simple */
+    byte *str;                  /* or the bytes of a string or name value */
+    uint size;
+    char name[1];               /* variable length */
+};
+
+/* Remember the value of a systemdict name before a job changes it.
+ * Returns 1 if the value cannot be put back, so the job must not change it. */
+static int
+job_server_save_name(gs_main_instance *minst, job_server_name_t **plist,
+                     const char *name, uint len)
+{
+    i_ctx_t *i_ctx_p = minst->i_ctx_p;
+    job_server_name_t *p;
+    ref *pvalue;
+
+    for (p = *plist; p != NULL; p = p->next)
+        if (strlen(p->name) == len && !memcmp(p->name, name, len))
+            return 0;
+    p = (job_server_name_t *)gs_alloc_bytes(minst->heap,
+                                            sizeof(*p) + len, "job_server_save_name");
+    if (p == NULL)
+        return_error(gs_error_VMerror);
+    memcpy(p->name, name, len);
+    p->name[len] = 0;
+    p->str = NULL;
+    p->size = 0;
+    p->known = dict_find_string(systemdict, p->name, &pvalue) > 0;
+    if (p->known) {
+        ref sref;
+
+        switch (r_type(pvalue)) {
+            case t_name:
+                name_string_ref(imemory, pvalue, &sref);
+                pvalue = &sref;
+                /* falls through */
+            case t_string:
+                p->size = r_size(pvalue);
+                p->str = gs_alloc_bytes(minst->heap, max(p->size, 1),
+                                        "job_server_save_name");
+                if (p->str == NULL) {
+                    gs_free_object(minst->heap, p, "job_server_save_name");
+                    return_error(gs_error_VMerror);
+                }
+                memcpy(p->str, pvalue->value.const_bytes, p->size);
+                break;
+            case t_boolean:
+            case t_integer:
+            case t_real:
+            case t_null:
+                p->value = *pvalue;
+                break;
+            default:
+                gs_free_object(minst->heap, p, "job_server_save_name");
+                return 1;
+        }
+    }
+    p->next = *plist;
+    *plist = p;
+    return 0;
+}
+
+/* Put back the values saved by job_server_save_name, and free the list. */
+static int
+job_server_restore_names(gs_main_instance *minst, job_server_name_t *list)
+{
+    i_ctx_t *i_ctx_p = minst->i_ctx_p;
+    job_server_name_t *p;
+    int code = 0;
+
+    while ((p = list) != NULL) {
+        list = p->next;
+        if (code >= 0) {
+            if (!p->known)
+                i_initial_remove_name(i_ctx_p, p->name);
+            else {
+                ref value;
+
+                if (p->str == NULL)
+                    value = p->value;
+                else if (r_has_type(&p->value, t_name))
+                    code = name_ref(imemory, p->str, p->size, &value, 1);
+                else {
+                    uint space = icurrent_space;
+                    byte *str;
+
+                    ialloc_set_space(idmemory, avm_system);
+                    str = ialloc_string(p->size, "job_server_restore_names");
+                    ialloc_set_space(idmemory, space);
+                    if (str == NULL)
+                        code = gs_note_error(gs_error_VMerror);
+                    else {
+                        memcpy(str, p->str, p->size);
+                        make_const_string(&value, a_readonly | avm_system,
+                                          p->size, str);
+                    }
+                }
+                if (code >= 0)
+                    code = i_initial_enter_name_copy(i_ctx_p, p->name, &value);
+            }
+        }
+        gs_free_object(minst->heap, p->str, "job_server_restore_names");
+        gs_free_object(minst->heap, p, "job_server_restore_names");
+    }
+    return code;
+}
+
+/*
+ * A job is allowed to read its files and write its output file only while
+ * it runs. The permissions it needs may already have been given to the
+ * server (e.g. by --permit-file-read), in which case adding them does
+ * nothing, so we note just the paths the job's switches and files really
+ * added, and take away only those at its end.
+ */
+typedef struct job_server_path_s job_server_path_t;
+struct job_server_path_s {
+    job_server_path_t *next;
+    gs_path_control_t type;
+    char path[1];               /* variable length */
+};
+
+static gs_path_control_set_t *
+job_server_control_set(gs_main_instance *minst, gs_path_control_t type)
+{
+    gs_lib_ctx_core_t *core = minst->heap->gs_lib_ctx->core;
+
+    switch (type) {
+        case gs_permit_file_reading:
+            return &core->permit_reading;
+        case gs_permit_file_writing:
+            return &core->permit_writing;
+        default:
+            return &core->permit_control;
+    }
+}
+
+/* Note the paths of a type added since the list had num entries: new
+ * entries are always put at the end. */
+static int
+job_server_note_paths(gs_main_instance *minst, job_server_path_t **plist,
+                      gs_path_control_t type, uint num)
+{
+    gs_path_control_set_t *control = job_server_control_set(minst, type);
+    uint i;
+
+    for (i = num; i < control->num; i++) {
+        const char *path = control->entry[i].path;
+        job_server_path_t *p = (job_server_path_t *)
+            gs_alloc_bytes(minst->heap, sizeof(*p) + strlen(path),
+                           "job_server_note_paths");
+
+        if (p == NULL)
+            return_error(gs_error_VMerror);
+        p->type = type;
+        strcpy(p->path, path);
+        p->next = *plist;
+        *plist = p;
+    }
+    return 0;
+}
+
+/* Let the job read a file. */
+static int
+job_server_permit_reading(gs_main_instance *minst, job_server_path_t **plist,
+                          const char *path)
+{
+    uint num = job_server_control_set(minst, gs_permit_file_reading)->num;
+    int code = gs_add_control_path(minst->heap, gs_permit_file_reading, path);
+
+    if (code < 0)
+        return code;
+    return job_server_note_paths(minst, plist, gs_permit_file_reading, num);
+}
+
+/* Take away the permissions noted for a job, and free the list. */
+static void
+job_server_withdraw_paths(gs_main_instance *minst, job_server_path_t *list)
+{
+    job_server_path_t *p;
+
+    while ((p = list) != NULL) {
+        list = p->next;
+        (void)gs_remove_control_path(minst->heap, p->type, p->path);
+        gs_free_object(minst->heap, p, "job_server_withdraw_paths");
+    }
+}
+
+/* Remember the systemdict names that a device switch is about to set. */
+static int
+job_server_switch_names(gs_main_instance *minst, job_server_name_t **plist,
+                        const char *arg)
+{
+    static const char *const o_names[] = {"OutputFile", "BATCH", "NOPAUSE", 0};
+    static const char *const g_names[] = {"FIXEDMEDIA", "DEVICEWIDTH", "DEVICEHEIGHT", 0};
+    static const char *const r_names[] = {"FIXEDRESOLUTION", "DEVICEXRESOLUTION", "DEVICEYRESOLUTION", 0};
+    const char *const *names;
+    int code = 0;
+
+    switch (arg[1]) {
+        case 'o':
+            names = o_names;
+            break;
+        case 'g':
+            names = g_names;
+            break;
+        case 'r':
+            names = r_names;
+            break;
+        default:
+            return job_server_save_name(minst, plist, arg + 2,
+                                        strcspn(arg + 2, "=#"));
+    }
+    for (; *names != NULL && code == 0; names++)
+        code = job_server_save_name(minst, plist, *names, strlen(*names));
+    return code;
+}
+
+/* Append to the PostScript program that runs a job, hex encoding the
+ * argument if there is one. */
+static int
+job_server_append(gs_main_instance *minst, char **pbuf, uint *psize,
+                  const char *str, const char *arg)
+{
+    uint len = strlen(*pbuf) + strlen(str) + 1 + (arg ? esc_strlen(arg) + 1 : 0);
+
+    if (len > *psize) {
+        uint size = max(len, *psize * 2);
+        char *buf = (char *)gs_resize_object(minst->heap, *pbuf, size,
+                                             "job_server_append");
+
+        if (buf == NULL)
+            return_error(gs_error_VMerror);
+        *pbuf = buf;
+        *psize = size;
+    }
+    if (arg != NULL) {
+        esc_strcat(*pbuf, arg);
+        strcat(*pbuf, " ");
+    }
+    strcat(*pbuf, str);
+    return 0;
+}
+
+/* Each job gets its own copy of the device prototype: copying a device
+ * that is open is not safe. */
+static const char job_server_begin[] =
+"false 0 .startnewjob { "
+"systemdict /DEVICE .knownget not { currentpagedevice /OutputDevice get } if "
+"findprotodevice copydevice " JOB_DEVICE_PROPS JOB_DEVICE_SET;
+static const char job_server_end[] =
+"} stopped { $error /newerror get dup { handleerror } if } { //false } ifelse "
+"count 1 roll count 1 sub { pop } repeat cleardictstack "
+"serverdict /.jobsave get restore "
+"serverdict /.jobsave //null put serverdict /.jobsavelevel 0 put";
+
+/* Run one job. Sets *failed if the job ran into an error; returns an
+ * error only if the server cannot carry on. */
+static int
+job_server_run(gs_main_instance *minst, char *line, bool *failed)
+{
+    arg_list args;
+    const char *arg;
+    job_server_name_t *names = NULL;
+    job_server_path_t *paths = NULL;
+    uint size = 1024;
+    char *ps = (char *)gs_alloc_bytes(minst->heap, size, "job_server_run");
+    bool code_args = false;
+    int code, code1;
+
+    if (ps == NULL)
+        return_error(gs_error_VMerror);
+    *ps = 0;
+    code = arg_init(&args, NULL, 0, gs_main_arg_sopen, (void *)minst,
+                    minst->get_codepoint, minst->heap);
+    if (code >= 0 &&
+        arg_push_decoded_memory_string(&args, line, false, true, NULL))
+        code = gs_note_error(gs_error_Fatal);
+    if (code >= 0)
+        code = job_server_append(minst, &ps, &size, job_server_begin, NULL);
+    while (code >= 0 && (code = arg_next(&args, &arg, minst->heap)) > 0) {
+        if (code_args && (arg[0] != '-' || isdigit((unsigned char)arg[1]))) {
+            code = job_server_append(minst, &ps, &size, "cvx exec ", arg);
+            continue;
+        }
+        code_args = false;
+        if (arg[0] != '-' || arg[1] == 0) {
+            code = job_server_permit_reading(minst, &paths, arg);
+            if (code >= 0)
+                code = job_server_append(minst, &ps, &size, "run ", arg);
+        } else if (strchr(JOB_DEVICE_SWITCHES, arg[1]) != NULL) {
+            code = job_server_switch_names(minst, &names, arg);
+            if (code > 0) {
+                emprintf1(minst->heap, "%s cannot be changed by a job - ignoring\n", arg);
+                code = 0;
+            } else if (code == 0) {
+                /* -o and -sOutputFile let the job write its output file. */
+                uint nwrite = job_server_control_set(minst, gs_permit_file_writing)->num;
+                uint ncontrol = job_server_control_set(minst, gs_permit_file_control)->num;
+
+                code = swproc(minst, arg, &args);
+                if (code > 0) {
+                    outprintf(minst->heap, "Unknown switch %s - ignoring\n", arg);
+                    code = 0;
+                }
+                code1 = job_server_note_paths(minst, &paths, gs_permit_file_writing, nwrite);
+                if (code1 >= 0)
+                    code1 = job_server_note_paths(minst, &paths, gs_permit_file_control, ncontrol);
+                if (code >= 0)
+                    code = code1;
+            }
+        } else if (!strcmp(arg, "-c"))
+            code_args = true;
+        else if (arg[1] == 'f') {
+            if (arg[2] != 0) {
+                code = job_server_permit_reading(minst, &paths, arg + 2);
+                if (code >= 0)
+                    code = job_server_append(minst, &ps, &size, "run ", arg + 2);
+            }
+        } else
+            emprintf1(minst->heap, "%s cannot be used in a job - ignoring\n", arg);
+    }
+    if (code >= 0)
+        code = job_server_append(minst, &ps, &size, job_server_end, NULL);
+    if (code >= 0) {
+        code = run_string(minst, ps, runFlush, minst->user_errors, NULL, NULL);
+        if (code >= 0)
+            code = gs_pop_boolean(minst, failed);
+    } else
+        *failed = true;
+    code1 = job_server_restore_names(minst, names);
+    if (code >= 0)
+        code = code1;
+    arg_finit(&args);
+    job_server_withdraw_paths(minst, paths);
+    gs_free_object(minst->heap, ps, "job_server_run");
+    return code;
+}
+
+static int
+job_server(gs_main_instance *minst)
+{
+    char *line;
+    int njobs = 0;
+    int code = gs_main_init2(minst);
+
+    if (code >= 0)
+        code = swproc(minst, "-dNOPAUSE", NULL);
+    if (code < 0)
+        return code;
+    line = (char *)gs_alloc_bytes(minst->heap, JOB_LINE_MAX, "job_server");
+    if (line == NULL)
+        return_error(gs_error_VMerror);
+    while (job_read_line(minst, line, false) > 0) {
+        long t0[2], t1[2];
+        bool failed = true;
+
+        njobs++;
+        gp_get_realtime(t0);
+        code = job_server_run(minst, line, &failed);
+        gp_get_realtime(t1);
+        errprintf(minst->heap, "%%%%[ Job %d: exit status %d, %.3f s ]%%%%\n",
+                  njobs, failed ? 1 : 0,
+                  (t1[0] - t0[0]) + (t1[1] - t0[1]) / 1e9);
+        if (code < 0)
+            break;
+    }
+    gs_free_object(minst->heap, line, "job_server");
+    return code < 0 ? code : gs_error_Quit;
+}
+
 /* ---------------- Print information ---------------- */
 
 /*
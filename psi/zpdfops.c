@@ -1529,6 +1529,17 @@ static int zPDFInit(i_ctx_t *i_ctx_p)
                 goto error;
             pdfctx->ctx->args.nonativefontmap = pvalueref->value.boolval;
         }
+        if (dict_find_string(pdictref, "PDFObjectCacheSize", &pvalueref) > 0) {
+            if (!r_has_type(pvalueref, t_integer) || pvalueref->value.intval < 0 ||
+                pvalueref->value.intval > max_int)
+                goto error;
+            pdfctx->ctx->args.objectcachesize = (int)pvalueref->value.intval;
+        }
+        if (dict_find_string(pdictref, "PDFCacheStatistics", &pvalueref) > 0) {
+            if (!r_has_type(pvalueref, t_boolean))
+                goto error;
+            pdfctx->ctx->args.cachestatistics = pvalueref->value.boolval;
+        }
         if (dict_find_string(pdictref, "PageCount", &pvalueref) > 0) {
             if (!r_has_type(pvalueref, t_integer))
                 goto error;
@@ -43,6 +43,7 @@
 #include "gsparamx.h"
 #include "gx.h"
 #include "gxgstate.h"
+#include "gxpcolor.h"		/* for pattern cache status */
 #include "gslibctx.h"
 
 
@@ -184,6 +185,31 @@ current_CurFontCache(i_ctx_t *i_ctx_p)
     return cstat[0];
 }
 
+static long
+current_PatternCacheHits(i_ctx_t *i_ctx_p)
+{
+    gx_pattern_cache_stats_t stats;
+
+    gx_pattern_cache_get_stats(gstate_pattern_cache(igs), &stats);
+    return stats.hits;
+}
+static long
+current_PatternCacheMisses(i_ctx_t *i_ctx_p)
+{
+    gx_pattern_cache_stats_t stats;
+
+    gx_pattern_cache_get_stats(gstate_pattern_cache(igs), &stats);
+    return stats.misses;
+}
+static long
+current_PatternCacheEvictions(i_ctx_t *i_ctx_p)
+{
+    gx_pattern_cache_stats_t stats;
+
+    gx_pattern_cache_get_stats(gstate_pattern_cache(igs), &stats);
+    return stats.evictions;
+}
+
 /* Even though size_t is unsigned, PostScript limits this to signed range */
 static size_t
 current_MaxGlobalVM(i_ctx_t *i_ctx_p)
@@ -242,6 +268,9 @@ static const long_param_def_t system_long_params[] =
     {"BuildTime", min_long, max_long, current_BuildTime, NULL},
     {"MaxFontCache", 0, MAX_UINT_PARAM, current_MaxFontCache, set_MaxFontCache},
     {"CurFontCache", 0, MAX_UINT_PARAM, current_CurFontCache, NULL},
+    {"PatternCacheHits", 0, max_long, current_PatternCacheHits, NULL},
+    {"PatternCacheMisses", 0, max_long, current_PatternCacheMisses, NULL},
+    {"PatternCacheEvictions", 0, max_long, current_PatternCacheEvictions, NULL},
     {"Revision", min_long, max_long, current_Revision, NULL},
     {"PageCount", min_long, max_long, current_PageCount, NULL}
 };
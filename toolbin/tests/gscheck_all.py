@@ -23,6 +23,7 @@ from gstestutils import gsRunTestsMain
 def addTests(suite, gsroot, now, options=None, **args):
     import gscheck_raster; gscheck_raster.addTests(suite,gsroot,now,options=options,**args)
     import gscheck_pdfwrite; gscheck_pdfwrite.addTests(suite,gsroot,now,options=options, **args)
+    import gscheck_jobs; gscheck_jobs.addTests(suite,gsroot,**args)
 
 if __name__ == "__main__":
     gsRunTestsMain(addTests)
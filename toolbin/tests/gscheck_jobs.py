@@ -0,0 +1,98 @@
+#!/usr/bin/env python
+
+# Copyright (C) 2001-2023 Artifex Software, Inc.
+# All Rights Reserved.
+#
+# This software is provided AS-IS with no warranty, either express or
+# implied.
+#
+# This software is distributed under license and may not be copied,
+# modified or distributed except as expressly authorized under the terms
+# of the license contained in the file LICENSE in this distribution.
+#
+# Refer to licensing information at http://www.artifex.com or contact
+# Artifex Software, Inc.,  1305 Grant Avenue - Suite 200, Novato,
+# CA 94945, U.S.A., +1(415)492-9861, for further information.
+#
+
+
+#
+# gscheck_jobs.py
+#
+# runs jobs through --job-server and --fork-jobs and checks that their
+# output is byte-identical to that of the same jobs run one per process.
+#
+
+import os, shutil, subprocess, tempfile
+from gstestutils import GSTestCase, gsRunTestsMain
+
+# Each job: the file to run, relative to gsroot, and its device switches.
+# The second job of a pair differs from the first only in resolution, so
+# a job that inherits state from the one before shows up as a difference.
+jobs = [
+    ('examples/annots.pdf', ['-sDEVICE=png16m', '-r50']),
+    ('examples/annots.pdf', ['-sDEVICE=png16m', '-r100', '-dFirstPage=2', '-dLastPage=2']),
+    ('examples/tiger.eps', ['-sDEVICE=pgmraw', '-r72']),
+    ('examples/tiger.eps', ['-sDEVICE=pgmraw', '-r30', '-sPAPERSIZE=a4']),
+]
+
+class GSCheckJobOutput(GSTestCase):
+
+    def __init__(self, gsroot, mode):
+        self.gsroot = gsroot
+        self.mode = mode
+        GSTestCase.__init__(self)
+
+    def shortDescription(self):
+        return "Jobs run by %s must give the same output as standalone runs." % self.mode
+
+    def outputs(self, dir, prefix):
+        files = [f for f in os.listdir(dir) if f.startswith(prefix)]
+        files.sort()
+        return files
+
+    def runTest(self):
+        gs = os.path.join(self.gsroot, 'bin', 'gs')
+        dir = tempfile.mkdtemp()
+        messages = []
+        try:
+            lines = []
+            for n in range(len(jobs)):
+                file, switches = jobs[n]
+                file = os.path.join(self.gsroot, file)
+                out = os.path.join(dir, 'job%d_%%d' % n)
+                code = subprocess.call([gs, '-q', '-dBATCH', '-dNOPAUSE'] + switches +
+                                       ['-sOutputFile=' + out + '.a', file])
+                if code != 0:
+                    messages.append("standalone job %d: exit code %d" % (n, code))
+                lines.append(' '.join(switches + ['-sOutputFile=' + out + '.b', file]))
+            server = subprocess.Popen([gs, '-q', '-dNOPAUSE', self.mode], stdin=subprocess.PIPE)
+            server.communicate(('\n'.join(lines) + '\n').encode())
+            if server.returncode != 0:
+                messages.append("%s: exit code %d" % (self.mode, server.returncode))
+            for n in range(len(jobs)):
+                a = self.outputs(dir, 'job%d_' % n)
+                pages = [f[:-2] for f in a if f.endswith('.a')]
+                if len(pages) == 0:
+                    messages.append("job %d: no output" % n)
+                for page in pages:
+                    if not os.path.exists(os.path.join(dir, page + '.b')):
+                        messages.append("job %d: %s missing" % (n, page))
+                    elif open(os.path.join(dir, page + '.a'), 'rb').read() != \
+                         open(os.path.join(dir, page + '.b'), 'rb').read():
+                        messages.append("job %d: %s differs" % (n, page))
+                if len(a) != 2 * len(pages):
+                    messages.append("job %d: page count differs" % n)
+        finally:
+            shutil.rmtree(dir)
+        self.failIfMessages(messages)
+
+# Add the tests defined in this file to a suite.
+
+def addTests(suite, gsroot, **args):
+    suite.addTest(GSCheckJobOutput(gsroot, '--job-server'))
+    if os.name == 'posix':
+        suite.addTest(GSCheckJobOutput(gsroot, '--fork-jobs'))
+
+if __name__ == "__main__":
+    gsRunTestsMain(addTests)